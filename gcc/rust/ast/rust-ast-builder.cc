@@ -35,6 +35,31 @@ Builder::literal_string (std::string &&content) const
 			  PrimitiveCoreType::CORETYPE_STR, {}, loc));
 }
 
+std::unique_ptr<Expr>
+Builder::literal_bool (bool value) const
+{
+  return std::unique_ptr<Expr> (
+    new AST::LiteralExpr (value ? "true" : "false", Literal::LitType::BOOL,
+			  PrimitiveCoreType::CORETYPE_BOOL, {}, loc));
+}
+
+std::unique_ptr<Expr>
+Builder::comparison (std::unique_ptr<Expr> &&lhs, std::unique_ptr<Expr> &&rhs,
+		     ComparisonOperator op) const
+{
+  return std::unique_ptr<Expr> (
+    new ComparisonExpr (std::move (lhs), std::move (rhs), op, loc));
+}
+
+std::unique_ptr<Expr>
+Builder::boolean_operation (std::unique_ptr<Expr> &&lhs,
+			    std::unique_ptr<Expr> &&rhs,
+			    LazyBooleanOperator op) const
+{
+  return std::unique_ptr<Expr> (
+    new LazyBooleanExpr (std::move (lhs), std::move (rhs), op, loc));
+}
+
 std::unique_ptr<Expr>
 Builder::call (std::unique_ptr<Expr> &&path,
 	       std::vector<std::unique_ptr<Expr>> &&args) const
@@ -43,6 +68,68 @@ Builder::call (std::unique_ptr<Expr> &&path,
     new CallExpr (std::move (path), std::move (args), {}, loc));
 }
 
+std::unique_ptr<Expr>
+Builder::method_call (std::unique_ptr<Expr> &&receiver, std::string method,
+		      std::vector<std::unique_ptr<Expr>> &&args) const
+{
+  return std::unique_ptr<Expr> (new MethodCallExpr (std::move (receiver),
+						    path_segment (method),
+						    std::move (args), {}, loc));
+}
+
+std::unique_ptr<Stmt>
+Builder::statement (std::unique_ptr<Expr> &&expr) const
+{
+  return std::unique_ptr<Stmt> (
+    new ExprStmt (std::move (expr), loc, /* semicolon_followed */ true));
+}
+
+std::unique_ptr<Expr>
+Builder::unsafe_block (std::unique_ptr<Expr> &&expr) const
+{
+  auto block = std::unique_ptr<BlockExpr> (
+    new BlockExpr ({}, std::move (expr), {}, {}, LoopLabel::error (), loc,
+		   loc));
+
+  return std::unique_ptr<Expr> (
+    new UnsafeBlockExpr (std::move (block), {}, loc));
+}
+
+std::unique_ptr<Expr>
+Builder::if_else (std::unique_ptr<Expr> &&condition,
+		  std::unique_ptr<Expr> &&then_expr,
+		  std::unique_ptr<Expr> &&else_expr) const
+{
+  auto then_block = std::unique_ptr<BlockExpr> (
+    new BlockExpr ({}, std::move (then_expr), {}, {}, LoopLabel::error (), loc,
+		   loc));
+  auto else_block = std::unique_ptr<BlockExpr> (
+    new BlockExpr ({}, std::move (else_expr), {}, {}, LoopLabel::error (), loc,
+		   loc));
+
+  return std::unique_ptr<Expr> (
+    new IfExprConseqElse (std::move (condition), std::move (then_block),
+			  std::move (else_block), {}, loc));
+}
+
+std::unique_ptr<Expr>
+Builder::match (std::unique_ptr<Expr> &&scrutinee,
+		std::vector<MatchCase> &&cases) const
+{
+  return std::unique_ptr<Expr> (
+    new MatchExpr (std::move (scrutinee), std::move (cases), {}, {}, loc));
+}
+
+MatchCase
+Builder::match_case (std::unique_ptr<Pattern> &&pattern,
+		     std::unique_ptr<Expr> &&expr) const
+{
+  auto patterns = std::vector<std::unique_ptr<Pattern>> ();
+  patterns.emplace_back (std::move (pattern));
+
+  return MatchCase (MatchArm (std::move (patterns), loc), std::move (expr));
+}
+
 std::unique_ptr<Expr>
 Builder::array (std::vector<std::unique_ptr<Expr>> &&members) const
 {
@@ -92,14 +179,66 @@ Builder::single_type_path (std::string type) const
   return std::unique_ptr<Type> (new TypePath (std::move (segments), loc));
 }
 
+std::unique_ptr<Type>
+Builder::ref_type (std::string type, bool mut) const
+{
+  auto segments = std::vector<std::unique_ptr<TypePathSegment>> ();
+  segments.emplace_back (type_path_segment (type));
+
+  auto path
+    = std::unique_ptr<TypeNoBounds> (new TypePath (std::move (segments), loc));
+
+  return std::unique_ptr<Type> (new ReferenceType (mut, std::move (path), loc));
+}
+
+std::unique_ptr<Type>
+Builder::ref_type (std::unique_ptr<TypeNoBounds> &&type, bool mut) const
+{
+  return std::unique_ptr<Type> (new ReferenceType (mut, std::move (type), loc));
+}
+
+TypePath
+Builder::type_path (std::vector<std::string> &&segments,
+		    bool opening_scope_resolution) const
+{
+  auto path_segments = std::vector<std::unique_ptr<TypePathSegment>> ();
+  for (auto &seg : segments)
+    path_segments.emplace_back (type_path_segment (seg));
+
+  return TypePath (std::move (path_segments), loc, opening_scope_resolution);
+}
+
+std::unique_ptr<Type>
+Builder::generic_type_path (TypePath &&path, std::unique_ptr<Type> &&arg) const
+{
+  auto segments = std::move (path.get_segments ());
+  auto last = std::move (segments.back ());
+  segments.pop_back ();
+
+  auto args = std::vector<GenericArg> ();
+  args.emplace_back (GenericArg::create_type (std::move (arg)));
+
+  segments.emplace_back (
+    new TypePathSegmentGeneric (last->get_ident_segment (),
+				last->get_separating_scope_resolution (),
+				GenericArgs ({}, std::move (args), {}, loc),
+				loc));
+
+  return std::unique_ptr<Type> (
+    new TypePath (std::move (segments), loc,
+		  path.has_opening_scope_resolution_op ()));
+}
+
 PathInExpression
-Builder::path_in_expression (std::vector<std::string> &&segments) const
+Builder::path_in_expression (std::vector<std::string> &&segments,
+			     bool opening_scope_resolution) const
 {
   auto path_segments = std::vector<PathExprSegment> ();
   for (auto &seg : segments)
     path_segments.emplace_back (path_segment (seg));
 
-  return PathInExpression (std::move (path_segments), {}, loc);
+  return PathInExpression (std::move (path_segments), {}, loc,
+			   opening_scope_resolution);
 }
 
 std::unique_ptr<Expr>
@@ -174,5 +313,29 @@ Builder::wildcard () const
   return std::unique_ptr<Pattern> (new WildcardPattern (loc));
 }
 
+std::unique_ptr<Pattern>
+Builder::identifier_pattern (std::string name) const
+{
+  return std::unique_ptr<Pattern> (
+    new IdentifierPattern (Identifier (name, loc), loc));
+}
+
+std::unique_ptr<Pattern>
+Builder::path_pattern (PathInExpression &&path) const
+{
+  return std::unique_ptr<Pattern> (new PathInExpression (std::move (path)));
+}
+
+std::unique_ptr<Pattern>
+Builder::tuple_struct_pattern (
+  PathInExpression &&path, std::vector<std::unique_ptr<Pattern>> &&items) const
+{
+  auto tuple_items = std::unique_ptr<TupleStructItems> (
+    new TupleStructItemsNoRange (std::move (items)));
+
+  return std::unique_ptr<Pattern> (
+    new TupleStructPattern (std::move (path), std::move (tuple_items)));
+}
+
 } // namespace AST
 } // namespace Rust
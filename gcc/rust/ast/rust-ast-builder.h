@@ -46,6 +46,19 @@ public:
   std::unique_ptr<Expr> ref (std::unique_ptr<Expr> &&of,
 			     bool mut = false) const;
 
+  /* Create a boolean literal expression (`true`) */
+  std::unique_ptr<Expr> literal_bool (bool value) const;
+
+  /* Create a comparison between two expressions (`lhs == rhs`) */
+  std::unique_ptr<Expr> comparison (std::unique_ptr<Expr> &&lhs,
+				    std::unique_ptr<Expr> &&rhs,
+				    ComparisonOperator op) const;
+
+  /* Create a lazy boolean expression (`lhs && rhs`) */
+  std::unique_ptr<Expr> boolean_operation (std::unique_ptr<Expr> &&lhs,
+					   std::unique_ptr<Expr> &&rhs,
+					   LazyBooleanOperator op) const;
+
   /* Create a dereference of an expression (`*of`) */
   std::unique_ptr<Expr> deref (std::unique_ptr<Expr> &&of) const;
 
@@ -67,6 +80,34 @@ public:
   std::unique_ptr<Expr> call (std::unique_ptr<Expr> &&path,
 			      std::vector<std::unique_ptr<Expr>> &&args) const;
 
+  /**
+   * Create a method call expression, given its arguments
+   * (`receiver.method(arg0, arg1)`)
+   */
+  std::unique_ptr<Expr>
+  method_call (std::unique_ptr<Expr> &&receiver, std::string method,
+	       std::vector<std::unique_ptr<Expr>> &&args) const;
+
+  /* Create an expression statement (`expr;`) */
+  std::unique_ptr<Stmt> statement (std::unique_ptr<Expr> &&expr) const;
+
+  /* Create an unsafe block whose tail expression is EXPR (`unsafe { expr }`) */
+  std::unique_ptr<Expr> unsafe_block (std::unique_ptr<Expr> &&expr) const;
+
+  /* Create an if expression whose blocks have the tail expressions THEN_EXPR
+     and ELSE_EXPR (`if condition { then_expr } else { else_expr }`) */
+  std::unique_ptr<Expr> if_else (std::unique_ptr<Expr> &&condition,
+				 std::unique_ptr<Expr> &&then_expr,
+				 std::unique_ptr<Expr> &&else_expr) const;
+
+  /* Create a match expression (`match scrutinee { case0, case1 }`) */
+  std::unique_ptr<Expr> match (std::unique_ptr<Expr> &&scrutinee,
+			       std::vector<MatchCase> &&cases) const;
+
+  /* Create a match case with a single pattern (`pattern => expr`) */
+  MatchCase match_case (std::unique_ptr<Pattern> &&pattern,
+			std::unique_ptr<Expr> &&expr) const;
+
   /**
    * Create an array expression (`[member0, member1, member2]`)
    */
@@ -86,13 +127,33 @@ public:
    */
   std::unique_ptr<Type> single_type_path (std::string type) const;
 
+  /* Create a reference to a type from a single string (`&type`) */
+  std::unique_ptr<Type> ref_type (std::string type, bool mut = false) const;
+
+  /* Create a reference to a type (`&type`) */
+  std::unique_ptr<Type> ref_type (std::unique_ptr<TypeNoBounds> &&type,
+				  bool mut = false) const;
+
+  /**
+   * Create a type path from multiple segments (`fmt::Result`), starting with
+   * `::` when OPENING_SCOPE_RESOLUTION is set
+   */
+  TypePath type_path (std::vector<std::string> &&segments,
+		      bool opening_scope_resolution = false) const;
+
+  /* Give a single generic type argument to the last segment of a type path
+     (`Option` to `Option<arg>`) */
+  std::unique_ptr<Type> generic_type_path (TypePath &&path,
+					   std::unique_ptr<Type> &&arg) const;
+
   /**
    * Create a path in expression from multiple segments (`Clone::clone`). You
    * do not need to separate the segments using `::`, you can simply provide a
    * vector of strings to the functions which will get turned into path segments
    */
   PathInExpression
-  path_in_expression (std::vector<std::string> &&segments) const;
+  path_in_expression (std::vector<std::string> &&segments,
+		      bool opening_scope_resolution = false) const;
 
   /* Create a struct expression for unit structs (`S`) */
   std::unique_ptr<Expr> struct_expr_struct (std::string struct_name) const;
@@ -116,6 +177,18 @@ public:
   /* Create a wildcard pattern (`_`) */
   std::unique_ptr<Pattern> wildcard () const;
 
+  /* Create a pattern binding a new variable (`name`) */
+  std::unique_ptr<Pattern> identifier_pattern (std::string name) const;
+
+  /* Create a pattern matching a unit struct or enum variant (`Path`) */
+  std::unique_ptr<Pattern> path_pattern (PathInExpression &&path) const;
+
+  /* Create a pattern matching a tuple struct or enum variant
+     (`Path(item0, item1)`) */
+  std::unique_ptr<Pattern>
+  tuple_struct_pattern (PathInExpression &&path,
+			std::vector<std::unique_ptr<Pattern>> &&items) const;
+
 private:
   /**
    * Location of the generated AST nodes
@@ -71,13 +71,19 @@ TokenCollector::trailing_comma ()
 void
 TokenCollector::newline ()
 {
-  tokens.push_back ({CollectItem::Kind::Newline});
+  if (sink)
+    sink->newline ();
+  else
+    tokens.push_back ({CollectItem::Kind::Newline});
 }
 
 void
 TokenCollector::indentation ()
 {
-  tokens.push_back ({indent_level});
+  if (sink)
+    sink->indentation (indent_level);
+  else
+    tokens.push_back ({indent_level});
 }
 
 void
@@ -96,7 +102,10 @@ TokenCollector::decrement_indentation ()
 void
 TokenCollector::comment (std::string comment)
 {
-  tokens.push_back ({comment});
+  if (sink)
+    sink->comment (comment);
+  else
+    tokens.push_back ({comment});
 }
 
 void
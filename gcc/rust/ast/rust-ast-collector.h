@@ -70,10 +70,43 @@ private:
   Kind kind;
 };
 
+/**
+ * Receives the tokens and the layout of the code as a TokenCollector visits
+ * it, so that they can be used right away rather than stored.
+ */
+class CollectSink
+{
+public:
+  virtual ~CollectSink () {}
+
+  virtual void token (TokenPtr token) = 0;
+  virtual void newline () {}
+  virtual void indentation (size_t level ATTRIBUTE_UNUSED) {}
+  virtual void comment (const std::string &comment ATTRIBUTE_UNUSED) {}
+};
+
+/**
+ * Sink appending the tokens to a vector, and dropping the layout.
+ */
+class TokenSink : public CollectSink
+{
+public:
+  TokenSink (std::vector<const_TokenPtr> &tokens) : tokens (tokens) {}
+
+  void token (TokenPtr token) override { tokens.push_back (token); }
+
+private:
+  std::vector<const_TokenPtr> &tokens;
+};
+
 class TokenCollector : public ASTVisitor
 {
 public:
-  TokenCollector () : indent_level (0) {}
+  TokenCollector () : indent_level (0), sink (nullptr) {}
+
+  // Hand everything to SINK as it is collected instead of storing it, in
+  // which case collect and collect_tokens return nothing
+  TokenCollector (CollectSink &sink) : indent_level (0), sink (&sink) {}
 
   bool output_trailing_commas = false;
 
@@ -86,8 +119,15 @@ public:
 private:
   std::vector<CollectItem> tokens;
   size_t indent_level;
+  CollectSink *sink;
 
-  void push (TokenPtr token) { tokens.push_back ({token}); }
+  void push (TokenPtr token)
+  {
+    if (sink)
+      sink->token (token);
+    else
+      tokens.push_back ({token});
+  }
 
   /**
    * Visit all items in given @collection, placing the separator in between but
@@ -18,11 +18,16 @@
 
 #include "rust-ast-dump.h"
 #include "rust-expr.h"
+#include "rust-item.h"
 
 namespace Rust {
 namespace AST {
 
-Dump::Dump (std::ostream &stream) : stream (stream), indentation (Indent ()) {}
+Dump::Dump (std::ostream &stream, const std::string &filter,
+	    const std::string &crate_name)
+  : stream (stream), indentation (Indent ()), filter (filter),
+    crate_name (crate_name)
+{}
 
 bool
 Dump::require_spacing (TokenPtr previous, TokenPtr current)
@@ -65,6 +70,35 @@ Dump::require_spacing (TokenPtr previous, TokenPtr current)
     }
 }
 
+void
+Dump::Printer::token (TokenPtr token)
+{
+  if (require_spacing (previous, token))
+    stream << " ";
+  stream << token->as_string ();
+  previous = token;
+}
+
+void
+Dump::Printer::newline ()
+{
+  stream << "\n";
+  previous = nullptr;
+}
+
+void
+Dump::Printer::indentation (size_t level)
+{
+  for (size_t i = 0; i < level; i++)
+    stream << "    ";
+}
+
+void
+Dump::Printer::comment (const std::string &comment)
+{
+  stream << " /* " << comment << " */ ";
+}
+
 void
 Dump::debug (Visitable &v)
 {
@@ -72,10 +106,88 @@ Dump::debug (Visitable &v)
   dump.process (v);
 }
 
+/**
+ * Dump the crate one item at a time, so that the tokens of a single item are
+ * collected at once instead of the whole crate's
+ */
 void
 Dump::go (AST::Crate &crate)
 {
-  process (crate);
+  if (!filter.empty ())
+    {
+      go_filtered (crate.items, crate_name);
+      return;
+    }
+
+  for (auto &attr : crate.inner_attrs)
+    {
+      process (attr);
+      stream << "\n";
+    }
+
+  for (auto &item : crate.items)
+    {
+      process (*item);
+      stream << "\n";
+    }
+}
+
+// The name of the items which can be selected by a dump filter
+static tl::optional<std::string>
+item_name (Item &item)
+{
+  if (auto module = dynamic_cast<Module *> (&item))
+    return module->get_name ().as_string ();
+  if (auto function = dynamic_cast<Function *> (&item))
+    return function->get_function_name ().as_string ();
+  if (auto structure = dynamic_cast<Struct *> (&item))
+    return structure->get_identifier ().as_string ();
+  if (auto enumeration = dynamic_cast<Enum *> (&item))
+    return enumeration->get_identifier ().as_string ();
+  if (auto union_item = dynamic_cast<Union *> (&item))
+    return union_item->get_identifier ().as_string ();
+  if (auto trait = dynamic_cast<Trait *> (&item))
+    return trait->get_identifier ().as_string ();
+  if (auto alias = dynamic_cast<TypeAlias *> (&item))
+    return alias->get_new_type_name ().as_string ();
+  if (auto constant = dynamic_cast<ConstantItem *> (&item))
+    return constant->get_identifier ();
+  if (auto static_item = dynamic_cast<StaticItem *> (&item))
+    return static_item->get_identifier ().as_string ();
+
+  return tl::nullopt;
+}
+
+/**
+ * Dump the ITEMS of the module at PARENT which are selected by the filter,
+ * each preceded by a comment with its path
+ */
+void
+Dump::go_filtered (std::vector<std::unique_ptr<Item>> &items,
+		   const std::string &parent)
+{
+  for (auto &item : items)
+    {
+      auto name = item_name (*item);
+      if (!name)
+	continue;
+
+      auto path = parent + "::" + name.value ();
+      auto match = DumpFilter::match (filter, path);
+      if (match == DumpFilter::SKIP)
+	continue;
+
+      auto module = dynamic_cast<Module *> (item.get ());
+      if (match == DumpFilter::DESCEND && module != nullptr)
+	{
+	  go_filtered (module->get_items (), path);
+	  continue;
+	}
+
+      stream << "// " << path << "\n";
+      process (*item);
+      stream << "\n";
+    }
 }
 
 void
@@ -31,7 +31,10 @@ namespace AST {
 class Dump
 {
 public:
-  Dump (std::ostream &stream);
+  // Only the items whose path, as CRATE_NAME::module::item, is selected by
+  // FILTER are dumped, see DumpFilter
+  Dump (std::ostream &stream, const std::string &filter = "",
+	const std::string &crate_name = "");
 
   /**
    * Run the visitor on an entire crate and its items
@@ -41,47 +44,38 @@ public:
 
   template <typename T> void process (T &v)
   {
-    TokenCollector collector;
+    Printer printer (stream);
+    TokenCollector collector (printer);
     collector.visit (v);
-
-    TokenPtr previous = nullptr;
-    for (auto item : collector.collect ())
-      {
-	switch (item.get_kind ())
-	  {
-	    case AST::CollectItem::Kind::Token: {
-	      TokenPtr current = item.get_token ();
-	      if (require_spacing (previous, current))
-		stream << " ";
-	      stream << current->as_string ();
-	      previous = current;
-	    }
-	    break;
-	  case AST::CollectItem::Kind::Comment:
-	    stream << " /* " << item.get_comment () << " */ ";
-	    break;
-	  case AST::CollectItem::Kind::Indentation:
-	    for (size_t i = 0; i < item.get_indent_level (); i++)
-	      {
-		stream << "    ";
-	      }
-	    break;
-	  case AST::CollectItem::Kind::Newline:
-	    stream << "\n";
-	    previous = nullptr;
-	    break;
-	  default:
-	    rust_unreachable ();
-	  }
-      }
   }
 
   // Helper method to get a quick debug dump to standard error output
   static void debug (Visitable &v);
 
 private:
+  // Writes the code to the stream as the collector visits it
+  class Printer : public CollectSink
+  {
+  public:
+    Printer (std::ostream &stream) : stream (stream), previous (nullptr) {}
+
+    void token (TokenPtr token) override;
+    void newline () override;
+    void indentation (size_t level) override;
+    void comment (const std::string &comment) override;
+
+  private:
+    std::ostream &stream;
+    TokenPtr previous;
+  };
+
   std::ostream &stream;
   Indent indentation;
+  std::string filter;
+  std::string crate_name;
+
+  void go_filtered (std::vector<std::unique_ptr<Item>> &items,
+		    const std::string &parent);
 
   static bool require_spacing (TokenPtr previous, TokenPtr current);
 };
@@ -664,7 +664,39 @@ DefaultASTVisitor::visit (AST::AsyncBlockExpr &expr)
 
 void
 DefaultASTVisitor::visit (AST::InlineAsm &expr)
-{}
+{
+  using RegisterType = AST::InlineAsmOperand::RegisterType;
+
+  for (auto &operand : expr.operands)
+    switch (operand.register_type)
+      {
+      case RegisterType::In:
+	visit (operand.in.expr);
+	break;
+      case RegisterType::Out:
+	if (operand.out.expr)
+	  visit (operand.out.expr);
+	break;
+      case RegisterType::InOut:
+	visit (operand.in_out.expr);
+	break;
+      case RegisterType::SplitInOut:
+	visit (operand.split_in_out.in_expr);
+	if (operand.split_in_out.out_expr)
+	  visit (operand.split_in_out.out_expr);
+	break;
+      case RegisterType::Const:
+	visit (operand.cnst.anon_const.expr);
+	break;
+      case RegisterType::Sym:
+	visit (operand.sym.expr);
+	break;
+      case RegisterType::Label:
+	if (operand.label.expr)
+	  visit (operand.label.expr);
+	break;
+      }
+}
 
 void
 DefaultASTVisitor::visit (AST::TypeParam &param)
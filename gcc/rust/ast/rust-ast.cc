@@ -32,7 +32,10 @@ along with GCC; see the file COPYING3.  If not see
 #include "rust-parse.h"
 #include "rust-operators.h"
 #include "rust-dir-owner.h"
+#include "rust-module-prefetch.h"
+#include "rust-make-deps.h"
 #include "rust-attribute-values.h"
+#include "rust-attributes.h"
 
 /* Compilation unit used for various AST-related functions that would make
  * the headers too long if they were defined inline and don't receive any
@@ -311,7 +314,7 @@ Attribute::get_traits_to_derive ()
 
 // Copy constructor must deep copy attr_input as unique pointer
 Attribute::Attribute (Attribute const &other)
-  : path (other.path), locus (other.locus)
+  : path (other.path), locus (other.locus), builtin (other.builtin)
 {
   // guard to protect from null pointer dereference
   if (other.attr_input != nullptr)
@@ -324,6 +327,7 @@ Attribute::operator= (Attribute const &other)
 {
   path = other.path;
   locus = other.locus;
+  builtin = other.builtin;
   // guard to protect from null pointer dereference
   if (other.attr_input != nullptr)
     attr_input = other.attr_input->clone_attr_input ();
@@ -3347,6 +3351,14 @@ Module::process_file_path ()
   rust_assert (kind == Module::ModuleKind::UNLOADED);
   rust_assert (module_file.empty ());
 
+  module_file = find_file_path (true).value_or ("");
+}
+
+tl::optional<std::string>
+Module::find_file_path (bool report_errors)
+{
+  rust_assert (kind == Module::ModuleKind::UNLOADED);
+
   // This corresponds to the path of the file 'including' the module. So the
   // file that contains the 'mod <file>;' directive
   std::string including_fpath (outer_filename);
@@ -3389,10 +3401,7 @@ Module::process_file_path ()
     }
 
   if (!path_string.empty ())
-    {
-      module_file = current_directory_name + path_string;
-      return;
-    }
+    return current_directory_name + path_string;
 
   // FIXME: We also have to search for
   // <directory>/<including_fname>/<module_name>.rs In rustc, this is done via
@@ -3411,21 +3420,21 @@ Module::process_file_path ()
   bool multiple_candidates_found = file_mod_found && dir_mod_found;
   bool no_candidates_found = !file_mod_found && !dir_mod_found;
 
-  if (multiple_candidates_found)
+  if (multiple_candidates_found && report_errors)
     rust_error_at (locus,
 		   "two candidates found for module %s: %s.rs and %s%smod.rs",
 		   module_name.as_string ().c_str (),
 		   module_name.as_string ().c_str (),
 		   module_name.as_string ().c_str (), file_separator);
 
-  if (no_candidates_found)
+  if (no_candidates_found && report_errors)
     rust_error_at (locus, "no candidate found for module %s",
 		   module_name.as_string ().c_str ());
 
   if (no_candidates_found || multiple_candidates_found)
-    return;
+    return tl::nullopt;
 
-  module_file = std::move (file_mod_found ? file_mod_path : dir_mod_path);
+  return file_mod_found ? file_mod_path : dir_mod_path;
 }
 
 void
@@ -3438,19 +3447,30 @@ Module::load_items ()
   if (module_file.empty ())
     return;
 
-  RAIIFile file_wrap (module_file.c_str ());
   Linemap *linemap = Session::get_instance ().linemap;
-  if (!file_wrap.ok ())
+  auto &prefetcher = ModulePrefetcher::get ();
+
+  // the file may already have been read by the module prefetcher
+  auto contents = prefetcher.take (module_file);
+  RAIIFile file_wrap = contents.has_value ()
+			 ? RAIIFile::create_error ()
+			 : RAIIFile (module_file.c_str ());
+  if (!contents.has_value () && !file_wrap.ok ())
     {
       rust_error_at (get_locus (), "cannot open module file %s: %m",
 		     module_file.c_str ());
       return;
     }
 
+  MakeDependencies::get ().add_dependency (module_file);
+
   rust_debug ("Attempting to parse file %s", module_file.c_str ());
 
-  Lexer lex (module_file.c_str (), std::move (file_wrap), linemap);
-  Parser<Lexer> parser (lex);
+  std::unique_ptr<Lexer> lex (
+    contents.has_value ()
+      ? new Lexer (module_file.c_str (), contents.value (), linemap)
+      : new Lexer (module_file.c_str (), std::move (file_wrap), linemap));
+  Parser<Lexer> parser (*lex);
 
   // we need to parse any possible inner attributes for this module
   inner_attrs = parser.parse_inner_attributes ();
@@ -3460,6 +3480,9 @@ Module::load_items ()
 
   items = std::move (parsed_items);
   kind = ModuleKind::LOADED;
+
+  // start reading the files of the modules this one declares
+  prefetcher.prefetch (items);
 }
 
 void
@@ -4226,8 +4249,8 @@ Attribute::check_cfg_predicate (const Session &session) const
   /* assume that cfg predicate actually can exist, i.e. attribute has cfg or
    * cfg_attr path */
   if (!has_attr_input ()
-      || (path.as_string () != Values::Attributes::CFG
-	  && path.as_string () != Values::Attributes::CFG_ATTR))
+      || (path != Values::Attributes::CFG
+	  && path != Values::Attributes::CFG_ATTR))
     {
       // DEBUG message
       rust_debug (
@@ -4243,7 +4266,35 @@ Attribute::check_cfg_predicate (const Session &session) const
     return false;
 
   auto &meta_item = static_cast<AttrInputMetaItemContainer &> (*attr_input);
-  return meta_item.get_items ().front ()->check_cfg_predicate (session);
+  return meta_item.check_cfg_attr_predicate (session);
+}
+
+bool
+AttrInputMetaItemContainer::check_cfg_attr_predicate (
+  const Session &session) const
+{
+  if (!cfg_predicate.has_value ())
+    cfg_predicate = items.front ()->check_cfg_predicate (session);
+
+  return cfg_predicate.value ();
+}
+
+Values::BuiltinAttribute
+Attribute::get_builtin () const
+{
+  if (builtin.has_value ())
+    return builtin.value ();
+
+  // builtin attributes always have a single segment
+  auto &segments = path.get_segments ();
+  if (segments.size () != 1)
+    builtin = Values::BuiltinAttribute::UNKNOWN;
+  else
+    builtin = Analysis::BuiltinAttributeMappings::get ()
+		->lookup_builtin (segments[0].get_segment_name ())
+		.kind;
+
+  return builtin.value ();
 }
 
 std::vector<Attribute>
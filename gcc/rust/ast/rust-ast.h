@@ -26,6 +26,7 @@
 #include "rust-location.h"
 #include "rust-diagnostics.h"
 #include "rust-keyword-values.h"
+#include "rust-attribute-values.h"
 
 namespace Rust {
 // TODO: remove typedefs and make actual types for these
@@ -321,22 +322,38 @@ private:
   /* TODO: maybe make subclasses of each type of literal with their typed
    * values (or generics) */
   std::string value_as_string;
+  // Holds the value instead when it is too large to be copied with the
+  // literal, see max_interned_length
+  std::shared_ptr<const std::string> large_value;
   LitType type;
   PrimitiveCoreType type_hint;
 
 public:
-  std::string as_string () const { return value_as_string; }
+  std::string as_string () const
+  {
+    return large_value ? *large_value : value_as_string;
+  }
 
   LitType get_lit_type () const { return type; }
 
   PrimitiveCoreType get_type_hint () const { return type_hint; }
 
+  const std::shared_ptr<const std::string> &get_large_value () const
+  {
+    return large_value;
+  }
+
   Literal (std::string value_as_string, LitType type,
 	   PrimitiveCoreType type_hint)
     : value_as_string (std::move (value_as_string)), type (type),
       type_hint (type_hint)
   {}
 
+  Literal (std::shared_ptr<const std::string> large_value, LitType type,
+	   PrimitiveCoreType type_hint)
+    : large_value (std::move (large_value)), type (type), type_hint (type_hint)
+  {}
+
   static Literal create_error ()
   {
     return Literal ("", ERROR, PrimitiveCoreType::CORETYPE_UNKNOWN);
@@ -634,6 +651,10 @@ private:
 
   bool inner_attribute;
 
+  // The builtin attribute named by path, resolved the first time it is asked
+  // for
+  mutable tl::optional<Values::BuiltinAttribute> builtin;
+
   // TODO: maybe a variable storing whether attr input is parsed or not
 
 public:
@@ -742,7 +763,15 @@ public:
   // no visitor pattern as not currently polymorphic
 
   const SimplePath &get_path () const { return path; }
-  SimplePath &get_path () { return path; }
+  SimplePath &get_path ()
+  {
+    builtin = tl::nullopt;
+    return path;
+  }
+
+  /* Which builtin attribute this is, or UNKNOWN. Prefer this to comparing
+   * the path with one of the Values::Attributes names. */
+  Values::BuiltinAttribute get_builtin () const;
 
   // Call to parse attribute body to meta item syntax.
   void parse_attr_to_meta_item ();
@@ -859,6 +888,12 @@ class AttrInputMetaItemContainer : public AttrInput
 {
   std::vector<std::unique_ptr<MetaItemInner>> items;
 
+  /* The cfg predicate of a cfg or cfg_attr attribute, evaluated the first
+   * time it is checked. The cfg stripping pass runs on every expansion round
+   * but the target options never change, so this is kept for later rounds.
+   */
+  mutable tl::optional<bool> cfg_predicate;
+
 public:
   AttrInputMetaItemContainer (std::vector<std::unique_ptr<MetaItemInner>> items)
     : items (std::move (items))
@@ -866,6 +901,7 @@ public:
 
   // copy constructor with vector clone
   AttrInputMetaItemContainer (const AttrInputMetaItemContainer &other)
+    : cfg_predicate (other.cfg_predicate)
   {
     items.reserve (other.items.size ());
     for (const auto &e : other.items)
@@ -881,6 +917,7 @@ public:
     items.reserve (other.items.size ());
     for (const auto &e : other.items)
       items.push_back (e->clone_meta_item_inner ());
+    cfg_predicate = other.cfg_predicate;
 
     return *this;
   }
@@ -911,10 +948,17 @@ public:
 
   std::vector<Attribute> separate_cfg_attrs () const override;
 
+  // Whether the cfg predicate, the first item, holds for SESSION
+  bool check_cfg_attr_predicate (const Session &session) const;
+
   bool is_meta_item () const override { return true; }
 
   // TODO: this mutable getter seems dodgy
-  std::vector<std::unique_ptr<MetaItemInner>> &get_items () { return items; }
+  std::vector<std::unique_ptr<MetaItemInner>> &get_items ()
+  {
+    cfg_predicate = tl::nullopt;
+    return items;
+  }
   const std::vector<std::unique_ptr<MetaItemInner>> &get_items () const
   {
     return items;
@@ -4975,8 +4975,10 @@ struct InlineAsmOperand
 
   InlineAsmOperand () {}
   InlineAsmOperand (const InlineAsmOperand &other)
-    : in (other.in), out (other.out), in_out (other.in_out),
-      split_in_out (other.split_in_out), cnst (other.cnst), sym (other.sym)
+    : register_type (other.register_type), in (other.in), out (other.out),
+      in_out (other.in_out), split_in_out (other.split_in_out),
+      cnst (other.cnst), sym (other.sym), label (other.label),
+      locus (other.locus)
   {}
 
   void set_in (const tl::optional<struct In> &reg)
@@ -28,43 +28,34 @@ ffi::RustHamster::to_string () const
   return std::string (ptr, len);
 }
 
-Pieces
-Pieces::collect (const std::string &to_parse, bool append_newline)
-{
-  auto handle = ffi::collect_pieces (to_parse.c_str (), append_newline);
-
-  // this performs multiple copies, can we avoid them maybe?
-  // TODO: Instead of just creating a vec of, basically, `ffi::Piece`s, we
-  // should transform them into the proper C++ type which we can work with. so
-  // transform all the strings into C++ strings? all the Option<T> into
-  // tl::optional<T>?
-  auto pieces_vector = std::vector<ffi::Piece> (handle.piece_slice.base_ptr,
-						handle.piece_slice.base_ptr
-						  + handle.piece_slice.len);
-
-  return Pieces (handle, std::move (pieces_vector));
-}
+Pieces::Data::Data (ffi::FormatArgsHandle handle)
+  : handle (handle),
+    // TODO: Instead of just creating a vec of, basically, `ffi::Piece`s, we
+    // should transform them into the proper C++ type which we can work with.
+    // so transform all the strings into C++ strings? all the Option<T> into
+    // tl::optional<T>?
+    pieces (handle.piece_slice.base_ptr,
+	    handle.piece_slice.base_ptr + handle.piece_slice.len)
+{}
 
-Pieces::~Pieces () { ffi::destroy_pieces (handle); }
+Pieces::Data::~Data () { ffi::destroy_pieces (handle); }
 
-Pieces::Pieces (const Pieces &other) : pieces_vector (other.pieces_vector)
-{
-  handle = ffi::clone_pieces (other.handle);
-}
-
-Pieces &
-Pieces::operator= (const Pieces &other)
+Pieces
+Pieces::collect (const std::string &to_parse, bool append_newline)
 {
-  handle = ffi::clone_pieces (other.handle);
-  pieces_vector = other.pieces_vector;
-
-  return *this;
+  // the pieces never change once parsed, so they are kept for the whole
+  // compilation and shared by every invocation using the same string
+  static thread_local std::map<std::pair<std::string, bool>,
+			       std::shared_ptr<const Data>>
+    cache;
+
+  auto &data = cache[std::make_pair (to_parse, append_newline)];
+  if (data == nullptr)
+    data = std::make_shared<const Data> (
+      ffi::collect_pieces (to_parse.c_str (), append_newline));
+
+  return Pieces (data);
 }
 
-Pieces::Pieces (Pieces &&other)
-  : pieces_vector (std::move (other.pieces_vector)),
-    handle (clone_pieces (other.handle))
-{}
-
 } // namespace Fmt
 } // namespace Rust
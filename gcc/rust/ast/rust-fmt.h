@@ -272,36 +272,37 @@ void destroy_pieces (FormatArgsHandle);
 
 } // namespace ffi
 
+/**
+ * The pieces of a parsed format string. Parsing goes through the Rust
+ * format_parser, and identical format strings are common (think of logging
+ * code), so every string is parsed once and its pieces are shared between all
+ * the Pieces created for it. Copying Pieces is cheap.
+ */
 struct Pieces
 {
   static Pieces collect (const std::string &to_parse, bool append_newline);
-  ~Pieces ();
 
-  Pieces (const Pieces &other);
-  Pieces &operator= (const Pieces &other);
+  const std::vector<ffi::Piece> &get_pieces () const { return data->pieces; }
 
-  Pieces (Pieces &&other);
-
-  const std::vector<ffi::Piece> &get_pieces () const { return pieces_vector; }
-
-  // {
-  //   slice = clone_pieces (&other.slice);
-  //   to_parse = other.to_parse;
+private:
+  struct Data
+  {
+    Data (ffi::FormatArgsHandle handle);
+    ~Data ();
 
-  //   return *this;
-  // }
+    Data (const Data &) = delete;
+    Data &operator= (const Data &) = delete;
 
-private:
-  Pieces (ffi::FormatArgsHandle handle, std::vector<ffi::Piece> &&pieces_vector)
-    : pieces_vector (std::move (pieces_vector)), handle (handle)
-  {}
+    // this memory is held for FFI reasons - it needs to be released
+    // precisely, so try to not access it/modify it if possible. you should
+    // instead work with `pieces`, which points into it
+    ffi::FormatArgsHandle handle;
+    std::vector<ffi::Piece> pieces;
+  };
 
-  std::vector<ffi::Piece> pieces_vector;
+  Pieces (std::shared_ptr<const Data> data) : data (std::move (data)) {}
 
-  // this memory is held for FFI reasons - it needs to be released and cloned
-  // precisely, so try to not access it/modify it if possible. you should
-  // instead work with `pieces_vector`
-  ffi::FormatArgsHandle handle;
+  std::shared_ptr<const Data> data;
 };
 
 } // namespace Fmt
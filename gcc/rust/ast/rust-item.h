@@ -856,6 +856,9 @@ public:
   // Search for the filename associated with an external module, storing it in
   // module_file
   void process_file_path ();
+  // Search for the filename associated with an external module, without
+  // storing it
+  tl::optional<std::string> find_file_path (bool report_errors);
   // Load the items contained in an external module
   void load_items ();
 
@@ -20,6 +20,8 @@
 
 #include "target.h"
 #include "stringpool.h"
+#include "timevar.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace Compile {
@@ -27,8 +29,11 @@ namespace Compile {
 BuiltinsContext &
 BuiltinsContext::get ()
 {
-  static BuiltinsContext instance;
-  return instance;
+  auto &instance = ThreadState::current ().builtins;
+  if (instance == nullptr)
+    instance = new BuiltinsContext ();
+
+  return *instance;
 }
 
 bool
@@ -43,10 +48,15 @@ BuiltinsContext::lookup_simple_builtin (const std::string &name, tree *builtin)
   return lookup_gcc_builtin (*to_search, builtin);
 }
 
-BuiltinsContext::BuiltinsContext () { setup (); }
+BuiltinsContext::BuiltinsContext ()
+{
+  auto_timevar tv (TV_RUST_BUILTINS);
+  setup ();
+}
 
 /**
- * Define a function type according to `builtin-types.def`
+ * Record a function type of `builtin-types.def`, it is only built by
+ * `get_builtin_type`
  *
  * *Heavily* inspired by the D frontend's `def_fn_type` function
  */
@@ -57,35 +67,78 @@ BuiltinsContext::define_function_type (Type def_idx, Type ret_idx,
   va_list list;
   va_start (list, n);
 
-  auto args = std::vector<tree> ();
+  auto &def = builtin_type_defs[def_idx];
+  def.kind = is_variadic ? TypeDef::VARIADIC_FUNCTION : TypeDef::FUNCTION;
+  def.ret = ret_idx;
+  def.n_args = n;
 
   for (size_t i = 0; i < n; i++)
     {
       // The argument is an enum Type, but it's promoted to int when passed
       // though '...'.
-      auto arg_idx = va_arg (list, int);
-      auto arg_type = builtin_types[arg_idx];
-
-      args.emplace_back (arg_type);
+      def.args[i] = (Type) va_arg (list, int);
     }
 
-  auto return_type = builtin_types[ret_idx];
-  if (return_type == error_mark_node)
+  va_end (list);
+}
+
+void
+BuiltinsContext::define_primitive_type (Type def_idx, tree type)
+{
+  builtin_type_defs[def_idx].kind = TypeDef::PRIMITIVE;
+  builtin_types[def_idx] = type;
+  builtin_type_built[def_idx] = true;
+}
+
+void
+BuiltinsContext::define_pointer_type (Type def_idx, Type pointee_idx)
+{
+  auto &def = builtin_type_defs[def_idx];
+  def.kind = TypeDef::POINTER;
+  def.ret = pointee_idx;
+  def.n_args = 0;
+}
+
+/**
+ * Get one of the types of `builtin-types.def`, building it and the types it
+ * refers to on first use
+ */
+tree
+BuiltinsContext::get_builtin_type (Type idx)
+{
+  if (builtin_type_built[idx])
+    return builtin_types[idx];
+
+  auto &def = builtin_type_defs[idx];
+  rust_assert (def.kind != TypeDef::PRIMITIVE);
+
+  auto type = NULL_TREE;
+  auto ret = get_builtin_type (def.ret);
+  if (ret == error_mark_node)
     {
       // Mark the builtin as not available.
-      builtin_types[def_idx] = error_mark_node;
-      va_end (list);
-      return;
+      type = error_mark_node;
+    }
+  else if (def.kind == TypeDef::POINTER)
+    {
+      type = build_pointer_type (ret);
     }
-
-  auto fn_type = NULL_TREE;
-  if (is_variadic)
-    fn_type = build_varargs_function_type_array (return_type, n, args.data ());
   else
-    fn_type = build_function_type_array (return_type, n, args.data ());
+    {
+      tree args[11];
+      for (size_t i = 0; i < def.n_args; i++)
+	args[i] = get_builtin_type (def.args[i]);
+
+      if (def.kind == TypeDef::VARIADIC_FUNCTION)
+	type = build_varargs_function_type_array (ret, def.n_args, args);
+      else
+	type = build_function_type_array (ret, def.n_args, args);
+    }
 
-  builtin_types[def_idx] = fn_type;
-  va_end (list);
+  builtin_types[idx] = type;
+  builtin_type_built[idx] = true;
+
+  return type;
 }
 
 // Taken directly from the D frontend
@@ -136,7 +189,10 @@ BuiltinsContext::define_builtin_types ()
     return type ? type : error_mark_node;
   };
 
-#define DEF_PRIMITIVE_TYPE(ENUM, VALUE) builtin_types[ENUM] = VALUE;
+  for (size_t i = 0; i <= Type::BT_LAST; i++)
+    builtin_type_built[i] = false;
+
+#define DEF_PRIMITIVE_TYPE(ENUM, VALUE) define_primitive_type (ENUM, VALUE);
 #define DEF_FUNCTION_TYPE_0(ENUM, RETURN)                                      \
   define_function_type (ENUM, RETURN, 0, 0);
 #define DEF_FUNCTION_TYPE_1(ENUM, RETURN, A1)                                  \
@@ -185,8 +241,7 @@ BuiltinsContext::define_builtin_types ()
 				 A9, A10, A11)                                 \
   define_function_type (ENUM, RETURN, 1, 11, A1, A2, A3, A4, A5, A6, A7, A8,   \
 			A9, A10, A11);
-#define DEF_POINTER_TYPE(ENUM, TYPE)                                           \
-  builtin_types[ENUM] = build_pointer_type (builtin_types[TYPE]);
+#define DEF_POINTER_TYPE(ENUM, TYPE) define_pointer_type (ENUM, TYPE);
 
 #include "builtin-types.def"
 
@@ -213,7 +268,7 @@ BuiltinsContext::define_builtin_types ()
 #undef DEF_FUNCTION_TYPE_VAR_11
 #undef DEF_POINTER_TYPE
 
-  builtin_types[Type::BT_LAST] = NULL_TREE;
+  define_primitive_type (Type::BT_LAST, NULL_TREE);
 }
 
 /**
@@ -245,37 +300,28 @@ BuiltinsContext::define_builtin_attributes ()
 }
 
 /**
- * Define all builtin functions during the first initialization of the
- * `BuiltinsContext`.
+ * Register all builtin functions during the first initialization of the
+ * `BuiltinsContext`. The implicit builtins, which the middle end may introduce
+ * calls to on its own, are declared right away. The declarations of the other
+ * ones are built by `lookup_gcc_builtin`
  */
 void
 BuiltinsContext::define_builtins ()
 {
   auto *built_in_attributes = builtin_attributes;
-  auto build_builtin = [this] (built_in_function fn_code, const char *fn_name,
-			       built_in_class fn_class, tree fn_type, bool both,
-			       bool fallback, tree attributes, bool implicit) {
-    if (fn_type == error_mark_node)
-      return;
-
-    static auto to_skip = strlen ("__builtin_");
-
-    auto libname = fn_name + to_skip;
-    auto decl = add_builtin_function (fn_name, fn_type, fn_code, fn_class,
-				      fallback ? libname : NULL, attributes);
-
-    set_builtin_decl (fn_code, decl, implicit);
-
-    builtin_functions.insert ({std::string (fn_name), decl});
-  };
 
 #define DEF_BUILTIN(ENUM, NAME, CLASS, TYPE, LIBTYPE, BOTH_P, FALLBACK_P,      \
 		    NONANSI_P, ATTRS, IMPLICIT, COND)                          \
   if (NAME && COND)                                                            \
-    build_builtin (ENUM, NAME, CLASS, builtin_types[TYPE], BOTH_P, FALLBACK_P, \
-		   built_in_attributes[ATTRS], IMPLICIT);
+    builtin_defs.insert ({std::string (NAME),                                  \
+			  {ENUM, CLASS, TYPE, built_in_attributes[ATTRS],      \
+			   bool (FALLBACK_P), bool (IMPLICIT)}});
 #include "builtins.def"
 #undef DEF_BUILTIN
+
+  for (auto &def : builtin_defs)
+    if (def.second.implicit)
+      build_builtin (def.first, def.second);
 }
 
 /**
@@ -322,6 +368,9 @@ BuiltinsContext::register_rust_mappings ()
     {"fmaf32", "__builtin_fmaf"},
     {"fmaf64", "__builtin_fma"},
 
+    {"fmuladdf32", "__builtin_fmaf"},
+    {"fmuladdf64", "__builtin_fma"},
+
     {"fabsf32", "__builtin_fabsf"},
     {"fabsf64", "__builtin_fabs"},
 
@@ -351,6 +400,9 @@ BuiltinsContext::register_rust_mappings ()
 
     {"roundf32", "__builtin_roundf"},
     {"roundf64", "__builtin_round"},
+
+    {"roundevenf32", "__builtin_roundevenf"},
+    {"roundevenf64", "__builtin_roundeven"},
   };
 }
 
@@ -368,12 +420,52 @@ bool
 BuiltinsContext::lookup_gcc_builtin (const std::string &name, tree *builtin)
 {
   auto it = builtin_functions.find (name);
-  if (it == builtin_functions.end ())
+  if (it != builtin_functions.end ())
+    {
+      *builtin = it->second;
+      return true;
+    }
+
+  auto def = builtin_defs.find (name);
+  if (def == builtin_defs.end ())
     return false;
 
-  *builtin = it->second;
+  auto_timevar tv (TV_RUST_BUILTINS);
+
+  auto decl = build_builtin (name, def->second);
+  if (decl == error_mark_node)
+    return false;
+
+  *builtin = decl;
   return true;
 }
 
+/**
+ * Build the declaration of a builtin function and register it, or return
+ * `error_mark_node` if one of the types it uses is not available
+ */
+tree
+BuiltinsContext::build_builtin (const std::string &name,
+				const BuiltinDef &info)
+{
+  auto fn_type = get_builtin_type (info.type);
+  if (fn_type == error_mark_node)
+    return error_mark_node;
+
+  static auto to_skip = strlen ("__builtin_");
+
+  auto fn_name = name.c_str ();
+  auto libname = fn_name + to_skip;
+  auto decl = add_builtin_function (fn_name, fn_type, info.code, info.fn_class,
+				    info.fallback ? libname : NULL,
+				    info.attributes);
+
+  set_builtin_decl (info.code, decl, info.implicit);
+
+  builtin_functions.insert ({name, decl});
+
+  return decl;
+}
+
 } // namespace Compile
 } // namespace Rust
@@ -166,13 +166,50 @@ private:
     ATTR_LAST,
   };
 
+  /**
+   * How to build one of the types of `builtin-types.def`. Function and pointer
+   * types are only built once a builtin using them is looked up.
+   */
+  struct TypeDef
+  {
+    enum Kind
+    {
+      PRIMITIVE,
+      FUNCTION,
+      VARIADIC_FUNCTION,
+      POINTER,
+    } kind;
+
+    // The return type of a function, or the pointee of a pointer
+    Type ret;
+    unsigned char n_args;
+    Type args[11];
+  };
+
+  /**
+   * A GCC builtin exposed to GCC Rust, the arguments of `add_builtin_function`
+   * and `set_builtin_decl` until its declaration is built
+   */
+  struct BuiltinDef
+  {
+    built_in_function code;
+    built_in_class fn_class;
+    Type type;
+    tree attributes;
+    bool fallback;
+    bool implicit;
+  };
+
   /**
    * All builtin types, as defined in `builtin-types.def`
    *
-   * This array is filled by the `define_builtin_types` method, during the first
-   * initialization of the `BuiltinsContext`
+   * This array is filled by `get_builtin_type`, the primitive types are all
+   * set by `define_builtin_types` during the first initialization of the
+   * `BuiltinsContext`
    */
   tree builtin_types[Type::BT_LAST + 1];
+  bool builtin_type_built[Type::BT_LAST + 1];
+  TypeDef builtin_type_defs[Type::BT_LAST + 1];
 
   /**
    * Similarly, this array contains all builtin attributes, as defined in
@@ -185,6 +222,9 @@ private:
 
   void define_function_type (Type def, Type ret, bool is_variadic, size_t n,
 			     ...);
+  void define_primitive_type (Type def, tree type);
+  void define_pointer_type (Type def, Type pointee);
+  tree get_builtin_type (Type type);
   void define_builtin_types ();
   void define_builtin_attributes ();
   void define_builtins ();
@@ -200,8 +240,12 @@ private:
   void setup ();
 
   bool lookup_gcc_builtin (const std::string &name, tree *builtin);
+  tree build_builtin (const std::string &name, const BuiltinDef &info);
 
-  // A mapping of the GCC built-ins exposed to GCC Rust.
+  // A mapping of the GCC built-ins exposed to GCC Rust. Apart from the
+  // implicit ones, declarations are built on their first lookup, as most
+  // crates only ever use a handful.
+  std::map<std::string, BuiltinDef> builtin_defs;
   std::map<std::string, tree> builtin_functions;
   std::map<std::string, std::string> rust_intrinsic_to_gcc_builtin;
 };
@@ -0,0 +1,124 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-check-remarks.h"
+#include "rust-diagnostics.h"
+#include "rust-thread-state.h"
+#include "options.h"
+#include "backend.h"
+#include "tree.h"
+#include "gimple.h"
+#include "gimple-iterator.h"
+#include "tree-pass.h"
+#include "context.h"
+
+namespace Rust {
+
+CheckRemarks &
+CheckRemarks::get ()
+{
+  auto &instance = ThreadState::current ().check_remarks;
+  if (instance == nullptr)
+    instance = new CheckRemarks ();
+
+  return *instance;
+}
+
+bool
+CheckRemarks::enabled ()
+{
+  return flag_rust_remark == 1;
+}
+
+void
+CheckRemarks::record_check (location_t locus, Kind kind)
+{
+  checks[LOCATION_LOCUS (locus)] = kind;
+}
+
+tl::optional<CheckRemarks::Kind>
+CheckRemarks::lookup_check (location_t locus) const
+{
+  auto it = checks.find (LOCATION_LOCUS (locus));
+  if (it == checks.end ())
+    return tl::nullopt;
+
+  return it->second;
+}
+
+namespace {
+
+const pass_data pass_data_check_remarks = {
+  GIMPLE_PASS,		/* type */
+  "rust-check-remarks", /* name */
+  OPTGROUP_NONE,	/* optinfo_flags */
+  TV_NONE,		/* tv_id */
+  PROP_cfg,		/* properties_required */
+  0,			/* properties_provided */
+  0,			/* properties_destroyed */
+  0,			/* todo_flags_start */
+  0,			/* todo_flags_finish */
+};
+
+class pass_check_remarks : public gimple_opt_pass
+{
+public:
+  pass_check_remarks (gcc::context *ctxt)
+    : gimple_opt_pass (pass_data_check_remarks, ctxt)
+  {}
+
+  unsigned int execute (function *fun) final override;
+};
+
+unsigned int
+pass_check_remarks::execute (function *fun)
+{
+  basic_block bb;
+  FOR_EACH_BB_FN (bb, fun)
+    for (gimple_stmt_iterator gsi = gsi_start_bb (bb); !gsi_end_p (gsi);
+	 gsi_next (&gsi))
+      {
+	gimple *stmt = gsi_stmt (gsi);
+	if (!gimple_call_builtin_p (stmt, BUILT_IN_ABORT))
+	  continue;
+
+	location_t locus = gimple_location (stmt);
+	auto kind = CheckRemarks::get ().lookup_check (locus);
+	if (!kind)
+	  continue;
+
+	const char *check = *kind == CheckRemarks::Kind::OVERFLOW
+			      ? "overflow check"
+			      : "bounds check";
+	rust_inform (locus, "%s kept in %qs", check, function_name (fun));
+      }
+
+  return 0;
+}
+
+} // namespace
+
+void
+CheckRemarks::register_pass ()
+{
+  // "optimized" runs at every optimization level, right before expansion
+  ::register_pass (new pass_check_remarks (g), PASS_POS_INSERT_AFTER,
+		   "optimized", 1);
+}
+
+} // namespace Rust
@@ -0,0 +1,68 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_CHECK_REMARKS_H
+#define RUST_CHECK_REMARKS_H
+
+#include "rust-system.h"
+#include "optional.h"
+
+namespace Rust {
+
+/**
+ * The runtime checks which survived the optimizers, reported with
+ * -frust-remark=checks so that hot code can be rewritten until its checks
+ * are provably gone.
+ *
+ * The checks all abort through `__builtin_abort`, so the locations of the
+ * aborting calls are recorded while compiling them. A GIMPLE pass running
+ * after the optimizers then reports each call left at one of those
+ * locations, along with the function it ended up in, which differs from the
+ * one it was written in once it got inlined.
+ */
+class CheckRemarks
+{
+public:
+  enum class Kind
+  {
+    OVERFLOW,
+    BOUNDS,
+  };
+
+  static CheckRemarks &get ();
+
+  // Whether -frust-remark=checks was given
+  static bool enabled ();
+
+  void record_check (location_t locus, Kind kind);
+
+  // The check aborting at LOCUS, if it is one
+  tl::optional<Kind> lookup_check (location_t locus) const;
+
+  // Add the pass reporting the checks after the optimizers
+  static void register_pass ();
+
+private:
+  CheckRemarks () {}
+
+  std::map<location_t, Kind> checks;
+};
+
+} // namespace Rust
+
+#endif // RUST_CHECK_REMARKS_H
@@ -0,0 +1,556 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-compile-asm.h"
+#include "rust-compile-expr.h"
+#include "rust-constexpr.h"
+#include "rust-builtins.h"
+#include "rust-session-manager.h"
+#include "rust-gcc.h"
+#include "tm.h"
+#include "tm_p.h"
+#include "varasm.h"
+#include "output.h"
+
+namespace Rust {
+namespace Compile {
+
+static bool
+target_arch_is (const std::string &arch)
+{
+  return Session::get_instance ().options.target_data.has_key_value_pair (
+    "target_arch", arch);
+}
+
+// Whether the code GCC emits around the asm block uses the Intel syntax,
+// on the targets which support several dialects
+static bool
+target_uses_intel_syntax ()
+{
+#ifdef ASSEMBLER_DIALECT
+  return ASSEMBLER_DIALECT != 0;
+#else
+  return false;
+#endif
+}
+
+/* The size of the area below the stack pointer in which GCC keeps the values
+   of leaf functions, on the targets which have one.  */
+
+static unsigned
+red_zone_size ()
+{
+#if defined(TARGET_RED_ZONE) && defined(RED_ZONE_SIZE)
+  if (TARGET_64BIT && TARGET_RED_ZONE)
+    return RED_ZONE_SIZE;
+#endif
+  return 0;
+}
+
+/* Move the stack pointer below the red zone of SIZE bytes around
+   ASM_TEMPLATE, and back, in the syntax of the code around it. lea leaves the
+   flags alone. The template then sees a stack pointer lower by SIZE bytes.  */
+
+static std::string
+skip_red_zone (const std::string &asm_template, unsigned size)
+{
+  std::string bytes = std::to_string (size);
+  if (target_uses_intel_syntax ())
+    return "lea rsp, [rsp - " + bytes + "]\n\t" + asm_template
+	   + "\n\tlea rsp, [rsp + " + bytes + "]";
+
+  return "leaq -" + bytes + "(%%rsp), %%rsp\n\t" + asm_template + "\n\tleaq "
+	 + bytes + "(%%rsp), %%rsp";
+}
+
+void
+CompileAsm::Compile (HIR::InlineAsm &expr, Context *ctx)
+{
+  CompileAsm compiler (expr, ctx);
+  compiler.go ();
+}
+
+void
+CompileAsm::go ()
+{
+  location_t locus = expr.get_locus ();
+  if (expr.is_global_asm)
+    {
+      rust_sorry_at (locus, "%<global_asm!%> is not supported yet");
+      return;
+    }
+  if (!expr.clobber_abi.empty ())
+    {
+      rust_sorry_at (expr.clobber_abi.front ().loc,
+		     "%<clobber_abi%> is not supported yet");
+      return;
+    }
+
+  is_x86 = target_arch_is ("x86") || target_arch_is ("x86_64");
+
+  bool ok = true;
+  for (auto &operand : expr.get_operands ())
+    ok = lower_operand (operand) && ok;
+  if (!ok)
+    return;
+
+  auto asm_template = build_template ();
+  if (!asm_template)
+    return;
+
+  // unless it is nostack, the block may push to the stack, which would
+  // overwrite the red zone: GCC cannot be told to keep it free, so the block
+  // steps over it
+  if (!expr.has_option (AST::InlineAsmOption::NOSTACK))
+    if (unsigned red_zone = red_zone_size ())
+      asm_template = skip_red_zone (*asm_template, red_zone);
+
+  // only clobber what the options do not rule out
+  if (!expr.has_option (AST::InlineAsmOption::NOMEM))
+    add_clobber ("memory");
+  if (!expr.has_option (AST::InlineAsmOption::PRESERVES_FLAGS))
+    add_clobber ("cc");
+
+  tree string = build_string (asm_template->size (), asm_template->c_str ());
+  tree asm_stmt = build5 (ASM_EXPR, void_type_node, string, outputs, inputs,
+			  clobbers, NULL_TREE);
+  ASM_VOLATILE_P (asm_stmt) = !expr.has_option (AST::InlineAsmOption::PURE);
+  TREE_SIDE_EFFECTS (asm_stmt) = 1;
+  SET_EXPR_LOCATION (asm_stmt, locus);
+  ctx->add_statement (asm_stmt);
+
+  for (tree copy_back : copy_backs)
+    ctx->add_statement (copy_back);
+
+  if (expr.has_option (AST::InlineAsmOption::NORETURN))
+    {
+      tree unreachable = NULL_TREE;
+      BuiltinsContext::get ().lookup_simple_builtin ("__builtin_unreachable",
+						     &unreachable);
+      rust_assert (unreachable);
+      ctx->add_statement (build_call_expr_loc (locus, unreachable, 0));
+    }
+}
+
+bool
+CompileAsm::lower_operand (HIR::InlineAsmOperand &operand)
+{
+  using RegisterType = HIR::InlineAsmOperand::RegisterType;
+
+  LoweredOperand result;
+  bool ok = true;
+  switch (operand.register_type)
+    {
+    case RegisterType::Const:
+      result.text = lower_const_operand (operand);
+      ok = result.text.has_value ();
+      break;
+    case RegisterType::Sym:
+      result.text = lower_sym_operand (operand);
+      ok = result.text.has_value ();
+      break;
+    case RegisterType::Label:
+      rust_sorry_at (operand.locus, "label operands are not supported yet");
+      ok = false;
+      break;
+    default:
+      ok = lower_register_operand (operand, result);
+      break;
+    }
+
+  lowered.push_back (std::move (result));
+  return ok;
+}
+
+bool
+CompileAsm::lower_register_operand (HIR::InlineAsmOperand &operand,
+				    LoweredOperand &result)
+{
+  using RegisterType = HIR::InlineAsmOperand::RegisterType;
+
+  rust_assert (operand.reg.has_value ());
+  const auto &reg = operand.reg.value ();
+  location_t locus = operand.locus;
+
+  auto constraint = register_constraint (reg);
+  if (!constraint)
+    return false;
+  result.constraint = *constraint;
+
+  // the input value and the output place, either can be missing
+  tree value = NULL_TREE;
+  tree place = NULL_TREE;
+  switch (operand.register_type)
+    {
+    case RegisterType::In:
+      value = CompileExpr::Compile (operand.expr.get (), ctx);
+      break;
+    case RegisterType::Out:
+      if (operand.has_expr ())
+	place = CompileExpr::Compile (operand.expr.get (), ctx);
+      break;
+    case RegisterType::InOut:
+      place = CompileExpr::Compile (operand.expr.get (), ctx);
+      value = place;
+      break;
+    case RegisterType::SplitInOut:
+      value = CompileExpr::Compile (operand.expr.get (), ctx);
+      if (operand.has_out_expr ())
+	place = CompileExpr::Compile (operand.out_expr.get (), ctx);
+      break;
+    default:
+      rust_unreachable ();
+    }
+  if (value == error_mark_node || place == error_mark_node)
+    return false;
+
+  bool is_input = operand.register_type != RegisterType::Out;
+  bool is_output = operand.register_type != RegisterType::In;
+  // outputs which are not late may not share a register with any input
+  std::string early_clobber = operand.late ? "" : "&";
+
+  if (reg.type == AST::InlineAsmRegOrRegClass::Type::Reg)
+    {
+      const std::string &name = reg.reg.Symbol;
+      if (!is_input && place == NULL_TREE)
+	{
+	  add_clobber (name);
+	  return true;
+	}
+
+      // the operand goes through a variable living in the register, which
+      // its constraint then cannot fail to pick
+      tree type = TREE_TYPE (place != NULL_TREE ? place : value);
+      tree var = hard_register_variable (name, type, value, locus);
+      if (is_output)
+	result.output = add_output ((is_input ? "+" : "=") + *constraint, var);
+      else
+	result.input = add_input (*constraint, var);
+
+      if (place != NULL_TREE)
+	copy_backs.push_back (
+	  Backend::assignment_statement (place, var, locus));
+      return true;
+    }
+
+  if (is_output)
+    {
+      if (place == NULL_TREE)
+	{
+	  tree type
+	    = value != NULL_TREE ? TREE_TYPE (value) : scratch_type (*constraint);
+	  if (type == NULL_TREE)
+	    {
+	      rust_sorry_at (locus,
+			     "discarding outputs of register class %qs is not "
+			     "supported yet",
+			     reg.reg_class.Symbol.c_str ());
+	      return false;
+	    }
+
+	  tree stmt = NULL_TREE;
+	  Bvariable *scratch
+	    = Backend::temporary_variable (ctx->peek_fn ().fndecl,
+					   ctx->peek_enclosing_scope (), type,
+					   NULL_TREE, false, locus, &stmt);
+	  ctx->add_statement (stmt);
+	  place = scratch->get_tree (locus);
+	}
+
+      bool tied = operand.register_type == RegisterType::InOut;
+      result.output
+	= add_output ((tied ? "+" : "=") + early_clobber + *constraint, place);
+    }
+
+  if (operand.register_type == RegisterType::In)
+    result.input = add_input (*constraint, value);
+  else if (operand.register_type == RegisterType::SplitInOut)
+    result.input = add_input (std::to_string (result.output), value);
+
+  return true;
+}
+
+tl::optional<std::string>
+CompileAsm::lower_const_operand (HIR::InlineAsmOperand &operand)
+{
+  tree value = fold_expr (CompileExpr::Compile (operand.expr.get (), ctx));
+  if (value == error_mark_node)
+    return tl::nullopt;
+
+  if (TREE_CODE (value) == INTEGER_CST && tree_fits_shwi_p (value))
+    return std::to_string (tree_to_shwi (value));
+  if (TREE_CODE (value) == INTEGER_CST && tree_fits_uhwi_p (value))
+    return std::to_string (tree_to_uhwi (value));
+
+  rust_error_at (operand.locus,
+		 "%<const%> operands must evaluate to an integer which fits "
+		 "in 64 bits");
+  return tl::nullopt;
+}
+
+tl::optional<std::string>
+CompileAsm::lower_sym_operand (HIR::InlineAsmOperand &operand)
+{
+  tree value = CompileExpr::Compile (operand.expr.get (), ctx);
+  if (value == error_mark_node)
+    return tl::nullopt;
+
+  STRIP_NOPS (value);
+  if (TREE_CODE (value) == ADDR_EXPR)
+    value = TREE_OPERAND (value, 0);
+
+  if (TREE_CODE (value) != FUNCTION_DECL
+      && !(VAR_P (value) && is_global_var (value)))
+    {
+      rust_error_at (operand.locus,
+		     "%<sym%> operands must refer to a function or a static");
+      return tl::nullopt;
+    }
+
+  // the symbol is only referenced from the template, which GCC does not look
+  // into, so it must not be discarded as unused
+  TREE_USED (value) = 1;
+  DECL_PRESERVE_P (value) = 1;
+
+  const char *name = IDENTIFIER_POINTER (DECL_ASSEMBLER_NAME (value));
+  if (name[0] == '*')
+    return std::string (name + 1);
+
+  return std::string (user_label_prefix) + name;
+}
+
+tl::optional<std::string>
+CompileAsm::register_constraint (const AST::InlineAsmRegOrRegClass &reg) const
+{
+  if (reg.type == AST::InlineAsmRegOrRegClass::Type::Reg)
+    {
+      const std::string &name = reg.reg.Symbol;
+      auto starts_with = [&name] (const char *prefix) {
+	return name.rfind (prefix, 0) == 0;
+      };
+
+      if (is_x86 && (starts_with ("xmm") || starts_with ("ymm")))
+	return std::string ("x");
+      if (is_x86 && starts_with ("zmm"))
+	return std::string ("v");
+      if (is_x86 && name.size () == 2 && name[0] == 'k')
+	return std::string ("Yk");
+      if (target_arch_is ("aarch64") && name.size () > 1
+	  && std::strchr ("bhsdqv", name[0]) && ISDIGIT (name[1]))
+	return std::string ("w");
+      if ((target_arch_is ("riscv32") || target_arch_is ("riscv64"))
+	  && starts_with ("f"))
+	return std::string ("f");
+
+      return std::string ("r");
+    }
+
+  const std::string &reg_class = reg.reg_class.Symbol;
+  if (reg_class == "reg")
+    return std::string ("r");
+
+  static const std::map<std::string, std::map<std::string, std::string>>
+    classes = {
+      {"x86",
+       {{"reg_abcd", "Q"},
+	{"reg_byte", "q"},
+	{"xmm_reg", "x"},
+	{"ymm_reg", "x"},
+	{"zmm_reg", "v"},
+	{"kreg", "Yk"}}},
+      {"aarch64", {{"vreg", "w"}, {"vreg_low16", "x"}}},
+      {"arm", {{"sreg", "t"}, {"dreg", "w"}, {"qreg", "w"}}},
+      {"riscv32", {{"freg", "f"}}},
+      {"riscv64", {{"freg", "f"}}},
+    };
+
+  for (const auto &arch : classes)
+    {
+      bool matches = arch.first == "x86" ? is_x86 : target_arch_is (arch.first);
+      if (!matches)
+	continue;
+
+      auto it = arch.second.find (reg_class);
+      if (it != arch.second.end ())
+	return it->second;
+    }
+
+  rust_error_at (reg.locus, "invalid register class %qs for this target",
+		 reg_class.c_str ());
+  return tl::nullopt;
+}
+
+tree
+CompileAsm::hard_register_variable (const std::string &reg, tree type,
+				    tree init, location_t locus)
+{
+  tree stmt = NULL_TREE;
+  Bvariable *var
+    = Backend::temporary_variable (ctx->peek_fn ().fndecl,
+				   ctx->peek_enclosing_scope (), type, init,
+				   false, locus, &stmt);
+
+  tree decl = var->get_decl ();
+  DECL_REGISTER (decl) = 1;
+  DECL_HARD_REGISTER (decl) = 1;
+  set_user_assembler_name (decl, reg.c_str ());
+  ctx->add_statement (stmt);
+
+  return decl;
+}
+
+tree
+CompileAsm::scratch_type (const std::string &constraint) const
+{
+  if (constraint == "r" || constraint == "Q" || constraint == "q")
+    return size_type_node;
+
+  return NULL_TREE;
+}
+
+int
+CompileAsm::add_output (const std::string &constraint, tree place)
+{
+  tree name = build_tree_list (NULL_TREE, build_string (constraint.size (),
+							constraint.c_str ()));
+  outputs = chainon (outputs, build_tree_list (name, place));
+  return output_count++;
+}
+
+int
+CompileAsm::add_input (const std::string &constraint, tree value)
+{
+  tree name = build_tree_list (NULL_TREE, build_string (constraint.size (),
+							constraint.c_str ()));
+  inputs = chainon (inputs, build_tree_list (name, value));
+  return input_count++;
+}
+
+void
+CompileAsm::add_clobber (const std::string &name)
+{
+  clobbers = tree_cons (NULL_TREE, build_string (name.size (), name.c_str ()),
+			clobbers);
+}
+
+tl::optional<std::string>
+CompileAsm::build_template () const
+{
+  std::string result;
+  for (const auto &piece : expr.template_)
+    {
+      if (!piece.is_placeholder)
+	{
+	  for (char c : piece.string)
+	    {
+	      // characters which GCC would otherwise interpret, the braces and
+	      // the bar select an assembler dialect on x86
+	      if (c == '%' || (is_x86 && std::strchr ("{|}", c)))
+		result += '%';
+	      result += c;
+	    }
+	  continue;
+	}
+
+      const auto &placeholder = piece.placeholder;
+      rust_assert (placeholder.operand_idx < lowered.size ());
+      const auto &operand = lowered[placeholder.operand_idx];
+      if (operand.text)
+	{
+	  result += *operand.text;
+	  continue;
+	}
+
+      // GCC numbers all the outputs before the inputs
+      int number = -1;
+      if (operand.output >= 0)
+	number = operand.output;
+      else if (operand.input >= 0)
+	number = output_count + operand.input;
+
+      if (number < 0)
+	{
+	  rust_error_at (placeholder.locus,
+			 "discarded outputs on explicit registers cannot be "
+			 "used in the template");
+	  return tl::nullopt;
+	}
+
+      result += '%' + operand_modifier (operand, placeholder.modifier)
+		+ std::to_string (number);
+    }
+
+  if (!is_x86)
+    return result;
+
+  // Rust defaults to the Intel syntax on x86, the template is switched to
+  // the syntax it is written in and back to the one around it
+  bool att_syntax = expr.has_option (AST::InlineAsmOption::ATT_SYNTAX);
+  if (att_syntax == target_uses_intel_syntax ())
+    {
+      const char *intel = ".intel_syntax noprefix";
+      const char *att = ".att_syntax prefix";
+      result = std::string (att_syntax ? att : intel) + "\n\t" + result
+	       + "\n\t" + (att_syntax ? intel : att);
+    }
+
+  return result;
+}
+
+std::string
+CompileAsm::operand_modifier (const LoweredOperand &operand,
+			      char modifier) const
+{
+  if (modifier == '\0')
+    return "";
+
+  // the other targets share the modifiers of GCC
+  if (!is_x86)
+    return std::string (1, modifier);
+
+  bool vector = operand.constraint == "x" || operand.constraint == "v";
+  if (vector)
+    switch (modifier)
+      {
+      case 'x':
+	return "x";
+      case 'y':
+	return "t";
+      case 'z':
+	return "g";
+      }
+  else
+    switch (modifier)
+      {
+      case 'l':
+	return "b";
+      case 'h':
+	return "h";
+      case 'x':
+	return "w";
+      case 'e':
+	return "k";
+      case 'r':
+	return "q";
+      }
+
+  return std::string (1, modifier);
+}
+
+} // namespace Compile
+} // namespace Rust
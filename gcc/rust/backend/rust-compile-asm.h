@@ -0,0 +1,101 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_COMPILE_ASM
+#define RUST_COMPILE_ASM
+
+#include "rust-compile-base.h"
+#include "rust-hir-expr.h"
+
+namespace Rust {
+namespace Compile {
+
+/**
+ * Lowers an `asm!` block to a GCC extended asm statement.
+ *
+ * Register classes become constraint letters and explicit registers become
+ * hard register variables which the operands are copied through. The
+ * template placeholders are renumbered after the GCC operands, which list
+ * all the outputs before the inputs, while const and sym operands are
+ * substituted in the template directly.
+ *
+ * Nothing is clobbered unless the options allow it: memory is only clobbered
+ * without `nomem`, the flags only without `preserves_flags`, and the block is
+ * only volatile when it is not `pure`, so that the optimizers are free to
+ * move, merge or remove the blocks which declare they can be.
+ */
+class CompileAsm
+{
+public:
+  static void Compile (HIR::InlineAsm &expr, Context *ctx);
+
+private:
+  // Where the GCC operands of a Rust operand ended up
+  struct LoweredOperand
+  {
+    int output = -1;
+    int input = -1;
+    // the constraint of the register, to map the template modifiers
+    std::string constraint;
+    // the replacement of const and sym operands in the template
+    tl::optional<std::string> text;
+  };
+
+  CompileAsm (HIR::InlineAsm &expr, Context *ctx) : expr (expr), ctx (ctx) {}
+
+  void go ();
+  bool lower_operand (HIR::InlineAsmOperand &operand);
+  bool lower_register_operand (HIR::InlineAsmOperand &operand,
+			       LoweredOperand &lowered);
+  tl::optional<std::string> lower_const_operand (HIR::InlineAsmOperand &op);
+  tl::optional<std::string> lower_sym_operand (HIR::InlineAsmOperand &op);
+
+  tl::optional<std::string>
+  register_constraint (const AST::InlineAsmRegOrRegClass &reg) const;
+  tree hard_register_variable (const std::string &reg, tree type, tree init,
+			       location_t locus);
+  tree scratch_type (const std::string &constraint) const;
+
+  int add_output (const std::string &constraint, tree place);
+  int add_input (const std::string &constraint, tree value);
+  void add_clobber (const std::string &name);
+
+  tl::optional<std::string> build_template () const;
+  std::string operand_modifier (const LoweredOperand &operand,
+				char modifier) const;
+
+  HIR::InlineAsm &expr;
+  Context *ctx;
+
+  bool is_x86 = false;
+  std::vector<LoweredOperand> lowered;
+  tree outputs = NULL_TREE;
+  tree inputs = NULL_TREE;
+  tree clobbers = NULL_TREE;
+  int output_count = 0;
+  int input_count = 0;
+
+  // copies from the hard register variables to the places of the outputs,
+  // emitted after the asm statement
+  std::vector<tree> copy_backs;
+};
+
+} // namespace Compile
+} // namespace Rust
+
+#endif // RUST_COMPILE_ASM
@@ -21,6 +21,7 @@
 #include "rust-compile-stmt.h"
 #include "rust-compile-expr.h"
 #include "rust-compile-fnparam.h"
+#include "rust-compile-pattern.h"
 #include "rust-compile-var-decl.h"
 #include "rust-compile-type.h"
 #include "rust-constexpr.h"
@@ -32,12 +33,16 @@
 #include "rust-compile-implitem.h"
 #include "rust-attribute-values.h"
 #include "rust-immutable-name-resolution-context.h"
+#include "rust-self-profile.h"
+#include "rust-session-manager.h"
 
 #include "fold-const.h"
 #include "stringpool.h"
 #include "attribs.h"
 #include "tree.h"
 #include "print-tree.h"
+#include "varasm.h"
+#include "function.h"
 
 namespace Rust {
 namespace Compile {
@@ -73,60 +78,37 @@ HIRCompileBase::setup_fndecl (tree fndecl, bool is_main_entry_point,
   // is it inline?
   for (const auto &attr : attrs)
     {
-      bool is_inline
-	= attr.get_path ().as_string () == Values::Attributes::INLINE;
-      bool is_must_use
-	= attr.get_path ().as_string () == Values::Attributes::MUST_USE;
-      bool is_cold = attr.get_path ().as_string () == Values::Attributes::COLD;
-      bool is_link_section
-	= attr.get_path ().as_string () == Values::Attributes::LINK_SECTION;
-      bool no_mangle
-	= attr.get_path ().as_string () == Values::Attributes::NO_MANGLE;
-      bool is_deprecated
-	= attr.get_path ().as_string () == Values::Attributes::DEPRECATED;
-      bool is_proc_macro
-	= attr.get_path ().as_string () == Values::Attributes::PROC_MACRO;
-      bool is_proc_macro_attribute
-	= attr.get_path ().as_string ()
-	  == Values::Attributes::PROC_MACRO_ATTRIBUTE;
-      bool is_proc_macro_derive = attr.get_path ().as_string ()
-				  == Values::Attributes::PROC_MACRO_DERIVE;
-
-      if (is_inline)
+      switch (attr.get_builtin ())
 	{
+	case Values::BuiltinAttribute::INLINE:
 	  handle_inline_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_must_use)
-	{
+	  break;
+	case Values::BuiltinAttribute::MUST_USE:
 	  handle_must_use_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_cold)
-	{
+	  break;
+	case Values::BuiltinAttribute::COLD:
 	  handle_cold_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_link_section)
-	{
+	  break;
+	case Values::BuiltinAttribute::LINK_SECTION:
 	  handle_link_section_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_deprecated)
-	{
+	  break;
+	case Values::BuiltinAttribute::DEPRECATED:
 	  handle_deprecated_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (no_mangle)
-	{
+	  break;
+	case Values::BuiltinAttribute::NO_MANGLE:
 	  handle_no_mangle_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_proc_macro)
-	{
+	  break;
+	case Values::BuiltinAttribute::PROC_MACRO:
 	  handle_bang_proc_macro_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_proc_macro_attribute)
-	{
+	  break;
+	case Values::BuiltinAttribute::PROC_MACRO_ATTRIBUTE:
 	  handle_attribute_proc_macro_attribute_on_fndecl (fndecl, attr);
-	}
-      else if (is_proc_macro_derive)
-	{
+	  break;
+	case Values::BuiltinAttribute::PROC_MACRO_DERIVE:
 	  handle_derive_proc_macro_attribute_on_fndecl (fndecl, attr);
+	  break;
+	default:
+	  break;
 	}
     }
 }
@@ -565,6 +547,30 @@ HIRCompileBase::indirect_expression (tree expr, location_t locus)
   return build_fold_indirect_ref_loc (locus, expr);
 }
 
+// Whether the tail expression VALUE of the body of FNDECL is a local which
+// can be constructed in the return slot of the caller directly. This is only
+// the case of the aggregates returned in memory, when the body has no other
+// return: nothing but the local is ever stored in the return value then.
+bool
+HIRCompileBase::is_named_return_value (tree fndecl, tree value)
+{
+  tree result = DECL_RESULT (fndecl);
+  if (TREE_CODE (value) != VAR_DECL || result == NULL_TREE
+      || result == error_mark_node)
+    return false;
+
+  if (DECL_CONTEXT (value) != fndecl || TREE_STATIC (value)
+      || DECL_HAS_VALUE_EXPR_P (value) || TREE_THIS_VOLATILE (value)
+      || TYPE_MAIN_VARIANT (TREE_TYPE (value))
+	   != TYPE_MAIN_VARIANT (TREE_TYPE (result)))
+    return false;
+
+  if (!aggregate_value_p (result, fndecl))
+    return false;
+
+  return !ctx->peek_fn ().has_returns;
+}
+
 void
 HIRCompileBase::compile_function_body (tree fndecl,
 				       HIR::BlockExpr &function_body,
@@ -601,8 +607,22 @@ HIRCompileBase::compile_function_body (tree fndecl,
 	  return_value = coercion_site (id, return_value, actual, expected,
 					lvalue_locus, rvalue_locus);
 
-	  tree return_stmt
-	    = Backend::return_statement (fndecl, return_value, locus);
+	  tree return_stmt = NULL_TREE;
+	  if (is_named_return_value (fndecl, return_value))
+	    {
+	      // the local lives in the return slot all along, there is
+	      // nothing to copy
+	      tree result = DECL_RESULT (fndecl);
+	      SET_DECL_VALUE_EXPR (return_value, result);
+	      DECL_HAS_VALUE_EXPR_P (return_value) = 1;
+	      if (TREE_ADDRESSABLE (return_value))
+		TREE_ADDRESSABLE (result) = 1;
+	      return_stmt
+		= build1_loc (locus, RETURN_EXPR, void_type_node, result);
+	    }
+	  else
+	    return_stmt
+	      = Backend::return_statement (fndecl, return_value, locus);
 	  ctx->add_statement (return_stmt);
 	}
       else
@@ -644,18 +664,178 @@ get_abi (const AST::AttrVec &outer_attrs,
   return is_proc_macro ? ABI::CDECL : qualifiers.get_abi ();
 }
 
+// Whether TY contains no UnsafeCell other than behind an indirection, in which
+// case nothing can change the memory a shared reference to TY points to
+bool
+HIRCompileBase::is_freeze (const TyTy::BaseType *ty)
+{
+  ty = ty->destructure ();
+  switch (ty->get_kind ())
+    {
+    case TyTy::TypeKind::BOOL:
+    case TyTy::TypeKind::CHAR:
+    case TyTy::TypeKind::INT:
+    case TyTy::TypeKind::UINT:
+    case TyTy::TypeKind::FLOAT:
+    case TyTy::TypeKind::USIZE:
+    case TyTy::TypeKind::ISIZE:
+    case TyTy::TypeKind::STR:
+    case TyTy::TypeKind::NEVER:
+    case TyTy::TypeKind::REF:
+    case TyTy::TypeKind::POINTER:
+    case TyTy::TypeKind::FNDEF:
+    case TyTy::TypeKind::FNPTR:
+      return true;
+
+    case TyTy::TypeKind::ARRAY:
+      return is_freeze (
+	static_cast<const TyTy::ArrayType *> (ty)->get_element_type ());
+
+    case TyTy::TypeKind::SLICE:
+      return is_freeze (
+	static_cast<const TyTy::SliceType *> (ty)->get_element_type ());
+
+      case TyTy::TypeKind::TUPLE: {
+	auto tuple = static_cast<const TyTy::TupleType *> (ty);
+	for (size_t i = 0; i < tuple->num_fields (); i++)
+	  if (!is_freeze (tuple->get_field (i)))
+	    return false;
+	return true;
+      }
+
+      case TyTy::TypeKind::ADT: {
+	auto adt = static_cast<const TyTy::ADTType *> (ty);
+	auto unsafe_cell
+	  = ctx->get_mappings ().lookup_lang_item (LangItem::Kind::UNSAFE_CELL);
+	for (auto &variant : adt->get_variants ())
+	  {
+	    if (unsafe_cell.has_value ()
+		&& variant->get_defid () == unsafe_cell.value ())
+	      return false;
+
+	    for (auto &field : variant->get_fields ())
+	      if (!is_freeze (field->get_field_type ()))
+		return false;
+	  }
+	return true;
+      }
+
+    default:
+      // closures, trait objects and anything unresolved may hold an UnsafeCell
+      return false;
+    }
+}
+
+// Functions returning `!` never return. The entry points of panics are also
+// cold, which keeps the paths calling them out of the way of the hot ones.
+void
+HIRCompileBase::setup_diverging_fndecl (tree fndecl, TyTy::FnType *fntype)
+{
+  if (fntype->get_return_type ()->destructure ()->get_kind ()
+      != TyTy::TypeKind::NEVER)
+    return;
+
+  TREE_THIS_VOLATILE (fndecl) = 1;
+
+  static const LangItem::Kind panics[]
+    = {LangItem::Kind::PANIC, LangItem::Kind::PANIC_FMT,
+       LangItem::Kind::PANIC_BOUNDS_CHECK, LangItem::Kind::BEGIN_PANIC};
+  for (auto kind : panics)
+    {
+      auto lang_item = ctx->get_mappings ().lookup_lang_item (kind);
+      if (lang_item.has_value () && lang_item.value () == fntype->get_id ())
+	{
+	  tree cold = get_identifier (Values::Attributes::COLD);
+	  DECL_ATTRIBUTES (fndecl)
+	    = tree_cons (cold, NULL_TREE, DECL_ATTRIBUTES (fndecl));
+	  return;
+	}
+    }
+}
+
+// References are never null, mark the parameters of FNDECL which are thin
+// references as such
+void
+HIRCompileBase::setup_reference_params_nonnull (tree fndecl,
+						TyTy::FnType *fntype)
+{
+  // the positions are the ones of the fndecl, where the fat pointers take two
+  // parameters of which the data pointer is never null either
+  bool split_fat_pointers = fntype->get_abi () == ABI::RUST;
+  tree args = NULL_TREE;
+  int position = 0;
+  for (size_t i = 0; i < fntype->num_params (); i++)
+    {
+      auto param_tyty = fntype->param_at (i).second->destructure ();
+      tree param_type = TyTyResolveCompile::compile (ctx, param_tyty);
+      position++;
+
+      bool is_scalar_pair
+	= split_fat_pointers && Backend::is_scalar_pair (param_type);
+      int data_position = position;
+      if (is_scalar_pair)
+	position++;
+
+      if (param_tyty->get_kind () != TyTy::TypeKind::REF)
+	continue;
+      if (TREE_CODE (param_type) != POINTER_TYPE && !is_scalar_pair)
+	continue;
+
+      args = tree_cons (NULL_TREE,
+			build_int_cst (integer_type_node, data_position), args);
+    }
+
+  if (args == NULL_TREE)
+    return;
+
+  tree attrs = tree_cons (get_identifier ("nonnull"), nreverse (args),
+			  TYPE_ATTRIBUTES (TREE_TYPE (fndecl)));
+  TREE_TYPE (fndecl) = build_type_attribute_variant (TREE_TYPE (fndecl), attrs);
+}
+
+// Nothing else may access the memory behind a `&mut` parameter while the
+// function runs, nor modify the memory behind a `&` parameter unless it holds
+// an UnsafeCell. Both are what restrict tells GCC.
+void
+HIRCompileBase::setup_reference_params_restrict (
+  std::vector<Bvariable *> &params, TyTy::FnType *fntype)
+{
+  for (size_t i = 0; i < params.size () && i < fntype->num_params (); i++)
+    {
+      auto param_tyty = fntype->param_at (i).second->destructure ();
+      if (param_tyty->get_kind () != TyTy::TypeKind::REF)
+	continue;
+
+      auto ref = static_cast<const TyTy::ReferenceType *> (param_tyty);
+      if (!ref->is_mutable () && !is_freeze (ref->get_base ()))
+	continue;
+
+      tree decl = params[i]->get_decl ();
+      if (decl == error_mark_node || TREE_CODE (decl) != PARM_DECL
+	  || TREE_CODE (TREE_TYPE (decl)) != POINTER_TYPE)
+	continue;
+
+      TREE_TYPE (decl)
+	= build_qualified_type (TREE_TYPE (decl), TYPE_QUAL_RESTRICT);
+    }
+}
+
 tree
 HIRCompileBase::compile_function (
   const std::string &fn_name, HIR::SelfParam &self_param,
   std::vector<HIR::FunctionParam> &function_params,
   const HIR::FunctionQualifiers &qualifiers, HIR::Visibility &visibility,
   AST::AttrVec &outer_attrs, location_t locus, HIR::BlockExpr *function_body,
-  const Resolver::CanonicalPath &canonical_path, TyTy::FnType *fntype)
+  const Resolver::CanonicalPath &canonical_path, TyTy::FnType *fntype,
+  bool defer_body)
 {
   tree compiled_fn_type = TyTyResolveCompile::compile (ctx, fntype);
   std::string ir_symbol_name
     = canonical_path.get () + fntype->subst_as_string ();
 
+  if (SelfProfile::enabled ())
+    SelfProfile::get ().add_instance (canonical_path.get ());
+
   // we don't mangle the main fn since we haven't implemented the main shim
   bool is_main_fn = fn_name.compare ("main") == 0;
   if (is_main_fn)
@@ -673,6 +853,8 @@ HIRCompileBase::compile_function (
   setup_fndecl (fndecl, is_main_fn, fntype->has_substitutions_defined (),
 		visibility, qualifiers, outer_attrs);
   setup_abi_options (fndecl, get_abi (outer_attrs, qualifiers));
+  setup_reference_params_nonnull (fndecl, fntype);
+  setup_diverging_fndecl (fndecl, fntype);
 
   // conditionally mangle the function name
   bool should_mangle = should_mangle_item (fndecl);
@@ -682,25 +864,216 @@ HIRCompileBase::compile_function (
 			   get_identifier_with_length (asm_name.data (),
 						       asm_name.length ()));
 
+  // functions of extern crates only get compiled here when their body was
+  // exported, which is the case of #[inline] ones: every crate using them
+  // keeps its own local copy rather than clashing with the upstream symbol
+  bool is_upstream
+    = fntype->get_id ().crateNum != ctx->get_mappings ().get_current_crate ();
+  bool is_local_copy = is_upstream && !fntype->has_substitutions_defined ();
+  if (is_local_copy)
+    TREE_PUBLIC (fndecl) = 0;
+
+  // `pub` functions which no other crate can name, such as the ones of private
+  // modules, are local to executables and hidden in libraries, which still
+  // need them for the bodies they export
+  bool is_unreachable
+    = ctx->get_mappings ().is_unreachable_item (fntype->get_id ());
+  bool is_executable
+    = Session::get_instance ().options.target_data.get_crate_type ()
+      == TargetOptions::CrateType::BIN;
+  if (is_unreachable && !is_main_fn && should_mangle && TREE_PUBLIC (fndecl))
+    {
+      if (is_executable)
+	TREE_PUBLIC (fndecl) = 0;
+      else
+	{
+	  DECL_VISIBILITY (fndecl) = VISIBILITY_HIDDEN;
+	  DECL_VISIBILITY_SPECIFIED (fndecl) = 1;
+	}
+    }
+
+  // let dependent crates link against this instance, every crate sharing it
+  // emits a weak definition
+  bool is_pub = visibility.get_vis_type () == HIR::Visibility::VisType::PUBLIC;
+  if (flag_rust_share_generics && is_pub && !is_unreachable && should_mangle
+      && fntype->has_substitutions_defined () && !qualifiers.is_const ())
+    {
+      TREE_PUBLIC (fndecl) = 1;
+      DECL_WEAK (fndecl) = 1;
+      ctx->get_mappings ().insert_shared_instance (canonical_path.get (),
+						   asm_name);
+    }
+
+  // every crate instantiating a generic emits its own copy: key it by its
+  // mangled symbol so that the linker keeps a single one
+  if (should_mangle && fntype->has_substitutions_defined () && !is_main_fn
+      && !(is_unreachable && is_executable) && supports_one_only ())
+    {
+      if (!TREE_PUBLIC (fndecl))
+	{
+	  TREE_PUBLIC (fndecl) = 1;
+	  DECL_VISIBILITY (fndecl) = VISIBILITY_HIDDEN;
+	  DECL_VISIBILITY_SPECIFIED (fndecl) = 1;
+	}
+      make_decl_one_only (fndecl, DECL_ASSEMBLER_NAME (fndecl));
+    }
+
+  // the local copies are left in every codegen unit using them
+  if (!is_local_copy)
+    ctx->place_function (fndecl, canonical_path,
+			 fntype->has_substitutions_defined ());
+
   // insert into the context
   ctx->insert_function_decl (fntype, fndecl);
 
-  // setup the params
+  // callers only need the declaration, the body can be compiled later
+  if (defer_body)
+    {
+      ctx->push_deferred_fn_body ({fndecl, &self_param, &function_params,
+				   function_body, locus, fntype});
+      return fndecl;
+    }
+
+  return compile_function_definition (fndecl, self_param, function_params,
+				      locus, function_body, fntype);
+}
+
+tree
+HIRCompileBase::compile_upstream_instance (
+  const std::string &asm_name, location_t locus,
+  const Resolver::CanonicalPath &canonical_path, TyTy::FnType *fntype)
+{
+  tree compiled_fn_type = TyTyResolveCompile::compile (ctx, fntype);
+  std::string ir_symbol_name
+    = canonical_path.get () + fntype->subst_as_string ();
+
+  const unsigned int flags = Backend::function_is_declaration;
+  tree fndecl = Backend::function (compiled_fn_type, ir_symbol_name, asm_name,
+				   flags, locus);
+  TREE_PUBLIC (fndecl) = 1;
+  setup_abi_options (fndecl, fntype->get_abi ());
+  setup_diverging_fndecl (fndecl, fntype);
+
+  ctx->insert_function_decl (fntype, fndecl);
+
+  return fndecl;
+}
+
+HIRCompileBase::ScalarPairParam
+HIRCompileBase::declare_scalar_pair_param (tree fndecl, tree type,
+					   HIR::Pattern *pattern, HirId hirid,
+					   location_t locus)
+{
+  tree data_field = TYPE_FIELDS (type);
+  tree meta_field = DECL_CHAIN (data_field);
+
+  Bvariable *data
+    = Backend::parameter_variable (fndecl,
+				   IDENTIFIER_POINTER (DECL_NAME (data_field)),
+				   TREE_TYPE (data_field), locus);
+  Bvariable *meta
+    = Backend::parameter_variable (fndecl,
+				   IDENTIFIER_POINTER (DECL_NAME (meta_field)),
+				   TREE_TYPE (meta_field), locus);
+  DECL_ARTIFICIAL (data->get_decl ()) = 1;
+  DECL_ARTIFICIAL (meta->get_decl ()) = 1;
+
+  return {data, meta, type, pattern, hirid, locus};
+}
+
+// The fat pointer is put back together in a local at the start of the body,
+// which the pattern of the parameter binds like a parameter of its own
+void
+HIRCompileBase::bind_scalar_pair_param (tree fndecl, tree code_block,
+					const ScalarPairParam &pair)
+{
+  tree value
+    = Backend::constructor_expression (pair.type, false,
+				       {pair.data->get_tree (pair.locus),
+					pair.meta->get_tree (pair.locus)},
+				       -1, pair.locus);
+
+  tree init_stmt = NULL_TREE;
+  Bvariable *var
+    = Backend::temporary_variable (fndecl, code_block, pair.type, value,
+				   false, pair.locus, &init_stmt);
+  ctx->add_statement (init_stmt);
+
+  if (pair.pattern == nullptr
+      || pair.pattern->get_pattern_type () == HIR::Pattern::IDENTIFIER)
+    ctx->insert_var_decl (pair.hirid, var);
+  else if (pair.pattern->get_pattern_type () != HIR::Pattern::WILDCARD)
+    CompilePatternBindings::Compile (pair.pattern, var->get_tree (pair.locus),
+				     ctx);
+}
+
+/* Drop the debug info of the parameters and locals in BLOCK and its
+   subblocks, so that only the line tables of the function remain.  */
+
+static void
+strip_block_debug_info (tree block)
+{
+  for (tree var = BLOCK_VARS (block); var != NULL_TREE; var = DECL_CHAIN (var))
+    DECL_IGNORED_P (var) = 1;
+  for (tree sub = BLOCK_SUBBLOCKS (block); sub != NULL_TREE;
+       sub = BLOCK_CHAIN (sub))
+    strip_block_debug_info (sub);
+}
+
+static void
+strip_debug_info (tree fndecl)
+{
+  for (tree parm = DECL_ARGUMENTS (fndecl); parm != NULL_TREE;
+       parm = DECL_CHAIN (parm))
+    DECL_IGNORED_P (parm) = 1;
+  if (DECL_INITIAL (fndecl) != NULL_TREE)
+    strip_block_debug_info (DECL_INITIAL (fndecl));
+}
+
+tree
+HIRCompileBase::compile_function_definition (
+  tree fndecl, HIR::SelfParam &self_param,
+  std::vector<HIR::FunctionParam> &function_params, location_t locus,
+  HIR::BlockExpr *function_body, TyTy::FnType *fntype)
+{
+  // every instance of a generic function is an event of its own
+  SelfProfileScope profile ("compile", IDENTIFIER_POINTER (DECL_NAME (fndecl)));
+
+  // setup the params, PARAM_VARS are the ones of the fndecl while FN_PARAMS
+  // has one per parameter of FNTYPE, the data half of the fat pointers
   TyTy::BaseType *tyret = fntype->get_return_type ();
   std::vector<Bvariable *> param_vars;
+  std::vector<Bvariable *> fn_params;
+  std::vector<ScalarPairParam> scalar_pair_params;
+  bool split_fat_pointers = fntype->get_abi () == ABI::RUST;
   if (!self_param.is_error ())
     {
       rust_assert (fntype->is_method ());
       TyTy::BaseType *self_tyty_lookup = fntype->get_self_type ();
 
       tree self_type = TyTyResolveCompile::compile (ctx, self_tyty_lookup);
-      Bvariable *compiled_self_param
-	= CompileSelfParam::compile (ctx, fndecl, self_param, self_type,
-				     self_param.get_locus ());
-
-      param_vars.push_back (compiled_self_param);
-      ctx->insert_var_decl (self_param.get_mappings ().get_hirid (),
-			    compiled_self_param);
+      if (split_fat_pointers && Backend::is_scalar_pair (self_type))
+	{
+	  auto pair = declare_scalar_pair_param (fndecl, self_type, nullptr,
+						 self_param.get_mappings ()
+						   .get_hirid (),
+						 self_param.get_locus ());
+	  scalar_pair_params.push_back (pair);
+	  param_vars.push_back (pair.data);
+	  param_vars.push_back (pair.meta);
+	  fn_params.push_back (pair.data);
+	}
+      else
+	{
+	  Bvariable *compiled_self_param
+	    = CompileSelfParam::compile (ctx, fndecl, self_param, self_type,
+					 self_param.get_locus ());
+
+	  param_vars.push_back (compiled_self_param);
+	  fn_params.push_back (compiled_self_param);
+	  ctx->insert_var_decl (self_param.get_mappings ().get_hirid (),
+				compiled_self_param);
+	}
     }
 
   // offset from + 1 for the TyTy::FnType being used when this is a method to
@@ -714,17 +1087,31 @@ HIRCompileBase::compile_function (
       auto compiled_param_type = TyTyResolveCompile::compile (ctx, param_tyty);
 
       location_t param_locus = referenced_param.get_locus ();
+      HIR::Pattern &param_pattern = *referenced_param.get_param_name ();
+      if (split_fat_pointers && Backend::is_scalar_pair (compiled_param_type))
+	{
+	  auto pair = declare_scalar_pair_param (
+	    fndecl, compiled_param_type, &param_pattern,
+	    param_pattern.get_mappings ().get_hirid (), param_locus);
+	  scalar_pair_params.push_back (pair);
+	  param_vars.push_back (pair.data);
+	  param_vars.push_back (pair.meta);
+	  fn_params.push_back (pair.data);
+	  continue;
+	}
+
       Bvariable *compiled_param_var
 	= CompileFnParam::compile (ctx, fndecl, &referenced_param,
 				   compiled_param_type, param_locus);
 
       param_vars.push_back (compiled_param_var);
+      fn_params.push_back (compiled_param_var);
 
-      const HIR::Pattern &param_pattern = *referenced_param.get_param_name ();
       ctx->insert_var_decl (param_pattern.get_mappings ().get_hirid (),
 			    compiled_param_var);
     }
 
+  setup_reference_params_restrict (fn_params, fntype);
   if (!Backend::function_set_parameters (fndecl, param_vars))
     return error_mark_node;
 
@@ -748,12 +1135,21 @@ HIRCompileBase::compile_function (
   ctx->add_statement (ret_var_stmt);
 
   ctx->push_fn (fndecl, return_address, tyret);
+  for (auto &pair : scalar_pair_params)
+    bind_scalar_pair_param (fndecl, code_block, pair);
   compile_function_body (fndecl, *function_body, tyret);
   tree bind_tree = ctx->pop_block ();
 
   gcc_assert (TREE_CODE (bind_tree) == BIND_EXPR);
   DECL_SAVED_TREE (fndecl) = bind_tree;
 
+  // the instances of functions from other crates are debugged in the crate
+  // they come from, the types of their locals would only bloat this one
+  bool is_upstream
+    = fntype->get_id ().crateNum != ctx->get_mappings ().get_current_crate ();
+  if (is_upstream && flag_rust_debuginfo == 1)
+    strip_debug_info (fndecl);
+
   ctx->pop_fn ();
   ctx->push_function (fndecl);
 
@@ -50,6 +50,12 @@ protected:
 			     const TyTy::DynamicObjectType *ty,
 			     location_t locus);
 
+  tree create_vtable (tree vtable_type,
+		      const std::vector<unsigned long> &indexes,
+		      const std::vector<tree> &methods, location_t locus);
+
+  tree promote_constant (tree init, location_t locus);
+
   tree compute_address_for_trait_item (
     const Resolver::TraitItemReference *ref,
     const TyTy::TypeBoundPredicate *predicate,
@@ -66,7 +72,7 @@ protected:
 		      const Analysis::NodeMapping &mappings,
 		      location_t expr_locus, bool is_qualified_path);
 
-  tree resolve_adjustements (std::vector<Resolver::Adjustment> &adjustments,
+  tree resolve_adjustements (Resolver::AdjustmentSpan adjustments,
 			     tree expression, location_t locus);
 
   tree resolve_deref_adjustment (Resolver::Adjustment &adjustment,
@@ -87,6 +93,8 @@ protected:
   tree resolve_method_address (TyTy::FnType *fntype, TyTy::BaseType *receiver,
 			       location_t expr_locus);
 
+  bool is_named_return_value (tree fndecl, tree value);
+
   void compile_function_body (tree fndecl, HIR::BlockExpr &function_body,
 			      TyTy::BaseType *fn_return_ty);
 
@@ -100,7 +108,37 @@ protected:
 			 HIR::Visibility &visibility, AST::AttrVec &outer_attrs,
 			 location_t locus, HIR::BlockExpr *function_body,
 			 const Resolver::CanonicalPath &canonical_path,
-			 TyTy::FnType *fntype);
+			 TyTy::FnType *fntype, bool defer_body = false);
+
+  // Declare an instance an extern crate emitted, instead of compiling it
+  tree compile_upstream_instance (const std::string &asm_name,
+				  location_t locus,
+				  const Resolver::CanonicalPath &canonical_path,
+				  TyTy::FnType *fntype);
+
+  tree compile_function_definition (
+    tree fndecl, HIR::SelfParam &self_param,
+    std::vector<HIR::FunctionParam> &function_params, location_t locus,
+    HIR::BlockExpr *function_body, TyTy::FnType *fntype);
+
+  // A fat pointer parameter of a Rust function, which comes in as the two
+  // scalars of its fields: PATTERN is null for the self parameter
+  struct ScalarPairParam
+  {
+    Bvariable *data;
+    Bvariable *meta;
+    tree type;
+    HIR::Pattern *pattern;
+    HirId hirid;
+    location_t locus;
+  };
+
+  ScalarPairParam declare_scalar_pair_param (tree fndecl, tree type,
+					     HIR::Pattern *pattern, HirId hirid,
+					     location_t locus);
+
+  void bind_scalar_pair_param (tree fndecl, tree code_block,
+			       const ScalarPairParam &pair);
 
   static tree unit_expression (location_t locus);
 
@@ -141,6 +179,15 @@ protected:
 
   static void setup_abi_options (tree fndecl, ABI abi);
 
+  bool is_freeze (const TyTy::BaseType *ty);
+
+  void setup_diverging_fndecl (tree fndecl, TyTy::FnType *fntype);
+
+  void setup_reference_params_nonnull (tree fndecl, TyTy::FnType *fntype);
+
+  void setup_reference_params_restrict (std::vector<Bvariable *> &params,
+					TyTy::FnType *fntype);
+
   static tree indirect_expression (tree expr, location_t locus);
 
   static bool mark_addressable (tree, location_t);
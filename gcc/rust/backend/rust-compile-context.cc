@@ -18,6 +18,8 @@
 
 #include "rust-compile-context.h"
 #include "rust-compile-type.h"
+#include "rust-tyty-key.h"
+#include "fnv-hash.h"
 
 namespace Rust {
 namespace Compile {
@@ -48,6 +50,43 @@ Context::setup_builtins ()
     }
 }
 
+// A hash of the signature of a monomorphized function or closure, such that
+// instances which are is_equal always get the same hash. Parts of the
+// signature without a TypeKey all hash the same for that reason.
+uint64_t
+Context::instance_hash (const TyTy::BaseType *ty)
+{
+  uint64_t hash = ty->get_kind ();
+  auto add = [&hash] (const TyTy::BaseType *part) {
+    auto key = TyTy::TypeKey::make (part);
+    hash = hash * 31 + (key ? key->get_hash () : 0);
+  };
+
+  switch (ty->get_kind ())
+    {
+      case TyTy::TypeKind::FNDEF: {
+	auto fn = static_cast<const TyTy::FnType *> (ty);
+	for (auto &param : fn->get_params ())
+	  add (param.second);
+	add (fn->get_return_type ());
+	break;
+      }
+
+      case TyTy::TypeKind::CLOSURE: {
+	auto closure = static_cast<const TyTy::ClosureType *> (ty);
+	add (&closure->get_parameters ());
+	add (&closure->get_result_type ());
+	break;
+      }
+
+    default:
+      add (ty);
+      break;
+    }
+
+  return hash;
+}
+
 hashval_t
 Context::type_hasher (tree type)
 {
@@ -145,49 +184,250 @@ Context::type_hasher (tree type)
 void
 Context::push_closure_context (HirId id)
 {
-  auto it = closure_bindings.find (id);
-  rust_assert (it == closure_bindings.end ());
+  for (auto &scope : closure_scopes)
+    rust_assert (scope.closure != id);
 
-  closure_bindings.insert ({id, {}});
-  closure_scope_bindings.push_back (id);
+  closure_scopes.push_back ({id, {}});
 }
 
 void
 Context::pop_closure_context ()
 {
-  rust_assert (!closure_scope_bindings.empty ());
-
-  HirId ref = closure_scope_bindings.back ();
-  closure_scope_bindings.pop_back ();
-  closure_bindings.erase (ref);
+  rust_assert (!closure_scopes.empty ());
+  closure_scopes.pop_back ();
 }
 
 void
 Context::insert_closure_binding (HirId id, tree expr)
 {
-  rust_assert (!closure_scope_bindings.empty ());
-
-  HirId ref = closure_scope_bindings.back ();
-  closure_bindings[ref].insert ({id, expr});
+  rust_assert (!closure_scopes.empty ());
+  closure_scopes.back ().bindings.push_back ({id, expr});
 }
 
 bool
 Context::lookup_closure_binding (HirId id, tree *expr)
 {
-  if (closure_scope_bindings.empty ())
+  if (closure_scopes.empty ())
     return false;
 
-  HirId ref = closure_scope_bindings.back ();
-  auto it = closure_bindings.find (ref);
-  rust_assert (it != closure_bindings.end ());
+  for (auto &binding : closure_scopes.back ().bindings)
+    if (binding.first == id)
+      {
+	*expr = binding.second;
+	return true;
+      }
+
+  return false;
+}
+
+unsigned
+module_codegen_unit (const std::vector<std::string> &module)
+{
+  Hash::FNV128 hasher;
+  for (auto &segment : module)
+    {
+      hasher.write ((const unsigned char *) segment.data (), segment.size ());
+      hasher.write ((const unsigned char *) "::", 2);
+    }
+
+  uint64_t hi, lo;
+  hasher.sum (&hi, &lo);
+  return lo % flag_rust_codegen_units;
+}
+
+// The unit of the items of a module, from the path of one of them. The path
+// is cut before its last segment, or before the first impl block in it.
+static unsigned
+path_codegen_unit (const Resolver::CanonicalPath &path)
+{
+  std::vector<std::string> module;
+  for (size_t i = 0; i + 1 < path.size (); i++)
+    {
+      auto &segment = path.get_seg_at (i).second;
+      if (segment[0] == '<')
+	break;
+      module.push_back (segment);
+    }
+
+  return module_codegen_unit (module);
+}
+
+void
+Context::place_function (tree fndecl, const Resolver::CanonicalPath &path,
+			 bool near_user)
+{
+  if (flag_rust_codegen_units <= 1 || path.is_empty ())
+    return;
+
+  // private #[inline] functions are cheaper to duplicate than to call across
+  // units, every unit using one gets its own copy
+  if (!TREE_PUBLIC (fndecl) && DECL_DECLARED_INLINE_P (fndecl))
+    return;
+
+  if (near_user && !fn_state.fn_stack.empty ())
+    {
+      auto user = codegen_units.find (peek_fn ().fndecl);
+      if (user != codegen_units.end ())
+	{
+	  codegen_units[fndecl] = user->second;
+	  return;
+	}
+    }
+
+  codegen_units[fndecl] = path_codegen_unit (path);
+}
+
+void
+Context::place_var (Bvariable *var, const Resolver::CanonicalPath &path)
+{
+  if (flag_rust_codegen_units <= 1 || path.is_empty ())
+    return;
+
+  codegen_units[var->get_decl ()] = path_codegen_unit (path);
+}
 
-  auto iy = it->second.find (id);
-  if (iy == it->second.end ())
+bool
+Context::is_dead_function (const HIR::Function &fn) const
+{
+  HirId id = fn.get_mappings ().get_hirid ();
+  if (!live_items || live_items->find (id) != live_items->end ()
+      || fn.get_visibility ().is_public ())
     return false;
 
-  *expr = iy->second;
+  // trait methods are reached through their trait
+  if (mappings.is_impl_item (id)
+      && mappings.lookup_associated_impl (id)->has_trait_ref ())
+    return false;
+
+  // these are used by the linker or the compiler rather than by the crate
+  for (const auto &attr : fn.get_outer_attrs ())
+    switch (attr.get_builtin ())
+      {
+      case Values::BuiltinAttribute::NO_MANGLE:
+      case Values::BuiltinAttribute::LINK_SECTION:
+      case Values::BuiltinAttribute::LANG:
+	return false;
+      default:
+	break;
+      }
+
   return true;
 }
 
+// Let the other codegen units refer to DECL
+static void
+make_hidden_symbol (tree decl)
+{
+  if (TREE_PUBLIC (decl))
+    return;
+
+  TREE_PUBLIC (decl) = 1;
+  DECL_VISIBILITY (decl) = VISIBILITY_HIDDEN;
+  DECL_VISIBILITY_SPECIFIED (decl) = 1;
+}
+
+/* Only one codegen unit defines each static and each function which was
+   placed in a unit, and the first unit the other public variables. The other
+   units refer to them, so private ones get a hidden symbol. The variables the
+   compiler generates such as vtables, the functions which were not placed and
+   the one-only generic instances are left in every unit which uses them.  */
+
+void
+Context::write_to_backend ()
+{
+  if (flag_rust_codegen_units > 1)
+    {
+      unsigned unit = flag_rust_codegen_unit;
+      for (auto var : var_decls)
+	{
+	  tree decl = var->get_decl ();
+	  if (decl == error_mark_node)
+	    continue;
+
+	  auto placed = codegen_units.find (decl);
+	  if (placed == codegen_units.end () && !TREE_PUBLIC (decl))
+	    continue;
+
+	  unsigned var_unit = 0;
+	  if (placed != codegen_units.end ())
+	    {
+	      var_unit = placed->second;
+	      make_hidden_symbol (decl);
+	    }
+	  if (var_unit == unit)
+	    continue;
+
+	  DECL_EXTERNAL (decl) = 1;
+	  TREE_STATIC (decl) = 0;
+	  DECL_INITIAL (decl) = NULL_TREE;
+	}
+
+      for (auto fndecl : func_decls)
+	{
+	  if (fndecl == error_mark_node)
+	    continue;
+
+	  // public functions which were not placed go in the first unit, the
+	  // linker merges the copies of the one-only ones
+	  auto placed = codegen_units.find (fndecl);
+	  bool every_unit
+	    = DECL_ONE_ONLY (fndecl)
+	      || (placed == codegen_units.end () && !TREE_PUBLIC (fndecl));
+	  if (!every_unit)
+	    {
+	      unsigned fn_unit
+		= placed == codegen_units.end () ? 0 : placed->second;
+	      make_hidden_symbol (fndecl);
+	      if (fn_unit != unit)
+		{
+		  DECL_EXTERNAL (fndecl) = 1;
+		  TREE_STATIC (fndecl) = 0;
+		  DECL_SAVED_TREE (fndecl) = NULL_TREE;
+		  DECL_INITIAL (fndecl) = NULL_TREE;
+		  continue;
+		}
+	    }
+
+	  Backend::write_function_definition (fndecl);
+	}
+    }
+
+  Backend::write_global_definitions (type_decls, const_decls, func_decls,
+				     var_decls);
+}
+
+void
+Context::dump_memory_report () const
+{
+  auto dump = [] (const char *name, size_t count) {
+    fprintf (stderr, "  %-28s %10" GCC_PRISZ "u\n", name, (fmt_size_t) count);
+  };
+
+  size_t mono_fn_count = 0;
+  for (auto &fn : mono_fns)
+    mono_fn_count += fn.second.decls.size ();
+  size_t mono_closure_count = 0;
+  for (auto &closure : mono_closure_fns)
+    mono_closure_count += closure.second.decls.size ();
+
+  dump ("compiled types", compiled_type_map.size ());
+  dump ("interned types",
+	interned_types[0].size () + interned_types[1].size ());
+  dump ("main variants", main_variants.size ());
+  dump ("compiled functions", compiled_fn_map.size ());
+  dump ("monomorphized functions", mono_fn_count);
+  dump ("monomorphized closures", mono_closure_count);
+  dump ("compiled constants", compiled_consts.size ());
+  dump ("compiled variables", compiled_var_decls.size ());
+  dump ("vtables", vtables.size ());
+  dump ("promoted constants", promoted_constants.size ());
+  dump ("string literals", string_literals.size ());
+  dump ("mangled names", mangled_names.size ());
+  dump ("type declarations", type_decls.size ());
+  dump ("function declarations", func_decls.size ());
+  dump ("variable declarations", var_decls.size ());
+  dump ("constant declarations", const_decls.size ());
+}
+
 } // namespace Compile
 } // namespace Rust
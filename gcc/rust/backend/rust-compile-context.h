@@ -37,6 +37,26 @@ struct fncontext
   tree fndecl;
   ::Bvariable *ret_addr;
   TyTy::BaseType *retty;
+  // whether an explicit `return` was compiled in the body so far
+  bool has_returns = false;
+};
+
+/* The statement state of the function bodies being compiled. It is the only
+   state a body needs to itself, everything else a body reaches is a cache of
+   declarations and types shared by the whole crate.  */
+struct FunctionState
+{
+  std::vector<fncontext> fn_stack;
+  std::vector<std::vector<tree>> statements;
+  std::vector<tree> scope_stack;
+  std::vector<::Bvariable *> loop_value_stack;
+  std::vector<tree> loop_begin_labels;
+
+  bool empty () const
+  {
+    return fn_stack.empty () && statements.empty () && scope_stack.empty ()
+	   && loop_value_stack.empty () && loop_begin_labels.empty ();
+  }
 };
 
 struct CustomDeriveInfo
@@ -55,7 +75,7 @@ public:
 
   bool lookup_compiled_types (tree t, tree *type)
   {
-    hashval_t h = type_hasher (t);
+    hashval_t h = hash_type (t);
     auto it = compiled_type_map.find (h);
     if (it == compiled_type_map.end ())
       return false;
@@ -66,7 +86,7 @@ public:
 
   tree insert_compiled_type (tree type)
   {
-    hashval_t h = type_hasher (type);
+    hashval_t h = hash_type (type);
     auto it = compiled_type_map.find (h);
     if (it != compiled_type_map.end ())
       return it->second;
@@ -76,9 +96,27 @@ public:
     return type;
   }
 
+  bool lookup_interned_type (const TyTy::BaseType *interned,
+			     bool trait_object_mode, tree *type)
+  {
+    auto &types = interned_types[trait_object_mode];
+    auto it = types.find (interned);
+    if (it == types.end ())
+      return false;
+
+    *type = it->second;
+    return true;
+  }
+
+  void insert_interned_type (const TyTy::BaseType *interned,
+			     bool trait_object_mode, tree type)
+  {
+    interned_types[trait_object_mode][interned] = type;
+  }
+
   tree insert_main_variant (tree type)
   {
-    hashval_t h = type_hasher (type);
+    hashval_t h = hash_type (type);
     auto it = main_variants.find (h);
     if (it != main_variants.end ())
       return it->second;
@@ -93,17 +131,17 @@ public:
 
   void push_block (tree scope)
   {
-    scope_stack.push_back (scope);
-    statements.push_back ({});
+    fn_state.scope_stack.push_back (scope);
+    fn_state.statements.push_back ({});
   }
 
   tree pop_block ()
   {
-    auto block = scope_stack.back ();
-    scope_stack.pop_back ();
+    auto block = fn_state.scope_stack.back ();
+    fn_state.scope_stack.pop_back ();
 
-    auto stmts = statements.back ();
-    statements.pop_back ();
+    auto stmts = fn_state.statements.back ();
+    fn_state.statements.pop_back ();
 
     Backend::block_add_statements (block, stmts);
 
@@ -112,18 +150,22 @@ public:
 
   tree peek_enclosing_scope ()
   {
-    if (scope_stack.size () == 0)
+    if (fn_state.scope_stack.size () == 0)
       return nullptr;
 
-    return scope_stack.back ();
+    return fn_state.scope_stack.back ();
   }
 
   void add_statement_to_enclosing_scope (tree stmt)
   {
+    auto &statements = fn_state.statements;
     statements.at (statements.size () - 2).push_back (stmt);
   }
 
-  void add_statement (tree stmt) { statements.back ().push_back (stmt); }
+  void add_statement (tree stmt)
+  {
+    fn_state.statements.back ().push_back (stmt);
+  }
 
   void insert_var_decl (HirId id, ::Bvariable *decl)
   {
@@ -148,21 +190,17 @@ public:
     rust_assert (compiled_fn_map.find (id) == compiled_fn_map.end ());
     compiled_fn_map[id] = fn;
 
-    auto it = mono_fns.find (dId);
-    if (it == mono_fns.end ())
-      mono_fns[dId] = {};
-
-    mono_fns[dId].push_back ({ref, fn});
+    auto &instances = mono_fns[dId];
+    instances.by_hash[instance_hash (ref)].push_back ({ref, fn});
+    instances.decls.push_back (fn);
   }
 
   void insert_closure_decl (const TyTy::ClosureType *ref, tree fn)
   {
     auto dId = ref->get_def_id ();
-    auto it = mono_closure_fns.find (dId);
-    if (it == mono_closure_fns.end ())
-      mono_closure_fns[dId] = {};
-
-    mono_closure_fns[dId].push_back ({ref, fn});
+    auto &instances = mono_closure_fns[dId];
+    instances.by_hash[instance_hash (ref)].push_back ({ref, fn});
+    instances.decls.push_back (fn);
   }
 
   tree lookup_closure_decl (const TyTy::ClosureType *ref)
@@ -172,7 +210,11 @@ public:
     if (it == mono_closure_fns.end ())
       return error_mark_node;
 
-    for (auto &i : it->second)
+    auto bucket = it->second.by_hash.find (instance_hash (ref));
+    if (bucket == it->second.by_hash.end ())
+      return error_mark_node;
+
+    for (auto &i : bucket->second)
       {
 	const TyTy::ClosureType *t = i.first;
 	tree fn = i.second;
@@ -197,33 +239,37 @@ public:
 	if (it == mono_fns.end ())
 	  return false;
 
-	for (auto &e : mono_fns[dId])
+	auto bucket = it->second.by_hash.find (instance_hash (ref));
+	if (bucket != it->second.by_hash.end ())
+	  for (auto &e : bucket->second)
+	    {
+	      const TyTy::BaseType *r = e.first;
+	      if (ref->is_equal (*r))
+		{
+		  *fn = e.second;
+		  return true;
+		}
+	    }
+
+	if (asm_name.empty ())
+	  return false;
+
+	for (tree f : it->second.decls)
 	  {
-	    const TyTy::BaseType *r = e.first;
-	    tree f = e.second;
+	    if (!DECL_ASSEMBLER_NAME_SET_P (f))
+	      continue;
+
+	    tree raw = DECL_ASSEMBLER_NAME_RAW (f);
+	    const char *rptr = IDENTIFIER_POINTER (raw);
 
-	    if (ref->is_equal (*r))
+	    bool lengths_match_p = IDENTIFIER_LENGTH (raw) == asm_name.size ();
+	    if (lengths_match_p
+		&& strncmp (rptr, asm_name.c_str (), IDENTIFIER_LENGTH (raw))
+		     == 0)
 	      {
 		*fn = f;
 		return true;
 	      }
-
-	    if (DECL_ASSEMBLER_NAME_SET_P (f) && !asm_name.empty ())
-	      {
-		tree raw = DECL_ASSEMBLER_NAME_RAW (f);
-		const char *rptr = IDENTIFIER_POINTER (raw);
-
-		bool lengths_match_p
-		  = IDENTIFIER_LENGTH (raw) == asm_name.size ();
-		if (lengths_match_p
-		    && strncmp (rptr, asm_name.c_str (),
-				IDENTIFIER_LENGTH (raw))
-			 == 0)
-		  {
-		    *fn = f;
-		    return true;
-		  }
-	      }
 	  }
 	return false;
       }
@@ -260,6 +306,65 @@ public:
     return true;
   }
 
+  // Trait object vtables are shared by every coercion site which needs the
+  // same METHODS, the FUNCTION_DECLs making up the vtable.
+  void insert_vtable (const std::vector<tree> &methods, tree vtable)
+  {
+    vtables[methods] = vtable;
+  }
+
+  bool lookup_vtable (const std::vector<tree> &methods, tree *vtable)
+  {
+    auto it = vtables.find (methods);
+    if (it == vtables.end ())
+      return false;
+
+    *vtable = it->second;
+    return true;
+  }
+
+  // String literals with the same contents and type share their STRING_CST,
+  // which the constant pool emits once per compilation unit.
+  tree lookup_string_literal (const std::string &value, tree type)
+  {
+    auto it = string_literals.find ({value, type});
+    return it == string_literals.end () ? NULL_TREE : it->second;
+  }
+
+  void insert_string_literal (const std::string &value, tree type, tree cst)
+  {
+    // large values, such as the contents of include_bytes!, are rarely
+    // repeated and not worth a copy in the map
+    if (value.size () > max_interned_length)
+      return;
+
+    string_literals[{value, type}] = cst;
+  }
+
+  // Constant arrays which are borrowed immutably are promoted to read-only
+  // globals, one for each distinct INIT.
+  void insert_promoted_constant (tree init, tree decl)
+  {
+    promoted_constants[iterative_hash_expr (init, 0)].push_back (decl);
+  }
+
+  bool lookup_promoted_constant (tree init, tree *decl)
+  {
+    auto it = promoted_constants.find (iterative_hash_expr (init, 0));
+    if (it == promoted_constants.end ())
+      return false;
+
+    for (tree candidate : it->second)
+      if (TREE_TYPE (candidate) == TREE_TYPE (init)
+	  && simple_cst_equal (DECL_INITIAL (candidate), init) == 1)
+	{
+	  *decl = candidate;
+	  return true;
+	}
+
+    return false;
+  }
+
   void insert_pattern_binding (HirId id, tree binding)
   {
     implicit_pattern_bindings[id] = binding;
@@ -277,30 +382,51 @@ public:
 
   void push_fn (tree fn, ::Bvariable *ret_addr, TyTy::BaseType *retty)
   {
-    fn_stack.push_back (fncontext{fn, ret_addr, retty});
+    fn_state.fn_stack.push_back (fncontext{fn, ret_addr, retty});
+  }
+  void pop_fn () { fn_state.fn_stack.pop_back (); }
+
+  void note_fn_return ()
+  {
+    rust_assert (!fn_state.fn_stack.empty ());
+    fn_state.fn_stack.back ().has_returns = true;
   }
-  void pop_fn () { fn_stack.pop_back (); }
 
-  bool in_fn () { return fn_stack.size () != 0; }
+  bool in_fn () { return fn_state.fn_stack.size () != 0; }
 
   // Note: it is undefined behavior to call peek_fn () if fn_stack is empty.
   fncontext peek_fn ()
   {
-    rust_assert (!fn_stack.empty ());
-    return fn_stack.back ();
+    rust_assert (!fn_state.fn_stack.empty ());
+    return fn_state.fn_stack.back ();
   }
 
   void push_type (tree t) { type_decls.push_back (t); }
   void push_var (::Bvariable *v) { var_decls.push_back (v); }
   void push_const (tree c) { const_decls.push_back (c); }
-  void push_function (tree f) { func_decls.push_back (f); }
-
-  void write_to_backend ()
+  // Record F, whose body is complete, and pass it on to the middle-end. With
+  // several codegen units, this waits until the crate is written out, once
+  // it is known which functions the unit emits.
+  void push_function (tree f)
   {
-    Backend::write_global_definitions (type_decls, const_decls, func_decls,
-				       var_decls);
+    func_decls.push_back (f);
+    if (flag_rust_codegen_units <= 1)
+      Backend::write_function_definition (f);
   }
 
+  /* Choose the codegen unit emitting FNDECL, the function at PATH, for
+   * -frust-codegen-units. A function goes with the other items of its module,
+   * unless NEAR_USER is set: generic instances and closures are emitted with
+   * the function being compiled when they are first needed. */
+  void place_function (tree fndecl, const Resolver::CanonicalPath &path,
+		       bool near_user);
+
+  // Choose the codegen unit defining VAR, the static at PATH: it goes with
+  // the other items of its module, like functions
+  void place_var (::Bvariable *var, const Resolver::CanonicalPath &path);
+
+  void write_to_backend ();
+
   bool function_completed (tree fn)
   {
     for (auto it = func_decls.begin (); it != func_decls.end (); it++)
@@ -314,28 +440,31 @@ public:
     return false;
   }
 
-  void push_loop_context (Bvariable *var) { loop_value_stack.push_back (var); }
+  void push_loop_context (Bvariable *var)
+  {
+    fn_state.loop_value_stack.push_back (var);
+  }
 
-  Bvariable *peek_loop_context () { return loop_value_stack.back (); }
+  Bvariable *peek_loop_context () { return fn_state.loop_value_stack.back (); }
 
   Bvariable *pop_loop_context ()
   {
-    auto back = loop_value_stack.back ();
-    loop_value_stack.pop_back ();
+    auto back = fn_state.loop_value_stack.back ();
+    fn_state.loop_value_stack.pop_back ();
     return back;
   }
 
   void push_loop_begin_label (tree label)
   {
-    loop_begin_labels.push_back (label);
+    fn_state.loop_begin_labels.push_back (label);
   }
 
-  tree peek_loop_begin_label () { return loop_begin_labels.back (); }
+  tree peek_loop_begin_label () { return fn_state.loop_begin_labels.back (); }
 
   tree pop_loop_begin_label ()
   {
-    tree pop = loop_begin_labels.back ();
-    loop_begin_labels.pop_back ();
+    tree pop = fn_state.loop_begin_labels.back ();
+    fn_state.loop_begin_labels.pop_back ();
     return pop;
   }
 
@@ -347,10 +476,65 @@ public:
   }
   bool const_context_p (void) { return (const_context > 0); }
 
-  std::string mangle_item (const TyTy::BaseType *ty,
-			   const Resolver::CanonicalPath &path)
+  // A monomorphized function whose declaration has been built and whose body
+  // is compiled once the crate's items are done, so that instances are
+  // generated from a worklist instead of recursing into each other.
+  struct DeferredFnBody
+  {
+    tree fndecl;
+    HIR::SelfParam *self_param;
+    std::vector<HIR::FunctionParam> *function_params;
+    HIR::BlockExpr *function_body;
+    location_t locus;
+    TyTy::FnType *fntype;
+  };
+
+  // Replace the statement state with STATE, returning the previous one, so
+  // that a function body can be compiled apart from the one being compiled
+  FunctionState swap_function_state (FunctionState state)
+  {
+    std::swap (fn_state, state);
+    return state;
+  }
+
+  // The items which the dead code analysis found live. Until they are set,
+  // every function is assumed to be live.
+  void set_live_items (std::set<HirId> live) { live_items = std::move (live); }
+
+  // Whether FN is private and never used, so that it does not need to be
+  // compiled unless a reference to it turns up while compiling the crate
+  bool is_dead_function (const HIR::Function &fn) const;
+
+  void set_defer_fn_bodies (bool defer) { defer_bodies = defer; }
+  bool defer_fn_bodies () const { return defer_bodies; }
+
+  void push_deferred_fn_body (DeferredFnBody body)
   {
-    return mangler.mangle_item (this, ty, path);
+    deferred_fn_bodies.push_back (body);
+  }
+
+  tl::optional<DeferredFnBody> pop_deferred_fn_body ()
+  {
+    if (deferred_fn_bodies.empty ())
+      return tl::nullopt;
+
+    DeferredFnBody body = deferred_fn_bodies.front ();
+    deferred_fn_bodies.pop_front ();
+    return body;
+  }
+
+  // The symbol name of TY at PATH, which gets mangled once per instance
+  const std::string &mangle_item (const TyTy::BaseType *ty,
+				  const Resolver::CanonicalPath &path)
+  {
+    auto key = std::make_pair (ty, path.get ());
+    auto it = mangled_names.find (key);
+    if (it == mangled_names.end ())
+      it = mangled_names
+	     .emplace (std::move (key), mangler.mangle_item (this, ty, path))
+	     .first;
+
+    return it->second;
   }
 
   void push_closure_context (HirId id);
@@ -363,8 +547,22 @@ public:
   std::vector<tree> &get_const_decls () { return const_decls; }
   std::vector<tree> &get_func_decls () { return func_decls; }
 
+  // Print the size of the caches to stderr, for -frust-mem-report
+  void dump_memory_report () const;
+
   static hashval_t type_hasher (tree type);
 
+  hashval_t hash_type (tree type)
+  {
+    auto it = type_hashes.find (type);
+    if (it != type_hashes.end ())
+      return it->second;
+
+    hashval_t h = type_hasher (type);
+    type_hashes.insert ({type, h});
+    return h;
+  }
+
   void collect_attribute_proc_macro (tree fndecl)
   {
     attribute_macros.push_back (fndecl);
@@ -388,36 +586,65 @@ public:
   }
 
 private:
+  static uint64_t instance_hash (const TyTy::BaseType *ty);
+
   Resolver::Resolver *resolver;
   Resolver::TypeCheckContext *tyctx;
   Analysis::Mappings &mappings;
   Mangler mangler;
 
   // state
-  std::vector<fncontext> fn_stack;
+  FunctionState fn_state;
   std::map<HirId, ::Bvariable *> compiled_var_decls;
-  std::map<hashval_t, tree> compiled_type_map;
+  std::unordered_map<hashval_t, tree> compiled_type_map;
+  // The hash of every type looked up in compiled_type_map or main_variants,
+  // which walks the fields of records, so it is only computed once per type
+  std::unordered_map<tree, hashval_t> type_hashes;
+  // The lowered interned types, indexed by trait object mode. These are
+  // looked up before hashing the GENERIC type, so a type which has already
+  // been lowered costs a single lookup.
+  std::unordered_map<const TyTy::BaseType *, tree> interned_types[2];
   std::map<HirId, tree> compiled_fn_map;
   std::map<HirId, tree> compiled_consts;
   std::map<HirId, tree> compiled_labels;
-  std::vector<::std::vector<tree>> statements;
-  std::vector<tree> scope_stack;
-  std::vector<::Bvariable *> loop_value_stack;
-  std::vector<tree> loop_begin_labels;
-  std::map<DefId, std::vector<std::pair<const TyTy::BaseType *, tree>>>
-    mono_fns;
-  std::map<DefId, std::vector<std::pair<const TyTy::ClosureType *, tree>>>
-    mono_closure_fns;
+  // The monomorphized instances of one generic function or closure, bucketed
+  // by instance_hash. The declarations are also kept in order of insertion,
+  // to look them up by assembler name.
+  template <typename T> struct MonoInstances
+  {
+    std::unordered_map<uint64_t, std::vector<std::pair<const T *, tree>>>
+      by_hash;
+    std::vector<tree> decls;
+  };
+
+  std::unordered_map<DefId, MonoInstances<TyTy::BaseType>> mono_fns;
+  std::unordered_map<DefId, MonoInstances<TyTy::ClosureType>> mono_closure_fns;
   std::map<HirId, tree> implicit_pattern_bindings;
-  std::map<hashval_t, tree> main_variants;
+  std::map<std::vector<tree>, tree> vtables;
+  std::unordered_map<hashval_t, std::vector<tree>> promoted_constants;
+  std::map<std::pair<std::string, tree>, tree> string_literals;
+  std::map<std::pair<const TyTy::BaseType *, std::string>, std::string>
+    mangled_names;
+  std::unordered_map<hashval_t, tree> main_variants;
+  // the codegen unit of each function, functions which are not placed get a
+  // private copy in every unit using them
+  std::unordered_map<tree, unsigned> codegen_units;
 
   std::vector<CustomDeriveInfo> custom_derive_macros;
   std::vector<tree> attribute_macros;
   std::vector<tree> bang_macros;
 
-  // closure bindings
-  std::vector<HirId> closure_scope_bindings;
-  std::map<HirId, std::map<HirId, tree>> closure_bindings;
+  // The captures of a closure being compiled. A closure captures a handful of
+  // variables at most, which are cheaper to search in a flat vector than to
+  // keep in a map.
+  struct ClosureScope
+  {
+    HirId closure;
+    std::vector<std::pair<HirId, tree>> bindings;
+  };
+
+  // closure bindings, the innermost closure last
+  std::vector<ClosureScope> closure_scopes;
 
   // To GCC middle-end
   std::vector<tree> type_decls;
@@ -427,8 +654,18 @@ private:
 
   // Nonzero iff we are currently compiling something inside a constant context.
   unsigned int const_context = 0;
+
+  bool defer_bodies = false;
+  std::deque<DeferredFnBody> deferred_fn_bodies;
+
+  tl::optional<std::set<HirId>> live_items;
 };
 
+// The -frust-codegen-units unit of the items of the module at the path MODULE,
+// given as its segments from the crate name
+unsigned
+module_codegen_unit (const std::vector<std::string> &module);
+
 } // namespace Compile
 } // namespace Rust
 
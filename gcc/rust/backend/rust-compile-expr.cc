@@ -24,6 +24,8 @@
 #include "rust-compile-implitem.h"
 #include "rust-constexpr.h"
 #include "rust-compile-type.h"
+#include "rust-compile-intrinsic.h"
+#include "rust-compile-asm.h"
 #include "rust-gcc.h"
 
 #include "fold-const.h"
@@ -135,6 +137,7 @@ CompileExpr::visit (HIR::ReturnExpr &expr)
   tree return_stmt = Backend::return_statement (fncontext.fndecl, return_value,
 						expr.get_locus ());
   ctx->add_statement (return_stmt);
+  ctx->note_fn_return ();
 }
 
 void
@@ -175,9 +178,8 @@ CompileExpr::visit (HIR::ArithmeticOrLogicalExpr &expr)
     }
   else
     {
-      translated
-	= Backend::arithmetic_or_logical_expression (op, lhs, rhs,
-						     expr.get_locus ());
+      translated = Backend::arithmetic_or_logical_expression (
+	op, lhs, rhs, expr.get_locus (), !ctx->const_context_p ());
     }
 }
 
@@ -225,9 +227,8 @@ CompileExpr::visit (HIR::CompoundAssignmentExpr &expr)
     }
   else
     {
-      translated
-	= Backend::arithmetic_or_logical_expression (op, lhs, rhs,
-						     expr.get_locus ());
+      translated = Backend::arithmetic_or_logical_expression (
+	op, lhs, rhs, expr.get_locus (), !ctx->const_context_p ());
     }
 }
 
@@ -251,7 +252,8 @@ CompileExpr::visit (HIR::NegationExpr &expr)
       return;
     }
 
-  translated = Backend::negation_expression (op, negated_expr, location);
+  translated = Backend::negation_expression (op, negated_expr, location,
+					     !ctx->const_context_p ());
 }
 
 void
@@ -298,10 +300,9 @@ CompileExpr::visit (HIR::TypeCastExpr &expr)
   auto type_to_cast_to = TyTyResolveCompile::compile (ctx, type_to_cast_to_ty);
   auto casted_expr = CompileExpr::Compile (expr.get_casted_expr ().get (), ctx);
 
-  std::vector<Resolver::Adjustment> *adjustments = nullptr;
-  bool ok = ctx->get_tyctx ()->lookup_cast_autoderef_mappings (
-    expr.get_mappings ().get_hirid (), &adjustments);
-  if (ok)
+  auto adjustments = ctx->get_tyctx ()->lookup_cast_autoderef_mappings (
+    expr.get_mappings ().get_hirid ());
+  if (adjustments)
     {
       casted_expr
 	= resolve_adjustements (*adjustments, casted_expr, expr.get_locus ());
@@ -816,6 +817,13 @@ CompileExpr::visit (HIR::BorrowExpr &expr)
 				       &tyty))
     return;
 
+  // a shared borrow of a constant array, such as the string pieces built
+  // for format_args!, refers to a single read-only global
+  if (!expr.is_mut () && TREE_CODE (main_expr) == CONSTRUCTOR
+      && TREE_CONSTANT (main_expr)
+      && TREE_CODE (TREE_TYPE (main_expr)) == ARRAY_TYPE)
+    main_expr = promote_constant (main_expr, expr.get_locus ());
+
   translated = address_expression (main_expr, expr.get_locus ());
 }
 
@@ -899,6 +907,13 @@ CompileExpr::visit (HIR::LiteralExpr &expr)
     }
 }
 
+void
+CompileExpr::visit (HIR::InlineAsm &expr)
+{
+  CompileAsm::Compile (expr, ctx);
+  translated = unit_expression (expr.get_locus ());
+}
+
 void
 CompileExpr::visit (HIR::AssignmentExpr &expr)
 {
@@ -982,14 +997,213 @@ check_match_scrutinee (HIR::MatchExpr &expr, Context *ctx)
   return scrutinee_kind;
 }
 
+tree
+CompileExpr::compile_match_arm (HIR::MatchCase &kase, HIR::Pattern &pattern,
+				tree match_scrutinee_expr, Bvariable *result,
+				tree end_label)
+{
+  // setup the match-arm-body-block
+  tree fndecl = ctx->peek_fn ().fndecl;
+  tree enclosing_scope = ctx->peek_enclosing_scope ();
+  location_t start_location = UNKNOWN_LOCATION; // FIXME
+  location_t end_location = UNKNOWN_LOCATION;	// FIXME
+  tree arm_body_block = Backend::block (fndecl, enclosing_scope, {},
+					start_location, end_location);
+
+  ctx->push_block (arm_body_block);
+
+  // setup the bindings for the block
+  CompilePatternBindings::Compile (&pattern, match_scrutinee_expr, ctx);
+
+  // compile the expr and setup the assignment
+  location_t arm_locus = kase.get_arm ().get_locus ();
+  tree kase_expr_tree = CompileExpr::Compile (kase.get_expr ().get (), ctx);
+  tree result_reference = Backend::var_expression (result, arm_locus);
+  tree assignment
+    = Backend::assignment_statement (result_reference, kase_expr_tree,
+				     arm_locus);
+  ctx->add_statement (assignment);
+
+  // go to end label
+  tree goto_end_label
+    = build1_loc (arm_locus, GOTO_EXPR, void_type_node, end_label);
+  ctx->add_statement (goto_end_label);
+
+  ctx->pop_block ();
+
+  return arm_body_block;
+}
+
+/* Lower EXPR to a SWITCH_EXPR on the value of the scrutinee, on its
+   discriminant, or on its length when matching a string. This is a decision
+   tree one level deep: each case only checks the sub-tests of the arms which
+   can match its value, in order, and jumps to the body of the first one which
+   succeeds. The switched value is read once, and a body is emitted once
+   whatever the number of cases leading to it.
+
+   Returns false, without having emitted anything, if the match has to be
+   lowered to a chain of pattern checks.  */
+
+bool
+CompileExpr::compile_match_switch (HIR::MatchExpr &expr,
+				   tree match_scrutinee_expr, Bvariable *result,
+				   tree end_label)
+{
+  TyTy::BaseType *scrutinee_tyty = nullptr;
+  if (!ctx->get_tyctx ()->lookup_type (
+	expr.get_scrutinee_expr ()->get_mappings ().get_hirid (),
+	&scrutinee_tyty))
+    return false;
+
+  location_t locus = expr.get_locus ();
+  tree switch_cond = NULL_TREE;
+  switch (scrutinee_tyty->get_kind ())
+    {
+    case TyTy::TypeKind::INT:
+    case TyTy::TypeKind::UINT:
+    case TyTy::TypeKind::USIZE:
+    case TyTy::TypeKind::ISIZE:
+    case TyTy::TypeKind::CHAR:
+      switch_cond = match_scrutinee_expr;
+      break;
+
+    case TyTy::TypeKind::ADT:
+      if (static_cast<TyTy::ADTType *> (scrutinee_tyty)->is_enum ())
+	{
+	  // every variant record starts with the discriminant
+	  tree variant_record
+	    = Backend::struct_field_expression (match_scrutinee_expr, 0, locus);
+	  switch_cond
+	    = Backend::struct_field_expression (variant_record, 0, locus);
+	}
+      break;
+
+    case TyTy::TypeKind::REF:
+      // string literals are grouped by length, then compared bytewise
+      if (static_cast<TyTy::ReferenceType *> (scrutinee_tyty)
+	    ->is_dyn_str_type ())
+	switch_cond
+	  = Backend::struct_field_expression (match_scrutinee_expr, 1, locus);
+      break;
+
+    default:
+      break;
+    }
+  if (switch_cond == NULL_TREE || switch_cond == error_mark_node)
+    return false;
+
+  struct SwitchArm
+  {
+    HIR::MatchCase *kase;
+    HIR::Pattern *pattern;
+    bool is_default;
+    // the sub-test left once the switch picked one of the labels
+    tree check_expr;
+    tree label;
+  };
+
+  std::vector<SwitchArm> arms;
+  std::vector<std::vector<CompilePatternCaseLabels::CaseRange>> labels;
+  bool seen_default = false;
+  for (auto &kase : expr.get_match_cases ())
+    {
+      if (kase.get_arm ().has_match_arm_guard ())
+	return false;
+
+      for (auto &pattern : kase.get_arm ().get_patterns ())
+	{
+	  // only the first arm matching a value is taken
+	  if (seen_default)
+	    return false;
+
+	  SwitchArm arm = {&kase, pattern.get (), false, NULL_TREE, NULL_TREE};
+	  labels.emplace_back ();
+	  if (!CompilePatternCaseLabels::Compile (pattern.get (),
+						  match_scrutinee_expr, ctx,
+						  labels.back (), arm.is_default,
+						  arm.check_expr))
+	    return false;
+
+	  seen_default = arm.is_default;
+	  arms.push_back (std::move (arm));
+	}
+    }
+
+  tree cond_type = TREE_TYPE (switch_cond);
+  // overlapping labels are left to the chain of checks
+  std::vector<CompilePatternCaseLabels::SwitchCase> cases;
+  if (!CompilePatternCaseLabels::sort_cases (cond_type, labels, cases))
+    return false;
+
+  tree fndecl = ctx->peek_fn ().fndecl;
+  for (auto &arm : arms)
+    arm.label = Backend::label (fndecl, "", arm.pattern->get_locus ());
+
+  auto goto_label = [] (tree label, location_t locus) {
+    return build1_loc (locus, GOTO_EXPR, void_type_node, label);
+  };
+
+  tree switch_body = Backend::block (fndecl, ctx->peek_enclosing_scope (), {},
+				     locus, locus);
+  ctx->push_block (switch_body);
+  for (auto &c : cases)
+    {
+      tree high = tree_int_cst_equal (c.low, c.high) ? NULL_TREE : c.high;
+      ctx->add_statement (
+	build_case_label (c.low, high, create_artificial_label (locus)));
+
+      // a catch-all is always the last arm
+      std::vector<size_t> candidates = c.arms;
+      if (seen_default)
+	candidates.push_back (arms.size () - 1);
+
+      bool exhausted = false;
+      for (size_t i : candidates)
+	{
+	  SwitchArm &arm = arms[i];
+	  location_t arm_locus = arm.pattern->get_locus ();
+	  if (arm.check_expr == NULL_TREE)
+	    {
+	      ctx->add_statement (goto_label (arm.label, arm_locus));
+	      exhausted = true;
+	      break;
+	    }
+
+	  ctx->add_statement (
+	    Backend::if_statement (NULL_TREE, arm.check_expr,
+				   goto_label (arm.label, arm_locus), NULL_TREE,
+				   arm_locus));
+	}
+      if (!exhausted)
+	ctx->add_statement (goto_label (end_label, locus));
+    }
+  if (seen_default)
+    {
+      SwitchArm &arm = arms.back ();
+      ctx->add_statement (build_case_label (NULL_TREE, NULL_TREE,
+					    create_artificial_label (locus)));
+      ctx->add_statement (goto_label (arm.label, arm.pattern->get_locus ()));
+    }
+  ctx->pop_block ();
+
+  ctx->add_statement (
+    build2_loc (locus, SWITCH_EXPR, cond_type, switch_cond, switch_body));
+  ctx->add_statement (goto_label (end_label, locus));
+
+  for (auto &arm : arms)
+    {
+      ctx->add_statement (Backend::label_definition_statement (arm.label));
+      ctx->add_statement (compile_match_arm (*arm.kase, *arm.pattern,
+					     match_scrutinee_expr, result,
+					     end_label));
+    }
+
+  return true;
+}
+
 void
 CompileExpr::visit (HIR::MatchExpr &expr)
 {
-  // https://gcc.gnu.org/onlinedocs/gccint/Basic-Statements.html#Basic-Statements
-  // TODO
-  // SWITCH_ALL_CASES_P is true if the switch includes a default label or the
-  // case label ranges cover all possible values of the condition expression
-
   TyTy::TypeKind scrutinee_kind = check_match_scrutinee (expr, ctx);
   if (scrutinee_kind == TyTy::TypeKind::ERROR)
     {
@@ -1045,55 +1259,30 @@ CompileExpr::visit (HIR::MatchExpr &expr)
   tree end_label_decl_statement
     = Backend::label_definition_statement (end_label);
 
-  for (auto &kase : expr.get_match_cases ())
-    {
-      // for now lets just get single pattern's working
-      HIR::MatchArm &kase_arm = kase.get_arm ();
-      rust_assert (kase_arm.get_patterns ().size () > 0);
+  if (!compile_match_switch (expr, match_scrutinee_expr, tmp, end_label))
+    for (auto &kase : expr.get_match_cases ())
+      {
+	// for now lets just get single pattern's working
+	HIR::MatchArm &kase_arm = kase.get_arm ();
+	rust_assert (kase_arm.get_patterns ().size () > 0);
 
-      for (auto &kase_pattern : kase_arm.get_patterns ())
-	{
-	  // setup the match-arm-body-block
-	  location_t start_location = UNKNOWN_LOCATION; // FIXME
-	  location_t end_location = UNKNOWN_LOCATION;	// FIXME
-	  tree arm_body_block = Backend::block (fndecl, enclosing_scope, {},
-						start_location, end_location);
-
-	  ctx->push_block (arm_body_block);
-
-	  // setup the bindings for the block
-	  CompilePatternBindings::Compile (kase_pattern.get (),
-					   match_scrutinee_expr, ctx);
-
-	  // compile the expr and setup the assignment if required when tmp !=
-	  // NULL
-	  location_t arm_locus = kase_arm.get_locus ();
-	  tree kase_expr_tree
-	    = CompileExpr::Compile (kase.get_expr ().get (), ctx);
-	  tree result_reference = Backend::var_expression (tmp, arm_locus);
-	  tree assignment
-	    = Backend::assignment_statement (result_reference, kase_expr_tree,
-					     arm_locus);
-	  ctx->add_statement (assignment);
-
-	  // go to end label
-	  tree goto_end_label
-	    = build1_loc (arm_locus, GOTO_EXPR, void_type_node, end_label);
-	  ctx->add_statement (goto_end_label);
-
-	  ctx->pop_block ();
-
-	  tree check_expr
-	    = CompilePatternCheckExpr::Compile (kase_pattern.get (),
-						match_scrutinee_expr, ctx);
-
-	  tree check_stmt
-	    = Backend::if_statement (NULL_TREE, check_expr, arm_body_block,
-				     NULL_TREE, kase_pattern->get_locus ());
-
-	  ctx->add_statement (check_stmt);
-	}
-    }
+	for (auto &kase_pattern : kase_arm.get_patterns ())
+	  {
+	    tree arm_body_block
+	      = compile_match_arm (kase, *kase_pattern, match_scrutinee_expr,
+				   tmp, end_label);
+
+	    tree check_expr
+	      = CompilePatternCheckExpr::Compile (kase_pattern.get (),
+						  match_scrutinee_expr, ctx);
+
+	    tree check_stmt
+	      = Backend::if_statement (NULL_TREE, check_expr, arm_body_block,
+				       NULL_TREE, kase_pattern->get_locus ());
+
+	    ctx->add_statement (check_stmt);
+	  }
+      }
 
   // setup the switch expression
   ctx->add_statement (end_label_decl_statement);
@@ -1215,6 +1404,22 @@ CompileExpr::visit (HIR::CallExpr &expr)
     return true;
   };
 
+  // intrinsics only depending on their generic arguments, such as size_of,
+  // are replaced by their value instead of being called
+  if (tyty->get_kind () == TyTy::TypeKind::FNDEF)
+    {
+      TyTy::FnType *fn = static_cast<TyTy::FnType *> (tyty);
+      if (fn->get_abi () == ABI::INTRINSIC)
+	{
+	  tree folded = Intrinsics (ctx).fold_call (fn);
+	  if (folded != NULL_TREE)
+	    {
+	      translated = folded;
+	      return;
+	    }
+	}
+    }
+
   auto fn_address = CompileExpr::Compile (expr.get_fnexpr ().get (), ctx);
 
   // is this a closure call?
@@ -1323,10 +1528,9 @@ CompileExpr::visit (HIR::MethodCallExpr &expr)
   // lookup the autoderef mappings
   HirId autoderef_mappings_id
     = expr.get_receiver ()->get_mappings ().get_hirid ();
-  std::vector<Resolver::Adjustment> *adjustments = nullptr;
-  ok = ctx->get_tyctx ()->lookup_autoderef_mappings (autoderef_mappings_id,
-						     &adjustments);
-  rust_assert (ok);
+  auto adjustments
+    = ctx->get_tyctx ()->lookup_autoderef_mappings (autoderef_mappings_id);
+  rust_assert (adjustments);
 
   // apply adjustments for the fn call
   self = resolve_adjustements (*adjustments, self,
@@ -1398,9 +1602,10 @@ CompileExpr::get_fn_addr_from_dyn (const TyTy::DynamicObjectType *dyn,
 
   tree vtable_ptr
     = Backend::struct_field_expression (receiver_ref, 1, expr_locus);
+  tree vtable = build_fold_indirect_ref_loc (expr_locus, vtable_ptr);
   tree vtable_array_access
-    = build4_loc (expr_locus, ARRAY_REF, TREE_TYPE (TREE_TYPE (vtable_ptr)),
-		  vtable_ptr, idx, NULL_TREE, NULL_TREE);
+    = build4_loc (expr_locus, ARRAY_REF, TREE_TYPE (TREE_TYPE (vtable)),
+		  vtable, idx, NULL_TREE, NULL_TREE);
 
   tree vcall = build3_loc (expr_locus, OBJ_TYPE_REF, expected_fntype,
 			   vtable_array_access, receiver_ref, idx);
@@ -1447,10 +1652,9 @@ CompileExpr::resolve_operator_overload (LangItem::Kind lang_item_type,
   tree fn_expr = resolve_method_address (fntype, receiver, expr.get_locus ());
 
   // lookup the autoderef mappings
-  std::vector<Resolver::Adjustment> *adjustments = nullptr;
-  ok = ctx->get_tyctx ()->lookup_autoderef_mappings (
-    expr.get_lvalue_mappings ().get_hirid (), &adjustments);
-  rust_assert (ok);
+  auto adjustments = ctx->get_tyctx ()->lookup_autoderef_mappings (
+    expr.get_lvalue_mappings ().get_hirid ());
+  rust_assert (adjustments);
 
   // apply adjustments for the fn call
   tree self = resolve_adjustements (*adjustments, lhs, lhs_expr->get_locus ());
@@ -1469,7 +1673,7 @@ CompileExpr::compile_bool_literal (const HIR::LiteralExpr &expr,
 {
   rust_assert (expr.get_lit_type () == HIR::Literal::BOOL);
 
-  const auto literal_value = expr.get_literal ();
+  const auto &literal_value = expr.get_literal ();
   bool bval = literal_value.as_string ().compare ("true") == 0;
   return Backend::boolean_constant_expression (bval);
 }
@@ -1479,10 +1683,26 @@ CompileExpr::compile_integer_literal (const HIR::LiteralExpr &expr,
 				      const TyTy::BaseType *tyty)
 {
   rust_assert (expr.get_lit_type () == HIR::Literal::INT);
-  const auto literal_value = expr.get_literal ();
+  const auto &literal_value = expr.get_literal ();
 
   tree type = TyTyResolveCompile::compile (ctx, tyty);
 
+  // the common case: the value was already parsed when it was lowered
+  auto int_value = literal_value.get_int_value ();
+  if (int_value.has_value () && INTEGRAL_TYPE_P (type))
+    {
+      if (wi::gtu_p (int_value.value (), wi::to_widest (TYPE_MAX_VALUE (type))))
+	{
+	  rust_error_at (expr.get_locus (),
+			 "integer overflows the respective type %<%s%>",
+			 tyty->get_name ().c_str ());
+	  return error_mark_node;
+	}
+
+      return wide_int_to_tree (type, wi::uhwi (int_value.value (),
+					       TYPE_PRECISION (type)));
+    }
+
   mpz_t ival;
   if (mpz_init_set_str (ival, literal_value.as_string ().c_str (), 10) != 0)
     {
@@ -1518,7 +1738,7 @@ CompileExpr::compile_float_literal (const HIR::LiteralExpr &expr,
 				    const TyTy::BaseType *tyty)
 {
   rust_assert (expr.get_lit_type () == HIR::Literal::FLOAT);
-  const auto literal_value = expr.get_literal ();
+  const auto &literal_value = expr.get_literal ();
 
   mpfr_t fval;
   if (mpfr_init_set_str (fval, literal_value.as_string ().c_str (), 10,
@@ -1558,7 +1778,7 @@ CompileExpr::compile_char_literal (const HIR::LiteralExpr &expr,
 				   const TyTy::BaseType *tyty)
 {
   rust_assert (expr.get_lit_type () == HIR::Literal::CHAR);
-  const auto literal_value = expr.get_literal ();
+  const auto &literal_value = expr.get_literal ();
 
   // FIXME needs wchar_t
   char c = literal_value.as_string ().c_str ()[0];
@@ -1570,7 +1790,7 @@ CompileExpr::compile_byte_literal (const HIR::LiteralExpr &expr,
 				   const TyTy::BaseType *tyty)
 {
   rust_assert (expr.get_lit_type () == HIR::Literal::BYTE);
-  const auto literal_value = expr.get_literal ();
+  const auto &literal_value = expr.get_literal ();
 
   tree type = TyTyResolveCompile::compile (ctx, tyty);
   char c = literal_value.as_string ().c_str ()[0];
@@ -1584,9 +1804,15 @@ CompileExpr::compile_string_literal (const HIR::LiteralExpr &expr,
   tree fat_pointer = TyTyResolveCompile::compile (ctx, tyty);
 
   rust_assert (expr.get_lit_type () == HIR::Literal::STRING);
-  const auto literal_value = expr.get_literal ();
+  const auto &literal_value = expr.get_literal ();
 
-  auto base = Backend::string_constant_expression (literal_value.as_string ());
+  const std::string &value = literal_value.as_string ();
+  tree base = ctx->lookup_string_literal (value, NULL_TREE);
+  if (base == NULL_TREE)
+    {
+      base = Backend::string_constant_expression (value);
+      ctx->insert_string_literal (value, NULL_TREE, base);
+    }
   tree data = address_expression (base, expr.get_locus ());
 
   TyTy::BaseType *usize = nullptr;
@@ -1613,22 +1839,19 @@ CompileExpr::compile_byte_string_literal (const HIR::LiteralExpr &expr,
   rust_assert (base_tyty->get_kind () == TyTy::TypeKind::ARRAY);
   auto array_tyty = static_cast<TyTy::ArrayType *> (base_tyty);
 
-  std::string value_str = expr.get_literal ().as_string ();
-  std::vector<tree> vals;
-  std::vector<unsigned long> indexes;
-  for (size_t i = 0; i < value_str.size (); i++)
+  // a single STRING_CST of the array type, rather than a constructor with an
+  // element per byte, so that large literals such as the ones produced by
+  // include_bytes! stay cheap
+  const std::string &value_str = expr.get_literal ().as_string ();
+  tree array_type = TyTyResolveCompile::compile (ctx, array_tyty);
+  tree constructed = ctx->lookup_string_literal (value_str, array_type);
+  if (constructed == NULL_TREE)
     {
-      char b = value_str.at (i);
-      tree bb = Backend::char_constant_expression (b);
-      vals.push_back (bb);
-      indexes.push_back (i);
+      constructed = build_string (value_str.size (), value_str.data ());
+      TREE_TYPE (constructed) = array_type;
+      ctx->insert_string_literal (value_str, array_type, constructed);
     }
 
-  tree array_type = TyTyResolveCompile::compile (ctx, array_tyty);
-  tree constructed
-    = Backend::array_constructor_expression (array_type, indexes, vals,
-					     expr.get_locus ());
-
   return address_expression (constructed, expr.get_locus ());
 }
 
@@ -1800,33 +2023,12 @@ CompileExpr::array_copied_expr (location_t expr_locus,
   tree translated_expr
     = CompileExpr::Compile (elems.get_elem_to_copy ().get (), ctx);
 
-  tree max_domain = TYPE_MAX_VALUE (domain);
-  tree min_domain = TYPE_MIN_VALUE (domain);
-
-  auto max = wi::to_offset (max_domain);
-  auto min = wi::to_offset (min_domain);
-  auto precision = TYPE_PRECISION (TREE_TYPE (domain));
-  auto sign = TYPE_SIGN (TREE_TYPE (domain));
-  unsigned HOST_WIDE_INT len
-    = wi::ext (max - min + 1, precision, sign).to_uhwi ();
-
-  // In a const context we must initialize the entire array, which entails
-  // allocating for each element. If the user wants a huge array, we will OOM
-  // and die horribly.
+  // In a const context we must initialize the entire array. A single
+  // element ranging over all of its indexes does that whatever the length.
   if (ctx->const_context_p ())
-    {
-      size_t idx = 0;
-      std::vector<unsigned long> indexes;
-      std::vector<tree> constructor;
-      for (unsigned HOST_WIDE_INT i = 0; i < len; i++)
-	{
-	  constructor.push_back (translated_expr);
-	  indexes.push_back (idx++);
-	}
-
-      return Backend::array_constructor_expression (array_type, indexes,
-						    constructor, expr_locus);
-    }
+    return Backend::array_repeat_constructor_expression (array_type,
+							 translated_expr,
+							 expr_locus);
 
   else
     {
@@ -1850,15 +2052,14 @@ CompileExpr::array_copied_expr (location_t expr_locus,
       tree block = ctx->pop_block ();
 
       // The result is a compound expression which creates a temporary array,
-      // initializes all the elements in a loop, and then yeilds the array.
+      // initializes all the elements, and then yields the array.
       return Backend::compound_expression (block, tmp, expr_locus);
     }
 }
 
 tree
-HIRCompileBase::resolve_adjustements (
-  std::vector<Resolver::Adjustment> &adjustments, tree expression,
-  location_t locus)
+HIRCompileBase::resolve_adjustements (Resolver::AdjustmentSpan adjustments,
+				     tree expression, location_t locus)
 {
   tree e = expression;
   for (auto &adjustment : adjustments)
@@ -2152,8 +2353,14 @@ CompileExpr::visit (HIR::ArrayIndexExpr &expr)
 	= indirect_expression (array_reference, expr.get_locus ());
     }
 
-  translated = Backend::array_index_expression (array_reference, index,
-						expr.get_locus ());
+  // accesses in constant contexts are left to the constant evaluator
+  if (ctx->in_fn () && !ctx->const_context_p ())
+    translated
+      = Backend::array_index_expression_checked (array_reference, index,
+						 expr.get_locus ());
+  else
+    translated = Backend::array_index_expression (array_reference, index,
+						  expr.get_locus ());
 }
 
 void
@@ -2232,6 +2439,13 @@ CompileExpr::generate_closure_function (HIR::ClosureExpr &expr,
   tree fndecl = Backend::function (compiled_fn_type, ir_symbol_name, asm_name,
 				   flags, expr.get_locus ());
 
+  // Closures are mostly small and called from the one generic function they
+  // are passed to, make them candidates for inlining there like #[inline]
+  // functions. This also gives each codegen unit using one its own copy.
+  DECL_DECLARED_INLINE_P (fndecl) = 1;
+
+  ctx->place_function (fndecl, path, true);
+
   // insert into the context
   ctx->insert_function_decl (fn_tyty, fndecl);
   ctx->insert_closure_decl (&closure_tyty, fndecl);
@@ -2460,10 +2674,9 @@ CompileExpr::generate_possible_fn_trait_call (HIR::CallExpr &expr,
   // need to apply any autoderef's to the self argument
   HIR::Expr *fnexpr = expr.get_fnexpr ().get ();
   HirId autoderef_mappings_id = fnexpr->get_mappings ().get_hirid ();
-  std::vector<Resolver::Adjustment> *adjustments = nullptr;
-  bool ok = ctx->get_tyctx ()->lookup_autoderef_mappings (autoderef_mappings_id,
-							  &adjustments);
-  rust_assert (ok);
+  auto adjustments
+    = ctx->get_tyctx ()->lookup_autoderef_mappings (autoderef_mappings_id);
+  rust_assert (adjustments);
 
   // apply adjustments for the fn call
   tree self = resolve_adjustements (*adjustments, receiver, expr.get_locus ());
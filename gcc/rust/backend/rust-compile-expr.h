@@ -83,6 +83,8 @@ public:
   void visit (HIR::AwaitExpr &) override {}
   void visit (HIR::AsyncBlockExpr &) override {}
 
+  void visit (HIR::InlineAsm &expr) override;
+
   // nothing to do for these
   void visit (HIR::StructExprFieldIdentifier &) override {}
   void visit (HIR::StructExprFieldIdentifierValue &) override {}
@@ -133,6 +135,13 @@ protected:
 			  const TyTy::ArrayType &array_tyty, tree array_type,
 			  HIR::ArrayElemsCopied &elems);
 
+  tree compile_match_arm (HIR::MatchCase &kase, HIR::Pattern &pattern,
+			  tree match_scrutinee_expr, Bvariable *result,
+			  tree end_label);
+
+  bool compile_match_switch (HIR::MatchExpr &expr, tree match_scrutinee_expr,
+			     Bvariable *result, tree end_label);
+
 protected:
   tree generate_closure_function (HIR::ClosureExpr &expr,
 				  TyTy::ClosureType &closure_tyty,
@@ -146,6 +146,7 @@ public:
 				     flags, function.get_locus ());
     TREE_PUBLIC (fndecl) = 1;
     setup_abi_options (fndecl, fntype->get_abi ());
+    setup_diverging_fndecl (fndecl, fntype);
 
     ctx->insert_function_decl (fntype, fndecl);
 
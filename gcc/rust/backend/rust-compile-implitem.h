@@ -33,7 +33,7 @@ public:
 		       bool is_query_mode = false,
 		       location_t ref_locus = UNDEF_LOCATION)
   {
-    CompileInherentImplItem compiler (ctx, concrete, ref_locus);
+    CompileInherentImplItem compiler (ctx, concrete, is_query_mode, ref_locus);
     item->accept_vis (compiler);
 
     if (is_query_mode && compiler.reference == error_mark_node)
@@ -45,8 +45,8 @@ public:
 
 private:
   CompileInherentImplItem (Context *ctx, TyTy::BaseType *concrete,
-			   location_t ref_locus)
-    : CompileItem (ctx, concrete, ref_locus)
+			   bool is_query_mode, location_t ref_locus)
+    : CompileItem (ctx, concrete, is_query_mode, ref_locus)
   {}
 };
 
@@ -23,6 +23,7 @@
 #include "rust-diagnostics.h"
 #include "rust-location.h"
 #include "rust-constexpr.h"
+#include "rust-type-util.h"
 #include "rust-tree.h"
 #include "tree-core.h"
 #include "rust-gcc.h"
@@ -77,7 +78,7 @@ check_for_basic_integer_type (const std::string &intrinsic_str,
 static tree
 offset_handler (Context *ctx, TyTy::FnType *fntype);
 static tree
-sizeof_handler (Context *ctx, TyTy::FnType *fntype);
+type_property_handler (Context *ctx, TyTy::FnType *fntype);
 static tree
 transmute_handler (Context *ctx, TyTy::FnType *fntype);
 static tree
@@ -87,6 +88,10 @@ wrapping_op_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op);
 static tree
 op_with_overflow_inner (Context *ctx, TyTy::FnType *fntype, tree_code op);
 static tree
+saturating_op_inner (Context *ctx, TyTy::FnType *fntype, tree_code op);
+static tree
+exact_div_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
 uninit_handler (Context *ctx, TyTy::FnType *fntype);
 static tree
 move_val_init_handler (Context *ctx, TyTy::FnType *fntype);
@@ -102,6 +107,28 @@ enum class Prefetch
 static tree
 prefetch_data_handler (Context *ctx, TyTy::FnType *fntype, Prefetch kind);
 
+enum class BitOp
+{
+  Ctpop,
+  Ctlz,
+  CtlzNonzero,
+  Cttz,
+  CttzNonzero,
+  Bswap,
+  Bitreverse
+};
+
+static tree
+bit_op_handler (Context *ctx, TyTy::FnType *fntype, BitOp op);
+
+const static std::function<tree (Context *, TyTy::FnType *)>
+bit_op_handler (BitOp op)
+{
+  return [op] (Context *ctx, TyTy::FnType *fntype) {
+    return bit_op_handler (ctx, fntype, op);
+  };
+}
+
 static inline tree
 rotate_left_handler (Context *ctx, TyTy::FnType *fntype)
 {
@@ -161,6 +188,19 @@ atomic_load_handler (int ordering)
   };
 }
 
+static tree
+atomic_rmw_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			  const std::string &builtin_prefix, int ordering);
+static tree
+atomic_cxchg_handler_inner (Context *ctx, TyTy::FnType *fntype, bool weak,
+			    int success, int failure);
+static tree
+atomic_fence_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			    const char *builtin_name, int ordering);
+static tree
+atomic_minmax_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op,
+			     bool is_unsigned, int ordering);
+
 static inline tree
 unchecked_op_inner (Context *ctx, TyTy::FnType *fntype, tree_code op);
 
@@ -172,6 +212,17 @@ unchecked_op_handler (tree_code op)
   };
 }
 
+static tree
+float_fast_op_inner (Context *ctx, TyTy::FnType *fntype, tree_code op);
+
+const static std::function<tree (Context *, TyTy::FnType *)>
+float_fast_op_handler (tree_code op)
+{
+  return [op] (Context *ctx, TyTy::FnType *fntype) {
+    return float_fast_op_inner (ctx, fntype, op);
+  };
+}
+
 static inline tree
 copy_handler_inner (Context *ctx, TyTy::FnType *fntype, bool overlaps);
 
@@ -183,6 +234,29 @@ copy_handler (bool overlaps)
   };
 }
 
+static tree
+write_bytes_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			   bool is_volatile);
+
+const static std::function<tree (Context *, TyTy::FnType *)>
+write_bytes_handler (bool is_volatile)
+{
+  return [is_volatile] (Context *ctx, TyTy::FnType *fntype) {
+    return write_bytes_handler_inner (ctx, fntype, is_volatile);
+  };
+}
+
+static tree
+volatile_load_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+volatile_store_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+black_box_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+raw_eq_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+uniform_integer_fields_handler (Context *ctx, TyTy::FnType *fntype);
+
 static inline tree
 expect_handler_inner (Context *ctx, TyTy::FnType *fntype, bool likely);
 
@@ -194,6 +268,54 @@ expect_handler (bool likely)
   };
 }
 
+static tree
+simd_binary_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op);
+static tree
+simd_comparison_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			       tree_code op);
+static tree
+simd_reduce_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op,
+			   bool ordered);
+static tree
+simd_neg_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+simd_extract_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+simd_insert_handler (Context *ctx, TyTy::FnType *fntype);
+static tree
+simd_shuffle_handler (Context *ctx, TyTy::FnType *fntype);
+
+const static std::function<tree (Context *, TyTy::FnType *)>
+simd_binary_handler (tree_code op)
+{
+  return [op] (Context *ctx, TyTy::FnType *fntype) {
+    return simd_binary_handler_inner (ctx, fntype, op);
+  };
+}
+
+const static std::function<tree (Context *, TyTy::FnType *)>
+simd_comparison_handler (tree_code op)
+{
+  return [op] (Context *ctx, TyTy::FnType *fntype) {
+    return simd_comparison_handler_inner (ctx, fntype, op);
+  };
+}
+
+const static std::function<tree (Context *, TyTy::FnType *)>
+saturating_op_handler (tree_code op)
+{
+  return [op] (Context *ctx, TyTy::FnType *fntype) {
+    return saturating_op_inner (ctx, fntype, op);
+  };
+}
+const static std::function<tree (Context *, TyTy::FnType *)>
+simd_reduce_handler (tree_code op, bool ordered = false)
+{
+  return [op, ordered] (Context *ctx, TyTy::FnType *fntype) {
+    return simd_reduce_handler_inner (ctx, fntype, op, ordered);
+  };
+}
+
 inline tree
 sorry_handler (Context *ctx, TyTy::FnType *fntype)
 {
@@ -207,18 +329,38 @@ static const std::map<std::string,
 		      std::function<tree (Context *, TyTy::FnType *)>>
   generic_intrinsics = {
     {"offset", offset_handler},
-    {"size_of", sizeof_handler},
+    {"size_of", type_property_handler},
+    {"min_align_of", type_property_handler},
+    {"pref_align_of", type_property_handler},
+    {"needs_drop", type_property_handler},
     {"transmute", transmute_handler},
     {"rotate_left", rotate_left_handler},
     {"rotate_right", rotate_right_handler},
+    {"ctpop", bit_op_handler (BitOp::Ctpop)},
+    {"ctlz", bit_op_handler (BitOp::Ctlz)},
+    {"ctlz_nonzero", bit_op_handler (BitOp::CtlzNonzero)},
+    {"cttz", bit_op_handler (BitOp::Cttz)},
+    {"cttz_nonzero", bit_op_handler (BitOp::CttzNonzero)},
+    {"bswap", bit_op_handler (BitOp::Bswap)},
+    {"bitreverse", bit_op_handler (BitOp::Bitreverse)},
     {"wrapping_add", wrapping_op_handler (PLUS_EXPR)},
     {"wrapping_sub", wrapping_op_handler (MINUS_EXPR)},
     {"wrapping_mul", wrapping_op_handler (MULT_EXPR)},
     {"add_with_overflow", op_with_overflow (PLUS_EXPR)},
     {"sub_with_overflow", op_with_overflow (MINUS_EXPR)},
     {"mul_with_overflow", op_with_overflow (MULT_EXPR)},
+    {"saturating_add", saturating_op_handler (PLUS_EXPR)},
+    {"saturating_sub", saturating_op_handler (MINUS_EXPR)},
+    {"exact_div", exact_div_handler},
     {"copy", copy_handler (true)},
     {"copy_nonoverlapping", copy_handler (false)},
+    {"write_bytes", write_bytes_handler (false)},
+    {"volatile_set_memory", write_bytes_handler (true)},
+    {"volatile_load", volatile_load_handler},
+    {"volatile_store", volatile_store_handler},
+    {"black_box", black_box_handler},
+    {"raw_eq", raw_eq_handler},
+    {"has_uniform_integer_fields", uniform_integer_fields_handler},
     {"prefetch_read_data", prefetch_read_data},
     {"prefetch_write_data", prefetch_write_data},
     {"atomic_store_seqcst", atomic_store_handler (__ATOMIC_SEQ_CST)},
@@ -236,13 +378,152 @@ static const std::map<std::string,
     {"unchecked_rem", unchecked_op_handler (TRUNC_MOD_EXPR)},
     {"unchecked_shl", unchecked_op_handler (LSHIFT_EXPR)},
     {"unchecked_shr", unchecked_op_handler (RSHIFT_EXPR)},
+    {"fadd_fast", float_fast_op_handler (PLUS_EXPR)},
+    {"fsub_fast", float_fast_op_handler (MINUS_EXPR)},
+    {"fmul_fast", float_fast_op_handler (MULT_EXPR)},
+    {"fdiv_fast", float_fast_op_handler (RDIV_EXPR)},
+    {"frem_fast", float_fast_op_handler (TRUNC_MOD_EXPR)},
     {"uninit", uninit_handler},
     {"move_val_init", move_val_init_handler},
     {"likely", expect_handler (true)},
     {"unlikely", expect_handler (false)},
     {"assume", assume_handler},
+    {"simd_add", simd_binary_handler (PLUS_EXPR)},
+    {"simd_sub", simd_binary_handler (MINUS_EXPR)},
+    {"simd_mul", simd_binary_handler (MULT_EXPR)},
+    {"simd_div", simd_binary_handler (TRUNC_DIV_EXPR)},
+    {"simd_rem", simd_binary_handler (TRUNC_MOD_EXPR)},
+    {"simd_shl", simd_binary_handler (LSHIFT_EXPR)},
+    {"simd_shr", simd_binary_handler (RSHIFT_EXPR)},
+    {"simd_and", simd_binary_handler (BIT_AND_EXPR)},
+    {"simd_or", simd_binary_handler (BIT_IOR_EXPR)},
+    {"simd_xor", simd_binary_handler (BIT_XOR_EXPR)},
+    {"simd_neg", simd_neg_handler},
+    {"simd_eq", simd_comparison_handler (EQ_EXPR)},
+    {"simd_ne", simd_comparison_handler (NE_EXPR)},
+    {"simd_lt", simd_comparison_handler (LT_EXPR)},
+    {"simd_le", simd_comparison_handler (LE_EXPR)},
+    {"simd_gt", simd_comparison_handler (GT_EXPR)},
+    {"simd_ge", simd_comparison_handler (GE_EXPR)},
+    {"simd_extract", simd_extract_handler},
+    {"simd_insert", simd_insert_handler},
+    {"simd_shuffle", simd_shuffle_handler},
+    {"simd_shuffle2", simd_shuffle_handler},
+    {"simd_shuffle4", simd_shuffle_handler},
+    {"simd_shuffle8", simd_shuffle_handler},
+    {"simd_shuffle16", simd_shuffle_handler},
+    {"simd_shuffle32", simd_shuffle_handler},
+    {"simd_shuffle64", simd_shuffle_handler},
+    {"simd_reduce_add_ordered", simd_reduce_handler (PLUS_EXPR, true)},
+    {"simd_reduce_add_unordered", simd_reduce_handler (PLUS_EXPR)},
+    {"simd_reduce_mul_ordered", simd_reduce_handler (MULT_EXPR, true)},
+    {"simd_reduce_mul_unordered", simd_reduce_handler (MULT_EXPR)},
+    {"simd_reduce_min", simd_reduce_handler (MIN_EXPR)},
+    {"simd_reduce_max", simd_reduce_handler (MAX_EXPR)},
+    {"simd_reduce_and", simd_reduce_handler (BIT_AND_EXPR)},
+    {"simd_reduce_or", simd_reduce_handler (BIT_IOR_EXPR)},
+    {"simd_reduce_xor", simd_reduce_handler (BIT_XOR_EXPR)},
 };
 
+/**
+ * Returns the handler of the atomic read-modify-write, compare-exchange or
+ * fence intrinsic NAME. These come in one variant per memory order, or pair
+ * of memory orders, which are spelled out at the end of their name, e.g.
+ * `atomic_xadd_acqrel` or `atomic_cxchgweak_acquire_relaxed`.
+ */
+static tl::optional<std::function<tree (Context *, TyTy::FnType *)>>
+atomic_intrinsic_handler (const std::string &name)
+{
+  static const std::map<std::string, int> orderings = {
+    {"relaxed", __ATOMIC_RELAXED}, {"acquire", __ATOMIC_ACQUIRE},
+    {"release", __ATOMIC_RELEASE}, {"acqrel", __ATOMIC_ACQ_REL},
+    {"seqcst", __ATOMIC_SEQ_CST},
+  };
+  static const std::map<std::string, std::string> rmw_builtins = {
+    {"xchg", "__atomic_exchange_"}, {"xadd", "__atomic_fetch_add_"},
+    {"xsub", "__atomic_fetch_sub_"}, {"and", "__atomic_fetch_and_"},
+    {"nand", "__atomic_fetch_nand_"}, {"or", "__atomic_fetch_or_"},
+    {"xor", "__atomic_fetch_xor_"},
+  };
+
+  const std::string prefix = "atomic_";
+  if (name.compare (0, prefix.size (), prefix) != 0)
+    return tl::nullopt;
+
+  // split the rest of the name into the operation and its orderings
+  std::vector<std::string> parts;
+  size_t start = prefix.size ();
+  for (;;)
+    {
+      size_t end = name.find ('_', start);
+      parts.push_back (name.substr (start, end - start));
+      if (end == std::string::npos)
+	break;
+      start = end + 1;
+    }
+
+  const std::string &op = parts[0];
+  std::vector<int> ordering;
+  for (size_t i = 1; i < parts.size (); i++)
+    {
+      auto it = orderings.find (parts[i]);
+      if (it == orderings.end ())
+	return tl::nullopt;
+      ordering.push_back (it->second);
+    }
+
+  if (op == "cxchg" || op == "cxchgweak")
+    {
+      if (ordering.size () != 2)
+	return tl::nullopt;
+
+      bool weak = op == "cxchgweak";
+      int success = ordering[0];
+      int failure = ordering[1];
+      return std::function<tree (Context *, TyTy::FnType *)> (
+	[weak, success, failure] (Context *ctx, TyTy::FnType *fntype) {
+	  return atomic_cxchg_handler_inner (ctx, fntype, weak, success,
+					     failure);
+	});
+    }
+
+  if (ordering.size () != 1)
+    return tl::nullopt;
+
+  int order = ordering[0];
+  if (op == "fence" || op == "singlethreadfence")
+    {
+      const char *builtin = op == "fence" ? "__atomic_thread_fence"
+					   : "__atomic_signal_fence";
+      return std::function<tree (Context *, TyTy::FnType *)> (
+	[builtin, order] (Context *ctx, TyTy::FnType *fntype) {
+	  return atomic_fence_handler_inner (ctx, fntype, builtin, order);
+	});
+    }
+
+  // GCC has no builtin for these, they are compiled to a compare-exchange loop
+  if (op == "max" || op == "min" || op == "umax" || op == "umin")
+    {
+      tree_code code = (op == "max" || op == "umax") ? MAX_EXPR : MIN_EXPR;
+      bool is_unsigned = op[0] == 'u';
+      return std::function<tree (Context *, TyTy::FnType *)> (
+	[code, is_unsigned, order] (Context *ctx, TyTy::FnType *fntype) {
+	  return atomic_minmax_handler_inner (ctx, fntype, code, is_unsigned,
+					      order);
+	});
+    }
+
+  auto builtin = rmw_builtins.find (op);
+  if (builtin == rmw_builtins.end ())
+    return tl::nullopt;
+
+  const std::string &builtin_prefix = builtin->second;
+  return std::function<tree (Context *, TyTy::FnType *)> (
+    [builtin_prefix, order] (Context *ctx, TyTy::FnType *fntype) {
+      return atomic_rmw_handler_inner (ctx, fntype, builtin_prefix, order);
+    });
+}
+
 Intrinsics::Intrinsics (Context *ctx) : ctx (ctx) {}
 
 /**
@@ -269,6 +550,10 @@ Intrinsics::compile (TyTy::FnType *fntype)
   if (it != generic_intrinsics.end ())
     return it->second (ctx, fntype);
 
+  auto atomic = atomic_intrinsic_handler (fntype->get_identifier ());
+  if (atomic.has_value ())
+    return atomic.value () (ctx, fntype);
+
   location_t locus = ctx->get_mappings ().lookup_location (fntype->get_ref ());
   rust_error_at (locus, ErrorCode::E0093,
 		 "unrecognized intrinsic function: %<%s%>",
@@ -277,6 +562,21 @@ Intrinsics::compile (TyTy::FnType *fntype)
   return error_mark_node;
 }
 
+/**
+ * Returns the value of a call to the intrinsic function FNTYPE when it can be
+ * computed at compile time from its generic arguments alone, so that the call
+ * does not need to be emitted. Returns NULL_TREE otherwise.
+ *
+ * @param fntype The Rust function type of the called intrinsic
+ */
+tree
+Intrinsics::fold_call (TyTy::FnType *fntype)
+{
+  rust_assert (fntype->get_abi () == ABI::INTRINSIC);
+
+  return type_property_value (ctx, fntype);
+}
+
 /**
  * Items can be forward compiled which means we may not need to invoke this
  * code. We might also have already compiled this generic function as well.
@@ -418,11 +718,57 @@ offset_handler (Context *ctx, TyTy::FnType *fntype)
   return fndecl;
 }
 
+/**
+ * The value of the intrinsics only depending on their generic parameter, such
+ * as size_of<T>, or NULL_TREE if FNTYPE is not one of those or T is not known
+ * yet.
+ */
+static tree
+type_property_value (Context *ctx, TyTy::FnType *fntype)
+{
+  if (fntype->get_params ().size () != 0
+      || fntype->get_num_substitutions () != 1)
+    return NULL_TREE;
+
+  auto &param_mapping = fntype->get_substs ().at (0);
+  const TyTy::ParamType *param_tyty = param_mapping.get_param_ty ();
+  TyTy::BaseType *resolved_tyty = param_tyty->resolve ();
+  if (resolved_tyty->get_kind () == TyTy::TypeKind::PARAM)
+    return NULL_TREE;
+
+  tree template_parameter_type
+    = TyTyResolveCompile::compile (ctx, resolved_tyty);
+  if (template_parameter_type == error_mark_node)
+    return NULL_TREE;
+
+  tree value;
+  const std::string &name = fntype->get_identifier ();
+  if (name == "size_of")
+    {
+      // zero-sized types have no TYPE_SIZE_UNIT
+      value = TYPE_SIZE_UNIT (template_parameter_type);
+      if (value == NULL_TREE)
+	value = size_zero_node;
+    }
+  else if (name == "min_align_of" || name == "pref_align_of")
+    value = size_int (TYPE_ALIGN_UNIT (template_parameter_type));
+  else if (name == "needs_drop")
+    value = Resolver::type_needs_drop (resolved_tyty) ? boolean_true_node
+						      : boolean_false_node;
+  else
+    return NULL_TREE;
+
+  tree return_type
+    = TyTyResolveCompile::compile (ctx, fntype->get_return_type ());
+  return fold_convert (return_type, value);
+}
+
 static tree
-sizeof_handler (Context *ctx, TyTy::FnType *fntype)
+type_property_handler (Context *ctx, TyTy::FnType *fntype)
 {
-  // size_of has _zero_ parameters its parameter is the generic one
+  // these have _zero_ parameters, their parameter is the generic one
   rust_assert (fntype->get_params ().size () == 0);
+  rust_assert (fntype->get_num_substitutions () == 1);
 
   tree lookup = NULL_TREE;
   if (check_for_cached_intrinsic (ctx, fntype, &lookup))
@@ -430,22 +776,17 @@ sizeof_handler (Context *ctx, TyTy::FnType *fntype)
 
   auto fndecl = compile_intrinsic_function (ctx, fntype);
 
-  // get the template parameter type tree fn size_of<T>();
-  rust_assert (fntype->get_num_substitutions () == 1);
-  auto &param_mapping = fntype->get_substs ().at (0);
-  const TyTy::ParamType *param_tyty = param_mapping.get_param_ty ();
-  TyTy::BaseType *resolved_tyty = param_tyty->resolve ();
-  tree template_parameter_type
-    = TyTyResolveCompile::compile (ctx, resolved_tyty);
+  tree value = type_property_value (ctx, fntype);
+  if (value == NULL_TREE)
+    return error_mark_node;
 
   enter_intrinsic_block (ctx, fndecl);
 
-  // BUILTIN size_of FN BODY BEGIN
-  tree size_expr = TYPE_SIZE_UNIT (template_parameter_type);
+  // BUILTIN type property FN BODY BEGIN
   auto return_statement
-    = Backend::return_statement (fndecl, size_expr, UNDEF_LOCATION);
+    = Backend::return_statement (fndecl, value, UNDEF_LOCATION);
   ctx->add_statement (return_statement);
-  // BUILTIN size_of FN BODY END
+  // BUILTIN type property FN BODY END
 
   finalize_intrinsic_block (ctx, fndecl);
 
@@ -564,6 +905,226 @@ rotate_handler (Context *ctx, TyTy::FnType *fntype, tree_code op)
   return fndecl;
 }
 
+// Call the GCC builtin NAME on ARG, converted to the builtin's parameter type
+static tree
+call_bit_builtin (const std::string &name, tree arg)
+{
+  tree builtin = NULL_TREE;
+  BuiltinsContext::get ().lookup_simple_builtin (name, &builtin);
+  rust_assert (builtin);
+
+  tree param_type = TREE_VALUE (TYPE_ARG_TYPES (TREE_TYPE (builtin)));
+  return build_call_expr_loc (BUILTINS_LOCATION, builtin, 1,
+			      fold_convert (param_type, arg));
+}
+
+/**
+ * Count the bits of X, a zero-extended `unsigned long long` whose value has
+ * PRECISION significant bits, as an `int`. Counting the leading or trailing
+ * zeros of zero is only checked for when NONZERO is false, the builtins are
+ * undefined for it.
+ */
+static tree
+build_bit_count (BitOp op, tree x, unsigned precision, bool nonzero)
+{
+  if (op == BitOp::Ctpop)
+    return call_bit_builtin ("__builtin_popcountll", x);
+
+  tree count;
+  if (op == BitOp::Ctlz || op == BitOp::CtlzNonzero)
+    {
+      // the zero bits the value was extended with are counted too
+      tree extension
+	= build_int_cst (integer_type_node,
+			 TYPE_PRECISION (TREE_TYPE (x)) - precision);
+      count = fold_build2 (MINUS_EXPR, integer_type_node,
+			   call_bit_builtin ("__builtin_clzll", x), extension);
+    }
+  else
+    {
+      rust_assert (op == BitOp::Cttz || op == BitOp::CttzNonzero);
+      count = call_bit_builtin ("__builtin_ctzll", x);
+    }
+
+  if (nonzero)
+    return count;
+
+  tree is_zero = fold_build2 (EQ_EXPR, boolean_type_node, x,
+			      build_zero_cst (TREE_TYPE (x)));
+  return fold_build3 (COND_EXPR, integer_type_node, is_zero,
+		      build_int_cst (integer_type_node, precision), count);
+}
+
+/**
+ * Count the bits of X, an unsigned integer of 128 bits or less, as an `int`.
+ * 128-bit integers are split in two halves since GCC has no 128-bit variant of
+ * the bit counting builtins.
+ */
+static tree
+build_wide_bit_count (BitOp op, tree x)
+{
+  bool nonzero = op == BitOp::CtlzNonzero || op == BitOp::CttzNonzero;
+  unsigned precision = TYPE_PRECISION (TREE_TYPE (x));
+  tree ull = long_long_unsigned_type_node;
+  unsigned half = TYPE_PRECISION (ull);
+
+  if (precision <= half)
+    return build_bit_count (op, fold_convert (ull, x), precision, nonzero);
+
+  rust_assert (precision == 2 * half);
+  tree shift = build_int_cst (integer_type_node, half);
+  tree hi = fold_convert (ull, fold_build2 (RSHIFT_EXPR, TREE_TYPE (x), x,
+					    shift));
+  tree lo = fold_convert (ull, x);
+
+  if (op == BitOp::Ctpop)
+    return fold_build2 (PLUS_EXPR, integer_type_node,
+			build_bit_count (op, hi, half, true),
+			build_bit_count (op, lo, half, true));
+
+  // the first half to be counted, and the one the count continues in when the
+  // first half is zero
+  bool leading = op == BitOp::Ctlz || op == BitOp::CtlzNonzero;
+  tree first = leading ? hi : lo;
+  tree second = leading ? lo : hi;
+
+  tree first_is_zero
+    = fold_build2 (EQ_EXPR, boolean_type_node, first, build_zero_cst (ull));
+  tree continued
+    = fold_build2 (PLUS_EXPR, integer_type_node,
+		   build_int_cst (integer_type_node, half),
+		   build_bit_count (op, second, half, nonzero));
+
+  return fold_build3 (COND_EXPR, integer_type_node, first_is_zero, continued,
+		      build_bit_count (op, first, half, true));
+}
+
+// Swap the bytes of X, an unsigned integer of 8, 16, 32, 64 or 128 bits
+static tree
+build_bswap (tree x)
+{
+  tree type = TREE_TYPE (x);
+  unsigned precision = TYPE_PRECISION (type);
+  if (precision == 8)
+    return x;
+
+  return fold_convert (type, call_bit_builtin ("__builtin_bswap"
+						 + std::to_string (precision),
+					       x));
+}
+
+/**
+ * Reverse the bits of X, an unsigned integer of 8, 16, 32, 64 or 128 bits.
+ * There is no builtin for it, so the bits of each byte are reversed by
+ * swapping adjacent bits, then pairs of bits, then nibbles, and the bytes
+ * swapped last.
+ */
+static tree
+build_bitreverse (tree x)
+{
+  tree type = TREE_TYPE (x);
+  tree all_ones = build_minus_one_cst (type);
+
+  // 0b0101..., 0b0011... and 0b00001111... masks
+  for (int shift : {1, 2, 4})
+    {
+      tree mask
+	= fold_build2 (TRUNC_DIV_EXPR, type, all_ones,
+		       build_int_cst (type, (1 << shift) + 1));
+      tree amount = build_int_cst (integer_type_node, shift);
+
+      tree high = fold_build2 (BIT_AND_EXPR, type,
+			       fold_build2 (RSHIFT_EXPR, type, x, amount),
+			       mask);
+      tree low = fold_build2 (LSHIFT_EXPR, type,
+			      fold_build2 (BIT_AND_EXPR, type, x, mask),
+			      amount);
+      x = fold_build2 (BIT_IOR_EXPR, type, high, low);
+    }
+
+  return build_bswap (x);
+}
+
+/**
+ * pub fn ctpop<T>(x: T) -> T;
+ * pub fn ctlz<T>(x: T) -> T;
+ * pub fn ctlz_nonzero<T>(x: T) -> T;
+ * pub fn cttz<T>(x: T) -> T;
+ * pub fn cttz_nonzero<T>(x: T) -> T;
+ * pub fn bswap<T>(x: T) -> T;
+ * pub fn bitreverse<T>(x: T) -> T;
+ *
+ * The counting intrinsics return `u32` in newer versions of core, their result
+ * is converted to whichever return type is declared.
+ */
+static tree
+bit_op_handler (Context *ctx, TyTy::FnType *fntype, BitOp op)
+{
+  rust_assert (fntype->get_params ().size () == 1);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  auto locus = fntype->get_locus ();
+  auto monomorphized_type
+    = fntype->get_substs ()[0].get_param_ty ()->resolve ();
+  if (!check_for_basic_integer_type ("bit manipulation", locus,
+				     monomorphized_type))
+    return error_mark_node;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN bit manipulation FN BODY BEGIN
+  tree x = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  tree x_type = TREE_TYPE (x);
+  tree unsigned_x = fold_convert (unsigned_type_for (x_type), x);
+
+  unsigned precision = TYPE_PRECISION (x_type);
+  if (precision > 2 * TYPE_PRECISION (long_long_unsigned_type_node))
+    {
+      rust_error_at (locus, "bit manipulation intrinsics are not available "
+			    "for %qs",
+		     monomorphized_type->get_name ().c_str ());
+      return error_mark_node;
+    }
+
+  tree result;
+  switch (op)
+    {
+    case BitOp::Bswap:
+      result = build_bswap (unsigned_x);
+      break;
+    case BitOp::Bitreverse:
+      result = build_bitreverse (unsigned_x);
+      break;
+    default:
+      result = build_wide_bit_count (op, unsigned_x);
+      break;
+    }
+
+  tree return_type = TREE_TYPE (DECL_RESULT (fndecl));
+  auto return_statement
+    = Backend::return_statement (fndecl, fold_convert (return_type, result),
+				 UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+  // BUILTIN bit manipulation FN BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
 /**
  * pub fn wrapping_{add, sub, mul}<T>(lhs: T, rhs: T) -> T;
  */
@@ -595,11 +1156,10 @@ wrapping_op_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
   auto lhs = Backend::var_expression (lhs_param, UNDEF_LOCATION);
   auto rhs = Backend::var_expression (rhs_param, UNDEF_LOCATION);
 
-  // Operations are always wrapping in Rust, as we have -fwrapv enabled by
-  // default. The difference between a wrapping_{add, sub, mul} and a regular
+  // The difference between a wrapping_{add, sub, mul} and a regular
   // arithmetic operation is that these intrinsics do not panic - they always
   // carry over.
-  auto wrap_expr = build2 (op, TREE_TYPE (lhs), lhs, rhs);
+  auto wrap_expr = Backend::wrapping_expression (op, lhs, rhs, UNDEF_LOCATION);
 
   auto return_statement
     = Backend::return_statement (fndecl, wrap_expr, UNDEF_LOCATION);
@@ -611,6 +1171,53 @@ wrapping_op_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
   return fndecl;
 }
 
+/**
+ * The internal function behind `__builtin_{add, sub, mul}_overflow`, computing
+ * X OP Y as a complex number whose real part is the wrapped result, and whose
+ * imaginary part tells whether the operation overflowed. These expand to the
+ * operation and a check of the overflow flag, without going through memory.
+ * The result is wrapped in a SAVE_EXPR to be used for both parts.
+ */
+static tree
+build_overflow_call (tree_code op, tree x, tree y)
+{
+  internal_fn fn;
+  switch (op)
+    {
+    case PLUS_EXPR:
+      fn = IFN_ADD_OVERFLOW;
+      break;
+    case MINUS_EXPR:
+      fn = IFN_SUB_OVERFLOW;
+      break;
+    case MULT_EXPR:
+      fn = IFN_MUL_OVERFLOW;
+      break;
+    default:
+      rust_unreachable ();
+    }
+
+  tree type = TREE_TYPE (x);
+  tree call = build_call_expr_internal_loc (BUILTINS_LOCATION, fn,
+					    build_complex_type (type), 2, x, y);
+  return save_expr (call);
+}
+
+static tree
+overflow_result (tree overflow)
+{
+  return fold_build1_loc (BUILTINS_LOCATION, REALPART_EXPR,
+			  TREE_TYPE (TREE_TYPE (overflow)), overflow);
+}
+
+static tree
+overflow_flag (tree overflow)
+{
+  tree flag = fold_build1_loc (BUILTINS_LOCATION, IMAGPART_EXPR,
+			       TREE_TYPE (TREE_TYPE (overflow)), overflow);
+  return fold_convert (boolean_type_node, flag);
+}
+
 /**
  * pub fn add_with_overflow<T>(x: T, y: T) -> (T, bool);
  */
@@ -619,6 +1226,7 @@ op_with_overflow_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
 {
   // wrapping_<op> intrinsics have two parameter
   rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
 
   tree lookup = NULL_TREE;
   if (check_for_cached_intrinsic (ctx, fntype, &lookup))
@@ -636,77 +1244,539 @@ op_with_overflow_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
   if (!Backend::function_set_parameters (fndecl, param_vars))
     return error_mark_node;
 
-  rust_assert (fntype->get_num_substitutions () == 1);
-  auto &param_mapping = fntype->get_substs ().at (0);
-  const TyTy::ParamType *param_tyty = param_mapping.get_param_ty ();
-  TyTy::BaseType *resolved_tyty = param_tyty->resolve ();
-  tree template_parameter_type
-    = TyTyResolveCompile::compile (ctx, resolved_tyty);
-
-  // this should match y as well or we can take it from the TyTy structure
-  tree tmp_stmt = error_mark_node;
-  Bvariable *result_variable
-    = Backend::temporary_variable (fndecl, NULL_TREE, template_parameter_type,
-				   NULL_TREE, true /*address_is_taken*/,
-				   UNDEF_LOCATION, &tmp_stmt);
-  Bvariable *bool_variable
-    = Backend::temporary_variable (fndecl, NULL_TREE, boolean_type_node,
-				   NULL_TREE, true /*address_is_taken*/,
-				   UNDEF_LOCATION, &tmp_stmt);
-
-  enter_intrinsic_block (ctx, fndecl, {result_variable, bool_variable});
+  enter_intrinsic_block (ctx, fndecl);
 
   // BUILTIN op_with_overflow FN BODY BEGIN
   auto x = Backend::var_expression (x_param, UNDEF_LOCATION);
   auto y = Backend::var_expression (y_param, UNDEF_LOCATION);
 
-  tree overflow_builtin = error_mark_node;
-  switch (op)
+  tree overflow = build_overflow_call (op, x, y);
+
+  std::vector<tree> vals = {overflow_result (overflow),
+			    overflow_flag (overflow)};
+  tree tuple_type = TREE_TYPE (DECL_RESULT (fndecl));
+  tree result_expr = Backend::constructor_expression (tuple_type, false, vals,
+						      -1, UNDEF_LOCATION);
+
+  auto return_statement
+    = Backend::return_statement (fndecl, result_expr, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+
+  // BUILTIN wrapping_<op> FN BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * fn copy_nonoverlapping<T>(src: *const T, dst: *mut T, count: usize);
+ * fn copy<T>(src: *const T, dst: *mut T, count: usize);
+ */
+static tree
+copy_handler_inner (Context *ctx, TyTy::FnType *fntype, bool overlaps)
+{
+  rust_assert (fntype->get_params ().size () == 3);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure - not `copy_nonoverlapping` and `copy`
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN copy_nonoverlapping BODY BEGIN
+
+  auto src = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto dst = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+  auto count = Backend::var_expression (param_vars[2], UNDEF_LOCATION);
+
+  // We want to create the following statement
+  // memcpy(dst, src, size_of::<T>());
+  // so
+  // memcpy(dst, src, size_expr);
+
+  auto *resolved_ty = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  auto param_type = TyTyResolveCompile::compile (ctx, resolved_ty);
+
+  tree size_expr
+    = build2 (MULT_EXPR, size_type_node, TYPE_SIZE_UNIT (param_type), count);
+
+  tree memcpy_raw = nullptr;
+  BuiltinsContext::get ().lookup_simple_builtin (overlaps ? "__builtin_memmove"
+							  : "__builtin_memcpy",
+						 &memcpy_raw);
+  rust_assert (memcpy_raw);
+  auto memcpy = build_fold_addr_expr_loc (UNKNOWN_LOCATION, memcpy_raw);
+
+  auto copy_call = Backend::call_expression (memcpy, {dst, src, size_expr},
+					     nullptr, UNDEF_LOCATION);
+
+  ctx->add_statement (copy_call);
+
+  // BUILTIN copy_nonoverlapping BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * pub fn saturating_{add, sub}<T>(a: T, b: T) -> T;
+ *
+ * The result of the overflowing operation is replaced by the bound it went
+ * past with a select, which can be compiled to a conditional move.
+ */
+static tree
+saturating_op_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
+{
+  rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  auto *monomorphized_type
+    = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  if (!check_for_basic_integer_type ("saturating arithmetic",
+				     fntype->get_locus (), monomorphized_type))
+    return error_mark_node;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN saturating_<op> FN BODY BEGIN
+  auto x = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto y = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+  tree type = TREE_TYPE (x);
+
+  tree overflow = build_overflow_call (op, x, y);
+
+  // unsigned operations can only go past one bound, signed ones go past the
+  // maximum when adding a positive value or subtracting a negative one
+  tree bound;
+  if (TYPE_UNSIGNED (type))
+    bound = op == PLUS_EXPR ? TYPE_MAX_VALUE (type) : TYPE_MIN_VALUE (type);
+  else
     {
-    case PLUS_EXPR:
-      BuiltinsContext::get ().lookup_simple_builtin ("__builtin_add_overflow",
-						     &overflow_builtin);
-      break;
+      tree y_negative
+	= fold_build2_loc (BUILTINS_LOCATION, LT_EXPR, boolean_type_node, y,
+			   build_zero_cst (type));
+      tree if_negative = op == PLUS_EXPR ? TYPE_MIN_VALUE (type)
+					 : TYPE_MAX_VALUE (type);
+      tree if_positive = op == PLUS_EXPR ? TYPE_MAX_VALUE (type)
+					 : TYPE_MIN_VALUE (type);
+      bound = fold_build3_loc (BUILTINS_LOCATION, COND_EXPR, type, y_negative,
+			       if_negative, if_positive);
+    }
+
+  tree result
+    = fold_build3_loc (BUILTINS_LOCATION, COND_EXPR, type,
+		       overflow_flag (overflow), bound,
+		       overflow_result (overflow));
+
+  auto return_statement
+    = Backend::return_statement (fndecl, result, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+  // BUILTIN saturating_<op> FN BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * pub fn exact_div<T>(x: T, y: T) -> T;
+ *
+ * The division is undefined when it has a remainder, which EXACT_DIV_EXPR
+ * lets the optimizers rely on, e.g. to replace it by a multiplication.
+ */
+static tree
+exact_div_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  auto *monomorphized_type
+    = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  if (!check_for_basic_integer_type ("exact division", fntype->get_locus (),
+				     monomorphized_type))
+    return error_mark_node;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN exact_div FN BODY BEGIN
+  auto x = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto y = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+
+  auto expr = fold_build2_loc (BUILTINS_LOCATION, EXACT_DIV_EXPR,
+			       TREE_TYPE (x), x, y);
+  auto return_statement
+    = Backend::return_statement (fndecl, expr, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+  // BUILTIN exact_div FN BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * pub fn f{add, sub, mul, div, rem}_fast<T>(a: T, b: T) -> T;
+ *
+ * These are undefined for non-finite operands or results, which lets LLVM
+ * use fast-math flags on the single operation. GCC only has function wide
+ * -ffast-math like flags, so the operations are compiled as IEEE ones, which
+ * is correct for every operand these are defined for.
+ */
+static tree
+float_fast_op_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
+{
+  rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  auto *monomorphized_type
+    = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  if (monomorphized_type->get_kind () != TyTy::FLOAT)
+    {
+      rust_error_at (fntype->get_locus (),
+		     "fast floating point intrinsics can only be used with "
+		     "floating point types (got %qs)",
+		     monomorphized_type->get_name ().c_str ());
+      return error_mark_node;
+    }
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN f<op>_fast BODY BEGIN
+
+  auto x = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto y = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+  tree type = TREE_TYPE (x);
+
+  tree expr;
+  if (op == TRUNC_MOD_EXPR)
+    {
+      // there is no tree code for the floating point remainder
+      tree fmod = NULL_TREE;
+      BuiltinsContext::get ().lookup_simple_builtin (
+	TYPE_PRECISION (type) == 32 ? "__builtin_fmodf" : "__builtin_fmod",
+	&fmod);
+      rust_assert (fmod);
+      expr = build_call_expr_loc (BUILTINS_LOCATION, fmod, 2, x, y);
+    }
+  else
+    expr = fold_build2_loc (BUILTINS_LOCATION, op, type, x, y);
+
+  auto return_statement
+    = Backend::return_statement (fndecl, expr, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+
+  // BUILTIN f<op>_fast BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * fn write_bytes<T> (dst: *mut T, val: u8, count: usize);
+ * fn volatile_set_memory<T> (dst: *mut T, val: u8, count: usize);
+ */
+static tree
+write_bytes_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			   bool is_volatile)
+{
+  rust_assert (fntype->get_params ().size () == 3);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure - not `write_bytes`
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  // the index of the next byte to store, when the stores are volatile
+  std::vector<Bvariable *> vars;
+  if (is_volatile)
+    {
+      tree tmp_stmt = error_mark_node;
+      vars.push_back (
+	Backend::temporary_variable (fndecl, NULL_TREE, size_type_node,
+				     size_zero_node, false, UNDEF_LOCATION,
+				     &tmp_stmt));
+    }
+
+  enter_intrinsic_block (ctx, fndecl, vars);
+
+  // BUILTIN write_bytes BODY BEGIN
+
+  auto dst = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto val = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+  auto count = Backend::var_expression (param_vars[2], UNDEF_LOCATION);
+
+  auto *resolved_ty = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  auto param_type = TyTyResolveCompile::compile (ctx, resolved_ty);
+
+  tree size_expr
+    = build2 (MULT_EXPR, size_type_node, TYPE_SIZE_UNIT (param_type), count);
+
+  if (!is_volatile)
+    {
+      // memset(dst, val, size_of::<T>() * count);
+      tree memset_raw = nullptr;
+      BuiltinsContext::get ().lookup_simple_builtin ("__builtin_memset",
+						     &memset_raw);
+      rust_assert (memset_raw);
+      auto memset = build_fold_addr_expr_loc (UNKNOWN_LOCATION, memset_raw);
+
+      auto val_expr = fold_convert (integer_type_node, val);
+      auto memset_call
+	= Backend::call_expression (memset, {dst, val_expr, size_expr},
+				    nullptr, UNDEF_LOCATION);
+      ctx->add_statement (memset_call);
+    }
+  else
+    {
+      // GCC has no volatile memset, so every byte is stored on its own:
+      // while index < size { *(dst as *mut u8).add (index) = val; index++ }
+      tree index = vars[0]->get_tree (BUILTINS_LOCATION);
+
+      tree byte_type = build_qualified_type (TREE_TYPE (val),
+					     TYPE_QUAL_VOLATILE);
+      tree byte_ptr = fold_convert (build_pointer_type (byte_type), dst);
+      tree byte = build1 (INDIRECT_REF, byte_type,
+			  fold_build_pointer_plus (byte_ptr, index));
+      TREE_THIS_VOLATILE (byte) = 1;
+      TREE_SIDE_EFFECTS (byte) = 1;
+
+      tree done = fold_build2 (GE_EXPR, boolean_type_node, index, size_expr);
+      tree next = fold_build2 (PLUS_EXPR, size_type_node, index,
+			       size_one_node);
+
+      tree body = Backend::statement_list (
+	{Backend::exit_expression (done, BUILTINS_LOCATION),
+	 Backend::assignment_statement (byte, val, BUILTINS_LOCATION),
+	 Backend::assignment_statement (index, next, BUILTINS_LOCATION)});
+      ctx->add_statement (Backend::loop_expression (body, BUILTINS_LOCATION));
+    }
+
+  // BUILTIN write_bytes BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+// The volatile access to the value pointed to by PTR
+static tree
+build_volatile_deref (tree ptr)
+{
+  tree type = TREE_TYPE (TREE_TYPE (ptr));
+  tree deref = build1 (INDIRECT_REF, type, ptr);
+  TREE_THIS_VOLATILE (deref) = 1;
+  TREE_SIDE_EFFECTS (deref) = 1;
+
+  return deref;
+}
+
+/**
+ * fn volatile_load<T> (src: *const T) -> T;
+ */
+static tree
+volatile_load_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  rust_assert (fntype->get_params ().size () == 1);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure - volatile accesses are not
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN volatile_load BODY BEGIN
+  auto src = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+
+  auto return_statement
+    = Backend::return_statement (fndecl, build_volatile_deref (src),
+				 UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+  // BUILTIN volatile_load BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * fn volatile_store<T> (dst: *mut T, val: T);
+ */
+static tree
+volatile_store_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure - volatile accesses are not
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN volatile_store BODY BEGIN
+  auto dst = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto val = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+
+  ctx->add_statement (
+    Backend::assignment_statement (build_volatile_deref (dst), val,
+				   UNDEF_LOCATION));
+  // BUILTIN volatile_store BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * fn black_box<T> (dummy: T) -> T;
+ *
+ * Returns DUMMY after an empty volatile asm statement which may read and
+ * write it, as well as any other memory, so that the optimizers can neither
+ * assume anything about the result nor remove the computation of DUMMY.
+ */
+static tree
+black_box_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  rust_assert (fntype->get_params ().size () == 1);
+  rust_assert (fntype->get_num_substitutions () == 1);
 
-    case MINUS_EXPR:
-      BuiltinsContext::get ().lookup_simple_builtin ("__builtin_sub_overflow",
-						     &overflow_builtin);
-      break;
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
 
-    case MULT_EXPR:
-      BuiltinsContext::get ().lookup_simple_builtin ("__builtin_mul_overflow",
-						     &overflow_builtin);
-      break;
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
 
-    default:
-      rust_unreachable ();
-      break;
-    }
-  rust_assert (overflow_builtin != error_mark_node);
+  // The whole point of `black_box` is not to be pure
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
 
-  tree bool_decl = bool_variable->get_tree (BUILTINS_LOCATION);
-  tree result_decl = result_variable->get_tree (BUILTINS_LOCATION);
-  tree result_ref = build_fold_addr_expr_loc (BUILTINS_LOCATION, result_decl);
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
 
-  tree builtin_call = build_call_expr_loc (BUILTINS_LOCATION, overflow_builtin,
-					   3, x, y, result_ref);
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
 
-  tree overflow_assignment
-    = Backend::assignment_statement (bool_decl, builtin_call,
-				     BUILTINS_LOCATION);
+  enter_intrinsic_block (ctx, fndecl);
 
-  ctx->add_statement (overflow_assignment);
+  // BUILTIN black_box BODY BEGIN
+  tree dummy = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  TREE_ADDRESSABLE (dummy) = 1;
 
-  std::vector<tree> vals = {result_decl, bool_decl};
-  tree tuple_type = TREE_TYPE (DECL_RESULT (fndecl));
-  tree result_expr = Backend::constructor_expression (tuple_type, false, vals,
-						      -1, UNDEF_LOCATION);
+  // asm volatile ("" : : "g" (&dummy) : "memory");
+  tree constraint = build_tree_list (NULL_TREE, build_string (1, "g"));
+  tree inputs
+    = build_tree_list (constraint,
+		       build_fold_addr_expr_loc (BUILTINS_LOCATION, dummy));
+  tree clobbers = build_tree_list (NULL_TREE, build_string (6, "memory"));
+
+  tree barrier = build5 (ASM_EXPR, void_type_node, build_string (0, ""),
+			 NULL_TREE, inputs, clobbers, NULL_TREE);
+  ASM_VOLATILE_P (barrier) = 1;
+  TREE_SIDE_EFFECTS (barrier) = 1;
+  SET_EXPR_LOCATION (barrier, BUILTINS_LOCATION);
+  ctx->add_statement (barrier);
 
   auto return_statement
-    = Backend::return_statement (fndecl, result_expr, UNDEF_LOCATION);
+    = Backend::return_statement (fndecl, dummy, UNDEF_LOCATION);
   ctx->add_statement (return_statement);
-
-  // BUILTIN wrapping_<op> FN BODY END
+  // BUILTIN black_box BODY END
 
   finalize_intrinsic_block (ctx, fndecl);
 
@@ -714,13 +1784,15 @@ op_with_overflow_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
 }
 
 /**
- * fn copy_nonoverlapping<T>(src: *const T, dst: *mut T, count: usize);
- * fn copy<T>(src: *const T, dst: *mut T, count: usize);
+ * fn raw_eq<T> (a: &T, b: &T) -> bool;
+ *
+ * Compares the bytes of the values A and B point to with a single memcmp. The
+ * values must not contain any padding or otherwise uninitialized byte.
  */
 static tree
-copy_handler_inner (Context *ctx, TyTy::FnType *fntype, bool overlaps)
+raw_eq_handler (Context *ctx, TyTy::FnType *fntype)
 {
-  rust_assert (fntype->get_params ().size () == 3);
+  rust_assert (fntype->get_params ().size () == 2);
   rust_assert (fntype->get_num_substitutions () == 1);
 
   tree lookup = NULL_TREE;
@@ -729,9 +1801,9 @@ copy_handler_inner (Context *ctx, TyTy::FnType *fntype, bool overlaps)
 
   auto fndecl = compile_intrinsic_function (ctx, fntype);
 
-  // Most intrinsic functions are pure - not `copy_nonoverlapping` and `copy`
+  // the comparison reads the memory the arguments point to
   TREE_READONLY (fndecl) = 0;
-  TREE_SIDE_EFFECTS (fndecl) = 1;
+  DECL_PURE_P (fndecl) = 1;
 
   // setup the params
   std::vector<Bvariable *> param_vars;
@@ -742,36 +1814,118 @@ copy_handler_inner (Context *ctx, TyTy::FnType *fntype, bool overlaps)
 
   enter_intrinsic_block (ctx, fndecl);
 
-  // BUILTIN copy_nonoverlapping BODY BEGIN
+  // BUILTIN raw_eq BODY BEGIN
+  auto a = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto b = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
 
-  auto src = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
-  auto dst = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
-  auto count = Backend::var_expression (param_vars[2], UNDEF_LOCATION);
+  auto *resolved_ty = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  auto value_type = TyTyResolveCompile::compile (ctx, resolved_ty);
+
+  tree memcmp_raw = nullptr;
+  BuiltinsContext::get ().lookup_simple_builtin ("__builtin_memcmp",
+						 &memcmp_raw);
+  rust_assert (memcmp_raw);
+  auto memcmp = build_fold_addr_expr_loc (UNKNOWN_LOCATION, memcmp_raw);
+
+  // the size is a constant, so that the comparison can be expanded inline
+  auto memcmp_call
+    = Backend::call_expression (memcmp, {a, b, TYPE_SIZE_UNIT (value_type)},
+				nullptr, UNDEF_LOCATION);
+  auto equal
+    = Backend::comparison_expression (ComparisonOperator::EQUAL, memcmp_call,
+				      integer_zero_node, UNDEF_LOCATION);
 
-  // We want to create the following statement
-  // memcpy(dst, src, size_of::<T>());
-  // so
-  // memcpy(dst, src, size_expr);
+  auto return_statement
+    = Backend::return_statement (fndecl, equal, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+  // BUILTIN raw_eq BODY END
 
-  auto *resolved_ty = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
-  auto param_type = TyTyResolveCompile::compile (ctx, resolved_ty);
+  finalize_intrinsic_block (ctx, fndecl);
 
-  tree size_expr
-    = build2 (MULT_EXPR, size_type_node, TYPE_SIZE_UNIT (param_type), count);
+  return fndecl;
+}
 
-  tree memcpy_raw = nullptr;
-  BuiltinsContext::get ().lookup_simple_builtin (overlaps ? "__builtin_memmove"
-							  : "__builtin_memcpy",
-						 &memcpy_raw);
-  rust_assert (memcpy_raw);
-  auto memcpy = build_fold_addr_expr_loc (UNKNOWN_LOCATION, memcpy_raw);
+/* Whether TYPE, which compiles to TREE_TYPE, is a struct with several fields
+   of the same primitive integer type and no padding.  */
 
-  auto copy_call = Backend::call_expression (memcpy, {dst, src, size_expr},
-					     nullptr, UNDEF_LOCATION);
+static bool
+has_uniform_integer_fields (Context *ctx, TyTy::BaseType *type, tree tree_type)
+{
+  if (type->get_kind () != TyTy::TypeKind::ADT)
+    return false;
 
-  ctx->add_statement (copy_call);
+  auto adt = static_cast<TyTy::ADTType *> (type);
+  if (!adt->is_struct_struct () && !adt->is_tuple_struct ())
+    return false;
 
-  // BUILTIN copy_nonoverlapping BODY END
+  auto &fields = adt->get_variants ().at (0)->get_fields ();
+  if (fields.size () < 2)
+    return false;
+
+  TyTy::BaseType *field_type = fields[0]->get_field_type ()->destructure ();
+  switch (field_type->get_kind ())
+    {
+    case TyTy::TypeKind::INT:
+    case TyTy::TypeKind::UINT:
+    case TyTy::TypeKind::ISIZE:
+    case TyTy::TypeKind::USIZE:
+      break;
+    default:
+      return false;
+    }
+
+  for (auto &field : fields)
+    if (!field->get_field_type ()->destructure ()->is_equal (*field_type))
+      return false;
+
+  // which rules out the alignments larger than the one of the fields
+  tree field_tree = TyTyResolveCompile::compile (ctx, field_type);
+  tree fields_size = size_binop (MULT_EXPR, TYPE_SIZE_UNIT (field_tree),
+				 size_int (fields.size ()));
+  return tree_int_cst_equal (TYPE_SIZE_UNIT (tree_type), fields_size);
+}
+
+/**
+ * fn has_uniform_integer_fields<T> (a: &T) -> bool;
+ *
+ * Whether the fields of T are several times the same primitive integer type,
+ * so that its values have no padding. The builtin derives use it to compare
+ * or hash these values as a whole, which they cannot find out by themselves
+ * since they only see the spelling of the field types.
+ */
+static tree
+uniform_integer_fields_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  rust_assert (fntype->get_params ().size () == 1);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN has_uniform_integer_fields BODY BEGIN
+  auto *resolved_ty = fntype->get_substs ().at (0).get_param_ty ()->resolve ();
+  auto value_type = TyTyResolveCompile::compile (ctx, resolved_ty);
+
+  tree value
+    = has_uniform_integer_fields (ctx, resolved_ty, value_type)
+	? boolean_true_node
+	: boolean_false_node;
+
+  auto return_statement
+    = Backend::return_statement (fndecl, value, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+  // BUILTIN has_uniform_integer_fields BODY END
 
   finalize_intrinsic_block (ctx, fndecl);
 
@@ -865,30 +2019,213 @@ build_atomic_builtin_name (const std::string &prefix, location_t locus,
   auto type_name = operand_type->get_name ();
   if (type_name == "usize" || type_name == "isize")
     {
-      rust_sorry_at (
-	locus, "atomics are not yet available for size types (usize, isize)");
-      return "";
+      rust_sorry_at (
+	locus, "atomics are not yet available for size types (usize, isize)");
+      return "";
+    }
+
+  if (type_name.at (0) == 'i')
+    {
+      rust_sorry_at (locus, "atomics are not yet supported for signed "
+			    "integer types (i8, i16, i32, i64, i128)");
+      return "";
+    }
+
+  auto type_size_str = allowed_types.find (type_name);
+
+  if (!check_for_basic_integer_type ("atomic", locus, operand_type))
+    return "";
+
+  result += type_size_str->second;
+
+  return result;
+}
+
+static tree
+atomic_store_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
+{
+  rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure but not the atomic ones
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  std::vector<tree> types;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars, &types);
+
+  auto ok = Backend::function_set_parameters (fndecl, param_vars);
+  rust_assert (ok);
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  auto dst = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  TREE_READONLY (dst) = 0;
+
+  auto value = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+  auto memorder = make_unsigned_long_tree (ordering);
+
+  auto monomorphized_type
+    = fntype->get_substs ()[0].get_param_ty ()->resolve ();
+
+  auto builtin_name
+    = build_atomic_builtin_name ("atomic_store_", fntype->get_locus (),
+				 monomorphized_type);
+  if (builtin_name.empty ())
+    return error_mark_node;
+
+  tree atomic_store_raw = nullptr;
+  BuiltinsContext::get ().lookup_simple_builtin (builtin_name,
+						 &atomic_store_raw);
+  rust_assert (atomic_store_raw);
+
+  auto atomic_store
+    = build_fold_addr_expr_loc (UNKNOWN_LOCATION, atomic_store_raw);
+
+  auto store_call
+    = Backend::call_expression (atomic_store, {dst, value, memorder}, nullptr,
+				UNDEF_LOCATION);
+  TREE_READONLY (store_call) = 0;
+  TREE_SIDE_EFFECTS (store_call) = 1;
+
+  ctx->add_statement (store_call);
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+static tree
+atomic_load_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
+{
+  rust_assert (fntype->get_params ().size () == 1);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure but not the atomic ones
+  // FIXME: Is atomic_load_* pure? Feels like it shouldn't so
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  std::vector<tree> types;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars, &types);
+
+  auto ok = Backend::function_set_parameters (fndecl, param_vars);
+  rust_assert (ok);
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  auto src = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto memorder = make_unsigned_long_tree (ordering);
+
+  auto monomorphized_type
+    = fntype->get_substs ()[0].get_param_ty ()->resolve ();
+
+  auto builtin_name
+    = build_atomic_builtin_name ("atomic_load_", fntype->get_locus (),
+				 monomorphized_type);
+  if (builtin_name.empty ())
+    return error_mark_node;
+
+  tree atomic_load_raw = nullptr;
+  BuiltinsContext::get ().lookup_simple_builtin (builtin_name,
+						 &atomic_load_raw);
+  rust_assert (atomic_load_raw);
+
+  auto atomic_load
+    = build_fold_addr_expr_loc (UNKNOWN_LOCATION, atomic_load_raw);
+
+  auto load_call = Backend::call_expression (atomic_load, {src, memorder},
+					     nullptr, UNDEF_LOCATION);
+  auto return_statement
+    = Backend::return_statement (fndecl, load_call, UNDEF_LOCATION);
+
+  TREE_READONLY (load_call) = 0;
+  TREE_SIDE_EFFECTS (load_call) = 1;
+
+  ctx->add_statement (return_statement);
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * Returns the `__atomic_*_N` builtin named BUILTIN_PREFIX followed by the size
+ * of TYPE, or NULL_TREE after reporting an error when values of TYPE cannot be
+ * operated on atomically. The builtins are expanded inline whenever the target
+ * supports atomics of that size, and call libatomic otherwise.
+ */
+static tree
+lookup_atomic_builtin (const std::string &builtin_prefix, location_t locus,
+		       TyTy::BaseType *type, tree compiled_type)
+{
+  if (!is_basic_integer_type (type) && type->get_kind () != TyTy::POINTER)
+    {
+      rust_error_at (locus,
+		     "atomic intrinsics can only be used with basic integer "
+		     "and raw pointer types (got %qs)",
+		     type->get_name ().c_str ());
+      return NULL_TREE;
     }
 
-  if (type_name.at (0) == 'i')
+  HOST_WIDE_INT size = int_size_in_bytes (compiled_type);
+  switch (size)
     {
-      rust_sorry_at (locus, "atomics are not yet supported for signed "
-			    "integer types (i8, i16, i32, i64, i128)");
-      return "";
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+    case 16:
+      break;
+    default:
+      rust_error_at (locus, "atomic intrinsics are not available for %qs",
+		     type->get_name ().c_str ());
+      return NULL_TREE;
     }
 
-  auto type_size_str = allowed_types.find (type_name);
+  tree builtin = NULL_TREE;
+  BuiltinsContext::get ().lookup_simple_builtin (builtin_prefix
+						   + std::to_string (size),
+						 &builtin);
+  rust_assert (builtin);
 
-  if (!check_for_basic_integer_type ("atomic", locus, operand_type))
-    return "";
+  return builtin;
+}
 
-  result += type_size_str->second;
+// The type of the Nth parameter of the builtin BUILTIN
+static tree
+builtin_param_type (tree builtin, int n)
+{
+  tree args = TYPE_ARG_TYPES (TREE_TYPE (builtin));
+  for (int i = 0; i < n; i++)
+    args = TREE_CHAIN (args);
 
-  return result;
+  return TREE_VALUE (args);
 }
 
+/**
+ * fn atomic_<op>_<ordering><T> (dst: *mut T, src: T) -> T;
+ *
+ * Applies OP to the value at DST and SRC, and returns the previous value.
+ */
 static tree
-atomic_store_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
+atomic_rmw_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			  const std::string &builtin_prefix, int ordering)
 {
   rust_assert (fntype->get_params ().size () == 2);
   rust_assert (fntype->get_num_substitutions () == 1);
@@ -905,53 +2242,52 @@ atomic_store_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
 
   // setup the params
   std::vector<Bvariable *> param_vars;
-  std::vector<tree> types;
-  compile_fn_params (ctx, fntype, fndecl, &param_vars, &types);
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
 
-  auto ok = Backend::function_set_parameters (fndecl, param_vars);
-  rust_assert (ok);
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
 
   enter_intrinsic_block (ctx, fndecl);
 
   auto dst = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
-  TREE_READONLY (dst) = 0;
-
   auto value = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
-  auto memorder = make_unsigned_long_tree (ordering);
+  tree value_type = TREE_TYPE (value);
 
   auto monomorphized_type
     = fntype->get_substs ()[0].get_param_ty ()->resolve ();
-
-  auto builtin_name
-    = build_atomic_builtin_name ("atomic_store_", fntype->get_locus (),
-				 monomorphized_type);
-  if (builtin_name.empty ())
+  tree builtin = lookup_atomic_builtin (builtin_prefix, fntype->get_locus (),
+					monomorphized_type, value_type);
+  if (builtin == NULL_TREE)
     return error_mark_node;
 
-  tree atomic_store_raw = nullptr;
-  BuiltinsContext::get ().lookup_simple_builtin (builtin_name,
-						 &atomic_store_raw);
-  rust_assert (atomic_store_raw);
-
-  auto atomic_store
-    = build_fold_addr_expr_loc (UNKNOWN_LOCATION, atomic_store_raw);
+  // the builtins work on unsigned integers of the right size
+  tree operand = fold_convert (builtin_param_type (builtin, 1), value);
+  tree call = build_call_expr_loc (BUILTINS_LOCATION, builtin, 3, dst, operand,
+				   make_unsigned_long_tree (ordering));
+  TREE_SIDE_EFFECTS (call) = 1;
 
-  auto store_call
-    = Backend::call_expression (atomic_store, {dst, value, memorder}, nullptr,
-				UNDEF_LOCATION);
-  TREE_READONLY (store_call) = 0;
-  TREE_SIDE_EFFECTS (store_call) = 1;
+  auto return_statement
+    = Backend::return_statement (fndecl, fold_convert (value_type, call),
+				 UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
 
-  ctx->add_statement (store_call);
   finalize_intrinsic_block (ctx, fndecl);
 
   return fndecl;
 }
 
+/**
+ * fn atomic_cxchg[weak]_<success>_<failure><T> (dst: *mut T, old: T, src: T)
+ *   -> (T, bool);
+ *
+ * Stores SRC at DST if the value there is OLD. Returns the previous value and
+ * whether the store happened.
+ */
 static tree
-atomic_load_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
+atomic_cxchg_handler_inner (Context *ctx, TyTy::FnType *fntype, bool weak,
+			    int success, int failure)
 {
-  rust_assert (fntype->get_params ().size () == 1);
+  rust_assert (fntype->get_params ().size () == 3);
   rust_assert (fntype->get_num_substitutions () == 1);
 
   tree lookup = NULL_TREE;
@@ -961,48 +2297,172 @@ atomic_load_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
   auto fndecl = compile_intrinsic_function (ctx, fntype);
 
   // Most intrinsic functions are pure but not the atomic ones
-  // FIXME: Is atomic_load_* pure? Feels like it shouldn't so
   TREE_READONLY (fndecl) = 0;
   TREE_SIDE_EFFECTS (fndecl) = 1;
 
   // setup the params
   std::vector<Bvariable *> param_vars;
-  std::vector<tree> types;
-  compile_fn_params (ctx, fntype, fndecl, &param_vars, &types);
-
-  auto ok = Backend::function_set_parameters (fndecl, param_vars);
-  rust_assert (ok);
-
-  enter_intrinsic_block (ctx, fndecl);
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
 
-  auto src = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
-  auto memorder = make_unsigned_long_tree (ordering);
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
 
   auto monomorphized_type
     = fntype->get_substs ()[0].get_param_ty ()->resolve ();
+  tree value_type = TyTyResolveCompile::compile (ctx, monomorphized_type);
 
-  auto builtin_name
-    = build_atomic_builtin_name ("atomic_load_", fntype->get_locus (),
-				 monomorphized_type);
-  if (builtin_name.empty ())
+  // the builtin writes the previous value to EXPECTED when it differs
+  tree tmp_stmt = error_mark_node;
+  Bvariable *expected_variable
+    = Backend::temporary_variable (fndecl, NULL_TREE, value_type, NULL_TREE,
+				   true /*address_is_taken*/, UNDEF_LOCATION,
+				   &tmp_stmt);
+  Bvariable *bool_variable
+    = Backend::temporary_variable (fndecl, NULL_TREE, boolean_type_node,
+				   NULL_TREE, true /*address_is_taken*/,
+				   UNDEF_LOCATION, &tmp_stmt);
+
+  enter_intrinsic_block (ctx, fndecl, {expected_variable, bool_variable});
+
+  auto dst = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto old = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+  auto src = Backend::var_expression (param_vars[2], UNDEF_LOCATION);
+
+  tree builtin
+    = lookup_atomic_builtin ("__atomic_compare_exchange_", fntype->get_locus (),
+			     monomorphized_type, value_type);
+  if (builtin == NULL_TREE)
     return error_mark_node;
 
-  tree atomic_load_raw = nullptr;
-  BuiltinsContext::get ().lookup_simple_builtin (builtin_name,
-						 &atomic_load_raw);
-  rust_assert (atomic_load_raw);
+  tree expected_decl = expected_variable->get_tree (BUILTINS_LOCATION);
+  tree bool_decl = bool_variable->get_tree (BUILTINS_LOCATION);
 
-  auto atomic_load
-    = build_fold_addr_expr_loc (UNKNOWN_LOCATION, atomic_load_raw);
+  ctx->add_statement (
+    Backend::assignment_statement (expected_decl, old, BUILTINS_LOCATION));
+
+  tree expected_ref
+    = build_fold_addr_expr_loc (BUILTINS_LOCATION, expected_decl);
+  tree desired = fold_convert (builtin_param_type (builtin, 2), src);
+  tree call
+    = build_call_expr_loc (BUILTINS_LOCATION, builtin, 6, dst, expected_ref,
+			   desired, weak ? boolean_true_node : boolean_false_node,
+			   make_unsigned_long_tree (success),
+			   make_unsigned_long_tree (failure));
+  TREE_SIDE_EFFECTS (call) = 1;
+
+  ctx->add_statement (Backend::assignment_statement (
+    bool_decl, fold_convert (boolean_type_node, call), BUILTINS_LOCATION));
+
+  std::vector<tree> vals = {expected_decl, bool_decl};
+  tree tuple_type = TREE_TYPE (DECL_RESULT (fndecl));
+  tree result_expr = Backend::constructor_expression (tuple_type, false, vals,
+						      -1, UNDEF_LOCATION);
 
-  auto load_call = Backend::call_expression (atomic_load, {src, memorder},
-					     nullptr, UNDEF_LOCATION);
   auto return_statement
-    = Backend::return_statement (fndecl, load_call, UNDEF_LOCATION);
+    = Backend::return_statement (fndecl, result_expr, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
 
-  TREE_READONLY (load_call) = 0;
-  TREE_SIDE_EFFECTS (load_call) = 1;
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+/**
+ * fn atomic_[u]max_<ordering><T> (dst: *mut T, src: T) -> T;
+ * fn atomic_[u]min_<ordering><T> (dst: *mut T, src: T) -> T;
+ *
+ * Stores the maximum, or minimum, of the value at DST and SRC at DST, and
+ * returns the previous value. The signed variants compare the values as
+ * signed integers, the `u` ones as unsigned integers:
+ *
+ * previous = *dst;
+ * while !cxchgweak (dst, &previous, op (previous, src)) {}
+ * return previous;
+ */
+static tree
+atomic_minmax_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op,
+			     bool is_unsigned, int ordering)
+{
+  rust_assert (fntype->get_params ().size () == 2);
+  rust_assert (fntype->get_num_substitutions () == 1);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure but not the atomic ones
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
 
+  // setup the params
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  auto monomorphized_type
+    = fntype->get_substs ()[0].get_param_ty ()->resolve ();
+  tree value_type = TyTyResolveCompile::compile (ctx, monomorphized_type);
+
+  // the compare-exchange writes the current value to PREVIOUS when it fails
+  tree tmp_stmt = error_mark_node;
+  Bvariable *previous_variable
+    = Backend::temporary_variable (fndecl, NULL_TREE, value_type, NULL_TREE,
+				   true /*address_is_taken*/, UNDEF_LOCATION,
+				   &tmp_stmt);
+
+  enter_intrinsic_block (ctx, fndecl, {previous_variable});
+
+  auto dst = Backend::var_expression (param_vars[0], UNDEF_LOCATION);
+  auto src = Backend::var_expression (param_vars[1], UNDEF_LOCATION);
+
+  tree load = lookup_atomic_builtin ("__atomic_load_", fntype->get_locus (),
+				     monomorphized_type, value_type);
+  if (load == NULL_TREE)
+    return error_mark_node;
+  tree cxchg
+    = lookup_atomic_builtin ("__atomic_compare_exchange_", fntype->get_locus (),
+			     monomorphized_type, value_type);
+  rust_assert (cxchg != NULL_TREE);
+
+  tree previous_decl = previous_variable->get_tree (BUILTINS_LOCATION);
+
+  // the loop checks the value it read, so the first load can be relaxed
+  tree initial = build_call_expr_loc (BUILTINS_LOCATION, load, 2, dst,
+				      make_unsigned_long_tree (__ATOMIC_RELAXED));
+  TREE_SIDE_EFFECTS (initial) = 1;
+  ctx->add_statement (
+    Backend::assignment_statement (previous_decl,
+				   fold_convert (value_type, initial),
+				   BUILTINS_LOCATION));
+
+  tree compare_type = is_unsigned ? unsigned_type_for (value_type)
+				  : signed_type_for (value_type);
+  tree desired = fold_build2 (op, compare_type,
+			      fold_convert (compare_type, previous_decl),
+			      fold_convert (compare_type, src));
+
+  tree previous_ref
+    = build_fold_addr_expr_loc (BUILTINS_LOCATION, previous_decl);
+  tree call
+    = build_call_expr_loc (BUILTINS_LOCATION, cxchg, 6, dst, previous_ref,
+			   fold_convert (builtin_param_type (cxchg, 2),
+					 desired),
+			   boolean_true_node, make_unsigned_long_tree (ordering),
+			   make_unsigned_long_tree (__ATOMIC_RELAXED));
+  TREE_SIDE_EFFECTS (call) = 1;
+
+  tree done = fold_convert (boolean_type_node, call);
+  ctx->add_statement (
+    Backend::loop_expression (Backend::exit_expression (done,
+							BUILTINS_LOCATION),
+			      BUILTINS_LOCATION));
+
+  auto return_statement
+    = Backend::return_statement (fndecl, previous_decl, UNDEF_LOCATION);
   ctx->add_statement (return_statement);
 
   finalize_intrinsic_block (ctx, fndecl);
@@ -1010,6 +2470,42 @@ atomic_load_handler_inner (Context *ctx, TyTy::FnType *fntype, int ordering)
   return fndecl;
 }
 
+/**
+ * fn atomic_fence_<ordering> ();
+ * fn atomic_singlethreadfence_<ordering> ();
+ */
+static tree
+atomic_fence_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			    const char *builtin_name, int ordering)
+{
+  rust_assert (fntype->get_params ().empty ());
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  // Most intrinsic functions are pure but not the atomic ones
+  TREE_READONLY (fndecl) = 0;
+  TREE_SIDE_EFFECTS (fndecl) = 1;
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  tree builtin = NULL_TREE;
+  BuiltinsContext::get ().lookup_simple_builtin (builtin_name, &builtin);
+  rust_assert (builtin);
+
+  tree call = build_call_expr_loc (BUILTINS_LOCATION, builtin, 1,
+				   make_unsigned_long_tree (ordering));
+  TREE_SIDE_EFFECTS (call) = 1;
+  ctx->add_statement (call);
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
 static inline tree
 unchecked_op_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
 {
@@ -1265,5 +2761,245 @@ assume_handler (Context *ctx, TyTy::FnType *fntype)
   return fndecl;
 }
 
+/**
+ * Compile a simd_* intrinsic, which returns the expression BODY builds out of
+ * its parameters. The first parameter of all of them is a #[repr(simd)]
+ * vector.
+ */
+static tree
+simd_intrinsic (
+  Context *ctx, TyTy::FnType *fntype, size_t num_params,
+  const std::function<tree (tree fndecl, const std::vector<tree> &args)> &body)
+{
+  rust_assert (fntype->get_params ().size () == num_params);
+
+  tree lookup = NULL_TREE;
+  if (check_for_cached_intrinsic (ctx, fntype, &lookup))
+    return lookup;
+
+  auto fndecl = compile_intrinsic_function (ctx, fntype);
+
+  std::vector<Bvariable *> param_vars;
+  compile_fn_params (ctx, fntype, fndecl, &param_vars);
+
+  if (!Backend::function_set_parameters (fndecl, param_vars))
+    return error_mark_node;
+
+  std::vector<tree> args;
+  for (auto &param : param_vars)
+    args.push_back (Backend::var_expression (param, UNDEF_LOCATION));
+
+  if (TREE_CODE (TREE_TYPE (args.at (0))) != VECTOR_TYPE)
+    {
+      rust_error_at (fntype->get_locus (),
+		     "%s intrinsic can only be used with SIMD vector types",
+		     fntype->get_identifier ().c_str ());
+      return error_mark_node;
+    }
+
+  enter_intrinsic_block (ctx, fndecl);
+
+  // BUILTIN simd_<op> FN BODY BEGIN
+
+  tree expr = body (fndecl, args);
+  if (expr == error_mark_node)
+    return error_mark_node;
+
+  auto return_statement
+    = Backend::return_statement (fndecl, expr, UNDEF_LOCATION);
+  ctx->add_statement (return_statement);
+
+  // BUILTIN simd_<op> FN BODY END
+
+  finalize_intrinsic_block (ctx, fndecl);
+
+  return fndecl;
+}
+
+// Lane INDEX of VECTOR, which is a vector parameter of an intrinsic. Lanes
+// with a variable index are only accessible in memory.
+static tree
+simd_lane (tree vector, tree index)
+{
+  if (TREE_CODE (index) != INTEGER_CST)
+    TREE_ADDRESSABLE (vector) = 1;
+
+  return Backend::vector_lane_expression (vector, index, UNDEF_LOCATION);
+}
+
+static unsigned HOST_WIDE_INT
+simd_lanes (tree vector_type)
+{
+  return TYPE_VECTOR_SUBPARTS (vector_type).to_constant ();
+}
+
+static tree
+simd_binary_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op)
+{
+  return simd_intrinsic (ctx, fntype, 2,
+			 [op] (tree, const std::vector<tree> &args) {
+			   tree type = TREE_TYPE (args[0]);
+			   tree_code code = op;
+			   if (op == TRUNC_DIV_EXPR
+			       && FLOAT_TYPE_P (TREE_TYPE (type)))
+			     code = RDIV_EXPR;
+
+			   return fold_build2 (code, type, args[0], args[1]);
+			 });
+}
+
+static tree
+simd_neg_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  return simd_intrinsic (ctx, fntype, 1,
+			 [] (tree, const std::vector<tree> &args) {
+			   return fold_build1 (NEGATE_EXPR,
+					       TREE_TYPE (args[0]), args[0]);
+			 });
+}
+
+/**
+ * simd_<cmp><T, U> (x: T, y: T) -> U compares each lane, U is a vector of
+ * integers with as many lanes set to all ones where the comparison holds.
+ */
+static tree
+simd_comparison_handler_inner (Context *ctx, TyTy::FnType *fntype,
+			       tree_code op)
+{
+  return simd_intrinsic (
+    ctx, fntype, 2, [fntype, op] (tree fndecl, const std::vector<tree> &args) {
+      tree type = TREE_TYPE (args[0]);
+      tree mask_type = TREE_TYPE (TREE_TYPE (fndecl));
+      if (TREE_CODE (mask_type) != VECTOR_TYPE
+	  || !INTEGRAL_TYPE_P (TREE_TYPE (mask_type))
+	  || simd_lanes (mask_type) != simd_lanes (type))
+	{
+	  rust_error_at (fntype->get_locus (),
+			 "%s intrinsic must return an integer vector with as "
+			 "many lanes as its arguments",
+			 fntype->get_identifier ().c_str ());
+	  return error_mark_node;
+	}
+
+      tree cmp = fold_build2 (op, truth_type_for (type), args[0], args[1]);
+      return fold_build3 (VEC_COND_EXPR, mask_type, cmp,
+			  build_minus_one_cst (mask_type),
+			  build_zero_cst (mask_type));
+    });
+}
+
+/**
+ * simd_extract<T, U> (x: T, idx: u32) -> U
+ */
+static tree
+simd_extract_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  return simd_intrinsic (ctx, fntype, 2,
+			 [] (tree, const std::vector<tree> &args) {
+			   return simd_lane (args[0],
+					     fold_convert (sizetype, args[1]));
+			 });
+}
+
+/**
+ * simd_insert<T, U> (x: T, idx: u32, val: U) -> T
+ */
+static tree
+simd_insert_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  return simd_intrinsic (
+    ctx, fntype, 3, [] (tree, const std::vector<tree> &args) {
+      tree lane = simd_lane (args[0], fold_convert (sizetype, args[1]));
+      tree assignment
+	= build2 (MODIFY_EXPR, TREE_TYPE (lane), lane,
+		  fold_convert (TREE_TYPE (lane), args[2]));
+
+      return build2 (COMPOUND_EXPR, TREE_TYPE (args[0]), assignment, args[0]);
+    });
+}
+
+/**
+ * simd_shuffle<T, U, V> (x: T, y: T, idx: U) -> V
+ *
+ * Lane I of the result is lane IDX[I] of the concatenation of X and Y. IDX
+ * is a constant in the caller, so once this is inlined each lane folds to
+ * a single one of X or Y.
+ */
+static tree
+simd_shuffle_handler (Context *ctx, TyTy::FnType *fntype)
+{
+  return simd_intrinsic (
+    ctx, fntype, 3, [fntype] (tree fndecl, const std::vector<tree> &args) {
+      tree type = TREE_TYPE (args[0]);
+      tree result_type = TREE_TYPE (TREE_TYPE (fndecl));
+      tree indices = args[2];
+      tree indices_type = TREE_TYPE (indices);
+      if (TREE_CODE (result_type) != VECTOR_TYPE
+	  || TYPE_MAIN_VARIANT (TREE_TYPE (result_type))
+	       != TYPE_MAIN_VARIANT (TREE_TYPE (type))
+	  || (TREE_CODE (indices_type) != ARRAY_TYPE
+	      && TREE_CODE (indices_type) != VECTOR_TYPE))
+	{
+	  rust_error_at (fntype->get_locus (),
+			 "invalid types for the %s intrinsic",
+			 fntype->get_identifier ().c_str ());
+	  return error_mark_node;
+	}
+
+      tree lanes = size_int (simd_lanes (type));
+      vec<constructor_elt, va_gc> *elts = nullptr;
+      for (unsigned HOST_WIDE_INT i = 0; i < simd_lanes (result_type); i++)
+	{
+	  tree index
+	    = TREE_CODE (indices_type) == ARRAY_TYPE
+		? Backend::array_index_expression (indices, size_int (i),
+						   UNDEF_LOCATION)
+		: simd_lane (indices, size_int (i));
+	  index = save_expr (fold_convert (sizetype, index));
+
+	  tree from_x = simd_lane (args[0], index);
+	  tree from_y
+	    = simd_lane (args[1], fold_build2 (MINUS_EXPR, sizetype, index,
+					       lanes));
+	  tree in_x = fold_build2 (LT_EXPR, boolean_type_node, index, lanes);
+	  CONSTRUCTOR_APPEND_ELT (elts, NULL_TREE,
+				  fold_build3 (COND_EXPR, TREE_TYPE (type),
+					       in_x, from_x, from_y));
+	}
+
+      return build_constructor (result_type, elts);
+    });
+}
+
+/**
+ * simd_reduce_<op><T, U> (x: T) -> U combines the lanes of X from first to
+ * last. The ordered variants take the initial value as a second parameter.
+ */
+static tree
+simd_reduce_handler_inner (Context *ctx, TyTy::FnType *fntype, tree_code op,
+			   bool ordered)
+{
+  return simd_intrinsic (
+    ctx, fntype, ordered ? 2 : 1,
+    [op, ordered] (tree fndecl, const std::vector<tree> &args) {
+      tree type = TREE_TYPE (args[0]);
+      tree element_type = TREE_TYPE (type);
+      tree element_size = TYPE_SIZE (element_type);
+
+      tree result = ordered ? fold_convert (element_type, args[1]) : NULL_TREE;
+      for (unsigned HOST_WIDE_INT i = 0; i < simd_lanes (type); i++)
+	{
+	  tree lane
+	    = build3 (BIT_FIELD_REF, element_type, args[0], element_size,
+		      bitsize_int (i * tree_to_uhwi (element_size)));
+	  result = result == NULL_TREE
+		     ? lane
+		     : fold_build2 (op, element_type, result, lane);
+	}
+
+      return fold_convert (TREE_TYPE (TREE_TYPE (fndecl)), result);
+    });
+}
+
 } // namespace Compile
 } // namespace Rust
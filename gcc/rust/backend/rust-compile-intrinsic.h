@@ -30,6 +30,8 @@ public:
 
   tree compile (TyTy::FnType *fntype);
 
+  tree fold_call (TyTy::FnType *fntype);
+
 private:
   Context *ctx;
 };
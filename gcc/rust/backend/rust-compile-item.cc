@@ -20,10 +20,36 @@
 #include "rust-compile-implitem.h"
 #include "rust-compile-extern.h"
 #include "rust-immutable-name-resolution-context.h"
+#include "rust-attribute-values.h"
+#include "rust-session-manager.h"
 
 namespace Rust {
 namespace Compile {
 
+/* Return the TLS model of the static VAR if it is `#[thread_local]`.  The
+   statics of an executable are at a fixed offset of the thread pointer,
+   whichever crate of it names them; libraries can be loaded with dlopen and
+   need the general model.  -frust-tls-model= overrides the choice.  */
+
+static tl::optional<enum tls_model>
+thread_local_model (HIR::StaticItem &var)
+{
+  bool is_thread_local = false;
+  for (const auto &attr : var.get_outer_attrs ())
+    if (attr.get_builtin () == Values::BuiltinAttribute::THREAD_LOCAL)
+      is_thread_local = true;
+  if (!is_thread_local)
+    return tl::nullopt;
+
+  if (flag_rust_tls_model != TLS_MODEL_NONE)
+    return static_cast<enum tls_model> (flag_rust_tls_model);
+
+  bool is_executable
+    = Session::get_instance ().options.target_data.get_crate_type ()
+      == TargetOptions::CrateType::BIN;
+  return is_executable ? TLS_MODEL_LOCAL_EXEC : TLS_MODEL_GLOBAL_DYNAMIC;
+}
+
 void
 CompileItem::visit (HIR::StaticItem &var)
 {
@@ -63,14 +89,67 @@ CompileItem::visit (HIR::StaticItem &var)
 				in_unique_section, var.get_locus ());
 
   tree init = value == error_mark_node ? error_mark_node : DECL_INITIAL (value);
+
+  // an immutable static without interior mutability is never written to, so
+  // it goes to read-only storage and the loads from it can be folded. This
+  // has to be known before the initializer picks the section.
+  if (!var.is_mut () && is_freeze (resolved_type) && init != error_mark_node)
+    TREE_READONLY (static_global->get_decl ()) = 1;
+
+  // and a thread-local one before it picks the .tdata or .tbss one
+  if (auto model = thread_local_model (var))
+    set_decl_tls_model (static_global->get_decl (), *model);
+
   Backend::global_variable_set_init (static_global, init);
 
   ctx->insert_var_decl (var.get_mappings ().get_hirid (), static_global);
   ctx->push_var (static_global);
+  ctx->place_var (static_global, *canonical_path);
 
   reference = Backend::var_expression (static_global, ref_locus);
 }
 
+/* Return the value of the compiled constant DECL as a Rust literal, if it is
+   a bool or an integer.  */
+
+static tl::optional<std::string>
+scalar_const_value (tree decl, const TyTy::BaseType *type)
+{
+  if (decl == error_mark_node || TREE_CODE (decl) != CONST_DECL)
+    return tl::nullopt;
+
+  tree value = DECL_INITIAL (decl);
+  if (value == NULL_TREE || TREE_CODE (value) != INTEGER_CST
+      || TREE_OVERFLOW (value))
+    return tl::nullopt;
+
+  switch (type->get_kind ())
+    {
+    case TyTy::TypeKind::BOOL:
+      return std::string (integer_zerop (value) ? "false" : "true");
+
+    case TyTy::TypeKind::INT:
+    case TyTy::TypeKind::UINT:
+    case TyTy::TypeKind::ISIZE:
+      case TyTy::TypeKind::USIZE: {
+	// the minimum of a signed type cannot be written as a negated literal
+	auto v = wi::to_wide (value);
+	signop sign = TYPE_SIGN (TREE_TYPE (value));
+	if (sign == SIGNED
+	    && wi::eq_p (v, wi::min_value (TYPE_PRECISION (TREE_TYPE (value)),
+					   SIGNED)))
+	  return tl::nullopt;
+
+	char buf[WIDE_INT_PRINT_BUFFER_SIZE];
+	print_dec (v, buf, sign);
+	return std::string (buf);
+      }
+
+    default:
+      return tl::nullopt;
+    }
+}
+
 void
 CompileItem::visit (HIR::ConstantItem &constant)
 {
@@ -112,6 +191,12 @@ CompileItem::visit (HIR::ConstantItem &constant)
 			     constant.get_locus ());
   ctx->pop_const_context ();
 
+  // dependent crates import the value rather than evaluating it again
+  if (auto value = scalar_const_value (const_expr, resolved_type))
+    ctx->get_mappings ().insert_const_value (mappings.get_hirid (),
+					     resolved_type->as_string (),
+					     value.value ());
+
   ctx->push_const (const_expr);
   ctx->insert_const_decl (mappings.get_hirid (), const_expr);
   reference = const_expr;
@@ -120,6 +205,10 @@ CompileItem::visit (HIR::ConstantItem &constant)
 void
 CompileItem::visit (HIR::Function &function)
 {
+  // dead private functions are only compiled if something refers to them
+  if (!is_query_mode && ctx->is_dead_function (function))
+    return;
+
   TyTy::BaseType *fntype_tyty;
   if (!ctx->get_tyctx ()->lookup_type (function.get_mappings ().get_hirid (),
 				       &fntype_tyty))
@@ -159,6 +248,18 @@ CompileItem::visit (HIR::Function &function)
 	}
     }
 
+  // items can be forward compiled which means we may not need to invoke this
+  // code. We might also have already compiled this generic function as well.
+  // Most references are to such functions, so look for an instance before
+  // paying for the canonical path and the mangled name.
+  tree lookup = NULL_TREE;
+  if (ctx->lookup_function_decl (fntype->get_ty_ref (), &lookup,
+				 fntype->get_id (), fntype))
+    {
+      reference = address_expression (lookup, ref_locus);
+      return;
+    }
+
   Resolver::CanonicalPath canonical_path
     = Resolver::CanonicalPath::create_empty ();
 
@@ -180,11 +281,9 @@ CompileItem::visit (HIR::Function &function)
       canonical_path = *path;
     }
 
-  const std::string asm_name = ctx->mangle_item (fntype, canonical_path);
-
-  // items can be forward compiled which means we may not need to invoke this
-  // code. We might also have already compiled this generic function as well.
-  tree lookup = NULL_TREE;
+  // an instance which is not is_equal to this one can still have the same
+  // symbol
+  const std::string &asm_name = ctx->mangle_item (fntype, canonical_path);
   if (ctx->lookup_function_decl (fntype->get_ty_ref (), &lookup,
 				 fntype->get_id (), fntype, asm_name))
     {
@@ -192,6 +291,16 @@ CompileItem::visit (HIR::Function &function)
       return;
     }
 
+  if (flag_rust_share_generics && fntype->has_substitutions_defined ()
+      && !function.get_qualifiers ().is_const ()
+      && ctx->get_mappings ().is_upstream_instance (asm_name))
+    {
+      tree fndecl = compile_upstream_instance (asm_name, function.get_locus (),
+					       canonical_path, fntype);
+      reference = address_expression (fndecl, ref_locus);
+      return;
+    }
+
   if (fntype->has_substitutions_defined ())
     {
       // override the Hir Lookups for the substituions in this context
@@ -201,6 +310,12 @@ CompileItem::visit (HIR::Function &function)
   if (function.get_qualifiers ().is_const ())
     ctx->push_const_context ();
 
+  // the body of a const fn must be available to the constant evaluator of its
+  // callers
+  bool defer_body = ctx->defer_fn_bodies ()
+		    && fntype->has_substitutions_defined ()
+		    && !ctx->const_context_p ();
+
   tree fndecl
     = compile_function (function.get_function_name ().as_string (),
 			function.get_self_param (),
@@ -208,13 +323,32 @@ CompileItem::visit (HIR::Function &function)
 			function.get_qualifiers (), function.get_visibility (),
 			function.get_outer_attrs (), function.get_locus (),
 			function.get_definition ().get (), canonical_path,
-			fntype);
+			fntype, defer_body);
   reference = address_expression (fndecl, ref_locus);
 
   if (function.get_qualifiers ().is_const ())
     ctx->pop_const_context ();
 }
 
+void
+CompileItem::compile_deferred_fn_body (Context *ctx,
+				       const Context::DeferredFnBody &body)
+{
+  CompileItem compiler (ctx, body.fntype, UNDEF_LOCATION);
+
+  // the body starts from an empty statement state and must leave it so
+  FunctionState outer = ctx->swap_function_state (FunctionState ());
+
+  // the substitutions of the instance which queued this body are gone by now
+  body.fntype->override_context ();
+  compiler.compile_function_definition (body.fndecl, *body.self_param,
+					*body.function_params, body.locus,
+					body.function_body, body.fntype);
+
+  FunctionState state = ctx->swap_function_state (std::move (outer));
+  rust_assert (state.empty ());
+}
+
 void
 CompileItem::visit (HIR::ImplBlock &impl_block)
 {
@@ -34,7 +34,7 @@ public:
 		       bool is_query_mode = false,
 		       location_t ref_locus = UNDEF_LOCATION)
   {
-    CompileItem compiler (ctx, concrete, ref_locus);
+    CompileItem compiler (ctx, concrete, is_query_mode, ref_locus);
     item->accept_vis (compiler);
 
     if (is_query_mode && compiler.reference == error_mark_node)
@@ -44,6 +44,10 @@ public:
     return compiler.reference;
   }
 
+  // Compile the body of a function queued while the crate was compiled
+  static void compile_deferred_fn_body (Context *ctx,
+				       const Context::DeferredFnBody &body);
+
   void visit (HIR::StaticItem &var) override;
   void visit (HIR::ConstantItem &constant) override;
   void visit (HIR::Function &function) override;
@@ -72,13 +76,15 @@ public:
   void visit (HIR::ExprStmt &) override {}
 
 protected:
-  CompileItem (Context *ctx, TyTy::BaseType *concrete, location_t ref_locus)
+  CompileItem (Context *ctx, TyTy::BaseType *concrete, bool is_query_mode,
+	       location_t ref_locus)
     : HIRCompileBase (ctx), concrete (concrete), reference (error_mark_node),
-      ref_locus (ref_locus)
+      is_query_mode (is_query_mode), ref_locus (ref_locus)
   {}
 
   TyTy::BaseType *concrete;
   tree reference;
+  bool is_query_mode;
   location_t ref_locus;
 };
 
@@ -21,10 +21,54 @@
 #include "rust-compile-resolve-path.h"
 #include "rust-constexpr.h"
 #include "rust-compile-type.h"
+#include "rust-builtins.h"
+#include "selftest.h"
 
 namespace Rust {
 namespace Compile {
 
+// Compare the bytes of the `&str` SCRUTINEE with the string literal VALUE,
+// assuming the lengths are already known to be equal. The size given to
+// memcmp is a constant so that the comparison can be expanded inline.
+static tree
+compile_str_bytes_check (Context *ctx, tree scrutinee, const std::string &value,
+			 location_t locus)
+{
+  if (value.empty ())
+    return boolean_true_node;
+
+  tree base = ctx->lookup_string_literal (value, NULL_TREE);
+  if (base == NULL_TREE)
+    {
+      base = Backend::string_constant_expression (value);
+      ctx->insert_string_literal (value, NULL_TREE, base);
+    }
+
+  tree memcmp_raw = nullptr;
+  BuiltinsContext::get ().lookup_simple_builtin ("__builtin_memcmp",
+						 &memcmp_raw);
+  rust_assert (memcmp_raw);
+  tree memcmp = build_fold_addr_expr_loc (locus, memcmp_raw);
+
+  tree data = Backend::struct_field_expression (scrutinee, 0, locus);
+  tree call
+    = Backend::call_expression (memcmp,
+				{data, build_fold_addr_expr_loc (locus, base),
+				 size_int (value.size ())},
+				nullptr, locus);
+
+  return Backend::comparison_expression (ComparisonOperator::EQUAL, call,
+					 integer_zero_node, locus);
+}
+
+// The length of the `&str` SCRUTINEE as a constant of its type
+static tree
+compile_str_length (tree scrutinee, const std::string &value, location_t locus)
+{
+  tree len = Backend::struct_field_expression (scrutinee, 1, locus);
+  return build_int_cstu (TREE_TYPE (len), value.size ());
+}
+
 void
 CompilePatternCheckExpr::visit (HIR::PathInExpression &pattern)
 {
@@ -67,8 +111,11 @@ CompilePatternCheckExpr::visit (HIR::PathInExpression &pattern)
   // must be enum
   match_scrutinee_expr = scrutinee_expr_qualifier_expr;
 
+  // the discriminant field may be narrower than the discriminant expression
   HIR::Expr *discrim_expr = variant->get_discriminant ();
-  tree discrim_expr_node = CompileExpr::Compile (discrim_expr, ctx);
+  tree discrim_expr_node
+    = fold_convert (TREE_TYPE (scrutinee_expr_qualifier_expr),
+		    CompileExpr::Compile (discrim_expr, ctx));
 
   check_expr
     = Backend::comparison_expression (ComparisonOperator::EQUAL,
@@ -95,6 +142,23 @@ CompilePatternCheckExpr::visit (HIR::LiteralPattern &pattern)
       rust_sorry_at (pattern.get_locus (), "floating-point literal in pattern");
     }
 
+  // the bytes of a string are only compared once the lengths are equal
+  if (pattern.get_literal ().get_lit_type () == HIR::Literal::LitType::STRING)
+    {
+      const std::string &value = pattern.get_literal ().as_string ();
+      location_t locus = pattern.get_locus ();
+      tree len_check = Backend::comparison_expression (
+	ComparisonOperator::EQUAL,
+	Backend::struct_field_expression (match_scrutinee_expr, 1, locus),
+	compile_str_length (match_scrutinee_expr, value, locus), locus);
+
+      check_expr = Backend::lazy_boolean_expression (
+	LazyBooleanOperator::LOGICAL_AND, len_check,
+	compile_str_bytes_check (ctx, match_scrutinee_expr, value, locus),
+	locus);
+      return;
+    }
+
   tree lit = CompileExpr::Compile (litexpr, ctx);
 
   check_expr = Backend::comparison_expression (ComparisonOperator::EQUAL,
@@ -240,6 +304,9 @@ CompilePatternCheckExpr::visit (HIR::StructPattern &pattern)
 	= Backend::struct_field_expression (scrutinee_record_expr, 0,
 					    pattern.get_path ().get_locus ());
 
+      discrim_expr_node
+	= fold_convert (TREE_TYPE (scrutinee_expr_qualifier_expr),
+			discrim_expr_node);
       check_expr
 	= Backend::comparison_expression (ComparisonOperator::EQUAL,
 					  scrutinee_expr_qualifier_expr,
@@ -339,6 +406,9 @@ CompilePatternCheckExpr::visit (HIR::TupleStructPattern &pattern)
 	= Backend::struct_field_expression (scrutinee_record_expr, 0,
 					    pattern.get_path ().get_locus ());
 
+      discrim_expr_node
+	= fold_convert (TREE_TYPE (scrutinee_expr_qualifier_expr),
+			discrim_expr_node);
       check_expr
 	= Backend::comparison_expression (ComparisonOperator::EQUAL,
 					  scrutinee_expr_qualifier_expr,
@@ -429,6 +499,290 @@ CompilePatternCheckExpr::visit (HIR::TuplePattern &pattern)
 
 // setup the bindings
 
+void
+CompilePatternCaseLabels::add_label (tree low, tree high)
+{
+  if (low != NULL_TREE)
+    low = fold_expr (low);
+  if (high != NULL_TREE)
+    high = fold_expr (high);
+
+  if (low == NULL_TREE || TREE_CODE (low) != INTEGER_CST
+      || (high != NULL_TREE && TREE_CODE (high) != INTEGER_CST))
+    {
+      ok = false;
+      return;
+    }
+
+  labels.push_back ({low, high});
+}
+
+bool
+CompilePatternCaseLabels::sort_cases (
+  tree cond_type, const std::vector<std::vector<CaseRange>> &labels,
+  std::vector<SwitchCase> &cases)
+{
+  std::vector<std::pair<SwitchCase, size_t>> entries;
+  for (size_t i = 0; i < labels.size (); i++)
+    for (auto &label : labels[i])
+      {
+	tree low = fold_convert (cond_type, label.first);
+	tree high = label.second == NULL_TREE
+		      ? low
+		      : fold_convert (cond_type, label.second);
+	if (tree_int_cst_lt (high, low))
+	  return false;
+
+	entries.push_back ({{low, high, {}}, i});
+      }
+
+  // sorting keeps the arms of a label in order
+  std::stable_sort (entries.begin (), entries.end (),
+		    [] (const std::pair<SwitchCase, size_t> &a,
+			const std::pair<SwitchCase, size_t> &b) {
+		      if (!tree_int_cst_equal (a.first.low, b.first.low))
+			return tree_int_cst_lt (a.first.low, b.first.low);
+		      return tree_int_cst_lt (a.first.high, b.first.high);
+		    });
+
+  for (auto &entry : entries)
+    {
+      SwitchCase &c = entry.first;
+      if (!cases.empty () && tree_int_cst_equal (cases.back ().low, c.low)
+	  && tree_int_cst_equal (cases.back ().high, c.high))
+	{
+	  cases.back ().arms.push_back (entry.second);
+	  continue;
+	}
+
+      if (!cases.empty () && !tree_int_cst_lt (cases.back ().high, c.low))
+	return false;
+
+      cases.push_back ({c.low, c.high, {entry.second}});
+    }
+
+  return true;
+}
+
+bool
+CompilePatternCaseLabels::is_irrefutable (HIR::Pattern &pattern)
+{
+  switch (pattern.get_pattern_type ())
+    {
+    case HIR::Pattern::PatternType::WILDCARD:
+      return true;
+
+    case HIR::Pattern::PatternType::IDENTIFIER:
+      return !static_cast<HIR::IdentifierPattern &> (pattern)
+		.has_pattern_to_bind ();
+
+    default:
+      return false;
+    }
+}
+
+void
+CompilePatternCaseLabels::add_check (tree check, location_t locus)
+{
+  if (check_expr == NULL_TREE)
+    check_expr = check;
+  else
+    check_expr = Backend::arithmetic_or_logical_expression (
+      ArithmeticOrLogicalOperator::BITWISE_AND, check_expr, check, locus);
+}
+
+TyTy::VariantDef *
+CompilePatternCaseLabels::add_variant (HIR::PathInExpression &path,
+				       int *variant_index)
+{
+  TyTy::BaseType *lookup = nullptr;
+  bool found
+    = ctx->get_tyctx ()->lookup_type (path.get_mappings ().get_hirid (),
+				      &lookup);
+  if (!found || lookup->get_kind () != TyTy::TypeKind::ADT
+      || !static_cast<TyTy::ADTType *> (lookup)->is_enum ())
+    {
+      ok = false;
+      return nullptr;
+    }
+  TyTy::ADTType *adt = static_cast<TyTy::ADTType *> (lookup);
+
+  HirId variant_id;
+  TyTy::VariantDef *variant = nullptr;
+  if (!ctx->get_tyctx ()->lookup_variant_definition (
+	path.get_mappings ().get_hirid (), &variant_id)
+      || !adt->lookup_variant_by_id (variant_id, &variant, variant_index))
+    {
+      ok = false;
+      return nullptr;
+    }
+
+  add_label (CompileExpr::Compile (variant->get_discriminant (), ctx),
+	     NULL_TREE);
+  return ok ? variant : nullptr;
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::PathInExpression &pattern)
+{
+  int variant_index = 0;
+  add_variant (pattern, &variant_index);
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::LiteralPattern &pattern)
+{
+  // floating point literals are diagnosed by CompilePatternCheckExpr
+  if (pattern.get_literal ().get_lit_type () == HIR::Literal::LitType::FLOAT)
+    {
+      ok = false;
+      return;
+    }
+
+  // strings are switched on their length, the bytes are the sub-test
+  if (pattern.get_literal ().get_lit_type () == HIR::Literal::LitType::STRING)
+    {
+      const std::string &value = pattern.get_literal ().as_string ();
+      location_t locus = pattern.get_locus ();
+      add_label (compile_str_length (match_scrutinee_expr, value, locus),
+		 NULL_TREE);
+      if (!value.empty ())
+	add_check (compile_str_bytes_check (ctx, match_scrutinee_expr, value,
+					    locus),
+		   locus);
+      return;
+    }
+
+  HIR::LiteralExpr *litexpr
+    = new HIR::LiteralExpr (pattern.get_mappings (), pattern.get_literal (),
+			    pattern.get_locus (),
+			    std::vector<AST::Attribute> ());
+
+  add_label (CompileExpr::Compile (litexpr, ctx), NULL_TREE);
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::RangePattern &pattern)
+{
+  tree lower = compile_range_pattern_bound (pattern.get_lower_bound ().get (),
+					    pattern.get_mappings (),
+					    pattern.get_locus (), ctx);
+  tree upper = compile_range_pattern_bound (pattern.get_upper_bound ().get (),
+					    pattern.get_mappings (),
+					    pattern.get_locus (), ctx);
+
+  add_label (lower, upper);
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::AltPattern &pattern)
+{
+  // the sub-tests of one alternative cannot be told apart from those of
+  // another once they share the arm
+  for (auto &alt : pattern.get_alts ())
+    {
+      alt->accept_vis (*this);
+      if (check_expr != NULL_TREE)
+	ok = false;
+    }
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::StructPattern &pattern)
+{
+  int variant_index = 0;
+  TyTy::VariantDef *variant = add_variant (pattern.get_path (), &variant_index);
+  if (variant == nullptr)
+    return;
+
+  tree variant_record
+    = Backend::struct_field_expression (match_scrutinee_expr, variant_index,
+					pattern.get_path ().get_locus ());
+
+  auto &elems = pattern.get_struct_pattern_elems ();
+  for (auto &field : elems.get_struct_pattern_fields ())
+    {
+      switch (field->get_item_type ())
+	{
+	case HIR::StructPatternField::ItemType::TUPLE_PAT:
+	  ok = false;
+	  break;
+
+	  case HIR::StructPatternField::ItemType::IDENT_PAT: {
+	    auto &ident
+	      = static_cast<HIR::StructPatternFieldIdentPat &> (*field.get ());
+	    HIR::Pattern &sub = *ident.get_pattern ();
+	    if (is_irrefutable (sub))
+	      break;
+
+	    size_t offs = 0;
+	    if (!variant->lookup_field (ident.get_identifier ().as_string (),
+					nullptr, &offs))
+	      {
+		ok = false;
+		break;
+	      }
+
+	    // the first field of the record is the discriminant
+	    tree field_expr
+	      = Backend::struct_field_expression (variant_record, offs + 1,
+						  ident.get_locus ());
+	    add_check (CompilePatternCheckExpr::Compile (&sub, field_expr, ctx),
+		       sub.get_locus ());
+	  }
+	  break;
+
+	case HIR::StructPatternField::ItemType::IDENT:
+	  break;
+	}
+    }
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::TupleStructPattern &pattern)
+{
+  std::unique_ptr<HIR::TupleStructItems> &items = pattern.get_items ();
+  if (items->get_item_type () != HIR::TupleStructItems::MULTIPLE)
+    {
+      ok = false;
+      return;
+    }
+
+  int variant_index = 0;
+  if (add_variant (pattern.get_path (), &variant_index) == nullptr)
+    return;
+
+  tree variant_record
+    = Backend::struct_field_expression (match_scrutinee_expr, variant_index,
+					pattern.get_path ().get_locus ());
+
+  // the first field of the record is the discriminant
+  size_t field_index = 1;
+  auto &items_no_range
+    = static_cast<HIR::TupleStructItemsNoRange &> (*items.get ());
+  for (auto &sub : items_no_range.get_patterns ())
+    {
+      size_t index = field_index++;
+      if (is_irrefutable (*sub))
+	continue;
+
+      tree field_expr
+	= Backend::struct_field_expression (variant_record, index,
+					    sub->get_locus ());
+      add_check (CompilePatternCheckExpr::Compile (sub.get (), field_expr, ctx),
+		 sub->get_locus ());
+    }
+}
+
+void
+CompilePatternCaseLabels::visit (HIR::IdentifierPattern &pattern)
+{
+  if (pattern.has_pattern_to_bind ())
+    ok = false;
+  else
+    is_default = true;
+}
+
 void
 CompilePatternBindings::visit (HIR::TupleStructPattern &pattern)
 {
@@ -746,3 +1100,63 @@ CompilePatternLet::visit (HIR::TuplePattern &pattern)
 
 } // namespace Compile
 } // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_compile_pattern_test (void)
+{
+  using Rust::Compile::CompilePatternCaseLabels;
+  using CaseRange = CompilePatternCaseLabels::CaseRange;
+
+  auto cst = [] (HOST_WIDE_INT value) {
+    return build_int_cst (integer_type_node, value);
+  };
+  auto value = [] (tree t) { return tree_to_shwi (t); };
+
+  // the arms of a label are kept in order, the cases sorted by value
+  std::vector<std::vector<CaseRange>> labels
+    = {{{cst (7), NULL_TREE}},
+       {{cst (3), cst (5)}, {cst (1), NULL_TREE}},
+       {{cst (7), NULL_TREE}},
+       {{build_int_cst (unsigned_char_type_node, 9), NULL_TREE}}};
+  std::vector<CompilePatternCaseLabels::SwitchCase> cases;
+  ASSERT_TRUE (
+    CompilePatternCaseLabels::sort_cases (long_integer_type_node, labels,
+					  cases));
+  ASSERT_EQ (cases.size (), 4);
+
+  ASSERT_EQ (value (cases[0].low), 1);
+  ASSERT_EQ (value (cases[0].high), 1);
+  ASSERT_EQ (cases[0].arms, std::vector<size_t> ({1}));
+
+  ASSERT_EQ (value (cases[1].low), 3);
+  ASSERT_EQ (value (cases[1].high), 5);
+  ASSERT_EQ (cases[1].arms, std::vector<size_t> ({1}));
+
+  ASSERT_EQ (value (cases[2].low), 7);
+  ASSERT_EQ (cases[2].arms, std::vector<size_t> ({0, 2}));
+
+  // the labels are converted to the type of the switched value
+  ASSERT_EQ (value (cases[3].low), 9);
+  ASSERT_EQ (TREE_TYPE (cases[3].low), long_integer_type_node);
+  ASSERT_EQ (cases[3].arms, std::vector<size_t> ({3}));
+
+  // distinct labels which overlap
+  labels = {{{cst (1), cst (4)}}, {{cst (4), NULL_TREE}}};
+  cases.clear ();
+  ASSERT_FALSE (
+    CompilePatternCaseLabels::sort_cases (integer_type_node, labels, cases));
+
+  // an empty range
+  labels = {{{cst (5), cst (2)}}};
+  cases.clear ();
+  ASSERT_FALSE (
+    CompilePatternCaseLabels::sort_cases (integer_type_node, labels, cases));
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
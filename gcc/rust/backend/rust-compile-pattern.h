@@ -67,6 +67,86 @@ public:
   tree check_expr;
 };
 
+/* The case labels a match arm pattern stands for, when the match can be
+   lowered to a SWITCH_EXPR on an integer scrutinee or on the discriminant of
+   an enum. The fields of a variant pattern which are refutable become a
+   sub-test, which only has to be checked once the switch has picked the
+   variant. Other patterns which need to test more than the switched value
+   cannot be lowered that way.  */
+class CompilePatternCaseLabels : public HIRCompileBase,
+				 public HIR::HIRPatternVisitor
+{
+public:
+  // A range of values, HIGH is NULL_TREE for a single value
+  using CaseRange = std::pair<tree, tree>;
+
+  // A case of a switch, with the indices of the arms labelled by its range
+  struct SwitchCase
+  {
+    tree low;
+    tree high;
+    std::vector<size_t> arms;
+  };
+
+  // Append the case labels of PATTERN to LABELS, or set IS_DEFAULT if it
+  // matches any value. The sub-test, if any, is stored in CHECK_EXPR.
+  // Returns false if PATTERN cannot be lowered to case labels.
+  static bool Compile (HIR::Pattern *pattern, tree match_scrutinee_expr,
+		       Context *ctx, std::vector<CaseRange> &labels,
+		       bool &is_default, tree &check_expr)
+  {
+    CompilePatternCaseLabels compiler (ctx, match_scrutinee_expr, labels);
+    pattern->accept_vis (compiler);
+    if (compiler.is_default)
+      is_default = true;
+    check_expr = compiler.check_expr;
+    return compiler.ok;
+  }
+
+  // Convert the LABELS of each arm to COND_TYPE and gather them into CASES,
+  // sorted by value. The arms sharing a label are kept in order. Returns
+  // false if a range is empty or if distinct labels overlap, since those would
+  // need the arms of both.
+  static bool sort_cases (tree cond_type,
+			  const std::vector<std::vector<CaseRange>> &labels,
+			  std::vector<SwitchCase> &cases);
+
+  void visit (HIR::PathInExpression &pattern) override;
+  void visit (HIR::LiteralPattern &pattern) override;
+  void visit (HIR::RangePattern &pattern) override;
+  void visit (HIR::AltPattern &pattern) override;
+  void visit (HIR::StructPattern &pattern) override;
+  void visit (HIR::TupleStructPattern &pattern) override;
+  void visit (HIR::IdentifierPattern &pattern) override;
+  void visit (HIR::WildcardPattern &) override { is_default = true; }
+
+  // Patterns which need more than a switch on a single value
+  void visit (HIR::QualifiedPathInExpression &) override { ok = false; }
+  void visit (HIR::ReferencePattern &) override { ok = false; }
+  void visit (HIR::TuplePattern &) override { ok = false; }
+  void visit (HIR::SlicePattern &) override { ok = false; }
+
+private:
+  CompilePatternCaseLabels (Context *ctx, tree match_scrutinee_expr,
+			    std::vector<CaseRange> &labels)
+    : HIRCompileBase (ctx), match_scrutinee_expr (match_scrutinee_expr),
+      labels (labels), check_expr (NULL_TREE), ok (true), is_default (false)
+  {}
+
+  void add_label (tree low, tree high);
+  void add_check (tree check, location_t locus);
+  TyTy::VariantDef *add_variant (HIR::PathInExpression &path,
+				 int *variant_index);
+
+  static bool is_irrefutable (HIR::Pattern &pattern);
+
+  tree match_scrutinee_expr;
+  std::vector<CaseRange> &labels;
+  tree check_expr;
+  bool ok;
+  bool is_default;
+};
+
 class CompilePatternBindings : public HIRCompileBase,
 			       public HIR::HIRPatternVisitor
 {
@@ -185,3 +265,12 @@ protected:
 
 } // namespace Compile
 } // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_compile_pattern_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -26,6 +26,7 @@
 #include "rust-hir-trait-resolve.h"
 #include "rust-hir-path-probe.h"
 #include "rust-compile-extern.h"
+#include "rust-compile-type.h"
 #include "rust-constexpr.h"
 #include "rust-tyty.h"
 
@@ -166,6 +167,28 @@ ResolvePathRef::resolve (const HIR::PathIdentSegment &final_segment,
       return binding;
     }
 
+  // a const generic parameter is its value in the instance being compiled
+  auto generic_param = ctx->get_mappings ().lookup_hir_generic_param (ref);
+  if (generic_param
+      && generic_param.value ()->get_kind ()
+	   == HIR::GenericParam::GenericKind::CONST)
+    {
+      TyTy::BaseType *param = nullptr;
+      ok = ctx->get_tyctx ()->lookup_type (ref, &param);
+      rust_assert (ok);
+
+      TyTy::BaseType *value = param->destructure ();
+      if (value->get_kind () != TyTy::TypeKind::CONST)
+	{
+	  rust_error_at (expr_locus, "value of const parameter %qs is unknown",
+			 final_segment.as_string ().c_str ());
+	  return error_mark_node;
+	}
+
+      return TyTyResolveCompile::compile_const_value (
+	ctx, *value->as<TyTy::ConstType> ());
+    }
+
   // it might be a function call
   if (lookup->get_kind () == TyTy::TypeKind::FNDEF)
     {
@@ -20,8 +20,10 @@
 #include "rust-compile-expr.h"
 #include "rust-constexpr.h"
 #include "rust-gcc.h"
+#include "rust-tyty-intern.h"
 
 #include "tree.h"
+#include "selftest.h"
 
 namespace Rust {
 namespace Compile {
@@ -39,6 +41,15 @@ TyTyResolveCompile::compile (Context *ctx, const TyTy::BaseType *ty,
 {
   TyTyResolveCompile compiler (ctx, trait_object_mode);
   const TyTy::BaseType *destructured = ty->destructure ();
+
+  // structurally identical types only need to be compiled once
+  const TyTy::BaseType *interned
+    = TyTy::TypeInterner::get ().intern (destructured);
+  tree cached = error_mark_node;
+  if (interned != nullptr
+      && ctx->lookup_interned_type (interned, trait_object_mode, &cached))
+    return cached;
+
   destructured->accept_vis (compiler);
 
   if (compiler.translated != error_mark_node
@@ -48,6 +59,10 @@ TyTyResolveCompile::compile (Context *ctx, const TyTy::BaseType *ty,
       compiler.translated = ctx->insert_compiled_type (compiler.translated);
     }
 
+  if (interned != nullptr && compiler.translated != error_mark_node)
+    ctx->insert_interned_type (interned, trait_object_mode,
+			       compiler.translated);
+
   return compiler.translated;
 }
 
@@ -87,6 +102,77 @@ TyTyResolveCompile::get_implicit_enumeral_node_type ()
   return enum_node;
 }
 
+// The discriminant of an enum is stored in the integer type given with
+// #[repr(...)], in the C int type of the target for #[repr(C)], or else in the
+// smallest integer type that can hold the discriminants of all of its
+// variants.
+tree
+TyTyResolveCompile::create_enum_discriminant_type (const TyTy::ADTType &type)
+{
+  TyTy::ADTType::ReprOptions repr = type.get_repr_options ();
+  if (repr.repr != nullptr)
+    return TyTyResolveCompile::compile (ctx, repr.repr);
+
+  // the enum must have the layout C code gives it
+  if (repr.is_c)
+    return integer_type_node;
+
+  widest_int min = 0;
+  widest_int max = 0;
+  bool is_constant = true;
+
+  ctx->push_const_context ();
+  for (auto &variant : type.get_variants ())
+    {
+      tree discrim_expr_node
+	= fold_expr (CompileExpr::Compile (variant->get_discriminant (), ctx));
+      if (TREE_CODE (discrim_expr_node) != INTEGER_CST)
+	{
+	  is_constant = false;
+	  break;
+	}
+
+      widest_int value = wi::to_widest (discrim_expr_node);
+      min = wi::smin (min, value);
+      max = wi::smax (max, value);
+    }
+  ctx->pop_const_context ();
+
+  if (!is_constant)
+    return TyTyResolveCompile::get_implicit_enumeral_node_type ();
+
+  std::string name = discriminant_type_name (min, max);
+  TyTy::BaseType *discriminant_type = nullptr;
+  bool ok = ctx->get_tyctx ()->lookup_builtin (name, &discriminant_type);
+  rust_assert (ok);
+
+  return TyTyResolveCompile::compile (ctx, discriminant_type);
+}
+
+std::string
+TyTyResolveCompile::discriminant_type_name (const widest_int &min,
+					    const widest_int &max)
+{
+  bool is_unsigned = wi::ges_p (min, 0);
+  signop sgn = is_unsigned ? UNSIGNED : SIGNED;
+  unsigned precision
+    = MAX (wi::min_precision (min, sgn), wi::min_precision (max, sgn));
+
+  std::string name = is_unsigned ? "u" : "i";
+  if (precision <= 8)
+    name += "8";
+  else if (precision <= 16)
+    name += "16";
+  else if (precision <= 32)
+    name += "32";
+  else if (precision <= 64)
+    name += "64";
+  else
+    name += "128";
+
+  return name;
+}
+
 tree
 TyTyResolveCompile::get_unit_type ()
 {
@@ -144,6 +230,51 @@ TyTyResolveCompile::visit (const TyTy::PlaceholderType &type)
   translated = error_mark_node;
 }
 
+tree
+TyTyResolveCompile::compile_const_value (Context *ctx,
+					 const TyTy::ConstType &value)
+{
+  tree type = TyTyResolveCompile::compile (ctx, value.get_value_type ());
+  if (type == error_mark_node)
+    return error_mark_node;
+
+  mpz_t ival;
+  if (mpz_init_set_str (ival, value.get_value ().c_str (), 10) != 0)
+    {
+      mpz_clear (ival);
+      return error_mark_node;
+    }
+
+  mpz_t type_min;
+  mpz_t type_max;
+  mpz_init (type_min);
+  mpz_init (type_max);
+  get_type_static_bounds (type, type_min, type_max);
+
+  tree result = error_mark_node;
+  if (mpz_cmp (ival, type_min) < 0 || mpz_cmp (ival, type_max) > 0)
+    rust_error_at (value.get_ident ().locus,
+		   "constant %qs overflows the type %<%s%>",
+		   value.as_string ().c_str (),
+		   value.get_value_type ()->get_name ().c_str ());
+  else
+    result = wide_int_to_tree (type, wi::from_mpz (type, ival, true));
+
+  mpz_clear (type_min);
+  mpz_clear (type_max);
+  mpz_clear (ival);
+
+  return result;
+}
+
+void
+TyTyResolveCompile::visit (const TyTy::ConstType &)
+{
+  // values are not types, they are only compiled as array lengths and as
+  // the values of const generic parameters
+  translated = error_mark_node;
+}
+
 void
 TyTyResolveCompile::visit (const TyTy::ClosureType &type)
 {
@@ -206,17 +337,31 @@ TyTyResolveCompile::visit (const TyTy::FnType &type)
 	Backend::typed_identifier ("_", ret, return_type_locus));
     }
 
+  // the Rust functions take the fat pointers as their two fields, which the
+  // targets pass in registers where they would pass the record in memory
+  bool split_fat_pointers = type.get_abi () == ABI::RUST;
   for (auto &param_pair : type.get_params ())
     {
       auto param_tyty = param_pair.second;
       auto compiled_param_type
 	= TyTyResolveCompile::compile (ctx, param_tyty, trait_object_mode);
+      auto param_name = param_pair.first->as_string ();
+      auto param_locus
+	= ctx->get_mappings ().lookup_location (param_tyty->get_ref ());
 
-      auto compiled_param = Backend::typed_identifier (
-	param_pair.first->as_string (), compiled_param_type,
-	ctx->get_mappings ().lookup_location (param_tyty->get_ref ()));
+      if (split_fat_pointers && Backend::is_scalar_pair (compiled_param_type))
+	{
+	  for (tree field = TYPE_FIELDS (compiled_param_type);
+	       field != NULL_TREE; field = DECL_CHAIN (field))
+	    parameters.push_back (
+	      Backend::typed_identifier (param_name, TREE_TYPE (field),
+					 param_locus));
+	  continue;
+	}
 
-      parameters.push_back (compiled_param);
+      parameters.push_back (Backend::typed_identifier (param_name,
+						       compiled_param_type,
+						       param_locus));
     }
 
   if (!type.is_variadic ())
@@ -235,10 +380,21 @@ TyTyResolveCompile::visit (const TyTy::FnPtr &type)
 
   std::vector<tree> parameters;
 
+  // as for the functions they point to, only the Rust ones take the fat
+  // pointers as their two fields
+  bool split_fat_pointers = type.get_abi () == ABI::RUST;
   auto &params = type.get_params ();
   for (auto &p : params)
     {
       tree pty = TyTyResolveCompile::compile (ctx, p.get_tyty ());
+      if (split_fat_pointers && Backend::is_scalar_pair (pty))
+	{
+	  for (tree field = TYPE_FIELDS (pty); field != NULL_TREE;
+	       field = DECL_CHAIN (field))
+	    parameters.push_back (TREE_TYPE (field));
+	  continue;
+	}
+
       parameters.push_back (pty);
     }
 
@@ -246,10 +402,101 @@ TyTyResolveCompile::visit (const TyTy::FnPtr &type)
 					   type.get_ident ().locus);
 }
 
+// Only the default representation leaves the order of the fields up to us
+static bool
+can_reorder_fields (const TyTy::ADTType &type)
+{
+  TyTy::ADTType::ReprOptions repr = type.get_repr_options ();
+  return flag_rust_reorder_fields && !repr.is_c && !repr.is_transparent
+	 && !repr.pack && repr.repr == nullptr;
+}
+
+// Describe the layout of TYPE for -frust-dump-layout
+static void
+dump_layout (const std::string &name, tree type, location_t locus)
+{
+  if (type == error_mark_node || !tree_fits_uhwi_p (TYPE_SIZE_UNIT (type)))
+    return;
+
+  rust_inform (locus, "layout of %qs: %wu bytes, alignment %u", name.c_str (),
+	       tree_to_uhwi (TYPE_SIZE_UNIT (type)), TYPE_ALIGN_UNIT (type));
+
+  if (TREE_CODE (type) != RECORD_TYPE)
+    return;
+
+  for (tree field = TYPE_FIELDS (type); field != NULL_TREE;
+       field = DECL_CHAIN (field))
+    rust_inform (locus, "field %qs at offset %wd",
+		 IDENTIFIER_POINTER (DECL_NAME (field)),
+		 int_byte_position (field));
+}
+
+// A #[repr(simd)] struct is a vector of its fields, which must all have the
+// same integer or floating point type. Vector types need a power of two
+// number of elements.
+tree
+TyTyResolveCompile::create_simd_vector_type (const TyTy::ADTType &type)
+{
+  location_t locus = type.get_ident ().locus;
+  TyTy::VariantDef &variant = *type.get_variants ().at (0);
+  if (variant.num_fields () == 0)
+    {
+      rust_error_at (locus, "SIMD vector cannot be empty");
+      return error_mark_node;
+    }
+
+  TyTy::BaseType *element = variant.get_field_at_index (0)->get_field_type ();
+  for (auto &field : variant.get_fields ())
+    if (!field->get_field_type ()->is_equal (*element))
+      {
+	rust_error_at (locus, "SIMD vector should be homogeneous");
+	return error_mark_node;
+      }
+
+  switch (element->destructure ()->get_kind ())
+    {
+    case TyTy::TypeKind::INT:
+    case TyTy::TypeKind::UINT:
+    case TyTy::TypeKind::USIZE:
+    case TyTy::TypeKind::ISIZE:
+    case TyTy::TypeKind::FLOAT:
+      break;
+
+    default:
+      rust_error_at (locus,
+		     "SIMD vector element type should be a primitive scalar "
+		     "(integer/float) type");
+      return error_mark_node;
+    }
+
+  if (!pow2p_hwi (variant.num_fields ()))
+    {
+      rust_sorry_at (locus, "SIMD vectors of %lu elements are not supported",
+		     (unsigned long) variant.num_fields ());
+      return error_mark_node;
+    }
+
+  tree element_type = TyTyResolveCompile::compile (ctx, element);
+  if (element_type == error_mark_node)
+    return error_mark_node;
+
+  return build_vector_type (element_type, variant.num_fields ());
+}
+
 void
 TyTyResolveCompile::visit (const TyTy::ADTType &type)
 {
   tree type_record = error_mark_node;
+  if (type.get_repr_options ().is_simd && !type.is_enum ()
+      && !type.is_union ())
+    {
+      tree vector_type = create_simd_vector_type (type);
+      translated = Backend::named_type (type.get_ident ().path.get ()
+					  + type.subst_as_string (),
+					vector_type, type.get_ident ().locus);
+      return;
+    }
+
   if (!type.is_enum ())
     {
       rust_assert (type.number_of_variants () == 1);
@@ -268,8 +515,12 @@ TyTyResolveCompile::visit (const TyTy::ADTType &type)
 	  fields.push_back (std::move (f));
 	}
 
-      type_record = type.is_union () ? Backend::union_type (fields)
-				     : Backend::struct_type (fields);
+      if (type.is_union ())
+	type_record = Backend::union_type (fields);
+      else if (can_reorder_fields (type))
+	type_record = Backend::reordered_struct_type (fields, 0);
+      else
+	type_record = Backend::struct_type (fields);
     }
   else
     {
@@ -294,18 +545,20 @@ TyTyResolveCompile::visit (const TyTy::ADTType &type)
       //   struct D { int RUST$ENUM$DISR; i64 x; i64 y; };
       // }
       //
+      // where int stands for the discriminant type, u8 in this example.
+      //
       // Ada, qual_union_types might still work for this but I am not 100% sure.
       // I ran into some issues lets reuse our normal union and ask Ada people
       // about it.
 
+      tree enumeral_type = create_enum_discriminant_type (type);
+
       std::vector<tree> variant_records;
       for (auto &variant : type.get_variants ())
 	{
 	  std::vector<Backend::typed_identifier> fields;
 
 	  // add in the qualifier field for the variant
-	  tree enumeral_type
-	    = TyTyResolveCompile::get_implicit_enumeral_node_type ();
 	  Backend::typed_identifier f (RUST_ENUM_DISR_FIELD_NAME, enumeral_type,
 				       ctx->get_mappings ().lookup_location (
 					 variant->get_id ()));
@@ -330,7 +583,10 @@ TyTyResolveCompile::visit (const TyTy::ADTType &type)
 	      fields.push_back (std::move (f));
 	    }
 
-	  tree variant_record = Backend::struct_type (fields);
+	  // the discriminant stays first, in the same place for every variant
+	  tree variant_record = can_reorder_fields (type)
+				  ? Backend::reordered_struct_type (fields, 1)
+				  : Backend::struct_type (fields);
 	  tree named_variant_record
 	    = Backend::named_type (variant->get_ident ().path.get (),
 				   variant_record, variant->get_ident ().locus);
@@ -386,6 +642,9 @@ TyTyResolveCompile::visit (const TyTy::ADTType &type)
     = type.get_ident ().path.get () + type.subst_as_string ();
   translated = Backend::named_type (named_struct_str, type_record,
 				    type.get_ident ().locus);
+
+  if (flag_rust_dump_layout)
+    dump_layout (named_struct_str, translated, type.get_ident ().locus);
 }
 
 void
@@ -427,6 +686,19 @@ TyTyResolveCompile::visit (const TyTy::ArrayType &type)
   tree element_type
     = TyTyResolveCompile::compile (ctx, type.get_element_type ());
 
+  // the length of an instance of a generic item is only known from its
+  // const generic arguments
+  auto capacity = type.get_capacity ();
+  if (capacity && capacity.value ()->destructure ()->get_kind () == TyTy::CONST)
+    {
+      auto value = capacity.value ()->destructure ()->as<TyTy::ConstType> ();
+      translated
+	= Backend::array_type (element_type,
+			       TyTyResolveCompile::compile_const_value (ctx,
+									*value));
+      return;
+    }
+
   ctx->push_const_context ();
   tree capacity_expr = CompileExpr::Compile (&type.get_capacity_expr (), ctx);
   ctx->pop_const_context ();
@@ -718,9 +990,13 @@ TyTyResolveCompile::create_dyn_obj_record (const TyTy::DynamicObjectType &type)
 				 type.get_ty_ref ()));
   fields.push_back (std::move (f));
 
+  // the vtables are read-only globals shared by all the trait objects of a
+  // given concrete type
   tree vtable_size = build_int_cst (size_type_node, items.size ());
   tree vtable_type = Backend::array_type (uintptr_ty, vtable_size);
-  Backend::typed_identifier vtf ("vtable", vtable_type,
+  tree vtable_ptr_ty
+    = build_pointer_type (Backend::immutable_type (vtable_type));
+  Backend::typed_identifier vtf ("vtable", vtable_ptr_ty,
 				 ctx->get_mappings ().lookup_location (
 				   type.get_ty_ref ()));
   fields.push_back (std::move (vtf));
@@ -784,3 +1060,39 @@ TyTyResolveCompile::create_str_type_record (const TyTy::StrType &type)
 
 } // namespace Compile
 } // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_compile_type_test (void)
+{
+  using Rust::Compile::TyTyResolveCompile;
+
+  auto name = [] (HOST_WIDE_INT min, HOST_WIDE_INT max) {
+    return TyTyResolveCompile::discriminant_type_name (widest_int (min),
+						       widest_int (max));
+  };
+
+  ASSERT_EQ (name (0, 0), "u8");
+  ASSERT_EQ (name (0, 255), "u8");
+  ASSERT_EQ (name (0, 256), "u16");
+  ASSERT_EQ (name (0, 65535), "u16");
+  ASSERT_EQ (name (0, HOST_WIDE_INT_1 << 32), "u64");
+
+  ASSERT_EQ (name (-1, 0), "i8");
+  ASSERT_EQ (name (-128, 127), "i8");
+  ASSERT_EQ (name (-128, 128), "i16");
+  ASSERT_EQ (name (-129, 0), "i16");
+  ASSERT_EQ (name (-(HOST_WIDE_INT_1 << 31), 0), "i32");
+
+  // discriminants beyond 64 bits
+  widest_int max = wi::lshift (widest_int (1), 64);
+  ASSERT_EQ (TyTyResolveCompile::discriminant_type_name (0, max), "u128");
+  ASSERT_EQ (TyTyResolveCompile::discriminant_type_name (-max, 0), "i128");
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
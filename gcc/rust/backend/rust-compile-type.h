@@ -34,6 +34,9 @@ public:
 
   static tree get_unit_type ();
 
+  // the constant of a const generic argument or of an array length
+  static tree compile_const_value (Context *ctx, const TyTy::ConstType &value);
+
   void visit (const TyTy::InferType &) override;
   void visit (const TyTy::ADTType &) override;
   void visit (const TyTy::TupleType &) override;
@@ -58,14 +61,22 @@ public:
   void visit (const TyTy::ProjectionType &) override;
   void visit (const TyTy::DynamicObjectType &) override;
   void visit (const TyTy::ClosureType &) override;
+  void visit (const TyTy::ConstType &) override;
 
 public:
   static hashval_t type_hasher (tree type);
 
+  // The name of the smallest integer type holding the discriminants from MIN
+  // to MAX, which is unsigned unless MIN is negative
+  static std::string discriminant_type_name (const widest_int &min,
+					     const widest_int &max);
+
 protected:
   tree create_slice_type_record (const TyTy::SliceType &type);
   tree create_str_type_record (const TyTy::StrType &type);
   tree create_dyn_obj_record (const TyTy::DynamicObjectType &type);
+  tree create_enum_discriminant_type (const TyTy::ADTType &type);
+  tree create_simd_vector_type (const TyTy::ADTType &type);
 
 private:
   TyTyResolveCompile (Context *ctx, bool trait_object_mode);
@@ -78,4 +89,13 @@ private:
 } // namespace Compile
 } // namespace Rust
 
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_compile_type_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
 #endif // RUST_COMPILE_TYPE
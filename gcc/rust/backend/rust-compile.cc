@@ -44,8 +44,15 @@ CompileCrate::Compile (HIR::Crate &crate, Context *ctx)
 void
 CompileCrate::go ()
 {
+  // generic instances referenced from a body are declared straight away and
+  // their own bodies are compiled from the worklist, breadth first
+  ctx->set_defer_fn_bodies (true);
   for (auto &item : crate.get_items ())
     CompileItem::compile (item.get (), ctx);
+  while (auto body = ctx->pop_deferred_fn_body ())
+    CompileItem::compile_deferred_fn_body (ctx, *body);
+  ctx->set_defer_fn_bodies (false);
+
   auto crate_type
     = Rust::Session::get_instance ().options.target_data.get_crate_type ();
   if (crate_type == TargetOptions::CrateType::PROC_MACRO)
@@ -59,9 +66,8 @@ HIRCompileBase::coercion_site (HirId id, tree rvalue, TyTy::BaseType *rval,
 			       TyTy::BaseType *lval, location_t lvalue_locus,
 			       location_t rvalue_locus)
 {
-  std::vector<Resolver::Adjustment> *adjustments = nullptr;
-  bool ok = ctx->get_tyctx ()->lookup_autoderef_mappings (id, &adjustments);
-  if (ok)
+  auto adjustments = ctx->get_tyctx ()->lookup_autoderef_mappings (id);
+  if (adjustments)
     {
       rvalue = resolve_adjustements (*adjustments, rvalue, rvalue_locus);
     }
@@ -195,11 +201,11 @@ HIRCompileBase::coerce_to_dyn_object (tree compiled_ref,
   tree dynamic_object = TyTyResolveCompile::compile (ctx, &r);
   tree dynamic_object_fields = TYPE_FIELDS (dynamic_object);
   tree vtable_field = DECL_CHAIN (dynamic_object_fields);
-  rust_assert (TREE_CODE (TREE_TYPE (vtable_field)) == ARRAY_TYPE);
+  rust_assert (TREE_CODE (TREE_TYPE (vtable_field)) == POINTER_TYPE);
 
   //' this assumes ordering and current the structure is
   // __trait_object_ptr
-  // [list of function ptrs]
+  // pointer to [list of function ptrs]
 
   std::vector<std::pair<Resolver::TraitReference *, HIR::ImplBlock *>>
     probed_bounds_for_receiver = Resolver::TypeBoundsProbe::Probe (actual);
@@ -210,6 +216,7 @@ HIRCompileBase::coerce_to_dyn_object (tree compiled_ref,
 
   std::vector<tree> vtable_ctor_elems;
   std::vector<unsigned long> vtable_ctor_idx;
+  std::vector<tree> methods;
   unsigned long i = 0;
   for (auto &bound : ty->get_object_items ())
     {
@@ -219,20 +226,87 @@ HIRCompileBase::coerce_to_dyn_object (tree compiled_ref,
       auto address = compute_address_for_trait_item (item, predicate,
 						     probed_bounds_for_receiver,
 						     actual, actual, locus);
+      if (address == error_mark_node)
+	return error_mark_node;
+
       vtable_ctor_elems.push_back (address);
       vtable_ctor_idx.push_back (i++);
+      methods.push_back (TREE_CODE (address) == ADDR_EXPR
+			   ? TREE_OPERAND (address, 0)
+			   : address);
     }
 
-  tree vtable_ctor
-    = Backend::array_constructor_expression (TREE_TYPE (vtable_field),
-					     vtable_ctor_idx, vtable_ctor_elems,
-					     locus);
+  tree vtable = NULL_TREE;
+  if (!ctx->lookup_vtable (methods, &vtable))
+    {
+      vtable = create_vtable (TREE_TYPE (TREE_TYPE (vtable_field)),
+			      vtable_ctor_idx, vtable_ctor_elems, locus);
+      ctx->insert_vtable (methods, vtable);
+    }
 
-  std::vector<tree> dyn_ctor = {address_of_compiled_ref, vtable_ctor};
+  std::vector<tree> dyn_ctor
+    = {address_of_compiled_ref, address_expression (vtable, locus)};
   return Backend::constructor_expression (dynamic_object, false, dyn_ctor, -1,
 					  locus);
 }
 
+// Emit the read-only global holding the vtable of a trait object, its
+// initializer is visible so that GCC can resolve the calls through it when
+// the global is known to be the vtable in use
+tree
+HIRCompileBase::create_vtable (tree vtable_type,
+			       const std::vector<unsigned long> &indexes,
+			       const std::vector<tree> &methods,
+			       location_t locus)
+{
+  static unsigned long vtable_count = 0;
+  std::string name = "__vtable_" + std::to_string (vtable_count++);
+
+  tree vtable_ctor
+    = Backend::array_constructor_expression (vtable_type, indexes, methods,
+					     locus);
+
+  Bvariable *vtable = Backend::global_variable (name, name, vtable_type,
+						false /* internal */,
+						true /* hidden */,
+						false /* no gc */, locus);
+  tree decl = vtable->get_decl ();
+  TREE_READONLY (decl) = 1;
+  DECL_ARTIFICIAL (decl) = 1;
+  Backend::global_variable_set_init (vtable, vtable_ctor);
+  ctx->push_var (vtable);
+
+  return decl;
+}
+
+// Return the read-only global initialized with INIT, a constant array, so
+// that borrowing it does not build the array on the stack each time. Every
+// borrow of the same constant shares the global, as the same constant
+// promoted by rustc would.
+tree
+HIRCompileBase::promote_constant (tree init, location_t locus)
+{
+  tree decl = NULL_TREE;
+  if (ctx->lookup_promoted_constant (init, &decl))
+    return decl;
+
+  static unsigned long promoted_count = 0;
+  std::string name = "__const_" + std::to_string (promoted_count++);
+
+  Bvariable *var = Backend::global_variable (name, name, TREE_TYPE (init),
+					     false /* internal */,
+					     true /* hidden */,
+					     false /* no gc */, locus);
+  decl = var->get_decl ();
+  TREE_READONLY (decl) = 1;
+  DECL_ARTIFICIAL (decl) = 1;
+  Backend::global_variable_set_init (var, init);
+  ctx->push_var (var);
+  ctx->insert_promoted_constant (init, decl);
+
+  return decl;
+}
+
 tree
 HIRCompileBase::compute_address_for_trait_item (
   const Resolver::TraitItemReference *ref,
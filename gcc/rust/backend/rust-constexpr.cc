@@ -1913,14 +1913,16 @@ eval_constant_expression (const constexpr_ctx *ctx, tree t, bool lval,
     }
 
   // Avoid excessively long constexpr evaluations
-  if (++ctx->global->constexpr_ops_count >= constexpr_ops_limit)
+  if (++ctx->global->constexpr_ops_count >= flag_rust_const_eval_limit)
     {
       rust_error_at (
 	loc,
-	"%<constexpr%> evaluation operation count exceeds limit of "
-	"%wd (use %<-fconstexpr-ops-limit=%> to increase the limit)",
-	constexpr_ops_limit);
+	"constant evaluation operation count exceeds limit of "
+	"%wd (use %<-frust-const-eval-limit=%> to increase the limit)",
+	flag_rust_const_eval_limit);
 
+      // stop the whole evaluation rather than erroring on every later step
+      *non_constant_p = true;
       return t;
     }
 
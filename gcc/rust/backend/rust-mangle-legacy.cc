@@ -20,6 +20,8 @@
 #include "fnv-hash.h"
 #include "rust-unicode.h"
 #include "rust-diagnostics.h"
+#include "rust-hir-map.h"
+#include "rust-hir-trait-reference.h"
 #include "rust-system.h"
 #include <sstream>
 
@@ -130,14 +132,136 @@ legacy_mangle_canonical_path (const Resolver::CanonicalPath &path)
   return buffer;
 }
 
+static void
+hash_paths (Hash::FNV128 &hasher, const TyTy::BaseType *ty);
+
+static void
+hash_def_id (Hash::FNV128 &hasher, const DefId &id)
+{
+  hasher.write (std::to_string (id.crateNum));
+  hasher.write (":");
+  hasher.write (std::to_string (id.localDefId));
+  hasher.write (";");
+}
+
+static void
+hash_substitution_paths (Hash::FNV128 &hasher,
+			 const TyTy::SubstitutionRef &subst)
+{
+  for (auto &arg : subst.get_substitution_arguments ().get_mappings ())
+    hash_paths (hasher, arg.get_tyty ());
+}
+
+// The canonical path of the trait of BOUND, and of its generic arguments
+static void
+hash_bound_paths (Hash::FNV128 &hasher, const TyTy::TypeBoundPredicate &bound)
+{
+  const Resolver::TraitReference *trait = bound.get ();
+  tl::optional<const Resolver::CanonicalPath &> path = tl::nullopt;
+  if (!trait->is_error ())
+    path = Analysis::Mappings::get ().lookup_canonical_path (
+      trait->get_mappings ().get_nodeid ());
+
+  hasher.write (path ? path->get () : bound.get_name ());
+  hasher.write (";");
+
+  hash_substitution_paths (hasher, bound);
+}
+
+// The paths of the types making up TY. Their names alone are ambiguous, as
+// types of the same name can be defined in different modules, and closures
+// or trait objects with the same signature print the same. Closures have no
+// path, they are told apart by their DefId.
+static void
+hash_paths (Hash::FNV128 &hasher, const TyTy::BaseType *ty)
+{
+  ty = ty->destructure ();
+  switch (ty->get_kind ())
+    {
+      case TyTy::TypeKind::ADT: {
+	auto adt = static_cast<const TyTy::ADTType *> (ty);
+	hasher.write (adt->get_ident ().path.get ());
+	hasher.write (";");
+	hash_substitution_paths (hasher, *adt);
+      }
+      break;
+      case TyTy::TypeKind::FNDEF: {
+	auto fn = static_cast<const TyTy::FnType *> (ty);
+	hash_substitution_paths (hasher, *fn);
+	for (auto &param : fn->get_params ())
+	  hash_paths (hasher, param.second);
+	hash_paths (hasher, fn->get_return_type ());
+      }
+      break;
+      case TyTy::TypeKind::FNPTR: {
+	auto fn = static_cast<const TyTy::FnPtr *> (ty);
+	for (auto &param : fn->get_params ())
+	  hash_paths (hasher, param.get_tyty ());
+	hash_paths (hasher, fn->get_return_type ());
+      }
+      break;
+      case TyTy::TypeKind::CLOSURE: {
+	auto closure = static_cast<const TyTy::ClosureType *> (ty);
+	hasher.write ("closure#");
+	hash_def_id (hasher, closure->get_def_id ());
+	hash_substitution_paths (hasher, *closure);
+	hash_paths (hasher, &closure->get_parameters ());
+	hash_paths (hasher, &closure->get_result_type ());
+      }
+      break;
+    case TyTy::TypeKind::DYNAMIC:
+      for (auto &bound : ty->get_specified_bounds ())
+	hash_bound_paths (hasher, bound);
+      break;
+    case TyTy::TypeKind::REF:
+      hash_paths (hasher,
+		  static_cast<const TyTy::ReferenceType *> (ty)->get_base ());
+      break;
+    case TyTy::TypeKind::POINTER:
+      hash_paths (hasher,
+		  static_cast<const TyTy::PointerType *> (ty)->get_base ());
+      break;
+    case TyTy::TypeKind::ARRAY:
+      hash_paths (hasher,
+		  static_cast<const TyTy::ArrayType *> (ty)->get_element_type ());
+      break;
+    case TyTy::TypeKind::SLICE:
+      hash_paths (hasher,
+		  static_cast<const TyTy::SliceType *> (ty)->get_element_type ());
+      break;
+      case TyTy::TypeKind::TUPLE: {
+	auto tuple = static_cast<const TyTy::TupleType *> (ty);
+	for (auto &field : tuple->get_fields ())
+	  hash_paths (hasher, field.get_tyty ());
+      }
+      break;
+    default:
+      break;
+    }
+}
+
 // rustc uses a sip128 hash for legacy mangling, but an fnv 128 was quicker to
-// implement for now
+// implement for now. The fingerprint is TY's mangle_string, which is fed to
+// the hasher piece by piece instead of being built in full first.
+//
+// The hash only depends on the structure of TY and the paths of the types in
+// it, not on the HirIds of the crate, so that the symbol of an instance stays
+// the same when unrelated code changes. The profiles of -fprofile-use are
+// looked up by symbol, this keeps them applying to the generic instances.
+// Closures are the exception: they have no path, so their DefId is hashed
+// wherever they appear in TY, including in its generic arguments.
 static std::string
-legacy_hash (const std::string &fingerprint)
+legacy_hash (const TyTy::BaseType *ty)
 {
   Hash::FNV128 hasher;
-  hasher.write ((const unsigned char *) fingerprint.c_str (),
-		fingerprint.size ());
+  hasher.write (TyTy::TypeKindFormat::to_string (ty->get_kind ()));
+  hasher.write (":");
+  hasher.write (ty->as_string ());
+  hasher.write (":");
+  hash_paths (hasher, ty);
+
+  hasher.write (":");
+  hasher.write (ty->bounds_as_string ());
 
   uint64_t hi, lo;
   hasher.sum (&hi, &lo);
@@ -153,7 +277,7 @@ std::string
 legacy_mangle_item (const TyTy::BaseType *ty,
 		    const Resolver::CanonicalPath &path)
 {
-  const std::string hash = legacy_hash (ty->mangle_string ());
+  const std::string hash = legacy_hash (ty);
   const std::string hash_sig = legacy_mangle_name (hash);
 
   return kLegacySymbolPrefix + legacy_mangle_canonical_path (path) + hash_sig
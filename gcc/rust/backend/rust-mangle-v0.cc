@@ -30,6 +30,22 @@
 namespace Rust {
 namespace Compile {
 
+// The mangled paths and types are built as strings, in which each of them is
+// wrapped in these markers. They are taken out by v0_add_backrefs once the
+// whole symbol is known, replacing the repeated paths and types with
+// backreferences.
+static const char kBackrefBegin = '\x01';
+static const char kBackrefEnd = '\x02';
+
+static std::string
+v0_backref_candidate (const std::string &mangled)
+{
+  return kBackrefBegin + mangled + kBackrefEnd;
+}
+
+static std::string
+v0_integer_62 (uint64_t x);
+
 struct V0Path
 {
   std::string prefix = "";
@@ -50,14 +66,20 @@ struct V0Path
   std::string as_string () const
   {
     if (prefix == "N")
-      return generic_prefix + prefix + ns + path + disambiguator + ident
-	     + generic_postfix;
+      {
+	auto nested = v0_backref_candidate (prefix + ns + path + disambiguator
+					    + ident);
+	if (generic_prefix.empty ())
+	  return nested;
+
+	return v0_backref_candidate (generic_prefix + nested + generic_postfix);
+      }
     else if (prefix == "M")
-      return prefix + impl_path + impl_type;
+      return v0_backref_candidate (prefix + impl_path + impl_type);
     else if (prefix == "X")
-      return prefix + impl_type + trait_type;
+      return v0_backref_candidate (prefix + impl_type + trait_type);
     else if (prefix == "C")
-      return prefix + disambiguator + ident;
+      return v0_backref_candidate (prefix + disambiguator + ident);
     else
       rust_unreachable ();
   }
@@ -212,6 +234,50 @@ v0_type_prefix (Context *ctx, const TyTy::BaseType *ty)
   rust_unreachable ();
 }
 
+// Returns the hexadecimal digits of DECIMAL, a string of decimal digits
+static std::string
+v0_hex_digits (std::string decimal)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  std::string digits;
+  while (decimal != "0" && !decimal.empty ())
+    {
+      // divide by 16, keeping the remainder as the next digit
+      std::string quotient;
+      unsigned remainder = 0;
+      for (char c : decimal)
+	{
+	  remainder = remainder * 10 + (c - '0');
+	  if (!quotient.empty () || remainder >= 16)
+	    quotient += '0' + remainder / 16;
+	  remainder %= 16;
+	}
+      digits.insert (digits.begin (), hex[remainder]);
+      decimal = quotient.empty () ? "0" : quotient;
+    }
+
+  return digits.empty () ? "0" : digits;
+}
+
+// Returns the mangled value of a const generic argument. This corresponds to
+// the `<const>` grammar in the v0 mangling RFC, the type of the value then
+// its hexadecimal digits.
+static std::string
+v0_const_prefix (const TyTy::ConstType &value)
+{
+  std::string digits = value.get_value ();
+  std::string sign;
+  if (!digits.empty () && digits[0] == '-')
+    {
+      sign = "n";
+      digits = digits.substr (1);
+    }
+
+  return v0_simple_type_prefix (value.get_value_type ()) + sign
+	 + v0_hex_digits (digits) + "_";
+}
+
 static std::string
 v0_generic_args (Context *ctx, const TyTy::BaseType *ty)
 {
@@ -221,7 +287,11 @@ v0_generic_args (Context *ctx, const TyTy::BaseType *ty)
     = const_cast<TyTy::FnType *> (fnty)->get_substitution_arguments ();
   for (TyTy::SubstitutionArg &map : subst_ref.get_mappings ())
     {
-      ss << v0_type_prefix (ctx, map.get_tyty ());
+      const TyTy::BaseType *arg = map.get_tyty ()->destructure ();
+      if (arg->get_kind () == TyTy::TypeKind::CONST)
+	ss << "K" << v0_const_prefix (*arg->as<const TyTy::ConstType> ());
+      else
+	ss << v0_type_prefix (ctx, map.get_tyty ());
     }
   return ss.str ();
 }
@@ -231,6 +301,12 @@ v0_generic_args (Context *ctx, const TyTy::BaseType *ty)
 static std::string
 v0_identifier (const std::string &identifier)
 {
+  // the same names come back in most symbols, encode each of them once
+  static thread_local std::unordered_map<std::string, std::string> identifiers;
+  auto cached = identifiers.find (identifier);
+  if (cached != identifiers.end ())
+    return cached->second;
+
   std::stringstream mangled;
   // The grammar for unicode identifier is contained in
   // <undisambiguated-identifier>, right under the <identifier> one. If the
@@ -263,7 +339,7 @@ v0_identifier (const std::string &identifier)
     mangled << "_";
 
   mangled << punycode;
-  return mangled.str ();
+  return identifiers[identifier] = mangled.str ();
 }
 
 static V0Path
@@ -483,6 +559,50 @@ v0_path (Rust::Compile::Context *ctx, const TyTy::BaseType *ty,
   return v0path.as_string ();
 }
 
+// Take the backreference markers out of MARKED, replacing each path or type
+// which was already mangled in this symbol with a `B <base-62-number>`
+// backreference to its first occurrence. Occurrences are compared before
+// their own parts are replaced, and the offsets start after the "_R" prefix.
+static std::string
+v0_add_backrefs (const std::string &marked)
+{
+  std::string mangled;
+  std::string unshortened;
+  std::unordered_map<std::string, size_t> first_occurrences;
+  std::vector<std::pair<size_t, size_t>> open;
+
+  for (char c : marked)
+    {
+      if (c == kBackrefBegin)
+	{
+	  open.emplace_back (mangled.size (), unshortened.size ());
+	  continue;
+	}
+
+      if (c == kBackrefEnd)
+	{
+	  rust_assert (!open.empty ());
+	  auto start = open.back ();
+	  open.pop_back ();
+
+	  auto occurrence = first_occurrences.emplace (
+	    unshortened.substr (start.second), start.first);
+	  if (!occurrence.second)
+	    {
+	      mangled.resize (start.first);
+	      mangled += "B" + v0_integer_62 (occurrence.first->second);
+	    }
+	  continue;
+	}
+
+      mangled += c;
+      unshortened += c;
+    }
+
+  rust_assert (open.empty ());
+  return mangled;
+}
+
 std::string
 v0_mangle_item (Rust::Compile::Context *ctx, const TyTy::BaseType *ty,
 		const Resolver::CanonicalPath &path)
@@ -497,7 +617,7 @@ v0_mangle_item (Rust::Compile::Context *ctx, const TyTy::BaseType *ty,
 
   std::stringstream mangled;
   mangled << "_R";
-  mangled << v0_path (ctx, ty, path);
+  mangled << v0_add_backrefs (v0_path (ctx, ty, path));
 
   rust_debug ("=> %s", mangled.str ().c_str ());
 
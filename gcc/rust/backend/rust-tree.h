@@ -82,6 +82,10 @@
 #define RS_DST_FLAG_P(TYPE)                                                    \
   (TREE_CODE (TYPE) == RECORD_TYPE && TREE_LANG_FLAG_0 (TYPE))
 
+// the fields of a record which were laid out in a different order than they
+// are declared in, as a TREE_VEC indexed by declaration order
+#define RS_DECLARED_FIELDS(TYPE) TYPE_LANG_SLOT_1 (RECORD_TYPE_CHECK (TYPE))
+
 // lambda?
 #define RS_CLOSURE_FLAG TREE_LANG_FLAG_1
 #define RS_CLOSURE_TYPE_P(TYPE)                                                \
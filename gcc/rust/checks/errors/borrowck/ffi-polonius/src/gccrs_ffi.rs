@@ -0,0 +1,158 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+// This is the Rust side of the FFI interface to Polonius, the C++ side is in
+// `polonius/rust-polonius-ffi.h`. Both must be kept in sync.
+
+use polonius_engine::{Algorithm as EngineAlgorithm, Atom};
+
+macro_rules! define_atom {
+    ($name:ident) => {
+        #[repr(transparent)]
+        #[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+        pub struct $name(usize);
+
+        impl From<usize> for $name {
+            fn from(index: usize) -> Self {
+                $name(index)
+            }
+        }
+
+        impl From<$name> for usize {
+            fn from(atom: $name) -> Self {
+                atom.0
+            }
+        }
+
+        impl Atom for $name {
+            fn index(self) -> usize {
+                self.0
+            }
+        }
+    };
+}
+
+define_atom!(Origin);
+define_atom!(Loan);
+define_atom!(Point);
+define_atom!(Variable);
+define_atom!(Path);
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct Pair<T1, T2> {
+    pub first: T1,
+    pub second: T2,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct Triple<T1, T2, T3> {
+    pub first: T1,
+    pub second: T2,
+    pub third: T3,
+}
+
+impl<T1: Copy, T2: Copy> From<&Pair<T1, T2>> for (T1, T2) {
+    fn from(pair: &Pair<T1, T2>) -> Self {
+        (pair.first, pair.second)
+    }
+}
+
+impl<T1: Copy, T2: Copy, T3: Copy> From<&Triple<T1, T2, T3>> for (T1, T2, T3) {
+    fn from(triple: &Triple<T1, T2, T3>) -> Self {
+        (triple.first, triple.second, triple.third)
+    }
+}
+
+/// Must be kept in the order of the C++ `FFI::Algorithm`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub enum Algorithm {
+    Naive,
+    DatafrogOpt,
+    LocationInsensitive,
+    Compare,
+    Hybrid,
+}
+
+impl From<Algorithm> for EngineAlgorithm {
+    fn from(algorithm: Algorithm) -> Self {
+        match algorithm {
+            Algorithm::Naive => EngineAlgorithm::Naive,
+            Algorithm::DatafrogOpt => EngineAlgorithm::DatafrogOpt,
+            Algorithm::LocationInsensitive => EngineAlgorithm::LocationInsensitive,
+            Algorithm::Compare => EngineAlgorithm::Compare,
+            Algorithm::Hybrid => EngineAlgorithm::Hybrid,
+        }
+    }
+}
+
+#[repr(C)]
+pub struct Slice<T> {
+    pub len: usize,
+    pub data: *const T,
+}
+
+impl<T> Slice<T> {
+    /// The data of an empty C++ vector may be null, which a Rust slice cannot
+    /// point to.
+    pub unsafe fn as_slice(&self) -> &[T] {
+        if self.len == 0 {
+            &[]
+        } else {
+            std::slice::from_raw_parts(self.data, self.len)
+        }
+    }
+
+    pub unsafe fn to_vec<U>(&self) -> Vec<U>
+    where
+        for<'a> U: From<&'a T>,
+    {
+        self.as_slice().iter().map(U::from).collect()
+    }
+}
+
+#[repr(C)]
+pub struct FactsView {
+    pub loan_issued_at: Slice<Triple<Origin, Loan, Point>>,
+    pub universal_region: Slice<Origin>,
+    pub cfg_edge: Slice<Pair<Point, Point>>,
+    pub loan_killed_at: Slice<Pair<Loan, Point>>,
+    pub subset_base: Slice<Triple<Origin, Origin, Point>>,
+    pub loan_invalidated_at: Slice<Pair<Point, Loan>>,
+    pub var_used_at: Slice<Pair<Variable, Point>>,
+    pub var_defined_at: Slice<Pair<Variable, Point>>,
+    pub var_dropped_at: Slice<Pair<Variable, Point>>,
+    pub use_of_var_derefs_origin: Slice<Pair<Variable, Origin>>,
+    pub drop_of_var_derefs_origin: Slice<Pair<Variable, Origin>>,
+    pub child_path: Slice<Pair<Path, Path>>,
+    pub path_is_var: Slice<Pair<Path, Variable>>,
+    pub path_assigned_at_base: Slice<Pair<Path, Point>>,
+    pub path_moved_at_base: Slice<Pair<Path, Point>>,
+    pub path_accessed_at_base: Slice<Pair<Path, Point>>,
+    pub known_placeholder_subset: Slice<Pair<Origin, Origin>>,
+    pub placeholder: Slice<Pair<Origin, Loan>>,
+}
+
+#[repr(C)]
+pub struct Output {
+    pub loan_errors: bool,
+    pub subset_errors: bool,
+    pub move_errors: bool,
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+mod gccrs_ffi;
+
+use polonius_engine::{AllFacts, FactTypes, Output};
+
+#[derive(Debug, Clone, Copy, Default)]
+struct GccrsAtoms;
+
+impl FactTypes for GccrsAtoms {
+    type Origin = gccrs_ffi::Origin;
+    type Loan = gccrs_ffi::Loan;
+    type Point = gccrs_ffi::Point;
+    type Variable = gccrs_ffi::Variable;
+    type Path = gccrs_ffi::Path;
+}
+
+/// Copy the facts out of the C++ vectors `input` points to.
+unsafe fn all_facts(input: &gccrs_ffi::FactsView) -> AllFacts<GccrsAtoms> {
+    AllFacts {
+        loan_issued_at: input.loan_issued_at.to_vec(),
+        universal_region: input.universal_region.as_slice().to_vec(),
+        cfg_edge: input.cfg_edge.to_vec(),
+        loan_killed_at: input.loan_killed_at.to_vec(),
+        subset_base: input.subset_base.to_vec(),
+        loan_invalidated_at: input.loan_invalidated_at.to_vec(),
+        var_used_at: input.var_used_at.to_vec(),
+        var_defined_at: input.var_defined_at.to_vec(),
+        var_dropped_at: input.var_dropped_at.to_vec(),
+        use_of_var_derefs_origin: input.use_of_var_derefs_origin.to_vec(),
+        drop_of_var_derefs_origin: input.drop_of_var_derefs_origin.to_vec(),
+        child_path: input.child_path.to_vec(),
+        path_is_var: input.path_is_var.to_vec(),
+        path_assigned_at_base: input.path_assigned_at_base.to_vec(),
+        path_moved_at_base: input.path_moved_at_base.to_vec(),
+        path_accessed_at_base: input.path_accessed_at_base.to_vec(),
+        known_placeholder_subset: input.known_placeholder_subset.to_vec(),
+        placeholder: input.placeholder.to_vec(),
+    }
+}
+
+/// Run `algorithm` on the facts of a single function.
+///
+/// # Safety
+///
+/// The slices of `input` must point to live C++ vectors for the duration of
+/// the call. The C++ declaration is in `polonius/rust-polonius.h`.
+#[no_mangle]
+pub unsafe extern "C" fn polonius_run(
+    input: gccrs_ffi::FactsView,
+    dump_enabled: bool,
+    algorithm: gccrs_ffi::Algorithm,
+) -> gccrs_ffi::Output {
+    let facts = all_facts(&input);
+    let output = Output::compute(&facts, algorithm.into(), dump_enabled);
+
+    if dump_enabled {
+        println!("{:#?}", output);
+    }
+
+    gccrs_ffi::Output {
+        loan_errors: !output.errors.is_empty(),
+        subset_errors: !output.subset_errors.is_empty(),
+        move_errors: !output.move_errors.is_empty(),
+    }
+}
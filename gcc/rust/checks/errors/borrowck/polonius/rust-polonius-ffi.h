@@ -22,7 +22,7 @@
 #include "rust-system.h"
 
 // This file defines the C++ side of the FFI interface to Polonius.
-// The corresponding Rust side is in `gccrs-ffi.rs`.
+// The corresponding Rust side is in `ffi-polonius/src/gccrs_ffi.rs`.
 
 // IMPORTANT:
 // This file intentionally does not include any C++ headers
@@ -68,6 +68,19 @@ template <typename T1, typename T2, typename T3> struct Triple
   {}
 };
 
+/**
+ * The analysis run by polonius, -frust-borrowcheck-algorithm= uses the same
+ * values. Must be kept in the order of `polonius_engine::Algorithm`.
+ */
+enum class Algorithm
+{
+  NAIVE,
+  DATAFROG_OPT,
+  LOCATION_INSENSITIVE,
+  COMPARE,
+  HYBRID,
+};
+
 /** Frozen variant to vector for FFI */
 template <typename T> struct Slice
 {
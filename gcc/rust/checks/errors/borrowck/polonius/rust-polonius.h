@@ -28,6 +28,41 @@
 namespace Rust {
 namespace Polonius {
 
+namespace FFI {
+
+// Facts are ordered like the tuples polonius turns them into
+
+template <typename T1, typename T2>
+bool
+operator< (const Pair<T1, T2> &a, const Pair<T1, T2> &b)
+{
+  return std::tie (a.first, a.second) < std::tie (b.first, b.second);
+}
+
+template <typename T1, typename T2>
+bool
+operator== (const Pair<T1, T2> &a, const Pair<T1, T2> &b)
+{
+  return a.first == b.first && a.second == b.second;
+}
+
+template <typename T1, typename T2, typename T3>
+bool
+operator< (const Triple<T1, T2, T3> &a, const Triple<T1, T2, T3> &b)
+{
+  return std::tie (a.first, a.second, a.third)
+	 < std::tie (b.first, b.second, b.third);
+}
+
+template <typename T1, typename T2, typename T3>
+bool
+operator== (const Triple<T1, T2, T3> &a, const Triple<T1, T2, T3> &b)
+{
+  return a.first == b.first && a.second == b.second && a.third == b.third;
+}
+
+} // namespace FFI
+
 struct FullPoint
 {
   uint32_t bb;
@@ -78,6 +113,39 @@ struct Facts
   std::vector<FFI::Pair<Origin, Origin>> known_placeholder_subset;
   std::vector<FFI::Pair<Origin, Loan>> placeholder;
 
+  /**
+   * Sort and deduplicate every relation. Polonius turns them into sorted sets
+   * before anything else, which is then only a pass over the facts.
+   */
+  void sort_and_dedup ()
+  {
+    sort_and_dedup (loan_issued_at);
+    sort_and_dedup (universal_region);
+    sort_and_dedup (cfg_edge);
+    sort_and_dedup (loan_killed_at);
+    sort_and_dedup (subset_base);
+    sort_and_dedup (loan_invalidated_at);
+    sort_and_dedup (var_used_at);
+    sort_and_dedup (var_defined_at);
+    sort_and_dedup (var_dropped_at);
+    sort_and_dedup (use_of_var_derefs_origin);
+    sort_and_dedup (drop_of_var_derefs_origin);
+    sort_and_dedup (child_path);
+    sort_and_dedup (path_is_var);
+    sort_and_dedup (path_assigned_at_base);
+    sort_and_dedup (path_moved_at_base);
+    sort_and_dedup (path_accessed_at_base);
+    sort_and_dedup (known_placeholder_subset);
+    sort_and_dedup (placeholder);
+  }
+
+  template <typename T> static void sort_and_dedup (std::vector<T> &relation)
+  {
+    std::sort (relation.begin (), relation.end ());
+    relation.erase (std::unique (relation.begin (), relation.end ()),
+		    relation.end ());
+  }
+
   /**
    * Create a const view for the struct for FFI.
    *
@@ -218,12 +286,13 @@ struct Facts
 };
 
 /**
- * Check a single function for borrow errors.
+ * Check a single function for borrow errors, using ALGORITHM.
  *
  * Output is not yet implemented and is only dumped to stdout.
  */
 extern "C" FFI::Output
-polonius_run (FFI::FactsView input, bool dump_enabled);
+polonius_run (FFI::FactsView input, bool dump_enabled,
+	      FFI::Algorithm algorithm);
 
 } // namespace Polonius
 } // namespace Rust
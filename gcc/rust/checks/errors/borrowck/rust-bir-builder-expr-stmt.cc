@@ -622,6 +622,47 @@ ExprStmtBuilder::visit (HIR::AsyncBlockExpr &expr)
   rust_sorry_at (expr.get_locus (), "async blocks are not supported");
 }
 
+void
+ExprStmtBuilder::visit (HIR::InlineAsm &expr)
+{
+  using RegisterType = HIR::InlineAsmOperand::RegisterType;
+
+  // The asm reads all its inputs, then writes its outputs with values which
+  // are unknown here.
+  std::vector<PlaceId> outputs;
+  for (auto &operand : expr.get_operands ())
+    switch (operand.register_type)
+      {
+      case RegisterType::In:
+	push_fake_read (visit_expr (*operand.expr));
+	break;
+	case RegisterType::InOut: {
+	  PlaceId place = visit_expr (*operand.expr);
+	  push_fake_read (place);
+	  outputs.push_back (place);
+	  break;
+	}
+      case RegisterType::SplitInOut:
+	push_fake_read (visit_expr (*operand.expr));
+	if (operand.has_out_expr ())
+	  outputs.push_back (visit_expr (*operand.out_expr));
+	break;
+      case RegisterType::Out:
+	if (operand.has_expr ())
+	  outputs.push_back (visit_expr (*operand.expr));
+	break;
+      case RegisterType::Const:
+      case RegisterType::Sym:
+      case RegisterType::Label:
+	break;
+      }
+
+  for (auto output : outputs)
+    push_assignment (output, new InitializerExpr ({}));
+
+  return_unit (expr);
+}
+
 void
 ExprStmtBuilder::visit (HIR::QualifiedPathInExpression &expr)
 {
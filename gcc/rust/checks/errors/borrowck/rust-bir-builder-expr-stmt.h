@@ -105,6 +105,7 @@ protected: // Expr
   void visit (HIR::MatchExpr &expr) override;
   void visit (HIR::AwaitExpr &expr) override;
   void visit (HIR::AsyncBlockExpr &expr) override;
+  void visit (HIR::InlineAsm &expr) override;
 
 protected: // Nodes not containing executable code. Nothing to do.
   void visit (HIR::QualifiedPathInExpression &expr) override;
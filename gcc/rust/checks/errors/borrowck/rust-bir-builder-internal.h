@@ -266,8 +266,7 @@ protected: // Helpers to add BIR statements
     auto copy = move_place (switch_val);
     ctx.get_current_bb ().statements.emplace_back (Statement::Kind::SWITCH,
 						   copy);
-    ctx.get_current_bb ().successors.insert (
-      ctx.get_current_bb ().successors.end (), destinations);
+    ctx.get_current_bb ().successors.append (destinations);
   }
 
   void push_goto (BasicBlockId bb)
@@ -366,7 +365,7 @@ protected: // CFG helpers
 
   void add_jump (BasicBlockId from, BasicBlockId to)
   {
-    ctx.basic_blocks[from].successors.emplace_back (to);
+    ctx.basic_blocks[from].successors.push_back (to);
   }
 
   void add_jump_to (BasicBlockId bb) { add_jump (ctx.current_bb, bb); }
@@ -210,6 +210,10 @@ public:
   {
     return_place (ExprStmtBuilder (ctx).build (expr));
   }
+  void visit (HIR::InlineAsm &expr) override
+  {
+    return_place (ExprStmtBuilder (ctx).build (expr));
+  }
 
 protected: // Illegal at this position.
   void visit (HIR::StructExprFieldIdentifier &field) override
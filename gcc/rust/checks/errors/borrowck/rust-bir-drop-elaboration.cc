@@ -0,0 +1,261 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-bir-drop-elaboration.h"
+#include "rust-type-util.h"
+
+namespace Rust {
+namespace BIR {
+
+std::vector<Drop>
+DropElaboration::elaborate (Function &func)
+{
+  DropElaboration elaboration (func);
+  elaboration.init_places ();
+  elaboration.run_dataflow ();
+
+  elaboration.record = true;
+  for (BasicBlockId bb = 0; bb < func.basic_blocks.size (); ++bb)
+    elaboration.visit_block (bb);
+
+  return std::move (elaboration.drops);
+}
+
+bool
+DropElaboration::needs_drop_flag (const std::vector<Drop> &drops,
+				  PlaceId place)
+{
+  return std::any_of (drops.begin (), drops.end (), [place] (const Drop &d) {
+    return d.place == place && d.kind == DropKind::CONDITIONAL;
+  });
+}
+
+void
+DropElaboration::init_places ()
+{
+  // the return value belongs to the caller
+  for (PlaceId place = RETURN_VALUE_PLACE + 1; place < place_db.size ();
+       ++place)
+    if (place_db[place].is_var ())
+      func.place_db[place].has_drop
+	= Resolver::type_needs_drop (place_db[place].tyty);
+
+  if (func.basic_blocks.empty ())
+    return;
+
+  entry_init.assign (func.basic_blocks.size (),
+		     std::vector<bool> (place_db.size ()));
+  entry_uninit = entry_init;
+
+  // only the arguments are initialized when entering the function
+  for (PlaceId place = 0; place < place_db.size (); ++place)
+    entry_uninit[0][place] = place_db[place].has_drop;
+  for (PlaceId arg : func.arguments)
+    {
+      entry_init[0][arg] = place_db[arg].has_drop;
+      entry_uninit[0][arg] = false;
+    }
+}
+
+void
+DropElaboration::run_dataflow ()
+{
+  if (func.basic_blocks.empty ())
+    return;
+
+  std::vector<BasicBlockId> worklist = {0};
+  std::vector<bool> queued (func.basic_blocks.size ());
+  queued[0] = true;
+
+  while (!worklist.empty ())
+    {
+      BasicBlockId bb = worklist.back ();
+      worklist.pop_back ();
+      queued[bb] = false;
+
+      visit_block (bb);
+
+      for (BasicBlockId succ : func.basic_blocks[bb].successors)
+	{
+	  bool changed = false;
+	  for (PlaceId place = 0; place < place_db.size (); ++place)
+	    {
+	      if (maybe_init[place] && !entry_init[succ][place])
+		entry_init[succ][place] = changed = true;
+	      if (maybe_uninit[place] && !entry_uninit[succ][place])
+		entry_uninit[succ][place] = changed = true;
+	    }
+
+	  if (changed && !queued[succ])
+	    {
+	      queued[succ] = true;
+	      worklist.push_back (succ);
+	    }
+	}
+    }
+}
+
+void
+DropElaboration::visit_block (BasicBlockId bb)
+{
+  maybe_init = entry_init[bb];
+  maybe_uninit = entry_uninit[bb];
+
+  current_bb = bb;
+  auto &statements = func.basic_blocks[bb].statements;
+  for (current_stmt = 0; current_stmt < statements.size (); ++current_stmt)
+    visit (statements[current_stmt]);
+}
+
+void
+DropElaboration::set_init (PlaceId place)
+{
+  if (!place_db[place].has_drop)
+    return;
+
+  maybe_init[place] = true;
+  maybe_uninit[place] = false;
+}
+
+void
+DropElaboration::set_uninit (PlaceId place)
+{
+  if (!place_db[place].has_drop)
+    return;
+
+  maybe_init[place] = false;
+  maybe_uninit[place] = true;
+}
+
+void
+DropElaboration::visit_operand (PlaceId place)
+{
+  if (!place_db[place].should_be_moved ())
+    return;
+
+  if (place_db[place].is_var ())
+    {
+      set_uninit (place);
+      return;
+    }
+
+  // nothing can be moved out from behind a reference or a pointer
+  bool through_deref = false;
+  place_db.for_each_path_segment (place, [&] (PlaceId segment) {
+    through_deref = through_deref || place_db[segment].kind == Place::DEREF;
+  });
+  if (through_deref)
+    return;
+
+  // the rest of the local is still to be dropped
+  PlaceId var = place_db.get_var (place);
+  if (place_db[var].has_drop)
+    maybe_uninit[var] = true;
+}
+
+void
+DropElaboration::drop (PlaceId place)
+{
+  if (!record || !place_db[place].has_drop)
+    return;
+
+  DropKind kind = DropKind::NONE;
+  if (maybe_init[place])
+    kind = maybe_uninit[place] ? DropKind::CONDITIONAL : DropKind::STATIC;
+
+  drops.push_back ({current_bb, current_stmt, place, kind});
+}
+
+void
+DropElaboration::visit (const Statement &stmt)
+{
+  switch (stmt.get_kind ())
+    {
+    case Statement::Kind::ASSIGNMENT:
+      stmt.get_expr ().accept_vis (*this);
+      // assigning to an initialized local drops its previous value
+      if (place_db[stmt.get_place ()].is_var ())
+	{
+	  if (maybe_init[stmt.get_place ()])
+	    drop (stmt.get_place ());
+	  set_init (stmt.get_place ());
+	}
+      break;
+    case Statement::Kind::SWITCH:
+      visit_operand (stmt.get_place ());
+      break;
+    case Statement::Kind::RETURN:
+      for (PlaceId place = RETURN_VALUE_PLACE + 1; place < place_db.size ();
+	   ++place)
+	if (maybe_init[place])
+	  drop (place);
+      break;
+    case Statement::Kind::STORAGE_DEAD:
+      drop (stmt.get_place ());
+      set_uninit (stmt.get_place ());
+      break;
+    case Statement::Kind::STORAGE_LIVE:
+      set_uninit (stmt.get_place ());
+      break;
+    case Statement::Kind::GOTO:
+    case Statement::Kind::USER_TYPE_ASCRIPTION:
+    case Statement::Kind::FAKE_READ:
+      break;
+    }
+}
+
+void
+DropElaboration::visit (const InitializerExpr &expr)
+{
+  for (auto value : expr.get_values ())
+    visit_operand (value);
+}
+
+void
+DropElaboration::visit (const Operator<1> &expr)
+{
+  visit_operand (expr.get_operand<0> ());
+}
+
+void
+DropElaboration::visit (const Operator<2> &expr)
+{
+  visit_operand (expr.get_operand<0> ());
+  visit_operand (expr.get_operand<1> ());
+}
+
+void
+DropElaboration::visit (const BorrowExpr &)
+{}
+
+void
+DropElaboration::visit (const Assignment &expr)
+{
+  visit_operand (expr.get_rhs ());
+}
+
+void
+DropElaboration::visit (const CallExpr &expr)
+{
+  visit_operand (expr.get_callable ());
+  for (auto arg : expr.get_arguments ())
+    visit_operand (arg);
+}
+
+} // namespace BIR
+} // namespace Rust
@@ -0,0 +1,120 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_BIR_DROP_ELABORATION_H
+#define RUST_BIR_DROP_ELABORATION_H
+
+#include "rust-system.h"
+#include "rust-bir-place.h"
+#include "rust-bir-visitor.h"
+#include "rust-bir.h"
+
+namespace Rust {
+namespace BIR {
+
+/** How a local is dropped at a point where it goes out of scope. */
+enum class DropKind : uint8_t
+{
+  /** The local is moved out or never initialized on every path: no drop. */
+  NONE,
+  /** The local is initialized on every path: it is dropped unconditionally. */
+  STATIC,
+  /** The local is only initialized on some paths: a drop flag decides. */
+  CONDITIONAL,
+};
+
+/** A local going out of scope at a StorageDead or a return statement. */
+struct Drop
+{
+  BasicBlockId bb;
+  uint32_t stmt;
+  PlaceId place;
+  DropKind kind;
+};
+
+/**
+ * Decides where the locals of a function must be dropped, so that dropping
+ * them costs nothing in the common cases.
+ *
+ * Only the locals whose type needs to be dropped are tracked, the others are
+ * marked with `has_drop` unset and never show up in the result. A forward
+ * dataflow over the basic blocks then computes which of them may be
+ * initialized, and which may be uninitialized, at each statement. A local
+ * which is only in one of these states when it goes out of scope is dropped
+ * statically or not at all, a drop flag is only needed when it is in both,
+ * that is when it was moved out on some paths only.
+ *
+ * Moves out of a field or an index make the whole local maybe uninitialized:
+ * its remaining fields are then dropped under a drop flag.
+ */
+class DropElaboration : public Visitor
+{
+  Function &func;
+  const PlaceDB &place_db;
+
+  // state at the start of each basic block, indexed by place
+  std::vector<std::vector<bool>> entry_init;
+  std::vector<std::vector<bool>> entry_uninit;
+
+  // state at the current statement
+  std::vector<bool> maybe_init;
+  std::vector<bool> maybe_uninit;
+
+  // the drops are only recorded once the dataflow converged
+  bool record = false;
+  BasicBlockId current_bb = 0;
+  uint32_t current_stmt = 0;
+  std::vector<Drop> drops;
+
+public:
+  /**
+   * Returns the drops of FUNC in the order of its statements, and sets the
+   * `has_drop` flag of its places.
+   */
+  static std::vector<Drop> elaborate (Function &func);
+
+  /** Whether any of DROPS decides at runtime whether PLACE is dropped. */
+  static bool needs_drop_flag (const std::vector<Drop> &drops, PlaceId place);
+
+protected:
+  explicit DropElaboration (Function &func)
+    : func (func), place_db (func.place_db)
+  {}
+
+  void init_places ();
+  void run_dataflow ();
+  void visit_block (BasicBlockId bb);
+
+  void set_init (PlaceId place);
+  void set_uninit (PlaceId place);
+  void visit_operand (PlaceId place);
+  void drop (PlaceId place);
+
+  void visit (const Statement &stmt) override;
+  void visit (const InitializerExpr &expr) override;
+  void visit (const Operator<1> &expr) override;
+  void visit (const Operator<2> &expr) override;
+  void visit (const BorrowExpr &expr) override;
+  void visit (const Assignment &expr) override;
+  void visit (const CallExpr &expr) override;
+};
+
+} // namespace BIR
+} // namespace Rust
+
+#endif // RUST_BIR_DROP_ELABORATION_H
@@ -33,9 +33,9 @@ get_tyty_name (TyTy::BaseType *tyty)
   return "unknown";
 }
 
-template <typename T, typename FN>
+template <typename Collection, typename FN>
 void
-print_comma_separated (std::ostream &stream, const std::vector<T> &collection,
+print_comma_separated (std::ostream &stream, const Collection &collection,
 		       FN printer)
 {
   if (collection.empty ())
@@ -82,6 +82,7 @@ public:
     collector.visit_statemensts ();
     collector.visit_places (func.arguments);
 
+    collector.facts.sort_and_dedup ();
     return std::move (collector.facts);
   }
 
@@ -791,6 +792,7 @@ protected: // Subset helpers.
       case TyTy::NEVER:
       case TyTy::DYNAMIC:
       case TyTy::CLOSURE:
+      case TyTy::CONST:
       case TyTy::ERROR:
 	return region_start;
       case TyTy::PLACEHOLDER:
@@ -408,6 +408,7 @@ private:
       case TyTy::ERROR:
       case TyTy::STR:
       case TyTy::PLACEHOLDER:
+      case TyTy::CONST:
 	rust_unreachable ();
       case TyTy::ADT:	     // TODO: check trait
       case TyTy::PROJECTION: // TODO: DUNNO
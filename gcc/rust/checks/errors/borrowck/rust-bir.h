@@ -105,12 +105,65 @@ using BasicBlockId = uint32_t;
 static constexpr BasicBlockId INVALID_BB
   = std::numeric_limits<BasicBlockId>::max ();
 
+/**
+ * Successors of a basic block. Almost every block has at most two of them,
+ * which are stored inline: only switches with more targets allocate.
+ */
+class Successors
+{
+  static constexpr uint32_t INLINE_SIZE = 2;
+
+  std::array<BasicBlockId, INLINE_SIZE> inline_ids;
+  // only used once there are more than INLINE_SIZE successors
+  std::vector<BasicBlockId> heap_ids;
+  uint32_t count = 0;
+
+public:
+  WARN_UNUSED_RESULT size_t size () const { return count; }
+  WARN_UNUSED_RESULT bool empty () const { return count == 0; }
+
+  const BasicBlockId *begin () const { return data (); }
+  const BasicBlockId *end () const { return data () + count; }
+
+  BasicBlockId operator[] (size_t i) const { return data ()[i]; }
+  WARN_UNUSED_RESULT BasicBlockId at (size_t i) const
+  {
+    rust_assert (i < count);
+    return data ()[i];
+  }
+
+  void push_back (BasicBlockId bb)
+  {
+    if (count < INLINE_SIZE)
+      inline_ids[count] = bb;
+    else
+      {
+	if (count == INLINE_SIZE)
+	  heap_ids.assign (inline_ids.begin (), inline_ids.end ());
+	heap_ids.push_back (bb);
+      }
+    count++;
+  }
+
+  void append (std::initializer_list<BasicBlockId> bbs)
+  {
+    for (auto bb : bbs)
+      push_back (bb);
+  }
+
+private:
+  const BasicBlockId *data () const
+  {
+    return count <= INLINE_SIZE ? inline_ids.data () : heap_ids.data ();
+  }
+};
+
 struct BasicBlock
 {
   // BIR "instructions".
   std::vector<Statement> statements;
   // A basic block can end with: goto, return or switch
-  std::vector<BasicBlockId> successors;
+  Successors successors;
 
 public:
   WARN_UNUSED_RESULT bool is_terminated () const;
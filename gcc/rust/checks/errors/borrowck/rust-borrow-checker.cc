@@ -21,7 +21,10 @@
 #include "rust-bir-fact-collector.h"
 #include "rust-bir-builder.h"
 #include "rust-bir-dump.h"
+#include "rust-bir-drop-elaboration.h"
 #include "polonius/rust-polonius.h"
+#include "rust-self-profile.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace HIR {
@@ -56,6 +59,186 @@ dump_function_bir (const std::string &filename, BIR::Function &func,
   file.close ();
 }
 
+// Dump where the locals of a function are dropped, and how
+static void
+dump_function_drops (const std::string &filename,
+		     const std::vector<BIR::Drop> &drops)
+{
+  static const char *kinds[] = {"none", "static", "conditional"};
+
+  std::ofstream file;
+  file.open (filename);
+  if (file.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "Failed to open file %s",
+		     filename.c_str ());
+      return;
+    }
+  for (auto &drop : drops)
+    file << "bb" << drop.bb << "[" << drop.stmt << "]: drop(_"
+	 << drop.place - 1 << ") " << kinds[static_cast<int> (drop.kind)]
+	 << "\n";
+  file.close ();
+}
+
+using FactsDumper = void (Polonius::Facts::*) (std::ostream &) const;
+
+static const std::pair<const char *, FactsDumper> fact_relations[] = {
+  {"loan_issued_at", &Polonius::Facts::dump_loan_issued_at},
+  {"loan_killed_at", &Polonius::Facts::dump_loan_killed_at},
+  {"loan_invalidated_at", &Polonius::Facts::dump_loan_invalidated_at},
+  {"subset_base", &Polonius::Facts::dump_subset_base},
+  {"universal_region", &Polonius::Facts::dump_universal_region},
+  {"cfg_edge", &Polonius::Facts::dump_cfg_edge},
+  {"var_used_at", &Polonius::Facts::dump_var_used_at},
+  {"var_defined_at", &Polonius::Facts::dump_var_defined_at},
+  {"var_dropped_at", &Polonius::Facts::dump_var_dropped_at},
+  {"use_of_var_derefs_origin",
+   &Polonius::Facts::dump_use_of_var_derefs_origin},
+  {"drop_of_var_derefs_origin",
+   &Polonius::Facts::dump_drop_of_var_derefs_origin},
+  {"child_path", &Polonius::Facts::dump_child_path},
+  {"path_is_var", &Polonius::Facts::dump_path_is_var},
+  {"known_placeholder_subset",
+   &Polonius::Facts::dump_known_placeholder_subset},
+  {"path_moved_at_base", &Polonius::Facts::dump_path_moved_at_base},
+  {"path_accessed_at_base", &Polonius::Facts::dump_path_accessed_at_base},
+  {"path_assigned_at_base", &Polonius::Facts::dump_path_assigned_at_base},
+  {"placeholder", &Polonius::Facts::dump_placeholder},
+};
+
+// Dump the facts of the function NAME in its own directory, one file per
+// relation, as expected by the polonius command line tool
+static void
+dump_function_facts (const Polonius::Facts &facts, const std::string &name)
+{
+  mkdir_wrapped ("nll_facts_gccrs/" + name);
+  for (auto &relation : fact_relations)
+    {
+      std::string filename
+	= "nll_facts_gccrs/" + name + "/" + relation.first + ".facts";
+      std::ofstream file;
+      file.open (filename);
+      if (file.fail ())
+	{
+	  abort ();
+	}
+
+      (facts.*relation.second) (file);
+    }
+}
+
+// Open the files of -frust-dump-bir-facts=per-relation, which hold a relation
+// for all the functions of the crate
+static std::vector<std::unique_ptr<std::ofstream>>
+open_relation_files ()
+{
+  std::vector<std::unique_ptr<std::ofstream>> files;
+  for (auto &relation : fact_relations)
+    {
+      std::string filename
+	= std::string ("nll_facts_gccrs/") + relation.first + ".facts";
+      files.emplace_back (new std::ofstream (filename));
+      if (files.back ()->fail ())
+	{
+	  abort ();
+	}
+    }
+
+  return files;
+}
+
+// Append the facts of the function NAME to the per-relation files, every line
+// starts with NAME and a tab so that the facts of a single function can be
+// picked out with `grep "^NAME<tab>"'
+static void
+append_function_facts (std::vector<std::unique_ptr<std::ofstream>> &files,
+		       const Polonius::Facts &facts, const std::string &name)
+{
+  for (size_t i = 0; i < files.size (); i++)
+    {
+      std::stringstream relation;
+      (facts.*fact_relations[i].second) (relation);
+
+      std::string line;
+      while (std::getline (relation, line))
+	*files[i] << name << '\t' << line << '\n';
+    }
+}
+
+/* Whether polonius cannot find any error in FUNC: it has no loan, no place
+   carrying a region and no place which could be moved.  */
+static bool
+is_trivially_borrow_correct (const BIR::Function &func)
+{
+  if (!func.place_db.get_loans ().empty ()
+      || func.universal_regions.has_regions ()
+      || !func.universal_region_bounds.empty ())
+    return false;
+
+  for (auto &place : func.place_db)
+    if (place.kind != BIR::Place::INVALID
+	&& (place.regions.has_regions () || !place.is_copy))
+      return false;
+
+  return true;
+}
+
+/* Run polonius on the facts of each function. Building the BIR and
+   collecting the facts report diagnostics and use the compiler's global
+   state, so they stay on the main thread, but polonius only reads the facts
+   and runs on up to -frust-borrowcheck-jobs= threads. The self profile only
+   records the run of each function of FUNCTIONS on a single thread.  */
+static std::vector<Polonius::FFI::Output>
+run_polonius (const std::vector<HIR::Function *> &functions,
+	      std::vector<Polonius::Facts> &function_facts)
+{
+  std::vector<Polonius::FFI::Output> results (function_facts.size ());
+
+  // the dumps of polonius go to stdout and must not be interleaved
+  bool dump = rust_be_debug_p ();
+  size_t jobs = dump ? 1 : flag_rust_borrowcheck_jobs;
+  jobs = std::max<size_t> (1, std::min (jobs, function_facts.size ()));
+
+  auto algorithm
+    = static_cast<Polonius::FFI::Algorithm> (flag_rust_borrowcheck_algorithm);
+
+  ThreadState state = ThreadState::current ();
+  auto run_batch = [&] (size_t batch) {
+    ThreadState::Adopt adopt (state);
+    for (size_t i = batch; i < function_facts.size (); i += jobs)
+      results[i] = Polonius::polonius_run (function_facts[i].freeze (), dump,
+					   algorithm);
+  };
+
+  if (jobs == 1)
+    {
+      for (size_t i = 0; i < function_facts.size (); i++)
+	{
+	  SelfProfileScope profile ("polonius",
+				    functions[i]->get_mappings ().get_nodeid ());
+	  results[i] = Polonius::polonius_run (function_facts[i].freeze (),
+					       dump, algorithm);
+	}
+
+      return results;
+    }
+
+  SelfProfileScope profile ("polonius", "all functions");
+
+  // falls back to running the batches one after the other when no thread can
+  // be started
+  std::vector<std::future<void>> workers;
+  for (size_t batch = 1; batch < jobs; batch++)
+    workers.emplace_back (std::async (worker_launch, run_batch, batch));
+  run_batch (0);
+
+  for (auto &worker : workers)
+    worker.wait ();
+
+  return results;
+}
+
 void
 BorrowChecker::go (HIR::Crate &crate)
 {
@@ -70,14 +253,23 @@ BorrowChecker::go (HIR::Crate &crate)
       mkdir_wrapped ("nll_facts_gccrs");
     }
 
+  // empty unless the facts of all the functions go to the same files
+  std::vector<std::unique_ptr<std::ofstream>> relation_files;
+  if (enable_dump_bir && flag_rust_dump_bir_facts == 1)
+    relation_files = open_relation_files ();
+
   FunctionCollector collector;
   collector.go (crate);
 
+  std::vector<HIR::Function *> functions;
+  std::vector<Polonius::Facts> function_facts;
   for (auto func : collector.get_functions ())
     {
       rust_debug_loc (func->get_locus (), "\nChecking function %s\n",
 		      func->get_function_name ().as_string ().c_str ());
 
+      SelfProfileScope profile ("borrowck",
+				func->get_mappings ().get_nodeid ());
       BIR::BuilderContext ctx;
       BIR::Builder builder (ctx);
       auto bir = builder.build (*func);
@@ -89,71 +281,41 @@ BorrowChecker::go (HIR::Crate &crate)
 				 + ".bir.dump";
 	  dump_function_bir (filename, bir,
 			     func->get_function_name ().as_string ());
+
+	  // nothing lowers the drops yet, they are only computed to be dumped
+	  auto drops = BIR::DropElaboration::elaborate (bir);
+	  filename = "bir_dump/" + crate_name + "."
+		     + func->get_function_name ().as_string () + ".drops.dump";
+	  dump_function_drops (filename, drops);
 	}
 
+      // the facts are still dumped for the functions skipped here
+      if (!enable_dump_bir && is_trivially_borrow_correct (bir))
+	continue;
+
       auto facts = BIR::FactCollector::collect (bir);
 
       if (enable_dump_bir)
 	{
-	  mkdir_wrapped ("nll_facts_gccrs/"
-			 + func->get_function_name ().as_string ());
-	  auto dump_facts_to_file
-	    = [&] (const std::string &suffix,
-		   void (Polonius::Facts::*fn) (std::ostream &) const) {
-		std::string filename = "nll_facts_gccrs/"
-				       + func->get_function_name ().as_string ()
-				       + "/" + suffix + ".facts";
-		std::ofstream file;
-		file.open (filename);
-		if (file.fail ())
-		  {
-		    abort ();
-		  }
-
-		// Run dump
-		// BEWARE: this callback charade is a workaround because gcc48
-		// won't let me return a file from a function
-		(facts.*fn) (file);
-	      };
-
-	  dump_facts_to_file ("loan_issued_at",
-			      &Polonius::Facts::dump_loan_issued_at);
-	  dump_facts_to_file ("loan_killed_at",
-			      &Polonius::Facts::dump_loan_killed_at);
-	  dump_facts_to_file ("loan_invalidated_at",
-			      &Polonius::Facts::dump_loan_invalidated_at);
-	  dump_facts_to_file ("subset_base",
-			      &Polonius::Facts::dump_subset_base);
-	  dump_facts_to_file ("universal_region",
-			      &Polonius::Facts::dump_universal_region);
-	  dump_facts_to_file ("cfg_edge", &Polonius::Facts::dump_cfg_edge);
-	  dump_facts_to_file ("var_used_at",
-			      &Polonius::Facts::dump_var_used_at);
-	  dump_facts_to_file ("var_defined_at",
-			      &Polonius::Facts::dump_var_defined_at);
-	  dump_facts_to_file ("var_dropped_at",
-			      &Polonius::Facts::dump_var_dropped_at);
-	  dump_facts_to_file ("use_of_var_derefs_origin",
-			      &Polonius::Facts::dump_use_of_var_derefs_origin);
-	  dump_facts_to_file ("drop_of_var_derefs_origin",
-			      &Polonius::Facts::dump_drop_of_var_derefs_origin);
-	  dump_facts_to_file ("child_path", &Polonius::Facts::dump_child_path);
-	  dump_facts_to_file ("path_is_var",
-			      &Polonius::Facts::dump_path_is_var);
-	  dump_facts_to_file ("known_placeholder_subset",
-			      &Polonius::Facts::dump_known_placeholder_subset);
-	  dump_facts_to_file ("path_moved_at_base",
-			      &Polonius::Facts::dump_path_moved_at_base);
-	  dump_facts_to_file ("path_accessed_at_base",
-			      &Polonius::Facts::dump_path_accessed_at_base);
-	  dump_facts_to_file ("path_assigned_at_base",
-			      &Polonius::Facts::dump_path_assigned_at_base);
-	  dump_facts_to_file ("placeholder",
-			      &Polonius::Facts::dump_placeholder);
+	  std::string name = func->get_function_name ().as_string ();
+	  if (relation_files.empty ())
+	    dump_function_facts (facts, name);
+	  else
+	    append_function_facts (relation_files, facts, name);
 	}
 
-      auto result
-	= Polonius::polonius_run (facts.freeze (), rust_be_debug_p ());
+      functions.push_back (func);
+      function_facts.push_back (std::move (facts));
+    }
+
+  auto results = run_polonius (functions, function_facts);
+
+  // report in the order of the functions, whatever the order in which they
+  // were checked
+  for (size_t i = 0; i < functions.size (); i++)
+    {
+      auto func = functions[i];
+      auto &result = results[i];
 
       if (result.loan_errors)
 	{
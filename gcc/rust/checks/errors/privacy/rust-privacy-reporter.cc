@@ -81,6 +81,9 @@ proc_macro_privacy_check (std::unique_ptr<HIR::Item> &item)
 void
 PrivacyReporter::go (HIR::Crate &crate)
 {
+  size_t next = 0;
+  number_modules (crate.get_mappings ().get_nodeid (), next);
+
   for (auto &item : crate.get_items ())
     {
       if (Session::get_instance ().options.is_proc_macro ())
@@ -89,26 +92,31 @@ PrivacyReporter::go (HIR::Crate &crate)
     }
 }
 
-static bool
-is_child_module (Analysis::Mappings &mappings, NodeId parent,
-		 NodeId possible_child)
+void
+PrivacyReporter::number_modules (NodeId module, size_t &next)
 {
-  auto children = mappings.lookup_module_children (parent);
+  size_t first = next++;
 
-  if (!children)
-    return false;
+  if (auto children = mappings.lookup_module_children (module))
+    for (auto &child : *children)
+      number_modules (child, next);
 
-  // Visit all toplevel children
-  for (auto &child : *children)
-    if (child == possible_child)
-      return true;
+  module_intervals[module] = {first, next};
+}
 
-  // Now descend recursively in the child module tree
-  for (auto &child : *children)
-    if (is_child_module (mappings, child, possible_child))
-      return true;
+bool
+PrivacyReporter::is_child_module (NodeId parent, NodeId possible_child) const
+{
+  auto parent_it = module_intervals.find (parent);
+  auto child_it = module_intervals.find (possible_child);
+  if (parent_it == module_intervals.end ()
+      || child_it == module_intervals.end ())
+    return false;
 
-  return false;
+  auto &parent_interval = parent_it->second;
+  auto &child_interval = child_it->second;
+  return parent_interval.first < child_interval.first
+	 && child_interval.second <= parent_interval.second;
 }
 
 // FIXME: This function needs a lot of refactoring
@@ -157,7 +165,7 @@ PrivacyReporter::check_for_privacy_violation (const NodeId &use_id,
 
 	// FIXME: This needs a LOT of TLC: hinting about the definition, a
 	// string to say if it's a module, function, type, etc...
-	if (!is_child_module (mappings, mod_node_id, current_module.value ()))
+	if (!is_child_module (mod_node_id, current_module.value ()))
 	  valid = false;
       }
       break;
@@ -249,6 +257,8 @@ PrivacyReporter::check_base_type_privacy (Analysis::NodeMapping &node_mappings,
     case TyTy::DYNAMIC:
       // The never type is builtin and always available
     case TyTy::NEVER:
+      // Const generic arguments are values, not types
+    case TyTy::CONST:
       // We shouldn't have inference types here, ever
     case TyTy::INFER:
       return;
@@ -623,6 +633,18 @@ PrivacyReporter::visit (HIR::AsyncBlockExpr &)
   // Not handled yet
 }
 
+void
+PrivacyReporter::visit (HIR::InlineAsm &expr)
+{
+  for (auto &operand : expr.get_operands ())
+    {
+      if (operand.has_expr ())
+	operand.expr->accept_vis (*this);
+      if (operand.has_out_expr ())
+	operand.out_expr->accept_vis (*this);
+    }
+}
+
 void
 PrivacyReporter::visit (HIR::Module &module)
 {
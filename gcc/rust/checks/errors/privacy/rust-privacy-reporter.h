@@ -77,6 +77,18 @@ types
    */
   void check_type_privacy (const HIR::Type *type);
 
+  /**
+   * Number the module tree rooted at MODULE in depth-first order, starting
+   * at NEXT. The interval of a module contains the intervals of all the
+   * modules nested in it, which makes nesting checks constant time.
+   */
+  void number_modules (NodeId module, size_t &next);
+
+  /**
+   * Is POSSIBLE_CHILD nested, at any depth, in the module PARENT?
+   */
+  bool is_child_module (NodeId parent, NodeId possible_child) const;
+
   virtual void visit (HIR::StructExprFieldIdentifier &field);
   virtual void visit (HIR::StructExprFieldIdentifierValue &field);
   virtual void visit (HIR::StructExprFieldIndexValue &field);
@@ -126,6 +138,7 @@ types
   virtual void visit (HIR::MatchExpr &expr);
   virtual void visit (HIR::AwaitExpr &expr);
   virtual void visit (HIR::AsyncBlockExpr &expr);
+  virtual void visit (HIR::InlineAsm &expr);
 
   virtual void visit (HIR::EnumItemTuple &);
   virtual void visit (HIR::EnumItemStruct &);
@@ -158,6 +171,9 @@ types
 
   // `None` means we're in the root module - the crate
   tl::optional<NodeId> current_module;
+
+  // first and last number given to the nodes of each module's subtree
+  std::unordered_map<NodeId, std::pair<size_t, size_t>> module_intervals;
 };
 
 } // namespace Privacy
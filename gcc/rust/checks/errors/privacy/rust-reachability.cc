@@ -38,6 +38,17 @@ ReachabilityVisitor::get_reachability_level (
   return item_visibility.is_public () ? current_level : ReachLevel::Unreachable;
 }
 
+ReachLevel
+ReachabilityVisitor::get_reachability_level (const HIR::VisItem &item)
+{
+  auto &mappings = Analysis::Mappings::get ();
+  if (item.get_visibility ().is_public ()
+      && mappings.is_reexported_item (item.get_mappings ().get_nodeid ()))
+    return ReachLevel::Reachable;
+
+  return get_reachability_level (item.get_visibility ());
+}
+
 void
 ReachabilityVisitor::visit_generic_predicates (
   const std::vector<std::unique_ptr<HIR::GenericParam>> &generics,
@@ -69,9 +80,13 @@ ReachabilityVisitor::visit_generic_predicates (
 void
 ReachabilityVisitor::visit (HIR::Module &mod)
 {
-  auto reach = get_reachability_level (mod.get_visibility ());
+  auto reach = get_reachability_level (mod);
   reach = ctx.update_reachability (mod.get_mappings (), reach);
 
+  // the public items of a private module are not reachable either
+  auto old_level = current_level;
+  current_level = reach;
+
   for (auto &item : mod.get_items ())
     {
       // FIXME: Is that what we want to do? Yes? Only visit the items with
@@ -82,6 +97,8 @@ ReachabilityVisitor::visit (HIR::Module &mod)
       if (vis_item)
 	vis_item->accept_vis (*this);
     }
+
+  current_level = old_level;
 }
 
 void
@@ -101,10 +118,15 @@ ReachabilityVisitor::visit (HIR::UseDeclaration &use_decl)
 void
 ReachabilityVisitor::visit (HIR::Function &func)
 {
-  auto fn_reach = get_reachability_level (func.get_visibility ());
+  auto fn_reach = get_reachability_level (func);
 
   fn_reach = ctx.update_reachability (func.get_mappings (), fn_reach);
   visit_generic_predicates (func.get_generic_params (), fn_reach);
+
+  // let the backend give it internal linkage
+  if (fn_reach == ReachLevel::Unreachable)
+    Analysis::Mappings::get ().insert_unreachable_item (
+      func.get_mappings ().get_defid ());
 }
 
 void
@@ -204,7 +226,7 @@ ReachabilityVisitor::visit (HIR::ConstantItem &const_item)
 void
 ReachabilityVisitor::visit (HIR::StaticItem &static_item)
 {
-  auto reach = get_reachability_level (static_item.get_visibility ());
+  auto reach = get_reachability_level (static_item);
   reach = ctx.update_reachability (static_item.get_mappings (), reach);
 }
 
@@ -61,6 +61,12 @@ public:
    */
   ReachLevel get_reachability_level (const HIR::Visibility &item_visibility);
 
+  /**
+   * Get the initial reach level for an item, which may also be reached through
+   * a `pub use` re-exporting it from another module.
+   */
+  ReachLevel get_reachability_level (const HIR::VisItem &item);
+
   virtual void visit (HIR::Module &mod);
   virtual void visit (HIR::ExternCrate &crate);
   virtual void visit (HIR::UseDeclaration &use_decl);
@@ -75,10 +75,10 @@ VisibilityResolver::resolve_module_path (const HIR::SimplePath &restriction,
   rust_assert (hid.has_value ());
   auto ref = hid.value ();
 
-  auto crate = mappings.get_ast_crate (mappings.get_current_crate ());
+  auto &crate = mappings.get_hir_crate (mappings.get_current_crate ());
 
   // we may be dealing with pub(crate)
-  if (ref_node_id == crate.get_node_id ())
+  if (ref_node_id == crate.get_mappings ().get_nodeid ())
     // FIXME: What do we do here? There isn't a DefId for the Crate, so can we
     // actually do anything?
     // We basically want to return true always but just when exporting export
@@ -19,6 +19,7 @@
 #include "rust-ast-validation.h"
 #include "rust-common.h"
 #include "rust-diagnostics.h"
+#include "rust-hir-map.h"
 #include "rust-item.h"
 #include "rust-keyword-values.h"
 
@@ -76,6 +77,8 @@ ASTValidation::visit (AST::Union &item)
 void
 ASTValidation::visit (AST::Function &function)
 {
+  gate (function);
+
   const auto &qualifiers = function.get_qualifiers ();
   if (qualifiers.is_async () && qualifiers.is_const ())
     rust_error_at (function.get_locus (),
@@ -194,7 +197,87 @@ ASTValidation::visit (AST::Module &module)
   if (module.get_unsafety () == Unsafety::Unsafe)
     rust_error_at (module.get_locus (), "module cannot be declared unsafe");
 
+  // such as the runtime of the test harness, which is still validated
+  bool was_generated = in_generated_module;
+  if (Analysis::Mappings::get ().is_compiler_generated_item (
+	module.get_node_id ()))
+    in_generated_module = true;
+
   AST::ContextualASTVisitor::visit (module);
+  in_generated_module = was_generated;
+}
+
+void
+ASTValidation::visit (AST::LifetimeParam &lifetime_param)
+{
+  gate (lifetime_param);
+  AST::ContextualASTVisitor::visit (lifetime_param);
+}
+
+void
+ASTValidation::visit (AST::ConstGenericParam &const_param)
+{
+  gate (const_param);
+  AST::ContextualASTVisitor::visit (const_param);
+}
+
+void
+ASTValidation::visit (AST::BorrowExpr &expr)
+{
+  gate (expr);
+  AST::ContextualASTVisitor::visit (expr);
+}
+
+void
+ASTValidation::visit (AST::BoxExpr &expr)
+{
+  gate (expr);
+  AST::ContextualASTVisitor::visit (expr);
+}
+
+void
+ASTValidation::visit (AST::TypeParam &param)
+{
+  gate (param);
+  AST::ContextualASTVisitor::visit (param);
+}
+
+void
+ASTValidation::visit (AST::TraitImpl &impl)
+{
+  gate (impl);
+  AST::ContextualASTVisitor::visit (impl);
+}
+
+void
+ASTValidation::visit (AST::ExternalTypeItem &item)
+{
+  gate (item);
+  AST::ContextualASTVisitor::visit (item);
+}
+
+void
+ASTValidation::visit (AST::ExternBlock &block)
+{
+  // such as the intrinsics the builtin derives declare
+  if (!Analysis::Mappings::get ().is_compiler_generated_item (
+	block.get_node_id ()))
+    gate (block);
+  AST::ContextualASTVisitor::visit (block);
+}
+
+void
+ASTValidation::visit (AST::MacroRulesDefinition &rules_def)
+{
+  gate (rules_def);
+  AST::ContextualASTVisitor::visit (rules_def);
+}
+
+void
+ASTValidation::visit (AST::RangePattern &pattern)
+{
+  gate (pattern);
+  AST::ContextualASTVisitor::visit (pattern);
 }
 
 } // namespace Rust
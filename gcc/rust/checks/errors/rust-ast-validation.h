@@ -22,13 +22,20 @@
 #include "rust-ast-visitor.h"
 #include "rust-ast-full.h"
 #include "rust-item.h"
+#include "rust-feature-gate.h"
 
 namespace Rust {
 
+/**
+ * Validates the expanded crate. When given a FEATURE_GATE, the unstable
+ * features are checked during the same walk.
+ */
 class ASTValidation : public AST::ContextualASTVisitor
 {
 public:
-  ASTValidation () {}
+  ASTValidation (FeatureGate *feature_gate = nullptr)
+    : feature_gate (feature_gate)
+  {}
 
   using AST::ContextualASTVisitor::visit;
 
@@ -41,6 +48,30 @@ public:
   virtual void visit (AST::Union &item);
   virtual void visit (AST::Function &function);
   virtual void visit (AST::Trait &trait);
+
+  // only checked by the feature gate
+  virtual void visit (AST::LifetimeParam &lifetime_param);
+  virtual void visit (AST::ConstGenericParam &const_param);
+  virtual void visit (AST::BorrowExpr &expr);
+  virtual void visit (AST::BoxExpr &expr);
+  virtual void visit (AST::TypeParam &param);
+  virtual void visit (AST::TraitImpl &impl);
+  virtual void visit (AST::ExternalTypeItem &item);
+  virtual void visit (AST::ExternBlock &block);
+  virtual void visit (AST::MacroRulesDefinition &rules_def);
+  virtual void visit (AST::RangePattern &pattern);
+
+private:
+  template <typename T> void gate (T &node)
+  {
+    if (feature_gate && !in_generated_module)
+      feature_gate->check (node);
+  }
+
+  FeatureGate *feature_gate;
+  // whether the walk is within a module the compiler generated, whose items
+  // may use unstable features the crate did not enable
+  bool in_generated_module = false;
 };
 
 } // namespace Rust
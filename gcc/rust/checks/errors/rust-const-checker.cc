@@ -35,7 +35,13 @@ void
 ConstChecker::go (HIR::Crate &crate)
 {
   for (auto &item : crate.get_items ())
-    item->accept_vis (*this);
+    go (*item);
+}
+
+void
+ConstChecker::go (HIR::Item &item)
+{
+  item.accept_vis (*this);
 }
 
 bool
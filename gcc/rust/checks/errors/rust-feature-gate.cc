@@ -19,19 +19,12 @@
 #include "rust-feature-gate.h"
 #include "rust-abi.h"
 #include "rust-attribute-values.h"
-#include "rust-ast-visitor.h"
 #include "rust-feature.h"
 
 namespace Rust {
 
 void
-FeatureGate::check (AST::Crate &crate)
-{
-  visit (crate);
-}
-
-void
-FeatureGate::visit (AST::Crate &crate)
+FeatureGate::collect_features (AST::Crate &crate)
 {
   valid_features.clear ();
 
@@ -64,8 +57,6 @@ FeatureGate::visit (AST::Crate &crate)
 	    }
 	}
     }
-
-  AST::DefaultASTVisitor::visit (crate);
 }
 
 void
@@ -97,7 +88,7 @@ FeatureGate::gate (Feature::Name name, location_t loc,
 }
 
 void
-FeatureGate::visit (AST::ExternBlock &block)
+FeatureGate::check (AST::ExternBlock &block)
 {
   if (block.has_abi ())
     {
@@ -107,7 +98,6 @@ FeatureGate::visit (AST::ExternBlock &block)
 	gate (Feature::Name::INTRINSICS, block.get_locus (),
 	      "intrinsics are subject to change");
     }
-  AST::DefaultASTVisitor::visit (block);
 }
 
 void
@@ -138,71 +128,61 @@ FeatureGate::check_may_dangle_attribute (
 }
 
 void
-FeatureGate::visit (AST::MacroRulesDefinition &rules_def)
+FeatureGate::check (AST::MacroRulesDefinition &rules_def)
 {
   check_rustc_attri (rules_def.get_outer_attrs ());
 }
 
 void
-FeatureGate::visit (AST::Function &function)
+FeatureGate::check (AST::Function &function)
 {
   if (!function.is_external ())
     check_rustc_attri (function.get_outer_attrs ());
-
-  AST::DefaultASTVisitor::visit (function);
 }
 
 void
-FeatureGate::visit (AST::ExternalTypeItem &item)
+FeatureGate::check (AST::ExternalTypeItem &item)
 {
-  // TODO(mxlol233): The gating needs a complete visiting chain to activate
-  // `AST::ExternalTypeItem`.
   gate (Feature::Name::EXTERN_TYPES, item.get_locus (),
 	"extern types are experimental");
 }
 
 void
-FeatureGate::visit (AST::TraitImpl &impl)
+FeatureGate::check (AST::TraitImpl &impl)
 {
   if (impl.is_exclam ())
     gate (Feature::Name::NEGATIVE_IMPLS, impl.get_locus (),
 	  "negative_impls are not yet implemented");
-
-  AST::DefaultASTVisitor::visit (impl);
-};
+}
 
 void
-FeatureGate::visit (AST::BoxExpr &expr)
+FeatureGate::check (AST::BoxExpr &expr)
 {
   gate (
     Feature::Name::BOX_SYNTAX, expr.get_locus (),
     "box expression syntax is experimental; you can call `Box::new` instead");
-  AST::DefaultASTVisitor::visit (expr);
 }
 
 void
-FeatureGate::visit (AST::LifetimeParam &lifetime_param)
+FeatureGate::check (AST::LifetimeParam &lifetime_param)
 {
   check_may_dangle_attribute (lifetime_param.get_outer_attrs ());
-  AST::DefaultASTVisitor::visit (lifetime_param);
 }
 
 void
-FeatureGate::visit (AST::ConstGenericParam &const_param)
+FeatureGate::check (AST::ConstGenericParam &const_param)
 {
   check_may_dangle_attribute (const_param.get_outer_attrs ());
-  AST::DefaultASTVisitor::visit (const_param);
 }
 
 void
-FeatureGate::visit (AST::TypeParam &param)
+FeatureGate::check (AST::TypeParam &param)
 {
   check_may_dangle_attribute (param.get_outer_attrs ());
-  AST::DefaultASTVisitor::visit (param);
 }
 
 void
-FeatureGate::visit (AST::BorrowExpr &expr)
+FeatureGate::check (AST::BorrowExpr &expr)
 {
   if (expr.is_raw_borrow ())
     gate (Feature::Name::RAW_REF_OP, expr.get_locus (),
@@ -210,7 +190,7 @@ FeatureGate::visit (AST::BorrowExpr &expr)
 }
 
 void
-FeatureGate::visit (AST::RangePattern &pattern)
+FeatureGate::check (AST::RangePattern &pattern)
 {
   if (pattern.get_range_kind () == AST::RangeKind::EXCLUDED)
     gate (Feature::Name::EXCLUSIVE_RANGE_PATTERN, pattern.get_locus (),
@@ -105,8 +105,8 @@ readonly_error (location_t loc, tree arg, enum lvalue_use use)
 	      arg);
 }
 
-static void
-check_decl (tree *t)
+void
+ReadonlyCheck::check_decl (tree *t)
 {
   if (TREE_CODE (*t) == MODIFY_EXPR)
     {
@@ -119,8 +119,8 @@ check_decl (tree *t)
     }
 }
 
-static tree
-readonly_walk_fn (tree *t, int *, void *)
+tree
+ReadonlyCheck::check_node (tree *t, int *, void *)
 {
   switch (TREE_CODE (*t))
     {
@@ -134,31 +134,5 @@ readonly_walk_fn (tree *t, int *, void *)
   return NULL_TREE;
 }
 
-void
-ReadonlyCheck::Lint (Compile::Context &ctx)
-{
-  for (auto &fndecl : ctx.get_func_decls ())
-    {
-      for (tree p = DECL_ARGUMENTS (fndecl); p != NULL_TREE; p = DECL_CHAIN (p))
-	{
-	  check_decl (&p);
-	}
-
-      walk_tree_without_duplicates (&DECL_SAVED_TREE (fndecl),
-				    &readonly_walk_fn, &ctx);
-    }
-
-  for (auto &var : ctx.get_var_decls ())
-    {
-      tree decl = var->get_decl ();
-      check_decl (&decl);
-    }
-
-  for (auto &const_decl : ctx.get_const_decls ())
-    {
-      check_decl (&const_decl);
-    }
-}
-
 } // namespace Analysis
 } // namespace Rust
@@ -27,7 +27,9 @@ namespace Analysis {
 class ReadonlyCheck
 {
 public:
-  static void Lint (Compile::Context &ctx);
+  // Lint hooks called by GenericLints, see rust-lint-generic.h
+  static void check_decl (tree *t);
+  static tree check_node (tree *t, int *walk_subtrees, void *data);
 };
 
 } // namespace Analysis
@@ -37,7 +37,13 @@ void
 UnsafeChecker::go (HIR::Crate &crate)
 {
   for (auto &item : crate.get_items ())
-    item->accept_vis (*this);
+    go (*item);
+}
+
+void
+UnsafeChecker::go (HIR::Item &item)
+{
+  item.accept_vis (*this);
 }
 
 static void
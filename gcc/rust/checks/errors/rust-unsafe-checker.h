@@ -32,6 +32,8 @@ public:
   UnsafeChecker ();
 
   void go (HIR::Crate &crate);
+  // Check a single item of the crate, and the items nested in it
+  void go (HIR::Item &item);
 
 private:
   /**
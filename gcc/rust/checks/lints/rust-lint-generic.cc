@@ -0,0 +1,83 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-lint-generic.h"
+#include "rust-lint-unused-var.h"
+#include "rust-readonly-check.h"
+
+namespace Rust {
+namespace Analysis {
+
+struct GenericLint
+{
+  // called on the parameters, globals and constants
+  void (*check_decl) (tree *t);
+  // called on every node of the function bodies
+  walk_tree_fn check_node;
+};
+
+// in the order they used to run in as separate walks
+static const GenericLint generic_lints[] = {
+  {UnusedVariables::check_decl, UnusedVariables::check_node},
+  {ReadonlyCheck::check_decl, ReadonlyCheck::check_node},
+};
+
+static void
+check_decl (tree *t)
+{
+  for (auto &lint : generic_lints)
+    lint.check_decl (t);
+}
+
+static tree
+generic_lints_walk_fn (tree *t, int *walk_subtrees, void *data)
+{
+  for (auto &lint : generic_lints)
+    lint.check_node (t, walk_subtrees, data);
+
+  return NULL_TREE;
+}
+
+void
+GenericLints::Lint (Compile::Context &ctx)
+{
+  for (auto &fndecl : ctx.get_func_decls ())
+    {
+      for (tree p = DECL_ARGUMENTS (fndecl); p != NULL_TREE; p = DECL_CHAIN (p))
+	{
+	  check_decl (&p);
+	}
+
+      walk_tree_without_duplicates (&DECL_SAVED_TREE (fndecl),
+				    &generic_lints_walk_fn, &ctx);
+    }
+
+  for (auto &var : ctx.get_var_decls ())
+    {
+      tree decl = var->get_decl ();
+      check_decl (&decl);
+    }
+
+  for (auto &const_decl : ctx.get_const_decls ())
+    {
+      check_decl (&const_decl);
+    }
+}
+
+} // namespace Analysis
+} // namespace Rust
@@ -0,0 +1,41 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_LINT_GENERIC
+#define RUST_LINT_GENERIC
+
+#include "rust-compile-context.h"
+
+namespace Rust {
+namespace Analysis {
+
+/**
+ * Runs the lints checking the GENERIC of the compiled crate. Each function
+ * body is walked a single time, and every node is handed to all the lints
+ * in turn, as are the parameters, globals and constants.
+ */
+class GenericLints
+{
+public:
+  static void Lint (Compile::Context &ctx);
+};
+
+} // namespace Analysis
+} // namespace Rust
+
+#endif // RUST_LINT_GENERIC
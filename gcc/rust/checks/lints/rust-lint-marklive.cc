@@ -85,7 +85,6 @@ MarkLive::go (HIR::Crate &)
     {
       HirId hirId = worklist.back ();
       worklist.pop_back ();
-      scannedSymbols.emplace (hirId);
       liveSymbols.emplace (hirId);
       if (auto item = mappings.lookup_hir_item (hirId))
 	item.value ()->accept_vis (*this);
@@ -244,7 +243,7 @@ MarkLive::visit (HIR::TypeAlias &alias)
 void
 MarkLive::mark_hir_id (HirId id)
 {
-  if (scannedSymbols.find (id) == scannedSymbols.end ())
+  if (scannedSymbols.emplace (id).second)
     {
       worklist.push_back (id);
     }
@@ -162,6 +162,18 @@ public:
       argument->accept_vis (*this);
   }
 
+  void visit (HIR::InlineAsm &expr) override
+  {
+    // sym operands name the functions and statics they use
+    for (auto &operand : expr.get_operands ())
+      {
+	if (operand.has_expr ())
+	  operand.expr->accept_vis (*this);
+	if (operand.has_out_expr ())
+	  operand.out_expr->accept_vis (*this);
+      }
+  }
+
   void visit (HIR::ArithmeticOrLogicalExpr &expr) override
   {
     expr.visit_lhs (*this);
@@ -275,12 +287,15 @@ public:
 private:
   std::vector<HirId> worklist;
   std::set<HirId> liveSymbols;
-  std::set<HirId> scannedSymbols;
+  // the symbols which were ever pushed to the worklist, so that each of them
+  // is only walked once
+  std::unordered_set<HirId> scannedSymbols;
   Analysis::Mappings &mappings;
   Resolver::Resolver *resolver;
   Resolver::TypeCheckContext *tyctx;
   MarkLive (std::vector<HirId> worklist)
-    : worklist (worklist), mappings (Analysis::Mappings::get ()),
+    : worklist (worklist), scannedSymbols (worklist.begin (), worklist.end ()),
+      mappings (Analysis::Mappings::get ()),
       resolver (Resolver::Resolver::get ()),
       tyctx (Resolver::TypeCheckContext::get ()){};
 
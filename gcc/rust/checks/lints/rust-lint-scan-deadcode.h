@@ -40,9 +40,8 @@ class ScanDeadcode : public MarkLiveBase
   using Rust::Analysis::MarkLiveBase::visit;
 
 public:
-  static void Scan (HIR::Crate &crate)
+  static void Scan (HIR::Crate &crate, std::set<HirId> &live_symbols)
   {
-    std::set<HirId> live_symbols = Analysis::MarkLive::Analysis (crate);
     ScanDeadcode sdc (live_symbols);
     for (auto &it : crate.get_items ())
       it.get ()->accept_vis (sdc);
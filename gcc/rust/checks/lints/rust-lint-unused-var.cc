@@ -22,8 +22,8 @@
 namespace Rust {
 namespace Analysis {
 
-static void
-check_decl (tree *t)
+void
+UnusedVariables::check_decl (tree *t)
 {
   rust_assert (TREE_CODE (*t) == VAR_DECL || TREE_CODE (*t) == PARM_DECL
 	       || TREE_CODE (*t) == CONST_DECL);
@@ -52,8 +52,8 @@ check_decl (tree *t)
     }
 }
 
-static tree
-unused_var_walk_fn (tree *t, int *, void *)
+tree
+UnusedVariables::check_node (tree *t, int *, void *)
 {
   switch (TREE_CODE (*t))
     {
@@ -68,31 +68,5 @@ unused_var_walk_fn (tree *t, int *, void *)
   return NULL_TREE;
 }
 
-void
-UnusedVariables::Lint (Compile::Context &ctx)
-{
-  for (auto &fndecl : ctx.get_func_decls ())
-    {
-      for (tree p = DECL_ARGUMENTS (fndecl); p != NULL_TREE; p = DECL_CHAIN (p))
-	{
-	  check_decl (&p);
-	}
-
-      walk_tree_without_duplicates (&DECL_SAVED_TREE (fndecl),
-				    &unused_var_walk_fn, &ctx);
-    }
-
-  for (auto &var : ctx.get_var_decls ())
-    {
-      tree decl = var->get_decl ();
-      check_decl (&decl);
-    }
-
-  for (auto &const_decl : ctx.get_const_decls ())
-    {
-      check_decl (&const_decl);
-    }
-}
-
 } // namespace Analysis
 } // namespace Rust
@@ -23,6 +23,15 @@
 #include "rust-item.h"
 
 namespace Rust {
+
+// Expands the cfg_attr attributes of ATTRS
+void
+expand_cfg_attrs (AST::AttrVec &attrs);
+
+// Is one of the cfg predicates of ATTRS false, so that their node goes away?
+bool
+fails_cfg_with_expand (AST::AttrVec &attrs);
+
 // Visitor used to maybe_strip attributes.
 class CfgStrip : public AST::DefaultASTVisitor
 {
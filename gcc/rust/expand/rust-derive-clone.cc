@@ -94,10 +94,16 @@ DeriveClone::clone_impl (std::unique_ptr<AssociatedItem> &&clone_fn,
 
 // TODO: Create new `make_qualified_call` helper function
 
-DeriveClone::DeriveClone (location_t loc)
-  : DeriveVisitor (loc), expanded (nullptr)
+DeriveClone::DeriveClone (location_t loc, bool is_copy)
+  : DeriveVisitor (loc), expanded (nullptr), is_copy (is_copy)
 {}
 
+std::unique_ptr<Expr>
+DeriveClone::copy_self ()
+{
+  return builder.deref (builder.identifier ("self"));
+}
+
 std::unique_ptr<AST::Item>
 DeriveClone::go (Item &item)
 {
@@ -111,6 +117,14 @@ DeriveClone::go (Item &item)
 void
 DeriveClone::visit_tuple (TupleStruct &item)
 {
+  // the `Copy` impl of a generic type has bounds the `Clone` one does not
+  if (is_copy && !item.has_generics ())
+    {
+      expanded = clone_impl (clone_fn (copy_self ()),
+			     item.get_identifier ().as_string ());
+      return;
+    }
+
   auto cloned_fields = std::vector<std::unique_ptr<Expr>> ();
 
   for (size_t idx = 0; idx < item.get_fields ().size (); idx++)
@@ -137,6 +151,13 @@ DeriveClone::visit_struct (StructStruct &item)
       return;
     }
 
+  if (is_copy && !item.has_generics ())
+    {
+      expanded = clone_impl (clone_fn (copy_self ()),
+			     item.get_struct_name ().as_string ());
+      return;
+    }
+
   auto cloned_fields = std::vector<std::unique_ptr<StructExprField>> ();
   for (auto &field : item.get_fields ())
     {
@@ -182,9 +203,7 @@ DeriveClone::visit_union (Union &item)
   auto stmts = std::vector<std::unique_ptr<Stmt>> ();
   stmts.emplace_back (
     builder.let (builder.wildcard (), std::move (full_path), nullptr));
-  auto tail_expr = builder.deref (builder.identifier ("self"));
-
-  auto block = builder.block (std::move (stmts), std::move (tail_expr));
+  auto block = builder.block (std::move (stmts), copy_self ());
 
   expanded = clone_impl (clone_fn (std::move (block)),
 			 item.get_identifier ().as_string ());
@@ -27,12 +27,23 @@ namespace AST {
 class DeriveClone : DeriveVisitor
 {
 public:
-  DeriveClone (location_t loc);
+  /* IS_COPY is set when the item also derives `Copy`, in which case there is
+     no need to clone it field by field.  */
+  DeriveClone (location_t loc, bool is_copy = false);
 
   std::unique_ptr<AST::Item> go (Item &item);
 
 private:
   std::unique_ptr<Item> expanded;
+  bool is_copy;
+
+  /**
+   * Create the body of the "clone" function for a non-generic `Copy` type,
+   * which is a plain copy of the value, as rustc does
+   *
+   * *self
+   */
+  std::unique_ptr<Expr> copy_self ();
 
   /**
    * Create a call to "clone". For now, this creates a call to
@@ -0,0 +1,173 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-derive-debug.h"
+#include "rust-item.h"
+
+namespace Rust {
+namespace AST {
+
+DeriveDebug::DeriveDebug (location_t loc)
+  : DeriveVisitor (loc), expanded (nullptr)
+{}
+
+std::unique_ptr<AST::Item>
+DeriveDebug::go (Item &item)
+{
+  item.accept_vis (*this);
+
+  // the items we cannot derive `Debug` for have been diagnosed already
+  return std::move (expanded);
+}
+
+std::unique_ptr<Expr>
+DeriveDebug::formatter_call (std::string method, std::string content)
+{
+  auto args = std::vector<std::unique_ptr<Expr>> ();
+  args.emplace_back (builder.literal_string (std::move (content)));
+
+  return builder.method_call (builder.identifier ("f"), method,
+			      std::move (args));
+}
+
+std::unique_ptr<Expr>
+DeriveDebug::debug_fields (
+  std::unique_ptr<Expr> &&debug_builder,
+  std::vector<std::vector<std::unique_ptr<Expr>>> &&fields)
+{
+  for (auto &field : fields)
+    debug_builder = builder.method_call (std::move (debug_builder), "field",
+					 std::move (field));
+
+  return builder.method_call (std::move (debug_builder), "finish", {});
+}
+
+std::unique_ptr<AssociatedItem>
+DeriveDebug::fmt_fn (std::unique_ptr<Expr> &&fmt_expr)
+{
+  auto block = std::unique_ptr<BlockExpr> (
+    new BlockExpr ({}, std::move (fmt_expr), {}, {}, AST::LoopLabel::error (),
+		   loc, loc));
+
+  std::unique_ptr<SelfParam> self (new SelfParam (Lifetime::error (),
+						  /* is_mut */ false, loc));
+
+  auto formatter = std::unique_ptr<TypeNoBounds> (
+    new TypePath (core_type_path ({"fmt", "Formatter"})));
+
+  std::vector<std::unique_ptr<Param>> params;
+  params.push_back (std::move (self));
+  params.emplace_back (
+    new FunctionParam (builder.identifier_pattern ("f"),
+		       builder.ref_type (std::move (formatter), true), {}, loc));
+
+  auto result
+    = std::unique_ptr<Type> (new TypePath (core_type_path ({"fmt", "Result"})));
+
+  return std::unique_ptr<AssociatedItem> (
+    new Function ({"fmt"}, builder.fn_qualifiers (), /* generics */ {},
+		  /* function params */ std::move (params), std::move (result),
+		  WhereClause::create_empty (), std::move (block),
+		  Visibility::create_private (), {}, loc));
+}
+
+std::unique_ptr<Item>
+DeriveDebug::fmt_impl (std::unique_ptr<AssociatedItem> &&fmt_fn,
+		       std::string name)
+{
+  auto trait_items = std::vector<std::unique_ptr<AssociatedItem>> ();
+  trait_items.emplace_back (std::move (fmt_fn));
+
+  return std::unique_ptr<Item> (
+    new TraitImpl (core_type_path ({"fmt", "Debug"}), /* unsafe */ false,
+		   /* exclam */ false, std::move (trait_items),
+		   /* generics */ {}, builder.single_type_path (name),
+		   WhereClause::create_empty (), Visibility::create_private (),
+		   {}, {}, loc));
+}
+
+void
+DeriveDebug::visit_tuple (TupleStruct &item)
+{
+  auto name = item.get_identifier ().as_string ();
+
+  // a tuple struct without fields is printed like a unit struct
+  if (item.get_fields ().empty ())
+    {
+      expanded = fmt_impl (fmt_fn (formatter_call ("write_str", name)), name);
+      return;
+    }
+
+  auto fields = std::vector<std::vector<std::unique_ptr<Expr>>> ();
+  for (size_t idx = 0; idx < item.get_fields ().size (); idx++)
+    {
+      auto args = std::vector<std::unique_ptr<Expr>> ();
+      args.emplace_back (builder.ref (builder.tuple_idx ("self", idx)));
+      fields.emplace_back (std::move (args));
+    }
+
+  expanded
+    = fmt_impl (fmt_fn (debug_fields (formatter_call ("debug_tuple", name),
+				      std::move (fields))),
+		name);
+}
+
+void
+DeriveDebug::visit_struct (StructStruct &item)
+{
+  auto name = item.get_struct_name ().as_string ();
+
+  if (item.is_unit_struct ())
+    {
+      expanded = fmt_impl (fmt_fn (formatter_call ("write_str", name)), name);
+      return;
+    }
+
+  auto fields = std::vector<std::vector<std::unique_ptr<Expr>>> ();
+  for (auto &field : item.get_fields ())
+    {
+      auto field_name = field.get_field_name ().as_string ();
+
+      auto args = std::vector<std::unique_ptr<Expr>> ();
+      args.emplace_back (builder.literal_string (std::string (field_name)));
+      args.emplace_back (builder.ref (
+	builder.field_access (builder.identifier ("self"), field_name)));
+      fields.emplace_back (std::move (args));
+    }
+
+  expanded
+    = fmt_impl (fmt_fn (debug_fields (formatter_call ("debug_struct", name),
+				      std::move (fields))),
+		name);
+}
+
+void
+DeriveDebug::visit_enum (Enum &item)
+{
+  rust_sorry_at (item.get_locus (), "cannot derive %qs for these items yet",
+		 "Debug");
+}
+
+void
+DeriveDebug::visit_union (Union &item)
+{
+  rust_error_at (item.get_locus (), "this trait cannot be derived for unions");
+}
+
+} // namespace AST
+} // namespace Rust
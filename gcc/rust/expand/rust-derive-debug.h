@@ -0,0 +1,84 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_DERIVE_DEBUG_H
+#define RUST_DERIVE_DEBUG_H
+
+#include "rust-derive.h"
+
+namespace Rust {
+namespace AST {
+
+class DeriveDebug : DeriveVisitor
+{
+public:
+  DeriveDebug (location_t loc);
+
+  std::unique_ptr<Item> go (Item &item);
+
+private:
+  std::unique_ptr<Item> expanded;
+
+  /**
+   * Call a method of the formatter with a single string argument
+   *
+   * f.<method>("<content>")
+   */
+  std::unique_ptr<Expr> formatter_call (std::string method,
+					std::string content);
+
+  /**
+   * Add fields to a `DebugStruct` or `DebugTuple` builder, then finish it
+   *
+   * <builder>.field(<field0>).field(<field1>).finish()
+   */
+  std::unique_ptr<Expr>
+  debug_fields (std::unique_ptr<Expr> &&debug_builder,
+		std::vector<std::vector<std::unique_ptr<Expr>>> &&fields);
+
+  /**
+   * Create the actual "fmt" function of the implementation, so
+   *
+   * fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+   *     <fmt_expr>
+   * }
+   *
+   */
+  std::unique_ptr<AssociatedItem> fmt_fn (std::unique_ptr<Expr> &&fmt_expr);
+
+  /**
+   * Create the Debug trait implementation for a type
+   *
+   * impl ::core::fmt::Debug for <type> {
+   *     <fmt_fn>
+   * }
+   *
+   */
+  std::unique_ptr<Item> fmt_impl (std::unique_ptr<AssociatedItem> &&fmt_fn,
+				  std::string name);
+
+  virtual void visit_struct (StructStruct &item);
+  virtual void visit_tuple (TupleStruct &item);
+  virtual void visit_enum (Enum &item);
+  virtual void visit_union (Union &item);
+};
+
+} // namespace AST
+} // namespace Rust
+
+#endif // ! RUST_DERIVE_DEBUG_H
@@ -0,0 +1,190 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-derive-hash.h"
+#include "rust-item.h"
+
+namespace Rust {
+namespace AST {
+
+DeriveHash::DeriveHash (location_t loc)
+  : DeriveVisitor (loc), expanded (nullptr)
+{}
+
+std::unique_ptr<AST::Item>
+DeriveHash::go (Item &item)
+{
+  item.accept_vis (*this);
+
+  // the items we cannot derive `Hash` for have been diagnosed already
+  return std::move (expanded);
+}
+
+std::unique_ptr<Stmt>
+DeriveHash::hash_field (std::unique_ptr<Expr> &&field)
+{
+  auto args = std::vector<std::unique_ptr<Expr>> ();
+  args.emplace_back (builder.ref (std::move (field)));
+  args.emplace_back (builder.identifier ("state"));
+
+  return builder.statement (
+    builder.call (core_path_expr ({"hash", "Hash", "hash"}), std::move (args)));
+}
+
+std::vector<std::unique_ptr<Stmt>>
+DeriveHash::hash_slice (const Type &field_type, size_t count,
+			std::vector<std::unique_ptr<Stmt>> &&hash_fields)
+{
+  auto transmute_params
+    = std::vector<std::pair<std::string, std::unique_ptr<Type>>> ();
+  transmute_params.emplace_back ("e", builder.single_type_path ("T"));
+
+  auto intrinsics = std::vector<std::unique_ptr<ExternalItem>> ();
+  intrinsics.emplace_back (uniform_integer_fields_intrinsic ());
+  intrinsics.emplace_back (intrinsic ("transmute", {"T", "U"},
+				      std::move (transmute_params),
+				      builder.single_type_path ("U")));
+
+  auto transmute_args = std::vector<std::unique_ptr<Expr>> ();
+  transmute_args.emplace_back (builder.identifier ("self"));
+
+  auto count_expr = std::unique_ptr<Expr> (
+    new LiteralExpr (std::to_string (count), Literal::INT,
+		     PrimitiveCoreType::CORETYPE_USIZE, {}, loc));
+  auto fields_type = std::unique_ptr<TypeNoBounds> (
+    new ArrayType (field_type.clone_type (), std::move (count_expr), loc));
+
+  auto slice_args = std::vector<std::unique_ptr<Expr>> ();
+  slice_args.emplace_back (builder.identifier ("fields"));
+  slice_args.emplace_back (builder.identifier ("state"));
+
+  auto hash_all = std::vector<std::unique_ptr<Stmt>> ();
+  hash_all.emplace_back (
+    builder.let (builder.identifier_pattern ("fields"),
+		 builder.ref_type (std::move (fields_type)),
+		 builder.unsafe_block (
+		   builder.call (builder.identifier ("transmute"),
+				 std::move (transmute_args)))));
+  hash_all.emplace_back (builder.statement (
+    builder.call (core_path_expr ({"hash", "Hash", "hash_slice"}),
+		  std::move (slice_args))));
+
+  auto stmts = std::vector<std::unique_ptr<Stmt>> ();
+  stmts.emplace_back (intrinsics_block (std::move (intrinsics)));
+  stmts.emplace_back (builder.statement (
+    builder.if_else (has_uniform_integer_fields (),
+		     builder.block (std::move (hash_all)),
+		     builder.block (std::move (hash_fields)))));
+
+  return stmts;
+}
+
+std::unique_ptr<AssociatedItem>
+DeriveHash::hash_fn (std::vector<std::unique_ptr<Stmt>> &&stmts)
+{
+  auto block = std::unique_ptr<BlockExpr> (
+    new BlockExpr (std::move (stmts), nullptr, {}, {},
+		   AST::LoopLabel::error (), loc, loc));
+
+  auto bounds = std::vector<std::unique_ptr<TypeParamBound>> ();
+  bounds.emplace_back (
+    new TraitBound (core_type_path ({"hash", "Hasher"}), loc));
+
+  auto generics = std::vector<std::unique_ptr<GenericParam>> ();
+  generics.emplace_back (
+    new TypeParam (Identifier ("H", loc), loc, std::move (bounds)));
+
+  std::unique_ptr<SelfParam> self (new SelfParam (Lifetime::error (),
+						  /* is_mut */ false, loc));
+
+  std::vector<std::unique_ptr<Param>> params;
+  params.push_back (std::move (self));
+  params.emplace_back (new FunctionParam (builder.identifier_pattern ("state"),
+					  builder.ref_type ("H", true), {},
+					  loc));
+
+  return std::unique_ptr<AssociatedItem> (
+    new Function ({"hash"}, builder.fn_qualifiers (), std::move (generics),
+		  /* function params */ std::move (params),
+		  /* return type */ nullptr, WhereClause::create_empty (),
+		  std::move (block), Visibility::create_private (), {}, loc));
+}
+
+std::unique_ptr<Item>
+DeriveHash::hash_impl (std::unique_ptr<AssociatedItem> &&hash_fn,
+		       std::string name)
+{
+  auto trait_items = std::vector<std::unique_ptr<AssociatedItem>> ();
+  trait_items.emplace_back (std::move (hash_fn));
+
+  return std::unique_ptr<Item> (
+    new TraitImpl (core_type_path ({"hash", "Hash"}), /* unsafe */ false,
+		   /* exclam */ false, std::move (trait_items),
+		   /* generics */ {}, builder.single_type_path (name),
+		   WhereClause::create_empty (), Visibility::create_private (),
+		   {}, {}, loc));
+}
+
+void
+DeriveHash::visit_tuple (TupleStruct &item)
+{
+  auto stmts = std::vector<std::unique_ptr<Stmt>> ();
+  for (size_t idx = 0; idx < item.get_fields ().size (); idx++)
+    stmts.emplace_back (hash_field (builder.tuple_idx ("self", idx)));
+
+  if (may_have_uniform_integer_fields (item))
+    stmts = hash_slice (item.get_fields ()[0].get_field_type (),
+			item.get_fields ().size (), std::move (stmts));
+
+  expanded = hash_impl (hash_fn (std::move (stmts)),
+			item.get_identifier ().as_string ());
+}
+
+void
+DeriveHash::visit_struct (StructStruct &item)
+{
+  auto stmts = std::vector<std::unique_ptr<Stmt>> ();
+  if (!item.is_unit_struct ())
+    for (auto &field : item.get_fields ())
+      stmts.emplace_back (hash_field (
+	builder.field_access (builder.identifier ("self"),
+			      field.get_field_name ().as_string ())));
+
+  if (may_have_uniform_integer_fields (item))
+    stmts = hash_slice (item.get_fields ()[0].get_field_type (),
+			item.get_fields ().size (), std::move (stmts));
+
+  expanded = hash_impl (hash_fn (std::move (stmts)),
+			item.get_struct_name ().as_string ());
+}
+
+void
+DeriveHash::visit_enum (Enum &item)
+{
+  rust_sorry_at (item.get_locus (), "cannot derive %qs for these items yet",
+		 "Hash");
+}
+
+void
+DeriveHash::visit_union (Union &item)
+{
+  rust_error_at (item.get_locus (), "this trait cannot be derived for unions");
+}
+
+} // namespace AST
+} // namespace Rust
@@ -0,0 +1,93 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_DERIVE_HASH_H
+#define RUST_DERIVE_HASH_H
+
+#include "rust-derive.h"
+
+namespace Rust {
+namespace AST {
+
+class DeriveHash : DeriveVisitor
+{
+public:
+  DeriveHash (location_t loc);
+
+  std::unique_ptr<Item> go (Item &item);
+
+private:
+  std::unique_ptr<Item> expanded;
+
+  /**
+   * Feed one field to the hasher
+   *
+   * ::core::hash::Hash::hash(&self.0, state);
+   */
+  std::unique_ptr<Stmt> hash_field (std::unique_ptr<Expr> &&field);
+
+  /**
+   * Feed all the COUNT fields of type FIELD_TYPE to the hasher at once when
+   * they turn out to be all of the same integer type, and run HASH_FIELDS
+   * otherwise
+   *
+   * extern "rust-intrinsic" {
+   *   fn has_uniform_integer_fields<T>(a: &T) -> bool;
+   *   fn transmute<T, U>(e: T) -> U;
+   * }
+   * if unsafe { has_uniform_integer_fields(self) } {
+   *   let fields: &[<field_type>; <count>] = unsafe { transmute(self) };
+   *   ::core::hash::Hash::hash_slice(fields, state);
+   * } else {
+   *   <hash_fields>
+   * }
+   */
+  std::vector<std::unique_ptr<Stmt>>
+  hash_slice (const Type &field_type, size_t count,
+	      std::vector<std::unique_ptr<Stmt>> &&hash_fields);
+
+  /**
+   * Create the actual "hash" function of the implementation, so
+   *
+   * fn hash<H: ::core::hash::Hasher>(&self, state: &mut H) { <stmts> }
+   *
+   */
+  std::unique_ptr<AssociatedItem>
+  hash_fn (std::vector<std::unique_ptr<Stmt>> &&stmts);
+
+  /**
+   * Create the Hash trait implementation for a type
+   *
+   * impl ::core::hash::Hash for <type> {
+   *     <hash_fn>
+   * }
+   *
+   */
+  std::unique_ptr<Item> hash_impl (std::unique_ptr<AssociatedItem> &&hash_fn,
+				   std::string name);
+
+  virtual void visit_struct (StructStruct &item);
+  virtual void visit_tuple (TupleStruct &item);
+  virtual void visit_enum (Enum &item);
+  virtual void visit_union (Union &item);
+};
+
+} // namespace AST
+} // namespace Rust
+
+#endif // ! RUST_DERIVE_HASH_H
@@ -0,0 +1,209 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-derive-ord.h"
+#include "rust-item.h"
+
+namespace Rust {
+namespace AST {
+
+DeriveOrd::DeriveOrd (location_t loc, bool is_partial)
+  : DeriveVisitor (loc), expanded (nullptr), is_partial (is_partial)
+{}
+
+std::unique_ptr<AST::Item>
+DeriveOrd::go (Item &item)
+{
+  item.accept_vis (*this);
+
+  // the items we cannot derive `Ord` for have been diagnosed already
+  return std::move (expanded);
+}
+
+std::string
+DeriveOrd::trait_name () const
+{
+  return is_partial ? "PartialOrd" : "Ord";
+}
+
+std::unique_ptr<Expr>
+DeriveOrd::cmp_call (std::unique_ptr<Expr> &&lhs, std::unique_ptr<Expr> &&rhs)
+{
+  auto args = std::vector<std::unique_ptr<Expr>> ();
+  args.emplace_back (builder.ref (std::move (lhs)));
+  args.emplace_back (builder.ref (std::move (rhs)));
+
+  auto method = is_partial ? "partial_cmp" : "cmp";
+
+  return builder.call (core_path_expr ({"cmp", trait_name (), method}),
+		       std::move (args));
+}
+
+std::unique_ptr<Expr>
+DeriveOrd::equal ()
+{
+  auto ordering = core_path_expr ({"cmp", "Ordering", "Equal"});
+  if (!is_partial)
+    return ordering;
+
+  auto args = std::vector<std::unique_ptr<Expr>> ();
+  args.emplace_back (std::move (ordering));
+
+  return builder.call (core_path_expr ({"option", "Option", "Some"}),
+		       std::move (args));
+}
+
+std::unique_ptr<Pattern>
+DeriveOrd::equal_pattern ()
+{
+  auto ordering
+    = builder.path_pattern (core_path ({"cmp", "Ordering", "Equal"}));
+  if (!is_partial)
+    return ordering;
+
+  auto items = std::vector<std::unique_ptr<Pattern>> ();
+  items.emplace_back (std::move (ordering));
+
+  return builder.tuple_struct_pattern (core_path ({"option", "Option", "Some"}),
+				       std::move (items));
+}
+
+std::unique_ptr<Expr>
+DeriveOrd::cmp_fields (
+  std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Expr>>> &&fields)
+{
+  if (fields.empty ())
+    return equal ();
+
+  // build the comparisons from the last field, which is compared as is, so
+  // that each one can be nested in the `match` of the field before it
+  std::unique_ptr<Expr> cmp_expr = cmp_call (std::move (fields.back ().first),
+					     std::move (fields.back ().second));
+
+  for (auto field = fields.rbegin () + 1; field != fields.rend (); field++)
+    {
+      auto cases = std::vector<MatchCase> ();
+      cases.emplace_back (
+	builder.match_case (equal_pattern (), std::move (cmp_expr)));
+      cases.emplace_back (
+	builder.match_case (builder.identifier_pattern ("cmp"),
+			    builder.identifier ("cmp")));
+
+      cmp_expr
+	= builder.match (cmp_call (std::move (field->first),
+				   std::move (field->second)),
+			 std::move (cases));
+    }
+
+  return cmp_expr;
+}
+
+std::unique_ptr<AssociatedItem>
+DeriveOrd::cmp_fn (std::unique_ptr<Expr> &&cmp_expr)
+{
+  auto block = std::unique_ptr<BlockExpr> (
+    new BlockExpr ({}, std::move (cmp_expr), {}, {}, AST::LoopLabel::error (),
+		   loc, loc));
+
+  std::unique_ptr<SelfParam> self (new SelfParam (Lifetime::error (),
+						  /* is_mut */ false, loc));
+
+  std::vector<std::unique_ptr<Param>> params;
+  params.push_back (std::move (self));
+  params.emplace_back (new FunctionParam (builder.identifier_pattern ("other"),
+					  builder.ref_type ("Self"), {}, loc));
+
+  auto ordering = std::unique_ptr<Type> (
+    new TypePath (core_type_path ({"cmp", "Ordering"})));
+  auto return_type = std::move (ordering);
+  if (is_partial)
+    return_type = builder.generic_type_path (core_type_path ({"option",
+							       "Option"}),
+					     std::move (return_type));
+
+  return std::unique_ptr<AssociatedItem> (
+    new Function ({is_partial ? "partial_cmp" : "cmp"},
+		  builder.fn_qualifiers (), /* generics */ {},
+		  /* function params */ std::move (params),
+		  std::move (return_type), WhereClause::create_empty (),
+		  std::move (block), Visibility::create_private (), {}, loc));
+}
+
+std::unique_ptr<Item>
+DeriveOrd::cmp_impl (std::unique_ptr<AssociatedItem> &&cmp_fn,
+		     std::string name)
+{
+  auto trait_items = std::vector<std::unique_ptr<AssociatedItem>> ();
+  trait_items.emplace_back (std::move (cmp_fn));
+
+  return std::unique_ptr<Item> (
+    new TraitImpl (core_type_path ({"cmp", trait_name ()}), /* unsafe */ false,
+		   /* exclam */ false, std::move (trait_items),
+		   /* generics */ {}, builder.single_type_path (name),
+		   WhereClause::create_empty (), Visibility::create_private (),
+		   {}, {}, loc));
+}
+
+void
+DeriveOrd::visit_tuple (TupleStruct &item)
+{
+  auto fields
+    = std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Expr>>> ();
+
+  for (size_t idx = 0; idx < item.get_fields ().size (); idx++)
+    fields.emplace_back (builder.tuple_idx ("self", idx),
+			 builder.tuple_idx ("other", idx));
+
+  expanded = cmp_impl (cmp_fn (cmp_fields (std::move (fields))),
+		       item.get_identifier ().as_string ());
+}
+
+void
+DeriveOrd::visit_struct (StructStruct &item)
+{
+  auto fields
+    = std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Expr>>> ();
+
+  if (!item.is_unit_struct ())
+    for (auto &field : item.get_fields ())
+      {
+	auto name = field.get_field_name ().as_string ();
+	fields.emplace_back (
+	  builder.field_access (builder.identifier ("self"), name),
+	  builder.field_access (builder.identifier ("other"), name));
+      }
+
+  expanded = cmp_impl (cmp_fn (cmp_fields (std::move (fields))),
+		       item.get_struct_name ().as_string ());
+}
+
+void
+DeriveOrd::visit_enum (Enum &item)
+{
+  rust_sorry_at (item.get_locus (), "cannot derive %qs for these items yet",
+		 trait_name ().c_str ());
+}
+
+void
+DeriveOrd::visit_union (Union &item)
+{
+  rust_error_at (item.get_locus (), "this trait cannot be derived for unions");
+}
+
+} // namespace AST
+} // namespace Rust
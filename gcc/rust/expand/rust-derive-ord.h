@@ -0,0 +1,108 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_DERIVE_ORD_H
+#define RUST_DERIVE_ORD_H
+
+#include "rust-derive.h"
+
+namespace Rust {
+namespace AST {
+
+/**
+ * DeriveOrd is used for both `Ord` and `PartialOrd`, which compare the fields
+ * of an item the same way: in declaration order, the first field which is not
+ * equal giving the result of the comparison
+ */
+class DeriveOrd : DeriveVisitor
+{
+public:
+  DeriveOrd (location_t loc, bool is_partial);
+
+  std::unique_ptr<Item> go (Item &item);
+
+private:
+  std::unique_ptr<Item> expanded;
+
+  bool is_partial;
+
+  /* The name of the derived trait, `Ord` or `PartialOrd` */
+  std::string trait_name () const;
+
+  /**
+   * Compare one field of both items
+   *
+   * ::core::cmp::Ord::cmp(&self.0, &other.0)
+   * ::core::cmp::PartialOrd::partial_cmp(&self.0, &other.0)
+   */
+  std::unique_ptr<Expr> cmp_call (std::unique_ptr<Expr> &&lhs,
+				  std::unique_ptr<Expr> &&rhs);
+
+  /**
+   * The result of comparing equal items, and the pattern matching it
+   *
+   * ::core::cmp::Ordering::Equal
+   * ::core::option::Option::Some(::core::cmp::Ordering::Equal)
+   */
+  std::unique_ptr<Expr> equal ();
+  std::unique_ptr<Pattern> equal_pattern ();
+
+  /**
+   * Chain the comparisons of the fields, so that the first one which is not
+   * equal is the result, and an item without fields is equal to itself
+   *
+   * match <cmp_call (self.0, other.0)> {
+   *     <equal_pattern> => <cmp_fields (rest)>,
+   *     cmp => cmp,
+   * }
+   */
+  std::unique_ptr<Expr>
+  cmp_fields (std::vector<std::pair<std::unique_ptr<Expr>,
+				    std::unique_ptr<Expr>>> &&fields);
+
+  /**
+   * Create the actual "cmp" or "partial_cmp" function of the implementation
+   *
+   * fn cmp(&self, other: &Self) -> ::core::cmp::Ordering { <cmp_expr> }
+   * fn partial_cmp(&self, other: &Self)
+   *     -> ::core::option::Option<::core::cmp::Ordering> { <cmp_expr> }
+   *
+   */
+  std::unique_ptr<AssociatedItem> cmp_fn (std::unique_ptr<Expr> &&cmp_expr);
+
+  /**
+   * Create the Ord or PartialOrd trait implementation for a type
+   *
+   * impl ::core::cmp::Ord for <type> {
+   *     <cmp_fn>
+   * }
+   *
+   */
+  std::unique_ptr<Item> cmp_impl (std::unique_ptr<AssociatedItem> &&cmp_fn,
+				  std::string name);
+
+  virtual void visit_struct (StructStruct &item);
+  virtual void visit_tuple (TupleStruct &item);
+  virtual void visit_enum (Enum &item);
+  virtual void visit_union (Union &item);
+};
+
+} // namespace AST
+} // namespace Rust
+
+#endif // ! RUST_DERIVE_ORD_H
@@ -0,0 +1,190 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-derive-partial-eq.h"
+#include "rust-item.h"
+
+namespace Rust {
+namespace AST {
+
+DerivePartialEq::DerivePartialEq (location_t loc)
+  : DeriveVisitor (loc), expanded (nullptr)
+{}
+
+std::unique_ptr<AST::Item>
+DerivePartialEq::go (Item &item)
+{
+  item.accept_vis (*this);
+
+  // the items we cannot derive `PartialEq` for have been diagnosed already
+  return std::move (expanded);
+}
+
+std::unique_ptr<Expr>
+DerivePartialEq::eq_fields (
+  std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Expr>>> &&fields)
+{
+  if (fields.empty ())
+    return builder.literal_bool (true);
+
+  std::unique_ptr<Expr> eq_expr = nullptr;
+  for (auto &field : fields)
+    {
+      auto cmp = builder.comparison (std::move (field.first),
+				     std::move (field.second),
+				     ComparisonOperator::EQUAL);
+      if (eq_expr)
+	eq_expr = builder.boolean_operation (std::move (eq_expr),
+					     std::move (cmp),
+					     LazyBooleanOperator::LOGICAL_AND);
+      else
+	eq_expr = std::move (cmp);
+    }
+
+  return eq_expr;
+}
+
+std::unique_ptr<Expr>
+DerivePartialEq::raw_eq (std::unique_ptr<Expr> &&eq_expr)
+{
+  auto params = std::vector<std::pair<std::string, std::unique_ptr<Type>>> ();
+  params.emplace_back ("a", builder.ref_type ("T"));
+  params.emplace_back ("b", builder.ref_type ("T"));
+
+  auto intrinsics = std::vector<std::unique_ptr<ExternalItem>> ();
+  intrinsics.emplace_back (intrinsic ("raw_eq", {"T"}, std::move (params),
+				      builder.single_type_path ("bool")));
+  intrinsics.emplace_back (uniform_integer_fields_intrinsic ());
+
+  auto stmts = std::vector<std::unique_ptr<Stmt>> ();
+  stmts.emplace_back (intrinsics_block (std::move (intrinsics)));
+
+  auto args = std::vector<std::unique_ptr<Expr>> ();
+  args.emplace_back (builder.identifier ("self"));
+  args.emplace_back (builder.identifier ("other"));
+
+  auto compare_bytes = builder.unsafe_block (
+    builder.call (builder.identifier ("raw_eq"), std::move (args)));
+
+  return builder.block (std::move (stmts),
+			builder.if_else (has_uniform_integer_fields (),
+					 std::move (compare_bytes),
+					 std::move (eq_expr)));
+}
+
+std::unique_ptr<AssociatedItem>
+DerivePartialEq::eq_fn (std::unique_ptr<Expr> &&eq_expr)
+{
+  auto block = std::unique_ptr<BlockExpr> (
+    new BlockExpr ({}, std::move (eq_expr), {}, {}, AST::LoopLabel::error (),
+		   loc, loc));
+
+  std::unique_ptr<SelfParam> self (new SelfParam (Lifetime::error (),
+						  /* is_mut */ false, loc));
+  auto other_pattern = std::unique_ptr<Pattern> (
+    new IdentifierPattern (Identifier ("other", loc), loc));
+
+  std::vector<std::unique_ptr<Param>> params;
+  params.push_back (std::move (self));
+  params.emplace_back (new FunctionParam (std::move (other_pattern),
+					  builder.ref_type ("Self"), {}, loc));
+
+  return std::unique_ptr<AssociatedItem> (
+    new Function ({"eq"}, builder.fn_qualifiers (), /* generics */ {},
+		  /* function params */ std::move (params),
+		  builder.single_type_path ("bool"),
+		  WhereClause::create_empty (), std::move (block),
+		  Visibility::create_private (), {}, loc));
+}
+
+std::unique_ptr<Item>
+DerivePartialEq::eq_impl (std::unique_ptr<AssociatedItem> &&eq_fn,
+			  std::string name)
+{
+  // should that be `$crate::core::cmp::PartialEq` instead?
+  auto segments = std::vector<std::unique_ptr<TypePathSegment>> ();
+  segments.emplace_back (builder.type_path_segment ("PartialEq"));
+  auto partial_eq = TypePath (std::move (segments), loc);
+
+  auto trait_items = std::vector<std::unique_ptr<AssociatedItem>> ();
+  trait_items.emplace_back (std::move (eq_fn));
+
+  return std::unique_ptr<Item> (
+    new TraitImpl (partial_eq, /* unsafe */ false,
+		   /* exclam */ false, std::move (trait_items),
+		   /* generics */ {}, builder.single_type_path (name),
+		   WhereClause::create_empty (), Visibility::create_private (),
+		   {}, {}, loc));
+}
+
+void
+DerivePartialEq::visit_tuple (TupleStruct &item)
+{
+  auto fields
+    = std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Expr>>> ();
+
+  for (size_t idx = 0; idx < item.get_fields ().size (); idx++)
+    fields.emplace_back (builder.tuple_idx ("self", idx),
+			 builder.tuple_idx ("other", idx));
+
+  auto eq_expr = eq_fields (std::move (fields));
+  if (may_have_uniform_integer_fields (item))
+    eq_expr = raw_eq (std::move (eq_expr));
+
+  expanded = eq_impl (eq_fn (std::move (eq_expr)),
+		      item.get_identifier ().as_string ());
+}
+
+void
+DerivePartialEq::visit_struct (StructStruct &item)
+{
+  auto fields
+    = std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Expr>>> ();
+
+  if (!item.is_unit_struct ())
+    for (auto &field : item.get_fields ())
+      {
+	auto name = field.get_field_name ().as_string ();
+	fields.emplace_back (
+	  builder.field_access (builder.identifier ("self"), name),
+	  builder.field_access (builder.identifier ("other"), name));
+      }
+
+  auto eq_expr = eq_fields (std::move (fields));
+  if (may_have_uniform_integer_fields (item))
+    eq_expr = raw_eq (std::move (eq_expr));
+
+  expanded = eq_impl (eq_fn (std::move (eq_expr)),
+		      item.get_struct_name ().as_string ());
+}
+
+void
+DerivePartialEq::visit_enum (Enum &item)
+{
+  rust_sorry_at (item.get_locus (), "cannot derive %qs for these items yet",
+		 "PartialEq");
+}
+
+void
+DerivePartialEq::visit_union (Union &item)
+{
+  rust_error_at (item.get_locus (), "this trait cannot be derived for unions");
+}
+
+} // namespace AST
+} // namespace Rust
@@ -0,0 +1,95 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_DERIVE_PARTIAL_EQ_H
+#define RUST_DERIVE_PARTIAL_EQ_H
+
+#include "rust-derive.h"
+
+namespace Rust {
+namespace AST {
+
+class DerivePartialEq : DeriveVisitor
+{
+public:
+  DerivePartialEq (location_t loc);
+
+  std::unique_ptr<AST::Item> go (Item &item);
+
+private:
+  std::unique_ptr<Item> expanded;
+
+  /**
+   * Chain the comparisons of the fields with `&&`, so that the first field
+   * which differs ends the comparison, and an item without fields is always
+   * equal to itself
+   *
+   * self.0 == other.0 && self.1 == other.1 && ...
+   */
+  std::unique_ptr<Expr>
+  eq_fields (std::vector<std::pair<std::unique_ptr<Expr>,
+				   std::unique_ptr<Expr>>> &&fields);
+
+  /**
+   * Compare the whole values at once when the fields turn out to be all of
+   * the same integer type and thus contain no padding, and with EQ_EXPR
+   * otherwise
+   *
+   * {
+   *   extern "rust-intrinsic" {
+   *     fn raw_eq<T>(a: &T, b: &T) -> bool;
+   *     fn has_uniform_integer_fields<T>(a: &T) -> bool;
+   *   }
+   *   if unsafe { has_uniform_integer_fields(self) } {
+   *     unsafe { raw_eq(self, other) }
+   *   } else {
+   *     <eq_expr>
+   *   }
+   * }
+   */
+  std::unique_ptr<Expr> raw_eq (std::unique_ptr<Expr> &&eq_expr);
+
+  /**
+   * Create the actual "eq" function of the implementation, so
+   *
+   * fn eq(&self, other: &Self) -> bool { <eq_expr> }
+   *
+   */
+  std::unique_ptr<AssociatedItem> eq_fn (std::unique_ptr<Expr> &&eq_expr);
+
+  /**
+   * Create the PartialEq trait implementation for a type
+   *
+   * impl PartialEq for <type> {
+   *     <eq_fn>
+   * }
+   *
+   */
+  std::unique_ptr<Item> eq_impl (std::unique_ptr<AssociatedItem> &&eq_fn,
+				 std::string name);
+
+  virtual void visit_struct (StructStruct &item);
+  virtual void visit_tuple (TupleStruct &item);
+  virtual void visit_enum (Enum &item);
+  virtual void visit_union (Union &item);
+};
+
+} // namespace AST
+} // namespace Rust
+
+#endif // ! RUST_DERIVE_PARTIAL_EQ_H
@@ -19,6 +19,16 @@
 #include "rust-derive.h"
 #include "rust-derive-clone.h"
 #include "rust-derive-copy.h"
+#include "rust-derive-debug.h"
+#include "rust-derive-eq.h"
+#include "rust-derive-hash.h"
+#include "rust-derive-ord.h"
+#include "rust-derive-partial-eq.h"
+#include "rust-session-manager.h"
+#include "rust-ast-dump.h"
+#include "rust-lex.h"
+#include "rust-parse.h"
+#include "selftest.h"
 
 namespace Rust {
 namespace AST {
@@ -27,23 +37,187 @@ DeriveVisitor::DeriveVisitor (location_t loc)
   : loc (loc), builder (Builder (loc))
 {}
 
+bool
+DeriveVisitor::has_core_crate ()
+{
+  return !Session::get_instance ().injected_crate_name.empty ();
+}
+
+PathInExpression
+DeriveVisitor::core_path (std::vector<std::string> &&segments) const
+{
+  if (!has_core_crate ())
+    {
+      segments.erase (segments.begin ());
+      return builder.path_in_expression (std::move (segments));
+    }
+
+  segments.insert (segments.begin (),
+		   Session::get_instance ().injected_crate_name);
+  return builder.path_in_expression (std::move (segments), true);
+}
+
+std::unique_ptr<Expr>
+DeriveVisitor::core_path_expr (std::vector<std::string> &&segments) const
+{
+  return std::unique_ptr<Expr> (
+    new PathInExpression (core_path (std::move (segments))));
+}
+
+TypePath
+DeriveVisitor::core_type_path (std::vector<std::string> &&segments) const
+{
+  if (!has_core_crate ())
+    {
+      segments.erase (segments.begin ());
+      return builder.type_path (std::move (segments));
+    }
+
+  segments.insert (segments.begin (),
+		   Session::get_instance ().injected_crate_name);
+  return builder.type_path (std::move (segments), true);
+}
+
+std::unique_ptr<ExternalItem>
+DeriveVisitor::intrinsic (
+  std::string name, std::vector<std::string> &&generics,
+  std::vector<std::pair<std::string, std::unique_ptr<Type>>> &&params,
+  std::unique_ptr<Type> &&return_type) const
+{
+  auto generic_params = std::vector<std::unique_ptr<GenericParam>> ();
+  for (auto &generic : generics)
+    generic_params.emplace_back (
+      new TypeParam (Identifier (generic, loc), loc));
+
+  auto function_params = std::vector<NamedFunctionParam> ();
+  for (auto &param : params)
+    function_params.emplace_back (param.first, std::move (param.second),
+				  std::vector<Attribute> (), loc);
+
+  return std::unique_ptr<ExternalItem> (
+    new ExternalFunctionItem ({name, loc}, std::move (generic_params),
+			      std::move (return_type),
+			      WhereClause::create_empty (),
+			      std::move (function_params),
+			      Visibility::create_private (), {}, loc));
+}
+
+std::unique_ptr<Stmt>
+DeriveVisitor::intrinsics_block (
+  std::vector<std::unique_ptr<ExternalItem>> &&intrinsics) const
+{
+  auto block = std::unique_ptr<ExternBlock> (
+    new ExternBlock ("rust-intrinsic", std::move (intrinsics),
+		     Visibility::create_private (), {}, {}, loc));
+
+  Analysis::Mappings::get ().insert_compiler_generated_item (
+    block->get_node_id ());
+
+  return block;
+}
+
+std::unique_ptr<ExternalItem>
+DeriveVisitor::uniform_integer_fields_intrinsic () const
+{
+  auto params = std::vector<std::pair<std::string, std::unique_ptr<Type>>> ();
+  params.emplace_back ("a", builder.ref_type ("T"));
+
+  return intrinsic ("has_uniform_integer_fields", {"T"}, std::move (params),
+		    builder.single_type_path ("bool"));
+}
+
+std::unique_ptr<Expr>
+DeriveVisitor::has_uniform_integer_fields () const
+{
+  auto args = std::vector<std::unique_ptr<Expr>> ();
+  args.emplace_back (builder.identifier ("self"));
+
+  return builder.unsafe_block (
+    builder.call (builder.identifier ("has_uniform_integer_fields"),
+		  std::move (args)));
+}
+
+/* Whether TYPES are spelled several times as the same primitive integer
+   type.  */
+
+static bool
+is_uniform_integer_type_list (const std::vector<std::string> &types)
+{
+  static const std::set<std::string> integer_types
+    = {"i8", "i16", "i32", "i64", "i128", "isize",
+       "u8", "u16", "u32", "u64", "u128", "usize"};
+
+  if (types.size () < 2 || integer_types.count (types[0]) == 0)
+    return false;
+
+  for (auto &type : types)
+    if (type != types[0])
+      return false;
+
+  return true;
+}
+
+bool
+DeriveVisitor::may_have_uniform_integer_fields (StructStruct &item)
+{
+  std::vector<std::string> types;
+  if (!item.is_unit_struct ())
+    for (auto &field : item.get_fields ())
+      types.push_back (field.get_field_type ().as_string ());
+
+  return is_uniform_integer_type_list (types);
+}
+
+bool
+DeriveVisitor::may_have_uniform_integer_fields (TupleStruct &item)
+{
+  std::vector<std::string> types;
+  for (auto &field : item.get_fields ())
+    types.push_back (field.get_field_type ().as_string ());
+
+  return is_uniform_integer_type_list (types);
+}
+
+// the traits are only parsed out of the attribute on first use
+bool
+DeriveVisitor::derives_copy (std::vector<Attribute> &attrs)
+{
+  for (auto &attr : attrs)
+    if (attr.is_derive ())
+      for (auto &path : attr.get_traits_to_derive ())
+	{
+	  auto builtin
+	    = MacroBuiltin::builtins.lookup (path.get ().as_string ());
+	  if (builtin.has_value () && builtin.value () == BuiltinMacro::Copy)
+	    return true;
+	}
+
+  return false;
+}
+
 std::unique_ptr<Item>
 DeriveVisitor::derive (Item &item, const Attribute &attr,
-		       BuiltinMacro to_derive)
+		       BuiltinMacro to_derive, bool derives_copy)
 {
   switch (to_derive)
     {
     case BuiltinMacro::Clone:
-      return DeriveClone (attr.get_locus ()).go (item);
+      return DeriveClone (attr.get_locus (), derives_copy).go (item);
     case BuiltinMacro::Copy:
       return DeriveCopy (attr.get_locus ()).go (item);
-    case BuiltinMacro::Debug:
-    case BuiltinMacro::Default:
-    case BuiltinMacro::Eq:
     case BuiltinMacro::PartialEq:
-    case BuiltinMacro::Ord:
+      return DerivePartialEq (attr.get_locus ()).go (item);
+    case BuiltinMacro::Eq:
+      return DeriveEq (attr.get_locus ()).go (item);
     case BuiltinMacro::PartialOrd:
+      return DeriveOrd (attr.get_locus (), /* is_partial */ true).go (item);
+    case BuiltinMacro::Ord:
+      return DeriveOrd (attr.get_locus (), /* is_partial */ false).go (item);
     case BuiltinMacro::Hash:
+      return DeriveHash (attr.get_locus ()).go (item);
+    case BuiltinMacro::Debug:
+      return DeriveDebug (attr.get_locus ()).go (item);
+    case BuiltinMacro::Default:
     default:
       rust_sorry_at (attr.get_locus (), "unimplemented builtin derive macro");
       return nullptr;
@@ -52,3 +226,133 @@ DeriveVisitor::derive (Item &item, const Attribute &attr,
 
 } // namespace AST
 } // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+/* Expand the builtin derive TRAIT for the item of SOURCE, named by its derive
+   attribute ATTR, and dump the impl it creates.  */
+
+static std::string
+derive (const std::string &source, Rust::BuiltinMacro trait, size_t attr = 0)
+{
+  Rust::Lexer lex (source, nullptr);
+  Rust::Parser<Rust::Lexer> parser (lex);
+
+  auto items = parser.parse_items ();
+  ASSERT_TRUE (parser.get_errors ().empty ());
+  ASSERT_EQ (items.size (), 1);
+
+  auto &item = *items[0];
+  auto &attrs = item.get_outer_attrs ();
+  bool derives_copy = Rust::AST::DeriveVisitor::derives_copy (attrs);
+  auto impl = Rust::AST::DeriveVisitor::derive (item, attrs.at (attr), trait,
+						derives_copy);
+  ASSERT_TRUE (impl != nullptr);
+
+  std::stringstream text;
+  Rust::AST::Dump (text).go (*impl);
+  return text.str ();
+}
+
+static bool
+contains (const std::string &impl, const std::string &text)
+{
+  return impl.find (text) != std::string::npos;
+}
+
+void
+rust_derive_test (void)
+{
+  using Rust::BuiltinMacro;
+
+  // the clone of a `Copy` type is a copy of it, whichever derive attribute
+  // comes first
+  auto clone = derive ("#[derive(Clone)] struct Point { x: u32, y: u32 }",
+		       BuiltinMacro::Clone);
+  ASSERT_TRUE (contains (clone, "self.x"));
+
+  auto copy = derive ("#[derive(Clone, Copy)] struct Point { x: u32 }",
+		      BuiltinMacro::Clone);
+  ASSERT_TRUE (contains (copy, "*self"));
+  ASSERT_FALSE (contains (copy, "self.x"));
+
+  auto copy_first
+    = derive ("#[derive(Copy)]\n#[derive(Clone)]\nstruct Point { x: u32 }",
+	      BuiltinMacro::Clone, 1);
+  ASSERT_TRUE (contains (copy_first, "*self"));
+  ASSERT_FALSE (contains (copy_first, "self.x"));
+
+  // the fields are compared one by one, or all at once by the raw_eq
+  // intrinsic when they turn out to be of the same integer type
+  auto eq = derive ("#[derive(PartialEq)] struct Point { x: u32, y: u32 }",
+		    BuiltinMacro::PartialEq);
+  ASSERT_TRUE (contains (eq, "raw_eq"));
+  ASSERT_TRUE (contains (eq, "has_uniform_integer_fields"));
+  ASSERT_TRUE (contains (eq, "&&"));
+
+  auto mixed_eq = derive ("#[derive(PartialEq)] struct Mixed(u8, bool);",
+			  BuiltinMacro::PartialEq);
+  ASSERT_FALSE (contains (mixed_eq, "raw_eq"));
+
+  // the fields are hashed one by one...
+  auto mixed
+    = derive ("#[derive(Hash)] struct Mixed(u8, bool);", BuiltinMacro::Hash);
+  ASSERT_TRUE (contains (mixed, "Mixed"));
+  ASSERT_TRUE (contains (mixed, "fn hash"));
+  ASSERT_FALSE (contains (mixed, "hash_slice"));
+
+  // ...unless they might all be of the same integer type, which the derived
+  // code checks before hashing them at once
+  auto point = derive ("#[derive(Hash)] struct Point { x: u32, y: u32 }",
+		       BuiltinMacro::Hash);
+  ASSERT_TRUE (contains (point, "has_uniform_integer_fields"));
+  ASSERT_TRUE (contains (point, "hash_slice"));
+  ASSERT_TRUE (contains (point, "transmute"));
+
+  // and items without fields have nothing to hash
+  auto unit = derive ("#[derive(Hash)] struct Unit;", BuiltinMacro::Hash);
+  ASSERT_TRUE (contains (unit, "fn hash"));
+  ASSERT_FALSE (contains (unit, "hash_slice"));
+
+  // the fields are compared in order, the first one which is not equal
+  // giving the result
+  auto ord = derive ("#[derive(Ord)] struct Version(u8, u8);",
+		     BuiltinMacro::Ord);
+  ASSERT_TRUE (contains (ord, "fn cmp"));
+  ASSERT_TRUE (contains (ord, "Equal"));
+  ASSERT_FALSE (contains (ord, "partial_cmp"));
+
+  auto partial_ord
+    = derive ("#[derive(PartialOrd)] struct Version { major: u8, minor: u8 }",
+	      BuiltinMacro::PartialOrd);
+  ASSERT_TRUE (contains (partial_ord, "fn partial_cmp"));
+  ASSERT_TRUE (contains (partial_ord, "Some"));
+
+  // an item without fields is equal to itself
+  auto unit_ord = derive ("#[derive(Ord)] struct Unit;", BuiltinMacro::Ord);
+  ASSERT_TRUE (contains (unit_ord, "Equal"));
+  ASSERT_FALSE (contains (unit_ord, "match"));
+
+  // structs are printed with their field names, tuple structs without them
+  // and the items without fields with their name only
+  auto debug = derive ("#[derive(Debug)] struct Point { x: u32, y: u32 }",
+		       BuiltinMacro::Debug);
+  ASSERT_TRUE (contains (debug, "debug_struct"));
+  ASSERT_TRUE (contains (debug, "\"x\""));
+  ASSERT_TRUE (contains (debug, "finish"));
+
+  auto debug_tuple
+    = derive ("#[derive(Debug)] struct Pair(u8, u8);", BuiltinMacro::Debug);
+  ASSERT_TRUE (contains (debug_tuple, "debug_tuple"));
+
+  auto debug_unit
+    = derive ("#[derive(Debug)] struct Unit;", BuiltinMacro::Debug);
+  ASSERT_TRUE (contains (debug_unit, "write_str"));
+  ASSERT_FALSE (contains (debug_unit, "finish"));
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
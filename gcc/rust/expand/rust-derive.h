@@ -34,8 +34,17 @@ namespace AST {
 class DeriveVisitor : public AST::ASTVisitor
 {
 public:
+  /* Expand the builtin derive TO_DERIVE of ITEM, named by its attribute
+     DERIVE. DERIVES_COPY tells whether any derive attribute of the item
+     derives `Copy`, see derives_copy.  */
   static std::unique_ptr<Item> derive (Item &item, const Attribute &derive,
-				       BuiltinMacro to_derive);
+				       BuiltinMacro to_derive,
+				       bool derives_copy = false);
+
+  /* Does any of the derive attributes among ATTRS derive `Copy`? Expanding a
+     derive attribute removes it from its item, so this has to be asked
+     before the first one is expanded.  */
+  static bool derives_copy (std::vector<Attribute> &attrs);
 
 protected:
   DeriveVisitor (location_t loc);
@@ -43,6 +52,66 @@ protected:
   location_t loc;
   Builder builder;
 
+  /* Whether the crate has a core library to refer to, which `no_core` crates
+     do not have.  */
+  static bool has_core_crate ();
+
+  /**
+   * The path to an item of the core library, e.g. `::core::cmp::Ordering` for
+   * {"cmp", "Ordering"}. `no_core` crates provide these items themselves, and
+   * get the path without its leading module: `Ordering`.
+   */
+  PathInExpression core_path (std::vector<std::string> &&segments) const;
+  TypePath core_type_path (std::vector<std::string> &&segments) const;
+  std::unique_ptr<Expr>
+  core_path_expr (std::vector<std::string> &&segments) const;
+
+  /**
+   * Declare the intrinsic NAME, with the generic parameters GENERICS and the
+   * parameters PARAMS: `fn raw_eq<T> (a: &T, b: &T) -> bool`
+   */
+  std::unique_ptr<ExternalItem>
+  intrinsic (std::string name, std::vector<std::string> &&generics,
+	     std::vector<std::pair<std::string, std::unique_ptr<Type>>> &&params,
+	     std::unique_ptr<Type> &&return_type) const;
+
+  /**
+   * Declare INTRINSICS in an `extern "rust-intrinsic"` block, so that the
+   * derived code does not depend on the core library having them. The block
+   * is recorded as generated by the compiler, which does not require the
+   * `intrinsics` feature from the crate.
+   */
+  std::unique_ptr<Stmt> intrinsics_block (
+    std::vector<std::unique_ptr<ExternalItem>> &&intrinsics) const;
+
+  /**
+   * Whether ITEM might have several fields which are all of the same primitive
+   * integer type. Its values then have no padding, and can be compared or
+   * hashed as a whole rather than field by field.
+   *
+   * Only the spelling of the field types is known during expansion, and a
+   * crate can name its own types `u32`: the derived code still checks that
+   * the fields are integers once the types are resolved, through the
+   * `has_uniform_integer_fields` intrinsic.
+   */
+  static bool may_have_uniform_integer_fields (StructStruct &item);
+  static bool may_have_uniform_integer_fields (TupleStruct &item);
+
+  /**
+   * Declare the intrinsic telling whether the fields of a type are several
+   * times the same primitive integer type, without padding
+   *
+   * fn has_uniform_integer_fields<T>(a: &T) -> bool;
+   */
+  std::unique_ptr<ExternalItem> uniform_integer_fields_intrinsic () const;
+
+  /**
+   * Use it on `self`, once it is declared
+   *
+   * unsafe { has_uniform_integer_fields(self) }
+   */
+  std::unique_ptr<Expr> has_uniform_integer_fields () const;
+
 private:
   // the 4 "allowed" visitors, which a derive-visitor can specify and override
   virtual void visit_struct (StructStruct &struct_item) = 0;
@@ -228,4 +297,13 @@ private:
 } // namespace AST
 } // namespace Rust
 
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_derive_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
 #endif // DERIVE_VISITOR_H
@@ -0,0 +1,147 @@
+// Copyright (C) 2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-desugar-for-loop.h"
+#include "rust-ast-builder.h"
+#include "rust-pattern.h"
+#include "rust-stmt.h"
+
+namespace Rust {
+namespace AST {
+
+static const std::string FOR_IV = "#iv";
+static const std::string FOR_END = "#end";
+static const std::string FOR_DONE = "#done";
+
+static std::unique_ptr<Pattern>
+binding (const std::string &name, bool is_mut, location_t locus)
+{
+  return std::unique_ptr<Pattern> (
+    new IdentifierPattern (name, locus, false, is_mut));
+}
+
+static std::unique_ptr<Stmt>
+expr_stmt (std::unique_ptr<Expr> &&expr, location_t locus)
+{
+  return std::unique_ptr<Stmt> (new ExprStmt (std::move (expr), locus, true));
+}
+
+static std::unique_ptr<BlockExpr>
+block (std::vector<std::unique_ptr<Stmt>> &&stmts, std::unique_ptr<Expr> &&tail,
+       location_t locus)
+{
+  return std::unique_ptr<BlockExpr> (new BlockExpr (std::move (stmts),
+						    std::move (tail), {}, {},
+						    LoopLabel::error (), locus,
+						    locus));
+}
+
+// `#iv += 1`
+static std::unique_ptr<Expr>
+increment (const Builder &b, location_t locus)
+{
+  std::unique_ptr<Expr> one (
+    new LiteralExpr ("1", Literal::LitType::INT,
+		     PrimitiveCoreType::CORETYPE_UNKNOWN, {}, locus));
+  return std::unique_ptr<Expr> (
+    new CompoundAssignmentExpr (b.identifier (FOR_IV), std::move (one),
+				CompoundAssignmentOperator::ADD, locus));
+}
+
+tl::optional<std::unique_ptr<Expr>>
+desugar_range_for_loop (ForLoopExpr &expr)
+{
+  Expr *from = nullptr;
+  Expr *to = nullptr;
+  bool inclusive = false;
+  if (auto range = dynamic_cast<RangeFromToExpr *> (&expr.get_iterator_expr ()))
+    {
+      from = &range->get_from_expr ();
+      to = &range->get_to_expr ();
+    }
+  else if (auto range
+	   = dynamic_cast<RangeFromToInclExpr *> (&expr.get_iterator_expr ()))
+    {
+      from = &range->get_from_expr ();
+      to = &range->get_to_expr ();
+      inclusive = true;
+    }
+  else
+    return tl::nullopt;
+
+  location_t locus = expr.get_locus ();
+  Builder b (locus);
+
+  std::vector<std::unique_ptr<Stmt>> stmts;
+  stmts.push_back (
+    b.let (binding (FOR_IV, true, locus), nullptr, from->clone_expr ()));
+  stmts.push_back (
+    b.let (binding (FOR_END, false, locus), nullptr, to->clone_expr ()));
+
+  std::vector<std::unique_ptr<Stmt>> body;
+  body.push_back (b.let (expr.get_pattern ().clone_pattern (), nullptr,
+			 b.identifier (FOR_IV)));
+
+  std::unique_ptr<Expr> condition;
+  if (!inclusive)
+    {
+      condition = b.comparison (b.identifier (FOR_IV), b.identifier (FOR_END),
+				ComparisonOperator::LESS_THAN);
+      body.push_back (expr_stmt (increment (b, locus), locus));
+    }
+  else
+    {
+      // the range is empty when it starts past its end
+      stmts.push_back (
+	b.let (binding (FOR_DONE, true, locus), nullptr,
+	       b.comparison (b.identifier (FOR_IV), b.identifier (FOR_END),
+			     ComparisonOperator::GREATER_THAN)));
+      condition = std::unique_ptr<Expr> (
+	new NegationExpr (b.identifier (FOR_DONE), NegationOperator::NOT, {},
+			  locus));
+
+      // if #iv == #end { #done = true; } else { #iv += 1; }
+      std::vector<std::unique_ptr<Stmt>> last;
+      last.push_back (expr_stmt (std::unique_ptr<Expr> (
+				   new AssignmentExpr (b.identifier (FOR_DONE),
+						       b.literal_bool (true),
+						       {}, locus)),
+				 locus));
+      std::vector<std::unique_ptr<Stmt>> next;
+      next.push_back (expr_stmt (increment (b, locus), locus));
+      body.push_back (expr_stmt (
+	std::unique_ptr<Expr> (new IfExprConseqElse (
+	  b.comparison (b.identifier (FOR_IV), b.identifier (FOR_END),
+			ComparisonOperator::EQUAL),
+	  block (std::move (last), nullptr, locus),
+	  block (std::move (next), nullptr, locus), {}, locus)),
+	locus));
+    }
+
+  auto loop_body
+    = block (std::move (body), expr.get_loop_block ().clone_block_expr (),
+	     locus);
+  std::unique_ptr<Expr> loop (
+    new WhileLoopExpr (std::move (condition), std::move (loop_body), locus,
+		       expr.get_loop_label (), expr.get_outer_attrs ()));
+
+  return b.block (std::move (stmts), std::move (loop));
+}
+
+} // namespace AST
+} // namespace Rust
@@ -0,0 +1,59 @@
+// Copyright (C) 2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_DESUGAR_FOR_LOOP_H
+#define RUST_DESUGAR_FOR_LOOP_H
+
+#include "optional.h"
+#include "rust-ast.h"
+#include "rust-expr.h"
+
+namespace Rust {
+namespace AST {
+
+/**
+ * Lower a `for` loop over a range of integers to a counted loop.
+ *
+ * `for PAT in a..b BODY` becomes
+ *
+ *   {
+ *     let mut #iv = a;
+ *     let #end = b;
+ *     while #iv < #end {
+ *       let PAT = #iv;
+ *       #iv += 1;
+ *       BODY
+ *     }
+ *   }
+ *
+ * and `a..=b` stops after the iteration on `b`, with a flag rather than a
+ * comparison against `b + 1`, which could overflow. The counter is advanced
+ * before the body so that `continue` needs no special handling, and has a
+ * name that no Rust code can refer to.
+ *
+ * The loop does not go through the `Iterator` implementation of the ranges
+ * and matching the `Option` it returns: the induction variable is plain, so
+ * that the IV optimizations and the vectorizer of GCC handle the loop at any
+ * optimization level. Other loops are left untouched.
+ */
+tl::optional<std::unique_ptr<Expr>> desugar_range_for_loop (ForLoopExpr &expr);
+
+} // namespace AST
+} // namespace Rust
+
+#endif // RUST_DESUGAR_FOR_LOOP_H
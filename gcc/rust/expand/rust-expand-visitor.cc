@@ -23,6 +23,7 @@
 #include "rust-ast.h"
 #include "rust-type.h"
 #include "rust-derive.h"
+#include "rust-desugar-for-loop.h"
 
 namespace Rust {
 
@@ -45,31 +46,50 @@ ExpandVisitor::go (AST::Crate &crate)
 
 static std::unique_ptr<AST::Item>
 builtin_derive_item (AST::Item &item, const AST::Attribute &derive,
-		     BuiltinMacro to_derive)
+		     BuiltinMacro to_derive, bool derives_copy)
 {
-  return AST::DeriveVisitor::derive (item, derive, to_derive);
+  return AST::DeriveVisitor::derive (item, derive, to_derive, derives_copy);
 }
 
-static std::vector<std::unique_ptr<AST::Item>>
-derive_item (AST::Item &item, AST::SimplePath &to_derive,
-	     MacroExpander &expander)
+/* Run the custom derives among TRAITS over ITEM. The result holds the items
+   generated by each of TRAITS, which is nothing for the builtin derives.  */
+
+static std::vector<std::vector<std::unique_ptr<AST::Item>>>
+derive_items (AST::Item &item,
+	      std::vector<std::reference_wrapper<AST::SimplePath>> &traits,
+	      MacroExpander &expander)
 {
-  std::vector<std::unique_ptr<AST::Item>> result;
-  auto frag = expander.expand_derive_proc_macro (item, to_derive);
-  if (!frag.is_error ())
+  std::vector<std::reference_wrapper<AST::SimplePath>> custom;
+  for (auto &to_derive : traits)
+    if (!MacroBuiltin::builtins.lookup (to_derive.get ().as_string ()))
+      custom.push_back (to_derive);
+
+  auto fragments = expander.expand_derive_proc_macros (item, custom);
+
+  std::vector<std::vector<std::unique_ptr<AST::Item>>> result (traits.size ());
+  size_t next = 0;
+  for (size_t i = 0; i < traits.size (); i++)
     {
+      if (MacroBuiltin::builtins.lookup (traits[i].get ().as_string ()))
+	continue;
+
+      auto &frag = fragments[next++];
+      if (frag.is_error ())
+	continue;
+
       for (auto &node : frag.get_nodes ())
 	{
 	  switch (node.get_kind ())
 	    {
 	    case AST::SingleASTNode::ITEM:
-	      result.push_back (node.take_item ());
+	      result[i].push_back (node.take_item ());
 	      break;
 	    default:
 	      rust_unreachable ();
 	    }
 	}
     }
+
   return result;
 }
 
@@ -135,13 +155,13 @@ expand_tail_expr (AST::BlockExpr &block_expr, MacroExpander &expander)
       bool changed = false;
       for (auto it = attrs.begin (); it != attrs.end ();)
 	{
-	  auto current = *it;
-	  if (is_builtin (current))
+	  if (is_builtin (*it))
 	    {
 	      it++;
 	    }
 	  else
 	    {
+	      auto current = std::move (*it);
 	      it = attrs.erase (it);
 	      changed = true;
 	      auto new_stmts
@@ -171,35 +191,38 @@ ExpandVisitor::expand_inner_items (
       if (item->has_outer_attrs ())
 	{
 	  auto &attrs = item->get_outer_attrs ();
+	  bool derives_copy = AST::DeriveVisitor::derives_copy (attrs);
 
 	  for (auto attr_it = attrs.begin (); attr_it != attrs.end ();
 	       /* erase => No increment*/)
 	    {
-	      auto current = *attr_it;
-
-	      if (current.is_derive ())
+	      if (attr_it->is_derive ())
 		{
+		  auto current = std::move (*attr_it);
 		  current.parse_attr_to_meta_item ();
 		  attr_it = attrs.erase (attr_it);
 		  // Get traits to derive in the current attribute
 		  auto traits_to_derive = current.get_traits_to_derive ();
-		  for (auto &to_derive : traits_to_derive)
+		  auto derived
+		    = derive_items (*item, traits_to_derive, expander);
+		  for (size_t i = 0; i < traits_to_derive.size (); i++)
 		    {
 		      auto maybe_builtin = MacroBuiltin::builtins.lookup (
-			to_derive.get ().as_string ());
+			traits_to_derive[i].get ().as_string ());
 		      if (maybe_builtin.has_value ())
 			{
 			  auto new_item
 			    = builtin_derive_item (*item, current,
-						   maybe_builtin.value ());
+						   maybe_builtin.value (),
+						   derives_copy);
 			  // this inserts the derive *before* the item - is it a
 			  // problem?
-			  it = items.insert (it, std::move (new_item));
+			  if (new_item)
+			    it = items.insert (it, std::move (new_item));
 			}
 		      else
 			{
-			  auto new_items
-			    = derive_item (*item, to_derive, expander);
+			  auto &new_items = derived[i];
 			  std::move (new_items.begin (), new_items.end (),
 				     std::inserter (items, it));
 			}
@@ -207,12 +230,13 @@ ExpandVisitor::expand_inner_items (
 		}
 	      else /* Attribute */
 		{
-		  if (is_builtin (current))
+		  if (is_builtin (*attr_it))
 		    {
 		      attr_it++;
 		    }
 		  else
 		    {
+		      auto current = std::move (*attr_it);
 		      attr_it = attrs.erase (attr_it);
 		      auto new_items
 			= expand_item_attribute (*item, current.get_path (),
@@ -258,34 +282,36 @@ ExpandVisitor::expand_inner_stmts (AST::BlockExpr &expr)
       if (item.has_outer_attrs ())
 	{
 	  auto &attrs = item.get_outer_attrs ();
+	  bool derives_copy = AST::DeriveVisitor::derives_copy (attrs);
 
 	  for (auto attr_it = attrs.begin (); attr_it != attrs.end ();
 	       /* erase => No increment*/)
 	    {
-	      auto current = *attr_it;
-
-	      if (current.is_derive ())
+	      if (attr_it->is_derive ())
 		{
+		  auto current = std::move (*attr_it);
 		  attr_it = attrs.erase (attr_it);
 		  // Get traits to derive in the current attribute
 		  auto traits_to_derive = current.get_traits_to_derive ();
-		  for (auto &to_derive : traits_to_derive)
+		  auto derived = derive_items (item, traits_to_derive, expander);
+		  for (size_t i = 0; i < traits_to_derive.size (); i++)
 		    {
 		      auto maybe_builtin = MacroBuiltin::builtins.lookup (
-			to_derive.get ().as_string ());
+			traits_to_derive[i].get ().as_string ());
 		      if (maybe_builtin.has_value ())
 			{
 			  auto new_item
 			    = builtin_derive_item (item, current,
-						   maybe_builtin.value ());
+						   maybe_builtin.value (),
+						   derives_copy);
 			  // this inserts the derive *before* the item - is it a
 			  // problem?
-			  it = stmts.insert (it, std::move (new_item));
+			  if (new_item)
+			    it = stmts.insert (it, std::move (new_item));
 			}
 		      else
 			{
-			  auto new_items
-			    = derive_item (item, to_derive, expander);
+			  auto &new_items = derived[i];
 			  std::move (new_items.begin (), new_items.end (),
 				     std::inserter (stmts, it));
 			}
@@ -293,12 +319,13 @@ ExpandVisitor::expand_inner_stmts (AST::BlockExpr &expr)
 		}
 	      else /* Attribute */
 		{
-		  if (is_builtin (current))
+		  if (is_builtin (*attr_it))
 		    {
 		      attr_it++;
 		    }
 		  else
 		    {
+		      auto current = std::move (*attr_it);
 		      attr_it = attrs.erase (attr_it);
 		      auto new_items
 			= expand_stmt_attribute (item, current.get_path (),
@@ -339,6 +366,12 @@ ExpandVisitor::maybe_expand_expr (std::unique_ptr<AST::Expr> &expr)
   if (final_fragment.should_expand ()
       && final_fragment.is_expression_fragment ())
     expr = final_fragment.take_expression_fragment ();
+
+  // loops over integer ranges become counted loops, now that their body is
+  // expanded
+  if (auto loop = dynamic_cast<AST::ForLoopExpr *> (expr.get ()))
+    if (auto desugared = AST::desugar_range_for_loop (*loop))
+      expr = std::move (*desugared);
 }
 
 void
@@ -1035,10 +1068,9 @@ ExpandVisitor::visit_inner_using_attrs (T &item,
 {
   for (auto it = attrs.begin (); it != attrs.end (); /* erase => No increment*/)
     {
-      auto current = *it;
-
-      if (!is_builtin (current) && !current.is_derive ())
+      if (!is_builtin (*it) && !it->is_derive ())
 	{
+	  auto current = std::move (*it);
 	  it = attrs.erase (it);
 	  expand_inner_attribute (item, current.get_path ());
 	}
@@ -134,18 +134,14 @@ parse_reg (InlineAsmContext &inline_asm_ctx)
   auto &parser = inline_asm_ctx.parser;
 
   if (!parser.skip_token (LEFT_PAREN))
-    {
-      // TODO: we expect a left parenthesis here, please return the correct
-      // error.
-      rust_unreachable ();
-      return tl::nullopt;
-    }
+    return tl::nullopt;
 
   // after successful left parenthesis parsing, we should return ast of
   // InlineAsmRegOrRegClass of reg or reg class
   auto token = parser.peek_current_token ();
   auto tok_id = token->get_id ();
   AST::InlineAsmRegOrRegClass reg_class;
+  reg_class.locus = token->get_locus ();
   if (parser.skip_token (IDENTIFIER))
     {
       // construct a InlineAsmRegOrRegClass
@@ -156,32 +152,54 @@ parse_reg (InlineAsmContext &inline_asm_ctx)
     {
       // TODO: there is STRING_LITERAL, and BYTE_STRING_LITERAL, should we check
       // for both?
+      parser.skip_token ();
 
       // construct a InlineAsmRegOrRegClass
-      // parse_format_string
       reg_class.type = RegType::Reg;
       inline_asm_ctx.is_explicit = true;
-      reg_class.reg_class.Symbol = token->as_string ();
+      reg_class.reg.Symbol = token->as_string ();
     }
   else
     {
-      // TODO: This should emit error
-      //  return
-      //  Err(p.dcx().create_err(errors::ExpectedRegisterClassOrExplicitRegister
-      //  {
-      //           span: p.token.span,
-      //       }));
-      rust_unreachable ();
+      rust_error_at (token->get_locus (),
+		     "expected register class or explicit register");
+      return tl::nullopt;
     }
   if (!parser.skip_token (RIGHT_PAREN))
+    return tl::nullopt;
+
+  return reg_class;
+}
+
+// Parse the expression of an operand, which cannot be `_' unless
+// ALLOW_UNDERSCORE is set. Returns false after reporting an error, leaving
+// EXPR unset when `_' is found.
+static bool
+parse_operand_expr (InlineAsmContext &inline_asm_ctx,
+		    std::unique_ptr<AST::Expr> &expr, bool allow_underscore)
+{
+  auto &parser = inline_asm_ctx.parser;
+  auto token = parser.peek_current_token ();
+
+  if (parser.maybe_skip_token (UNDERSCORE))
     {
-      // TODO: we expect a left parenthesis here, please return the correct
-      // error.
-      rust_unreachable ();
-      return tl::nullopt;
+      if (allow_underscore)
+	return true;
+
+      rust_error_at (token->get_locus (),
+		     "_ cannot be used for input operands");
+      return false;
     }
 
-  return reg_class;
+  expr = parser.parse_expr ();
+  if (expr == nullptr)
+    {
+      rust_error_at (token->get_locus (), "expected expression, found %qs",
+		     token->get_token_description ());
+      return false;
+    }
+
+  return true;
 }
 
 // From rustc
@@ -200,184 +218,131 @@ parse_reg_operand (InlineAsmContext inline_asm_ctx)
   auto &parser = inline_asm_ctx.parser;
   AST::InlineAsmOperand reg_operand;
   auto token = parser.peek_current_token ();
-  auto iden_token = parser.peek_current_token ();
   auto &inline_asm = inline_asm_ctx.inline_asm;
+  reg_operand.locus = token->get_locus ();
+
+  tl::optional<std::string> name = tl::nullopt;
   if (check_identifier (parser, ""))
     {
-      auto equal_token = parser.peek_current_token ();
       if (!parser.skip_token (EQUAL))
+	return tl::unexpected<std::string> ("expected `=` after operand name");
+
+      name = token->as_string ();
+      if (inline_asm_ctx.named_args.count (name.value ()))
 	{
-	  // TODO: Please handle this.
-	  rust_unreachable ();
+	  rust_error_at (token->get_locus (), "duplicate argument named %qs",
+			 name->c_str ());
+	  return tl::unexpected<std::string> ("duplicate argument");
 	}
+      inline_asm_ctx.set_allow_templates (false);
     }
 
   bool is_global_asm = inline_asm.is_global_asm;
+  auto keyword = parser.peek_current_token ();
 
   // For the keyword IN, currently we count it as a seperate keyword called
   // Rust::IN search for #define RS_TOKEN_LIST in code base.
-  if (!is_global_asm && parser.skip_token (IN))
+  if (!is_global_asm && parser.maybe_skip_token (IN))
     {
       auto reg = parse_reg (inline_asm_ctx);
+      if (!reg)
+	return tl::unexpected<std::string> ("invalid register");
 
-      if (parser.skip_token (UNDERSCORE))
-	{
-	  // We are sure to be failing a test here, based on asm.rs
-	  // https://github.com/rust-lang/rust/blob/a330e49593ee890f9197727a3a558b6e6b37f843/compiler/rustc_builtin_macros/src/asm.rs#L112
-	  rust_unreachable ();
-	}
-
-      auto expr = parse_format_string (inline_asm_ctx);
+      std::unique_ptr<AST::Expr> expr;
+      if (!parse_operand_expr (inline_asm_ctx, expr, false))
+	return tl::unexpected<std::string> ("invalid input operand");
 
-      // TODO: When we've succesfully parse an expr, remember to clone_expr()
-      // instead of nullptr
-      struct AST::InlineAsmOperand::In in (reg, nullptr);
+      struct AST::InlineAsmOperand::In in (reg, std::move (expr));
       reg_operand.set_in (in);
-      inline_asm_ctx.inline_asm.operands.push_back (reg_operand);
-      return inline_asm_ctx;
     }
-  else if (!is_global_asm && check_identifier (parser, "out"))
+  else if (!is_global_asm
+	   && (check_identifier (parser, "out")
+	       || check_identifier (parser, "lateout")))
     {
+      bool late = keyword->as_string () == "lateout";
+
       auto reg = parse_reg (inline_asm_ctx);
+      if (!reg)
+	return tl::unexpected<std::string> ("invalid register");
 
-      auto expr = parse_format_string (inline_asm_ctx);
+      // an output to `_' only clobbers its register
+      std::unique_ptr<AST::Expr> expr;
+      if (!parse_operand_expr (inline_asm_ctx, expr, true))
+	return tl::unexpected<std::string> ("invalid output operand");
 
-      // TODO: When we've succesfully parse an expr, remember to clone_expr()
-      // instead of nullptr
-      struct AST::InlineAsmOperand::Out out (reg, false, nullptr);
+      struct AST::InlineAsmOperand::Out out (reg, late, std::move (expr));
       reg_operand.set_out (out);
-      inline_asm_ctx.inline_asm.operands.push_back (reg_operand);
-
-      return inline_asm_ctx;
     }
-  else if (!is_global_asm && check_identifier (parser, "lateout"))
+  else if (!is_global_asm
+	   && (check_identifier (parser, "inout")
+	       || check_identifier (parser, "inlateout")))
     {
-      rust_unreachable ();
-      return inline_asm_ctx;
-    }
-  else if (!is_global_asm && check_identifier (parser, "inout"))
-    {
-      auto reg = parse_reg (inline_asm_ctx);
+      // For reviewers, the parsing of inout and inlateout is exactly the same,
+      // Except here, the late flag is set to true.
+      bool late = keyword->as_string () == "inlateout";
 
-      if (parser.skip_token (UNDERSCORE))
-	{
-	  // We are sure to be failing a test here, based on asm.rs
-	  // https://github.com/rust-lang/rust/blob/a330e49593ee890f9197727a3a558b6e6b37f843/compiler/rustc_builtin_macros/src/asm.rs#L112
-	  rust_unreachable ();
-	}
-
-      // TODO: Is error propogation our top priority, the ? in rust's asm.rs is
-      // doing a lot of work.
-      // TODO: Not sure how to use parse_expr
-      auto expr = parse_format_string (inline_asm_ctx);
+      auto reg = parse_reg (inline_asm_ctx);
+      if (!reg)
+	return tl::unexpected<std::string> ("invalid register");
 
-      std::unique_ptr<AST::Expr> out_expr;
+      std::unique_ptr<AST::Expr> expr;
+      if (!parse_operand_expr (inline_asm_ctx, expr, false))
+	return tl::unexpected<std::string> ("invalid input operand");
 
-      if (parser.skip_token (MATCH_ARROW))
+      if (parser.maybe_skip_token (MATCH_ARROW))
 	{
-	  if (!parser.skip_token (UNDERSCORE))
-	    {
-	      parse_format_string (inline_asm_ctx);
-	      // out_expr = parser.parse_expr();
-	    }
-
-	  // TODO: Rembmer to pass in clone_expr() instead of nullptr
 	  // https://github.com/rust-lang/rust/blob/a3167859f2fd8ff2241295469876a2b687280bdc/compiler/rustc_builtin_macros/src/asm.rs#L135
 	  // RUST VERSION: ast::InlineAsmOperand::SplitInOut { reg, in_expr:
-	  // expr, out_expr, late: false }
-	  struct AST::InlineAsmOperand::SplitInOut split_in_out (reg, false,
-								 nullptr,
-								 nullptr);
-	  reg_operand.set_split_in_out (split_in_out);
-	  inline_asm_ctx.inline_asm.operands.push_back (reg_operand);
+	  // expr, out_expr, late }
+	  std::unique_ptr<AST::Expr> out_expr;
+	  if (!parse_operand_expr (inline_asm_ctx, out_expr, true))
+	    return tl::unexpected<std::string> ("invalid output operand");
 
-	  return inline_asm_ctx;
+	  struct AST::InlineAsmOperand::SplitInOut split_in_out (
+	    reg, late, std::move (expr), std::move (out_expr));
+	  reg_operand.set_split_in_out (split_in_out);
 	}
       else
 	{
 	  // https://github.com/rust-lang/rust/blob/a3167859f2fd8ff2241295469876a2b687280bdc/compiler/rustc_builtin_macros/src/asm.rs#L137
-	  // RUST VERSION: ast::InlineAsmOperand::InOut { reg, expr, late: false
-	  // }
-	  struct AST::InlineAsmOperand::InOut inout (reg, false, nullptr);
+	  // RUST VERSION: ast::InlineAsmOperand::InOut { reg, expr, late }
+	  struct AST::InlineAsmOperand::InOut inout (reg, late, std::move (expr));
 	  reg_operand.set_in_out (inout);
-	  inline_asm_ctx.inline_asm.operands.push_back (reg_operand);
-	  return inline_asm_ctx;
 	}
     }
-  else if (!is_global_asm && check_identifier (parser, "inlateout"))
-    // For reviewers, the parsing of inout and inlateout is exactly the same,
-    // Except here, the late flag is set to true.
+  else if (parser.maybe_skip_token (CONST))
     {
-      auto reg = parse_reg (inline_asm_ctx);
-
-      if (parser.skip_token (UNDERSCORE))
-	{
-	  // We are sure to be failing a test here, based on asm.rs
-	  // https://github.com/rust-lang/rust/blob/a330e49593ee890f9197727a3a558b6e6b37f843/compiler/rustc_builtin_macros/src/asm.rs#L112
-	  rust_unreachable ();
-	}
-
-      // TODO: Is error propogation our top priority, the ? in rust's asm.rs is
-      // doing a lot of work.
-      // TODO: Not sure how to use parse_expr
-      auto expr = parse_format_string (inline_asm_ctx);
-
-      std::unique_ptr<AST::Expr> out_expr;
+      struct AST::InlineAsmOperand::Const cnst;
+      if (!parse_operand_expr (inline_asm_ctx, cnst.anon_const.expr, false))
+	return tl::unexpected<std::string> ("invalid const operand");
+      cnst.anon_const.id = cnst.anon_const.expr->get_node_id ();
 
-      if (parser.skip_token (MATCH_ARROW))
-	{
-	  if (!parser.skip_token (UNDERSCORE))
-	    {
-	      parse_format_string (inline_asm_ctx);
-	      // out_expr = parser.parse_expr();
-	    }
-
-	  // TODO: Rembmer to pass in clone_expr() instead of nullptr
-	  // https://github.com/rust-lang/rust/blob/a3167859f2fd8ff2241295469876a2b687280bdc/compiler/rustc_builtin_macros/src/asm.rs#L149
-	  // RUST VERSION: ast::InlineAsmOperand::SplitInOut { reg, in_expr:
-	  // expr, out_expr, late: true }
-	  struct AST::InlineAsmOperand::SplitInOut split_in_out (reg, true,
-								 nullptr,
-								 nullptr);
-	  reg_operand.set_split_in_out (split_in_out);
-	  inline_asm_ctx.inline_asm.operands.push_back (reg_operand);
-	  return inline_asm_ctx;
-	}
-      else
-	{
-	  // https://github.com/rust-lang/rust/blob/a3167859f2fd8ff2241295469876a2b687280bdc/compiler/rustc_builtin_macros/src/asm.rs#L151
-	  // RUST VERSION: ast::InlineAsmOperand::InOut { reg, expr, late: true
-	  // }
-	  struct AST::InlineAsmOperand::InOut inout (reg, true, nullptr);
-	  reg_operand.set_in_out (inout);
-	  inline_asm_ctx.inline_asm.operands.push_back (reg_operand);
-	  return inline_asm_ctx;
-	}
-    }
-  else if (parser.peek_current_token ()->get_id () == CONST)
-    {
-      // TODO: Please handle const with parse_expr instead.
-      auto anon_const = parse_format_string (inline_asm_ctx);
-      reg_operand.set_cnst (tl::nullopt);
-      rust_unreachable ();
-      return inline_asm_ctx;
+      reg_operand.set_cnst (cnst);
     }
   else if (check_identifier (parser, "sym"))
     {
-      // TODO: Please handle sym, which needs ExprKind::Path in Rust's asm.rs
-      rust_unreachable ();
-      return inline_asm_ctx;
+      // the path is checked to name a function or a static once resolved
+      struct AST::InlineAsmOperand::Sym sym;
+      if (!parse_operand_expr (inline_asm_ctx, sym.expr, false))
+	return tl::unexpected<std::string> ("invalid sym operand");
+
+      reg_operand.set_sym (sym);
     }
   else
     {
-      // TODO: It is  weird that we can't seem to match any identifier,
-      // something must be wrong. consult compiler code in asm.rs or rust online
-      // compiler.
-      rust_unreachable ();
-      return inline_asm_ctx;
+      rust_error_at (token->get_locus (),
+		     "expected operand, clobber_abi, options, or additional "
+		     "template string");
+      return tl::unexpected<std::string> ("expected operand");
     }
+
+  if (name)
+    inline_asm_ctx.named_args[name.value ()] = inline_asm.operands.size ();
+  inline_asm.operands.push_back (reg_operand);
+
   return inline_asm_ctx;
 }
+
 void
 check_and_set (InlineAsmContext &inline_asm_ctx, AST::InlineAsmOption option)
 {
@@ -578,11 +543,8 @@ parse_asm_arg (InlineAsmContext inline_asm_ctx)
 
       // And if that token comma is also the trailing comma, we break
       token = parser.peek_current_token ();
-      if (token->get_id () == COMMA && token->get_id () == last_token_id)
-	{
-	  parser.skip_token ();
-	  break;
-	}
+      if (token->get_id () == last_token_id)
+	break;
 
       // Ok after the left paren is good, we better be parsing correctly
       // everything in here, which is operand in ABNF
@@ -605,6 +567,13 @@ parse_asm_arg (InlineAsmContext inline_asm_ctx)
       // only other logical choice is reg_operand
       // std::cout << "reg_operand" << std::endl;
       auto operand = parse_reg_operand (inline_asm_ctx);
+      if (!operand)
+	return operand;
+
+      inline_asm_ctx.named_args = operand->named_args;
+      inline_asm_ctx.allow_templates = operand->allow_templates;
+      inline_asm_ctx.is_explicit = operand->is_explicit;
+      token = parser.peek_current_token ();
     }
   return tl::expected<InlineAsmContext, std::string> (inline_asm_ctx);
 }
@@ -639,10 +608,10 @@ parse_asm (location_t invoc_locus, AST::MacroInvocData &invoc,
 
   // operands stream, also handles the optional ","
   tl::expected<InlineAsmContext, std::string> resulting_context
-    = tl::expected<InlineAsmContext, std::string> (inline_asm_ctx);
-  resulting_context.and_then (parse_format_strings)
-    .and_then (parse_asm_arg)
-    .and_then (validate);
+    = tl::expected<InlineAsmContext, std::string> (inline_asm_ctx)
+	.and_then (parse_format_strings)
+	.and_then (parse_asm_arg)
+	.and_then (validate);
 
   // TODO: I'm putting the validation here because the rust reference put it
   // here Per Arthur's advice we would actually do the validation in a different
@@ -680,8 +649,10 @@ tl::expected<InlineAsmContext, std::string>
 parse_format_strings (InlineAsmContext inline_asm_ctx)
 {
   // Parse the first ever formatted string, success or not, will skip 1 token
-  auto parser = inline_asm_ctx.parser;
+  auto &parser = inline_asm_ctx.parser;
   auto last_token_id = inline_asm_ctx.last_token_id;
+  auto &template_strs = inline_asm_ctx.inline_asm.template_strs;
+  auto locus = parser.peek_current_token ()->get_locus ();
   auto fm_string = parse_format_string (inline_asm_ctx);
 
   if (fm_string == tl::nullopt)
@@ -690,6 +661,7 @@ parse_format_strings (InlineAsmContext inline_asm_ctx)
 		     "%s template must be a string literal", "asm");
       return tl::unexpected<std::string> ("ERROR");
     }
+  template_strs.push_back ({fm_string.value (), "", locus});
 
   // formatted string stream
 
@@ -703,12 +675,14 @@ parse_format_strings (InlineAsmContext inline_asm_ctx)
       // in here, which is formatted string in ABNF
       inline_asm_ctx.consumed_comma_without_formatted_string = false;
 
+      locus = parser.peek_current_token ()->get_locus ();
       fm_string = parse_format_string (inline_asm_ctx);
       if (fm_string == tl::nullopt)
 	{
 	  inline_asm_ctx.consumed_comma_without_formatted_string = true;
 	  break;
 	}
+      template_strs.push_back ({fm_string.value (), "", locus});
     }
 
   return tl::expected<InlineAsmContext, std::string> (inline_asm_ctx);
@@ -731,9 +705,193 @@ parse_format_strings (InlineAsmContext inline_asm_ctx)
 //   return true;
 // }
 
+// Split the templates of the asm into literal pieces and placeholders, each
+// placeholder referring to the operand at its index. The templates are joined
+// by newlines, as if they were a single one.
+static bool
+expand_templates (InlineAsmContext &inline_asm_ctx)
+{
+  auto &inline_asm = inline_asm_ctx.inline_asm;
+  auto &pieces = inline_asm.template_;
+  bool raw = inline_asm.options.count (AST::InlineAsmOption::RAW) != 0;
+  size_t next_positional = 0;
+
+  std::string literal;
+  auto flush_literal = [&] () {
+    if (!literal.empty ())
+      pieces.push_back ({false, literal, {}});
+    literal.clear ();
+  };
+
+  for (size_t i = 0; i < inline_asm.template_strs.size (); i++)
+    {
+      const std::string &str = inline_asm.template_strs[i].symbol;
+      location_t locus = inline_asm.template_strs[i].loc;
+      if (i != 0)
+	literal += '\n';
+
+      if (raw)
+	{
+	  literal += str;
+	  continue;
+	}
+
+      for (size_t pos = 0; pos < str.size (); pos++)
+	{
+	  char c = str[pos];
+	  if ((c == '{' || c == '}') && pos + 1 < str.size ()
+	      && str[pos + 1] == c)
+	    {
+	      literal += c;
+	      pos++;
+	      continue;
+	    }
+	  if (c == '}')
+	    {
+	      rust_error_at (locus, "invalid asm template string: unmatched "
+				    "%<}%> found");
+	      return false;
+	    }
+	  if (c != '{')
+	    {
+	      literal += c;
+	      continue;
+	    }
+
+	  size_t end = str.find ('}', pos);
+	  if (end == std::string::npos)
+	    {
+	      rust_error_at (locus, "invalid asm template string: expected "
+				    "%<}%>, found end of string");
+	      return false;
+	    }
+	  std::string spec = str.substr (pos + 1, end - pos - 1);
+	  pos = end;
+
+	  char modifier = '\0';
+	  size_t colon = spec.find (':');
+	  if (colon != std::string::npos)
+	    {
+	      std::string modifiers = spec.substr (colon + 1);
+	      spec.resize (colon);
+	      if (modifiers.size () != 1)
+		{
+		  rust_error_at (locus, "invalid asm template modifier %qs",
+				 modifiers.c_str ());
+		  return false;
+		}
+	      modifier = modifiers[0];
+	    }
+
+	  size_t operand_idx;
+	  if (spec.empty ())
+	    operand_idx = next_positional++;
+	  else if (std::all_of (spec.begin (), spec.end (),
+				[] (char c) { return ISDIGIT (c); }))
+	    operand_idx = std::stoul (spec);
+	  else
+	    {
+	      auto named = inline_asm_ctx.named_args.find (spec);
+	      if (named == inline_asm_ctx.named_args.end ())
+		{
+		  rust_error_at (locus, "there is no argument named %qs",
+				 spec.c_str ());
+		  return false;
+		}
+	      operand_idx = named->second;
+	    }
+
+	  if (operand_idx >= inline_asm.operands.size ())
+	    {
+	      rust_error_at (locus, "invalid reference to argument at index %lu",
+			     (unsigned long) operand_idx);
+	      return false;
+	    }
+
+	  flush_literal ();
+	  pieces.push_back ({true, "", {operand_idx, modifier, locus}});
+	}
+    }
+  flush_literal ();
+
+  return true;
+}
+
+// Whether any operand of INLINE_ASM writes to a place
+static bool
+has_outputs (const AST::InlineAsm &inline_asm)
+{
+  using RegisterType = AST::InlineAsmOperand::RegisterType;
+
+  for (auto &operand : inline_asm.operands)
+    switch (operand.register_type)
+      {
+      case RegisterType::Out:
+	if (operand.out.expr != nullptr)
+	  return true;
+	break;
+      case RegisterType::InOut:
+	return true;
+      case RegisterType::SplitInOut:
+	if (operand.split_in_out.out_expr != nullptr)
+	  return true;
+	break;
+      default:
+	break;
+      }
+
+  return false;
+}
+
 tl::expected<InlineAsmContext, std::string>
 validate (InlineAsmContext inline_asm_ctx)
 {
+  using Option = AST::InlineAsmOption;
+
+  auto &inline_asm = inline_asm_ctx.inline_asm;
+  auto locus = inline_asm.get_locus ();
+  auto has = [&] (Option option) {
+    return inline_asm.options.count (option) != 0;
+  };
+
+  // these follow the checks of rustc's asm.rs
+  bool valid = true;
+  if (has (Option::NOMEM) && has (Option::READONLY))
+    {
+      rust_error_at (locus, "the %<nomem%> and %<readonly%> options are "
+			    "mutually exclusive");
+      valid = false;
+    }
+  if (has (Option::PURE) && has (Option::NORETURN))
+    {
+      rust_error_at (locus, "the %<pure%> and %<noreturn%> options are "
+			    "mutually exclusive");
+      valid = false;
+    }
+  if (has (Option::PURE) && !has (Option::NOMEM) && !has (Option::READONLY))
+    {
+      rust_error_at (locus, "the %<pure%> option must be combined with "
+			    "either %<nomem%> or %<readonly%>");
+      valid = false;
+    }
+
+  bool outputs = has_outputs (inline_asm);
+  if (has (Option::PURE) && !outputs)
+    {
+      rust_error_at (locus, "asm with the %<pure%> option must have at "
+			    "least one output");
+      valid = false;
+    }
+  if (has (Option::NORETURN) && outputs)
+    {
+      rust_error_at (locus, "asm outputs are not allowed with the "
+			    "%<noreturn%> option");
+      valid = false;
+    }
+
+  if (!valid || !expand_templates (inline_asm_ctx))
+    return tl::unexpected<std::string> ("invalid asm");
+
   return tl::expected<InlineAsmContext, std::string> (inline_asm_ctx);
 }
 } // namespace Rust
@@ -24,6 +24,8 @@ public:
   AST::InlineAsm &inline_asm;
   Parser<MacroInvocLexer> &parser;
   int last_token_id;
+  // index of the named operands, which the templates can refer to
+  std::map<std::string, int> named_args;
   InlineAsmContext (AST::InlineAsm &inline_asm, Parser<MacroInvocLexer> &parser,
 		    int last_token_id)
     : allow_templates (true), is_explicit (false),
@@ -17,6 +17,7 @@
 // <http://www.gnu.org/licenses/>.
 
 #include "rust-macro-builtins-helpers.h"
+#include "rust-make-deps.h"
 
 namespace Rust {
 
@@ -265,6 +266,7 @@ load_file_bytes (location_t invoc_locus, const char *filename)
       rust_error_at (invoc_locus, "cannot open filename %s: %m", filename);
       return tl::nullopt;
     }
+  MakeDependencies::get ().add_dependency (filename);
 
   FILE *f = file_wrap.get_raw ();
   fseek (f, 0L, SEEK_END);
@@ -281,4 +283,37 @@ load_file_bytes (location_t invoc_locus, const char *filename)
 
   return buf;
 }
+
+tl::optional<std::string>
+load_file_string (location_t invoc_locus, const char *filename)
+{
+  RAIIFile file_wrap (filename);
+  if (file_wrap.get_raw () == nullptr)
+    {
+      rust_error_at (invoc_locus, "cannot open filename %s: %m", filename);
+      return tl::nullopt;
+    }
+  MakeDependencies::get ().add_dependency (filename);
+
+  FILE *f = file_wrap.get_raw ();
+  struct stat statbuf;
+  if (fstat (fileno (f), &statbuf) != 0)
+    {
+      rust_error_at (invoc_locus, "error reading file %s: %m", filename);
+      return tl::nullopt;
+    }
+
+  size_t fsize = statbuf.st_size;
+  if (fsize == 0)
+    return std::string ();
+
+  std::string contents (fsize, '\0');
+  if (fread (&contents[0], fsize, 1, f) != 1)
+    {
+      rust_error_at (invoc_locus, "error reading file %s: %m", filename);
+      return tl::nullopt;
+    }
+
+  return contents;
+}
 } // namespace Rust
\ No newline at end of file
@@ -86,5 +86,10 @@ source_relative_path (std::string path, location_t locus);
 // FIXME: platform specific.
 tl::optional<std::vector<uint8_t>>
 load_file_bytes (location_t invoc_locus, const char *filename);
+
+// Read the full contents of the file FILENAME straight into the returned
+// string, rather than through an intermediate buffer.
+tl::optional<std::string>
+load_file_string (location_t invoc_locus, const char *filename);
 } // namespace Rust
 #endif // GCCRS_RUST_MACRO_BUILTINS_HELPERS_H
@@ -21,6 +21,7 @@
 #include "rust-macro-builtins.h"
 #include "rust-macro-builtins-helpers.h"
 #include "optional.h"
+#include "rust-make-deps.h"
 namespace Rust {
 /* Expand builtin macro include_bytes!("filename"), which includes the contents
 of the given file as reference to a byte array. Yields an expression of type
@@ -45,46 +46,32 @@ MacroBuiltin::include_bytes_handler (location_t invoc_locus,
   std::string target_filename
     = source_relative_path (lit_expr->as_string (), invoc_locus);
 
-  auto maybe_bytes = load_file_bytes (invoc_locus, target_filename.c_str ());
+  auto maybe_bytes = load_file_string (invoc_locus, target_filename.c_str ());
 
   if (!maybe_bytes.has_value ())
     return AST::Fragment::create_error ();
 
-  std::vector<uint8_t> bytes = maybe_bytes.value ();
-
-  /* Is there a more efficient way to do this?  */
-  std::vector<std::unique_ptr<AST::Expr>> elts;
+  /* A byte string literal already has the type &'static [u8; N], so the whole
+     file becomes a single literal rather than an array with a literal per
+     byte.  When the file is large, the literal shares the token's copy of
+     it.  */
+  auto token
+    = Token::make_byte_string (invoc_locus, std::move (maybe_bytes.value ()));
+  auto value
+    = token->get_large_str ()
+	? AST::Literal (token->get_large_str (), AST::Literal::BYTE_STRING,
+			PrimitiveCoreType::CORETYPE_UNKNOWN)
+	: AST::Literal (token->get_str (), AST::Literal::BYTE_STRING,
+			PrimitiveCoreType::CORETYPE_UNKNOWN);
+
+  auto literal = std::unique_ptr<AST::Expr> (
+    new AST::LiteralExpr (std::move (value), {} /* outer_attrs */,
+			  invoc_locus));
 
-  // We create the tokens for a borrow expression of a byte array, so
-  // & [ <byte0>, <byte1>, ... ]
   std::vector<std::unique_ptr<AST::Token>> toks;
-  toks.emplace_back (make_token (Token::make (AMP, invoc_locus)));
-  toks.emplace_back (make_token (Token::make (LEFT_SQUARE, invoc_locus)));
-
-  for (uint8_t b : bytes)
-    {
-      elts.emplace_back (
-	new AST::LiteralExpr (std::string (1, (char) b), AST::Literal::BYTE,
-			      PrimitiveCoreType::CORETYPE_U8,
-			      {} /* outer_attrs */, invoc_locus));
-      toks.emplace_back (make_token (Token::make_byte_char (invoc_locus, b)));
-      toks.emplace_back (make_token (Token::make (COMMA, invoc_locus)));
-    }
-
-  toks.emplace_back (make_token (Token::make (RIGHT_SQUARE, invoc_locus)));
-
-  auto elems = std::unique_ptr<AST::ArrayElems> (
-    new AST::ArrayElemsValues (std::move (elts), invoc_locus));
+  toks.emplace_back (make_token (std::move (token)));
 
-  auto array = std::unique_ptr<AST::Expr> (
-    new AST::ArrayExpr (std::move (elems), {}, {}, invoc_locus));
-
-  auto borrow = std::unique_ptr<AST::Expr> (
-    new AST::BorrowExpr (std::move (array), Mutability::Imm,
-			 /* raw borrow */ false,
-			 /* double borrow */ false, {}, invoc_locus));
-
-  auto node = AST::SingleASTNode (std::move (borrow));
+  auto node = AST::SingleASTNode (std::move (literal));
 
   return AST::Fragment ({node}, std::move (toks));
 }
@@ -214,6 +201,8 @@ MacroBuiltin::include_handler (location_t invoc_locus,
       return AST::Fragment::create_error ();
     }
 
+  MakeDependencies::get ().add_dependency (target_filename);
+
   rust_debug ("Attempting to parse included file %s", target_filename);
 
   Lexer lex (target_filename, std::move (target_file), linemap);
@@ -20,6 +20,7 @@
 #include "optional.h"
 #include "rust-ast-fragment.h"
 #include "rust-macro-substitute-ctx.h"
+#include "rust-self-profile.h"
 #include "rust-ast-full.h"
 #include "rust-ast-visitor.h"
 #include "rust-diagnostics.h"
@@ -28,6 +29,7 @@
 #include "rust-early-name-resolver.h"
 #include "rust-session-manager.h"
 #include "rust-proc-macro.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 
@@ -80,46 +82,78 @@ MacroExpander::expand_decl_macro (location_t invoc_locus,
 
   AST::DelimTokenTree &invoc_token_tree = invoc.get_delim_tok_tree ();
 
-  // find matching arm
-  AST::MacroRule *matched_rule = nullptr;
-  std::map<std::string, std::unique_ptr<MatchedFragmentContainer>>
-    matched_fragments;
-  for (auto &rule : rules_def.get_rules ())
+  // matching only depends on the tokens of the invocation, so identical
+  // invocations of a definition reuse the arm and fragments found first
+  auto invoc_stream = invoc_token_tree.to_token_stream ();
+  auto cache_key
+    = std::make_pair (rules_def.get_node_id (), hash_tokens (invoc_stream));
+
+  auto &info = get_rules_info (rules_def);
+
+  // on a miss, the stream is moved into the cache
+  const std::vector<std::unique_ptr<AST::Token>> *stream = &invoc_stream;
+  auto cached = lookup_cached_match (cache_key, invoc_stream);
+  if (cached)
+    match_cache_hits++;
+  else
     {
-      sub_stack.push ();
-      bool did_match_rule = try_match_rule (rule, invoc_token_tree);
-      matched_fragments = sub_stack.pop ();
+      match_cache_misses++;
+
+      // find matching arm, only trying the ones that can start with the first
+      // token of the invocation
+      auto &rules = rules_def.get_rules ();
+      std::map<std::string, std::unique_ptr<MatchedFragmentContainer>>
+	matched_fragments;
+      size_t matched_rule = rules.size ();
+      for (size_t i = 0; i < rules.size (); i++)
+	{
+	  if (!info.first_sets[i].may_match (invoc_stream))
+	    continue;
+
+	  sub_stack.push ();
+	  bool did_match_rule = try_match_rule (rules[i], invoc_stream);
+	  matched_fragments = sub_stack.pop ();
 
-      if (did_match_rule)
+	  if (did_match_rule)
+	    {
+	      matched_rule = i;
+	      break;
+	    }
+	}
+
+      if (matched_rule == rules.size ())
 	{
-	  //  // Debugging
-	  //  for (auto &kv : matched_fragments)
-	  //    rust_debug ("[fragment]: %s (%ld - %s)", kv.first.c_str (),
-	  //		kv.second.get_fragments ().size (),
-	  //		kv.second.get_kind ()
-	  //		    == MatchedFragmentContainer::Kind::Repetition
-	  //		  ? "repetition"
-	  //		  : "metavar");
-
-	  matched_rule = &rule;
-	  break;
+	  rich_location r (line_table, invoc_locus);
+	  r.add_range (rules_def.get_locus ());
+	  rust_error_at (r, "Failed to match any rule within macro");
+	  return AST::Fragment::create_error ();
 	}
-    }
 
-  if (matched_rule == nullptr)
-    {
-      rich_location r (line_table, invoc_locus);
-      r.add_range (rules_def.get_locus ());
-      rust_error_at (r, "Failed to match any rule within macro");
-      return AST::Fragment::create_error ();
+      auto &entries = match_cache[cache_key];
+      entries.push_back (CachedMatch{std::move (invoc_stream), matched_rule,
+				     std::move (matched_fragments)});
+      cached = tl::optional<CachedMatch &> (entries.back ());
+      stream = &cached->invoc_stream;
     }
 
   std::map<std::string, MatchedFragmentContainer *> matched_fragments_ptr;
 
-  for (auto &ent : matched_fragments)
+  for (auto &ent : cached->fragments)
     matched_fragments_ptr.emplace (ent.first, ent.second.get ());
 
-  return transcribe_rule (*matched_rule, invoc_token_tree,
+  size_t rule_index = cached->rule_index;
+  if (profiling)
+    {
+      auto &arms = get_macro_profile (rules_def.get_node_id (),
+				      rules_def.get_rule_name ().as_string (),
+				      "macro_rules", rules_def.get_locus ())
+		     .arm_matches;
+      arms.resize (rules_def.get_rules ().size ());
+      arms[rule_index]++;
+    }
+
+  return transcribe_rule (rules_def.get_rules ()[rule_index], invoc_token_tree,
+			  *stream, info.transcribers[rule_index],
 			  matched_fragments_ptr, semicolon, peek_context ());
 }
 
@@ -162,18 +196,12 @@ MacroExpander::expand_eager_invocations (AST::MacroInvocation &invoc)
   //     new_tt = expand_eager_invoc(eagers[i++]);
   //     old_tt[start..end] = new_tt;
 
-  auto dtt = invoc.get_invoc_data ().get_delim_tok_tree ();
+  auto &dtt = invoc.get_invoc_data ().get_delim_tok_tree ();
   auto stream = dtt.to_token_stream ();
   std::vector<std::unique_ptr<AST::TokenTree>> new_stream;
   size_t current_pending = 0;
 
-  // we need to create a clone of the delimited token tree as the lexer
-  // expects ownership of the tokens
-  std::vector<std::unique_ptr<Rust::AST::Token>> dtt_clone;
-  for (auto &tok : stream)
-    dtt_clone.emplace_back (tok->clone_token ());
-
-  MacroInvocLexer lex (std::move (dtt_clone));
+  MacroInvocLexer lex (stream);
   Parser<MacroInvocLexer> parser (lex);
 
   // we want to build a substitution map - basically, associating a `start` and
@@ -279,17 +307,24 @@ MacroExpander::expand_invoc (AST::MacroInvocation &invoc,
   auto rules_def = mappings.lookup_macro_invocation (invoc);
 
   // If there's no rule associated with the invocation, we can simply return
-  // early. The early name resolver will have already emitted an error.
+  // early. The early name resolver will have already emitted an error. A later
+  // round may still be able to resolve it, so it has to be revisited.
   if (!rules_def)
-    return;
+    {
+      needs_revisit_flag = true;
+      return;
+    }
 
   auto rdef = rules_def.value ();
 
   // We store the last expanded invocation and macro definition for error
   // reporting in case the recursion limit is reached
-  last_invoc = *invoc.clone_macro_invocation_impl ();
+  last_invoc_locus = invoc.get_locus ();
   last_def = *rdef;
 
+  long start = profile_start ();
+  SelfProfileScope self_profile ("expansion",
+				 rdef->get_rule_name ().as_string ().c_str ());
   if (rdef->is_builtin ())
     fragment = rdef
 		 ->get_builtin_transcriber () (invoc.get_locus (), invoc_data,
@@ -299,9 +334,76 @@ MacroExpander::expand_invoc (AST::MacroInvocation &invoc,
     fragment
       = expand_decl_macro (invoc.get_locus (), invoc_data, *rdef, semicolon);
 
+  if (profiling)
+    profile_invocation (
+      rdef->get_node_id (), rdef->get_rule_name ().as_string (),
+      rdef->is_builtin () ? "builtin" : "macro_rules", rdef->get_locus (),
+      invoc_data.get_delim_tok_tree ().to_token_stream ().size (), fragment,
+      start);
+
   set_expanded_fragment (std::move (fragment));
 }
 
+MacroProfile &
+MacroExpander::get_macro_profile (NodeId def, const std::string &name,
+				  const char *kind, location_t locus)
+{
+  auto it = macro_profiles.find (def);
+  if (it == macro_profiles.end ())
+    it = macro_profiles
+	   .emplace (def, MacroProfile{name, kind, locus, 0, {}, 0, 0, 0})
+	   .first;
+
+  return it->second;
+}
+
+void
+MacroExpander::profile_invocation (NodeId def, const std::string &name,
+				   const char *kind, location_t locus,
+				   size_t tokens_in, AST::Fragment &fragment,
+				   long start)
+{
+  auto &profile = get_macro_profile (def, name, kind, locus);
+  profile.invocations++;
+  profile.tokens_in += tokens_in;
+  profile.tokens_out += fragment.get_tokens ().size ();
+  profile.time += get_run_time () - start;
+}
+
+std::vector<const MacroProfile *>
+MacroExpander::get_macro_profiles () const
+{
+  std::vector<const MacroProfile *> profiles;
+  for (auto &entry : macro_profiles)
+    profiles.push_back (&entry.second);
+
+  std::stable_sort (profiles.begin (), profiles.end (),
+		    [] (const MacroProfile *a, const MacroProfile *b) {
+		      return a->time > b->time;
+		    });
+
+  return profiles;
+}
+
+/* Only macro invocations and attributes (`cfg`, derives, attribute macros)
+   give the next expansion round something to do, and both need a `!` or a
+   `#` token. Fragments built straight from AST nodes carry no tokens and are
+   assumed to need another round.  */
+
+bool
+MacroExpander::fragment_may_need_expansion (AST::Fragment &fragment)
+{
+  auto &tokens = fragment.get_tokens ();
+  if (tokens.empty ())
+    return !fragment.get_nodes ().empty ();
+
+  for (auto &token : tokens)
+    if (token->get_id () == EXCLAM || token->get_id () == HASH)
+      return true;
+
+  return false;
+}
+
 void
 MacroExpander::expand_crate ()
 {
@@ -358,12 +460,88 @@ MacroExpander::depth_exceeds_recursion_limit () const
   return expansion_depth >= cfg.recursion_limit;
 }
 
+size_t
+MacroExpander::hash_tokens (
+  const std::vector<std::unique_ptr<AST::Token>> &stream)
+{
+  size_t hash = stream.size ();
+  for (auto &tok : stream)
+    {
+      hash = hash * 31 + tok->get_id ();
+      if (tok->get_tok_ptr ()->has_str ())
+	hash = hash * 31 + std::hash<std::string> () (tok->get_str ());
+    }
+
+  return hash;
+}
+
+static bool
+same_tokens (const std::vector<std::unique_ptr<AST::Token>> &a,
+	     const std::vector<std::unique_ptr<AST::Token>> &b)
+{
+  if (a.size () != b.size ())
+    return false;
+
+  for (size_t i = 0; i < a.size (); i++)
+    {
+      const_TokenPtr lhs = a[i]->get_tok_ptr ();
+      const_TokenPtr rhs = b[i]->get_tok_ptr ();
+      if (lhs->get_id () != rhs->get_id ()
+	  || lhs->has_str () != rhs->has_str ()
+	  || (lhs->has_str () && lhs->get_str () != rhs->get_str ()))
+	return false;
+    }
+
+  return true;
+}
+
+tl::optional<MacroExpander::CachedMatch &>
+MacroExpander::lookup_cached_match (
+  const std::pair<NodeId, size_t> &key,
+  const std::vector<std::unique_ptr<AST::Token>> &invoc_stream)
+{
+  auto it = match_cache.find (key);
+  if (it == match_cache.end ())
+    return tl::nullopt;
+
+  for (auto &entry : it->second)
+    if (same_tokens (entry.invoc_stream, invoc_stream))
+      return entry;
+
+  return tl::nullopt;
+}
+
+const MacroExpander::MacroRulesInfo &
+MacroExpander::get_rules_info (AST::MacroRulesDefinition &rules_def)
+{
+  auto it = rules_info.find (rules_def.get_node_id ());
+  if (it != rules_info.end ())
+    return it->second;
+
+  MacroRulesInfo info;
+  info.first_sets.reserve (rules_def.get_rules ().size ());
+  info.transcribers.reserve (rules_def.get_rules ().size ());
+  for (auto &rule : rules_def.get_rules ())
+    {
+      info.first_sets.push_back (MacroFirstSet::compute (rule.get_matcher ()));
+      info.transcribers.push_back (
+	rule.get_transcriber ().get_token_tree ().to_token_stream ());
+    }
+
+  return rules_info.emplace (rules_def.get_node_id (), std::move (info))
+    .first->second;
+}
+
 bool
-MacroExpander::try_match_rule (AST::MacroRule &match_rule,
-			       AST::DelimTokenTree &invoc_token_tree)
+MacroExpander::try_match_rule (
+  AST::MacroRule &match_rule,
+  const std::vector<std::unique_ptr<AST::Token>> &invoc_stream)
 {
-  MacroInvocLexer lex (invoc_token_tree.to_token_stream ());
-  Parser<MacroInvocLexer> parser (lex);
+  // matching never expands anything, so attempts cannot overlap and can all
+  // share one parser
+  fragment_lexer.reset (invoc_stream);
+  fragment_parser.reset ();
+  Parser<MacroInvocLexer> &parser = fragment_parser;
 
   AST::MacroMatcher &matcher = match_rule.get_matcher ();
 
@@ -379,11 +557,116 @@ MacroExpander::try_match_rule (AST::MacroRule &match_rule,
   return used_all_input_tokens;
 }
 
+// Can TOKEN follow a fragment of kind KIND without being part of it, whatever
+// the fragment is ?
+static bool
+ends_fragment (const_TokenPtr token, AST::MacroFragSpec::Kind kind)
+{
+  switch (token->get_id ())
+    {
+    case COMMA:
+    case SEMICOLON:
+    case MATCH_ARROW:
+    case RIGHT_PAREN:
+    case RIGHT_SQUARE:
+    case RIGHT_CURLY:
+    case END_OF_FILE:
+      return true;
+    case EQUAL:
+    case RIGHT_ANGLE:
+      return kind == AST::MacroFragSpec::TY;
+    default:
+      return false;
+    }
+}
+
+// The number of tokens taken by a fragment of kind KIND at the start of the
+// parser's input, when it can be told without parsing the fragment. This
+// covers token trees, and expressions, types and patterns that are a single
+// identifier or literal, which together are most fragments in practice.
+static tl::optional<int>
+peek_fragment_length (Parser<MacroInvocLexer> &parser,
+		      AST::MacroFragSpec::Kind kind)
+{
+  const_TokenPtr first = parser.peek_current_token ();
+
+  switch (kind)
+    {
+      case AST::MacroFragSpec::TT: {
+	switch (first->get_id ())
+	  {
+	  case LEFT_PAREN:
+	  case LEFT_SQUARE:
+	  case LEFT_CURLY:
+	    break;
+	  case RIGHT_PAREN:
+	  case RIGHT_SQUARE:
+	  case RIGHT_CURLY:
+	  case END_OF_FILE:
+	    return tl::nullopt;
+	  default:
+	    return 1;
+	  }
+
+	// leave anything malformed to the parser
+	auto length = parser.get_token_source ().get_group_length (0);
+	if (!length.has_value ())
+	  return tl::nullopt;
+
+	return (int) length.value ();
+      }
+
+    case AST::MacroFragSpec::EXPR:
+    case AST::MacroFragSpec::PAT:
+      switch (first->get_id ())
+	{
+	case IDENTIFIER:
+	case INT_LITERAL:
+	case FLOAT_LITERAL:
+	case STRING_LITERAL:
+	case CHAR_LITERAL:
+	case BYTE_STRING_LITERAL:
+	case BYTE_CHAR_LITERAL:
+	case TRUE_LITERAL:
+	case FALSE_LITERAL:
+	  break;
+	default:
+	  return tl::nullopt;
+	}
+      break;
+
+    case AST::MacroFragSpec::TY:
+      if (first->get_id () != IDENTIFIER)
+	return tl::nullopt;
+      break;
+
+    default:
+      return tl::nullopt;
+    }
+
+  if (!ends_fragment (parser.peek (1), kind))
+    return tl::nullopt;
+
+  return 1;
+}
+
 bool
 MacroExpander::match_fragment (Parser<MacroInvocLexer> &parser,
 			       AST::MacroMatchFragment &fragment)
 {
-  switch (fragment.get_frag_spec ().get_kind ())
+  // skip the fragments that do not need parsing rather than building AST
+  // that would be thrown away, the transcribed tokens are parsed again
+  // anyway
+  auto kind = fragment.get_frag_spec ().get_kind ();
+  auto length = peek_fragment_length (parser, kind);
+  if (length.has_value ())
+    {
+      for (int i = 0; i < length.value (); i++)
+	parser.skip_token ();
+      return !parser.has_errors ();
+    }
+
+  switch (kind)
     {
     case AST::MacroFragSpec::EXPR:
       parser.parse_expr ();
@@ -1020,6 +1303,8 @@ tokens_to_str (std::vector<std::unique_ptr<AST::Token>> &tokens)
 AST::Fragment
 MacroExpander::transcribe_rule (
   AST::MacroRule &match_rule, AST::DelimTokenTree &invoc_token_tree,
+  const std::vector<std::unique_ptr<AST::Token>> &invoc_stream,
+  const std::vector<std::unique_ptr<AST::Token>> &macro_rule_tokens,
   std::map<std::string, MatchedFragmentContainer *> &matched_fragments,
   AST::InvocKind invoc_kind, ContextType ctx)
 {
@@ -1030,9 +1315,6 @@ MacroExpander::transcribe_rule (
   AST::MacroTranscriber &transcriber = match_rule.get_transcriber ();
   AST::DelimTokenTree &transcribe_tree = transcriber.get_token_tree ();
 
-  auto invoc_stream = invoc_token_tree.to_token_stream ();
-  auto macro_rule_tokens = transcribe_tree.to_token_stream ();
-
   auto substitute_context
     = SubstituteCtx (invoc_stream, macro_rule_tokens, matched_fragments);
   std::vector<std::unique_ptr<AST::Token>> substituted_tokens
@@ -1042,8 +1324,9 @@ MacroExpander::transcribe_rule (
 	      tokens_to_str (substituted_tokens).c_str ());
 
   // parse it to an Fragment
-  MacroInvocLexer lex (std::move (substituted_tokens));
-  Parser<MacroInvocLexer> parser (lex);
+  fragment_lexer.reset (std::move (substituted_tokens));
+  fragment_parser.reset ();
+  Parser<MacroInvocLexer> &parser = fragment_parser;
 
   auto last_token_id = TokenId::RIGHT_CURLY;
 
@@ -1103,6 +1386,106 @@ MacroExpander::transcribe_rule (
   return fragment;
 }
 
+std::vector<AST::Fragment>
+MacroExpander::expand_derive_proc_macros (
+  AST::Item &item,
+  const std::vector<std::reference_wrapper<AST::SimplePath>> &paths)
+{
+  std::vector<AST::Fragment> fragments;
+
+  // the profile records the time spent by each invocation on its own
+  size_t jobs = profiling ? 1 : flag_rust_proc_macro_jobs;
+  jobs = std::min (jobs, paths.size ());
+
+  // macros commonly keep global state, so unless all of them say otherwise,
+  // they run one after the other
+  for (auto &path : paths)
+    {
+      auto macro = mappings.lookup_derive_proc_macro_invocation (path.get ());
+      if (macro.has_value () && !macro->is_thread_safe ())
+	jobs = 1;
+    }
+
+  if (jobs <= 1)
+    {
+      for (auto &path : paths)
+	fragments.push_back (expand_derive_proc_macro (item, path.get ()));
+      return fragments;
+    }
+
+  std::vector<const_TokenPtr> vec;
+  AST::TokenSink sink (vec);
+  AST::TokenCollector collector (sink);
+  collector.visit (item);
+
+  ProcMacro::Arena arena;
+  ProcMacro::Arena::Scope arena_scope (arena);
+
+  // every macro takes ownership of its input, so each gets its own copy
+  std::vector<const CustomDeriveProcMacro *> macros;
+  std::vector<ProcMacro::TokenStream> streams;
+  for (auto &path : paths)
+    {
+      auto macro = mappings.lookup_derive_proc_macro_invocation (path.get ());
+      if (!macro.has_value ())
+	{
+	  rust_error_at (path.get ().get_locus (), "macro not found");
+	  macros.push_back (nullptr);
+	  streams.emplace_back ();
+	  continue;
+	}
+
+      macros.push_back (&macro.value ());
+      streams.push_back (convert (vec));
+    }
+
+  // the macros only call back into the compiler to lex strings, which is
+  // serialized, and the current thread runs its share of the invocations.
+  // The workers lex with the session of the current thread.
+  std::vector<tl::optional<ProcMacro::TokenStream>> outputs (macros.size ());
+  ThreadState state = ThreadState::current ();
+  auto run_batch = [&] (size_t batch) {
+    ThreadState::Adopt adopt (state);
+    for (size_t i = batch; i < macros.size (); i += jobs)
+      if (macros[i] != nullptr)
+	outputs[i] = macros[i]->invoke (streams[i]);
+  };
+
+  std::vector<std::future<void>> workers;
+  for (size_t batch = 1; batch < jobs; batch++)
+    workers.emplace_back (std::async (worker_launch, run_batch, batch));
+  run_batch (0);
+
+  for (auto &worker : workers)
+    worker.wait ();
+
+  for (size_t i = 0; i < macros.size (); i++)
+    {
+      if (macros[i] == nullptr)
+	fragments.push_back (AST::Fragment::create_error ());
+      else if (!outputs[i])
+	{
+	  report_lost_proc_macro (paths[i].get ().get_locus (),
+				  macros[i]->get_name ());
+	  fragments.push_back (AST::Fragment::create_error ());
+	}
+      else
+	fragments.push_back (parse_proc_macro_output (outputs[i].value ()));
+    }
+
+  return fragments;
+}
+
+void
+MacroExpander::report_lost_proc_macro (location_t locus,
+				       const std::string &name)
+{
+  rust_error_at (locus,
+		 "procedural macro %qs did not complete: the process running "
+		 "it exited",
+		 name.c_str ());
+}
+
 AST::Fragment
 MacroExpander::parse_proc_macro_output (ProcMacro::TokenStream ts)
 {
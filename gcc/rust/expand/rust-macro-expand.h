@@ -30,6 +30,7 @@
 #include "rust-early-name-resolver.h"
 #include "rust-name-resolver.h"
 #include "rust-macro-invoc-lexer.h"
+#include "rust-macro-first-set.h"
 #include "rust-proc-macro-invoc-lexer.h"
 #include "rust-token-converter.h"
 #include "rust-ast-collector.h"
@@ -278,6 +279,22 @@ private:
     stack;
 };
 
+// What the macro-profile dump reports about a macro definition
+struct MacroProfile
+{
+  std::string name;
+  // "macro_rules", "builtin", "derive", "bang" or "attribute"
+  const char *kind;
+  location_t locus;
+  unsigned invocations;
+  // invocations matched by each arm of a macro_rules! definition
+  std::vector<unsigned> arm_matches;
+  size_t tokens_in;
+  size_t tokens_out;
+  // in microseconds, including eager expansion of nested invocations
+  long time;
+};
+
 // Object used to store shared data (between functions) for macro expansion.
 struct MacroExpander
 {
@@ -300,7 +317,11 @@ struct MacroExpander
     : cfg (cfg), crate (crate), session (session),
       sub_stack (SubstitutionScope ()),
       expanded_fragment (AST::Fragment::create_error ()),
-      has_changed_flag (false), resolver (Resolver::Resolver::get ()),
+      has_changed_flag (false), needs_revisit_flag (false),
+      expanded_fragment_count (0), match_cache_hits (0),
+      match_cache_misses (0), profiling (false),
+      fragment_lexer (std::vector<std::unique_ptr<AST::Token>> ()),
+      fragment_parser (fragment_lexer), resolver (Resolver::Resolver::get ()),
       mappings (Analysis::Mappings::get ())
   {}
 
@@ -327,11 +348,45 @@ struct MacroExpander
 
   bool depth_exceeds_recursion_limit () const;
 
-  bool try_match_rule (AST::MacroRule &match_rule,
-		       AST::DelimTokenTree &invoc_token_tree);
+  bool try_match_rule (
+    AST::MacroRule &match_rule,
+    const std::vector<std::unique_ptr<AST::Token>> &invoc_stream);
+
+  // What is computed about a macro_rules! definition on its first use
+  struct MacroRulesInfo
+  {
+    // first set of every arm's matcher
+    std::vector<MacroFirstSet> first_sets;
+    // flattened transcriber of every arm
+    std::vector<std::vector<std::unique_ptr<AST::Token>>> transcribers;
+  };
+
+  const MacroRulesInfo &get_rules_info (AST::MacroRulesDefinition &rules_def);
+
+  /**
+   * The arm an invocation matched and the fragments it captured, as offsets
+   * into the invocation's token stream. Both only depend on the tokens, not on
+   * where the invocation is, so they can be reused for identical invocations.
+   */
+  struct CachedMatch
+  {
+    std::vector<std::unique_ptr<AST::Token>> invoc_stream;
+    size_t rule_index;
+    std::map<std::string, std::unique_ptr<MatchedFragmentContainer>>
+      fragments;
+  };
+
+  static size_t
+  hash_tokens (const std::vector<std::unique_ptr<AST::Token>> &stream);
+
+  tl::optional<CachedMatch &> lookup_cached_match (
+    const std::pair<NodeId, size_t> &key,
+    const std::vector<std::unique_ptr<AST::Token>> &invoc_stream);
 
   AST::Fragment transcribe_rule (
     AST::MacroRule &match_rule, AST::DelimTokenTree &invoc_token_tree,
+    const std::vector<std::unique_ptr<AST::Token>> &invoc_stream,
+    const std::vector<std::unique_ptr<AST::Token>> &macro_rule_tokens,
     std::map<std::string, MatchedFragmentContainer *> &matched_fragments,
     AST::InvocKind invoc_kind, ContextType ctx);
 
@@ -393,7 +448,12 @@ struct MacroExpander
   void set_expanded_fragment (AST::Fragment &&fragment)
   {
     if (!fragment.is_error ())
-      has_changed_flag = true;
+      {
+	has_changed_flag = true;
+	expanded_fragment_count++;
+	if (fragment_may_need_expansion (fragment))
+	  needs_revisit_flag = true;
+      }
 
     expanded_fragment = std::move (fragment);
   }
@@ -408,6 +468,18 @@ struct MacroExpander
 
   void import_proc_macros (std::string extern_crate);
 
+  // The worker of the proc macro server running the macro NAME exited
+  void report_lost_proc_macro (location_t locus, const std::string &name);
+
+  /**
+   * Expand each of the custom derives PATHS over ITEM, which all of them see
+   * in the same state. With -frust-proc-macro-jobs= the macros run on several
+   * threads, their outputs are still parsed in the order of PATHS.
+   */
+  std::vector<AST::Fragment> expand_derive_proc_macros (
+    AST::Item &item,
+    const std::vector<std::reference_wrapper<AST::SimplePath>> &paths);
+
   template <typename T>
   AST::Fragment expand_derive_proc_macro (T &item, AST::SimplePath &path)
   {
@@ -419,15 +491,29 @@ struct MacroExpander
 	return AST::Fragment::create_error ();
       }
 
-    AST::TokenCollector collector;
-
+    std::vector<const_TokenPtr> vec;
+    AST::TokenSink sink (vec);
+    AST::TokenCollector collector (sink);
     collector.visit (item);
 
-    auto c = collector.collect_tokens ();
-    std::vector<const_TokenPtr> vec (c.cbegin (), c.cend ());
+    // everything exchanged with the macro is dead once its output is parsed
+    ProcMacro::Arena arena;
+    ProcMacro::Arena::Scope arena_scope (arena);
 
-    return parse_proc_macro_output (
-      macro.value ().get_handle () (convert (vec)));
+    long start = profile_start ();
+    auto output = macro->invoke (convert (vec));
+    if (!output)
+      {
+	report_lost_proc_macro (path.get_locus (), macro->get_name ());
+	return AST::Fragment::create_error ();
+      }
+
+    auto fragment = parse_proc_macro_output (output.value ());
+    if (profiling)
+      profile_invocation (macro->get_node_id (), macro->get_name (), "derive",
+			  UNDEF_LOCATION, vec.size (), fragment, start);
+
+    return fragment;
   }
 
   template <typename T>
@@ -442,15 +528,28 @@ struct MacroExpander
 	return AST::Fragment::create_error ();
       }
 
-    AST::TokenCollector collector;
-
+    std::vector<const_TokenPtr> vec;
+    AST::TokenSink sink (vec);
+    AST::TokenCollector collector (sink);
     collector.visit (item);
 
-    auto c = collector.collect_tokens ();
-    std::vector<const_TokenPtr> vec (c.cbegin (), c.cend ());
+    ProcMacro::Arena arena;
+    ProcMacro::Arena::Scope arena_scope (arena);
+
+    long start = profile_start ();
+    auto output = macro->invoke (convert (vec));
+    if (!output)
+      {
+	report_lost_proc_macro (invocation.get_locus (), macro->get_name ());
+	return AST::Fragment::create_error ();
+      }
+
+    auto fragment = parse_proc_macro_output (output.value ());
+    if (profiling)
+      profile_invocation (macro->get_node_id (), macro->get_name (), "bang",
+			  UNDEF_LOCATION, vec.size (), fragment, start);
 
-    return parse_proc_macro_output (
-      macro.value ().get_handle () (convert (vec)));
+    return fragment;
   }
 
   template <typename T>
@@ -464,17 +563,31 @@ struct MacroExpander
 	return AST::Fragment::create_error ();
       }
 
-    AST::TokenCollector collector;
-
+    std::vector<const_TokenPtr> vec;
+    AST::TokenSink sink (vec);
+    AST::TokenCollector collector (sink);
     collector.visit (item);
 
-    auto c = collector.collect_tokens ();
-    std::vector<const_TokenPtr> vec (c.cbegin (), c.cend ());
+    ProcMacro::Arena arena;
+    ProcMacro::Arena::Scope arena_scope (arena);
 
     // FIXME: Handle attributes
-    return parse_proc_macro_output (
-      macro.value ().get_handle () (ProcMacro::TokenStream::make_tokenstream (),
-				    convert (vec)));
+    long start = profile_start ();
+    auto output = macro->invoke (ProcMacro::TokenStream::make_tokenstream (),
+				 convert (vec));
+    if (!output)
+      {
+	report_lost_proc_macro (path.get_locus (), macro->get_name ());
+	return AST::Fragment::create_error ();
+      }
+
+    auto fragment = parse_proc_macro_output (output.value ());
+    if (profiling)
+      profile_invocation (macro->get_node_id (), macro->get_name (),
+			  "attribute", UNDEF_LOCATION, vec.size (), fragment,
+			  start);
+
+    return fragment;
   }
 
   /**
@@ -482,34 +595,97 @@ struct MacroExpander
    */
   bool has_changed () const { return has_changed_flag; }
 
+  /**
+   * Could the crate contain work for another expansion round? This is false
+   * when every fragment expanded since the last reset is free of macro
+   * invocations and attributes and every invocation could be resolved, in
+   * which case stripping and expanding the crate again would not change it.
+   */
+  bool needs_revisit () const { return needs_revisit_flag; }
+
+  /**
+   * Number of fragments expanded since the expander's state was last reset
+   */
+  unsigned get_expanded_fragment_count () const
+  {
+    return expanded_fragment_count;
+  }
+
+  unsigned get_match_cache_hits () const { return match_cache_hits; }
+  unsigned get_match_cache_misses () const { return match_cache_misses; }
+
+  /**
+   * Record what is spent expanding each macro from now on, see
+   * `get_macro_profiles`
+   */
+  void enable_profiling () { profiling = true; }
+
+  /**
+   * Profiles of every macro expanded so far, slowest first
+   */
+  std::vector<const MacroProfile *> get_macro_profiles () const;
+
   /**
    * Reset the expander's "changed" state. This function should be executed at
    * each iteration in a fixed point loop
    */
-  void reset_changed_state () { has_changed_flag = false; }
+  void reset_changed_state ()
+  {
+    has_changed_flag = false;
+    needs_revisit_flag = false;
+    expanded_fragment_count = 0;
+  }
 
   tl::optional<AST::MacroRulesDefinition &> &get_last_definition ()
   {
     return last_def;
   }
 
-  tl::optional<AST::MacroInvocation &> &get_last_invocation ()
+  // Invocations are replaced by their expansion, only their location is kept
+  tl::optional<location_t> get_last_invocation_locus () const
   {
-    return last_invoc;
+    return last_invoc_locus;
   }
 
 private:
   AST::Fragment parse_proc_macro_output (ProcMacro::TokenStream ts);
 
+  long profile_start () const { return profiling ? get_run_time () : 0; }
+
+  MacroProfile &get_macro_profile (NodeId def, const std::string &name,
+				   const char *kind, location_t locus);
+
+  void profile_invocation (NodeId def, const std::string &name,
+			   const char *kind, location_t locus,
+			   size_t tokens_in, AST::Fragment &fragment,
+			   long start);
+
+  static bool fragment_may_need_expansion (AST::Fragment &fragment);
+
   AST::Crate &crate;
   Session &session;
   SubstitutionScope sub_stack;
   std::vector<ContextType> context;
   AST::Fragment expanded_fragment;
   bool has_changed_flag;
+  bool needs_revisit_flag;
+  unsigned expanded_fragment_count;
+  // info about every macro_rules! definition used so far
+  std::map<NodeId, MacroRulesInfo> rules_info;
+  // matches of macro_rules! invocations, keyed on the definition and the hash
+  // of the invocation's tokens
+  std::map<std::pair<NodeId, size_t>, std::vector<CachedMatch>> match_cache;
+  unsigned match_cache_hits;
+  unsigned match_cache_misses;
+  bool profiling;
+  std::map<NodeId, MacroProfile> macro_profiles;
+  // lexer and parser reset for each match attempt and transcription instead
+  // of being rebuilt every time, see try_match_rule
+  MacroInvocLexer fragment_lexer;
+  Parser<MacroInvocLexer> fragment_parser;
 
   tl::optional<AST::MacroRulesDefinition &> last_def;
-  tl::optional<AST::MacroInvocation &> last_invoc;
+  tl::optional<location_t> last_invoc_locus;
 
 public:
   Resolver::Resolver *resolver;
@@ -0,0 +1,269 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-macro-first-set.h"
+#include "selftest.h"
+
+namespace Rust {
+
+MacroFirstSet
+MacroFirstSet::compute (const AST::MacroMatcher &matcher)
+{
+  MacroFirstSet first;
+
+  if (matcher.is_error ())
+    first.any_token = true;
+  else
+    first.can_be_empty = first.add_sequence (matcher.get_matches ());
+
+  return first;
+}
+
+/* The token the parser gets when it splits the compound token ID, e.g. `>`
+   for `>>`, or nothing if ID is not a compound token.  */
+static tl::optional<TokenId>
+split_first (TokenId id)
+{
+  switch (id)
+    {
+    case NOT_EQUAL:
+      return EXCLAM;
+    case PERCENT_EQ:
+      return PERCENT;
+    case AMP_EQ:
+    case LOGICAL_AND:
+      return AMP;
+    case ASTERISK_EQ:
+      return ASTERISK;
+    case PLUS_EQ:
+      return PLUS;
+    case MINUS_EQ:
+    case RETURN_TYPE:
+      return MINUS;
+    case DOT_DOT:
+      return DOT;
+    case DOT_DOT_EQ:
+    case ELLIPSIS:
+      return DOT_DOT;
+    case DIV_EQ:
+      return DIV;
+    case SCOPE_RESOLUTION:
+      return COLON;
+    case LEFT_SHIFT:
+    case LESS_OR_EQUAL:
+      return LEFT_ANGLE;
+    case LEFT_SHIFT_EQ:
+      return LEFT_SHIFT;
+    case EQUAL_EQUAL:
+    case MATCH_ARROW:
+      return EQUAL;
+    case RIGHT_SHIFT:
+    case GREATER_OR_EQUAL:
+      return RIGHT_ANGLE;
+    case RIGHT_SHIFT_EQ:
+      return RIGHT_SHIFT;
+    case CARET_EQ:
+      return CARET;
+    case PIPE_EQ:
+    case OR:
+      return PIPE;
+    default:
+      return tl::nullopt;
+    }
+}
+
+bool
+MacroFirstSet::may_match (
+  const std::vector<std::unique_ptr<AST::Token>> &stream) const
+{
+  if (any_token)
+    return true;
+
+  // the stream always starts and ends with the invocation's delimiters
+  if (stream.size () <= 2)
+    return can_be_empty;
+
+  // a compound token may be split to match its first component, so `>>` can
+  // start an arm beginning with `>`
+  tl::optional<TokenId> id = stream[1]->get_id ();
+  for (; id.has_value (); id = split_first (id.value ()))
+    if (tokens[id.value ()])
+      return true;
+
+  return false;
+}
+
+// Add the first tokens of SEQ, returns whether all of SEQ can match nothing
+bool
+MacroFirstSet::add_sequence (
+  const std::vector<std::unique_ptr<AST::MacroMatch>> &seq)
+{
+  for (auto &match : seq)
+    if (!add_match (*match))
+      return false;
+
+  return true;
+}
+
+// Add the first tokens of MATCH, returns whether MATCH can match nothing
+bool
+MacroFirstSet::add_match (const AST::MacroMatch &match)
+{
+  switch (match.get_macro_match_type ())
+    {
+      case AST::MacroMatch::MacroMatchType::Tok: {
+	auto &tok = static_cast<const AST::Token &> (match);
+	tokens[tok.get_id ()] = true;
+	return false;
+      }
+
+      case AST::MacroMatch::MacroMatchType::Matcher: {
+	auto &matcher = static_cast<const AST::MacroMatcher &> (match);
+	switch (matcher.get_delim_type ())
+	  {
+	  case AST::DelimType::PARENS:
+	    tokens[LEFT_PAREN] = true;
+	    break;
+	  case AST::DelimType::SQUARE:
+	    tokens[LEFT_SQUARE] = true;
+	    break;
+	  case AST::DelimType::CURLY:
+	    tokens[LEFT_CURLY] = true;
+	    break;
+	  }
+	return false;
+      }
+
+      case AST::MacroMatch::MacroMatchType::Fragment: {
+	auto &fragment = static_cast<const AST::MacroMatchFragment &> (match);
+	if (fragment.get_frag_spec ().get_kind () == AST::MacroFragSpec::BLOCK)
+	  {
+	    tokens[LEFT_CURLY] = true;
+	    return false;
+	  }
+
+	any_token = true;
+	return true;
+      }
+
+      case AST::MacroMatch::MacroMatchType::Repetition: {
+	auto &rep = static_cast<const AST::MacroMatchRepetition &> (match);
+	bool inner_can_be_empty = add_sequence (rep.get_matches ());
+
+	return inner_can_be_empty
+	       || rep.get_op () != AST::MacroMatchRepetition::ONE_OR_MORE;
+      }
+    }
+
+  rust_unreachable ();
+}
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+static std::unique_ptr<Rust::AST::Token>
+make_token (Rust::TokenId id)
+{
+  return std::unique_ptr<Rust::AST::Token> (
+    new Rust::AST::Token (Rust::Token::make (id, UNDEF_LOCATION)));
+}
+
+static std::vector<std::unique_ptr<Rust::AST::Token>>
+make_stream (const std::vector<Rust::TokenId> &ids)
+{
+  std::vector<std::unique_ptr<Rust::AST::Token>> stream;
+  stream.push_back (make_token (Rust::LEFT_PAREN));
+  for (auto id : ids)
+    stream.push_back (make_token (id));
+  stream.push_back (make_token (Rust::RIGHT_PAREN));
+
+  return stream;
+}
+
+static std::unique_ptr<Rust::AST::MacroMatch>
+make_fragment (Rust::AST::MacroFragSpec::Kind kind)
+{
+  return std::unique_ptr<Rust::AST::MacroMatch> (
+    new Rust::AST::MacroMatchFragment (std::string ("x"),
+				       Rust::AST::MacroFragSpec (kind),
+				       UNDEF_LOCATION));
+}
+
+void
+rust_macro_first_set_test (void)
+{
+  using namespace Rust;
+
+  // (; $x:expr)
+  std::vector<std::unique_ptr<AST::MacroMatch>> token_first;
+  token_first.push_back (make_token (SEMICOLON));
+  token_first.push_back (make_fragment (AST::MacroFragSpec::EXPR));
+  auto token_set = MacroFirstSet::compute (
+    AST::MacroMatcher (AST::PARENS, std::move (token_first), UNDEF_LOCATION));
+
+  // ($($x:block),*)
+  std::vector<std::unique_ptr<AST::MacroMatch>> blocks;
+  blocks.push_back (make_fragment (AST::MacroFragSpec::BLOCK));
+  std::vector<std::unique_ptr<AST::MacroMatch>> rep_first;
+  rep_first.emplace_back (
+    new AST::MacroMatchRepetition (std::move (blocks),
+				   AST::MacroMatchRepetition::ANY,
+				   make_token (COMMA), UNDEF_LOCATION));
+  auto rep_set = MacroFirstSet::compute (
+    AST::MacroMatcher (AST::PARENS, std::move (rep_first), UNDEF_LOCATION));
+
+  // ($x:tt)
+  std::vector<std::unique_ptr<AST::MacroMatch>> tt_first;
+  tt_first.push_back (make_fragment (AST::MacroFragSpec::TT));
+  auto tt_set = MacroFirstSet::compute (
+    AST::MacroMatcher (AST::PARENS, std::move (tt_first), UNDEF_LOCATION));
+
+  auto semi = make_stream ({SEMICOLON, INT_LITERAL});
+  ASSERT_TRUE (token_set.may_match (semi));
+  ASSERT_FALSE (rep_set.may_match (semi));
+  ASSERT_TRUE (tt_set.may_match (semi));
+
+  auto block = make_stream ({LEFT_CURLY, RIGHT_CURLY});
+  ASSERT_FALSE (token_set.may_match (block));
+  ASSERT_TRUE (rep_set.may_match (block));
+  ASSERT_TRUE (tt_set.may_match (block));
+
+  // (> $x:expr)
+  std::vector<std::unique_ptr<AST::MacroMatch>> angle_first;
+  angle_first.push_back (make_token (RIGHT_ANGLE));
+  angle_first.push_back (make_fragment (AST::MacroFragSpec::EXPR));
+  auto angle_set = MacroFirstSet::compute (
+    AST::MacroMatcher (AST::PARENS, std::move (angle_first), UNDEF_LOCATION));
+
+  ASSERT_TRUE (angle_set.may_match (make_stream ({RIGHT_SHIFT})));
+  ASSERT_TRUE (angle_set.may_match (make_stream ({RIGHT_SHIFT_EQ})));
+  ASSERT_TRUE (angle_set.may_match (make_stream ({GREATER_OR_EQUAL})));
+  ASSERT_FALSE (angle_set.may_match (make_stream ({LEFT_SHIFT})));
+
+  auto empty = make_stream ({});
+  ASSERT_FALSE (token_set.may_match (empty));
+  ASSERT_TRUE (rep_set.may_match (empty));
+  ASSERT_TRUE (tt_set.may_match (empty));
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,70 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_MACRO_FIRST_SET_H
+#define RUST_MACRO_FIRST_SET_H
+
+#include "rust-system.h"
+#include "rust-ast.h"
+#include "rust-macro.h"
+
+namespace Rust {
+
+/**
+ * The tokens the matcher of a `macro_rules!` arm can start with. This is an
+ * over-approximation: an arm whose first set does not contain the first token
+ * of an invocation cannot match it, but an arm whose first set does may still
+ * fail to match.
+ *
+ * Fragments other than `block` can start with too many different tokens to
+ * be worth tracking, so they make the arm accept any token.
+ */
+class MacroFirstSet
+{
+public:
+  // Compute the first set of the matcher of a macro arm. The delimiters of
+  // that matcher are not matched against the invocation and are ignored.
+  static MacroFirstSet compute (const AST::MacroMatcher &matcher);
+
+  /* Can the arm match STREAM, the token stream of an invocation's delimited
+     token tree (delimiters included) ?  */
+  bool may_match (const std::vector<std::unique_ptr<AST::Token>> &stream) const;
+
+private:
+  MacroFirstSet () : tokens (), any_token (false), can_be_empty (false) {}
+
+  bool add_sequence (const std::vector<std::unique_ptr<AST::MacroMatch>> &seq);
+  bool add_match (const AST::MacroMatch &match);
+
+  std::array<bool, LAST_TOKEN + 1> tokens;
+  bool any_token;
+  bool can_be_empty;
+};
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_macro_first_set_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_MACRO_FIRST_SET_H
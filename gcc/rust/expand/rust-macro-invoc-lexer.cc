@@ -24,15 +24,32 @@ namespace Rust {
 const_TokenPtr
 MacroInvocLexer::peek_token (int n)
 {
-  if ((offs + n) >= token_stream.size ())
+  auto &tokens = get_tokens ();
+  if ((offs + n) >= tokens.size ())
     return Token::make (END_OF_FILE, UNDEF_LOCATION);
 
-  return token_stream.at (offs + n)->get_tok_ptr ();
+  return tokens.at (offs + n)->get_tok_ptr ();
+}
+
+void
+MacroInvocLexer::unshare ()
+{
+  if (shared_stream == nullptr)
+    return;
+
+  token_stream.reserve (shared_stream->size ());
+  for (auto &tok : *shared_stream)
+    token_stream.emplace_back (tok->clone_token ());
+
+  shared_stream = nullptr;
 }
 
 void
 MacroInvocLexer::split_current_token (TokenId new_left, TokenId new_right)
 {
+  unshare ();
+  closing_delimiters.clear ();
+
   auto &current_token = token_stream.at (offs);
   auto current_pos = token_stream.begin () + offs;
 
@@ -54,6 +71,8 @@ MacroInvocLexer::split_current_token (std::vector<TokenPtr> new_tokens)
 {
   rust_assert (new_tokens.size () > 0);
 
+  unshare ();
+  closing_delimiters.clear ();
   auto current_pos = token_stream.begin () + offs;
 
   token_stream.erase (current_pos);
@@ -70,12 +89,76 @@ MacroInvocLexer::get_token_slice (size_t start_idx, size_t end_idx) const
 {
   std::vector<std::unique_ptr<AST::Token>> slice;
 
-  rust_assert (end_idx < token_stream.size ());
+  auto &tokens = get_tokens ();
+  rust_assert (end_idx < tokens.size ());
 
   for (size_t i = start_idx; i < end_idx; i++)
-    slice.emplace_back (token_stream[i]->clone_token ());
+    slice.emplace_back (tokens[i]->clone_token ());
 
   return slice;
 }
 
+// The delimiter closing the opening delimiter ID
+static TokenId
+closing_delimiter (TokenId id)
+{
+  switch (id)
+    {
+    case LEFT_PAREN:
+      return RIGHT_PAREN;
+    case LEFT_SQUARE:
+      return RIGHT_SQUARE;
+    case LEFT_CURLY:
+      return RIGHT_CURLY;
+    default:
+      rust_unreachable ();
+    }
+}
+
+tl::optional<size_t>
+MacroInvocLexer::get_group_length (int n) const
+{
+  auto &tokens = get_tokens ();
+  size_t start = offs + n;
+  if (start >= tokens.size ())
+    return tl::nullopt;
+
+  // match all the delimiters of the stream in one pass, so that skipping any
+  // number of groups afterwards is linear in the size of the stream
+  if (closing_delimiters.size () != tokens.size ())
+    {
+      closing_delimiters.assign (tokens.size (), 0);
+
+      std::vector<size_t> open;
+      for (size_t i = 0; i < tokens.size (); i++)
+	switch (tokens[i]->get_id ())
+	  {
+	  case LEFT_PAREN:
+	  case LEFT_SQUARE:
+	  case LEFT_CURLY:
+	    open.push_back (i);
+	    break;
+	  case RIGHT_PAREN:
+	  case RIGHT_SQUARE:
+	  case RIGHT_CURLY:
+	    if (open.empty ())
+	      break;
+	    // a mismatched pair stays unmatched
+	    if (closing_delimiter (tokens[open.back ()]->get_id ())
+		== tokens[i]->get_id ())
+	      closing_delimiters[open.back ()] = i;
+	    open.pop_back ();
+	    break;
+	  default:
+	    break;
+	  }
+    }
+
+  size_t close = closing_delimiters[start];
+  if (close == 0)
+    return tl::nullopt;
+
+  return close - start + 1;
+}
+
 } // namespace Rust
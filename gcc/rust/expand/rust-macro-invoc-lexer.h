@@ -20,6 +20,7 @@
 #define RUST_MACRO_INVOC_LEXER_H
 
 #include "rust-ast.h"
+#include "optional.h"
 
 namespace Rust {
 template <class T> class MacroInvocLexerBase
@@ -45,6 +46,13 @@ public:
   size_t get_offs () const { return offs; }
 
 protected:
+  // Start over on a new stream
+  void reset (std::vector<T> stream)
+  {
+    offs = 0;
+    token_stream = std::move (stream);
+  }
+
   size_t offs;
   std::vector<T> token_stream;
 };
@@ -52,10 +60,37 @@ protected:
 class MacroInvocLexer : public MacroInvocLexerBase<std::unique_ptr<AST::Token>>
 {
 public:
-  MacroInvocLexer (std::vector<std::unique_ptr<AST::Token>> stream)
-    : MacroInvocLexerBase (std::move (stream))
+  MacroInvocLexer (std::vector<std::unique_ptr<AST::Token>> &&stream)
+    : MacroInvocLexerBase (std::move (stream)), shared_stream (nullptr)
+  {}
+
+  // Lex a stream owned by someone else, which must outlive the lexer. The
+  // tokens are only copied if one of them has to be split.
+  MacroInvocLexer (const std::vector<std::unique_ptr<AST::Token>> &stream)
+    : MacroInvocLexerBase (std::vector<std::unique_ptr<AST::Token>> ()),
+      shared_stream (&stream)
   {}
 
+  // Start over on a new stream, so that one lexer can be reused for many
+  // fragments. The overloads take the stream like the constructors do.
+  void reset (std::vector<std::unique_ptr<AST::Token>> &&stream)
+  {
+    MacroInvocLexerBase::reset (std::move (stream));
+    shared_stream = nullptr;
+    closing_delimiters.clear ();
+  }
+
+  // Starting over on the same shared stream, as when trying every arm of a
+  // macro on one invocation, keeps its delimiter table.
+  void reset (const std::vector<std::unique_ptr<AST::Token>> &stream)
+  {
+    if (&stream != shared_stream)
+      closing_delimiters.clear ();
+
+    MacroInvocLexerBase::reset (std::vector<std::unique_ptr<AST::Token>> ());
+    shared_stream = &stream;
+  }
+
   // Returns token n tokens ahead of current position.
   const_TokenPtr peek_token (int n);
 
@@ -71,6 +106,25 @@ public:
 
   std::vector<std::unique_ptr<AST::Token>>
   get_token_slice (size_t start_idx, size_t end_idx) const;
+
+  // The number of tokens of the delimited group opened by the token n tokens
+  // ahead of current position, if it opens one that the stream closes.
+  tl::optional<size_t> get_group_length (int n) const;
+
+private:
+  const std::vector<std::unique_ptr<AST::Token>> &get_tokens () const
+  {
+    return shared_stream != nullptr ? *shared_stream : token_stream;
+  }
+
+  // Take a copy of the shared stream before modifying it
+  void unshare ();
+
+  const std::vector<std::unique_ptr<AST::Token>> *shared_stream;
+
+  // The index of the delimiter closing each opening delimiter of the stream,
+  // zero for the other tokens. Built on demand by get_group_length.
+  mutable std::vector<size_t> closing_delimiters;
 };
 } // namespace Rust
 
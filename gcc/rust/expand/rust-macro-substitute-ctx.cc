@@ -22,7 +22,7 @@ namespace Rust {
 
 bool
 SubstituteCtx::substitute_metavar (
-  std::unique_ptr<AST::Token> &metavar,
+  const std::unique_ptr<AST::Token> &metavar,
   std::vector<std::unique_ptr<AST::Token>> &expanded)
 {
   auto metavar_name = metavar->get_str ();
@@ -206,7 +206,7 @@ SubstituteCtx::substitute_repetition (
 }
 
 static bool
-is_rep_op (std::unique_ptr<AST::Token> &tok)
+is_rep_op (const std::unique_ptr<AST::Token> &tok)
 {
   auto id = tok->get_id ();
   return id == QUESTION_MARK || id == ASTERISK || id == PLUS;
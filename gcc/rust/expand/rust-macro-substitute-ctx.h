@@ -22,8 +22,8 @@
 namespace Rust {
 class SubstituteCtx
 {
-  std::vector<std::unique_ptr<AST::Token>> &input;
-  std::vector<std::unique_ptr<AST::Token>> &macro;
+  const std::vector<std::unique_ptr<AST::Token>> &input;
+  const std::vector<std::unique_ptr<AST::Token>> &macro;
   std::map<std::string, MatchedFragmentContainer *> &fragments;
 
   /**
@@ -38,8 +38,8 @@ class SubstituteCtx
 				size_t &repeat_amount);
 
 public:
-  SubstituteCtx (std::vector<std::unique_ptr<AST::Token>> &input,
-		 std::vector<std::unique_ptr<AST::Token>> &macro,
+  SubstituteCtx (const std::vector<std::unique_ptr<AST::Token>> &input,
+		 const std::vector<std::unique_ptr<AST::Token>> &macro,
 		 std::map<std::string, MatchedFragmentContainer *> &fragments)
     : input (input), macro (macro), fragments (fragments)
   {}
@@ -54,7 +54,7 @@ public:
    *
    * @return True iff the substitution succeeded
    */
-  bool substitute_metavar (std::unique_ptr<AST::Token> &metavar,
+  bool substitute_metavar (const std::unique_ptr<AST::Token> &metavar,
 			   std::vector<std::unique_ptr<AST::Token>> &expanded);
 
   /**
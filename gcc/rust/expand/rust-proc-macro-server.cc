@@ -0,0 +1,818 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-proc-macro-server.h"
+#include "rust-proc-macro-wire.h"
+#include "rust-proc-macro.h"
+#include "rust-diagnostics.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <signal.h>
+#endif
+
+namespace Rust {
+namespace ProcMacroServer {
+
+#ifndef _WIN32
+
+namespace {
+
+/* Every message is its kind, the 32-bit size of its payload, then the
+   payload, whose parts are encoded by ProcMacroWire.  */
+
+enum MessageKind : uint8_t
+{
+  // compiler to worker
+
+  // library, path
+  LOAD,
+  // library, index, input stream, attribute flag, attribute stream
+  EXPAND,
+  // success flag, stream
+  LEXED,
+
+  // worker to compiler
+
+  // error kind, error symbol, number of macros, then for each of them its
+  // tag and name, and the attributes of custom derives
+  LOADED,
+  // stream
+  EXPANDED,
+  // source, answered by LEXED
+  LEX,
+  // source, answered by LEXED with a single literal
+  LEX_LITERAL,
+};
+
+#ifdef MSG_NOSIGNAL
+// a worker exiting must not kill the compiler with SIGPIPE
+const int send_flags = MSG_NOSIGNAL;
+#else
+const int send_flags = 0;
+#endif
+
+bool
+write_all (int fd, const char *data, size_t size)
+{
+  while (size > 0)
+    {
+      ssize_t written = send (fd, data, size, send_flags);
+      if (written < 0 && errno == EINTR)
+	continue;
+      if (written <= 0)
+	return false;
+
+      data += written;
+      size -= written;
+    }
+
+  return true;
+}
+
+bool
+read_all (int fd, char *data, size_t size)
+{
+  while (size > 0)
+    {
+      ssize_t count = read (fd, data, size);
+      if (count < 0 && errno == EINTR)
+	continue;
+      if (count <= 0)
+	return false;
+
+      data += count;
+      size -= count;
+    }
+
+  return true;
+}
+
+bool
+send_message (int fd, MessageKind kind, const std::string &payload)
+{
+  std::string header;
+  ProcMacroWire::write_u8 (header, kind);
+  ProcMacroWire::write_u32 (header, payload.size ());
+
+  return write_all (fd, header.data (), header.size ())
+	 && write_all (fd, payload.data (), payload.size ());
+}
+
+bool
+receive_message (int fd, MessageKind &kind, std::string &payload)
+{
+  char header[5];
+  if (!read_all (fd, header, sizeof (header)))
+    return false;
+
+  ProcMacroWire::Decoder decoder (header, sizeof (header));
+  uint8_t tag;
+  uint32_t size;
+  decoder.read_u8 (tag);
+  decoder.read_u32 (size);
+
+  kind = static_cast<MessageKind> (tag);
+  payload.resize (size);
+  return read_all (fd, &payload[0], size);
+}
+
+void
+prepare_socket (int fd)
+{
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt (fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof (on));
+#endif
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+}
+
+// Pass the descriptor SOCKET over to the other end of FD
+bool
+send_socket (int fd, int socket)
+{
+  char byte = 0;
+  struct iovec iov = {&byte, 1};
+
+  union
+  {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE (sizeof (int))];
+  } control;
+  memset (&control, 0, sizeof (control));
+
+  struct msghdr message = {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof (control.buffer);
+
+  struct cmsghdr *header = CMSG_FIRSTHDR (&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (header), &socket, sizeof (int));
+
+  ssize_t sent;
+  do
+    sent = sendmsg (fd, &message, send_flags);
+  while (sent < 0 && errno == EINTR);
+
+  return sent == 1;
+}
+
+// The descriptor passed over FD by send_socket, or -1
+int
+receive_socket (int fd)
+{
+  char byte;
+  struct iovec iov = {&byte, 1};
+
+  union
+  {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE (sizeof (int))];
+  } control;
+
+  struct msghdr message = {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof (control.buffer);
+
+  ssize_t received;
+  do
+    received = recvmsg (fd, &message, 0);
+  while (received < 0 && errno == EINTR);
+
+  struct cmsghdr *header = CMSG_FIRSTHDR (&message);
+  if (received != 1 || header == nullptr || header->cmsg_level != SOL_SOCKET
+      || header->cmsg_type != SCM_RIGHTS)
+    return -1;
+
+  int socket;
+  memcpy (&socket, CMSG_DATA (header), sizeof (int));
+  prepare_socket (socket);
+  return socket;
+}
+
+/* The worker side. Anything going wrong with the compiler, which is then
+   gone or confused, ends the worker.  */
+
+// The socket to the compiler
+int compiler = -1;
+
+// The libraries loaded by the worker, by identifier
+std::unordered_map<uint32_t, const ProcMacro::ProcmacroArray *>
+  worker_libraries;
+
+// Ask the compiler to lex SOURCE into STREAM, with a request of KIND
+bool
+remote_lex (MessageKind kind, const std::string &source,
+	    ProcMacro::TokenStream &stream)
+{
+  std::string payload;
+  ProcMacroWire::write_string (payload, source);
+
+  MessageKind reply;
+  if (!send_message (compiler, kind, payload)
+      || !receive_message (compiler, reply, payload) || reply != LEXED)
+    _exit (1);
+
+  ProcMacroWire::Decoder decoder (payload.data (), payload.size ());
+  uint8_t success;
+  if (!decoder.read_u8 (success) || !decoder.read_stream (stream))
+    _exit (1);
+
+  return success;
+}
+
+ProcMacro::TokenStream
+remote_tokenstream_from_string (std::string &data, bool &lex_error)
+{
+  ProcMacro::TokenStream stream;
+  lex_error = !remote_lex (LEX, data, stream);
+
+  return stream;
+}
+
+ProcMacro::Literal
+remote_literal_from_string (const std::string &data, bool &error)
+{
+  ProcMacro::TokenStream stream;
+  error = !remote_lex (LEX_LITERAL, data, stream) || stream.size != 1
+	  || stream.data[0].tag != ProcMacro::LITERAL;
+  if (error)
+    return ProcMacro::Literal::make_usize (0);
+
+  return stream.data[0].payload.literal;
+}
+
+void
+serve_load (ProcMacroWire::Decoder &request)
+{
+  uint32_t library;
+  std::string path;
+  if (!request.read_u32 (library) || !request.read_string (path)
+      || !request.at_end ())
+    _exit (1);
+
+  ProcMacroLibraryError error;
+  auto array
+    = open_proc_macro_library (path, remote_tokenstream_from_string,
+			       remote_literal_from_string, error);
+  worker_libraries[library] = array;
+
+  std::string reply;
+  ProcMacroWire::write_u8 (reply, error.kind);
+  ProcMacroWire::write_string (reply, error.symbol);
+  ProcMacroWire::write_u32 (reply, array == nullptr ? 0 : array->length);
+  for (uint32_t i = 0; array != nullptr && i < array->length; i++)
+    {
+      auto &macro = array->macros[i];
+      ProcMacroWire::write_u8 (reply, macro.tag);
+      switch (macro.tag)
+	{
+	  case ProcMacro::CUSTOM_DERIVE: {
+	    auto &derive = macro.payload.custom_derive;
+	    ProcMacroWire::write_string (reply, derive.trait_name);
+	    ProcMacroWire::write_u32 (reply, derive.attr_size);
+	    for (std::uint64_t j = 0; j < derive.attr_size; j++)
+	      ProcMacroWire::write_string (reply, derive.attributes[j]);
+	    break;
+	  }
+	case ProcMacro::ATTR:
+	  ProcMacroWire::write_string (reply, macro.payload.attribute.name);
+	  break;
+	case ProcMacro::BANG:
+	  ProcMacroWire::write_string (reply, macro.payload.bang.name);
+	  break;
+	}
+    }
+
+  if (!send_message (compiler, LOADED, reply))
+    _exit (1);
+}
+
+void
+serve_expand (ProcMacroWire::Decoder &request)
+{
+  // everything exchanged with the macro is dead once its output is sent
+  ProcMacro::Arena arena;
+  ProcMacro::Arena::Scope arena_scope (arena);
+
+  uint32_t library, index;
+  uint8_t has_attribute;
+  ProcMacro::TokenStream input;
+  auto attribute = ProcMacro::TokenStream::make_tokenstream ();
+  if (!request.read_u32 (library) || !request.read_u32 (index)
+      || !request.read_stream (input) || !request.read_u8 (has_attribute)
+      || (has_attribute && !request.read_stream (attribute))
+      || !request.at_end ())
+    _exit (1);
+
+  auto found = worker_libraries.find (library);
+  if (found == worker_libraries.end () || found->second == nullptr
+      || index >= found->second->length)
+    _exit (1);
+
+  auto &macro = found->second->macros[index];
+  ProcMacro::TokenStream output;
+  switch (macro.tag)
+    {
+    case ProcMacro::CUSTOM_DERIVE:
+      output = macro.payload.custom_derive.macro (input);
+      break;
+    case ProcMacro::ATTR:
+      output = macro.payload.attribute.macro (attribute, input);
+      break;
+    case ProcMacro::BANG:
+      output = macro.payload.bang.macro (input);
+      break;
+    default:
+      _exit (1);
+    }
+
+  std::string reply;
+  ProcMacroWire::write_stream (reply, output);
+  if (!send_message (compiler, EXPANDED, reply))
+    _exit (1);
+}
+
+[[noreturn]] void
+worker_main (int fd)
+{
+  compiler = fd;
+
+  // the socket carries the protocol, what the macros print goes to stderr
+  dup2 (STDERR_FILENO, STDOUT_FILENO);
+
+  MessageKind kind;
+  std::string payload;
+  while (receive_message (compiler, kind, payload))
+    {
+      ProcMacroWire::Decoder request (payload.data (), payload.size ());
+      switch (kind)
+	{
+	case LOAD:
+	  serve_load (request);
+	  break;
+	case EXPAND:
+	  serve_expand (request);
+	  break;
+	default:
+	  _exit (1);
+	}
+    }
+
+  _exit (0);
+}
+
+/* The zygote forks a worker for each byte it reads, and passes the socket
+   to the worker back. It exits with the compiler, closing its socket, and
+   the workers do the same.  */
+
+[[noreturn]] void
+zygote_main (int fd)
+{
+  // nobody waits for the workers
+  signal (SIGCHLD, SIG_IGN);
+
+  char request;
+  while (read_all (fd, &request, 1))
+    {
+      int sockets[2];
+      if (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+	break;
+
+      pid_t pid = fork ();
+      if (pid == 0)
+	{
+	  close (fd);
+	  close (sockets[0]);
+	  worker_main (sockets[1]);
+	}
+
+      close (sockets[1]);
+      bool sent = pid > 0 && send_socket (fd, sockets[0]);
+      close (sockets[0]);
+      if (!sent)
+	break;
+    }
+
+  _exit (0);
+}
+
+/* The compiler side.  */
+
+struct Worker
+{
+  int socket;
+  // The libraries the worker has loaded
+  std::set<uint32_t> libraries;
+};
+
+struct Library
+{
+  std::string path;
+  std::vector<ProcMacro::Procmacro> macros;
+  // The names and attributes the descriptions in MACROS point to
+  std::deque<std::string> strings;
+  std::deque<std::vector<const char *>> attributes;
+};
+
+bool server_started = false;
+
+// The socket to the zygote, or -1 once it is gone
+int zygote = -1;
+
+// Everything below is guarded by the mutex, as custom derives may be expanded
+// from several threads
+std::mutex pool_mutex;
+std::condition_variable pool_changed;
+std::vector<Worker> idle_workers;
+size_t worker_count = 0;
+size_t max_workers = 1;
+
+std::vector<std::unique_ptr<Library>> libraries;
+// The libraries loaded so far, or failed to, by canonical path
+std::unordered_map<std::string, tl::optional<uint32_t>> library_ids;
+
+// Take an idle worker, or the new one of the zygote, waiting for one of the
+// busy workers when there are already max_workers of them
+tl::optional<Worker>
+acquire_worker ()
+{
+  std::unique_lock<std::mutex> lock (pool_mutex);
+  while (true)
+    {
+      if (!idle_workers.empty ())
+	{
+	  Worker worker = std::move (idle_workers.back ());
+	  idle_workers.pop_back ();
+	  return worker;
+	}
+
+      if (worker_count < max_workers && zygote >= 0)
+	{
+	  char request = 0;
+	  int socket = write_all (zygote, &request, 1)
+			 ? receive_socket (zygote)
+			 : -1;
+	  if (socket >= 0)
+	    {
+	      worker_count++;
+	      return Worker {socket, {}};
+	    }
+
+	  close (zygote);
+	  zygote = -1;
+	}
+
+      if (worker_count == 0)
+	return tl::nullopt;
+
+      pool_changed.wait (lock);
+    }
+}
+
+void
+release_worker (Worker &&worker, bool alive)
+{
+  std::lock_guard<std::mutex> lock (pool_mutex);
+  if (alive)
+    idle_workers.push_back (std::move (worker));
+  else
+    {
+      close (worker.socket);
+      worker_count--;
+    }
+
+  pool_changed.notify_one ();
+}
+
+// Answer the lexing request of a macro running on a worker
+std::string
+lex (MessageKind kind, const std::string &request)
+{
+  ProcMacroWire::Decoder decoder (request.data (), request.size ());
+  std::string source;
+  bool error = !decoder.read_string (source) || !decoder.at_end ();
+
+  auto stream = ProcMacro::TokenStream::make_tokenstream ();
+  if (!error && kind == LEX)
+    {
+      auto tokens = tokenstream_from_string (source, error);
+      if (!error)
+	stream = tokens;
+    }
+  else if (!error)
+    {
+      auto literal = literal_from_string (source, error);
+      if (!error)
+	stream.push (ProcMacro::TokenTree::make_tokentree (literal));
+    }
+
+  std::string reply;
+  ProcMacroWire::write_u8 (reply, !error);
+  ProcMacroWire::write_stream (reply, stream);
+  return reply;
+}
+
+// Send REQUEST to WORKER and answer its lexing requests until it replies with
+// EXPECTED, whose payload is left in REPLY. Returns false when the worker is
+// gone or replied with something else.
+bool
+transact (Worker &worker, MessageKind request, const std::string &payload,
+	  MessageKind expected, std::string &reply)
+{
+  if (!send_message (worker.socket, request, payload))
+    return false;
+
+  MessageKind kind;
+  while (receive_message (worker.socket, kind, reply))
+    {
+      if (kind == expected)
+	return true;
+      if (kind != LEX && kind != LEX_LITERAL)
+	return false;
+      if (!send_message (worker.socket, LEXED, lex (kind, reply)))
+	return false;
+    }
+
+  return false;
+}
+
+// Have WORKER load LIBRARY, and record the description of its macros in it
+// when asked to. Returns false when the worker is gone.
+bool
+load_library (Worker &worker, uint32_t id, const std::string &path,
+	      ProcMacroLibraryError &error, Library *library)
+{
+  std::string payload, reply;
+  ProcMacroWire::write_u32 (payload, id);
+  ProcMacroWire::write_string (payload, path);
+  if (!transact (worker, LOAD, payload, LOADED, reply))
+    return false;
+
+  ProcMacroWire::Decoder decoder (reply.data (), reply.size ());
+  uint8_t kind;
+  uint32_t count;
+  if (!decoder.read_u8 (kind) || kind > ProcMacroLibraryError::MISSING_CALLBACK
+      || !decoder.read_string (error.symbol) || !decoder.read_u32 (count))
+    return false;
+
+  error.kind = static_cast<ProcMacroLibraryError::Kind> (kind);
+  if (error.kind != ProcMacroLibraryError::NONE)
+    return true;
+
+  worker.libraries.insert (id);
+  for (uint32_t i = 0; library != nullptr && i < count; i++)
+    {
+      uint8_t tag;
+      std::string name;
+      if (!decoder.read_u8 (tag) || tag > ProcMacro::BANG
+	  || !decoder.read_string (name))
+	return false;
+
+      library->strings.push_back (name);
+      const char *name_str = library->strings.back ().c_str ();
+
+      ProcMacro::ProcmacroPayload macro;
+      switch (tag)
+	{
+	  case ProcMacro::CUSTOM_DERIVE: {
+	    uint32_t attr_size;
+	    if (!decoder.read_u32 (attr_size))
+	      return false;
+
+	    library->attributes.emplace_back ();
+	    for (uint32_t j = 0; j < attr_size; j++)
+	      {
+		std::string attribute;
+		if (!decoder.read_string (attribute))
+		  return false;
+
+		library->strings.push_back (attribute);
+		library->attributes.back ().push_back (
+		  library->strings.back ().c_str ());
+	      }
+
+	    macro.custom_derive
+	      = {name_str, library->attributes.back ().data (), attr_size,
+		 nullptr};
+	    break;
+	  }
+	case ProcMacro::ATTR:
+	  macro.attribute = {name_str, nullptr};
+	  break;
+	case ProcMacro::BANG:
+	  macro.bang = {name_str, nullptr};
+	  break;
+	}
+
+      library->macros.push_back (
+	{static_cast<ProcMacro::ProcmacroTag> (tag), macro});
+    }
+
+  return library == nullptr || decoder.at_end ();
+}
+
+} // namespace
+
+bool
+enabled ()
+{
+  return server_started;
+}
+
+void
+start (size_t workers)
+{
+  int sockets[2];
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    {
+      rust_error_at (UNDEF_LOCATION,
+		     "cannot start the procedural macro server: %m");
+      return;
+    }
+
+  // what is buffered must not be written again by the zygote
+  fflush (stdout);
+  fflush (stderr);
+
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      close (sockets[0]);
+      zygote_main (sockets[1]);
+    }
+
+  close (sockets[1]);
+  if (pid < 0)
+    {
+      close (sockets[0]);
+      rust_error_at (UNDEF_LOCATION,
+		     "cannot start the procedural macro server: %m");
+      return;
+    }
+
+  prepare_socket (sockets[0]);
+  zygote = sockets[0];
+  max_workers = std::max<size_t> (workers, 1);
+  server_started = true;
+}
+
+tl::optional<uint32_t>
+load (const std::string &path, std::vector<ProcMacro::Procmacro> &macros)
+{
+  char *real_path = lrealpath (path.c_str ());
+  std::string key (real_path);
+  free (real_path);
+
+  {
+    std::lock_guard<std::mutex> lock (pool_mutex);
+    auto loaded = library_ids.find (key);
+    if (loaded != library_ids.end ())
+      {
+	if (loaded->second)
+	  macros = libraries[*loaded->second]->macros;
+	return loaded->second;
+      }
+  }
+
+  std::unique_ptr<Library> library (new Library {path, {}, {}, {}});
+  uint32_t id;
+  {
+    std::lock_guard<std::mutex> lock (pool_mutex);
+    id = libraries.size ();
+  }
+
+  auto worker = acquire_worker ();
+  if (!worker)
+    {
+      rust_error_at (UNDEF_LOCATION,
+		     "cannot load procedural macro library %qs: no worker of "
+		     "the procedural macro server is left",
+		     path.c_str ());
+      return tl::nullopt;
+    }
+
+  ProcMacroLibraryError error;
+  bool alive = load_library (*worker, id, path, error, library.get ());
+  release_worker (std::move (*worker), alive);
+
+  tl::optional<uint32_t> result = tl::nullopt;
+  if (!alive)
+    rust_error_at (UNDEF_LOCATION,
+		   "procedural macro library %qs crashed the process loading it",
+		   path.c_str ());
+  else if (error.kind != ProcMacroLibraryError::NONE)
+    report_proc_macro_library_error (path, error);
+  else
+    result = id;
+
+  std::lock_guard<std::mutex> lock (pool_mutex);
+  if (result)
+    {
+      macros = library->macros;
+      libraries.push_back (std::move (library));
+    }
+  library_ids.emplace (key, result);
+
+  return result;
+}
+
+tl::optional<ProcMacro::TokenStream>
+expand (Macro macro, const ProcMacro::TokenStream &input,
+	const ProcMacro::TokenStream *attribute)
+{
+  auto worker = acquire_worker ();
+  if (!worker)
+    return tl::nullopt;
+
+  // the workers load the libraries the first time they are used on them
+  bool alive = true;
+  if (worker->libraries.count (macro.library) == 0)
+    {
+      std::string path;
+      {
+	std::lock_guard<std::mutex> lock (pool_mutex);
+	path = libraries[macro.library]->path;
+      }
+
+      ProcMacroLibraryError error;
+      alive = load_library (*worker, macro.library, path, error, nullptr)
+	      && error.kind == ProcMacroLibraryError::NONE;
+    }
+
+  std::string payload, reply;
+  ProcMacroWire::write_u32 (payload, macro.library);
+  ProcMacroWire::write_u32 (payload, macro.index);
+  ProcMacroWire::write_stream (payload, input);
+  ProcMacroWire::write_u8 (payload, attribute != nullptr);
+  if (attribute != nullptr)
+    ProcMacroWire::write_stream (payload, *attribute);
+
+  alive = alive && transact (*worker, EXPAND, payload, EXPANDED, reply);
+
+  tl::optional<ProcMacro::TokenStream> output = tl::nullopt;
+  if (alive)
+    {
+      ProcMacroWire::Decoder decoder (reply.data (), reply.size ());
+      ProcMacro::TokenStream stream;
+      alive = decoder.read_stream (stream) && decoder.at_end ();
+      if (alive)
+	output = stream;
+    }
+
+  release_worker (std::move (*worker), alive);
+  return output;
+}
+
+#else
+
+bool
+enabled ()
+{
+  return false;
+}
+
+void
+start (size_t)
+{
+  rust_sorry_at (UNDEF_LOCATION,
+		 "the procedural macro server is not supported on this host");
+}
+
+tl::optional<uint32_t>
+load (const std::string &, std::vector<ProcMacro::Procmacro> &)
+{
+  rust_unreachable ();
+}
+
+tl::optional<ProcMacro::TokenStream>
+expand (Macro, const ProcMacro::TokenStream &, const ProcMacro::TokenStream *)
+{
+  rust_unreachable ();
+}
+
+#endif
+
+} // namespace ProcMacroServer
+} // namespace Rust
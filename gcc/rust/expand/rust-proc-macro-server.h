@@ -0,0 +1,81 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_PROC_MACRO_SERVER_H
+#define RUST_PROC_MACRO_SERVER_H
+
+#include "rust-system.h"
+#include "optional.h"
+#include "libproc_macro_internal/proc_macro.h"
+
+namespace Rust {
+
+/**
+ * With -frust-proc-macro-server, the procedural macro libraries are not
+ * loaded into the compiler but into worker processes, which run the macros
+ * on its behalf. A macro crashing or corrupting memory then only takes its
+ * worker down, and invocations made from several threads, such as the custom
+ * derives of an item, each run in a process of their own.
+ *
+ * The workers are forked on demand by a zygote, which `start` forks before
+ * the compiler creates any thread, and which hands the socket of each new
+ * worker over to the compiler. The compiler and the workers exchange the
+ * messages of ProcMacroWire. The callbacks through which the macros lex
+ * strings are forwarded back to the compiler, so that the tokens they create
+ * have locations in its line map.
+ *
+ * The server lives as long as the compiler: it is not shared between the
+ * invocations of a build.
+ */
+namespace ProcMacroServer {
+
+// An entrypoint of a library loaded through the server
+struct Macro
+{
+  uint32_t library;
+  uint32_t index;
+};
+
+// Is the proc macro server in use?
+bool
+enabled ();
+
+// Fork the zygote of up to WORKERS workers, before any thread is started
+void
+start (size_t workers);
+
+/**
+ * Load the library at PATH, and describe its entrypoints in MACROS, with
+ * null functions. Returns the identifier of the library, or nullopt when
+ * PATH is not a procedural macro library.
+ */
+tl::optional<uint32_t>
+load (const std::string &path, std::vector<ProcMacro::Procmacro> &macros);
+
+/**
+ * Run MACRO over INPUT on an idle worker, with the arguments ATTRIBUTE if it
+ * is an attribute macro. Returns nullopt when the worker exited instead.
+ */
+tl::optional<ProcMacro::TokenStream>
+expand (Macro macro, const ProcMacro::TokenStream &input,
+	const ProcMacro::TokenStream *attribute = nullptr);
+
+} // namespace ProcMacroServer
+} // namespace Rust
+
+#endif // RUST_PROC_MACRO_SERVER_H
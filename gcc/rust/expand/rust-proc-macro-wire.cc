@@ -0,0 +1,436 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-proc-macro-wire.h"
+#include "selftest.h"
+
+namespace Rust {
+namespace ProcMacroWire {
+
+void
+write_u8 (std::string &out, uint8_t value)
+{
+  out += static_cast<char> (value);
+}
+
+void
+write_u32 (std::string &out, uint32_t value)
+{
+  out += static_cast<char> (value & 0xff);
+  out += static_cast<char> ((value >> 8) & 0xff);
+  out += static_cast<char> ((value >> 16) & 0xff);
+  out += static_cast<char> ((value >> 24) & 0xff);
+}
+
+static void
+write_string (std::string &out, const ProcMacro::FFIString &str)
+{
+  rust_assert (str.len <= UINT32_MAX);
+  write_u32 (out, str.len);
+  out.append (reinterpret_cast<const char *> (str.data), str.len);
+}
+
+void
+write_string (std::string &out, const std::string &str)
+{
+  rust_assert (str.size () <= UINT32_MAX);
+  write_u32 (out, str.size ());
+  out += str;
+}
+
+static void
+write_span (std::string &out, ProcMacro::Span span)
+{
+  write_u32 (out, span.start);
+  write_u32 (out, span.end);
+}
+
+void
+write_stream (std::string &out, const ProcMacro::TokenStream &stream)
+{
+  rust_assert (stream.size <= UINT32_MAX);
+  write_u32 (out, stream.size);
+
+  for (std::uint64_t i = 0; i < stream.size; i++)
+    {
+      auto &tree = stream.data[i];
+      write_u8 (out, tree.tag);
+      switch (tree.tag)
+	{
+	  case ProcMacro::GROUP: {
+	    auto &group = tree.payload.group;
+	    write_u8 (out, group.delimiter);
+	    write_span (out, group.span);
+	    write_stream (out, group.stream);
+	    break;
+	  }
+	  case ProcMacro::IDENT: {
+	    auto &ident = tree.payload.ident;
+	    write_u8 (out, ident.is_raw);
+	    write_string (out, ident.value);
+	    write_span (out, ident.span);
+	    break;
+	  }
+	  case ProcMacro::PUNCT: {
+	    auto &punct = tree.payload.punct;
+	    write_u32 (out, punct.ch);
+	    write_u8 (out, punct.spacing);
+	    write_span (out, punct.span);
+	    break;
+	  }
+	  case ProcMacro::LITERAL: {
+	    auto &literal = tree.payload.literal;
+	    write_u8 (out, literal.kind.tag);
+	    // both raw kinds keep their hash count in the same byte
+	    write_u8 (out, literal.kind.tag == ProcMacro::STR_RAW
+			     ? literal.kind.payload.str_raw
+			   : literal.kind.tag == ProcMacro::BYTE_STR_RAW
+			     ? literal.kind.payload.byte_str_raw
+			     : 0);
+	    write_string (out, literal.text);
+	    write_string (out, literal.suffix);
+	    write_span (out, literal.span);
+	    break;
+	  }
+	}
+    }
+}
+
+std::string
+encode (const ProcMacro::TokenStream &stream)
+{
+  std::string out (kMagic, sizeof (kMagic));
+  write_u32 (out, kVersion);
+  write_stream (out, stream);
+
+  return out;
+}
+
+
+bool
+Decoder::read_string (ProcMacro::FFIString &str)
+{
+  uint32_t len;
+  if (!read_u32 (len) || size - pos < len)
+    return false;
+
+  str = ProcMacro::FFIString::make_ffistring (
+    reinterpret_cast<const unsigned char *> (data + pos), len);
+  pos += len;
+  return true;
+}
+
+bool
+Decoder::read_span (ProcMacro::Span &span)
+{
+  return read_u32 (span.start) && read_u32 (span.end);
+}
+
+// On failure nothing is left allocated in TREE
+bool
+Decoder::read_tree (ProcMacro::TokenTree &tree)
+{
+  uint8_t tag;
+  if (!read_u8 (tag))
+    return false;
+
+  switch (tag)
+    {
+      case ProcMacro::GROUP: {
+	uint8_t delimiter;
+	ProcMacro::Span span;
+	if (!read_u8 (delimiter) || delimiter > ProcMacro::NONE
+	    || !read_span (span))
+	  return false;
+
+	ProcMacro::TokenStream stream;
+	if (!read_stream (stream))
+	  return false;
+
+	tree = ProcMacro::TokenTree::make_tokentree (ProcMacro::Group::make_group (
+	  stream, static_cast<ProcMacro::Delimiter> (delimiter), span));
+	return true;
+      }
+
+      case ProcMacro::IDENT: {
+	uint8_t is_raw;
+	if (!read_u8 (is_raw) || is_raw > 1)
+	  return false;
+
+	ProcMacro::FFIString value;
+	if (!read_string (value))
+	  return false;
+
+	ProcMacro::Span span;
+	if (!read_span (span))
+	  {
+	    ProcMacro::FFIString::drop (&value);
+	    return false;
+	  }
+
+	tree = ProcMacro::TokenTree::make_tokentree (
+	  ProcMacro::Ident::make_ident (value, span, is_raw));
+	return true;
+      }
+
+      case ProcMacro::PUNCT: {
+	uint32_t ch;
+	uint8_t spacing;
+	ProcMacro::Span span;
+	if (!read_u32 (ch) || !read_u8 (spacing) || spacing > ProcMacro::JOINT
+	    || !read_span (span))
+	  return false;
+
+	tree = ProcMacro::TokenTree::make_tokentree (ProcMacro::Punct::make_punct (
+	  ch, span, static_cast<ProcMacro::Spacing> (spacing)));
+	return true;
+      }
+
+      case ProcMacro::LITERAL: {
+	uint8_t kind_tag, raw_hashes;
+	if (!read_u8 (kind_tag) || kind_tag > ProcMacro::BYTE_STR_RAW
+	    || !read_u8 (raw_hashes))
+	  return false;
+
+	ProcMacro::LitKind kind;
+	switch (kind_tag)
+	  {
+	  case ProcMacro::STR_RAW:
+	    kind = ProcMacro::LitKind::make_str_raw (raw_hashes);
+	    break;
+	  case ProcMacro::BYTE_STR_RAW:
+	    kind = ProcMacro::LitKind::make_byte_str_raw (raw_hashes);
+	    break;
+	  default:
+	    kind.tag = static_cast<ProcMacro::LitKindTag> (kind_tag);
+	    break;
+	  }
+
+	ProcMacro::FFIString text, suffix;
+	if (!read_string (text))
+	  return false;
+	if (!read_string (suffix))
+	  {
+	    ProcMacro::FFIString::drop (&text);
+	    return false;
+	  }
+
+	ProcMacro::Span span;
+	if (!read_span (span))
+	  {
+	    ProcMacro::FFIString::drop (&text);
+	    ProcMacro::FFIString::drop (&suffix);
+	    return false;
+	  }
+
+	tree = ProcMacro::TokenTree::make_tokentree (
+	  ProcMacro::Literal {kind, text, suffix, span});
+	return true;
+      }
+    }
+
+  return false;
+}
+
+// On failure nothing is left allocated in STREAM
+bool
+Decoder::read_stream (ProcMacro::TokenStream &stream)
+{
+  uint32_t count;
+  // every tree takes at least one byte, don't trust larger counts
+  if (!read_u32 (count) || count > size - pos)
+    return false;
+
+  stream = ProcMacro::TokenStream::make_tokenstream (
+    std::max<std::uint64_t> (count, 1));
+  for (uint32_t i = 0; i < count; i++)
+    {
+      ProcMacro::TokenTree tree;
+      if (!read_tree (tree))
+	{
+	  ProcMacro::TokenStream::drop (&stream);
+	  return false;
+	}
+      stream.push (tree);
+    }
+
+  return true;
+}
+
+bool
+Decoder::read_string (std::string &str)
+{
+  uint32_t len;
+  if (!read_u32 (len) || size - pos < len)
+    return false;
+
+  str.assign (data + pos, len);
+  pos += len;
+  return true;
+}
+
+bool
+Decoder::read_u8 (uint8_t &value)
+{
+  if (size - pos < 1)
+    return false;
+
+  value = static_cast<unsigned char> (data[pos++]);
+  return true;
+}
+
+bool
+Decoder::read_u32 (uint32_t &value)
+{
+  if (size - pos < 4)
+    return false;
+
+  const unsigned char *p = reinterpret_cast<const unsigned char *> (data + pos);
+  value = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+	  | ((uint32_t) p[3] << 24);
+  pos += 4;
+  return true;
+}
+
+tl::optional<ProcMacro::TokenStream>
+decode (const char *data, size_t size)
+{
+  if (size < sizeof (kMagic) || memcmp (data, kMagic, sizeof (kMagic)) != 0)
+    return tl::nullopt;
+
+  Decoder decoder (data + sizeof (kMagic), size - sizeof (kMagic));
+
+  uint32_t version;
+  if (!decoder.read_u32 (version) || version != kVersion)
+    return tl::nullopt;
+
+  ProcMacro::TokenStream stream;
+  if (!decoder.read_stream (stream))
+    return tl::nullopt;
+
+  if (!decoder.at_end ())
+    {
+      ProcMacro::TokenStream::drop (&stream);
+      return tl::nullopt;
+    }
+
+  return stream;
+}
+
+} // namespace ProcMacroWire
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_proc_macro_wire_test (void)
+{
+  using namespace ProcMacro;
+
+  // r#foo = $( "x" , br##"y"## ) ;
+  auto inner = TokenStream::make_tokenstream ();
+  inner.push (TokenTree::make_tokentree (
+    Literal::make_literal (LitKind::make_str (), Span::make_span (3, 6), "x")));
+  inner.push (TokenTree::make_tokentree (
+    Punct::make_punct (',', Span::make_span (6, 7))));
+  inner.push (TokenTree::make_tokentree (
+    Literal::make_literal (LitKind::make_byte_str_raw (2),
+			   Span::make_span (8, 16), "y", "u8")));
+
+  auto stream = TokenStream::make_tokenstream ();
+  stream.push (TokenTree::make_tokentree (
+    Ident::make_ident ("foo", Span::make_span (0, 5), true)));
+  stream.push (TokenTree::make_tokentree (
+    Punct::make_punct ('=', Span::make_unknown (), JOINT)));
+  stream.push (TokenTree::make_tokentree (
+    Group::make_group (inner, PARENTHESIS, Span::make_span (2, 17))));
+
+  std::string message = Rust::ProcMacroWire::encode (stream);
+  TokenStream::drop (&stream);
+
+  auto decoded
+    = Rust::ProcMacroWire::decode (message.data (), message.size ());
+  ASSERT_TRUE (decoded.has_value ());
+  ASSERT_EQ (decoded->size, 3);
+
+  auto &ident = decoded->data[0];
+  ASSERT_EQ (ident.tag, IDENT);
+  ASSERT_TRUE (ident.payload.ident.is_raw);
+  ASSERT_EQ (ident.payload.ident.value.to_string (), "foo");
+  ASSERT_EQ (ident.payload.ident.span.end, 5);
+
+  auto &punct = decoded->data[1];
+  ASSERT_EQ (punct.tag, PUNCT);
+  ASSERT_EQ (punct.payload.punct.ch, '=');
+  ASSERT_EQ (punct.payload.punct.spacing, JOINT);
+
+  auto &group = decoded->data[2];
+  ASSERT_EQ (group.tag, GROUP);
+  ASSERT_EQ (group.payload.group.delimiter, PARENTHESIS);
+  ASSERT_EQ (group.payload.group.stream.size, 3);
+
+  auto &raw = group.payload.group.stream.data[2];
+  ASSERT_EQ (raw.tag, LITERAL);
+  ASSERT_EQ (raw.payload.literal.kind.tag, BYTE_STR_RAW);
+  ASSERT_EQ (raw.payload.literal.kind.payload.byte_str_raw, 2);
+  ASSERT_EQ (raw.payload.literal.text.to_string (), "y");
+  ASSERT_EQ (raw.payload.literal.suffix.to_string (), "u8");
+  ASSERT_EQ (raw.payload.literal.span.start, 8);
+
+  // encoding is stable across a round trip
+  ASSERT_EQ (Rust::ProcMacroWire::encode (decoded.value ()), message);
+  TokenStream::drop (&decoded.value ());
+
+  // every truncation is rejected, as are trailing bytes
+  for (size_t size = 0; size < message.size (); size++)
+    ASSERT_FALSE (
+      Rust::ProcMacroWire::decode (message.data (), size).has_value ());
+  std::string trailing = message + '\0';
+  ASSERT_FALSE (
+    Rust::ProcMacroWire::decode (trailing.data (), trailing.size ())
+      .has_value ());
+
+  // the parts of the server messages read back in order
+  std::string parts;
+  Rust::ProcMacroWire::write_u8 (parts, 7);
+  Rust::ProcMacroWire::write_u32 (parts, 0x12345678);
+  Rust::ProcMacroWire::write_string (parts, "libfoo.so");
+  Rust::ProcMacroWire::write_stream (parts, TokenStream::make_tokenstream ());
+
+  Rust::ProcMacroWire::Decoder decoder (parts.data (), parts.size ());
+  uint8_t byte;
+  uint32_t word;
+  std::string path;
+  TokenStream empty;
+  ASSERT_TRUE (decoder.read_u8 (byte));
+  ASSERT_EQ (byte, 7);
+  ASSERT_TRUE (decoder.read_u32 (word));
+  ASSERT_EQ (word, 0x12345678);
+  ASSERT_TRUE (decoder.read_string (path));
+  ASSERT_EQ (path, "libfoo.so");
+  ASSERT_TRUE (decoder.read_stream (empty));
+  ASSERT_EQ (empty.size, 0);
+  ASSERT_TRUE (decoder.at_end ());
+  ASSERT_FALSE (decoder.read_u8 (byte));
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
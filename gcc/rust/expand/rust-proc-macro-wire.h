@@ -0,0 +1,108 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_PROC_MACRO_WIRE_H
+#define RUST_PROC_MACRO_WIRE_H
+
+#include "rust-system.h"
+#include "optional.h"
+#include "libproc_macro_internal/proc_macro.h"
+
+namespace Rust {
+namespace ProcMacroWire {
+
+/**
+ * Binary encoding of a proc macro bridge TokenStream, so that streams can be
+ * handed to and received from a proc macro running in another process.
+ *
+ * Tags, flags and delimiters are single bytes, every other integer is 32-bit
+ * little endian. The layout is:
+ *
+ *   message	kMagic, kVersion, then a stream
+ *   stream	number of trees, then each tree
+ *   tree	tag, then
+ *		  group    delimiter, span, stream
+ *		  ident    raw flag, string, span
+ *		  punct    character, spacing, span
+ *		  literal  kind, raw hash count, text, suffix, span
+ *   string	length, then the bytes
+ *   span	start, end
+ */
+
+static const char kMagic[4] = {'G', 'R', 'P', 'M'};
+static const uint32_t kVersion = 1;
+
+std::string
+encode (const ProcMacro::TokenStream &stream);
+
+// Decode the message in DATA into a newly allocated stream, which the caller
+// must drop. Malformed or truncated messages are rejected.
+tl::optional<ProcMacro::TokenStream>
+decode (const char *data, size_t size);
+
+// Append the parts of a larger message to OUT, such as the requests of the
+// proc macro server
+void
+write_u8 (std::string &out, uint8_t value);
+void
+write_u32 (std::string &out, uint32_t value);
+void
+write_string (std::string &out, const std::string &str);
+void
+write_stream (std::string &out, const ProcMacro::TokenStream &stream);
+
+// Read back the parts written by the functions above. Every read fails
+// rather than go past the end of the data.
+class Decoder
+{
+public:
+  Decoder (const char *data, size_t size) : data (data), size (size), pos (0)
+  {}
+
+  bool read_u8 (uint8_t &value);
+  bool read_u32 (uint32_t &value);
+  bool read_string (std::string &str);
+
+  // On failure nothing is left allocated in STREAM
+  bool read_stream (ProcMacro::TokenStream &stream);
+
+  bool at_end () const { return pos == size; }
+
+private:
+  bool read_string (ProcMacro::FFIString &str);
+  bool read_span (ProcMacro::Span &span);
+  bool read_tree (ProcMacro::TokenTree &tree);
+
+  const char *data;
+  size_t size;
+  size_t pos;
+};
+
+} // namespace ProcMacroWire
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_proc_macro_wire_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_PROC_MACRO_WIRE_H
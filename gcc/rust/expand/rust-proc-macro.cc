@@ -21,6 +21,7 @@
 #include "rust-lex.h"
 #include "rust-token-converter.h"
 #include "rust-attributes.h"
+#include "rust-thread-state.h"
 
 #ifndef _WIN32
 #include <dlfcn.h>
@@ -28,28 +29,118 @@
 
 namespace Rust {
 
-BangProcMacro::BangProcMacro (ProcMacro::Bang macro)
+BangProcMacro::BangProcMacro (ProcMacro::Bang macro,
+			      tl::optional<ProcMacroServer::Macro> remote)
   : name (macro.name), node_id (Analysis::Mappings::get ().get_next_node_id ()),
-    macro (macro.macro)
+    macro (macro.macro), remote (remote)
 {}
 
-AttributeProcMacro::AttributeProcMacro (ProcMacro::Attribute macro)
+tl::optional<ProcMacro::TokenStream>
+BangProcMacro::invoke (ProcMacro::TokenStream input) const
+{
+  if (remote)
+    return ProcMacroServer::expand (*remote, input);
+
+  return macro (input);
+}
+
+AttributeProcMacro::AttributeProcMacro (
+  ProcMacro::Attribute macro, tl::optional<ProcMacroServer::Macro> remote)
   : name (macro.name), node_id (Analysis::Mappings::get ().get_next_node_id ()),
-    macro (macro.macro)
+    macro (macro.macro), remote (remote)
 {}
 
-CustomDeriveProcMacro::CustomDeriveProcMacro (ProcMacro::CustomDerive macro)
+tl::optional<ProcMacro::TokenStream>
+AttributeProcMacro::invoke (ProcMacro::TokenStream attribute,
+			    ProcMacro::TokenStream item) const
+{
+  if (remote)
+    return ProcMacroServer::expand (*remote, item, &attribute);
+
+  return macro (attribute, item);
+}
+
+CustomDeriveProcMacro::CustomDeriveProcMacro (
+  ProcMacro::CustomDerive macro, tl::optional<ProcMacroServer::Macro> remote,
+  bool thread_safe)
   : trait_name (macro.trait_name),
     attributes (macro.attributes, macro.attributes + macro.attr_size),
     node_id (Analysis::Mappings::get ().get_next_node_id ()),
-    macro (macro.macro)
+    macro (macro.macro), remote (remote), thread_safe (thread_safe)
 {}
 
+tl::optional<ProcMacro::TokenStream>
+CustomDeriveProcMacro::invoke (ProcMacro::TokenStream input) const
+{
+  if (remote)
+    return ProcMacroServer::expand (*remote, input);
+
+  return macro (input);
+}
+
+/* Macros generating code through `TokenStream::from_str` and
+   `Literal::from_str` tend to pass the same short snippets over and over, so
+   the tokens lexed from those are kept around and only converted again.
+   Longer inputs are rarely repeated and are not worth keeping.  The caches are
+   emptied whenever they reach max_cached_entries, so that a macro generating
+   many distinct snippets does not grow them for the whole compilation.  The
+   tokens carry locations of the session's line map, so the cache belongs to
+   the thread state.  */
+
+struct ProcMacroSourceCache
+{
+  std::unordered_map<std::string, const_TokenPtr> literals;
+  std::unordered_map<std::string, std::vector<const_TokenPtr>> tokens;
+};
+
 namespace {
 
+const size_t max_cached_source = 256;
+const size_t max_cached_entries = 1024;
+
+template <typename T>
+void
+cache_source (std::unordered_map<std::string, T> &cache,
+	      const std::string &source, T &&value)
+{
+  if (source.size () > max_cached_source)
+    return;
+
+  if (cache.size () >= max_cached_entries)
+    cache.clear ();
+
+  cache.emplace (source, std::move (value));
+}
+
+ProcMacroSourceCache &
+source_cache ()
+{
+  auto &cache = ThreadState::current ().proc_macro_sources;
+  if (cache == nullptr)
+    cache = new ProcMacroSourceCache ();
+
+  return *cache;
+}
+
+// derives may run on several threads, see expand_derive_proc_macros. This
+// also guards the token text table of the thread state they lex with.
+std::mutex callback_mutex;
+
+} // namespace
+
 ProcMacro::Literal
 literal_from_string (const std::string &data, bool &error)
 {
+  std::lock_guard<std::mutex> guard (callback_mutex);
+
+  auto &literal_cache = source_cache ().literals;
+  auto cached = literal_cache.find (data);
+  if (cached != literal_cache.end ())
+    {
+      error = false;
+      return convert_literal (cached->second);
+    }
+
   Lexer lex (data, nullptr);
   const_TokenPtr output = lex.build_token ();
   if (output == nullptr || !output->is_literal ())
@@ -59,6 +150,8 @@ literal_from_string (const std::string &data, bool &error)
       return ProcMacro::Literal::make_usize (0);
     }
 
+  cache_source (literal_cache, data, const_TokenPtr (output));
+
   error = false;
   return convert_literal (output);
 }
@@ -66,6 +159,16 @@ literal_from_string (const std::string &data, bool &error)
 ProcMacro::TokenStream
 tokenstream_from_string (std::string &data, bool &lex_error)
 {
+  std::lock_guard<std::mutex> guard (callback_mutex);
+
+  auto &tokens_cache = source_cache ().tokens;
+  auto cached = tokens_cache.find (data);
+  if (cached != tokens_cache.end ())
+    {
+      lex_error = false;
+      return convert (cached->second);
+    }
+
   // FIXME: Insert location pointing to call site in tokens
   Lexer lex (data, Session::get_instance ().linemap);
 
@@ -85,35 +188,30 @@ tokenstream_from_string (std::string &data, bool &lex_error)
     }
 
   lex_error = false;
-  return convert (tokens);
+  auto stream = convert (tokens);
+  cache_source (tokens_cache, data, std::move (tokens));
+
+  return stream;
 }
 
 static_assert (
-  std::is_same<decltype (tokenstream_from_string) *,
+  std::is_same<decltype (&tokenstream_from_string),
 	       ProcMacro::ts_from_str_fn_t>::value,
   "Registration callback signature not synced, check proc macro internals.");
 
 static_assert (
-  std::is_same<decltype (literal_from_string) *,
+  std::is_same<decltype (&literal_from_string),
 	       ProcMacro::lit_from_str_fn_t>::value,
   "Registration callback signature not synced, check proc macro internals.");
 
-} // namespace
-
 template <typename Symbol, typename Callback>
-bool
+static bool
 register_callback (void *handle, Symbol, std::string symbol_name,
 		   Callback callback)
 {
   void *addr = dlsym (handle, symbol_name.c_str ());
   if (addr == nullptr)
-    {
-      rust_error_at (UNDEF_LOCATION,
-		     "Callback registration symbol (%s) missing from "
-		     "proc macro, wrong version?",
-		     symbol_name.c_str ());
-      return false;
-    }
+    return false;
 
   auto storage = reinterpret_cast<Symbol *> (addr);
   *storage = callback;
@@ -122,36 +220,69 @@ register_callback (void *handle, Symbol, std::string symbol_name,
 }
 
 #define REGISTER_CALLBACK(HANDLE, SYMBOL, CALLBACK)                            \
-  register_callback (HANDLE, SYMBOL, #SYMBOL, CALLBACK)
+  (register_callback (HANDLE, SYMBOL, #SYMBOL, CALLBACK)                       \
+     ? true                                                                    \
+     : (error.symbol = #SYMBOL, false))
 
 const ProcMacro::ProcmacroArray *
-load_macros_array (std::string path)
+open_proc_macro_library (const std::string &path,
+			 ProcMacro::ts_from_str_fn_t ts_from_str,
+			 ProcMacro::lit_from_str_fn_t lit_from_str,
+			 ProcMacroLibraryError &error, bool *thread_safe)
 {
 #ifndef _WIN32
-  void *handle = dlopen (path.c_str (), RTLD_LAZY | RTLD_LOCAL);
+  // every symbol is resolved now, so that missing ones are reported here
+  // rather than in the middle of an expansion
+  void *handle = dlopen (path.c_str (), RTLD_NOW | RTLD_LOCAL);
   // We're leaking the handle since we can't ever unload it
   if (!handle)
     {
-      rust_debug ("Error whilst opening procedural macro: %s", dlerror ());
+      error.kind = ProcMacroLibraryError::NOT_A_LIBRARY;
+      error.symbol = dlerror ();
       return nullptr;
     }
 
-  if (!REGISTER_CALLBACK (handle, __gccrs_proc_macro_ts_from_str_,
-			  tokenstream_from_string))
-    return nullptr;
-  if (!REGISTER_CALLBACK (handle, __gccrs_proc_macro_lit_from_str_,
-			  literal_from_string))
-    return nullptr;
-  if (!REGISTER_CALLBACK (handle, __gccrs_proc_macro_is_available_,
-			  ProcMacro::BridgeState::Available))
-    return nullptr;
+  // the buffers exchanged with the macro must have the layout we expect
+  auto version = reinterpret_cast<const std::uint32_t *> (
+    dlsym (handle, "__gccrs_proc_macro_abi_version_"));
+  if (version == nullptr || *version != ProcMacro::ABI_VERSION)
+    {
+      error.kind = ProcMacroLibraryError::INCOMPATIBLE;
+      return nullptr;
+    }
+
+  if (!REGISTER_CALLBACK (handle, __gccrs_proc_macro_ts_from_str_, ts_from_str)
+      || !REGISTER_CALLBACK (handle, __gccrs_proc_macro_lit_from_str_,
+			     lit_from_str)
+      || !REGISTER_CALLBACK (handle, __gccrs_proc_macro_is_available_,
+			     ProcMacro::BridgeState::Available))
+    {
+      error.kind = ProcMacroLibraryError::MISSING_CALLBACK;
+      return nullptr;
+    }
 
   // FIXME: Add CrateStableId handling, right now all versions may be loaded,
   // even incompatible ones.
   auto symbol_name = generate_proc_macro_decls_symbol (0 /* FIXME */);
 
-  return *reinterpret_cast<const ProcMacro::ProcmacroArray **> (
+  auto decls = reinterpret_cast<const ProcMacro::ProcmacroArray **> (
     dlsym (handle, symbol_name.c_str ()));
+  if (decls == nullptr)
+    {
+      error.kind = ProcMacroLibraryError::NOT_A_LIBRARY;
+      error.symbol = symbol_name;
+      return nullptr;
+    }
+
+  if (thread_safe != nullptr)
+    {
+      auto flag = reinterpret_cast<const std::uint32_t *> (
+	dlsym (handle, "__gccrs_proc_macro_thread_safe_"));
+      *thread_safe = flag != nullptr && *flag != 0;
+    }
+
+  error.kind = ProcMacroLibraryError::NONE;
+  return *decls;
 #else
   rust_sorry_at (UNDEF_LOCATION,
 		 "Procedural macros are not yet supported on windows host");
@@ -161,18 +292,106 @@ load_macros_array (std::string path)
 
 #undef REGISTER_CALLBACK
 
-const std::vector<ProcMacro::Procmacro>
+void
+report_proc_macro_library_error (const std::string &path,
+				 const ProcMacroLibraryError &error)
+{
+  switch (error.kind)
+    {
+    case ProcMacroLibraryError::NONE:
+      break;
+    case ProcMacroLibraryError::NOT_A_LIBRARY:
+      // every file found when importing a crate is tried as a library
+      rust_debug ("%s is not a procedural macro library: %s", path.c_str (),
+		  error.symbol.c_str ());
+      break;
+    case ProcMacroLibraryError::INCOMPATIBLE:
+      rust_error_at (UNDEF_LOCATION,
+		     "procedural macro library %qs was built against an "
+		     "incompatible version of libgrust",
+		     path.c_str ());
+      break;
+    case ProcMacroLibraryError::MISSING_CALLBACK:
+      rust_error_at (UNDEF_LOCATION,
+		     "Callback registration symbol (%s) missing from "
+		     "proc macro, wrong version?",
+		     error.symbol.c_str ());
+      break;
+    }
+}
+
+struct LoadedLibrary
+{
+  const ProcMacro::ProcmacroArray *array;
+  bool thread_safe;
+};
+
+static LoadedLibrary
+load_macros_array (std::string path)
+{
+  ProcMacroLibraryError error;
+  LoadedLibrary library = {nullptr, false};
+  library.array
+    = open_proc_macro_library (path, tokenstream_from_string,
+			       literal_from_string, error,
+			       &library.thread_safe);
+  report_proc_macro_library_error (path, error);
+
+  return library;
+}
+
+/* The libraries opened so far, by canonical path, so that each of them is
+   only loaded once per process however many crates import it.  Libraries
+   which failed to load are recorded as well, every file found when
+   importing a crate is tried as a library.  */
+
+static std::unordered_map<std::string, LoadedLibrary> loaded_libraries;
+
+const std::vector<LoadedProcMacro>
 load_macros (std::string path)
 {
-  const ProcMacro::ProcmacroArray *array = load_macros_array (path);
+  std::vector<LoadedProcMacro> macros;
+
+  if (ProcMacroServer::enabled ())
+    {
+      std::vector<ProcMacro::Procmacro> remote_macros;
+      auto library = ProcMacroServer::load (path, remote_macros);
+      if (!library)
+	return {};
+
+      // each invocation runs in a worker process of its own
+      for (uint32_t i = 0; i < remote_macros.size (); i++)
+	macros.push_back (
+	  {remote_macros[i], ProcMacroServer::Macro {*library, i}, true});
+
+      return macros;
+    }
+
+  char *real_path = lrealpath (path.c_str ());
+  std::string key (real_path);
+  free (real_path);
+
+  LoadedLibrary library;
+  auto loaded = loaded_libraries.find (key);
+  if (loaded != loaded_libraries.end ())
+    library = loaded->second;
+  else
+    {
+      library = load_macros_array (path);
+      loaded_libraries.emplace (key, library);
+    }
+
   // Did not load the proc macro
+  auto array = library.array;
   if (array == nullptr)
     return {};
 
   rust_debug ("Found %lu procedural macros", (unsigned long) array->length);
 
-  return std::vector<ProcMacro::Procmacro> (array->macros,
-					    array->macros + array->length);
+  for (std::uint64_t i = 0; i < array->length; i++)
+    macros.push_back ({array->macros[i], tl::nullopt, library.thread_safe});
+
+  return macros;
 }
 
 std::string
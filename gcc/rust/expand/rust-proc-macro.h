@@ -19,6 +19,8 @@
 
 #include "libproc_macro_internal/proc_macro.h"
 #include "rust-mapping-common.h"
+#include "rust-proc-macro-server.h"
+#include "optional.h"
 
 namespace Rust {
 
@@ -28,16 +30,23 @@ private:
   std::string name;
   NodeId node_id;
   ProcMacro::BangMacro macro;
+  tl::optional<ProcMacroServer::Macro> remote;
 
 public:
-  BangProcMacro (ProcMacro::Bang macro);
+  BangProcMacro (ProcMacro::Bang macro,
+		 tl::optional<ProcMacroServer::Macro> remote = tl::nullopt);
   BangProcMacro () = default;
 
   const std::string &get_name () const { return name; }
 
   NodeId get_node_id () const { return node_id; }
 
-  ProcMacro::BangMacro get_handle () const { return macro; }
+  /**
+   * Run the macro over INPUT, in this process or in a worker of the proc
+   * macro server. Returns nullopt when the worker running it exited.
+   */
+  tl::optional<ProcMacro::TokenStream>
+  invoke (ProcMacro::TokenStream input) const;
 };
 
 class AttributeProcMacro
@@ -46,16 +55,25 @@ private:
   std::string name;
   NodeId node_id;
   ProcMacro::AttributeMacro macro;
+  tl::optional<ProcMacroServer::Macro> remote;
 
 public:
-  AttributeProcMacro (ProcMacro::Attribute macro);
+  AttributeProcMacro (
+    ProcMacro::Attribute macro,
+    tl::optional<ProcMacroServer::Macro> remote = tl::nullopt);
   AttributeProcMacro () = default;
 
   const std::string &get_name () const { return name; }
 
   NodeId get_node_id () const { return node_id; }
 
-  ProcMacro::AttributeMacro get_handle () const { return macro; }
+  /**
+   * Run the macro over ITEM with the arguments ATTRIBUTE of the attribute,
+   * in this process or in a worker of the proc macro server. Returns nullopt
+   * when the worker running it exited.
+   */
+  tl::optional<ProcMacro::TokenStream>
+  invoke (ProcMacro::TokenStream attribute, ProcMacro::TokenStream item) const;
 };
 
 class CustomDeriveProcMacro
@@ -65,16 +83,43 @@ private:
   std::vector<std::string> attributes;
   NodeId node_id;
   ProcMacro::CustomDeriveMacro macro;
+  tl::optional<ProcMacroServer::Macro> remote;
+  bool thread_safe = false;
 
 public:
-  CustomDeriveProcMacro (ProcMacro::CustomDerive macro);
+  CustomDeriveProcMacro (
+    ProcMacro::CustomDerive macro,
+    tl::optional<ProcMacroServer::Macro> remote = tl::nullopt,
+    bool thread_safe = false);
   CustomDeriveProcMacro () = default;
 
   const std::string &get_name () const { return trait_name; }
 
   NodeId get_node_id () const { return node_id; }
 
-  ProcMacro::CustomDeriveMacro get_handle () const { return macro; }
+  // Can the macro run while other macros of the process run on other threads?
+  bool is_thread_safe () const { return thread_safe; }
+
+  /**
+   * Run the macro over INPUT, in this process or in a worker of the proc
+   * macro server. Returns nullopt when the worker running it exited.
+   */
+  tl::optional<ProcMacro::TokenStream>
+  invoke (ProcMacro::TokenStream input) const;
+};
+
+/**
+ * A macro of a procedural macro library. Its entrypoint is null when the
+ * library was loaded by the proc macro server, which runs the macro REMOTE.
+ * THREAD_SAFE is set when the macro may be invoked concurrently: when it runs
+ * remotely, or when its library defines `__gccrs_proc_macro_thread_safe_` as
+ * non-zero.
+ */
+struct LoadedProcMacro
+{
+  ProcMacro::Procmacro macro;
+  tl::optional<ProcMacroServer::Macro> remote;
+  bool thread_safe;
 };
 
 /**
@@ -82,9 +127,50 @@ public:
  *
  * @param The path to the shared object file to load.
  */
-const std::vector<ProcMacro::Procmacro>
+const std::vector<LoadedProcMacro>
 load_macros (std::string path);
 
+// Why a file could not be used as a procedural macro library
+struct ProcMacroLibraryError
+{
+  enum Kind
+  {
+    NONE,
+    NOT_A_LIBRARY,
+    INCOMPATIBLE,
+    MISSING_CALLBACK,
+  };
+
+  Kind kind = NONE;
+  // The missing symbol, or the reason the file is not a library
+  std::string symbol;
+};
+
+/**
+ * Open the library at PATH and register TS_FROM_STR and LIT_FROM_STR as the
+ * callbacks its macros use to lex strings. Returns null, with the reason in
+ * ERROR, when PATH is not a usable procedural macro library. THREAD_SAFE, when
+ * given, is set to whether the library allows its macros to run concurrently.
+ */
+const ProcMacro::ProcmacroArray *
+open_proc_macro_library (const std::string &path,
+			 ProcMacro::ts_from_str_fn_t ts_from_str,
+			 ProcMacro::lit_from_str_fn_t lit_from_str,
+			 ProcMacroLibraryError &error,
+			 bool *thread_safe = nullptr);
+
+void
+report_proc_macro_library_error (const std::string &path,
+				 const ProcMacroLibraryError &error);
+
+// The callbacks of the libraries loaded by the compiler, lexing DATA with the
+// session of the calling thread
+ProcMacro::TokenStream
+tokenstream_from_string (std::string &data, bool &lex_error);
+
+ProcMacro::Literal
+literal_from_string (const std::string &data, bool &error);
+
 std::string
 generate_proc_macro_decls_symbol (std::uint32_t stable_crate_id);
 
@@ -0,0 +1,716 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-test-harness.h"
+#include "rust-attribute-values.h"
+#include "rust-diagnostics.h"
+#include "rust-hir-map.h"
+#include "rust-lex.h"
+#include "rust-parse.h"
+#include "selftest.h"
+
+namespace Rust {
+
+// Number of timed batches of each benchmark
+static const int bench_samples = 50;
+
+// Length of the batches of a benchmark, once calibrated, in nanoseconds
+static const int bench_batch_ns = 1000000;
+
+enum class HarnessKind
+{
+  None,
+  Test,
+  Bench,
+};
+
+static HarnessKind
+harness_kind (const AST::AttrVec &attrs)
+{
+  for (const auto &attr : attrs)
+    switch (attr.get_builtin ())
+      {
+      case Values::BuiltinAttribute::TEST:
+	return HarnessKind::Test;
+      case Values::BuiltinAttribute::BENCH:
+	return HarnessKind::Bench;
+      default:
+	break;
+      }
+
+  return HarnessKind::None;
+}
+
+// The generated `main` lives at the crate root, so every item on the way to
+// a test must be visible from there
+static void
+make_crate_visible (AST::Visibility &vis)
+{
+  switch (vis.get_vis_type ())
+    {
+    case AST::Visibility::PUB:
+    case AST::Visibility::PUB_CRATE:
+      break;
+    default:
+      vis = AST::Visibility::create_crate (UNDEF_LOCATION, UNDEF_LOCATION);
+      break;
+    }
+}
+
+void
+TestHarness::go (AST::Crate &crate)
+{
+  collect (crate.items);
+  if (!enabled)
+    return;
+
+  Lexer lex (generate (), nullptr);
+  Parser<Lexer> parser (lex);
+
+  auto harness = parser.parse_items ();
+  rust_assert (parser.get_errors ().empty ());
+
+  // the runtime module uses intrinsics, whatever features the crate enables
+  rust_assert (harness.front ()->get_ast_kind () == AST::Kind::MODULE);
+  Analysis::Mappings::get ().insert_compiler_generated_item (
+    harness.front ()->get_node_id ());
+
+  std::move (harness.begin (), harness.end (),
+	     std::back_inserter (crate.items));
+}
+
+void
+TestHarness::collect (std::vector<std::unique_ptr<AST::Item>> &items,
+		      const std::string &prefix)
+{
+  for (auto it = items.begin (); it != items.end ();)
+    {
+      auto &item = *it;
+      if (item->get_ast_kind () == AST::Kind::MODULE)
+	{
+	  auto &module = static_cast<AST::Module &> (*item);
+	  if (prefix.empty () && module.get_name ().as_string () == "test")
+	    root_has_test = true;
+	  if (module.get_kind () == AST::Module::LOADED)
+	    {
+	      size_t collected = tests.size () + benches.size ();
+	      collect (module.get_items (),
+		       prefix + module.get_name ().as_string () + "::");
+	      if (tests.size () + benches.size () != collected)
+		make_crate_visible (module.get_visibility ());
+	    }
+	  it++;
+	  continue;
+	}
+
+      auto function = dynamic_cast<AST::Function *> (item.get ());
+      if (function == nullptr)
+	{
+	  it++;
+	  continue;
+	}
+
+      auto name = function->get_function_name ().as_string ();
+      if (prefix.empty () && name == "test")
+	root_has_test = true;
+
+      auto kind = harness_kind (function->get_outer_attrs ());
+      if (kind == HarnessKind::None)
+	{
+	  // the harness brings its own entry point
+	  if (enabled && prefix.empty () && name == "main")
+	    it = items.erase (it);
+	  else
+	    it++;
+	  continue;
+	}
+
+      if (!enabled)
+	{
+	  it = items.erase (it);
+	  continue;
+	}
+
+      // the type of the benchmarks' argument is checked once the harness
+      // passes them to `__test::bench`
+      size_t params = kind == HarnessKind::Test ? 0 : 1;
+      if (function->has_generics () || function->has_return_type ()
+	  || function->get_function_params ().size () != params)
+	{
+	  if (kind == HarnessKind::Test)
+	    rust_error_at (function->get_locus (),
+			   "functions used as tests must have signature "
+			   "%<fn()%>");
+	  else
+	    rust_error_at (function->get_locus (),
+			   "functions used as benchmarks must have signature "
+			   "%<fn(&mut Bencher)%>");
+	  it++;
+	  continue;
+	}
+
+      if (kind == HarnessKind::Bench && !linux_target)
+	{
+	  rust_sorry_at (function->get_locus (),
+			 "benchmarks are not supported on this target");
+	  it++;
+	  continue;
+	}
+
+      make_crate_visible (function->get_visibility ());
+      if (kind == HarnessKind::Test)
+	tests.push_back (prefix + name);
+      else
+	benches.push_back (prefix + name);
+      it++;
+    }
+}
+
+// A Rust expression for VALUE as a nul-terminated C string
+static std::string
+c_string (const std::string &value)
+{
+  std::string result = "\"";
+  for (char c : value)
+    switch (c)
+      {
+      case '"':
+	result += "\\\"";
+	break;
+      case '\\':
+	result += "\\\\";
+	break;
+      case '\n':
+	result += "\\n";
+	break;
+      default:
+	result += c;
+	break;
+      }
+
+  return result + "\\0\" as *const str as *const i8";
+}
+
+// The runtime of the harness, completed by one of the two runtimes below.
+// `$SAMPLES`, `$BATCH_NS`, `$TESTS`, `$PRINT`, `$CLOCK_GETTIME`, the
+// `$..._VAR` names, the `$..._EVENT` names and the `$..._FORMAT` strings are
+// replaced when generating it.
+static const char *harness_module
+  = "mod __test {\n"
+    // the pointers which may be null are declared as integers, since they
+    // can only be compared with zero that way
+    "    extern \"C\" {\n"
+    "        fn printf(format: *const i8, ...) -> i32;\n"
+    "        fn getenv(name: *const i8) -> usize;\n"
+    "        fn strstr(haystack: *const i8, needle: usize) -> usize;\n"
+    "        fn exit(status: i32);\n"
+    "    }\n"
+    "\n"
+    "    extern \"rust-intrinsic\" {\n"
+    "        fn black_box<T>(dummy: T) -> T;\n"
+    "    }\n"
+    "\n"
+    "    pub struct Test {\n"
+    "        pub name: *const i8,\n"
+    "        pub f: fn(),\n"
+    "    }\n"
+    "\n"
+    "    pub struct Run {\n"
+    "        filter: usize,\n"
+    "        passed: usize,\n"
+    "        failed: usize,\n"
+    "        filtered: usize,\n"
+    "        benches: usize,\n"
+    "        started: u64,\n"
+    "    }\n"
+    "\n"
+    "    fn seconds(ns: u64) -> f64 {\n"
+    "        ns as f64 / 1000000000.0\n"
+    "    }\n"
+    "\n"
+    "    fn selected(filter: usize, name: *const i8) -> bool {\n"
+    "        filter == 0 || unsafe { strstr(name, filter) } != 0\n"
+    "    }\n"
+    "\n"
+    "    fn report(run: &mut Run, name: *const i8, ok: bool, elapsed: u64) {\n"
+    "        if ok {\n"
+    "            run.passed += 1;\n"
+    "        } else {\n"
+    "            run.failed += 1;\n"
+    "        }\n"
+    "        let event = if ok { $OK_EVENT } else { $FAILED_EVENT };\n"
+    "        unsafe {\n"
+    "            $PRINT($TEST_FORMAT, name, event, seconds(elapsed));\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    pub fn start(tests: u64) -> Run {\n"
+    "        unsafe {\n"
+    "            $PRINT($START_FORMAT, tests);\n"
+    "        }\n"
+    "        Run {\n"
+    "            filter: unsafe { getenv($FILTER_VAR) },\n"
+    "            passed: 0,\n"
+    "            failed: 0,\n"
+    "            filtered: 0,\n"
+    "            benches: 0,\n"
+    "            started: now(),\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    pub fn finish(run: &Run) {\n"
+    "        let event = if run.failed == 0 {\n"
+    "            $OK_EVENT\n"
+    "        } else {\n"
+    "            $FAILED_EVENT\n"
+    "        };\n"
+    "        unsafe {\n"
+    "            $PRINT($FINISH_FORMAT, event, run.passed as u64,\n"
+    "                   run.failed as u64, run.filtered as u64,\n"
+    "                   run.benches as u64, seconds(now() - run.started));\n"
+    "            if run.failed != 0 {\n"
+    "                exit(101);\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "\n";
+
+// The benchmark runner, only generated when there are benchmarks since it
+// relies on closures. Benchmarks run on the main thread once the tests are
+// done.
+static const char *bench_runtime
+  = "    fn median(samples: &mut [f64; $SAMPLES]) -> f64 {\n"
+    "        let mut i: usize = 1;\n"
+    "        while i < $SAMPLES {\n"
+    "            let sample = (*samples)[i];\n"
+    "            let mut j: usize = i;\n"
+    "            while j > 0 && (*samples)[j - 1] > sample {\n"
+    "                (*samples)[j] = (*samples)[j - 1];\n"
+    "                j -= 1;\n"
+    "            }\n"
+    "            (*samples)[j] = sample;\n"
+    "            i += 1;\n"
+    "        }\n"
+    "        ((*samples)[$SAMPLES / 2 - 1] + (*samples)[$SAMPLES / 2]) / 2.0\n"
+    "    }\n"
+    "\n"
+    "    pub struct Bencher {\n"
+    "        iterations: u64,\n"
+    "        median: f64,\n"
+    "        deviation: f64,\n"
+    "    }\n"
+    "\n"
+    "    impl Bencher {\n"
+    // the batches are doubled until one lasts $BATCH_NS, which also warms
+    // the code up, then $SAMPLES batches of that size are timed. The result
+    // goes through black_box so that the call can neither be hoisted out of
+    // the loop nor removed when it has no visible effect.
+    "        pub fn iter<T, F: FnMut() -> T>(&mut self, mut inner: F) {\n"
+    "            let mut iterations: u64 = 1;\n"
+    "            let mut calibrated = false;\n"
+    "            let mut samples = [0.0; $SAMPLES];\n"
+    "            let mut sample: usize = 0;\n"
+    "            while sample < $SAMPLES {\n"
+    "                let start = now();\n"
+    "                let mut i: u64 = 0;\n"
+    "                while i < iterations {\n"
+    "                    unsafe { black_box(inner()) };\n"
+    "                    i += 1;\n"
+    "                }\n"
+    "                let elapsed = now() - start;\n"
+    "\n"
+    "                if calibrated {\n"
+    "                    let time = elapsed as f64 / iterations as f64;\n"
+    "                    samples[sample] = time;\n"
+    "                    sample += 1;\n"
+    "                } else if elapsed < $BATCH_NS {\n"
+    "                    iterations *= 2;\n"
+    "                } else {\n"
+    "                    calibrated = true;\n"
+    "                }\n"
+    "            }\n"
+    "            let median_time = median(&mut samples);\n"
+    "\n"
+    "            let mut deviations = [0.0; $SAMPLES];\n"
+    "            let mut i: usize = 0;\n"
+    "            while i < $SAMPLES {\n"
+    "                deviations[i] = if samples[i] > median_time {\n"
+    "                    samples[i] - median_time\n"
+    "                } else {\n"
+    "                    median_time - samples[i]\n"
+    "                };\n"
+    "                i += 1;\n"
+    "            }\n"
+    "\n"
+    "            self.iterations = iterations;\n"
+    "            self.median = median_time;\n"
+    "            self.deviation = median(&mut deviations);\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    pub fn bench(run: &mut Run, name: *const i8, f: fn(&mut Bencher)) {\n"
+    "        if !selected(run.filter, name) {\n"
+    "            run.filtered += 1;\n"
+    "            return;\n"
+    "        }\n"
+    "        run.benches += 1;\n"
+    "\n"
+    "        let mut bencher = Bencher {\n"
+    "            iterations: 0,\n"
+    "            median: 0.0,\n"
+    "            deviation: 0.0,\n"
+    "        };\n"
+    "        f(&mut bencher);\n"
+    "\n"
+    "        unsafe {\n"
+    "            $PRINT($BENCH_FORMAT, name, bencher.median,\n"
+    "                   bencher.deviation, bencher.iterations,\n"
+    "                   $SAMPLES as u64);\n"
+    "        }\n"
+    "    }\n"
+    "\n";
+
+// The clock and the test runner on Linux, whose C libraries all agree on
+// these interfaces and constants: glibc, musl and uClibc number sysconf's
+// names the same way. Both fields of the time are read as 64-bit: on 32-bit
+// targets the nanoseconds are padded, which zeroing them first accounts for,
+// and where time_t is 32-bit the clock is read through the 64-bit entry point
+// which glibc 2.34 and musl 1.2 provide there.
+//
+// The tests run on a pool of processes, in a child each so that one which
+// panics or aborts fails on its own. The main thread forks them and waits
+// for them without ever starting a thread, so that whatever a test does, it
+// starts from a process in which fork is safe. The reports are written with
+// dprintf, so that stdout's buffer only ever holds what the tests print and
+// is not duplicated in the children.
+static const char *linux_runtime
+  = "    #[repr(C)]\n"
+    "    struct Timespec {\n"
+    "        sec: i64,\n"
+    "        nsec: i64,\n"
+    "    }\n"
+    "\n"
+    "    extern \"C\" {\n"
+    "        fn dprintf(fd: i32, format: *const i8, ...) -> i32;\n"
+    "        fn fflush(stream: usize) -> i32;\n"
+    "        fn $CLOCK_GETTIME(clock: i32, time: *mut Timespec) -> i32;\n"
+    "        fn fork() -> i32;\n"
+    "        fn waitpid(pid: i32, status: *mut i32, options: i32) -> i32;\n"
+    "        fn _exit(status: i32);\n"
+    "        fn atoi(value: usize) -> i32;\n"
+    "        fn sysconf(name: i32) -> isize;\n"
+    "    }\n"
+    "\n"
+    "    const CLOCK_MONOTONIC: i32 = 1;\n"
+    "    const SC_NPROCESSORS_ONLN: i32 = 84;\n"
+    "    const MAX_JOBS: usize = 64;\n"
+    "\n"
+    "    fn jobs() -> usize {\n"
+    "        let value = unsafe { getenv($THREADS_VAR) };\n"
+    "        let count = if value != 0 {\n"
+    "            (unsafe { atoi(value) }) as isize\n"
+    "        } else {\n"
+    "            unsafe { sysconf(SC_NPROCESSORS_ONLN) }\n"
+    "        };\n"
+    "        if count < 1 {\n"
+    "            1\n"
+    "        } else if count > MAX_JOBS as isize {\n"
+    "            MAX_JOBS\n"
+    "        } else {\n"
+    "            count as usize\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    fn now() -> u64 {\n"
+    "        let mut time = Timespec { sec: 0, nsec: 0 };\n"
+    "        unsafe {\n"
+    "            let time_ptr = &mut time as *mut Timespec;\n"
+    "            $CLOCK_GETTIME(CLOCK_MONOTONIC, time_ptr);\n"
+    "        }\n"
+    "        time.sec as u64 * 1000000000 + time.nsec as u64\n"
+    "    }\n"
+    "\n"
+    // the child's side of fork ends in _exit, so only the parent returns
+    "    fn spawn(f: fn()) -> i32 {\n"
+    "        let pid = unsafe { fork() };\n"
+    "        if pid == 0 {\n"
+    "            f();\n"
+    "            unsafe {\n"
+    "                fflush(0);\n"
+    "                _exit(0);\n"
+    "            }\n"
+    "        }\n"
+    "        pid\n"
+    "    }\n"
+    "\n"
+    // up to jobs() children run at once, each recorded with the index of
+    // its test and the time it was started at. When a fork fails, the test
+    // is retried once a child finished, or run in the main process when
+    // none is left.
+    "    pub fn run_tests(run: &mut Run, tests: &[Test; $TESTS]) {\n"
+    "        let count = jobs();\n"
+    "        let mut pids: [i32; MAX_JOBS] = [0; MAX_JOBS];\n"
+    "        let mut indices: [usize; MAX_JOBS] = [0; MAX_JOBS];\n"
+    "        let mut starts: [u64; MAX_JOBS] = [0; MAX_JOBS];\n"
+    "        let mut running: usize = 0;\n"
+    "        let mut next: usize = 0;\n"
+    "        while next < $TESTS || running > 0 {\n"
+    "            if next < $TESTS && running < count {\n"
+    "                let test = &tests[next];\n"
+    "                if !selected(run.filter, test.name) {\n"
+    "                    run.filtered += 1;\n"
+    "                    next += 1;\n"
+    "                    continue;\n"
+    "                }\n"
+    "\n"
+    "                let start = now();\n"
+    "                let pid = spawn(test.f);\n"
+    "                if pid > 0 {\n"
+    "                    pids[running] = pid;\n"
+    "                    indices[running] = next;\n"
+    "                    starts[running] = start;\n"
+    "                    running += 1;\n"
+    "                    next += 1;\n"
+    "                    continue;\n"
+    "                }\n"
+    "                if running == 0 {\n"
+    "                    let f = test.f;\n"
+    "                    f();\n"
+    "                    report(run, test.name, true, now() - start);\n"
+    "                    next += 1;\n"
+    "                    continue;\n"
+    "                }\n"
+    "            }\n"
+    "\n"
+    "            let mut status: i32 = -1;\n"
+    "            let status_ptr = &mut status as *mut i32;\n"
+    "            let pid = unsafe { waitpid(-1, status_ptr, 0) };\n"
+    "            let mut job: usize = 0;\n"
+    "            while job < running && pids[job] != pid {\n"
+    "                job += 1;\n"
+    "            }\n"
+    "            if job < running {\n"
+    "                let name = tests[indices[job]].name;\n"
+    "                report(run, name, status == 0, now() - starts[job]);\n"
+    "                running -= 1;\n"
+    "                pids[job] = pids[running];\n"
+    "                indices[job] = indices[running];\n"
+    "                starts[job] = starts[running];\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "}\n";
+
+// The runtime for the other targets, which only relies on the C standard
+// library. The tests run one after the other on the main thread. There is no
+// clock, so they are not timed and benchmarks are rejected, and a test which
+// panics ends the whole run.
+static const char *portable_runtime
+  = "    fn now() -> u64 {\n"
+    "        0\n"
+    "    }\n"
+    "\n"
+    "    pub fn run_tests(run: &mut Run, tests: &[Test; $TESTS]) {\n"
+    "        let mut next: usize = 0;\n"
+    "        while next < $TESTS {\n"
+    "            let test = &tests[next];\n"
+    "            next += 1;\n"
+    "            if !selected(run.filter, test.name) {\n"
+    "                run.filtered += 1;\n"
+    "                continue;\n"
+    "            }\n"
+    "\n"
+    "            let f = test.f;\n"
+    "            f();\n"
+    "            report(run, test.name, true, 0);\n"
+    "        }\n"
+    "    }\n"
+    "}\n";
+
+static void
+replace_all (std::string &source, const std::string &from,
+	     const std::string &to)
+{
+  for (size_t pos = source.find (from); pos != std::string::npos;
+       pos = source.find (from, pos + to.size ()))
+    source.replace (pos, from.size (), to);
+}
+
+std::string
+TestHarness::generate () const
+{
+  const char *start_format = json ? "" : "\nrunning %llu tests\n";
+  const char *test_format;
+  const char *finish_format;
+  if (linux_target)
+    {
+      test_format
+	= json ? "{\"type\":\"test\",\"name\":\"%s\",\"event\":\"%s\","
+		 "\"exec_time\":%.3f}\n"
+	       : "test %s ... %s <%.3fs>\n";
+      finish_format
+	= json ? "{\"type\":\"suite\",\"event\":\"%s\",\"passed\":%llu,"
+		 "\"failed\":%llu,\"filtered_out\":%llu,\"benches\":%llu,"
+		 "\"exec_time\":%.3f}\n"
+	       : "\ntest result: %s. %llu passed; %llu failed; %llu filtered "
+		 "out; %llu benchmarks run; finished in %.2fs\n\n";
+    }
+  else
+    {
+      test_format = json ? "{\"type\":\"test\",\"name\":\"%s\","
+			   "\"event\":\"%s\"}\n"
+			 : "test %s ... %s\n";
+      finish_format
+	= json ? "{\"type\":\"suite\",\"event\":\"%s\",\"passed\":%llu,"
+		 "\"failed\":%llu,\"filtered_out\":%llu,\"benches\":%llu}\n"
+	       : "\ntest result: %s. %llu passed; %llu failed; %llu filtered "
+		 "out; %llu benchmarks run\n\n";
+    }
+  const char *bench_format
+    = json ? "{\"type\":\"bench\",\"name\":\"%s\",\"median\":%.2f,"
+	     "\"deviation\":%.2f,\"iterations\":%llu,\"samples\":%llu}\n"
+	   : "test %s ... bench: %.2f ns/iter (+/- %.2f), %llu iterations x "
+	     "%llu samples\n";
+
+  std::string source = harness_module;
+  if (!benches.empty ())
+    source += bench_runtime;
+  source += linux_target ? linux_runtime : portable_runtime;
+  replace_all (source, "$PRINT(", linux_target ? "dprintf(1, " : "printf(");
+  replace_all (source, "$CLOCK_GETTIME",
+	       time64 ? "clock_gettime" : "__clock_gettime64");
+  replace_all (source, "$SAMPLES", std::to_string (bench_samples));
+  replace_all (source, "$BATCH_NS", std::to_string (bench_batch_ns));
+  replace_all (source, "$TESTS", std::to_string (tests.size ()));
+  replace_all (source, "$THREADS_VAR", c_string ("RUST_TEST_THREADS"));
+  replace_all (source, "$FILTER_VAR", c_string ("RUST_TEST_FILTER"));
+  replace_all (source, "$OK_EVENT", c_string ("ok"));
+  replace_all (source, "$FAILED_EVENT", c_string (json ? "failed" : "FAILED"));
+  replace_all (source, "$START_FORMAT", c_string (start_format));
+  replace_all (source, "$TEST_FORMAT", c_string (test_format));
+  replace_all (source, "$BENCH_FORMAT", c_string (bench_format));
+  replace_all (source, "$FINISH_FORMAT", c_string (finish_format));
+
+  // the descriptor table of the tests, which the runtime picks them from
+  source += "\nstatic __TESTS: [__test::Test; " + std::to_string (tests.size ())
+	    + "] = [\n";
+  for (auto &test : tests)
+    source += "    __test::Test { name: " + c_string (test) + ", f: crate::"
+	      + test + " },\n";
+  source += "];\n";
+
+  // benchmarks name their argument as libtest's `test::Bencher`
+  if (!benches.empty () && !root_has_test)
+    source += "\npub mod test {\n"
+	      "    pub use crate::__test::Bencher;\n"
+	      "}\n";
+
+  source += "\nfn main() {\n";
+  source += "    let mut run = __test::start("
+	    + std::to_string (tests.size () + benches.size ()) + ");\n";
+  source += "    __test::run_tests(&mut run, &__TESTS);\n";
+  for (auto &bench : benches)
+    source += "    __test::bench(&mut run, " + c_string (bench) + ", crate::"
+	      + bench + ");\n";
+  source += "    __test::finish(&run);\n";
+
+  return source + "}\n";
+}
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+static std::vector<std::unique_ptr<Rust::AST::Item>>
+parse_items (const std::string &source)
+{
+  Rust::Lexer lex (source, nullptr);
+  Rust::Parser<Rust::Lexer> parser (lex);
+
+  auto items = parser.parse_items ();
+  ASSERT_TRUE (parser.get_errors ().empty ());
+
+  return items;
+}
+
+void
+rust_test_harness_test (void)
+{
+  using namespace Rust;
+
+  const std::string source = "fn main() {}\n"
+			     "#[test]\n"
+			     "fn root() {}\n"
+			     "mod inner {\n"
+			     "    #[bench]\n"
+			     "    fn bench(b: &mut Bencher) {}\n"
+			     "    fn helper() {}\n"
+			     "}\n";
+
+  // without -frust-test, tests and benchmarks are removed
+  auto stripped = parse_items (source);
+  TestHarness disabled (false, false, true);
+  disabled.collect (stripped);
+
+  ASSERT_EQ (stripped.size (), 2);
+  ASSERT_EQ (static_cast<AST::Module &> (*stripped[1]).get_items ().size (),
+	     1);
+  ASSERT_EQ (disabled.get_test_count (), 0);
+
+  // with it, they are collected and the crate's main is dropped
+  for (bool json : {false, true})
+    {
+      auto items = parse_items (source);
+      TestHarness enabled (true, json, true);
+      enabled.collect (items);
+
+      ASSERT_EQ (items.size (), 2);
+      ASSERT_EQ (enabled.get_test_count (), 1);
+      ASSERT_EQ (enabled.get_bench_count (), 1);
+      ASSERT_TRUE (
+	static_cast<AST::Module &> (*items[1]).get_visibility ().is_public ());
+
+      // the generated harness must be valid Rust: the runtime module, the
+      // table of the tests, the `test` module and main
+      auto harness = parse_items (enabled.generate ());
+      ASSERT_EQ (harness.size (), 4);
+    }
+
+  // a 32-bit time_t is bypassed rather than read into 64-bit fields
+  auto time32_items = parse_items ("#[test]\nfn root() {}\n");
+  TestHarness time32 (true, false, true, false);
+  time32.collect (time32_items);
+
+  auto time32_source = time32.generate ();
+  ASSERT_NE (time32_source.find ("__clock_gettime64"), std::string::npos);
+  ASSERT_EQ (parse_items (time32_source).size (), 3);
+
+  // the portable runtime, which has no benchmarks
+  auto items = parse_items ("#[test]\nfn root() {}\n");
+  TestHarness portable (true, false, false);
+  portable.collect (items);
+
+  ASSERT_EQ (portable.get_test_count (), 1);
+  ASSERT_EQ (parse_items (portable.generate ()).size (), 3);
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
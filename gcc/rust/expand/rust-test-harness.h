@@ -0,0 +1,104 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_TEST_HARNESS_H
+#define RUST_TEST_HARNESS_H
+
+#include "rust-system.h"
+#include "rust-ast.h"
+#include "rust-item.h"
+
+namespace Rust {
+
+/**
+ * Builds the test harness of a crate once it is expanded. The `#[test]` and
+ * `#[bench]` functions are removed unless -frust-test is given, in which case
+ * they are collected instead and the crate's `main` is replaced by one which
+ * runs all of them.
+ *
+ * The tests are gathered in a static table which the runtime takes them
+ * from, one at a time. On Linux, they run on a pool of as many processes as
+ * RUST_TEST_THREADS says, or as there are online processors, which the main
+ * thread forks without starting any thread itself. Elsewhere, they run on
+ * the main thread. Each test is run once and reported.
+ * Only the tests and benchmarks whose path contains RUST_TEST_FILTER are run,
+ * when it is set.
+ *
+ * Benchmarks take a `&mut test::Bencher`, as with libtest, and are run
+ * afterwards on the main thread. `Bencher::iter` times its closure by calling
+ * it in batches whose size is doubled until a batch lasts a millisecond,
+ * which also warms it up, then by timing a fixed number of such batches. The
+ * median time per iteration and its median absolute deviation are reported,
+ * as text or as one JSON object per line with -frust-test-json.
+ *
+ * The harness only relies on the C library, so that it works for crates
+ * which do not link against the standard library. On Linux, each test runs
+ * in a child process so that a failing one is reported as such, and the
+ * tests are timed. Elsewhere, only the C standard library is assumed: the
+ * tests are neither run in parallel, timed nor isolated, and benchmarks are
+ * not supported.
+ */
+class TestHarness
+{
+public:
+  TestHarness (bool enabled, bool json, bool linux_target, bool time64 = true)
+    : enabled (enabled), json (json), linux_target (linux_target),
+      time64 (time64)
+  {}
+
+  void go (AST::Crate &crate);
+
+  // Collect, or remove, the tests and benchmarks among ITEMS and in the
+  // modules they contain. PREFIX is the path of the module holding ITEMS.
+  void collect (std::vector<std::unique_ptr<AST::Item>> &items,
+		const std::string &prefix = "");
+
+  // The source of the `main` function and of the module it uses
+  std::string generate () const;
+
+  size_t get_test_count () const { return tests.size (); }
+  size_t get_bench_count () const { return benches.size (); }
+
+private:
+  bool enabled;
+  bool json;
+  // whether the Linux runtime of the harness can be used
+  bool linux_target;
+  // whether the C library's clock_gettime takes a 64-bit time_t
+  bool time64;
+  // whether the crate root already has an item named `test`, in which case
+  // the harness does not provide `test::Bencher`
+  bool root_has_test = false;
+
+  // paths of the collected functions, relative to the crate root
+  std::vector<std::string> tests;
+  std::vector<std::string> benches;
+};
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_test_harness_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_TEST_HARNESS_H
@@ -744,25 +744,29 @@ ASTLoweringBase::handle_outer_attributes (const ItemWrapper &item)
 {
   for (const auto &attr : item.get_outer_attrs ())
     {
-      const auto &str_path = attr.get_path ().as_string ();
-      if (!is_known_attribute (str_path))
+      auto builtin = attr.get_builtin ();
+      if (builtin == Values::BuiltinAttribute::UNKNOWN)
 	{
 	  rust_error_at (attr.get_locus (), "unknown attribute");
 	  continue;
 	}
 
-      bool is_lang_item = str_path == Values::Attributes::LANG
+      bool is_lang_item = builtin == Values::BuiltinAttribute::LANG
 			  && attr.has_attr_input ()
 			  && attr.get_attr_input ().get_attr_input_type ()
 			       == AST::AttrInput::AttrInputType::LITERAL;
 
-      bool is_doc_item = str_path == Values::Attributes::DOC;
+      bool is_doc_item = builtin == Values::BuiltinAttribute::DOC;
+
+      // builtin attributes have a single segment
+      const auto &segment = attr.get_path ().get_segments ()[0];
 
       if (is_doc_item)
 	handle_doc_item_attribute (item, attr);
       else if (is_lang_item)
 	handle_lang_item_attribute (item, attr);
-      else if (!attribute_handled_in_another_pass (str_path))
+      else if (!attribute_handled_in_another_pass (
+		 segment.get_segment_name ()))
 	{
 	  rust_error_at (attr.get_locus (), "unhandled attribute: [%s]",
 			 attr.get_path ().as_string ().c_str ());
@@ -808,13 +812,6 @@ ASTLoweringBase::handle_lang_item_attribute (const ItemWrapper &item,
     rust_error_at (attr.get_locus (), "unknown lang item");
 }
 
-bool
-ASTLoweringBase::is_known_attribute (const std::string &attribute_path) const
-{
-  const auto &lookup = attr_mappings->lookup_builtin (attribute_path);
-  return !lookup.is_error ();
-}
-
 bool
 ASTLoweringBase::attribute_handled_in_another_pass (
   const std::string &attribute_path) const
@@ -942,6 +939,11 @@ ASTLoweringBase::lower_literal (const AST::Literal &literal)
       break;
     }
 
+  // large values stay shared with the AST rather than being copied
+  if (literal.get_large_value ())
+    return HIR::Literal (literal.get_large_value (), type,
+			 literal.get_type_hint ());
+
   return HIR::Literal (literal.as_string (), type, literal.get_type_hint ());
 }
 
@@ -992,7 +994,7 @@ ASTLoweringBase::lower_macro_definition (AST::MacroRulesDefinition &def)
 {
   auto is_export = false;
   for (const auto &attr : def.get_outer_attrs ())
-    if (attr.get_path ().as_string () == Values::Attributes::MACRO_EXPORT)
+    if (attr.get_builtin () == Values::BuiltinAttribute::MACRO_EXPORT)
       is_export = true;
 
   if (is_export)
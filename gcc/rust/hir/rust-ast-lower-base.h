@@ -300,8 +300,6 @@ protected:
   void handle_doc_item_attribute (const ItemWrapper &item,
 				  const AST::Attribute &attr);
 
-  bool is_known_attribute (const std::string &attribute_path) const;
-
   bool
   attribute_handled_in_another_pass (const std::string &attribute_path) const;
 
@@ -145,8 +145,8 @@ ASTLoweringExpr::visit (AST::QualifiedPathInExpression &expr)
 void
 ASTLoweringExpr::visit (AST::BoxExpr &expr)
 {
-  // Not implemented
-  rust_unreachable ();
+  rust_sorry_at (expr.get_locus (),
+		 "%<box%> expressions are not supported yet");
 }
 
 void
@@ -829,18 +829,76 @@ ASTLoweringExpr::visit (AST::ClosureExprInnerTyped &expr)
 			    expr.get_locus ());
 }
 
+// Lower EXPR, which can be null
+static std::unique_ptr<HIR::Expr>
+lower_asm_operand_expr (std::unique_ptr<AST::Expr> &expr)
+{
+  if (expr == nullptr)
+    return nullptr;
+
+  return std::unique_ptr<HIR::Expr> (ASTLoweringExpr::translate (*expr));
+}
+
 void
 ASTLoweringExpr::visit (AST::InlineAsm &expr)
 {
+  using RegisterType = AST::InlineAsmOperand::RegisterType;
+
   auto crate_num = mappings.get_current_crate ();
   Analysis::NodeMapping mapping (crate_num, expr.get_node_id (),
 				 mappings.get_next_hir_id (crate_num),
 				 mappings.get_next_localdef_id (crate_num));
 
+  std::vector<HIR::InlineAsmOperand> operands;
+  for (auto &operand : expr.operands)
+    {
+      tl::optional<AST::InlineAsmRegOrRegClass> reg = tl::nullopt;
+      bool late = false;
+      std::unique_ptr<HIR::Expr> lowered;
+      std::unique_ptr<HIR::Expr> out_lowered;
+
+      switch (operand.register_type)
+	{
+	case RegisterType::In:
+	  reg = operand.in.reg;
+	  lowered = lower_asm_operand_expr (operand.in.expr);
+	  break;
+	case RegisterType::Out:
+	  reg = operand.out.reg;
+	  late = operand.out.late;
+	  lowered = lower_asm_operand_expr (operand.out.expr);
+	  break;
+	case RegisterType::InOut:
+	  reg = operand.in_out.reg;
+	  late = operand.in_out.late;
+	  lowered = lower_asm_operand_expr (operand.in_out.expr);
+	  break;
+	case RegisterType::SplitInOut:
+	  reg = operand.split_in_out.reg;
+	  late = operand.split_in_out.late;
+	  lowered = lower_asm_operand_expr (operand.split_in_out.in_expr);
+	  out_lowered = lower_asm_operand_expr (operand.split_in_out.out_expr);
+	  break;
+	case RegisterType::Const:
+	  lowered = lower_asm_operand_expr (operand.cnst.anon_const.expr);
+	  break;
+	case RegisterType::Sym:
+	  lowered = lower_asm_operand_expr (operand.sym.expr);
+	  break;
+	case RegisterType::Label:
+	  lowered = lower_asm_operand_expr (operand.label.expr);
+	  break;
+	}
+
+      operands.emplace_back (operand.register_type, reg, late,
+			     std::move (lowered), std::move (out_lowered),
+			     operand.locus);
+    }
+
   translated
     = new HIR::InlineAsm (expr.get_locus (), expr.is_global_asm,
 			  expr.get_template_ (), expr.get_template_strs (),
-			  expr.get_operands (), expr.get_clobber_abi (),
+			  std::move (operands), expr.get_clobber_abi (),
 			  expr.get_options (), mapping);
 }
 void
@@ -24,6 +24,7 @@
 #include "rust-ast-lower-type.h"
 #include "rust-ast-lower-pattern.h"
 #include "rust-ast-lower-struct-field-expr.h"
+#include "rust-self-profile.h"
 
 namespace Rust {
 namespace HIR {
@@ -73,9 +74,11 @@ std::unique_ptr<HIR::Crate>
 ASTLowering::go ()
 {
   std::vector<std::unique_ptr<HIR::Item>> items;
+  items.reserve (astCrate.items.size ());
 
   for (auto &item : astCrate.items)
     {
+      SelfProfileScope profile ("lowering", item->get_node_id ());
       auto translated = ASTLoweringItem::translate (*item);
       if (translated != nullptr)
 	items.push_back (std::unique_ptr<HIR::Item> (translated));
@@ -330,24 +333,10 @@ ASTLoweringExprWithBlock::visit (AST::WhileLoopExpr &expr)
 void
 ASTLoweringExprWithBlock::visit (AST::ForLoopExpr &expr)
 {
-  // TODO FIXME
-
-  // HIR::BlockExpr *loop_block
-  //   = ASTLoweringBlock::translate (expr.get_loop_block ().get (),
-  //   &terminated);
-  // HIR::LoopLabel loop_label = lower_loop_label (expr.get_loop_label ());
-  // HIR::Expr *iterator_expr
-  //   = ASTLoweringExpr::translate (expr.get_iterator_expr ().get (),
-  //       			  &terminated);
-  // HIR::Pattern *loop_pattern
-  //   = ASTLoweringPattern::translate (expr.get_pattern ().get ());
-
-  // auto crate_num = mappings->get_current_crate ();
-  // Analysis::NodeMapping mapping (crate_num, expr.get_node_id (),
-  //       			 mappings->get_next_hir_id (crate_num),
-  //       			 UNKNOWN_LOCAL_DEFID);
-
-  gcc_unreachable ();
+  // the loops over integer ranges were desugared during the expansion
+  rust_sorry_at (expr.get_locus (),
+		 "%<for%> loops over iterators other than integer ranges are "
+		 "not supported yet");
 }
 
 void
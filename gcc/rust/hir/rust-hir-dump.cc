@@ -24,6 +24,7 @@
 #include "rust-hir.h"
 #include <string>
 #include "rust-attribute-values.h"
+#include "rust-hir-map.h"
 #include "tree/rust-hir-expr.h"
 
 namespace Rust {
@@ -49,9 +50,9 @@ namespace HIR {
 // If a field is optional and is currently not holding anything:
 //   field: none
 
-std::string Dump::delims[2][2] = {
-  {std::string ("{"), std::string ("}")},
-  {std::string ("["), std::string ("]")},
+const char *Dump::delims[2][2] = {
+  {"{", "}"},
+  {"[", "]"},
 };
 
 static std::string
@@ -88,11 +89,13 @@ Dump::go (HIR::Crate &e)
   do_inner_attrs (e);
   do_mappings (e.get_mappings ());
 
-  visit_collection ("items", e.get_items ());
+  visit_items ("items", e.get_items ());
   end ("Crate");
 }
 
-Dump::Dump (std::ostream &stream) : stream (stream) {}
+Dump::Dump (std::ostream &stream, const std::string &filter)
+  : beg_of_line (true), stream (stream), filter (filter), in_filtered (false)
+{}
 
 /**
  * Writes TEXT with a final newline if ENDLINE is true.
@@ -103,7 +106,13 @@ Dump::Dump (std::ostream &stream) : stream (stream) {}
  * @param endline If true, newline is emitted after text
  */
 void
-Dump::put (std::string text, bool endline)
+Dump::put (const std::string &text, bool endline)
+{
+  put (text.data (), text.size (), endline);
+}
+
+void
+Dump::put (const char *text, size_t size, bool endline)
 {
   if (beg_of_line)
     {
@@ -111,26 +120,26 @@ Dump::put (std::string text, bool endline)
       beg_of_line = false;
     }
 
-  // keep multiline string indented
-  std::string::size_type pos = 0;
-  std::string::size_type prev = 0;
-  auto first = true;
-  while ((pos = text.find ('\n', prev)) != std::string::npos)
+  // keep multiline string indented, a final newline is left out
+  const char *end = text + size;
+  for (bool first = true;; first = false)
     {
+      const char *newline = std::find (text, end, '\n');
+      if (!first && text == end)
+	break;
+
       if (!first)
-	stream << std::endl << indentation;
-      first = false;
+	stream << '\n' << indentation;
+      stream.write (text, newline - text);
 
-      stream << text.substr (prev, pos - prev);
-      prev = pos + 1;
+      if (newline == end)
+	break;
+      text = newline + 1;
     }
 
-  if (first)
-    stream << text;
-
   if (endline)
     {
-      stream << std::endl;
+      stream << '\n';
       beg_of_line = endline;
     }
 }
@@ -143,11 +152,12 @@ Dump::put (std::string text, bool endline)
  * @param d Delimiter
  */
 void
-Dump::begin (std::string name, enum delim d)
+Dump::begin (const char *name, enum delim d)
 {
   if (!beg_of_line)
     put ("");
-  put (name + " " + delims[d][0], true);
+  stream << indentation << name << ' ' << delims[d][0] << '\n';
+  beg_of_line = true;
   indentation.increment ();
 }
 
@@ -159,12 +169,13 @@ Dump::begin (std::string name, enum delim d)
  * @param d Delimiter
  */
 void
-Dump::end (std::string name, enum delim d)
+Dump::end (const char *name, enum delim d)
 {
   indentation.decrement ();
   if (!beg_of_line)
-    stream << std::endl;
-  put (delims[d][1] + " // " + name);
+    stream << '\n';
+  stream << indentation << delims[d][1] << " // " << name << '\n';
+  beg_of_line = true;
 }
 
 /**
@@ -174,7 +185,7 @@ Dump::end (std::string name, enum delim d)
  * @param name HIR field name
  */
 void
-Dump::begin_field (std::string name)
+Dump::begin_field (const char *name)
 {
   begin (name, CURLY);
 }
@@ -186,11 +197,27 @@ Dump::begin_field (std::string name)
  * @param name HIR field name
  */
 void
-Dump::end_field (std::string name)
+Dump::end_field (const char *name)
 {
   end (name, CURLY);
 }
 
+/**
+ * Emits the NAME of a field, followed by a colon.
+ *
+ * @param name Field name
+ */
+void
+Dump::put_field_name (const char *name)
+{
+  if (beg_of_line)
+    {
+      stream << indentation;
+      beg_of_line = false;
+    }
+  stream << name << ": ";
+}
+
 /**
  * Emits a single field/value pair denoted by NAME and TEXT.
  *
@@ -198,9 +225,9 @@ Dump::end_field (std::string name)
  * @param text Field value
  */
 void
-Dump::put_field (std::string name, std::string text)
+Dump::put_field (const char *name, const std::string &text)
 {
-  put (name + ": ", false);
+  put_field_name (name);
   indentation.increment ();
   put (text);
   indentation.decrement ();
@@ -215,7 +242,7 @@ Dump::put_field (std::string name, std::string text)
  */
 template <class T>
 void
-Dump::visit_field (std::string name, std::unique_ptr<T> &ptr)
+Dump::visit_field (const char *name, std::unique_ptr<T> &ptr)
 {
   if (ptr)
     visit_field (name, *ptr);
@@ -230,9 +257,9 @@ Dump::visit_field (std::string name, std::unique_ptr<T> &ptr)
  * @param v Field value
  */
 void
-Dump::visit_field (std::string name, FullVisitable &v)
+Dump::visit_field (const char *name, FullVisitable &v)
 {
-  put (name + ": ", false);
+  put_field_name (name);
   indentation.increment ();
   v.accept_vis (*this);
   indentation.decrement ();
@@ -247,7 +274,7 @@ Dump::visit_field (std::string name, FullVisitable &v)
  */
 template <class T>
 void
-Dump::visit_collection (std::string name, std::vector<std::unique_ptr<T>> &vec)
+Dump::visit_collection (const char *name, std::vector<std::unique_ptr<T>> &vec)
 {
   if (vec.empty ())
     {
@@ -270,7 +297,7 @@ Dump::visit_collection (std::string name, std::vector<std::unique_ptr<T>> &vec)
  */
 template <class T>
 void
-Dump::visit_collection (std::string name, std::vector<T> &vec)
+Dump::visit_collection (const char *name, std::vector<T> &vec)
 {
   if (vec.empty ())
     {
@@ -284,6 +311,49 @@ Dump::visit_collection (std::string name, std::vector<T> &vec)
   end_field (name);
 }
 
+/**
+ * Visits the ITEMS of a crate or module for field NAME, leaving out the ones
+ * not selected by the -frust-dump-filter path.
+ *
+ * @param name Field name
+ * @param items Items of the crate or module
+ */
+void
+Dump::visit_items (const char *name, std::vector<std::unique_ptr<Item>> &items)
+{
+  if (filter.empty () || in_filtered)
+    {
+      visit_collection (name, items);
+      return;
+    }
+
+  auto &mappings = Analysis::Mappings::get ();
+
+  begin_field (name);
+  for (auto &item : items)
+    {
+      auto path = mappings.lookup_canonical_path (
+	item->get_mappings ().get_nodeid ());
+      if (!path)
+	continue;
+
+      switch (DumpFilter::match (filter, path->get ()))
+	{
+	case DumpFilter::SKIP:
+	  break;
+	case DumpFilter::DESCEND:
+	  item->accept_vis (*this);
+	  break;
+	case DumpFilter::DUMP:
+	  in_filtered = true;
+	  item->accept_vis (*this);
+	  in_filtered = false;
+	  break;
+	}
+    }
+  end_field (name);
+}
+
 void
 Dump::do_traititem (TraitItem &e)
 {
@@ -1532,7 +1602,7 @@ Dump::visit (Module &e)
   begin ("Module");
   do_inner_attrs (e);
   put_field ("module_name", e.get_module_name ().as_string ());
-  visit_collection ("items", e.get_items ());
+  visit_items ("items", e.get_items ());
 
   end ("Module");
 }
@@ -34,15 +34,21 @@ class Dump : public HIRFullVisitor
 public:
   static void debug (FullVisitable &v);
 
-  Dump (std::ostream &stream);
+  // Only the items whose canonical path is selected by FILTER are dumped, see
+  // DumpFilter
+  Dump (std::ostream &stream, const std::string &filter = "");
   void go (HIR::Crate &crate);
 
 private:
   bool beg_of_line;
   Indent indentation;
   std::ostream &stream;
+  std::string filter;
+  // whether the item being dumped is selected by the filter as a whole
+  bool in_filtered;
 
-  void put (std::string name, bool newline = true);
+  void put (const std::string &text, bool newline = true);
+  void put (const char *text, size_t size, bool newline);
 
   enum delim
   {
@@ -50,26 +56,30 @@ private:
     SQUARE = 1,
   };
 
-  static std::string delims[2][2];
+  static const char *delims[2][2];
 
-  void begin (std::string name, enum delim = SQUARE);
-  void end (std::string name, enum delim = SQUARE);
-  void begin_field (std::string name);
-  void end_field (std::string name);
+  void begin (const char *name, enum delim = SQUARE);
+  void end (const char *name, enum delim = SQUARE);
+  void begin_field (const char *name);
+  void end_field (const char *name);
 
   template <class T>
-  void visit_collection (std::string name,
+  void visit_collection (const char *name,
 			 std::vector<std::unique_ptr<T>> &vec);
 
   template <class T>
-  void visit_collection (std::string name, std::vector<T> &vec);
+  void visit_collection (const char *name, std::vector<T> &vec);
 
-  void visit_field (std::string field_name, FullVisitable &v);
+  void visit_items (const char *name,
+		    std::vector<std::unique_ptr<Item>> &items);
+
+  void visit_field (const char *field_name, FullVisitable &v);
 
   template <class T>
-  void visit_field (std::string field_name, std::unique_ptr<T> &);
+  void visit_field (const char *field_name, std::unique_ptr<T> &);
 
-  void put_field (std::string field_name, std::string text);
+  void put_field_name (const char *field_name);
+  void put_field (const char *field_name, const std::string &text);
   void do_vis_item (VisItem &);
   void do_mappings (const Analysis::NodeMapping &mappings);
   void do_inner_attrs (WithInnerAttrs &);
@@ -3861,6 +3861,56 @@ struct InlineAsmRegOrRegClass
   location_t locus;
 };
 
+// Operand of an inline assembly block, with its expressions lowered
+struct InlineAsmOperand
+{
+  using RegisterType = AST::InlineAsmOperand::RegisterType;
+
+  RegisterType register_type;
+  // unset for const, sym and label operands
+  tl::optional<AST::InlineAsmRegOrRegClass> reg;
+  bool late;
+  // the value of in, const and the input of split inout operands, the place
+  // of out and inout operands, and the path of sym operands. Can be null for
+  // out operands, which then only clobber their register.
+  std::unique_ptr<Expr> expr;
+  // the place of split inout operands, can be null
+  std::unique_ptr<Expr> out_expr;
+  location_t locus;
+
+  InlineAsmOperand (RegisterType register_type,
+		    tl::optional<AST::InlineAsmRegOrRegClass> reg, bool late,
+		    std::unique_ptr<Expr> expr, std::unique_ptr<Expr> out_expr,
+		    location_t locus)
+    : register_type (register_type), reg (std::move (reg)), late (late),
+      expr (std::move (expr)), out_expr (std::move (out_expr)), locus (locus)
+  {}
+
+  InlineAsmOperand (const InlineAsmOperand &other)
+    : register_type (other.register_type), reg (other.reg), late (other.late),
+      expr (other.expr ? other.expr->clone_expr () : nullptr),
+      out_expr (other.out_expr ? other.out_expr->clone_expr () : nullptr),
+      locus (other.locus)
+  {}
+
+  InlineAsmOperand &operator= (const InlineAsmOperand &other)
+  {
+    register_type = other.register_type;
+    reg = other.reg;
+    late = other.late;
+    expr = other.expr ? other.expr->clone_expr () : nullptr;
+    out_expr = other.out_expr ? other.out_expr->clone_expr () : nullptr;
+    locus = other.locus;
+    return *this;
+  }
+
+  InlineAsmOperand (InlineAsmOperand &&other) = default;
+  InlineAsmOperand &operator= (InlineAsmOperand &&other) = default;
+
+  bool has_expr () const { return expr != nullptr; }
+  bool has_out_expr () const { return out_expr != nullptr; }
+};
+
 // Inline Assembly Node
 class InlineAsm : public ExprWithoutBlock
 {
@@ -3872,7 +3922,7 @@ public:
 
   std::vector<AST::InlineAsmTemplatePiece> template_;
   std::vector<AST::TupleTemplateStr> template_strs;
-  std::vector<AST::InlineAsmOperand> operands;
+  std::vector<InlineAsmOperand> operands;
   std::vector<AST::TupleClobber> clobber_abi;
   std::set<AST::InlineAsmOption> options;
 
@@ -3905,16 +3955,21 @@ public:
     return template_strs;
   }
 
-  std::vector<AST::InlineAsmOperand> get_operands () { return operands; }
+  std::vector<InlineAsmOperand> &get_operands () { return operands; }
 
   std::vector<AST::TupleClobber> get_clobber_abi () { return clobber_abi; }
 
   std::set<AST::InlineAsmOption> get_options () { return options; }
 
+  bool has_option (AST::InlineAsmOption option) const
+  {
+    return options.count (option) != 0;
+  }
+
   InlineAsm (location_t locus, bool is_global_asm,
 	     std::vector<AST::InlineAsmTemplatePiece> template_,
 	     std::vector<AST::TupleTemplateStr> template_strs,
-	     std::vector<AST::InlineAsmOperand> operands,
+	     std::vector<InlineAsmOperand> operands,
 	     std::vector<AST::TupleClobber> clobber_abi,
 	     std::set<AST::InlineAsmOption> options,
 	     Analysis::NodeMapping mappings,
@@ -138,6 +138,8 @@ public:
 
   std::unique_ptr<Expr> &get_expression () { return expression; }
 
+  location_t get_locus () const { return locus; }
+
 private:
   std::unique_ptr<Expr> expression;
   location_t locus;
@@ -156,7 +158,7 @@ public:
   bool has_generic_args () const
   {
     return !(lifetime_args.empty () && type_args.empty ()
-	     && binding_args.empty ());
+	     && binding_args.empty () && const_args.empty ());
   }
 
   GenericArgs (std::vector<Lifetime> lifetime_args,
@@ -212,7 +214,7 @@ public:
   bool is_empty () const
   {
     return lifetime_args.size () == 0 && type_args.size () == 0
-	   && binding_args.size () == 0;
+	   && binding_args.size () == 0 && const_args.size () == 0;
   }
 
   std::string as_string () const;
@@ -21,6 +21,7 @@
 #include "rust-hir-full.h"
 #include "rust-hir-visitor.h"
 #include "rust-diagnostics.h"
+#include "rust-hir-map.h"
 
 /* Compilation unit used for various HIR-related functions that would make
  * the headers too long if they were defined inline and don't receive any
@@ -73,13 +74,22 @@ get_string_in_delims (std::string str_input, AST::DelimType delim_type)
 std::string
 Crate::as_string () const
 {
-  std::string str ("HIR::Crate: ");
+  std::ostringstream str;
+  dump (str);
+
+  return str.str ();
+}
+
+void
+Crate::dump (std::ostream &stream) const
+{
+  stream << "HIR::Crate: ";
 
   // inner attributes
-  str += "\n inner attributes: ";
+  stream << "\n inner attributes: ";
   if (inner_attrs.empty ())
     {
-      str += "none";
+      stream << "none";
     }
   else
     {
@@ -87,15 +97,15 @@ Crate::as_string () const
        * just the body */
       for (const auto &attr : inner_attrs)
 	{
-	  str += "\n  " + attr.as_string ();
+	  stream << "\n  " << attr.as_string ();
 	}
     }
 
   // items
-  str += "\n items: ";
+  stream << "\n items: ";
   if (items.empty ())
     {
-      str += "none";
+      stream << "none";
     }
   else
     {
@@ -106,14 +116,15 @@ Crate::as_string () const
 	    {
 	      rust_debug ("something really terrible has gone wrong - "
 			  "null pointer item in crate.");
-	      return "nullptr_POINTER_MARK";
+	      stream << "nullptr_POINTER_MARK";
+	      return;
 	    }
 
-	  str += "\n  " + item->as_string ();
+	  stream << "\n  " << item->as_string ();
 	}
     }
 
-  return str + "\n::" + get_mappings ().as_string () + "\n";
+  stream << "\n::" << get_mappings ().as_string () << "\n";
 }
 
 std::string
@@ -2627,10 +2638,50 @@ LetStmt::as_string () const
   return str;
 }
 
+void
+Literal::parse_int_value ()
+{
+  int_value = 0;
+  has_int_value = false;
+
+  // integer literals reach the HIR as plain decimal digits
+  if (type != INT || as_string ().empty ())
+    return;
+
+  for (char c : as_string ())
+    {
+      if (!ISDIGIT (c))
+	return;
+
+      uint64_t digit = c - '0';
+      if (int_value > (UINT64_MAX - digit) / 10)
+	return;
+
+      int_value = int_value * 10 + digit;
+    }
+
+  has_int_value = true;
+}
+
+const AST::AttrVec &
+Expr::get_outer_attrs () const
+{
+  return Analysis::Mappings::get ().lookup_expr_attrs (mappings.get_hirid ());
+}
+
+void
+Expr::set_outer_attrs (AST::AttrVec outer_attrs_to_set)
+{
+  Analysis::Mappings::get ().insert_expr_attrs (mappings.get_hirid (),
+						std::move (outer_attrs_to_set));
+}
+
 // Used to get outer attributes for expressions.
 std::string
 Expr::as_string () const
 {
+  const AST::AttrVec &outer_attrs = get_outer_attrs ();
+
   // outer attributes
   std::string str = "outer attributes: ";
   if (outer_attrs.empty ())
@@ -3772,7 +3823,9 @@ BorrowExpr::accept_vis (HIRFullVisitor &vis)
 
 void
 InlineAsm::accept_vis (HIRExpressionVisitor &vis)
-{}
+{
+  vis.visit (*this);
+}
 
 void
 InlineAsm::accept_vis (HIRFullVisitor &vis)
@@ -25,6 +25,7 @@
 #include "rust-location.h"
 #include "rust-hir-map.h"
 #include "rust-diagnostics.h"
+#include "rust-symbol.h"
 
 namespace Rust {
 typedef int TupleIndex;
@@ -126,35 +127,71 @@ public:
 
 private:
   std::string value_as_string;
+  // Holds the value instead when it is shared with the AST literal, see
+  // max_interned_length
+  std::shared_ptr<const std::string> large_value;
   LitType type;
   PrimitiveCoreType type_hint;
 
+  // The value of an INT literal, parsed once when the literal is created so
+  // that later passes do not have to parse the string again. Only set when
+  // the value fits in 64 bits.
+  uint64_t int_value;
+  bool has_int_value;
+
+  void parse_int_value ();
+
 public:
-  std::string as_string () const { return value_as_string; }
+  const std::string &as_string () const
+  {
+    return large_value ? *large_value : value_as_string;
+  }
 
   LitType get_lit_type () const { return type; }
 
   PrimitiveCoreType get_type_hint () const { return type_hint; }
 
+  tl::optional<uint64_t> get_int_value () const
+  {
+    if (!has_int_value)
+      return tl::nullopt;
+
+    return int_value;
+  }
+
   Literal (std::string value_as_string, LitType type,
 	   PrimitiveCoreType type_hint)
     : value_as_string (std::move (value_as_string)), type (type),
-      type_hint (type_hint)
-  {}
+      type_hint (type_hint), int_value (0), has_int_value (false)
+  {
+    parse_int_value ();
+  }
+
+  Literal (std::shared_ptr<const std::string> large_value, LitType type,
+	   PrimitiveCoreType type_hint)
+    : large_value (std::move (large_value)), type (type),
+      type_hint (type_hint), int_value (0), has_int_value (false)
+  {
+    parse_int_value ();
+  }
 
   static Literal create_error ()
   {
     return Literal ("", CHAR, PrimitiveCoreType::CORETYPE_UNKNOWN);
   }
 
-  void set_lit_type (LitType lt) { type = lt; }
+  void set_lit_type (LitType lt)
+  {
+    type = lt;
+    parse_int_value ();
+  }
 
   // Returns whether literal is in an invalid state.
-  bool is_error () const { return value_as_string == ""; }
+  bool is_error () const { return as_string () == ""; }
 
   bool is_equal (Literal &other)
   {
-    return value_as_string == other.value_as_string && type == other.type
+    return as_string () == other.as_string () && type == other.type
 	   && type_hint == other.type_hint;
   }
 };
@@ -266,7 +303,6 @@ public:
   using FullVisitable::accept_vis;
 
 protected:
-  AST::AttrVec outer_attrs;
   Analysis::NodeMapping mappings;
 
 public:
@@ -308,7 +344,9 @@ public:
 
   BaseKind get_hir_kind () override final { return EXPR; }
 
-  const AST::AttrVec &get_outer_attrs () const { return outer_attrs; }
+  /* Expression attributes are rarely present and rarely read after lowering,
+     so they live in a side table keyed by HirId rather than in every node.  */
+  const AST::AttrVec &get_outer_attrs () const;
 
   // Unique pointer custom clone function
   std::unique_ptr<Expr> clone_expr () const
@@ -338,15 +376,15 @@ protected:
   // Constructor
   Expr (Analysis::NodeMapping mappings,
 	AST::AttrVec outer_attribs = AST::AttrVec ())
-    : outer_attrs (std::move (outer_attribs)), mappings (std::move (mappings))
-  {}
+    : mappings (std::move (mappings))
+  {
+    if (!outer_attribs.empty ())
+      set_outer_attrs (std::move (outer_attribs));
+  }
 
   // TODO: think of less hacky way to implement this kind of thing
   // Sets outer attributes.
-  void set_outer_attrs (AST::AttrVec outer_attrs_to_set)
-  {
-    outer_attrs = std::move (outer_attrs_to_set);
-  }
+  void set_outer_attrs (AST::AttrVec outer_attrs_to_set);
 };
 
 // HIR node for an expression without an accompanying block - abstract
@@ -545,6 +583,8 @@ class Lifetime : public TypeParamBound
 private:
   AST::Lifetime::LifetimeType lifetime_type;
   std::string lifetime_name;
+  // the name interned once, so that the type checker does not hash it again
+  Symbol lifetime_symbol;
   location_t locus;
   Analysis::NodeMapping mappings;
 
@@ -552,7 +592,8 @@ public:
   // Constructor
   Lifetime (Analysis::NodeMapping mapping, AST::Lifetime::LifetimeType type,
 	    std::string name, location_t locus)
-    : lifetime_type (type), lifetime_name (std::move (name)), locus (locus),
+    : lifetime_type (type), lifetime_name (std::move (name)),
+      lifetime_symbol (Symbol::intern (lifetime_name)), locus (locus),
       mappings (mapping)
   {}
 
@@ -578,6 +619,8 @@ public:
     return lifetime_name;
   }
 
+  Symbol get_symbol () const { return lifetime_symbol; }
+
   AST::Lifetime::LifetimeType get_lifetime_type () const
   {
     return lifetime_type;
@@ -916,6 +959,9 @@ public:
   // Get crate representation as string (e.g. for debugging).
   std::string as_string () const;
 
+  // Write the same representation to STREAM, one item at a time
+  void dump (std::ostream &stream) const;
+
   const Analysis::NodeMapping &get_mappings () const { return mappings; }
   std::vector<std::unique_ptr<Item>> &get_items () { return items; }
 };
@@ -22,5 +22,9 @@
 
 {".rs", "@rust", 0, 1, 0},
   {"@rust",
-   "crab1 %i %(cc1_options) %{I*} %{L*} %D %{!fsyntax-only:%(invoke_as)}", 0, 1,
-   0},
+   "crab1 %i %(cc1_options) %{I*} %{L*} %D \
+    %{MD:-MD %{!o:%b.d}%{o*:%.d%*}} \
+    %{MMD:-MMD %{!o:%b.d}%{o*:%.d%*}} \
+    %{M} %{MM} %{MF*} %{MP} %{MQ*} %{MT*} \
+    %{!M:%{!MM:%{!MT:%{!MQ:%{MD|MMD:%{o*:-MQ %*}}}}}} \
+    %{!fsyntax-only:%(invoke_as)}", 0, 1, 0},
@@ -28,6 +28,39 @@ constexpr uint8_t UTF8_BOM1 = 0xEF;
 constexpr uint8_t UTF8_BOM2 = 0xBB;
 constexpr uint8_t UTF8_BOM3 = 0xBF;
 
+/* Return the number of leading ASCII bytes among the SIZE bytes at DATA. The
+   bytes are tested a word at a time, which is what most of the time is spent
+   on since Rust sources are nearly always plain ASCII.  */
+
+inline size_t
+ascii_prefix_length (const char *data, size_t size)
+{
+  const uint64_t high_bits = 0x8080808080808080ULL;
+  size_t i = 0;
+
+  for (; i + 4 * sizeof (uint64_t) <= size; i += 4 * sizeof (uint64_t))
+    {
+      uint64_t words[4];
+      memcpy (words, data + i, sizeof (words));
+      if ((words[0] | words[1] | words[2] | words[3]) & high_bits)
+	break;
+    }
+
+  for (; i + sizeof (uint64_t) <= size; i += sizeof (uint64_t))
+    {
+      uint64_t word;
+      memcpy (&word, data + i, sizeof (word));
+      if (word & high_bits)
+	break;
+    }
+
+  for (; i < size; i++)
+    if (static_cast<uint8_t> (data[i]) > MAX_ASCII_CODEPOINT)
+      break;
+
+  return i;
+}
+
 // Input source wrapper thing.
 class InputSource
 {
@@ -35,11 +68,13 @@ private:
   // position of current character
   unsigned int pos;
   std::vector<Codepoint> chars;
-  bool is_valid_utf8;
 
   // Overload operator () to return next char from input stream.
   virtual int next_byte () = 0;
 
+protected:
+  bool is_valid_utf8;
+
   Codepoint next_codepoint ()
   {
     uint32_t input = next_byte ();
@@ -120,7 +155,6 @@ private:
       }
   }
 
-protected:
   // This method must be called by the constructor to initialize the input
   // source. We cannot move this to the constructor because it calls a
   // virtual method .
@@ -151,7 +185,7 @@ public:
   bool is_valid () { return is_valid_utf8; }
 
   // get the next UTF-8 character
-  Codepoint next ()
+  virtual Codepoint next ()
   {
     if (pos >= chars.size ())
       return Codepoint::eof ();
@@ -174,36 +208,145 @@ public:
   }
 };
 
+/* Regular files are mapped and decoded on the fly rather than copied into a
+   vector of codepoints, so that lexing a file only costs its mapping. Other
+   files, like stdin or pipes, are read and decoded upfront.  */
+
 class FileInputSource : public InputSource
 {
 private:
   // Input source file.
   FILE *input;
 
-  int next_byte () override { return fgetc (input); }
+  // Mapping of the file, or nullptr when it is read through INPUT.
+  const char *map;
+  size_t map_size;
+  size_t map_pos;
+  // End of the run of ASCII bytes MAP_POS is in.
+  size_t ascii_end;
+
+  int next_byte () override
+  {
+    if (map == nullptr)
+      return fgetc (input);
+
+    if (map_pos >= map_size)
+      return EOF;
+    return static_cast<uint8_t> (map[map_pos++]);
+  }
+
+  bool try_map ()
+  {
+#if HAVE_MMAP_FILE
+    struct stat statbuf;
+    if (fstat (fileno (input), &statbuf) != 0 || !S_ISREG (statbuf.st_mode)
+	|| statbuf.st_size == 0 || ftell (input) != 0)
+      return false;
+
+    void *addr = mmap (nullptr, statbuf.st_size, PROT_READ, MAP_PRIVATE,
+		       fileno (input), 0);
+    if (addr == MAP_FAILED)
+      return false;
+
+    map = static_cast<const char *> (addr);
+    map_size = statbuf.st_size;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Check that the whole mapping is valid UTF-8, without storing anything
+  void validate_map ()
+  {
+    while (true)
+      {
+	map_pos += ascii_prefix_length (map + map_pos, map_size - map_pos);
+
+	Codepoint c = next_codepoint ();
+	if (c.is_eof ())
+	  break;
+	if (c == CODEPOINT_INVALID)
+	  {
+	    is_valid_utf8 = false;
+	    break;
+	  }
+      }
+
+    map_pos = 0;
+  }
 
 public:
   // Create new input source from file.
-  FileInputSource (FILE *input) : InputSource (), input (input) { init (); }
+  FileInputSource (FILE *input)
+    : InputSource (), input (input), map (nullptr), map_size (0), map_pos (0),
+      ascii_end (0)
+  {
+    if (try_map ())
+      validate_map ();
+    else
+      init ();
+  }
+
+  ~FileInputSource ()
+  {
+#if HAVE_MMAP_FILE
+    if (map != nullptr)
+      munmap (const_cast<char *> (map), map_size);
+#endif
+  }
+
+  FileInputSource (const FileInputSource &) = delete;
+  FileInputSource &operator= (const FileInputSource &) = delete;
+
+  Codepoint next () override
+  {
+    if (map == nullptr)
+      return InputSource::next ();
+
+    // within a run of ASCII bytes there is nothing to decode
+    if (map_pos >= ascii_end)
+      ascii_end
+	= map_pos + ascii_prefix_length (map + map_pos, map_size - map_pos);
+    if (map_pos < ascii_end)
+      return {static_cast<uint32_t> (map[map_pos++])};
+
+    // like the upfront decoding, stop at the first invalid sequence
+    Codepoint c = next_codepoint ();
+    if (c == CODEPOINT_INVALID)
+      {
+	map_pos = map_size;
+	return Codepoint::eof ();
+      }
+    return c;
+  }
 };
 
 class BufferInputSource : public InputSource
 {
 private:
-  const std::string &buffer;
+  const char *buffer;
+  size_t size;
   size_t offs;
 
   int next_byte () override
   {
-    if (offs >= buffer.size ())
+    if (offs >= size)
       return EOF;
-    return static_cast<uint8_t> (buffer.at (offs++));
+    return static_cast<uint8_t> (buffer[offs++]);
   }
 
 public:
-  // Create new input source from file.
+  // Create new input source from a string.
   BufferInputSource (const std::string &b, size_t offset)
-    : InputSource (), buffer (b), offs (offset)
+    : InputSource (), buffer (b.data ()), size (b.size ()), offs (offset)
+  {
+    init ();
+  }
+
+  // Create new input source from the SIZE bytes at DATA, which are not copied.
+  BufferInputSource (const char *data, size_t size)
+    : InputSource (), buffer (data), size (size), offs (0)
   {
     init ();
   }
@@ -138,17 +138,48 @@ is_identifier_continue (uint32_t codepoint)
   return cpp_check_xid_property (codepoint) & CPP_XID_CONTINUE;
 }
 
+// `try` is not a reserved keyword before 2018
+static bool
+edition_reserves_try ()
+{
+  return Session::get_instance ().options.get_edition ()
+	 != CompileOptions::Edition::E2015;
+}
+
 Lexer::Lexer (const std::string &input, Linemap *linemap)
   : input (RAIIFile::create_error ()), current_line (1), current_column (1),
-    line_map (linemap), dump_lex_out ({}),
+    line_map (linemap), try_is_keyword (edition_reserves_try ()),
+    dump_lex_out ({}), token_count (0),
     raw_input_source (new BufferInputSource (input, 0)),
     input_queue{*raw_input_source}, token_queue (TokenSource (this))
 {}
 
+Lexer::Lexer (const char *input, size_t size, Linemap *linemap)
+  : input (RAIIFile::create_error ()), current_line (1), current_column (1),
+    line_map (linemap), try_is_keyword (edition_reserves_try ()),
+    dump_lex_out ({}), token_count (0),
+    raw_input_source (new BufferInputSource (input, size)),
+    input_queue{*raw_input_source}, token_queue (TokenSource (this))
+{}
+
+Lexer::Lexer (const char *filename, const std::string &contents,
+	      Linemap *linemap)
+  : input (RAIIFile::create_error ()), current_line (1), current_column (1),
+    line_map (linemap), try_is_keyword (edition_reserves_try ()),
+    dump_lex_out ({}), token_count (0),
+    raw_input_source (new BufferInputSource (contents, 0)),
+    input_queue{*raw_input_source}, token_queue (TokenSource (this))
+{
+  // inform line_table that file is being entered and is in line 1
+  if (linemap)
+    line_map->start_file (filename, current_line);
+}
+
 Lexer::Lexer (const char *filename, RAIIFile file_input, Linemap *linemap,
 	      tl::optional<std::ofstream &> dump_lex_opt)
   : input (std::move (file_input)), current_line (1), current_column (1),
-    line_map (linemap), dump_lex_out (dump_lex_opt),
+    line_map (linemap), try_is_keyword (edition_reserves_try ()),
+    dump_lex_out (dump_lex_opt), token_count (0),
     raw_input_source (new FileInputSource (input.get_raw ())),
     input_queue{*raw_input_source}, token_queue (TokenSource (this))
 {
@@ -258,16 +289,76 @@ Lexer::replace_current_token (TokenPtr replacement)
 
 /* Determines whether the string passed in is a keyword or not. If it is, it
  * returns the keyword name.  */
-TokenId
-Lexer::classify_keyword (const std::string &str)
+namespace {
+
+/* Keywords bucketed by length and first and last character, so that looking
+   an identifier up compares it with at most a couple of keywords and never
+   allocates.  */
+
+class KeywordTable
 {
-  auto &keywords = Rust::Values::Keywords::keywords_tokens;
-  auto keyword = keywords.find (str);
+public:
+  KeywordTable () : max_length (0)
+  {
+#define RS_TOKEN(x, y)
+#define RS_TOKEN_KEYWORD_2015(tok, key) add (key, tok);
+#define RS_TOKEN_KEYWORD_2018 RS_TOKEN_KEYWORD_2015
+    RS_TOKEN_LIST
+#undef RS_TOKEN_KEYWORD_2015
+#undef RS_TOKEN_KEYWORD_2018
+#undef RS_TOKEN
+  }
+
+  TokenId lookup (const std::string &str) const
+  {
+    if (str.empty () || str.size () > max_length)
+      return IDENTIFIER;
+
+    for (const auto &keyword : buckets[bucket (str.data (), str.size ())])
+      if (keyword.length == str.size ()
+	  && memcmp (keyword.str, str.data (), str.size ()) == 0)
+	return keyword.id;
 
-  if (keyword == keywords.end ())
     return IDENTIFIER;
+  }
+
+private:
+  struct Keyword
+  {
+    const char *str;
+    size_t length;
+    TokenId id;
+  };
+
+  static const size_t num_buckets = 128;
+
+  static size_t bucket (const char *str, size_t length)
+  {
+    return (length * 31 + static_cast<unsigned char> (str[0]) * 7
+	    + static_cast<unsigned char> (str[length - 1]))
+	   % num_buckets;
+  }
+
+  void add (const char *str, TokenId id)
+  {
+    size_t length = strlen (str);
+    buckets[bucket (str, length)].push_back ({str, length, id});
+    max_length = std::max (max_length, length);
+  }
 
-  auto id = keyword->second;
+  std::vector<Keyword> buckets[num_buckets];
+  size_t max_length;
+};
+
+} // namespace
+
+TokenId
+Lexer::classify_keyword (const std::string &str)
+{
+  static const KeywordTable keywords;
+  TokenId id = keywords.lookup (str);
+  if (id == IDENTIFIER)
+    return IDENTIFIER;
 
   // We now have the expected token ID of the reserved keyword. However, some
   // keywords are reserved starting in certain editions. For example, `try` is
@@ -276,10 +367,7 @@ Lexer::classify_keyword (const std::string &str)
   //
   // https://doc.rust-lang.org/reference/keywords.html#reserved-keywords
 
-  // `try` is not a reserved keyword before 2018
-  if (Session::get_instance ().options.get_edition ()
-	== CompileOptions::Edition::E2015
-      && id == TRY)
+  if (id == TRY && !try_is_keyword)
     return IDENTIFIER;
 
   return id;
@@ -2104,10 +2192,9 @@ Lexer::parse_identifier_or_keyword (location_t loc)
   // loop through entire name
   while (is_identifier_continue (current_char.value))
     {
-      auto s = current_char.as_string ();
       length++;
 
-      str += current_char.as_string ();
+      str += current_char;
       skip_input ();
       current_char = peek_input ();
     }
@@ -2630,6 +2717,16 @@ test_file_input_source (std::string str, const std::vector<uint32_t> &expected)
   assert_source_content (source, expected);
 }
 
+static void
+test_invalid_file_input_source (std::string str)
+{
+  FILE *tmpf = tmpfile ();
+  fputs (str.c_str (), tmpf);
+  std::rewind (tmpf);
+  Rust::FileInputSource source (tmpf);
+  ASSERT_FALSE (source.is_valid ());
+}
+
 void
 rust_input_source_test ()
 {
@@ -2670,6 +2767,25 @@ rust_input_source_test ()
        0x2642 /* MALE SIGN */,	       0x1f469 /* WOMAN */,
        0x200d /* ZERO WIDTH JOINER */, 0x2695 /* STAFF OF AESCULAPIUS */};
   test_file_input_source (src, expected);
+
+  src = u8"\xef\xbb\xbf"
+	"a\u00e9b";
+  expected = {'a', 0xe9 /* LATIN SMALL LETTER E WITH ACUTE */, 'b'};
+  test_file_input_source (src, expected);
+
+  test_invalid_file_input_source ("ab\xff"
+				  "cd");
+
+  // ASCII runs, across the word at a time and byte at a time loops
+  std::string ascii (70, 'a');
+  ASSERT_EQ (Rust::ascii_prefix_length (ascii.data (), 0), 0);
+  ASSERT_EQ (Rust::ascii_prefix_length (ascii.data (), ascii.size ()), 70);
+  for (size_t i : {0, 7, 8, 31, 32, 33, 69})
+    {
+      std::string mixed = ascii;
+      mixed[i] = '\xc3';
+      ASSERT_EQ (Rust::ascii_prefix_length (mixed.data (), mixed.size ()), i);
+    }
 }
 
 } // namespace selftest
@@ -164,6 +164,12 @@ public:
   // Lex the contents of a string instead of a file
   Lexer (const std::string &input, Linemap *linemap);
 
+  // Lex the SIZE bytes at INPUT, which must outlive the lexer
+  Lexer (const char *input, size_t size, Linemap *linemap);
+
+  // Lex the already read contents of FILENAME, which must outlive the lexer
+  Lexer (const char *filename, const std::string &contents, Linemap *linemap);
+
   // dtor
   ~Lexer ();
 
@@ -177,10 +183,11 @@ public:
 
   bool input_source_is_valid_utf8 ();
 
-  // Returns token n tokens ahead of current position.
-  const_TokenPtr peek_token (int n) { return token_queue.peek (n); }
+  /* Returns token n tokens ahead of current position. The reference is
+   * invalidated by skipping or replacing tokens, and by peeking further. */
+  const const_TokenPtr &peek_token (int n) { return token_queue.peek (n); }
   // Peeks the current token.
-  const_TokenPtr peek_token () { return peek_token (0); }
+  const const_TokenPtr &peek_token () { return peek_token (0); }
 
   // Builds a token from the input queue.
   TokenPtr build_token ();
@@ -205,6 +212,8 @@ public:
   void split_current_token (std::vector<TokenPtr> new_tokens);
 
   Linemap *get_line_map () { return line_map; }
+  // Number of tokens handed to the parser so far
+  size_t get_token_count () const { return token_count; }
   std::string get_filename () { return std::string (input.get_filename ()); }
 
 private:
@@ -222,6 +231,8 @@ private:
   Codepoint current_char;
   // Line map.
   Linemap *line_map;
+  // Whether `try` is reserved, which depends on the edition.
+  bool try_is_keyword;
 
   /* Max column number that can be quickly allocated - higher may require
    * allocating new linemap */
@@ -229,6 +240,8 @@ private:
 
   tl::optional<std::ofstream &> dump_lex_out;
 
+  size_t token_count;
+
   // The input source for the lexer.
   // InputSource input_source;
   // Input file queue.
@@ -248,13 +261,17 @@ private:
     TokenSource &get () { return *this; }
 
     // Overload operator () to build token in lexer.
-    TokenPtr next () { return lexer->build_token (); }
+    TokenPtr next ()
+    {
+      lexer->token_count++;
+      return lexer->build_token ();
+    }
   };
 
   // The token source for the lexer.
   // TokenSource token_source;
   // Token stream queue.
-  buffered_queue<std::shared_ptr<Token>, TokenSource> token_queue;
+  buffered_queue<const_TokenPtr, TokenSource> token_queue;
 };
 
 } // namespace Rust
@@ -20,6 +20,7 @@
 #include "rust-token.h"
 #include "rust-diagnostics.h"
 #include "rust-unicode.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 // Hackily defined way to get token description for enum value using x-macros
@@ -160,20 +161,59 @@ Token::get_type_hint_str () const
 }
 
 std::string
-nfc_normalize_token_string (location_t loc, TokenId id, const std::string &str)
+nfc_normalize_token_string (location_t loc, TokenId id, std::string &&str)
 {
-  if (id == IDENTIFIER || id == LIFETIME)
+  if (id != IDENTIFIER && id != LIFETIME)
+    return std::move (str);
+
+  // ASCII is always in NFC, and almost every identifier is ASCII
+  if (ascii_prefix_length (str.data (), str.size ()) == str.size ())
+    return std::move (str);
+
+  tl::optional<Utf8String> ustring = Utf8String::make_utf8_string (str);
+  if (!ustring.has_value ())
+    rust_internal_error_at (loc, "identifier '%s' is not a valid UTF-8 string",
+			    str.c_str ());
+
+  // avoid re-encoding strings which are already normalized
+  if (nfc_quick_check (ustring.value ().get_chars ()) == QuickCheckResult::YES)
+    return std::move (str);
+
+  return ustring.value ().nfc_normalize ().as_string ();
+}
+
+struct TokenStringTable
+{
+  // the elements of an unordered_set never move, so their address can be
+  // handed out
+  std::unordered_set<std::string> strings;
+};
+
+/* The proc macro workers lex on the table of the thread they help, but only
+   from the callbacks of the macros, which rust-proc-macro.cc serializes: the
+   table needs no lock of its own, which would cost every token of the serial
+   lexer.  */
+
+const std::string *
+intern_token_string (std::string &&str)
+{
+  auto &table = ThreadState::current ().token_strings;
+  if (table == nullptr)
+    table = new TokenStringTable ();
+
+  return &*table->strings.insert (std::move (str)).first;
+}
+
+void
+Token::set_str (std::string &&text)
+{
+  if (text.size () > max_interned_length)
     {
-      tl::optional<Utf8String> ustring = Utf8String::make_utf8_string (str);
-      if (ustring.has_value ())
-	return ustring.value ().nfc_normalize ().as_string ();
-      else
-	rust_internal_error_at (loc,
-				"identifier '%s' is not a valid UTF-8 string",
-				str.c_str ());
+      large_str = std::make_shared<const std::string> (std::move (text));
+      str = large_str.get ();
     }
   else
-    return str;
+    str = intern_token_string (std::move (text));
 }
 
 const std::string &
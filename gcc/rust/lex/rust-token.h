@@ -239,7 +239,17 @@ get_type_hint_string (PrimitiveCoreType type);
 
 /* Normalize string if a token is a identifier */
 std::string
-nfc_normalize_token_string (location_t loc, TokenId id, const std::string &str);
+nfc_normalize_token_string (location_t loc, TokenId id, std::string &&str);
+
+/* Return the unique copy of STR shared by all tokens with that text. It lives
+ * until the end of the compilation. */
+const std::string *
+intern_token_string (std::string &&str);
+
+/* Texts longer than this, such as the contents of include_bytes!, are rarely
+ * repeated. They are not interned: the tokens and literals holding one share
+ * a single copy of it instead. */
+const size_t max_interned_length = 1024;
 
 // Represents a single token. Create using factory static methods.
 class Token
@@ -249,9 +259,10 @@ private:
   TokenId token_id;
   // Token location.
   location_t locus;
-  // Associated text (if any) of token.
-  std::unique_ptr<std::string> str;
-  // TODO: maybe remove issues and just store std::string as value?
+  // Associated text (if any) of token, interned unless it is large.
+  const std::string *str;
+  // Owner of the text when it is too large to be interned
+  std::shared_ptr<const std::string> large_str;
   /* Type hint for token based on lexer data (e.g. type suffix). Does not exist
    * for most tokens. */
   PrimitiveCoreType type_hint;
@@ -267,14 +278,15 @@ private:
     : token_id (token_id), locus (location), type_hint (CORETYPE_UNKNOWN)
   {
     // Normalize identifier tokens
-    str = Rust::make_unique<std::string> (
-      nfc_normalize_token_string (location, token_id, paramStr));
+    set_str (
+      nfc_normalize_token_string (location, token_id, std::move (paramStr)));
   }
 
   // Token constructor from token id, location, and a char.
   Token (TokenId token_id, location_t location, char paramChar)
     : token_id (token_id), locus (location),
-      str (new std::string (1, paramChar)), type_hint (CORETYPE_UNKNOWN)
+      str (intern_token_string (std::string (1, paramChar))),
+      type_hint (CORETYPE_UNKNOWN)
   {
     // Do not need to normalize 1byte char
   }
@@ -284,9 +296,8 @@ private:
     : token_id (token_id), locus (location), type_hint (CORETYPE_UNKNOWN)
   {
     // Normalize identifier tokens
-    str = Rust::make_unique<std::string> (
-      nfc_normalize_token_string (location, token_id,
-				  paramCodepoint.as_string ()));
+    set_str (nfc_normalize_token_string (location, token_id,
+					 paramCodepoint.as_string ()));
   }
 
   // Token constructor from token id, location, a string, and type hint.
@@ -295,10 +306,19 @@ private:
     : token_id (token_id), locus (location), type_hint (parType)
   {
     // Normalize identifier tokens
-    str = Rust::make_unique<std::string> (
-      nfc_normalize_token_string (location, token_id, paramStr));
+    set_str (
+      nfc_normalize_token_string (location, token_id, std::move (paramStr)));
   }
 
+  // Keep TEXT as the text of the token
+  void set_str (std::string &&text);
+
+  // Lets make_shared reach the private constructors, so that a token and its
+  // reference count share a single allocation.
+  struct Allocator;
+
+  template <typename... Args> static TokenPtr create (Args &&...args);
+
 public:
   // No default constructor.
   Token () = delete;
@@ -312,88 +332,72 @@ public:
 
   ~Token () = default;
 
-  /* TODO: make_shared (which saves a heap allocation) does not work with the
-   * private constructor */
-
   // Makes and returns a new TokenPtr (with null string).
   static TokenPtr make (TokenId token_id, location_t locus)
   {
-    // return std::make_shared<Token> (token_id, locus);
-    return TokenPtr (new Token (token_id, locus));
+    return create (token_id, locus);
   }
 
   // Makes and returns a new TokenPtr of type IDENTIFIER.
   static TokenPtr make_identifier (location_t locus, std::string &&str)
   {
-    // return std::make_shared<Token> (IDENTIFIER, locus, str);
-    return TokenPtr (new Token (IDENTIFIER, locus, std::move (str)));
+    return create (IDENTIFIER, locus, std::move (str));
   }
 
   // Makes and returns a new TokenPtr of type INT_LITERAL.
   static TokenPtr make_int (location_t locus, std::string &&str,
 			    PrimitiveCoreType type_hint = CORETYPE_UNKNOWN)
   {
-    // return std::make_shared<Token> (INT_LITERAL, locus, str, type_hint);
-    return TokenPtr (
-      new Token (INT_LITERAL, locus, std::move (str), type_hint));
+    return create (INT_LITERAL, locus, std::move (str), type_hint);
   }
 
   // Makes and returns a new TokenPtr of type FLOAT_LITERAL.
   static TokenPtr make_float (location_t locus, std::string &&str,
 			      PrimitiveCoreType type_hint = CORETYPE_UNKNOWN)
   {
-    // return std::make_shared<Token> (FLOAT_LITERAL, locus, str, type_hint);
-    return TokenPtr (
-      new Token (FLOAT_LITERAL, locus, std::move (str), type_hint));
+    return create (FLOAT_LITERAL, locus, std::move (str), type_hint);
   }
 
   // Makes and returns a new TokenPtr of type STRING_LITERAL.
   static TokenPtr make_string (location_t locus, std::string &&str)
   {
-    // return std::make_shared<Token> (STRING_LITERAL, locus, str,
-    // CORETYPE_STR);
-    return TokenPtr (
-      new Token (STRING_LITERAL, locus, std::move (str), CORETYPE_STR));
+    return create (STRING_LITERAL, locus, std::move (str), CORETYPE_STR);
   }
 
   // Makes and returns a new TokenPtr of type CHAR_LITERAL.
   static TokenPtr make_char (location_t locus, Codepoint char_lit)
   {
-    // return std::make_shared<Token> (CHAR_LITERAL, locus, char_lit);
-    return TokenPtr (new Token (CHAR_LITERAL, locus, char_lit));
+    return create (CHAR_LITERAL, locus, char_lit);
   }
 
   // Makes and returns a new TokenPtr of type BYTE_CHAR_LITERAL.
   static TokenPtr make_byte_char (location_t locus, char byte_char)
   {
-    // return std::make_shared<Token> (BYTE_CHAR_LITERAL, locus, byte_char);
-    return TokenPtr (new Token (BYTE_CHAR_LITERAL, locus, byte_char));
+    return create (BYTE_CHAR_LITERAL, locus, byte_char);
   }
 
   // Makes and returns a new TokenPtr of type BYTE_STRING_LITERAL (fix).
   static TokenPtr make_byte_string (location_t locus, std::string &&str)
   {
-    // return std::make_shared<Token> (BYTE_STRING_LITERAL, locus, str);
-    return TokenPtr (new Token (BYTE_STRING_LITERAL, locus, std::move (str)));
+    return create (BYTE_STRING_LITERAL, locus, std::move (str));
   }
 
   // Makes and returns a new TokenPtr of type INNER_DOC_COMMENT.
   static TokenPtr make_inner_doc_comment (location_t locus, std::string &&str)
   {
-    return TokenPtr (new Token (INNER_DOC_COMMENT, locus, std::move (str)));
+    return create (INNER_DOC_COMMENT, locus, std::move (str));
   }
 
   // Makes and returns a new TokenPtr of type OUTER_DOC_COMMENT.
   static TokenPtr make_outer_doc_comment (location_t locus, std::string &&str)
   {
-    return TokenPtr (new Token (OUTER_DOC_COMMENT, locus, std::move (str)));
+    return create (OUTER_DOC_COMMENT, locus, std::move (str));
   }
 
   // Makes and returns a new TokenPtr of type LIFETIME.
   static TokenPtr make_lifetime (location_t locus, std::string &&str)
   {
-    // return std::make_shared<Token> (LIFETIME, locus, str);
-    return TokenPtr (new Token (LIFETIME, locus, std::move (str)));
+    return create (LIFETIME, locus, std::move (str));
   }
 
   // Gets id of the token.
@@ -417,6 +421,13 @@ returning empty string instead.", get_token_description()); return "";
 return *str;
 }*/
 
+  /* The buffer holding the text of the token when it is too large to be
+   * interned, or null. */
+  const std::shared_ptr<const std::string> &get_large_str () const
+  {
+    return large_str;
+  }
+
   // Gets token's type hint info.
   PrimitiveCoreType get_type_hint () const
   {
@@ -475,6 +486,22 @@ return *str;
 };
 } // namespace Rust
 
+namespace Rust {
+struct Token::Allocator : public Token
+{
+  template <typename... Args>
+  Allocator (Args &&...args) : Token (std::forward<Args> (args)...)
+  {}
+};
+
+template <typename... Args>
+TokenPtr
+Token::create (Args &&...args)
+{
+  return std::make_shared<Allocator> (std::forward<Args> (args)...);
+}
+} // namespace Rust
+
 namespace std {
 template <> struct hash<Rust::PrimitiveCoreType>
 {
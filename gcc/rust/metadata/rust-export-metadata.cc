@@ -23,10 +23,13 @@
 #include "rust-ast-dump.h"
 #include "rust-abi.h"
 #include "rust-item.h"
+#include "rust-macro.h"
 #include "rust-object-export.h"
+#include "rust-attribute-values.h"
 
 #include "md5.h"
 #include "rust-system.h"
+#include <zlib.h>
 
 namespace Rust {
 namespace Metadata {
@@ -52,6 +55,27 @@ ExportContext::pop_module_scope ()
   return poped;
 }
 
+std::string
+ExportContext::canonical_path_of (NodeId id, const std::string &name) const
+{
+  if (auto path = mappings.lookup_canonical_path (id))
+    return path->get ();
+
+  return name;
+}
+
+void
+ExportContext::add_def (const char *category, DefKind kind,
+			LocalDefId local_def_id, const std::string &name,
+			const std::string &path, const std::string &body)
+{
+  CategorySize &size = category_sizes[category];
+  size.count++;
+  size.bytes += body.size ();
+
+  writer.add_def (kind, local_def_id, name, path, body);
+}
+
 void
 ExportContext::emit_trait (const HIR::Trait &trait)
 {
@@ -63,7 +87,10 @@ ExportContext::emit_trait (const HIR::Trait &trait)
   AST::Dump dumper (oss);
   dumper.go (*item);
 
-  public_interface_buffer += oss.str ();
+  std::string name = trait.get_name ().as_string ();
+  add_def ("traits", DefKind::TRAIT, trait.get_mappings ().get_local_defid (),
+	   name, canonical_path_of (trait.get_mappings ().get_nodeid (), name),
+	   oss.str ());
 }
 
 void
@@ -80,12 +107,18 @@ ExportContext::emit_function (const HIR::Function &fn)
   // FIXME add assertion that item must be a vis_item;
   AST::VisItem &vis_item = static_cast<AST::VisItem &> (*item);
 
-  // if its a generic function we need to output the full declaration
-  // otherwise we can let people link against this
+  // if its a generic or #[inline] function we need to output the full
+  // declaration so that dependent crates can compile their own copy, otherwise
+  // we can let people link against this
+  bool is_inline = false;
+  for (const auto &attr : vis_item.get_outer_attrs ())
+    if (attr.get_builtin () == Values::BuiltinAttribute::INLINE)
+      is_inline = true;
 
   std::stringstream oss;
   AST::Dump dumper (oss);
-  if (!fn.has_generics ())
+  bool signature_only = !fn.has_generics () && !is_inline;
+  if (signature_only)
     {
       // FIXME assert that this is actually an AST::Function
       AST::Function &function = static_cast<AST::Function &> (vis_item);
@@ -100,6 +133,9 @@ ExportContext::emit_function (const HIR::Function &fn)
 				     fn.get_locus ());
 
       dumper.go (extern_block);
+
+      // the function is still owned by the crate's AST
+      extern_block.get_extern_items ().back ().release ();
     }
   else
     {
@@ -107,7 +143,11 @@ ExportContext::emit_function (const HIR::Function &fn)
     }
 
   // store the dump
-  public_interface_buffer += oss.str ();
+  std::string name = fn.get_function_name ().as_string ();
+  add_def (signature_only ? "function signatures" : "function bodies",
+	   DefKind::FUNCTION, fn.get_mappings ().get_local_defid (), name,
+	   canonical_path_of (fn.get_mappings ().get_nodeid (), name),
+	   oss.str ());
 }
 
 void
@@ -120,7 +160,54 @@ ExportContext::emit_macro (NodeId macro)
 
   dumper.go (*item);
 
-  public_interface_buffer += oss.str ();
+  // macros only live in the AST so they don't have a DefId
+  auto &def = static_cast<AST::MacroRulesDefinition &> (*item);
+  std::string name = def.get_rule_name ().as_string ();
+  add_def ("macros", DefKind::MACRO, UNKNOWN_LOCAL_DEFID, name, name,
+	   oss.str ());
+}
+
+void
+ExportContext::defer_constant (const HIR::ConstantItem &constant)
+{
+  std::string name = constant.get_identifier ().as_string ();
+  constants.push_back (
+    {constant.get_mappings ().get_hirid (),
+     constant.get_mappings ().get_local_defid (), name,
+     canonical_path_of (constant.get_mappings ().get_nodeid (), name)});
+}
+
+void
+ExportContext::emit_constants ()
+{
+  for (const auto &constant : constants)
+    {
+      // constants whose value is not a scalar are not exported, their
+      // initializer may refer to private items of the crate
+      auto value = mappings.lookup_const_value (constant.id);
+      if (!value)
+	continue;
+
+      std::string body = "pub const " + constant.name + ": " + value->first
+			 + " = " + value->second + ";";
+      add_def ("constants", DefKind::CONSTANT, constant.local_def_id,
+	       constant.name, constant.path, body);
+    }
+  constants.clear ();
+}
+
+void
+ExportContext::emit_instance (const std::string &path,
+			      const std::string &symbol)
+{
+  add_def ("instances", DefKind::INSTANCE, UNKNOWN_LOCAL_DEFID, symbol, path,
+	   "");
+}
+
+void
+ExportContext::finish ()
+{
+  public_interface_buffer = writer.serialize ();
 }
 
 const std::string &
@@ -144,7 +231,10 @@ public:
   void visit (HIR::TupleStruct &) override {}
   void visit (HIR::Enum &) override {}
   void visit (HIR::Union &) override {}
-  void visit (HIR::ConstantItem &) override {}
+  void visit (HIR::ConstantItem &constant) override
+  {
+    ctx.defer_constant (constant);
+  }
   void visit (HIR::StaticItem &) override {}
   void visit (HIR::ImplBlock &) override {}
   void visit (HIR::ExternBlock &) override {}
@@ -164,20 +254,26 @@ PublicInterface::PublicInterface (HIR::Crate &crate)
   : crate (crate), mappings (Analysis::Mappings::get ()), context ()
 {}
 
+std::unique_ptr<PublicInterface>
+PublicInterface::Gather (HIR::Crate &crate)
+{
+  std::unique_ptr<PublicInterface> interface (new PublicInterface (crate));
+  interface->gather_export_data ();
+  return interface;
+}
+
 void
-PublicInterface::Export (HIR::Crate &crate)
+PublicInterface::Export ()
 {
-  PublicInterface interface (crate);
-  interface.gather_export_data ();
-  interface.write_to_object_file ();
+  finish ();
+  write_to_object_file ();
 }
 
 void
-PublicInterface::ExportTo (HIR::Crate &crate, const std::string &output_path)
+PublicInterface::ExportTo (const std::string &output_path)
 {
-  PublicInterface interface (crate);
-  interface.gather_export_data ();
-  interface.write_to_path (output_path);
+  finish ();
+  write_to_path (output_path);
 }
 
 void
@@ -200,13 +296,42 @@ PublicInterface::gather_export_data ()
 }
 
 void
-PublicInterface::write_to_object_file () const
+PublicInterface::finish ()
+{
+  if (finished)
+    return;
+
+  context.emit_constants ();
+
+  // the generic instances are only known once the crate is compiled
+  for (const auto &instance : mappings.get_shared_instances ())
+    context.emit_instance (instance.first, instance.second);
+
+  context.finish ();
+  finished = true;
+}
+
+// Compress DATA into OUT, return false if zlib failed
+static bool
+zlib_compress (const std::string &data, std::string &out)
+{
+  uLongf size = compressBound (data.size ());
+  out.resize (size);
+  if (compress2 ((Bytef *) &out[0], &size, (const Bytef *) data.data (),
+		 data.size (), Z_BEST_COMPRESSION)
+      != Z_OK)
+    return false;
+
+  out.resize (size);
+  return true;
+}
+
+std::string
+PublicInterface::encode () const
 {
-  // done
   const auto &buf = context.get_interface_buffer ();
-  std::string size_buffer = std::to_string (buf.size ());
 
-  // md5 this
+  // md5 this, the checksum identifies the payload whatever its encoding
   struct md5_ctx chksm;
   unsigned char checksum[16];
 
@@ -214,19 +339,37 @@ PublicInterface::write_to_object_file () const
   md5_process_bytes (buf.c_str (), buf.size (), &chksm);
   md5_finish_ctx (&chksm, checksum);
 
-  // MAGIC MD5 DLIM  DLIM buffer-size DELIM contents
+  std::string compressed;
+  bool is_compressed
+    = flag_rust_compress_metadata && zlib_compress (buf, compressed);
+  const std::string &payload = is_compressed ? compressed : buf;
+  const char *encoding = is_compressed ? kEncodingZlib : kEncodingRaw;
+
+  // MAGIC MD5 DLIM crate DLIM encoding DLIM buffer-size DLIM stored-size DLIM
+  // contents
   const std::string current_crate_name = mappings.get_current_crate_name ();
 
-  // extern void
-  rust_write_export_data (kMagicHeader, sizeof (kMagicHeader));
-  rust_write_export_data ((const char *) checksum, sizeof (checksum));
-  rust_write_export_data (kSzDelim, sizeof (kSzDelim));
-  rust_write_export_data (current_crate_name.c_str (),
-			  current_crate_name.size ());
-  rust_write_export_data (kSzDelim, sizeof (kSzDelim));
-  rust_write_export_data (size_buffer.c_str (), size_buffer.size ());
-  rust_write_export_data (kSzDelim, sizeof (kSzDelim));
-  rust_write_export_data (buf.c_str (), buf.size ());
+  std::string data (kMagicHeader, sizeof (kMagicHeader));
+  data.append ((const char *) checksum, sizeof (checksum));
+  data.append (kSzDelim, sizeof (kSzDelim));
+  data += current_crate_name;
+  data.append (kSzDelim, sizeof (kSzDelim));
+  data += encoding;
+  data.append (kSzDelim, sizeof (kSzDelim));
+  data += std::to_string (buf.size ());
+  data.append (kSzDelim, sizeof (kSzDelim));
+  data += std::to_string (payload.size ());
+  data.append (kSzDelim, sizeof (kSzDelim));
+  data += payload;
+
+  return data;
+}
+
+void
+PublicInterface::write_to_object_file () const
+{
+  std::string data = encode ();
+  rust_write_export_data (data.c_str (), data.size ());
 }
 
 void
@@ -244,100 +387,38 @@ PublicInterface::write_to_path (const std::string &path) const
       return;
     }
 
-  // done
-  const auto &buf = context.get_interface_buffer ();
-  std::string size_buffer = std::to_string (buf.size ());
-
-  // md5 this
-  struct md5_ctx chksm;
-  unsigned char checksum[16];
-
-  md5_init_ctx (&chksm);
-  md5_process_bytes (buf.c_str (), buf.size (), &chksm);
-  md5_finish_ctx (&chksm, checksum);
+  std::string data = encode ();
 
-  // MAGIC MD5 DLIM  DLIM buffer-size DELIM contents
-  const std::string current_crate_name = mappings.get_current_crate_name ();
-
-  // write to path
-  FILE *nfd = fopen (path.c_str (), "wb");
+  // write to a temporary file renamed over PATH, so that a crate reading the
+  // metadata concurrently never sees it half written
+  std::string tmp_path = path + "." + std::to_string (getpid ()) + ".tmp";
+  FILE *nfd = fopen (tmp_path.c_str (), "wb");
   if (nfd == NULL)
     {
       rust_error_at (UNDEF_LOCATION,
 		     "failed to open file %<%s%> for writing: %s",
-		     path.c_str (), xstrerror (errno));
+		     tmp_path.c_str (), xstrerror (errno));
       return;
     }
 
   // write data
-  if (fwrite (kMagicHeader, sizeof (kMagicHeader), 1, nfd) < 1)
-    {
-      rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
-      return;
-    }
-
-  if (fwrite (checksum, sizeof (checksum), 1, nfd) < 1)
-    {
-      rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
-      return;
-    }
-
-  if (fwrite (kSzDelim, sizeof (kSzDelim), 1, nfd) < 1)
-    {
-      rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
-      return;
-    }
-
-  if (fwrite (current_crate_name.c_str (), current_crate_name.size (), 1, nfd)
-      < 1)
-    {
-      rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
-      return;
-    }
-
-  if (fwrite (kSzDelim, sizeof (kSzDelim), 1, nfd) < 1)
-    {
-      rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
-      return;
-    }
-
-  if (fwrite (size_buffer.c_str (), size_buffer.size (), 1, nfd) < 1)
+  bool ok = fwrite (data.c_str (), data.size (), 1, nfd) == 1;
+  ok = fclose (nfd) == 0 && ok;
+  if (!ok)
     {
       rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
+		     tmp_path.c_str (), xstrerror (errno));
+      unlink (tmp_path.c_str ());
       return;
     }
 
-  if (fwrite (kSzDelim, sizeof (kSzDelim), 1, nfd) < 1)
+  // done
+  if (rename (tmp_path.c_str (), path.c_str ()) != 0)
     {
-      rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		     path.c_str (), xstrerror (errno));
-      fclose (nfd);
-      return;
+      rust_error_at (UNDEF_LOCATION, "failed to rename %<%s%> to %<%s%>: %s",
+		     tmp_path.c_str (), path.c_str (), xstrerror (errno));
+      unlink (tmp_path.c_str ());
     }
-
-  if (!buf.empty ())
-    if (fwrite (buf.c_str (), buf.size (), 1, nfd) < 1)
-      {
-	rust_error_at (UNDEF_LOCATION, "failed to write to file %<%s%>: %s",
-		       path.c_str (), xstrerror (errno));
-	fclose (nfd);
-	return;
-      }
-
-  // done
-  fclose (nfd);
 }
 
 bool
@@ -22,13 +22,22 @@
 #include "rust-system.h"
 #include "rust-hir-full-decls.h"
 #include "rust-hir-map.h"
+#include "rust-metadata-format.h"
 
 namespace Rust {
 namespace Metadata {
 
-static const char kMagicHeader[4] = {'G', 'R', 'S', 'T'};
+// Bumped whenever the layout of the header changes. Crates written with the
+// first header, which had no encoding nor sizes, are still recognized so that
+// they can be reported as outdated.
+static const char kMagicHeader[4] = {'G', 'R', 'S', '2'};
+static const char kMagicHeaderV1[4] = {'G', 'R', 'S', 'T'};
 static const char kSzDelim[1] = {'$'};
 
+// How the payload is stored, named in the header after the crate name
+static const char kEncodingRaw[] = "raw";
+static const char kEncodingZlib[] = "zlib";
+
 class ExportContext
 {
 public:
@@ -50,29 +59,83 @@ public:
    */
   void emit_macro (NodeId macro);
 
+  // Constants are only known once the crate is compiled, so they are emitted
+  // by emit_constants once their values are available
+  void defer_constant (const HIR::ConstantItem &constant);
+  void emit_constants ();
+
+  // Record that the instance of the generic at PATH named SYMBOL is emitted
+  // by this crate
+  void emit_instance (const std::string &path, const std::string &symbol);
+
+  // Encode every emitted item into the interface buffer
+  void finish ();
+
   const std::string &get_interface_buffer () const;
 
+  struct CategorySize
+  {
+    size_t count = 0;
+    size_t bytes = 0;
+  };
+
+  // The number of exported items and the size of their bodies, by category
+  const std::map<std::string, CategorySize> &get_category_sizes () const
+  {
+    return category_sizes;
+  }
+
 private:
+  std::string canonical_path_of (NodeId id, const std::string &name) const;
+
+  void add_def (const char *category, DefKind kind, LocalDefId local_def_id,
+		const std::string &name, const std::string &path,
+		const std::string &body);
+
   Analysis::Mappings &mappings;
 
   std::vector<std::reference_wrapper<const HIR::Module>> module_stack;
+
+  struct DeferredConstant
+  {
+    HirId id;
+    LocalDefId local_def_id;
+    std::string name;
+    std::string path;
+  };
+  std::vector<DeferredConstant> constants;
+  MetadataWriter writer;
   std::string public_interface_buffer;
+  std::map<std::string, CategorySize> category_sizes;
 };
 
 class PublicInterface
 {
 public:
-  static void Export (HIR::Crate &crate);
+  /* Gather the items exported by CRATE. This reads the AST of the crate, so
+   * it must be done before the AST is freed, while the interface is only
+   * written once the crate is compiled. */
+  static std::unique_ptr<PublicInterface> Gather (HIR::Crate &crate);
+
+  void Export ();
 
-  static void ExportTo (HIR::Crate &crate, const std::string &output_path);
+  void ExportTo (const std::string &output_path);
 
   static bool is_crate_public (const HIR::VisItem &item);
 
+  const ExportContext &get_context () const { return context; }
+
   static std::string expected_metadata_filename ();
 
 protected:
   void gather_export_data ();
 
+  void finish ();
+
+  // The framing header followed by the payload, compressed when
+  // -frust-compress-metadata is given
+  std::string encode () const;
+
   void write_to_object_file () const;
 
   void write_to_path (const std::string &path) const;
@@ -83,6 +146,7 @@ private:
   HIR::Crate &crate;
   Analysis::Mappings &mappings;
   ExportContext context;
+  bool finished = false;
 };
 
 } // namespace Metadata
@@ -21,19 +21,158 @@
 #include "rust-export-metadata.h"
 
 #include "md5.h"
+#include <zlib.h>
 
 namespace Rust {
 namespace Imports {
 
-ExternCrate::ExternCrate (Import::Stream &stream) : import_stream (stream) {}
+ExternCrate::ExternCrate (Import::Stream &stream)
+  : import_stream (stream), metadata (nullptr), metadata_size (0)
+{}
 
 ExternCrate::ExternCrate (const std::string &crate_name,
-			  std::vector<ProcMacro::Procmacro> macros)
-  : proc_macros (macros), crate_name (crate_name)
+			  std::vector<LoadedProcMacro> macros)
+  : proc_macros (macros), crate_name (crate_name), metadata (nullptr),
+    metadata_size (0)
 {}
 
 ExternCrate::~ExternCrate () {}
 
+// One file per payload, named after the hex encoding of its md5
+static std::string
+cache_entry_path (const std::string &cache_dir, const unsigned char *checksum,
+		  size_t checksum_size)
+{
+  static const char hex_digits[] = "0123456789abcdef";
+
+  std::string path = cache_dir + "/";
+  for (size_t i = 0; i < checksum_size; i++)
+    {
+      path += hex_digits[checksum[i] >> 4];
+      path += hex_digits[checksum[i] & 0xf];
+    }
+
+  return path + ".meta";
+}
+
+// Does the md5 of the SIZE bytes at DATA match CHECKSUM?
+static bool
+checksum_matches (const char *data, size_t size,
+		  const unsigned char checksum[16])
+{
+  struct md5_ctx chksm;
+  unsigned char computed_checksum[16];
+
+  md5_init_ctx (&chksm);
+  md5_process_bytes (data, size, &chksm);
+  md5_finish_ctx (&chksm, computed_checksum);
+
+  return memcmp (computed_checksum, checksum, sizeof (computed_checksum)) == 0;
+}
+
+/* Read the entry at PATH into BUFFER. Whoever wrote it, an entry is only used
+   once its contents match CHECKSUM again, and a corrupted entry is removed so
+   that the next fresh read replaces it.  */
+
+static bool
+read_cached_metadata (const std::string &path, size_t expected_size,
+		      const unsigned char checksum[16], std::string &buffer)
+{
+  FILE *file = fopen (path.c_str (), "rb");
+  if (file == NULL)
+    return false;
+
+  struct stat statbuf;
+  bool ok = fstat (fileno (file), &statbuf) == 0
+	    && (size_t) statbuf.st_size == expected_size;
+  if (ok)
+    {
+      buffer.resize (expected_size);
+      ok = expected_size == 0
+	   || fread (&buffer[0], expected_size, 1, file) == 1;
+      if (!ok)
+	buffer.clear ();
+    }
+
+  fclose (file);
+
+  if (ok && !checksum_matches (buffer.data (), buffer.size (), checksum))
+    {
+      rust_debug ("discarding corrupted metadata cache entry %s",
+		  path.c_str ());
+      unlink (path.c_str ());
+      buffer.clear ();
+      ok = false;
+    }
+
+  return ok;
+}
+
+/* Entries are written under a temporary name and renamed into place, so that
+   concurrent compilations never see a partially written entry. Failing to
+   populate the cache is not an error.  */
+
+static void
+write_cached_metadata (const std::string &cache_dir, const std::string &path,
+		       const char *data, size_t size)
+{
+  if (mkdir (cache_dir.c_str (), 0777) != 0 && errno != EEXIST)
+    return;
+
+  std::string tmp_path = path + "." + std::to_string (getpid ()) + ".tmp";
+  FILE *file = fopen (tmp_path.c_str (), "wb");
+  if (file == NULL)
+    return;
+
+  bool ok = size == 0 || fwrite (data, size, 1, file) == 1;
+  ok = fclose (file) == 0 && ok;
+
+  if (!ok || rename (tmp_path.c_str (), path.c_str ()) != 0)
+    {
+      rust_debug ("failed to store metadata cache entry %s", path.c_str ());
+      unlink (tmp_path.c_str ());
+    }
+}
+
+// Read the bytes up to the next delimiter into FIELD, and skip the delimiter
+static bool
+read_field (Import::Stream &stream, std::string &field)
+{
+  while (!stream.saw_error () && !stream.at_eof ())
+    {
+      unsigned char byte = stream.get_char ();
+      if (memcmp (&byte, Metadata::kSzDelim, sizeof (Metadata::kSzDelim)) == 0)
+	return true;
+
+      field += byte;
+    }
+
+  return false;
+}
+
+/* Inflate the SIZE bytes at DATA into OUT, which holds exactly the expected
+   size of the payload. */
+
+static bool
+zlib_decompress (const char *data, size_t size, std::string &out)
+{
+  z_stream stream;
+  memset (&stream, 0, sizeof (stream));
+  if (inflateInit (&stream) != Z_OK)
+    return false;
+
+  stream.next_in = (Bytef *) data;
+  stream.avail_in = size;
+  stream.next_out = (Bytef *) &out[0];
+  stream.avail_out = out.size ();
+
+  int status = inflate (&stream, Z_FINISH);
+  bool ok = status == Z_STREAM_END && stream.avail_out == 0;
+  inflateEnd (&stream);
+
+  return ok;
+}
+
 bool
 ExternCrate::ok () const
 {
@@ -41,11 +180,26 @@ ExternCrate::ok () const
 }
 
 bool
-ExternCrate::load (location_t locus)
+ExternCrate::load (location_t locus,
+		   tl::optional<const std::string &> cache_dir)
 {
   rust_assert (this->import_stream.has_value ());
   auto &import_stream = this->import_stream->get ();
   // match header
+  const char *magic;
+  if (import_stream.peek (sizeof (Metadata::kMagicHeaderV1), &magic)
+      && memcmp (magic, Metadata::kMagicHeaderV1,
+		 sizeof (Metadata::kMagicHeaderV1))
+	   == 0)
+    {
+      rust_error_at (locus,
+		     "the metadata of crate %qs was written by an older "
+		     "version of the compiler, it must be rebuilt",
+		     crate_name.c_str ());
+      import_stream.set_saw_error ();
+      return false;
+    }
+
   import_stream.require_bytes (locus, Metadata::kMagicHeader,
 			       sizeof (Metadata::kMagicHeader));
   if (import_stream.saw_error ())
@@ -53,12 +207,14 @@ ExternCrate::load (location_t locus)
 
   // parse 16 bytes md5
   unsigned char checksum[16];
-  bool ok
-    = import_stream.do_peek (sizeof (checksum), (const char **) &checksum);
+  const char *checksum_bytes;
+  bool ok = import_stream.do_peek (sizeof (checksum), &checksum_bytes);
   if (!ok)
     return false;
 
+  memcpy (checksum, checksum_bytes, sizeof (checksum));
   import_stream.advance (sizeof (checksum));
+  this->checksum.assign ((const char *) checksum, sizeof (checksum));
 
   // parse delim
   import_stream.require_bytes (locus, Metadata::kSzDelim,
@@ -67,39 +223,40 @@ ExternCrate::load (location_t locus)
     return false;
 
   // parse crate name
-  bool saw_delim = false;
-  while (!import_stream.saw_error () && !import_stream.at_eof ())
+  if (!read_field (import_stream, crate_name) || crate_name.empty ())
     {
-      unsigned char byte = import_stream.get_char ();
-      saw_delim
-	= memcmp (&byte, Metadata::kSzDelim, sizeof (Metadata::kSzDelim)) == 0;
-      if (saw_delim)
-	break;
+      import_stream.set_saw_error ();
+      rust_error_at (locus, "failed to read crate name field");
 
-      crate_name += byte;
+      return false;
     }
-  if (!saw_delim || crate_name.empty ())
+
+  std::string encoding;
+  if (!read_field (import_stream, encoding))
     {
       import_stream.set_saw_error ();
-      rust_error_at (locus, "failed to read crate name field");
+      rust_error_at (locus, "failed to read metadata encoding");
 
       return false;
     }
 
-  // read until delim which is the size of the meta data
-  std::string metadata_length_buffer;
-  saw_delim = false;
-  while (!import_stream.saw_error () && !import_stream.at_eof ())
+  bool is_compressed = encoding == Metadata::kEncodingZlib;
+  if (!is_compressed && encoding != Metadata::kEncodingRaw)
     {
-      unsigned char byte = import_stream.get_char ();
-      saw_delim
-	= memcmp (&byte, Metadata::kSzDelim, sizeof (Metadata::kSzDelim)) == 0;
-      if (saw_delim)
-	break;
+      import_stream.set_saw_error ();
+      rust_error_at (locus, "unknown metadata encoding %qs in crate %qs",
+		     encoding.c_str (), crate_name.c_str ());
 
-      metadata_length_buffer += byte;
+      return false;
     }
-  if (!saw_delim || metadata_length_buffer.empty ())
+
+  // the size of the meta data, then the size it takes in the stream
+  std::string metadata_length_buffer;
+  std::string stored_length_buffer;
+  if (!read_field (import_stream, metadata_length_buffer)
+      || metadata_length_buffer.empty ()
+      || !read_field (import_stream, stored_length_buffer)
+      || stored_length_buffer.empty ())
     {
       import_stream.set_saw_error ();
       rust_error_at (locus, "failed to read metatadata size");
@@ -107,42 +264,81 @@ ExternCrate::load (location_t locus)
       return false;
     }
 
-  // interpret the string size
+  // interpret the string sizes
   int expected_buffer_length = -1;
   ok = ExternCrate::string_to_int (locus, metadata_length_buffer, false,
 				   &expected_buffer_length);
   if (!ok)
     return false;
 
-  // read the parsed size and it should be eof
-  metadata_buffer.reserve (expected_buffer_length);
-  for (int i = 0; i < expected_buffer_length && !import_stream.saw_error ()
-		  && !import_stream.at_eof ();
-       i++)
+  int stored_buffer_length = -1;
+  ok = ExternCrate::string_to_int (locus, stored_length_buffer, false,
+				   &stored_buffer_length);
+  if (!ok)
+    return false;
+
+  // entries hold the inflated payload, so only compressed payloads are worth
+  // caching: a raw one is already read straight out of the stream
+  std::string cache_path;
+  if (cache_dir.has_value () && is_compressed)
     {
-      metadata_buffer += import_stream.get_char ();
+      cache_path
+	= cache_entry_path (cache_dir.value (), checksum, sizeof (checksum));
+      if (read_cached_metadata (cache_path, expected_buffer_length, checksum,
+				metadata_storage))
+	{
+	  metadata = metadata_storage.data ();
+	  metadata_size = metadata_storage.size ();
+	  return true;
+	}
     }
 
-  // compute the md5
-  struct md5_ctx chksm;
-  unsigned char computed_checksum[16];
+  // the rest of the stream is the payload, take it in one go
+  const char *stored;
+  if (!import_stream.read_view (stored_buffer_length, &stored))
+    {
+      import_stream.set_saw_error ();
+      rust_error_at (locus, "truncated metadata in crate %qs",
+		     crate_name.c_str ());
 
-  md5_init_ctx (&chksm);
-  md5_process_bytes (metadata_buffer.c_str (), metadata_buffer.size (), &chksm);
-  md5_finish_ctx (&chksm, computed_checksum);
+      return false;
+    }
+
+  if (is_compressed)
+    {
+      // inflate straight from the view of the stream
+      metadata_storage.resize (expected_buffer_length);
+      if (!zlib_decompress (stored, stored_buffer_length, metadata_storage))
+	{
+	  import_stream.set_saw_error ();
+	  rust_error_at (locus, "corrupted metadata in crate %qs",
+			 crate_name.c_str ());
+
+	  return false;
+	}
+      metadata = metadata_storage.data ();
+    }
+  else if (stored_buffer_length == expected_buffer_length)
+    metadata = stored;
+  else
+    {
+      import_stream.set_saw_error ();
+      rust_error_at (locus, "failed to read metatadata size");
+
+      return false;
+    }
+  metadata_size = expected_buffer_length;
+
+  if (!checksum_matches (metadata, metadata_size, checksum))
+    {
+      rust_error_at (locus, "checksum mismatch in metadata of crate %qs",
+		     crate_name.c_str ());
+      return false;
+    }
 
-  // FIXME i think the encoding and decoding of md5 is going wrong or else we
-  // are not computing it correctly
-  //
-  // compare the checksums
-  // if (memcmp(computed_checksum, checksum, sizeof (checksum)) != 0)
-  //   {
-  //     rust_error_at (locus,
-  //       	     "checksum mismatch in metadata: %<%.*s%> vs %<%.*s%>",
-  //       	     sizeof (computed_checksum), computed_checksum,
-  //       	     sizeof (checksum), checksum);
-  //     return false;
-  //   }
+  if (!cache_path.empty ())
+    write_cached_metadata (cache_dir.value (), cache_path, metadata,
+			   metadata_size);
 
   // all good
   return true;
@@ -154,10 +350,16 @@ ExternCrate::get_crate_name () const
   return crate_name;
 }
 
-const std::string &
+const char *
 ExternCrate::get_metadata () const
 {
-  return metadata_buffer;
+  return metadata;
+}
+
+size_t
+ExternCrate::get_metadata_size () const
+{
+  return metadata_size;
 }
 
 // Turn a string into a integer with appropriate error handling.
@@ -31,28 +31,43 @@ class ExternCrate
 public:
   ExternCrate (Import::Stream &stream);
   ExternCrate (const std::string &crate_name,
-	       std::vector<ProcMacro::Procmacro> macros);
+	       std::vector<LoadedProcMacro> macros);
   ~ExternCrate ();
 
   bool ok () const;
 
-  bool load (location_t locus);
+  // Read the metadata from the stream. When CACHE_DIR is set, a compressed
+  // payload is looked up there inflated by checksum first, and stored there
+  // after a fresh read. Cached entries are checked against the checksum.
+  bool load (location_t locus,
+	     tl::optional<const std::string &> cache_dir = tl::nullopt);
 
   const std::string &get_crate_name () const;
 
-  const std::string &get_metadata () const;
+  // The md5 of the payload as recorded in the header, which identifies the
+  // crate whatever name or path it was found under
+  const std::string &get_checksum () const { return checksum; }
 
-  std::vector<ProcMacro::Procmacro> &get_proc_macros () { return proc_macros; }
+  // The payload is a view into the import stream, or into the cache entry it
+  // was loaded from, and is only valid as long as the stream is alive
+  const char *get_metadata () const;
+  size_t get_metadata_size () const;
+
+  std::vector<LoadedProcMacro> &get_proc_macros () { return proc_macros; }
 
   static bool string_to_int (location_t locus, const std::string &s,
 			     bool is_neg_ok, int *ret);
 
 private:
   tl::optional<std::reference_wrapper<Import::Stream>> import_stream;
-  std::vector<ProcMacro::Procmacro> proc_macros;
+  std::vector<LoadedProcMacro> proc_macros;
 
   std::string crate_name;
-  std::string metadata_buffer;
+  std::string checksum;
+  const char *metadata;
+  size_t metadata_size;
+  // owns the payload when it comes from the metadata cache
+  std::string metadata_storage;
 };
 
 } // namespace Imports
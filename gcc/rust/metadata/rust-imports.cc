@@ -22,6 +22,10 @@
 #include "rust-object-export.h"
 #include "rust-export-metadata.h"
 #include "rust-make-unique.h"
+#include "rust-make-deps.h"
+#include "selftest.h"
+
+#include <dirent.h>
 
 #ifndef O_BINARY
 #define O_BINARY 0
@@ -40,6 +44,63 @@ add_search_path (const std::string &path)
   search_path.push_back (path);
 }
 
+// The entries of the directories on the search path, listed the first time
+// an import is looked up in them.  Probing for every candidate file name in
+// every directory costs several failing system calls per import, which adds
+// up on network file systems.  Directories which cannot be listed map to
+// nullopt and are always probed.
+static std::map<std::string, tl::optional<std::set<std::string>>>
+  directory_entries;
+
+static const tl::optional<std::set<std::string>> &
+list_directory (const std::string &dir)
+{
+  auto it = directory_entries.find (dir);
+  if (it != directory_entries.end ())
+    return it->second;
+
+  tl::optional<std::set<std::string>> entries = tl::nullopt;
+  DIR *d = opendir (dir.empty () ? "." : dir.c_str ());
+  if (d != nullptr)
+    {
+      entries = std::set<std::string> ();
+      while (struct dirent *entry = readdir (d))
+	entries->insert (entry->d_name);
+      closedir (d);
+    }
+  else if (errno == ENOENT || errno == ENOTDIR)
+    {
+      // nothing can be found there
+      entries = std::set<std::string> ();
+    }
+
+  return directory_entries.emplace (dir, std::move (entries)).first->second;
+}
+
+// Return whether the search path directory DIR may hold FILENAME or one of
+// the files try_suffixes derives from it.
+
+static bool
+may_contain_package (const std::string &dir, const std::string &filename)
+{
+  // only the entries of DIR itself are listed
+  for (char c : filename)
+    if (IS_DIR_SEPARATOR (c))
+      return true;
+
+  const auto &entries = list_directory (dir);
+  if (!entries)
+    return true;
+
+  for (const auto &candidate :
+       {filename, filename + ".rox", "lib" + filename + ".so",
+	"lib" + filename + ".a", filename + ".o"})
+    if (entries->count (candidate))
+      return true;
+
+  return false;
+}
+
 // Find import data.  This searches the file system for FILENAME and
 // returns a pointer to a Stream object to read the data that it
 // exports.  If the file is not found, it returns NULL.
@@ -63,7 +124,7 @@ add_search_path (const std::string &path)
 // stop; we do not keep looking for another file with the same name
 // later in the search path.
 
-std::pair<std::unique_ptr<Import::Stream>, std::vector<ProcMacro::Procmacro>>
+std::pair<std::unique_ptr<Import::Stream>, std::vector<LoadedProcMacro>>
 Import::open_package (const std::string &filename, location_t location,
 		      const std::string &relative_import_path)
 {
@@ -117,6 +178,9 @@ Import::open_package (const std::string &filename, location_t location,
       for (std::vector<std::string>::const_iterator p = search_path.begin ();
 	   p != search_path.end (); ++p)
 	{
+	  if (!may_contain_package (*p, fn))
+	    continue;
+
 	  std::string indir = *p;
 	  if (!indir.empty () && indir[indir.size () - 1] != '/')
 	    indir += '/';
@@ -131,12 +195,12 @@ Import::open_package (const std::string &filename, location_t location,
   if (s.first != nullptr)
     return s;
 
-  return std::make_pair (nullptr, std::vector<ProcMacro::Procmacro>{});
+  return std::make_pair (nullptr, std::vector<LoadedProcMacro>{});
 }
 
 // Try to find the export data for FILENAME.
 
-std::pair<std::unique_ptr<Import::Stream>, std::vector<ProcMacro::Procmacro>>
+std::pair<std::unique_ptr<Import::Stream>, std::vector<LoadedProcMacro>>
 Import::try_package_in_directory (const std::string &filename,
 				  location_t location)
 {
@@ -161,9 +225,11 @@ Import::try_package_in_directory (const std::string &filename,
 
       fd = Import::try_suffixes (&found_filename);
       if (fd < 0)
-	return std::make_pair (nullptr, std::vector<ProcMacro::Procmacro>{});
+	return std::make_pair (nullptr, std::vector<LoadedProcMacro>{});
     }
 
+  MakeDependencies::get ().add_dependency (found_filename);
+
   auto macros = load_macros (found_filename);
 
   // The export data may not be in this file.
@@ -258,7 +324,10 @@ Import::find_export_data (const std::string &filename, int fd,
   // FIXME we need to work out a better header
   //
   if (memcmp (buf, Metadata::kMagicHeader, sizeof (Metadata::kMagicHeader))
-      == 0)
+	== 0
+      || memcmp (buf, Metadata::kMagicHeaderV1,
+		 sizeof (Metadata::kMagicHeaderV1))
+	   == 0)
     return Rust::make_unique<Stream_from_file> (fd);
 
   // See if we can read this as an archive.
@@ -274,9 +343,35 @@ std::unique_ptr<Import::Stream>
 Import::find_object_export_data (const std::string &filename, int fd,
 				 off_t offset, location_t location)
 {
+  int err;
+#if HAVE_MMAP_FILE
+  // map the export data rather than copying it, the section is found with
+  // the same lookup which rust_read_export_data does
+  off_t sec_offset;
+  off_t sec_length;
+  const char *find_errmsg
+    = rust_find_export_data (fd, offset, &sec_offset, &sec_length, &err);
+  if (find_errmsg == nullptr && sec_length == 0)
+    return nullptr;
+
+  if (find_errmsg == nullptr)
+    {
+      off_t start = offset + sec_offset;
+      off_t page_start = start & ~static_cast<off_t> (getpagesize () - 1);
+      size_t map_length = sec_length + (start - page_start);
+      void *map
+	= mmap (NULL, map_length, PROT_READ, MAP_PRIVATE, fd, page_start);
+      if (map != MAP_FAILED)
+	return Rust::make_unique<Stream_from_mapping> (
+	  map, map_length, static_cast<char *> (map) + (start - page_start),
+	  sec_length);
+    }
+
+  // fall back to reading a copy, which reports the errors
+#endif
+
   char *buf;
   size_t len;
-  int err;
   const char *errmsg = rust_read_export_data (fd, offset, &buf, &len, &err);
   if (errmsg != nullptr)
     {
@@ -376,7 +471,11 @@ Import::Stream::require_bytes (location_t location, const char *bytes,
 
 // Class Stream_from_file.
 
-Stream_from_file::Stream_from_file (int fd) : fd_ (fd), data_ ()
+// The file is read in blocks of at least this many bytes.
+static const size_t kReadAhead = 64 * 1024;
+
+Stream_from_file::Stream_from_file (int fd)
+  : fd_ (fd), data_ (), offset_ (0), view_ ()
 {
   if (lseek (fd, 0, SEEK_SET) != 0)
     {
@@ -387,40 +486,50 @@ Stream_from_file::Stream_from_file (int fd) : fd_ (fd), data_ ()
 
 Stream_from_file::~Stream_from_file () { close (this->fd_); }
 
-// Read next bytes.
+// Read ahead until at least LENGTH bytes past the read position are
+// buffered.  Returns false if the file ends before that.
 
 bool
-Stream_from_file::do_peek (size_t length, const char **bytes)
+Stream_from_file::fill (size_t length)
 {
-  if (this->data_.length () >= length)
-    {
-      *bytes = this->data_.data ();
-      return true;
-    }
+  // drop the bytes which were already consumed
+  this->data_.erase (0, this->offset_);
+  this->offset_ = 0;
 
-  this->data_.resize (length);
-  ssize_t got = ::read (this->fd_, &this->data_[0], length);
-
-  if (got < 0)
+  size_t target = std::max (length, kReadAhead);
+  while (this->data_.length () < length)
     {
-      if (!this->saw_error ())
-	rust_fatal_error (UNKNOWN_LOCATION, "read failed: %m");
-      this->set_saw_error ();
-      return false;
-    }
+      size_t have = this->data_.length ();
+      this->data_.resize (target);
+      ssize_t got = ::read (this->fd_, &this->data_[have], target - have);
+      if (got < 0)
+	{
+	  this->data_.resize (have);
+	  if (errno == EINTR)
+	    continue;
+	  if (!this->saw_error ())
+	    rust_fatal_error (UNKNOWN_LOCATION, "read failed: %m");
+	  this->set_saw_error ();
+	  return false;
+	}
 
-  if (lseek (this->fd_, -got, SEEK_CUR) < 0)
-    {
-      if (!this->saw_error ())
-	rust_fatal_error (UNKNOWN_LOCATION, "lseek failed: %m");
-      this->set_saw_error ();
-      return false;
+      this->data_.resize (have + got);
+      if (got == 0)
+	return false;
     }
 
-  if (static_cast<size_t> (got) < length)
+  return true;
+}
+
+// Read next bytes.
+
+bool
+Stream_from_file::do_peek (size_t length, const char **bytes)
+{
+  if (this->data_.length () - this->offset_ < length && !this->fill (length))
     return false;
 
-  *bytes = this->data_.data ();
+  *bytes = this->data_.data () + this->offset_;
   return true;
 }
 
@@ -429,19 +538,109 @@ Stream_from_file::do_peek (size_t length, const char **bytes)
 void
 Stream_from_file::do_advance (size_t skip)
 {
-  if (lseek (this->fd_, skip, SEEK_CUR) < 0)
+  size_t buffered = this->data_.length () - this->offset_;
+  if (skip <= buffered)
+    {
+      this->offset_ += skip;
+      return;
+    }
+
+  this->data_.clear ();
+  this->offset_ = 0;
+  if (lseek (this->fd_, skip - buffered, SEEK_CUR) < 0)
     {
       if (!this->saw_error ())
 	rust_fatal_error (UNKNOWN_LOCATION, "lseek failed: %m");
       this->set_saw_error ();
     }
-  if (!this->data_.empty ())
+}
+
+// Read a whole block with as few system calls as possible.
+
+bool
+Stream_from_file::do_read_view (size_t length, const char **bytes)
+{
+  // a later peek may move the buffered bytes, so they are copied out
+  size_t buffered = std::min (length, this->data_.length () - this->offset_);
+  this->view_.assign (this->data_, this->offset_, buffered);
+  this->view_.resize (length);
+  this->offset_ += buffered;
+
+  // the rest of a large block is read in place rather than through the
+  // read-ahead buffer
+  size_t total = buffered;
+  while (total < length)
     {
-      if (this->data_.length () > skip)
-	this->data_.erase (0, skip);
-      else
-	this->data_.clear ();
+      ssize_t got = ::read (this->fd_, &this->view_[total], length - total);
+      if (got < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (!this->saw_error ())
+	    rust_fatal_error (UNKNOWN_LOCATION, "read failed: %m");
+	  this->set_saw_error ();
+	  return false;
+	}
+      if (got == 0)
+	break;
+      total += got;
+    }
+
+  if (total < length)
+    {
+      // the file ended, leave what was read to be peeked again
+      this->data_.assign (this->view_, 0, total);
+      this->offset_ = 0;
+      return false;
     }
+
+  *bytes = this->view_.data ();
+  return true;
 }
 
 } // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_imports_test (void)
+{
+  // larger than the read-ahead, so that the stream refills its buffer
+  std::string contents;
+  for (size_t i = 0; i < 3 * 64 * 1024 + 17; i++)
+    contents.push_back (static_cast<char> ('a' + i % 26));
+
+  temp_source_file file (SELFTEST_LOCATION, ".rox", contents.c_str ());
+  int fd = open (file.get_filename (), O_RDONLY | O_BINARY);
+  ASSERT_TRUE (fd >= 0);
+
+  Rust::Stream_from_file stream (fd);
+
+  // byte at a time
+  for (size_t i = 0; i < 100000; i++)
+    ASSERT_EQ (stream.get_char (), contents[i]);
+
+  const char *bytes;
+  ASSERT_TRUE (stream.peek (4, &bytes));
+  ASSERT_EQ (std::string (bytes, 4), contents.substr (100000, 4));
+
+  // a view spanning the buffered bytes and the rest of the file
+  ASSERT_TRUE (stream.read_view (90000, &bytes));
+  ASSERT_EQ (std::string (bytes, 90000), contents.substr (100000, 90000));
+
+  stream.advance (100);
+  ASSERT_EQ (stream.get_char (), contents[190100]);
+
+  // a view past the end of the file leaves the stream where it was
+  size_t rest = contents.length () - 190101;
+  ASSERT_FALSE (stream.read_view (rest + 1, &bytes));
+  ASSERT_TRUE (stream.read_view (rest, &bytes));
+  ASSERT_EQ (std::string (bytes, rest), contents.substr (190101));
+  ASSERT_TRUE (stream.at_eof ());
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -89,6 +89,19 @@ public:
     // is more convenient in error reporting.  FIXME.
     int pos () { return static_cast<int> (this->pos_); }
 
+    // Set *BYTES to point to the next LENGTH bytes and advance past
+    // them, copying only if the stream cannot hand out its own
+    // storage.  The bytes stay valid until the next call to this
+    // function or until the stream is destroyed.  Returns false if the
+    // bytes are not available.
+    bool read_view (size_t length, const char **bytes)
+    {
+      if (!this->do_read_view (length, bytes))
+	return false;
+      this->pos_ += length;
+      return true;
+    }
+
     // This function should set *BYTES to point to a buffer holding
     // the LENGTH bytes at the current read position.  It should
     // return false if the bytes are not available.  This should not
@@ -99,6 +112,18 @@ public:
     // bytes.
     virtual void do_advance (size_t skip) = 0;
 
+    // This function should set *BYTES to point to the LENGTH bytes at
+    // the current read position and advance past them.  The default
+    // is only correct for streams whose data does not move when
+    // advancing.
+    virtual bool do_read_view (size_t length, const char **bytes)
+    {
+      if (!this->do_peek (length, bytes))
+	return false;
+      this->do_advance (length);
+      return true;
+    }
+
   private:
     // The current read position.
     size_t pos_;
@@ -110,11 +135,11 @@ public:
   // returns a pointer to a Stream object to read the data that it
   // exports.  LOCATION is the location of the import statement.
   // RELATIVE_IMPORT_PATH is used as a prefix for a relative import.
-  static std::pair<std::unique_ptr<Stream>, std::vector<ProcMacro::Procmacro>>
+  static std::pair<std::unique_ptr<Stream>, std::vector<LoadedProcMacro>>
   open_package (const std::string &filename, location_t location,
 		const std::string &relative_import_path);
 
-  static std::pair<std::unique_ptr<Stream>, std::vector<ProcMacro::Procmacro>>
+  static std::pair<std::unique_ptr<Stream>, std::vector<LoadedProcMacro>>
   try_package_in_directory (const std::string &, location_t);
 
   // Constructor.
@@ -232,6 +257,51 @@ private:
   size_t pos_;
 };
 
+#if HAVE_MMAP_FILE
+
+// Read import data straight out of a read-only mapping of the file holding
+// it.  The mapping starts on the page holding the data.
+
+class Stream_from_mapping : public Import::Stream
+{
+public:
+  Stream_from_mapping (void *map, size_t map_length, const char *data,
+		       size_t length)
+    : map_ (map), map_length_ (map_length), data_ (data), length_ (length),
+      pos_ (0)
+  {}
+
+  ~Stream_from_mapping () { munmap (this->map_, this->map_length_); }
+
+  bool do_peek (size_t length, const char **bytes)
+  {
+    if (this->pos_ + length > this->length_)
+      return false;
+    *bytes = this->data_ + this->pos_;
+    return true;
+  }
+
+  void do_advance (size_t len) { this->pos_ += len; }
+
+private:
+  // No copying.
+  Stream_from_mapping (const Stream_from_mapping &);
+  Stream_from_mapping &operator= (const Stream_from_mapping &);
+
+  // The mapping, as returned by mmap.
+  void *map_;
+  // The size of the mapping.
+  size_t map_length_;
+  // The data we are reading, within the mapping.
+  const char *data_;
+  // The length of the data.
+  size_t length_;
+  // The current position within the data.
+  size_t pos_;
+};
+
+#endif // HAVE_MMAP_FILE
+
 // Read import data from an open file descriptor.
 
 class Stream_from_file : public Import::Stream
@@ -245,17 +315,34 @@ public:
 
   void do_advance (size_t);
 
+  bool do_read_view (size_t, const char **);
+
 private:
+  bool fill (size_t);
+
   // No copying.
   Stream_from_file (const Stream_from_file &);
   Stream_from_file &operator= (const Stream_from_file &);
 
   // The file descriptor.
   int fd_;
-  // Data read from the file.
+  // Data read ahead from the file.
   std::string data_;
+  // The read position within data_.
+  size_t offset_;
+  // Data handed out by do_read_view.
+  std::string view_;
 };
 
 } // namespace Rust
 
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_imports_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
 #endif // RUST_IMPORTS_H
@@ -0,0 +1,317 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-metadata-format.h"
+#include "selftest.h"
+
+namespace Rust {
+namespace Metadata {
+
+// magic + version + 4 (offset, size) section pairs
+static const size_t kHeaderSize = 8 + 4 * 8;
+static const size_t kDefRecordSize = 6 * 4;
+static const size_t kIndexRecordSize = 2 * 4;
+
+static void
+write_u32 (std::string &out, uint32_t value)
+{
+  out += static_cast<char> (value & 0xff);
+  out += static_cast<char> ((value >> 8) & 0xff);
+  out += static_cast<char> ((value >> 16) & 0xff);
+  out += static_cast<char> ((value >> 24) & 0xff);
+}
+
+uint32_t
+MetadataWriter::intern_string (const std::string &str)
+{
+  auto it = string_offsets.find (str);
+  if (it != string_offsets.end ())
+    return it->second;
+
+  uint32_t offset = strings.size ();
+  strings += str;
+  strings += '\0';
+  string_offsets.insert ({str, offset});
+
+  return offset;
+}
+
+void
+MetadataWriter::add_def (DefKind kind, LocalDefId local_def_id,
+			 const std::string &name, const std::string &path,
+			 const std::string &body)
+{
+  DefRecord record;
+  record.local_def_id = local_def_id;
+  record.kind = static_cast<uint32_t> (kind);
+  record.name = intern_string (name);
+  record.path = intern_string (path);
+  record.body_offset = blob.size ();
+  record.body_size = body.size ();
+
+  blob += body;
+  defs.push_back (record);
+}
+
+std::string
+MetadataWriter::serialize () const
+{
+  std::vector<std::pair<uint32_t, uint32_t>> index;
+  for (size_t i = 0; i < defs.size (); i++)
+    if (defs[i].local_def_id != UNKNOWN_LOCAL_DEFID)
+      index.push_back ({defs[i].local_def_id, i});
+  std::sort (index.begin (), index.end ());
+
+  uint32_t strings_offset = kHeaderSize;
+  uint32_t defs_offset = strings_offset + strings.size ();
+  uint32_t index_offset = defs_offset + defs.size () * kDefRecordSize;
+  uint32_t blob_offset = index_offset + index.size () * kIndexRecordSize;
+
+  std::string out;
+  out.reserve (blob_offset + blob.size ());
+
+  out.append (kBinaryMagic, sizeof (kBinaryMagic));
+  write_u32 (out, kFormatVersion);
+  write_u32 (out, strings_offset);
+  write_u32 (out, strings.size ());
+  write_u32 (out, defs_offset);
+  write_u32 (out, defs.size ());
+  write_u32 (out, index_offset);
+  write_u32 (out, index.size ());
+  write_u32 (out, blob_offset);
+  write_u32 (out, blob.size ());
+
+  out += strings;
+
+  for (const auto &record : defs)
+    {
+      write_u32 (out, record.local_def_id);
+      write_u32 (out, record.kind);
+      write_u32 (out, record.name);
+      write_u32 (out, record.path);
+      write_u32 (out, record.body_offset);
+      write_u32 (out, record.body_size);
+    }
+
+  for (const auto &entry : index)
+    {
+      write_u32 (out, entry.first);
+      write_u32 (out, entry.second);
+    }
+
+  out += blob;
+
+  return out;
+}
+
+bool
+MetadataReader::is_binary_metadata (const char *data, size_t size)
+{
+  return size >= sizeof (kBinaryMagic)
+	 && memcmp (data, kBinaryMagic, sizeof (kBinaryMagic)) == 0;
+}
+
+uint32_t
+MetadataReader::read_u32 (size_t offset) const
+{
+  const unsigned char *p
+    = reinterpret_cast<const unsigned char *> (data + offset);
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+	 | ((uint32_t) p[3] << 24);
+}
+
+const char *
+MetadataReader::get_string (uint32_t offset) const
+{
+  rust_assert (offset < strings_size);
+  return data + strings_offset + offset;
+}
+
+// check that [OFFSET, OFFSET + LENGTH) lies within a buffer of SIZE bytes
+static bool
+section_in_bounds (uint64_t offset, uint64_t length, size_t size)
+{
+  return offset <= size && length <= size - offset;
+}
+
+tl::optional<MetadataReader>
+MetadataReader::open (const char *data, size_t size)
+{
+  if (!is_binary_metadata (data, size) || size < kHeaderSize)
+    return tl::nullopt;
+
+  MetadataReader reader (data, size);
+  reader.version = reader.read_u32 (4);
+  if (reader.version != kFormatVersion)
+    return tl::nullopt;
+
+  reader.strings_offset = reader.read_u32 (8);
+  reader.strings_size = reader.read_u32 (12);
+  reader.defs_offset = reader.read_u32 (16);
+  reader.def_count = reader.read_u32 (20);
+  reader.index_offset = reader.read_u32 (24);
+  reader.index_count = reader.read_u32 (28);
+  reader.blob_offset = reader.read_u32 (32);
+  reader.blob_size = reader.read_u32 (36);
+
+  if (!section_in_bounds (reader.strings_offset, reader.strings_size, size)
+      || !section_in_bounds (reader.defs_offset,
+			     (uint64_t) reader.def_count * kDefRecordSize,
+			     size)
+      || !section_in_bounds (reader.index_offset,
+			     (uint64_t) reader.index_count * kIndexRecordSize,
+			     size)
+      || !section_in_bounds (reader.blob_offset, reader.blob_size, size))
+    return tl::nullopt;
+
+  // every string must be terminated within the string table
+  if (reader.strings_size > 0
+      && data[reader.strings_offset + reader.strings_size - 1] != '\0')
+    return tl::nullopt;
+
+  // the records are checked once here, so that corrupt metadata is rejected
+  // rather than trusted by get_def and lookup_def
+  for (size_t idx = 0; idx < reader.def_count; idx++)
+    {
+      size_t record = reader.defs_offset + idx * kDefRecordSize;
+      if (reader.read_u32 (record + 8) >= reader.strings_size
+	  || reader.read_u32 (record + 12) >= reader.strings_size
+	  || !section_in_bounds (reader.read_u32 (record + 16),
+				 reader.read_u32 (record + 20),
+				 reader.blob_size))
+	return tl::nullopt;
+    }
+
+  for (size_t idx = 0; idx < reader.index_count; idx++)
+    {
+      size_t record = reader.index_offset + idx * kIndexRecordSize;
+      if (reader.read_u32 (record + 4) >= reader.def_count)
+	return tl::nullopt;
+    }
+
+  return reader;
+}
+
+DefEntry
+MetadataReader::get_def (size_t idx) const
+{
+  rust_assert (idx < def_count);
+  size_t record = defs_offset + idx * kDefRecordSize;
+
+  uint32_t body_offset = read_u32 (record + 16);
+  uint32_t body_size = read_u32 (record + 20);
+  rust_assert (section_in_bounds (body_offset, body_size, blob_size));
+
+  DefEntry entry;
+  entry.local_def_id = read_u32 (record);
+  entry.kind = static_cast<DefKind> (read_u32 (record + 4));
+  entry.name = get_string (read_u32 (record + 8));
+  entry.path = get_string (read_u32 (record + 12));
+  entry.body = data + blob_offset + body_offset;
+  entry.body_size = body_size;
+
+  return entry;
+}
+
+tl::optional<DefEntry>
+MetadataReader::lookup_def (LocalDefId id) const
+{
+  // binary search over the sorted (LocalDefId, def number) index
+  size_t lo = 0;
+  size_t hi = index_count;
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      size_t record = index_offset + mid * kIndexRecordSize;
+      LocalDefId current = read_u32 (record);
+
+      if (current == id)
+	return get_def (read_u32 (record + 4));
+      else if (current < id)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  return tl::nullopt;
+}
+
+} // namespace Metadata
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_metadata_format_test (void)
+{
+  using namespace Rust::Metadata;
+
+  MetadataWriter writer;
+  writer.add_def (DefKind::FUNCTION, 4, "foo", "test::foo",
+		  "extern \"Rust\" { pub fn foo(); }");
+  writer.add_def (DefKind::TRAIT, 2, "Bar", "test::Bar", "pub trait Bar {}");
+  writer.add_def (DefKind::MACRO, UNKNOWN_LOCAL_DEFID, "baz", "baz",
+		  "macro_rules! baz { () => {} }");
+
+  std::string buffer = writer.serialize ();
+  ASSERT_TRUE (MetadataReader::is_binary_metadata (buffer.data (),
+						   buffer.size ()));
+
+  auto reader = MetadataReader::open (buffer.data (), buffer.size ());
+  ASSERT_TRUE (reader.has_value ());
+  ASSERT_EQ (reader->get_version (), kFormatVersion);
+  ASSERT_EQ (reader->num_defs (), 3);
+
+  DefEntry first = reader->get_def (0);
+  ASSERT_TRUE (first.kind == DefKind::FUNCTION);
+  ASSERT_STREQ (first.name, "foo");
+  ASSERT_STREQ (first.path, "test::foo");
+  ASSERT_EQ (std::string (first.body, first.body_size),
+	     "extern \"Rust\" { pub fn foo(); }");
+
+  auto trait = reader->lookup_def (2);
+  ASSERT_TRUE (trait.has_value ());
+  ASSERT_TRUE (trait->kind == DefKind::TRAIT);
+  ASSERT_STREQ (trait->name, "Bar");
+
+  // macros have no DefId and are not indexed
+  ASSERT_FALSE (reader->lookup_def (UNKNOWN_LOCAL_DEFID).has_value ());
+  ASSERT_FALSE (reader->lookup_def (3).has_value ());
+
+  // truncated buffers are rejected
+  ASSERT_FALSE (
+    MetadataReader::open (buffer.data (), buffer.size () - 1).has_value ());
+
+  // and so are records pointing outside of their sections
+  std::string corrupt = buffer;
+  const unsigned char *header
+    = reinterpret_cast<const unsigned char *> (buffer.data ());
+  size_t first_record = header[16] | (header[17] << 8) | (header[18] << 16)
+			| ((size_t) header[19] << 24);
+  // the name of the first def
+  corrupt[first_record + 8] = '\xff';
+  corrupt[first_record + 9] = '\xff';
+  ASSERT_FALSE (
+    MetadataReader::open (corrupt.data (), corrupt.size ()).has_value ());
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,157 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_METADATA_FORMAT_H
+#define RUST_METADATA_FORMAT_H
+
+#include "rust-system.h"
+#include "rust-mapping-common.h"
+#include "optional.h"
+
+namespace Rust {
+namespace Metadata {
+
+/**
+ * Binary container for the public interface of a crate. This is the payload
+ * found after the `GRST` framing header in `.rox` files and in the export
+ * section of object files. Each def still holds the Rust source of its item,
+ * which the importer parses and type checks again.
+ *
+ * All integers are 32-bit little endian. The layout is:
+ *
+ *   header      kBinaryMagic, version, then the offset and size of every
+ *		 section below
+ *   strings     NUL terminated strings, referenced by offset
+ *   defs	 one fixed size DefRecord per exported item, in emission order
+ *   index	 (LocalDefId, def number) pairs sorted by LocalDefId
+ *   blob	 the per item payloads, referenced by offset and size
+ *
+ * A MetadataReader only validates the header, and each def is read on access
+ * straight out of the buffer, so the buffer can be a mapping of the file.
+ */
+
+static const char kBinaryMagic[4] = {'G', 'R', 'S', 'B'};
+static const uint32_t kFormatVersion = 1;
+
+enum class DefKind : uint32_t
+{
+  FUNCTION,
+  TRAIT,
+  MACRO,
+  // a generic instance emitted by the crate, named by its symbol and with an
+  // empty body
+  INSTANCE,
+  // a constant whose initializer was evaluated by the crate, the body holds
+  // the value rather than the original expression
+  CONSTANT,
+};
+
+struct DefEntry
+{
+  DefKind kind;
+  LocalDefId local_def_id;
+  const char *name;
+  const char *path;
+  // Rust source text for the item, not NUL terminated
+  const char *body;
+  size_t body_size;
+};
+
+class MetadataWriter
+{
+public:
+  MetadataWriter () = default;
+
+  void add_def (DefKind kind, LocalDefId local_def_id,
+		const std::string &name, const std::string &path,
+		const std::string &body);
+
+  size_t num_defs () const { return defs.size (); }
+
+  std::string serialize () const;
+
+private:
+  uint32_t intern_string (const std::string &str);
+
+  struct DefRecord
+  {
+    uint32_t local_def_id;
+    uint32_t kind;
+    uint32_t name;
+    uint32_t path;
+    uint32_t body_offset;
+    uint32_t body_size;
+  };
+
+  std::string strings;
+  std::map<std::string, uint32_t> string_offsets;
+  std::vector<DefRecord> defs;
+  std::string blob;
+};
+
+class MetadataReader
+{
+public:
+  // Return true if the payload in DATA starts with the binary magic
+  static bool is_binary_metadata (const char *data, size_t size);
+
+  // Validate the header of DATA. The buffer is not copied and must outlive
+  // the reader.
+  static tl::optional<MetadataReader> open (const char *data, size_t size);
+
+  uint32_t get_version () const { return version; }
+  size_t num_defs () const { return def_count; }
+
+  // Decode the def numbered IDX, in emission order
+  DefEntry get_def (size_t idx) const;
+
+  tl::optional<DefEntry> lookup_def (LocalDefId id) const;
+
+private:
+  MetadataReader (const char *data, size_t size) : data (data), size (size) {}
+
+  uint32_t read_u32 (size_t offset) const;
+  const char *get_string (uint32_t offset) const;
+
+  const char *data;
+  size_t size;
+
+  uint32_t version;
+  uint32_t strings_offset;
+  uint32_t strings_size;
+  uint32_t defs_offset;
+  uint32_t def_count;
+  uint32_t index_offset;
+  uint32_t index_count;
+  uint32_t blob_offset;
+  uint32_t blob_size;
+};
+
+} // namespace Metadata
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_metadata_format_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_METADATA_FORMAT_H
@@ -34,6 +34,7 @@
 #include "rust-attribute-values.h"
 #include "rust-keyword-values.h"
 #include "rust-session-manager.h"
+#include "rust-cfg-strip.h"
 
 #include "optional.h"
 
@@ -422,7 +423,16 @@ Parser<ManagedTokenSource>::parse_items ()
   const_TokenPtr t = lexer.peek_token ();
   while (t->get_id () != END_OF_FILE)
     {
-      std::unique_ptr<AST::Item> item = parse_item (false);
+      AST::AttrVec outer_attrs = parse_outer_attributes ();
+      bool disabled = is_cfg_disabled_item (outer_attrs);
+      if (disabled && skip_item_tokens ())
+	{
+	  t = lexer.peek_token ();
+	  continue;
+	}
+
+      std::unique_ptr<AST::Item> item
+	= parse_item (false, std::move (outer_attrs));
       if (item == nullptr)
 	{
 	  Error error (lexer.peek_token ()->get_locus (),
@@ -434,7 +444,8 @@ Parser<ManagedTokenSource>::parse_items ()
 	  break;
 	}
 
-      items.push_back (std::move (item));
+      if (!disabled)
+	items.push_back (std::move (item));
 
       t = lexer.peek_token ();
     }
@@ -442,6 +453,183 @@ Parser<ManagedTokenSource>::parse_items ()
   return items;
 }
 
+/* Returns whether CfgStrip would remove the item whose outer attributes are
+ * OUTER_ATTRS. The attributes are checked on a copy, their `cfg_attr` are
+ * expanded by CfgStrip as usual if the item is kept. */
+template <typename ManagedTokenSource>
+bool
+Parser<ManagedTokenSource>::is_cfg_disabled_item (
+  const AST::AttrVec &outer_attrs)
+{
+  bool has_cfg = false;
+  for (auto &attr : outer_attrs)
+    if (attr.get_path () == Values::Attributes::CFG
+	|| attr.get_path () == Values::Attributes::CFG_ATTR)
+      has_cfg = true;
+
+  if (!has_cfg)
+    return false;
+
+  AST::AttrVec attrs = outer_attrs;
+  expand_cfg_attrs (attrs);
+  return fails_cfg_with_expand (attrs);
+}
+
+/* Skips the tokens of the item at the current position, without building any
+ * AST for it, when its end can be found by matching delimiters. Syntax errors
+ * inside a skipped item are not reported. */
+template <typename ManagedTokenSource>
+bool
+Parser<ManagedTokenSource>::skip_item_tokens ()
+{
+  auto length = peek_item_length ();
+  if (!length.has_value ())
+    return false;
+
+  for (int i = 0; i < length.value (); i++)
+    lexer.skip_token ();
+
+  return true;
+}
+
+/* Returns the number of tokens of the item at the current position, found by
+ * matching delimiters, for the kinds of items that end either with a
+ * semicolon or with their braced body. */
+template <typename ManagedTokenSource>
+tl::optional<int>
+Parser<ManagedTokenSource>::peek_item_length ()
+{
+  int n = 0;
+
+  // visibility, `pub (in path)` cannot have nested parentheses
+  if (lexer.peek_token (n)->get_id () == PUB)
+    {
+      n++;
+      if (lexer.peek_token (n)->get_id () == LEFT_PAREN)
+	{
+	  while (lexer.peek_token (n)->get_id () != RIGHT_PAREN)
+	    {
+	      if (lexer.peek_token (n)->get_id () == END_OF_FILE)
+		return tl::nullopt;
+	      n++;
+	    }
+	  n++;
+	}
+    }
+
+  // whether the item can only end with a semicolon, i.e. may contain braces
+  // that are not its body
+  bool semicolon_only;
+  switch (lexer.peek_token (n)->get_id ())
+    {
+    case USE:
+    case STATIC_KW:
+    case TYPE:
+      semicolon_only = true;
+      break;
+    case CONST:
+      switch (lexer.peek_token (n + 1)->get_id ())
+	{
+	case FN_KW:
+	case UNSAFE:
+	case ASYNC:
+	case EXTERN_KW:
+	  semicolon_only = false;
+	  break;
+	default:
+	  semicolon_only = true;
+	  break;
+	}
+      break;
+    case FN_KW:
+    case STRUCT_KW:
+    case ENUM_KW:
+    case TRAIT:
+    case IMPL:
+    case MOD:
+    case UNSAFE:
+    case ASYNC:
+    case EXTERN_KW:
+      semicolon_only = false;
+      break;
+    default:
+      return tl::nullopt;
+    }
+
+  int depth = 0;
+  // generic argument lists outside of delimiters, which may contain braces
+  // or semicolons. An initializer may compare values so stop counting at
+  // its `=`, which the lexer may have glued to the closing angles before it
+  int angles = 0;
+  bool count_angles = true;
+  for (;; n++)
+    {
+      int closing = 0;
+      bool equal = false;
+      switch (lexer.peek_token (n)->get_id ())
+	{
+	case LEFT_PAREN:
+	case LEFT_SQUARE:
+	case LEFT_CURLY:
+	  depth++;
+	  break;
+	case RIGHT_PAREN:
+	case RIGHT_SQUARE:
+	  if (--depth < 0)
+	    return tl::nullopt;
+	  break;
+	case RIGHT_CURLY:
+	  if (--depth < 0)
+	    return tl::nullopt;
+	  if (depth == 0 && angles == 0 && !semicolon_only)
+	    return n + 1;
+	  break;
+	case SEMICOLON:
+	  if (depth == 0 && angles == 0)
+	    return n + 1;
+	  break;
+	case LEFT_ANGLE:
+	  if (depth == 0 && count_angles)
+	    angles++;
+	  break;
+	case LEFT_SHIFT:
+	  if (depth == 0 && count_angles)
+	    angles += 2;
+	  break;
+	case EQUAL:
+	  equal = true;
+	  break;
+	case RIGHT_ANGLE:
+	  closing = 1;
+	  break;
+	case GREATER_OR_EQUAL:
+	  closing = 1;
+	  equal = true;
+	  break;
+	case RIGHT_SHIFT:
+	  closing = 2;
+	  break;
+	case RIGHT_SHIFT_EQ:
+	  closing = 2;
+	  equal = true;
+	  break;
+	case END_OF_FILE:
+	  return tl::nullopt;
+	default:
+	  break;
+	}
+
+      if (depth != 0 || !count_angles)
+	continue;
+
+      angles -= closing;
+      if (angles < 0)
+	return tl::nullopt;
+      if (equal && angles == 0)
+	count_angles = false;
+    }
+}
+
 // Parses a crate (compilation unit) - entry point
 template <typename ManagedTokenSource>
 std::unique_ptr<AST::Crate>
@@ -1097,11 +1285,19 @@ Parser<ManagedTokenSource>::is_macro_rules_def (const_TokenPtr t)
 template <typename ManagedTokenSource>
 std::unique_ptr<AST::Item>
 Parser<ManagedTokenSource>::parse_item (bool called_from_statement)
+{
+  // parse outer attributes for item
+  return parse_item (called_from_statement, parse_outer_attributes ());
+}
+
+// Parses an item whose outer attributes have already been parsed.
+template <typename ManagedTokenSource>
+std::unique_ptr<AST::Item>
+Parser<ManagedTokenSource>::parse_item (bool called_from_statement,
+					AST::AttrVec outer_attrs)
 {
   // has a "called_from_statement" parameter for better error message handling
 
-  // parse outer attributes for item
-  AST::AttrVec outer_attrs = parse_outer_attributes ();
   const_TokenPtr t = lexer.peek_token ();
 
   switch (t->get_id ())
@@ -2497,7 +2693,16 @@ Parser<ManagedTokenSource>::parse_module (AST::Visibility vis,
 	const_TokenPtr tok = lexer.peek_token ();
 	while (tok->get_id () != RIGHT_CURLY)
 	  {
-	    std::unique_ptr<AST::Item> item = parse_item (false);
+	    AST::AttrVec item_attrs = parse_outer_attributes ();
+	    bool disabled = is_cfg_disabled_item (item_attrs);
+	    if (disabled && skip_item_tokens ())
+	      {
+		tok = lexer.peek_token ();
+		continue;
+	      }
+
+	    std::unique_ptr<AST::Item> item
+	      = parse_item (false, std::move (item_attrs));
 	    if (item == nullptr)
 	      {
 		Error error (tok->get_locus (),
@@ -2507,7 +2712,8 @@ Parser<ManagedTokenSource>::parse_module (AST::Visibility vis,
 		return nullptr;
 	      }
 
-	    items.push_back (std::move (item));
+	    if (!disabled)
+	      items.push_back (std::move (item));
 
 	    tok = lexer.peek_token ();
 	  }
@@ -2981,6 +3187,17 @@ Parser<ManagedTokenSource>::parse_function (AST::Visibility vis,
   tl::optional<std::unique_ptr<AST::BlockExpr>> body = tl::nullopt;
   if (lexer.peek_token ()->get_id () == SEMICOLON)
     lexer.skip_token ();
+  else if (skip_function_bodies
+	   && lexer.peek_token ()->get_id () == LEFT_CURLY)
+    {
+      location_t body_locus = lexer.peek_token ()->get_locus ();
+      lexer.skip_token ();
+      skip_after_end_block ();
+
+      body = Rust::make_unique<AST::BlockExpr> (
+	std::vector<std::unique_ptr<AST::Stmt>> (), nullptr, AST::AttrVec (),
+	AST::AttrVec (), AST::LoopLabel::error (), body_locus, body_locus);
+    }
   else
     {
       std::unique_ptr<AST::BlockExpr> block_expr = parse_block_expr ();
@@ -11804,16 +12021,66 @@ template <typename ManagedTokenSource>
 void
 Parser<ManagedTokenSource>::skip_after_semicolon ()
 {
-  const_TokenPtr t = lexer.peek_token ();
+  /* Delimited groups are skipped as a whole, so that a semicolon nested in
+   * one does not stop the recovery half way through it. An unmatched closing
+   * delimiter ends whatever encloses the broken construct and is left to it,
+   * unless it is the very first token and skipping it is the only way
+   * forward. */
+  bool skipped = false;
+  for (;;)
+    {
+      const_TokenPtr t = lexer.peek_token ();
+      if (t->get_id () == SEMICOLON)
+	{
+	  lexer.skip_token ();
+	  return;
+	}
 
-  while (t->get_id () != END_OF_FILE && t->get_id () != SEMICOLON)
+      if (!skip_token_tree ())
+	{
+	  if (skipped || t->get_id () == END_OF_FILE)
+	    return;
+	  lexer.skip_token ();
+	}
+
+      skipped = true;
+    }
+}
+
+/* Skips a whole delimited token tree when at an opening delimiter, and a
+ * single token otherwise. Skips nothing and returns false at a closing
+ * delimiter or at the end of the file. */
+template <typename ManagedTokenSource>
+bool
+Parser<ManagedTokenSource>::skip_token_tree ()
+{
+  int depth = 0;
+  do
     {
+      switch (lexer.peek_token ()->get_id ())
+	{
+	case LEFT_PAREN:
+	case LEFT_SQUARE:
+	case LEFT_CURLY:
+	  depth++;
+	  break;
+	case RIGHT_PAREN:
+	case RIGHT_SQUARE:
+	case RIGHT_CURLY:
+	  if (depth == 0)
+	    return false;
+	  depth--;
+	  break;
+	case END_OF_FILE:
+	  return depth > 0;
+	default:
+	  break;
+	}
       lexer.skip_token ();
-      t = lexer.peek_token ();
     }
+  while (depth > 0);
 
-  if (t->get_id () == SEMICOLON)
-    lexer.skip_token ();
+  return true;
 }
 
 /* Skips the current token */
@@ -11984,9 +12251,11 @@ Parser<ManagedTokenSource>::skip_after_end_attribute ()
 {
   const_TokenPtr t = lexer.peek_token ();
 
-  while (t->get_id () != RIGHT_SQUARE)
+  // brackets nested in the attribute are skipped with their group
+  while (t->get_id () != RIGHT_SQUARE && t->get_id () != END_OF_FILE)
     {
-      lexer.skip_token ();
+      if (!skip_token_tree ())
+	lexer.skip_token ();
       t = lexer.peek_token ();
     }
 
@@ -29,7 +29,7 @@ extract_module_path (const AST::AttrVec &inner_attrs,
   AST::Attribute path_attr = AST::Attribute::create_empty ();
   for (const auto &attr : inner_attrs)
     {
-      if (attr.get_path ().as_string () == Values::Attributes::PATH)
+      if (attr.get_builtin () == Values::BuiltinAttribute::PATH)
 	{
 	  path_attr = attr;
 	  break;
@@ -49,7 +49,7 @@ extract_module_path (const AST::AttrVec &inner_attrs,
 
   for (const auto &attr : outer_attrs)
     {
-      if (attr.get_path ().as_string () == Values::Attributes::PATH)
+      if (attr.get_builtin () == Values::BuiltinAttribute::PATH)
 	{
 	  path_attr = attr;
 	  break;
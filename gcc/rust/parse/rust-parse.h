@@ -190,6 +190,7 @@ private:
   void skip_after_end_block ();
   void skip_after_next_block ();
   void skip_after_end_attribute ();
+  bool skip_token_tree ();
 
   const_TokenPtr expect_token (TokenId t);
   const_TokenPtr expect_token (const_TokenPtr token_expect);
@@ -701,11 +702,20 @@ private:
   bool done_end_or_else ();
   bool done_end_of_file ();
 
+  // Item-list-related
+  std::unique_ptr<AST::Item> parse_item (bool called_from_statement,
+					 AST::AttrVec outer_attrs);
+  bool is_cfg_disabled_item (const AST::AttrVec &outer_attrs);
+  bool skip_item_tokens ();
+  tl::optional<int> peek_item_length ();
+
   void add_error (Error error) { error_table.push_back (std::move (error)); }
 
 public:
   // Construct parser with specified "managed" token source.
-  Parser (ManagedTokenSource &tokenSource) : lexer (tokenSource) {}
+  Parser (ManagedTokenSource &tokenSource)
+    : lexer (tokenSource), skip_function_bodies (false)
+  {}
 
   // Parse items without parsing an entire crate. This function is the main
   // parsing loop of AST::Crate::parse_crate().
@@ -724,8 +734,21 @@ public:
   // Get a reference to the list of errors encountered
   std::vector<Error> &get_errors () { return error_table; }
 
+  // Forget the state of previous parses, so that the parser can be reused
+  // once its token source has been reset
+  void reset ()
+  {
+    error_table.clear ();
+    inline_module_stack.clear ();
+  }
+
   const ManagedTokenSource &get_token_source () const { return lexer; }
 
+  // Skip the bodies of functions rather than parsing them, for when nothing
+  // past the items themselves is going to be looked at. The functions get an
+  // empty body instead.
+  void set_skip_function_bodies (bool skip) { skip_function_bodies = skip; }
+
   const_TokenPtr peek_current_token () { return lexer.peek_token (0); }
   const_TokenPtr peek (int n) { return lexer.peek_token (n); }
 
@@ -736,6 +759,8 @@ private:
   std::vector<Error> error_table;
   // The names of inline modules while parsing.
   std::vector<std::string> inline_module_stack;
+  // Whether function bodies are skipped, see set_skip_function_bodies.
+  bool skip_function_bodies;
 
   class InlineModuleStackScope
   {
@@ -741,6 +741,45 @@ ResolveExpr::visit (AST::ClosureExprInnerTyped &expr)
   resolver->get_label_scope ().pop ();
 }
 
+void
+ResolveExpr::visit (AST::InlineAsm &expr)
+{
+  using RegisterType = AST::InlineAsmOperand::RegisterType;
+
+  for (auto &operand : expr.operands)
+    switch (operand.register_type)
+      {
+      case RegisterType::In:
+	ResolveExpr::go (*operand.in.expr, prefix, canonical_prefix);
+	break;
+      case RegisterType::Out:
+	if (operand.out.expr)
+	  ResolveExpr::go (*operand.out.expr, prefix, canonical_prefix);
+	break;
+      case RegisterType::InOut:
+	ResolveExpr::go (*operand.in_out.expr, prefix, canonical_prefix);
+	break;
+      case RegisterType::SplitInOut:
+	ResolveExpr::go (*operand.split_in_out.in_expr, prefix,
+			 canonical_prefix);
+	if (operand.split_in_out.out_expr)
+	  ResolveExpr::go (*operand.split_in_out.out_expr, prefix,
+			   canonical_prefix);
+	break;
+      case RegisterType::Const:
+	ResolveExpr::go (*operand.cnst.anon_const.expr, prefix,
+			 canonical_prefix);
+	break;
+      case RegisterType::Sym:
+	ResolveExpr::go (*operand.sym.expr, prefix, canonical_prefix);
+	break;
+      case RegisterType::Label:
+	if (operand.label.expr)
+	  ResolveExpr::go (*operand.label.expr, prefix, canonical_prefix);
+	break;
+      }
+}
+
 void
 ResolveExpr::resolve_closure_param (AST::ClosureParam &param,
 				    std::vector<PatternBinding> &bindings)
@@ -185,6 +185,7 @@ ResolveItem::visit (AST::TypeAlias &alias)
   mappings.insert_canonical_path (alias.get_node_id (), cpath);
 
   NodeId scope_node_id = alias.get_node_id ();
+  resolver->get_name_scope ().push (scope_node_id);
   resolver->get_type_scope ().push (scope_node_id);
 
   if (alias.has_generics ())
@@ -196,6 +197,7 @@ ResolveItem::visit (AST::TypeAlias &alias)
 
   ResolveType::go (alias.get_type_aliased ());
 
+  resolver->get_name_scope ().pop ();
   resolver->get_type_scope ().pop ();
 }
 
@@ -247,6 +249,7 @@ ResolveItem::visit (AST::TupleStruct &struct_decl)
   resolve_visibility (struct_decl.get_visibility ());
 
   NodeId scope_node_id = struct_decl.get_node_id ();
+  resolver->get_name_scope ().push (scope_node_id);
   resolver->get_type_scope ().push (scope_node_id);
 
   if (struct_decl.has_generics ())
@@ -266,6 +269,7 @@ ResolveItem::visit (AST::TupleStruct &struct_decl)
       ResolveType::go (field.get_field_type ());
     }
 
+  resolver->get_name_scope ().pop ();
   resolver->get_type_scope ().pop ();
 }
 
@@ -281,6 +285,7 @@ ResolveItem::visit (AST::Enum &enum_decl)
   resolve_visibility (enum_decl.get_visibility ());
 
   NodeId scope_node_id = enum_decl.get_node_id ();
+  resolver->get_name_scope ().push (scope_node_id);
   resolver->get_type_scope ().push (scope_node_id);
 
   if (enum_decl.has_generics ())
@@ -294,6 +299,7 @@ ResolveItem::visit (AST::Enum &enum_decl)
   for (auto &variant : enum_decl.get_variants ())
     ResolveItem::go (*variant, path, cpath);
 
+  resolver->get_name_scope ().pop ();
   resolver->get_type_scope ().pop ();
 }
 
@@ -371,6 +377,7 @@ ResolveItem::visit (AST::StructStruct &struct_decl)
   resolve_visibility (struct_decl.get_visibility ());
 
   NodeId scope_node_id = struct_decl.get_node_id ();
+  resolver->get_name_scope ().push (scope_node_id);
   resolver->get_type_scope ().push (scope_node_id);
 
   if (struct_decl.has_generics ())
@@ -390,6 +397,7 @@ ResolveItem::visit (AST::StructStruct &struct_decl)
       ResolveType::go (field.get_field_type ());
     }
 
+  resolver->get_name_scope ().pop ();
   resolver->get_type_scope ().pop ();
 }
 
@@ -406,6 +414,7 @@ ResolveItem::visit (AST::Union &union_decl)
   resolve_visibility (union_decl.get_visibility ());
 
   NodeId scope_node_id = union_decl.get_node_id ();
+  resolver->get_name_scope ().push (scope_node_id);
   resolver->get_type_scope ().push (scope_node_id);
 
   if (union_decl.has_generics ())
@@ -423,6 +432,7 @@ ResolveItem::visit (AST::Union &union_decl)
       ResolveType::go (field.get_field_type ());
     }
 
+  resolver->get_name_scope ().pop ();
   resolver->get_type_scope ().pop ();
 }
 
@@ -946,6 +956,10 @@ ResolveItem::visit (AST::UseDeclaration &use_item)
   //
   // Which is the opposite of what we're doing if I understand correctly?
 
+  // other crates can name what a `pub use` imports through its path
+  bool is_reexport
+    = use_item.get_visibility ().get_vis_type () == AST::Visibility::PUB;
+
   NodeId current_module = resolver->peek_current_module_scope ();
   for (auto &import : to_resolve)
     {
@@ -957,6 +971,9 @@ ResolveItem::visit (AST::UseDeclaration &use_item)
       if (!ok)
 	continue;
 
+      if (is_reexport)
+	mappings.insert_reexported_item (resolved_node_id);
+
       if (import.is_glob ())
 	continue;
 
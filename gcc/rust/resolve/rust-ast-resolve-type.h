@@ -156,6 +156,18 @@ public:
       ResolveExpr::go (param.get_default_value ().get_expression (), prefix,
 		       canonical_prefix);
 
+    // const generic parameters are values the bodies can refer to
+    auto seg = CanonicalPath::new_seg (param.get_node_id (),
+				       param.get_name ().as_string ());
+    resolver->get_name_scope ().insert (
+      seg, param.get_node_id (), param.get_locus (), false, Rib::ItemType::Param,
+      [&] (const CanonicalPath &, NodeId, location_t locus) -> void {
+	rust_error_at (param.get_locus (),
+		       "generic param redefined multiple times");
+	rust_error_at (locus, "was defined here");
+      });
+
+    mappings.insert_canonical_path (param.get_node_id (), seg);
     ok = true;
   }
 
@@ -23,6 +23,7 @@
 #include "rust-ast-resolve-item.h"
 #include "rust-ast-resolve-expr.h"
 #include "rust-ast-resolve-struct-expr-field.h"
+#include "rust-thread-state.h"
 
 extern bool
 saw_errors (void);
@@ -35,7 +36,7 @@ namespace Resolver {
 NameResolution *
 NameResolution::get ()
 {
-  static NameResolution *instance;
+  auto &instance = ThreadState::current ().legacy_name_resolution;
   if (instance == nullptr)
     instance = new NameResolution ();
 
@@ -55,12 +55,44 @@ Early::go (AST::Crate &crate)
 
   // Then we proceed to the proper "early" name resolution: Import and macro
   // name resolution
-  for (auto &item : crate.items)
-    item->accept_vis (*this);
+  visit_items (crate.items);
 
   textual_scope.pop ();
 }
 
+void
+Early::visit_items (std::vector<std::unique_ptr<AST::Item>> &items)
+{
+  for (auto &item : items)
+    {
+      NodeId id = item->get_node_id ();
+      if (ctx.is_settled_item (id))
+	continue;
+
+      size_t pending_before = pending;
+      item->accept_vis (*this);
+
+      // nothing in the item can change or resolve differently next round
+      if (pending == pending_before)
+	ctx.settle_item (id);
+    }
+}
+
+// Whether ATTRS still hold a derive or an attribute macro to expand
+static bool
+has_expandable_attributes (const std::vector<AST::Attribute> &attrs)
+{
+  for (const auto &attr : attrs)
+    if (attr.is_derive ()
+	|| Analysis::BuiltinAttributeMappings::get ()
+	     ->lookup_builtin (
+	       attr.get_path ().get_segments ().at (0).get_segment_name ())
+	     .is_error ())
+      return true;
+
+  return false;
+}
+
 void
 Early::TextualScope::push ()
 {
@@ -92,7 +124,7 @@ Early::TextualScope::get (const std::string &name)
 {
   for (auto iterator = scopes.rbegin (); iterator != scopes.rend (); iterator++)
     {
-      auto scope = *iterator;
+      auto &scope = *iterator;
       auto found = scope.find (name);
       if (found != scope.end ())
 	return found->second;
@@ -104,6 +136,9 @@ Early::TextualScope::get (const std::string &name)
 void
 Early::visit (AST::MacroRulesDefinition &def)
 {
+  // the definition has to be inserted in the textual scope every round
+  pending++;
+
   DefaultResolver::visit (def);
 
   textual_scope.insert (def.get_rule_name ().as_string (), def.get_node_id ());
@@ -113,6 +148,15 @@ Early::visit (AST::MacroRulesDefinition &def)
 void
 Early::visit (AST::BlockExpr &block)
 {
+  // the items and the tail expression of a block might still be derived
+  // from or expanded, which we do not keep track of
+  for (auto &stmt : block.get_statements ())
+    if (stmt->get_stmt_kind () == AST::Stmt::Kind::Item)
+      pending++;
+  if (block.has_tail_expr ()
+      && has_expandable_attributes (block.get_tail_expr ().get_outer_attrs ()))
+    pending++;
+
   textual_scope.push ();
 
   DefaultResolver::visit (block);
@@ -125,7 +169,10 @@ Early::visit (AST::Module &module)
 {
   textual_scope.push ();
 
-  DefaultResolver::visit (module);
+  auto item_fn = [this, &module] () { visit_items (module.get_items ()); };
+
+  ctx.scoped (Rib::Kind::Module, module.get_node_id (), item_fn,
+	      module.get_name ());
 
   textual_scope.pop ();
 }
@@ -133,6 +180,9 @@ Early::visit (AST::Module &module)
 void
 Early::visit (AST::MacroInvocation &invoc)
 {
+  // resolved or not, the invocation is either expanded or retried next round
+  pending++;
+
   auto path = invoc.get_invoc_data ().get_path ();
 
   // When a macro is invoked by an unqualified identifier (not part of a
@@ -184,6 +234,9 @@ Early::visit_attributes (std::vector<AST::Attribute> &attrs)
 {
   auto &mappings = Analysis::Mappings::get ();
 
+  if (has_expandable_attributes (attrs))
+    pending++;
+
   for (auto &attr : attrs)
     {
       auto name = attr.get_path ().get_segments ().at (0).get_segment_name ();
@@ -250,5 +303,15 @@ Early::visit (AST::StructStruct &s)
   DefaultResolver::visit (s);
 }
 
+void
+Early::visit (AST::UseDeclaration &use)
+{
+  // imports are resolved again every round by `TopLevel`, as they might refer
+  // to items which have yet to be expanded
+  pending++;
+
+  DefaultResolver::visit (use);
+}
+
 } // namespace Resolver2_0
 } // namespace Rust
@@ -53,10 +53,19 @@ public:
 
   void visit (AST::Function &) override;
   void visit (AST::StructStruct &) override;
+  void visit (AST::UseDeclaration &) override;
 
 private:
   void visit_attributes (std::vector<AST::Attribute> &attrs);
 
+  /**
+   * Visit the items of a module, skipping the settled ones, and settle the
+   * ones in which nothing is left to expand or resolve. These are found by
+   * counting what still needs to be looked at again in `pending`.
+   */
+  void visit_items (std::vector<std::unique_ptr<AST::Item>> &items);
+  size_t pending = 0;
+
   /**
    * Insert a resolved macro invocation into the mappings once, meaning that we
    * can call this function each time the early name resolution pass is underway
@@ -30,7 +30,7 @@ static bool
 is_macro_use_module (const AST::Module &mod)
 {
   for (const auto &attr : mod.get_outer_attrs ())
-    if (attr.get_path ().as_string () == Values::Attributes::MACRO_USE)
+    if (attr.get_builtin () == Values::BuiltinAttribute::MACRO_USE)
       return true;
 
   return false;
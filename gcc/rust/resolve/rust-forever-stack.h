@@ -561,6 +561,10 @@ private:
   /* Add a new Rib to the stack. This is an internal method */
   void push_inner (Rib rib, Link link);
 
+  /* Add a definition to the rib of NODE and index it */
+  tl::expected<NodeId, DuplicateNameError>
+  insert_inner (Node &node, std::string name, Rib::Definition definition);
+
   /* Reverse iterate on `Node`s from the cursor, in an outwards fashion */
   void reverse_iter (std::function<KeepGoing (Node &)> lambda);
 
@@ -574,6 +578,20 @@ private:
   Node root;
   std::reference_wrapper<Node> cursor_reference;
 
+  /* Nodes are never removed from the trie and nodes of a std::map do not
+   * move, so they can be indexed as they are created. These are only a fast
+   * path for forward resolution, which falls back to walking the trie. */
+
+  // the Node pushed for each NodeId
+  std::unordered_map<NodeId, Node *> node_index;
+  // the first Node whose rib defined each NodeId, and the definition's name
+  std::unordered_map<NodeId, std::pair<Node *, std::string>> definition_index;
+
+  /* For each scope, the Node reached by the prefix (every segment but the
+   * last) of the paths resolved from it. Emptied whenever a Node is added. */
+  std::unordered_map<const Node *, std::unordered_map<std::string, Node *>>
+    path_cache;
+
   void stream_rib (std::stringstream &stream, const Rib &rib,
 		   const std::string &next, const std::string &next_next);
   void stream_node (std::stringstream &stream, unsigned indentation,
@@ -588,7 +606,8 @@ private:
 
   template <typename S>
   tl::optional<SegIterator<S>>
-  find_starting_point (const std::vector<S> &segments, Node &starting_point);
+  find_starting_point (const std::vector<S> &segments,
+		       std::reference_wrapper<Node> &starting_point);
 
   template <typename S>
   tl::optional<Node &> resolve_segments (Node &starting_point,
@@ -604,6 +623,8 @@ private:
 
   // FIXME: Documentation
   tl::optional<DfsResult> dfs (Node &starting_point, NodeId to_find);
+  // Find the Node defining ID and its name there, using the index if possible
+  tl::optional<DfsResult> find_definition (NodeId id);
   // FIXME: Documentation
   tl::optional<Rib &> dfs_rib (Node &starting_point, NodeId to_find);
 };
@@ -72,6 +72,18 @@ ForeverStack<N>::push_inner (Rib rib, Link link)
   auto it = emplace.first;
   auto existed = !emplace.second;
 
+  if (!existed)
+    {
+      // the new node could be a better match for a path already resolved
+      path_cache.clear ();
+
+      node_index.emplace (link.id, &it->second);
+      for (auto &kv : it->second.rib.get_values ())
+	for (auto id : kv.second.ids)
+	  definition_index.emplace (id, std::make_pair (&it->second,
+							kv.first.as_string ()));
+    }
+
   rust_debug ("inserting link: Link(%d [%s]): existed? %s", link.id,
 	      link.path.has_value () ? link.path.value ().as_string ().c_str ()
 				     : "<anon>",
@@ -90,34 +102,38 @@ ForeverStack<N>::pop ()
   rust_debug ("popping link");
 
   for (const auto &kv : cursor ().rib.get_values ())
-    rust_debug ("current_rib: k: %s, v: %s", kv.first.c_str (),
+    rust_debug ("current_rib: k: %s, v: %s", kv.first.as_string ().c_str (),
 		kv.second.to_string ().c_str ());
 
   if (cursor ().parent.has_value ())
     for (const auto &kv : cursor ().parent.value ().rib.get_values ())
-      rust_debug ("new cursor: k: %s, v: %s", kv.first.c_str (),
+      rust_debug ("new cursor: k: %s, v: %s", kv.first.as_string ().c_str (),
 		  kv.second.to_string ().c_str ());
 
   update_cursor (cursor ().parent.value ());
 }
 
-static tl::expected<NodeId, DuplicateNameError>
-insert_inner (Rib &rib, std::string name, Rib::Definition definition)
+template <Namespace N>
+tl::expected<NodeId, DuplicateNameError>
+ForeverStack<N>::insert_inner (Node &node, std::string name,
+			       Rib::Definition definition)
 {
-  return rib.insert (name, definition);
+  auto inserted = node.rib.insert (name, definition);
+  if (inserted)
+    definition_index.emplace (inserted.value (), std::make_pair (&node, name));
+
+  return inserted;
 }
 
 template <Namespace N>
 tl::expected<NodeId, DuplicateNameError>
 ForeverStack<N>::insert (Identifier name, NodeId node)
 {
-  auto &innermost_rib = peek ();
-
   // So what do we do here - if the Rib has already been pushed in an earlier
   // pass, we might end up in a situation where it is okay to re-add new names.
   // Do we just ignore that here? Do we keep track of if the Rib is new or not?
   // should our cursor have info on the current node like "is it newly pushed"?
-  return insert_inner (innermost_rib, name.as_string (),
+  return insert_inner (cursor (), name.as_string (),
 		       Rib::Definition::NonShadowable (node));
 }
 
@@ -125,9 +141,7 @@ template <Namespace N>
 tl::expected<NodeId, DuplicateNameError>
 ForeverStack<N>::insert_shadowable (Identifier name, NodeId node)
 {
-  auto &innermost_rib = peek ();
-
-  return insert_inner (innermost_rib, name.as_string (),
+  return insert_inner (cursor (), name.as_string (),
 		       Rib::Definition::Shadowable (node));
 }
 
@@ -135,11 +149,9 @@ template <Namespace N>
 tl::expected<NodeId, DuplicateNameError>
 ForeverStack<N>::insert_at_root (Identifier name, NodeId node)
 {
-  auto &root_rib = root.rib;
-
   // inserting in the root of the crate is never a shadowing operation, even for
   // macros
-  return insert_inner (root_rib, name.as_string (),
+  return insert_inner (root, name.as_string (),
 		       Rib::Definition::NonShadowable (node));
 }
 
@@ -149,7 +161,7 @@ template <>
 inline tl::expected<NodeId, DuplicateNameError>
 ForeverStack<Namespace::Macros>::insert (Identifier name, NodeId node)
 {
-  return insert_inner (peek (), name.as_string (),
+  return insert_inner (cursor (), name.as_string (),
 		       Rib::Definition::Shadowable (node));
 }
 
@@ -157,7 +169,7 @@ template <>
 inline tl::expected<NodeId, DuplicateNameError>
 ForeverStack<Namespace::Labels>::insert (Identifier name, NodeId node)
 {
-  return insert_inner (peek (), name.as_string (),
+  return insert_inner (cursor (), name.as_string (),
 		       Rib::Definition::Shadowable (node));
 }
 
@@ -229,9 +241,14 @@ ForeverStack<N>::get (const Identifier &name)
 {
   tl::optional<Rib::Definition> resolved_definition = tl::nullopt;
 
+  // a name that was never interned cannot be in any rib
+  auto symbol = Symbol::lookup (name.as_string ());
+  if (!symbol)
+    return tl::nullopt;
+
   // TODO: Can we improve the API? have `reverse_iter` return an optional?
-  reverse_iter ([&resolved_definition, &name] (Node &current) {
-    auto candidate = current.rib.get (name.as_string ());
+  reverse_iter ([&resolved_definition, &symbol] (Node &current) {
+    auto candidate = current.rib.get (symbol.value ());
 
     return candidate.map_or (
       [&resolved_definition] (Rib::Definition found) {
@@ -256,13 +273,17 @@ tl::optional<Rib::Definition> inline ForeverStack<Namespace::Labels>::get (
 {
   tl::optional<Rib::Definition> resolved_definition = tl::nullopt;
 
-  reverse_iter ([&resolved_definition, &name] (Node &current) {
+  auto symbol = Symbol::lookup (name.as_string ());
+  if (!symbol)
+    return tl::nullopt;
+
+  reverse_iter ([&resolved_definition, &symbol] (Node &current) {
     // looking up for labels cannot go through function ribs
     // TODO: What other ribs?
     if (current.rib.kind == Rib::Kind::Function)
       return KeepGoing::No;
 
-    auto candidate = current.rib.get (name.as_string ());
+    auto candidate = current.rib.get (symbol.value ());
 
     // FIXME: Factor this in a function with the generic `get`
     return candidate.map_or (
@@ -335,8 +356,8 @@ check_leading_kw_at_start (const S &segment, bool condition)
 template <Namespace N>
 template <typename S>
 tl::optional<typename std::vector<S>::const_iterator>
-ForeverStack<N>::find_starting_point (const std::vector<S> &segments,
-				      Node &starting_point)
+ForeverStack<N>::find_starting_point (
+  const std::vector<S> &segments, std::reference_wrapper<Node> &starting_point)
 {
   auto iterator = segments.begin ();
 
@@ -373,14 +394,15 @@ ForeverStack<N>::find_starting_point (const std::vector<S> &segments,
 	}
       if (seg.is_super_path_seg ())
 	{
-	  if (starting_point.is_root ())
+	  if (starting_point.get ().is_root ())
 	    {
 	      rust_error_at (seg.get_locus (), ErrorCode::E0433,
 			     "too many leading %<super%> keywords");
 	      return tl::nullopt;
 	    }
 
-	  starting_point = find_closest_module (starting_point.parent.value ());
+	  starting_point
+	    = find_closest_module (starting_point.get ().parent.value ());
 	  continue;
 	}
 
@@ -455,14 +477,27 @@ ForeverStack<N>::resolve_path (const std::vector<S> &segments)
   if (segments.size () == 1)
     return get (segments.back ().as_string ());
 
-  auto starting_point = cursor ();
+  // the same paths tend to be used again and again from a scope, so cache
+  // the node all but the last segment lead to. the last segment is still
+  // looked up, as definitions keep being added to the ribs.
+  std::string prefix;
+  for (auto seg = segments.begin (); !is_last (seg, segments); seg++)
+    prefix += seg->as_string () + "::";
+
+  auto &scope_cache = path_cache[&cursor ()];
+  auto cached = scope_cache.find (prefix);
+  if (cached != scope_cache.end ())
+    return cached->second->rib.get (segments.back ().as_string ());
+
+  std::reference_wrapper<Node> starting_point = cursor ();
 
   return find_starting_point (segments, starting_point)
     .and_then ([this, &segments, &starting_point] (
 		 typename std::vector<S>::const_iterator iterator) {
-      return resolve_segments (starting_point, segments, iterator);
+      return resolve_segments (starting_point.get (), segments, iterator);
     })
-    .and_then ([&segments] (Node final_node) {
+    .and_then ([&segments, &scope_cache, &prefix] (Node &final_node) {
+      scope_cache.emplace (prefix, &final_node);
       return final_node.rib.get (segments.back ().as_string ());
     });
 }
@@ -471,12 +506,12 @@ template <Namespace N>
 tl::optional<typename ForeverStack<N>::DfsResult>
 ForeverStack<N>::dfs (ForeverStack<N>::Node &starting_point, NodeId to_find)
 {
-  auto values = starting_point.rib.get_values ();
+  auto &values = starting_point.rib.get_values ();
 
   for (auto &kv : values)
     for (auto id : kv.second.ids)
       if (id == to_find)
-	return {{starting_point, kv.first}};
+	return {{starting_point, kv.first.as_string ()}};
 
   for (auto &child : starting_point.children)
     {
@@ -489,16 +524,36 @@ ForeverStack<N>::dfs (ForeverStack<N>::Node &starting_point, NodeId to_find)
   return tl::nullopt;
 }
 
+template <Namespace N>
+tl::optional<typename ForeverStack<N>::DfsResult>
+ForeverStack<N>::find_definition (NodeId id)
+{
+  auto indexed = definition_index.find (id);
+  if (indexed != definition_index.end ())
+    {
+      auto &node = *indexed->second.first;
+      auto &name = indexed->second.second;
+
+      // a shadowable definition can since have been replaced
+      auto definition = node.rib.get (name);
+      if (definition.has_value ()
+	  && std::find (definition->ids.begin (), definition->ids.end (), id)
+	       != definition->ids.end ())
+	return {{node, name}};
+    }
+
+  return dfs (root, id);
+}
+
 template <Namespace N>
 tl::optional<Resolver::CanonicalPath>
 ForeverStack<N>::to_canonical_path (NodeId id)
 {
-  // find the id in the current forever stack, starting from the root,
-  // performing either a BFS or DFS once the Node containing the ID is found, go
-  // back up to the root (parent().parent().parent()...) accumulate link
-  // segments reverse them that's your canonical path
+  // find the Node containing the ID, go back up to the root
+  // (parent().parent().parent()...) accumulate link segments reverse them
+  // that's your canonical path
 
-  return dfs (root, id).map ([this, id] (DfsResult tuple) {
+  return find_definition (id).map ([this, id] (DfsResult tuple) {
     auto containing_node = tuple.first;
     auto name = tuple.second;
 
@@ -508,20 +563,21 @@ ForeverStack<N>::to_canonical_path (NodeId id)
       if (current.is_root ())
 	return KeepGoing::No;
 
-      auto children = current.parent.value ().children;
+      auto &children = current.parent.value ().children;
       const Link *outer_link = nullptr;
 
-      for (auto &kv : children)
-	{
-	  auto &link = kv.first;
-	  auto &child = kv.second;
-
-	  if (link.id == child.id)
+      // links are ordered on their id, which is the id of the node they lead
+      // to when it was pushed
+      auto child = children.find (Link (current.id, tl::nullopt));
+      if (child != children.end () && &child->second == &current)
+	outer_link = &child->first;
+      else
+	for (auto &kv : children)
+	  if (&kv.second == &current)
 	    {
-	      outer_link = &link;
+	      outer_link = &kv.first;
 	      break;
 	    }
-	}
 
       rust_assert (outer_link);
 
@@ -567,6 +623,10 @@ template <Namespace N>
 tl::optional<Rib &>
 ForeverStack<N>::to_rib (NodeId rib_id)
 {
+  auto indexed = node_index.find (rib_id);
+  if (indexed != node_index.end ())
+    return indexed->second->rib;
+
   return dfs_rib (root, rib_id);
 }
 
@@ -585,7 +645,8 @@ ForeverStack<N>::stream_rib (std::stringstream &stream, const Rib &rib,
   stream << next << "rib: {\n";
 
   for (const auto &kv : rib.get_values ())
-    stream << next_next << kv.first << ": " << kv.second.to_string () << "\n";
+    stream << next_next << kv.first.as_string () << ": "
+	   << kv.second.to_string () << "\n";
 
   stream << next << "},\n";
 }
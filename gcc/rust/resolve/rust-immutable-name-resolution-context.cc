@@ -17,15 +17,15 @@
 // <http://www.gnu.org/licenses/>.
 
 #include "rust-immutable-name-resolution-context.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace Resolver2_0 {
 
-static ImmutableNameResolutionContext *instance = nullptr;
-
 const ImmutableNameResolutionContext &
 ImmutableNameResolutionContext::init (const NameResolutionContext &ctx)
 {
+  auto &instance = ThreadState::current ().name_resolution;
   rust_assert (!instance);
 
   instance = new ImmutableNameResolutionContext (ctx);
@@ -36,6 +36,7 @@ ImmutableNameResolutionContext::init (const NameResolutionContext &ctx)
 const ImmutableNameResolutionContext &
 ImmutableNameResolutionContext::get ()
 {
+  auto instance = ThreadState::current ().name_resolution;
   rust_assert (instance);
 
   return *instance;
@@ -142,6 +142,13 @@ public:
   // TODO: move to name-resolution-ctx.cc
   // storing it as a key in a map
   bool operator< (const Usage other) const { return other.id < id; }
+  bool operator== (const Usage other) const { return other.id == id; }
+
+  // NodeIds are handed out sequentially, they are their own hash
+  struct Hash
+  {
+    size_t operator() (const Usage usage) const { return usage.id; }
+  };
 
   NodeId id;
 };
@@ -211,9 +218,28 @@ public:
 
   tl::optional<NodeId> lookup (NodeId usage);
 
+  /**
+   * Items are settled once they contain nothing left to expand or to resolve
+   * in a later round of expansion: no macro invocation, no import and no
+   * nested item which could still get derived from. Collecting and resolving
+   * the definitions of the crate again after a round of expansion can then
+   * skip them, since whatever they defined is already in the `ForeverStack`s.
+   */
+  void settle_item (NodeId item) { settled_items.insert (item); }
+  bool is_settled_item (NodeId item) const
+  {
+    return settled_items.find (item) != settled_items.end ();
+  }
+
+  // The location of each definition inserted by `TopLevel`, to point at the
+  // previous definition of a duplicate one found in a later round
+  std::unordered_map<NodeId, location_t> definition_locations;
+
 private:
   /* Map of "usage" nodes which have been resolved to a "definition" node */
-  std::map<Usage, Definition> resolved_nodes;
+  std::unordered_map<Usage, Definition, Usage::Hash> resolved_nodes;
+
+  std::unordered_set<NodeId> settled_items;
 };
 
 } // namespace Resolver2_0
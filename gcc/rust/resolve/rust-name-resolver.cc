@@ -18,6 +18,7 @@
 
 #include "rust-name-resolver.h"
 #include "rust-ast-full.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace Resolver {
@@ -286,7 +287,7 @@ Resolver::Resolver ()
 Resolver *
 Resolver::get ()
 {
-  static Resolver *instance;
+  auto &instance = ThreadState::current ().legacy_resolver;
   if (instance == nullptr)
     instance = new Resolver ();
 
@@ -223,11 +223,12 @@ private:
   NodeId global_type_node_id;
   NodeId unit_ty_node_id;
 
-  // map a AST Node to a Rib
-  std::map<NodeId, Rib *> name_ribs;
-  std::map<NodeId, Rib *> type_ribs;
-  std::map<NodeId, Rib *> label_ribs;
-  std::map<NodeId, Rib *> macro_ribs;
+  // map a AST Node to a Rib. These maps and the resolution tables below are
+  // only ever looked up by NodeId, never walked, so they are hashed.
+  std::unordered_map<NodeId, Rib *> name_ribs;
+  std::unordered_map<NodeId, Rib *> type_ribs;
+  std::unordered_map<NodeId, Rib *> label_ribs;
+  std::unordered_map<NodeId, Rib *> macro_ribs;
 
   // Rust uses DefIds to namespace these under a crate_num
   // but then it uses the def_collector to assign local_defids
@@ -237,13 +238,13 @@ private:
 
   // these are of the form ref->Def-NodeId
   // we need two namespaces one for names and ones for types
-  std::map<NodeId, NodeId> resolved_names;
-  std::map<NodeId, NodeId> resolved_types;
-  std::map<NodeId, NodeId> resolved_labels;
-  std::map<NodeId, NodeId> resolved_macros;
+  std::unordered_map<NodeId, NodeId> resolved_names;
+  std::unordered_map<NodeId, NodeId> resolved_types;
+  std::unordered_map<NodeId, NodeId> resolved_labels;
+  std::unordered_map<NodeId, NodeId> resolved_macros;
 
   // misc
-  std::map<NodeId, NodeId> misc_resolved_items;
+  std::unordered_map<NodeId, NodeId> misc_resolved_items;
 
   // keep track of the current module scope ids
   std::vector<NodeId> current_module_stack;
@@ -73,21 +73,47 @@ Rib::Rib (Kind kind, std::unordered_map<std::string, NodeId> to_insert)
   : kind (kind)
 {
   for (auto &value : to_insert)
-    values.insert ({value.first, Definition::NonShadowable (value.second)});
+    insert (value.first, Definition::NonShadowable (value.second));
+}
+
+tl::optional<Rib::Definition &>
+Rib::find (Symbol name)
+{
+  if (!index.empty ())
+    {
+      auto it = index.find (name);
+      if (it == index.end ())
+	return tl::nullopt;
+
+      return values[it->second].second;
+    }
+
+  for (auto &value : values)
+    if (value.first == name)
+      return value.second;
+
+  return tl::nullopt;
 }
 
 tl::expected<NodeId, DuplicateNameError>
 Rib::insert (std::string name, Definition def)
 {
-  auto it = values.find (name);
-  if (it == values.end ())
+  auto symbol = Symbol::intern (name);
+  auto existing = find (symbol);
+  if (!existing)
     {
       /* No old value */
-      values[name] = def;
+      values.emplace_back (symbol, def);
+
+      if (!index.empty ())
+	index.emplace (symbol, values.size () - 1);
+      else if (values.size () > kMaxUnindexedSize)
+	for (size_t i = 0; i < values.size (); i++)
+	  index.emplace (values[i].first, i);
     }
-  else if (it->second.shadowable && def.shadowable)
+  else if (existing->shadowable && def.shadowable)
     { /* Both shadowable */
-      auto &current = values[name];
+      auto &current = existing.value ();
       for (auto id : def.ids)
 	{
 	  if (std::find (current.ids.cbegin (), current.ids.cend (), id)
@@ -97,14 +123,14 @@ Rib::insert (std::string name, Definition def)
 	    }
 	}
     }
-  else if (it->second.shadowable)
+  else if (existing->shadowable)
     { /* Only old shadowable : replace value */
-      values[name] = def;
+      existing.value () = def;
     }
   else /* Neither are shadowable */
     {
       return tl::make_unexpected (
-	DuplicateNameError (name, it->second.ids.back ()));
+	DuplicateNameError (name, existing->ids.back ()));
     }
 
   return def.ids.back ();
@@ -113,15 +139,24 @@ Rib::insert (std::string name, Definition def)
 tl::optional<Rib::Definition>
 Rib::get (const std::string &name)
 {
-  auto it = values.find (name);
+  auto symbol = Symbol::lookup (name);
+  if (!symbol)
+    return tl::nullopt;
 
-  if (it == values.end ())
+  return get (symbol.value ());
+}
+
+tl::optional<Rib::Definition>
+Rib::get (Symbol name)
+{
+  auto found = find (name);
+  if (!found)
     return tl::nullopt;
 
-  return it->second;
+  return found.value ();
 }
 
-const std::unordered_map<std::string, Rib::Definition> &
+const std::vector<std::pair<Symbol, Rib::Definition>> &
 Rib::get_values () const
 {
   return values;
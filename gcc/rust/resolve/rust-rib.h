@@ -23,6 +23,7 @@
 #include "rust-ast.h"
 #include "optional.h"
 #include "expected.h"
+#include "rust-symbol.h"
 
 namespace Rust {
 namespace Resolver2_0 {
@@ -179,13 +180,22 @@ public:
    * @return tl::nullopt if the key does not exist, the NodeId otherwise
    */
   tl::optional<Rib::Definition> get (const std::string &name);
+  tl::optional<Rib::Definition> get (Symbol name);
 
-  /* View all the values stored in the rib */
-  const std::unordered_map<std::string, Definition> &get_values () const;
+  /* View all the values stored in the rib, in insertion order */
+  const std::vector<std::pair<Symbol, Definition>> &get_values () const;
 
 private:
+  tl::optional<Definition &> find (Symbol name);
+
+  // Most ribs hold a handful of names, which are found faster by scanning
+  // them than by hashing. Larger ribs are indexed.
+  static const size_t kMaxUnindexedSize = 8;
+
   // TODO: Switch this to (NodeId, shadowable = false);
-  std::unordered_map<std::string, Definition> values;
+  std::vector<std::pair<Symbol, Definition>> values;
+  // position of each name in `values`, once there are too many to scan
+  std::unordered_map<Symbol, size_t> index;
 };
 
 } // namespace Resolver2_0
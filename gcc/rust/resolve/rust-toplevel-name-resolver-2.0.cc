@@ -126,7 +126,7 @@ GlobbingVisitor::visit (AST::UseDeclaration &use)
 }
 
 TopLevel::TopLevel (NameResolutionContext &resolver)
-  : DefaultResolver (resolver)
+  : DefaultResolver (resolver), node_locations (resolver.definition_locations)
 {}
 
 template <typename T>
@@ -165,8 +165,15 @@ TopLevel::go (AST::Crate &crate)
   // times in a row in a fixed-point fashion, so it would make the code
   // responsible for this ugly and perfom a lot of error checking.
 
-  for (auto &item : crate.items)
-    item->accept_vis (*this);
+  visit_items (crate.items);
+}
+
+void
+TopLevel::visit_items (std::vector<std::unique_ptr<AST::Item>> &items)
+{
+  for (auto &item : items)
+    if (!ctx.is_settled_item (item->get_node_id ()))
+      item->accept_vis (*this);
 }
 
 void
@@ -174,10 +181,7 @@ TopLevel::visit (AST::Module &module)
 {
   insert_or_error_out (module.get_name (), module, Namespace::Types);
 
-  auto sub_visitor = [this, &module] () {
-    for (auto &item : module.get_items ())
-      item->accept_vis (*this);
-  };
+  auto sub_visitor = [this, &module] () { visit_items (module.get_items ()); };
 
   ctx.scoped (Rib::Kind::Module, module.get_node_id (), sub_visitor,
 	      module.get_name ());
@@ -273,7 +277,7 @@ static bool
 is_macro_export (AST::MacroRulesDefinition &def)
 {
   for (const auto &attr : def.get_outer_attrs ())
-    if (attr.get_path ().as_string () == Values::Attributes::MACRO_EXPORT)
+    if (attr.get_builtin () == Values::BuiltinAttribute::MACRO_EXPORT)
       return true;
 
   return false;
@@ -723,6 +727,17 @@ flatten_glob (const AST::UseTreeGlob &glob, std::vector<AST::SimplePath> &paths,
     paths.emplace_back (glob.get_path ());
 }
 
+void
+TopLevel::mark_reexport (const AST::SimplePath &path)
+{
+  auto &mappings = Analysis::Mappings::get ();
+
+  if (auto value = ctx.values.resolve_path (path.get_segments ()))
+    mappings.insert_reexported_item (value->get_node_id ());
+  if (auto type = ctx.types.resolve_path (path.get_segments ()))
+    mappings.insert_reexported_item (type->get_node_id ());
+}
+
 void
 TopLevel::visit (AST::UseDeclaration &use)
 {
@@ -753,6 +768,17 @@ TopLevel::visit (AST::UseDeclaration &use)
       rust_error_at (rebind.first.get_final_segment ().get_locus (),
 		     ErrorCode::E0433, "unresolved import %qs",
 		     rebind.first.as_string ().c_str ());
+
+  // other crates can name what a `pub use` imports through its path
+  if (use.get_visibility ().get_vis_type () != AST::Visibility::PUB)
+    return;
+
+  for (auto &path : paths)
+    mark_reexport (path);
+  for (auto &glob : glob_path)
+    mark_reexport (glob);
+  for (auto &rebind : rebind_path)
+    mark_reexport (rebind.first);
 }
 
 } // namespace Resolver2_0
@@ -64,6 +64,10 @@ public:
   void go (AST::Crate &crate);
 
 private:
+  // Visit the items of a module, skipping the ones collected in a previous
+  // round of expansion which cannot have changed since
+  void visit_items (std::vector<std::unique_ptr<AST::Item>> &items);
+
   /**
    * Insert a new definition or error out if a definition with the same name was
    * already present in the same namespace in the same scope.
@@ -81,7 +85,7 @@ private:
 			    Namespace ns);
 
   // FIXME: Do we move these to our mappings?
-  std::unordered_map<NodeId, location_t> node_locations;
+  std::unordered_map<NodeId, location_t> &node_locations;
 
   // Store node forwarding for use declaration, the link between a
   // "new" local name and its definition.
@@ -112,6 +116,9 @@ private:
   bool handle_use_glob (AST::SimplePath &glob);
   bool handle_rebind (std::pair<AST::SimplePath, AST::UseTreeRebind> &pair);
 
+  // Record what PATH resolves to as re-exported by a `pub use`
+  void mark_reexport (const AST::SimplePath &path);
+
   void visit (AST::UseDeclaration &use) override;
 };
 
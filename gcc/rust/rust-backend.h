@@ -135,6 +135,13 @@ function_ptr_type (tree result, const std::vector<tree> &praameters,
 tree
 struct_type (const std::vector<typed_identifier> &fields);
 
+// Get a struct type whose fields are laid out by decreasing alignment to
+// reduce padding, except for the first N_FIXED ones which keep their place.
+// The fields are still accessed and initialized by declaration index.
+tree
+reordered_struct_type (const std::vector<typed_identifier> &fields,
+		       size_t n_fixed);
+
 // Get a union type.
 tree
 union_type (const std::vector<typed_identifier> &fields);
@@ -161,6 +168,11 @@ int64_t type_alignment (tree);
 // normally the same as type_alignment, but not always.
 int64_t type_field_alignment (tree);
 
+// Whether TYPE is a fat pointer, which the Rust functions take as the two
+// scalars of its fields rather than as an aggregate: the data pointer, and
+// the length or the vtable.
+bool is_scalar_pair (tree type);
+
 // Return the offset of field INDEX in a struct type.  INDEX is the
 // entry in the FIELDS std::vector parameter of struct_type or
 // set_placeholder_struct_type.
@@ -217,16 +229,26 @@ tree
 conditional_expression (tree function, tree btype, tree condition,
 			tree then_expr, tree else_expr, location_t);
 
+// Return an expression for LEFT OP RIGHT, or OP LEFT when OP is unary, which
+// wraps around on overflow.
+tree
+wrapping_expression (tree_code op, tree left, tree right, location_t);
+
 // Return an expression for the negation operation OP EXPR.
 // Supported values of OP are enumerated in NegationOperator.
+// Signed integers wrap around unless WRAPPING is false, as in const contexts,
+// where the overflow is diagnosed instead.
 tree
-negation_expression (NegationOperator op, tree expr, location_t);
+negation_expression (NegationOperator op, tree expr, location_t,
+		     bool wrapping = true);
 
 // Return an expression for the operation LEFT OP RIGHT.
 // Supported values of OP are enumerated in ArithmeticOrLogicalOperator.
+// Signed integers wrap around unless WRAPPING is false, as for negation.
 tree
 arithmetic_or_logical_expression (ArithmeticOrLogicalOperator op, tree left,
-				  tree right, location_t loc);
+				  tree right, location_t loc,
+				  bool wrapping = true);
 
 // Return an expression for the operation LEFT OP RIGHT.
 // Supported values of OP are enumerated in ArithmeticOrLogicalOperator.
@@ -265,6 +287,11 @@ array_constructor_expression (tree btype,
 			      const std::vector<unsigned long> &indexes,
 			      const std::vector<tree> &vals, location_t);
 
+// Return a constant expression for an array of BTYPE with every element set
+// to VAL, whose size does not depend on the length of the array.
+tree
+array_repeat_constructor_expression (tree btype, tree val, location_t);
+
 tree
 array_initializer (tree, tree, tree, tree, tree, tree *, location_t);
 
@@ -273,6 +300,16 @@ array_initializer (tree, tree, tree, tree, tree, tree *, location_t);
 tree
 array_index_expression (tree array, tree index, location_t);
 
+// Return an expression for lane INDEX of the vector VECTOR as an l-value.
+tree
+vector_lane_expression (tree vector, tree index, location_t);
+
+// Return an expression for ARRAY[INDEX] as an l-value, which aborts when
+// INDEX is out of the bounds of ARRAY.  The check is left out when INDEX is a
+// constant within them.
+tree
+array_index_expression_checked (tree array, tree index, location_t);
+
 // Create an expression for a call to FN with ARGS, taking place within
 // caller CALLER.
 tree
@@ -485,8 +522,13 @@ function_set_parameters (tree function,
 
 // Utility.
 
+// Hand the completed body of FNDECL over to the middle-end.
+void
+write_function_definition (tree fndecl);
+
 // Write the definitions for all TYPE_DECLS, CONSTANT_DECLS,
-// FUNCTION_DECLS, and VARIABLE_DECLS declared globally.
+// FUNCTION_DECLS, and VARIABLE_DECLS declared globally. The functions must
+// already have been written by write_function_definition.
 void
 write_global_definitions (const std::vector<tree> &type_decls,
 			  const std::vector<tree> &constant_decls,
@@ -506,4 +548,13 @@ tree convert_tree (tree, tree, location_t);
 
 } // namespace Backend
 
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_backend_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
 #endif // RUST_BACKEND_H
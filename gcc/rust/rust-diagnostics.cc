@@ -192,6 +192,21 @@ rust_error_at (const location_t location, const char *fmt, ...)
   va_end (ap);
 }
 
+/* Errors with a code that have already been reported, with their location.
+   A cascading failure tends to report the same error at the same place again
+   and again, so only the first report is kept, and the message of the others
+   is never even formatted.  */
+static std::set<std::pair<location_t, ErrorCode>> reported_errors;
+
+static bool
+already_reported (const location_t location, const ErrorCode code)
+{
+  if (location == UNDEF_LOCATION)
+    return false;
+
+  return !reported_errors.emplace (location, code).second;
+}
+
 class rust_error_code_rule : public diagnostic_metadata::rule
 {
 public:
@@ -247,6 +262,9 @@ void
 rust_error_at (const location_t location, const ErrorCode code, const char *fmt,
 	       ...)
 {
+  if (already_reported (location, code))
+    return;
+
   va_list ap;
 
   va_start (ap, fmt);
@@ -270,6 +288,9 @@ void
 rust_error_at (const rich_location &location, const ErrorCode code,
 	       const char *fmt, ...)
 {
+  if (already_reported (location.get_loc (), code))
+    return;
+
   va_list ap;
 
   va_start (ap, fmt);
@@ -291,6 +312,9 @@ void
 rust_error_at (rich_location *richloc, const ErrorCode code, const char *fmt,
 	       ...)
 {
+  if (already_reported (richloc->get_loc (), code))
+    return;
+
   /* TODO: Refactoring diagnostics to this overload */
   va_list ap;
 
@@ -391,7 +415,7 @@ rust_be_debug_p (void)
 }
 
 void
-rust_debug_loc (const location_t location, const char *fmt, ...)
+rust_debug_print (const location_t location, const char *fmt, ...)
 {
   if (!rust_be_debug_p ())
     return;
@@ -302,12 +302,16 @@ struct Error
 } // namespace Rust
 
 // rust_debug uses normal printf formatting, not GCC diagnostic formatting.
+// The arguments are only evaluated when -frust-debug is given, so they can be
+// expensive to compute, e.g. dumps of whole token streams or types.
 #define rust_debug(...) rust_debug_loc (UNDEF_LOCATION, __VA_ARGS__)
+#define rust_debug_loc(location, ...)                                          \
+  (rust_be_debug_p () ? rust_debug_print (location, __VA_ARGS__) : (void) 0)
 
 #define rust_sorry_at(location, ...) sorry_at (location, __VA_ARGS__)
 
 void
-rust_debug_loc (const location_t location, const char *fmt,
-		...) ATTRIBUTE_PRINTF_2;
+rust_debug_print (const location_t location, const char *fmt,
+		  ...) ATTRIBUTE_PRINTF_2;
 
 #endif // !defined(RUST_DIAGNOSTICS_H)
@@ -45,6 +45,7 @@
 #include "builtins.h"
 #include "print-tree.h"
 #include "attribs.h"
+#include "predict.h"
 
 #include "rust-location.h"
 #include "rust-linemap.h"
@@ -54,6 +55,8 @@
 
 #include "backend/rust-tree.h"
 #include "backend/rust-builtins.h"
+#include "backend/rust-check-remarks.h"
+#include "selftest.h"
 
 // Get the tree of a variable for use as an expression.  If this is a
 // zero-sized global, create an expression that refers to the decl but
@@ -597,6 +600,60 @@ struct_type (const std::vector<typed_identifier> &fields)
   return fill_in_fields (make_node (RECORD_TYPE), fields);
 }
 
+// Make a struct type with reordered fields.
+
+tree
+reordered_struct_type (const std::vector<typed_identifier> &fields,
+		       size_t n_fixed)
+{
+  for (auto &field : fields)
+    if (field.type == error_mark_node)
+      return error_mark_node;
+
+  std::vector<size_t> order (fields.size ());
+  std::iota (order.begin (), order.end (), 0);
+  std::stable_sort (order.begin () + std::min (n_fixed, order.size ()),
+		    order.end (), [&] (size_t a, size_t b) {
+		      return TYPE_ALIGN (fields[a].type)
+			     > TYPE_ALIGN (fields[b].type);
+		    });
+
+  std::vector<typed_identifier> laid_out;
+  for (auto index : order)
+    laid_out.push_back (fields[index]);
+
+  tree type = fill_in_fields (make_node (RECORD_TYPE), laid_out);
+  if (type == error_mark_node
+      || std::is_sorted (order.begin (), order.end ()))
+    return type;
+
+  tree declared_fields = make_tree_vec (fields.size ());
+  size_t i = 0;
+  for (tree field = TYPE_FIELDS (type); field != NULL_TREE;
+       field = DECL_CHAIN (field))
+    TREE_VEC_ELT (declared_fields, order[i++]) = field;
+  RS_DECLARED_FIELDS (type) = declared_fields;
+
+  return type;
+}
+
+// Return the field at INDEX in declaration order of the struct or union TYPE.
+
+static tree
+declared_field (tree type, size_t index)
+{
+  if (TREE_CODE (type) == RECORD_TYPE && RS_DECLARED_FIELDS (type) != NULL_TREE)
+    return TREE_VEC_ELT (RS_DECLARED_FIELDS (type), index);
+
+  tree field = TYPE_FIELDS (type);
+  for (; index > 0; --index)
+    {
+      field = DECL_CHAIN (field);
+      gcc_assert (field != NULL_TREE);
+    }
+  return field;
+}
+
 // Make a union type.
 
 tree
@@ -744,6 +801,15 @@ type_field_alignment (tree t)
   return rust_field_alignment (t);
 }
 
+// Slices, strings and trait objects are the only records flagged as DSTs.
+
+bool
+is_scalar_pair (tree type)
+{
+  return type != error_mark_node && RS_DST_FLAG_P (type)
+	 && list_length (TYPE_FIELDS (type)) == 2;
+}
+
 // Return the offset of a field in a struct.
 
 int64_t
@@ -752,12 +818,7 @@ type_field_offset (tree struct_tree, size_t index)
   if (struct_tree == error_mark_node)
     return 0;
   gcc_assert (TREE_CODE (struct_tree) == RECORD_TYPE);
-  tree field = TYPE_FIELDS (struct_tree);
-  for (; index > 0; --index)
-    {
-      field = DECL_CHAIN (field);
-      gcc_assert (field != NULL_TREE);
-    }
+  tree field = declared_field (struct_tree, index);
   HOST_WIDE_INT offset_wide = int_byte_position (field);
   int64_t ret = static_cast<int64_t> (offset_wide);
   gcc_assert (ret == offset_wide);
@@ -811,7 +872,9 @@ string_constant_expression (const std::string &val)
   tree const_char_type = build_qualified_type (char_type_node, TYPE_QUAL_CONST);
   tree string_type = build_array_type (const_char_type, index_type);
   TYPE_STRING_FLAG (string_type) = 1;
-  tree string_val = build_string (val.length (), val.data ());
+  // the terminating NUL is part of the constant, which lets it go to the
+  // mergeable string sections the linker deduplicates across objects
+  tree string_val = build_string (val.length () + 1, val.c_str ());
   TREE_TYPE (string_val) = string_type;
 
   return string_val;
@@ -870,6 +933,26 @@ convert_expression (tree type_tree, tree expr_tree, location_t location)
   return ret;
 }
 
+// Return an expression for lane INDEX of VECTOR_TREE.
+
+tree
+vector_lane_expression (tree vector_tree, tree index, location_t location)
+{
+  if (vector_tree == error_mark_node || index == error_mark_node)
+    return error_mark_node;
+
+  // going through an array keeps the lane an l-value, see
+  // c_common_mark_addressable_vec
+  tree vector_type = TREE_TYPE (vector_tree);
+  tree element_type = TREE_TYPE (vector_type);
+  tree array_type
+    = build_array_type_nelts (element_type, TYPE_VECTOR_SUBPARTS (vector_type));
+  tree array
+    = build1_loc (location, VIEW_CONVERT_EXPR, array_type, vector_tree);
+  return build4_loc (location, ARRAY_REF, element_type, array, index,
+		     NULL_TREE, NULL_TREE);
+}
+
 // Return an expression for the field at INDEX in BSTRUCT.
 
 tree
@@ -878,6 +961,11 @@ struct_field_expression (tree struct_tree, size_t index, location_t location)
   if (struct_tree == error_mark_node
       || TREE_TYPE (struct_tree) == error_mark_node)
     return error_mark_node;
+
+  // the fields of a #[repr(simd)] struct are the lanes of a vector
+  if (TREE_CODE (TREE_TYPE (struct_tree)) == VECTOR_TYPE)
+    return vector_lane_expression (struct_tree, size_int (index), location);
+
   gcc_assert (TREE_CODE (TREE_TYPE (struct_tree)) == RECORD_TYPE
 	      || TREE_CODE (TREE_TYPE (struct_tree)) == UNION_TYPE);
   tree field = TYPE_FIELDS (TREE_TYPE (struct_tree));
@@ -887,11 +975,7 @@ struct_field_expression (tree struct_tree, size_t index, location_t location)
       // and then turns out to be erroneous.
       return error_mark_node;
     }
-  for (unsigned int i = index; i > 0; --i)
-    {
-      field = DECL_CHAIN (field);
-      gcc_assert (field != NULL_TREE);
-    }
+  field = declared_field (TREE_TYPE (struct_tree), index);
   if (TREE_TYPE (field) == error_mark_node)
     return error_mark_node;
   tree ret = fold_build3_loc (location, COMPONENT_REF, TREE_TYPE (field),
@@ -1026,9 +1110,20 @@ is_floating_point (tree t)
   return tree_type == REAL_TYPE || tree_type == COMPLEX_TYPE;
 }
 
+// Whether an operation on LEFT and RIGHT keeps its own tree code rather than
+// wrapping around. The overflow of signed constants is left for the constant
+// evaluator to report, as it is in const contexts.
+static bool
+keeps_overflow (bool floating_point, bool wrapping, tree left, tree right)
+{
+  return floating_point || !wrapping
+	 || (TREE_CODE (left) == INTEGER_CST && TREE_CODE (right) == INTEGER_CST);
+}
+
 // Return an expression for the negation operation OP EXPR.
 tree
-negation_expression (NegationOperator op, tree expr_tree, location_t location)
+negation_expression (NegationOperator op, tree expr_tree, location_t location,
+		     bool wrapping)
 {
   /* Check if the expression is an error, in which case we return an error
      expression. */
@@ -1056,15 +1151,47 @@ negation_expression (NegationOperator op, tree expr_tree, location_t location)
     }
 
   /* Construct a new tree and build an expression from it. */
-  auto new_tree = fold_build1_loc (location, tree_code, tree_type, expr_tree);
+  bool keep = keeps_overflow (floating_point, wrapping, expr_tree, expr_tree);
+  auto new_tree = keep
+		    ? fold_build1_loc (location, tree_code, tree_type, expr_tree)
+		    : wrapping_expression (tree_code, expr_tree, NULL_TREE,
+					   location);
   if (floating_point && extended_type != NULL_TREE)
     new_tree = convert (original_type, expr_tree);
   return new_tree;
 }
 
+// Return LEFT OP RIGHT wrapping around on overflow. Signed arithmetic only
+// wraps around when it is performed on the unsigned type, GCC assumes that
+// it never overflows otherwise
+tree
+wrapping_expression (tree_code op, tree left, tree right, location_t location)
+{
+  tree type = TREE_TYPE (left);
+  if (!INTEGRAL_TYPE_P (type) || TYPE_UNSIGNED (type)
+      || (op != PLUS_EXPR && op != MINUS_EXPR && op != MULT_EXPR
+	  && op != NEGATE_EXPR))
+    {
+      if (right == NULL_TREE)
+	return fold_build1_loc (location, op, type, left);
+      return fold_build2_loc (location, op, type, left, right);
+    }
+
+  tree utype = unsigned_type_for (type);
+  left = fold_convert_loc (location, utype, left);
+  tree result;
+  if (right == NULL_TREE)
+    result = fold_build1_loc (location, op, utype, left);
+  else
+    result = fold_build2_loc (location, op, utype, left,
+			      fold_convert_loc (location, utype, right));
+
+  return fold_convert_loc (location, type, result);
+}
+
 tree
 arithmetic_or_logical_expression (ArithmeticOrLogicalOperator op, tree left,
-				  tree right, location_t location)
+				  tree right, location_t location, bool wrapping)
 {
   /* Check if either expression is an error, in which case we return an error
      expression. */
@@ -1096,7 +1223,9 @@ arithmetic_or_logical_expression (ArithmeticOrLogicalOperator op, tree left,
 	}
     }
 
-  ret = fold_build2_loc (location, tree_code, tree_type, left, right);
+  ret = keeps_overflow (floating_point, wrapping, left, right)
+	  ? fold_build2_loc (location, tree_code, tree_type, left, right)
+	  : wrapping_expression (tree_code, left, right, location);
   TREE_CONSTANT (ret) = TREE_CONSTANT (left) & TREE_CONSTANT (right);
 
   // TODO: How do we handle floating point?
@@ -1120,13 +1249,12 @@ is_overflowing_expr (ArithmeticOrLogicalOperator op)
     }
 }
 
-static std::pair<tree, tree>
-fetch_overflow_builtins (ArithmeticOrLogicalOperator op)
+static tree
+fetch_overflow_builtin (ArithmeticOrLogicalOperator op)
 {
-  auto builtin_ctx = Rust::Compile::BuiltinsContext::get ();
+  auto &builtin_ctx = Rust::Compile::BuiltinsContext::get ();
 
   auto builtin = NULL_TREE;
-  auto abort = NULL_TREE;
 
   switch (op)
     {
@@ -1144,12 +1272,41 @@ fetch_overflow_builtins (ArithmeticOrLogicalOperator op)
       break;
     };
 
-  builtin_ctx.lookup_simple_builtin ("__builtin_abort", &abort);
+  rust_assert (builtin);
+
+  return builtin;
+}
 
+// Return the statements aborting when a runtime check fails. Failing is the
+// exceptional case, predicting it as never taken keeps it out of the hot path
+static tree
+failed_check_abort (location_t location, Rust::CheckRemarks::Kind kind)
+{
+  if (Rust::CheckRemarks::enabled ())
+    Rust::CheckRemarks::get ().record_check (location, kind);
+
+  auto abort = NULL_TREE;
+  Rust::Compile::BuiltinsContext::get ().lookup_simple_builtin (
+    "__builtin_abort", &abort);
   rust_assert (abort);
-  rust_assert (builtin);
 
-  return {abort, builtin};
+  auto stmts = NULL_TREE;
+  append_to_statement_list (build_predict_expr (PRED_COLD_LABEL, NOT_TAKEN),
+			    &stmts);
+  append_to_statement_list (build_call_expr_loc (location, abort, 0), &stmts);
+
+  return stmts;
+}
+
+// Whether arithmetic should abort on overflow. Unless requested otherwise with
+// -frust-overflow-checks, overflows are only checked when not optimizing
+static bool
+overflow_checks_enabled ()
+{
+  if (flag_rust_overflow_checks != -1)
+    return flag_rust_overflow_checks;
+
+  return optimize == 0;
 }
 
 // Return an expression for the arithmetic or logical operation LEFT OP RIGHT
@@ -1165,7 +1322,6 @@ arithmetic_or_logical_expression_checked (ArithmeticOrLogicalOperator op,
   if (left == error_mark_node || right == error_mark_node)
     return error_mark_node;
 
-  // FIXME: Add `if (!debug_mode)`
   // No overflow checks for floating point operations or divisions. In that
   // case, simply assign the result of the operation to the receiver variable
   if (is_floating_point (left) || !is_overflowing_expr (op))
@@ -1173,15 +1329,19 @@ arithmetic_or_logical_expression_checked (ArithmeticOrLogicalOperator op,
       receiver_var->get_tree (location),
       arithmetic_or_logical_expression (op, left, right, location), location);
 
+  // Without overflow checks the operation wraps around
+  if (!overflow_checks_enabled ())
+    return assignment_statement (
+      receiver_var->get_tree (location),
+      arithmetic_or_logical_expression (op, left, right, location), location);
+
   auto receiver = receiver_var->get_tree (location);
   TREE_ADDRESSABLE (receiver) = 1;
   auto result_ref = build_fold_addr_expr_loc (location, receiver);
 
-  auto builtins = fetch_overflow_builtins (op);
-  auto abort = builtins.first;
-  auto builtin = builtins.second;
-
-  auto abort_call = build_call_expr_loc (location, abort, 0);
+  auto builtin = fetch_overflow_builtin (op);
+  auto abort_call
+    = failed_check_abort (location, Rust::CheckRemarks::Kind::OVERFLOW);
 
   auto builtin_call
     = build_call_expr_loc (location, builtin, 3, left, right, result_ref);
@@ -1236,6 +1396,17 @@ lazy_boolean_expression (LazyBooleanOperator op, tree left_tree,
   return new_tree;
 }
 
+// Order the constructor elements A and B by the position of their field.
+
+static int
+compare_field_position (const void *a, const void *b)
+{
+  auto x = static_cast<const constructor_elt *> (a);
+  auto y = static_cast<const constructor_elt *> (b);
+  return tree_int_cst_compare (bit_position (x->index),
+			       bit_position (y->index));
+}
+
 // Return an expression that constructs BTYPE with VALS.
 
 tree
@@ -1251,6 +1422,25 @@ constructor_expression (tree type_tree, bool is_variant,
 
   tree sink = NULL_TREE;
   bool is_constant = true;
+
+  // #[repr(simd)] structs are built lane by lane
+  if (TREE_CODE (type_tree) == VECTOR_TYPE)
+    {
+      for (auto val : vals)
+	{
+	  if (val == error_mark_node || TREE_TYPE (val) == error_mark_node)
+	    return error_mark_node;
+
+	  tree lane = convert_tree (TREE_TYPE (type_tree), val, location);
+	  if (!TREE_CONSTANT (lane))
+	    is_constant = false;
+	  CONSTRUCTOR_APPEND_ELT (init, NULL_TREE, lane);
+	}
+
+      tree ret = build_constructor (type_tree, init);
+      TREE_CONSTANT (ret) = is_constant;
+      return ret;
+    }
   tree field = TYPE_FIELDS (type_tree);
 
   if (is_variant)
@@ -1311,11 +1501,11 @@ constructor_expression (tree type_tree, bool is_variant,
       else
 	{
 	  gcc_assert (TREE_CODE (type_tree) == RECORD_TYPE);
-	  for (std::vector<tree>::const_iterator p = vals.begin ();
-	       p != vals.end (); ++p, field = DECL_CHAIN (field))
+	  for (size_t i = 0; i < vals.size (); i++)
 	    {
+	      field = declared_field (type_tree, i);
 	      gcc_assert (field != NULL_TREE);
-	      tree val = (*p);
+	      tree val = vals[i];
 	      if (TREE_TYPE (field) == error_mark_node || val == error_mark_node
 		  || TREE_TYPE (val) == error_mark_node)
 		return error_mark_node;
@@ -1338,7 +1528,12 @@ constructor_expression (tree type_tree, bool is_variant,
 	      if (!TREE_CONSTANT (elt->value))
 		is_constant = false;
 	    }
-	  gcc_assert (field == NULL_TREE);
+	  gcc_assert (vals.size ()
+		      == (size_t) list_length (TYPE_FIELDS (type_tree)));
+
+	  // the elements must follow the fields as they are laid out
+	  if (RS_DECLARED_FIELDS (type_tree) != NULL_TREE)
+	    init->qsort (compare_field_position);
 	}
     }
 
@@ -1350,6 +1545,51 @@ constructor_expression (tree type_tree, bool is_variant,
   return ret;
 }
 
+tree
+array_repeat_constructor_expression (tree type_tree, tree val,
+				     location_t location)
+{
+  if (type_tree == error_mark_node || val == error_mark_node)
+    return error_mark_node;
+
+  tree domain = TYPE_DOMAIN (type_tree);
+  gcc_assert (domain != NULL_TREE);
+
+  tree element_type = TREE_TYPE (type_tree);
+  HOST_WIDE_INT element_size = int_size_in_bytes (element_type);
+
+  // an empty constructor already zero initializes the whole array, and
+  // arrays of zero-sized types are built without any element, see
+  // array_constructor_expression
+  tree index_type = TREE_TYPE (domain);
+  offset_int length = wi::ext (wi::to_offset (TYPE_MAX_VALUE (domain))
+				 - wi::to_offset (TYPE_MIN_VALUE (domain)) + 1,
+			       TYPE_PRECISION (index_type),
+			       TYPE_SIGN (index_type));
+  bool is_empty = length == 0;
+  if (element_size == 0 || is_empty || initializer_zerop (val))
+    {
+      tree ret = build_constructor (type_tree, NULL);
+      TREE_CONSTANT (ret) = 1;
+      if (TREE_SIDE_EFFECTS (val))
+	ret = fold_build2_loc (location, COMPOUND_EXPR, type_tree, val, ret);
+      return ret;
+    }
+
+  // a single element covering every index of the array
+  tree range = build2 (RANGE_EXPR, sizetype,
+		       fold_convert (sizetype, TYPE_MIN_VALUE (domain)),
+		       fold_convert (sizetype, TYPE_MAX_VALUE (domain)));
+
+  vec<constructor_elt, va_gc> *init = NULL;
+  CONSTRUCTOR_APPEND_ELT (init, range, val);
+
+  tree ret = build_constructor (type_tree, init);
+  if (TREE_CONSTANT (val))
+    TREE_CONSTANT (ret) = 1;
+  return ret;
+}
+
 tree
 array_constructor_expression (tree type_tree,
 			      const std::vector<unsigned long> &indexes,
@@ -1403,8 +1643,51 @@ array_constructor_expression (tree type_tree,
   return ret;
 }
 
+// The byte which VALUE of SIZE bytes repeats, or -1 when its bytes differ or
+// it is not a constant
+
+static int
+splat_byte (tree value, unsigned HOST_WIDE_INT size)
+{
+  const unsigned HOST_WIDE_INT max_size = 64;
+  if (size == 0 || size > max_size
+      || (!CONSTANT_CLASS_P (value) && TREE_CODE (value) != CONSTRUCTOR))
+    return -1;
+
+  unsigned char bytes[max_size];
+  if (native_encode_initializer (value, bytes, size) != (int) size)
+    return -1;
+
+  for (unsigned HOST_WIDE_INT i = 1; i < size; i++)
+    if (bytes[i] != bytes[0])
+      return -1;
+
+  return bytes[0];
+}
+
+// A call to the builtin NAME with ARGS
+
+static tree
+builtin_call (const char *name, const std::vector<tree> &args,
+	      location_t locus)
+{
+  tree builtin = NULL_TREE;
+  BuiltinsContext::get ().lookup_simple_builtin (name, &builtin);
+  rust_assert (builtin);
+
+  return call_expression (build_fold_addr_expr_loc (locus, builtin), args,
+			  NULL_TREE, locus);
+}
+
 // Build insns to create an array, initialize all elements of the array to
-// value, and return it
+// value, and return it.
+//
+// The elements are copies of VALUE, so when the length is known they are not
+// stored one at a time: a constant whose bytes are all the same, such as
+// zero, is splatted with a single memset, and any other value is stored in
+// the first element then copied over the rest of the array by memcpy calls
+// which each double the initialized prefix.
+
 tree
 array_initializer (tree fndecl, tree block, tree array_type, tree length,
 		   tree value, tree *tmp, location_t locus)
@@ -1417,6 +1700,52 @@ array_initializer (tree fndecl, tree block, tree array_type, tree length,
 					     NULL_TREE, true, locus, &t);
   tree arr = tmp_array->get_tree (locus);
   stmts.push_back (t);
+  *tmp = tmp_array->get_tree (locus);
+
+  tree elem_size = TYPE_SIZE_UNIT (TREE_TYPE (array_type));
+  if (tree_fits_uhwi_p (length) && tree_fits_uhwi_p (elem_size))
+    {
+      unsigned HOST_WIDE_INT count = tree_to_uhwi (length);
+      unsigned HOST_WIDE_INT size = tree_to_uhwi (elem_size);
+      tree base = build_fold_addr_expr_loc (locus, arr);
+
+      int byte = splat_byte (value, size);
+      if (count == 0 || size == 0)
+	{
+	  // the value is still evaluated once, for its side effects
+	  if (TREE_SIDE_EFFECTS (value))
+	    stmts.push_back (value);
+	}
+      else if (byte >= 0)
+	{
+	  //   memset (&arr, byte, sizeof (arr));
+	  tree total = size_int (count * size);
+	  stmts.push_back (
+	    builtin_call ("__builtin_memset",
+			  {base, build_int_cst (integer_type_node, byte), total},
+			  locus));
+	}
+      else
+	{
+	  //   arr[0] = value;
+	  //   memcpy (&arr[1], &arr[0], size);
+	  //   memcpy (&arr[2], &arr[0], 2 * size);
+	  //   ...
+	  tree first = array_index_expression (arr, size_zero_node, locus);
+	  stmts.push_back (assignment_statement (first, value, locus));
+	  for (unsigned HOST_WIDE_INT done = 1; done < count; done *= 2)
+	    {
+	      unsigned HOST_WIDE_INT n = MIN (done, count - done);
+	      tree dst = build_fold_addr_expr_loc (
+		locus, array_index_expression (arr, size_int (done), locus));
+	      stmts.push_back (builtin_call ("__builtin_memcpy",
+					     {dst, base, size_int (n * size)},
+					     locus));
+	    }
+	}
+
+      return statement_list (stmts);
+    }
 
   // Temporary for the array length used for initialization loop guard.
   Bvariable *tmp_len = temporary_variable (fndecl, block, size_type_node,
@@ -1466,9 +1795,7 @@ array_initializer (tree fndecl, tree block, tree array_type, tree length,
   tree loop_body = statement_list (loop_stmts);
   stmts.push_back (loop_expression (loop_body, locus));
 
-  // Return the temporary in the provided pointer and the statement list which
-  // initializes it.
-  *tmp = tmp_array->get_tree (locus);
+  // Return the statement list which initializes the temporary.
   return statement_list (stmts);
 }
 
@@ -1495,6 +1822,55 @@ array_index_expression (tree array_tree, tree index_tree, location_t location)
   return ret;
 }
 
+// Return an expression representing ARRAY[INDEX], checking INDEX against the
+// length of ARRAY
+
+tree
+array_index_expression_checked (tree array_tree, tree index_tree,
+				location_t location)
+{
+  if (array_tree == error_mark_node || TREE_TYPE (array_tree) == error_mark_node
+      || index_tree == error_mark_node)
+    return error_mark_node;
+
+  tree array_type = TREE_TYPE (array_tree);
+  tree domain = TREE_CODE (array_type) == ARRAY_TYPE ? TYPE_DOMAIN (array_type)
+						     : NULL_TREE;
+  if (domain == NULL_TREE || TYPE_MAX_VALUE (domain) == NULL_TREE
+      || TREE_CODE (TYPE_MAX_VALUE (domain)) != INTEGER_CST)
+    return array_index_expression (array_tree, index_tree, location);
+
+  tree domain_type = TREE_TYPE (domain);
+  offset_int length = wi::ext (wi::to_offset (TYPE_MAX_VALUE (domain))
+				 - wi::to_offset (TYPE_MIN_VALUE (domain)) + 1,
+			       TYPE_PRECISION (domain_type),
+			       TYPE_SIGN (domain_type));
+
+  // every value of the index is in bounds
+  tree index_type = TREE_TYPE (index_tree);
+  if (!wi::fits_to_tree_p (length, index_type))
+    return array_index_expression (array_tree, index_tree, location);
+
+  tree length_tree = wide_int_to_tree (index_type, length);
+  if (TREE_CODE (index_tree) == INTEGER_CST
+      && tree_int_cst_lt (index_tree, length_tree))
+    return array_index_expression (array_tree, index_tree, location);
+
+  auto abort_call
+    = failed_check_abort (location, Rust::CheckRemarks::Kind::BOUNDS);
+
+  index_tree = save_expr (index_tree);
+  auto out_of_bounds = fold_build2_loc (location, GE_EXPR, boolean_type_node,
+					index_tree, length_tree);
+  auto check = build3_loc (location, COND_EXPR, void_type_node, out_of_bounds,
+			   abort_call, NULL_TREE);
+
+  // checking as part of the index keeps the result an l-value
+  index_tree
+    = build2_loc (location, COMPOUND_EXPR, index_type, check, index_tree);
+  return array_index_expression (array_tree, index_tree, location);
+}
+
 // Create an expression for a call to FN_EXPR with FN_ARGS.
 tree
 call_expression (tree fn, const std::vector<tree> &fn_args, tree chain_expr,
@@ -1506,11 +1882,40 @@ call_expression (tree fn, const std::vector<tree> &fn_args, tree chain_expr,
   gcc_assert (FUNCTION_POINTER_TYPE_P (TREE_TYPE (fn)));
   tree rettype = TREE_TYPE (TREE_TYPE (TREE_TYPE (fn)));
 
-  size_t nargs = fn_args.size ();
+  // the fat pointers passed to a function taking them as scalar pairs are
+  // split into their two fields
+  std::vector<tree> split_args;
+  tree param_types = TYPE_ARG_TYPES (TREE_TYPE (TREE_TYPE (fn)));
+  for (tree arg : fn_args)
+    {
+      tree param_type = param_types ? TREE_VALUE (param_types) : NULL_TREE;
+      if (param_type != NULL_TREE && param_type != void_type_node
+	  && arg != error_mark_node && is_scalar_pair (TREE_TYPE (arg))
+	  && !is_scalar_pair (param_type))
+	{
+	  tree pair = save_expr (arg);
+	  tree data_field = TYPE_FIELDS (TREE_TYPE (arg));
+	  tree meta_field = DECL_CHAIN (data_field);
+	  split_args.push_back (build3_loc (location, COMPONENT_REF,
+					    TREE_TYPE (data_field), pair,
+					    data_field, NULL_TREE));
+	  split_args.push_back (build3_loc (location, COMPONENT_REF,
+					    TREE_TYPE (meta_field), pair,
+					    meta_field, NULL_TREE));
+	  param_types = TREE_CHAIN (TREE_CHAIN (param_types));
+	  continue;
+	}
+
+      split_args.push_back (arg);
+      if (param_types)
+	param_types = TREE_CHAIN (param_types);
+    }
+
+  size_t nargs = split_args.size ();
   tree *args = nargs == 0 ? NULL : new tree[nargs];
   for (size_t i = 0; i < nargs; ++i)
     {
-      args[i] = fn_args.at (i);
+      args[i] = split_args.at (i);
     }
 
   tree fndecl = fn;
@@ -2213,6 +2618,27 @@ function (tree functype, const std::string &name, const std::string &asm_name,
   return decl;
 }
 
+void
+write_function_definition (tree decl)
+{
+  if (decl == error_mark_node)
+    return;
+
+  rust_preserve_from_gc (decl);
+
+  // other bodies are still being built, so leave cfun as it was
+  if (DECL_STRUCT_FUNCTION (decl) == NULL)
+    {
+      push_struct_function (decl);
+      pop_cfun ();
+    }
+  dump_function (TDI_original, decl);
+
+  // the body is only gimplified once the whole unit is finalized, until then
+  // it can still be walked by the lints and the constant evaluator
+  cgraph_node::finalize_function (decl, true);
+}
+
 // Create a statement that runs all deferred calls for FUNCTION.  This should
 // be a statement that looks like this in C++:
 //   finish:
@@ -2329,12 +2755,6 @@ write_global_definitions (const std::vector<tree> &type_decls,
       tree decl = (*p);
       if (decl != error_mark_node)
 	{
-	  rust_preserve_from_gc (decl);
-	  if (DECL_STRUCT_FUNCTION (decl) == NULL)
-	    allocate_struct_function (decl, false);
-	  dump_function (TDI_original, decl);
-	  cgraph_node::finalize_function (decl, true);
-
 	  defs[i] = decl;
 	  ++i;
 	}
@@ -2348,3 +2768,70 @@ write_global_definitions (const std::vector<tree> &type_decls,
 }
 
 } // namespace Backend
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_backend_test (void)
+{
+  using Backend::typed_identifier;
+
+  tree u8 = Backend::integer_type (true, 8);
+  tree u16 = Backend::integer_type (true, 16);
+  tree u32 = Backend::integer_type (true, 32);
+  std::vector<typed_identifier> fields
+    = {typed_identifier ("a", u8, UNKNOWN_LOCATION),
+       typed_identifier ("b", u32, UNKNOWN_LOCATION),
+       typed_identifier ("c", u16, UNKNOWN_LOCATION)};
+
+  // the fields are laid out by decreasing alignment
+  tree declared = Backend::struct_type (fields);
+  tree reordered = Backend::reordered_struct_type (fields, 0);
+  ASSERT_EQ (Backend::type_size (declared), 12);
+  ASSERT_EQ (Backend::type_size (reordered), 8);
+  ASSERT_EQ (Backend::type_field_offset (reordered, 0), 6);
+  ASSERT_EQ (Backend::type_field_offset (reordered, 1), 0);
+  ASSERT_EQ (Backend::type_field_offset (reordered, 2), 4);
+
+  // but are still accessed by declaration index
+  tree var = build_decl (UNKNOWN_LOCATION, VAR_DECL, NULL_TREE, reordered);
+  tree ref = Backend::struct_field_expression (var, 0, UNKNOWN_LOCATION);
+  ASSERT_EQ (TREE_CODE (ref), COMPONENT_REF);
+  ASSERT_STREQ (IDENTIFIER_POINTER (DECL_NAME (TREE_OPERAND (ref, 1))), "a");
+
+  // the fixed fields, such as a discriminant, keep their place
+  tree fixed = Backend::reordered_struct_type (fields, 1);
+  ASSERT_EQ (Backend::type_field_offset (fixed, 0), 0);
+  ASSERT_EQ (Backend::type_field_offset (fixed, 1), 4);
+  ASSERT_EQ (Backend::type_field_offset (fixed, 2), 8);
+
+  // fields already in order need no mapping
+  std::vector<typed_identifier> sorted = {fields[1], fields[2], fields[0]};
+  ASSERT_EQ (RS_DECLARED_FIELDS (Backend::reordered_struct_type (sorted, 0)),
+	     NULL_TREE);
+
+  // only fat pointers are scalar pairs
+  tree pointer = Backend::pointer_type (u8);
+  std::vector<typed_identifier> pair
+    = {typed_identifier ("data", pointer, UNKNOWN_LOCATION),
+       typed_identifier ("len", size_type_node, UNKNOWN_LOCATION)};
+  tree record = Backend::struct_type (pair);
+  ASSERT_FALSE (Backend::is_scalar_pair (record));
+  RS_DST_FLAG (record) = 1;
+  ASSERT_TRUE (Backend::is_scalar_pair (record));
+  ASSERT_FALSE (Backend::is_scalar_pair (pointer));
+
+  // the bytes a repeat array can be memset with
+  ASSERT_EQ (Backend::splat_byte (build_int_cst (u32, 0), 4), 0);
+  ASSERT_EQ (Backend::splat_byte (build_int_cst (u32, 0xffffffff), 4), 0xff);
+  ASSERT_EQ (Backend::splat_byte (build_int_cst (u32, 0x01010101), 4), 1);
+  ASSERT_EQ (Backend::splat_byte (build_int_cst (u32, 0x0102), 4), -1);
+  ASSERT_EQ (Backend::splat_byte (build_int_cst (u32, 0), 0), -1);
+  ASSERT_EQ (Backend::splat_byte (var, 8), -1);
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
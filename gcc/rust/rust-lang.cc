@@ -41,6 +41,21 @@
 #include "optional.h"
 #include "rust-unicode.h"
 #include "rust-punycode.h"
+#include "rust-metadata-format.h"
+#include "rust-macro-first-set.h"
+#include "rust-proc-macro-wire.h"
+#include "rust-test-harness.h"
+#include "rust-derive.h"
+#include "rust-symbol.h"
+#include "rust-tyty-key.h"
+#include "rust-fingerprint-cache.h"
+#include "rust-make-deps.h"
+#include "rust-self-profile.h"
+#include "rust-imports.h"
+#include "rust-check-remarks.h"
+#include "rust-backend.h"
+#include "rust-compile-type.h"
+#include "rust-compile-pattern.h"
 
 #include <mpfr.h>
 // note: header files must be in this order or else forward declarations don't
@@ -117,6 +132,9 @@ grs_langhook_init (void)
   // initialise compiler session
   Rust::Session::get_instance ().init ();
 
+  if (Rust::CheckRemarks::enabled ())
+    Rust::CheckRemarks::register_pass ();
+
   return true;
 }
 
@@ -133,10 +151,9 @@ static void
 grs_langhook_init_options_struct (struct gcc_options *opts)
 {
   /* Operations are always wrapping in Rust, even on signed integer. This is
-   * useful for the low level wrapping_{add, sub, mul} intrinsics, not for
-   * regular arithmetic operations which are checked for overflow anyway using
-   * builtins */
-  opts->x_flag_wrapv = 1;
+   * not done with -fwrapv: the code generated for signed arithmetic is the
+   * one wrapping around, so that the functions of the crate keep the default
+   * semantics of GCC and can be inlined into C and C++ ones with -flto */
 
   /* We need to warn on unused variables by default */
   opts->x_warn_unused_variable = 1;
@@ -165,6 +182,13 @@ grs_langhook_parse_file (void)
   Rust::Session::get_instance ().handle_input_files (num_in_fnames, in_fnames);
 }
 
+/* Called at the end of compilation, once the assembly file is closed.  */
+static void
+grs_langhook_finish (void)
+{
+  Rust::Session::get_instance ().finish ();
+}
+
 /* Seems to get the exact type for a specific type - e.g. for scalar float with
  * 32-bit bitsize, it returns float, and for 64-bit bitsize, it returns double.
  * Used to map RTL nodes to machine modes or something like that. */
@@ -267,6 +291,13 @@ grs_langhook_getdecls (void)
   return NULL;
 }
 
+/* Print the frontend's part of -fmem-report, once the crate is compiled.  */
+static void
+grs_langhook_print_statistics (void)
+{
+  Rust::Session::get_instance ().dump_memory_report ("the crate");
+}
+
 // Handle Rust-specific options. Return false if nothing happened.
 static bool
 grs_langhook_handle_option (
@@ -356,14 +387,15 @@ convert (tree type, tree expr)
 }
 
 /* FIXME: This is a hack to preserve trees that we create from the
-   garbage collector.  */
+   garbage collector.  They are kept in a vector, which the collector marks
+   without allocating a TREE_LIST node per tree or walking a chain.  */
 
-static GTY (()) tree rust_gc_root;
+static GTY (()) vec<tree, va_gc> *rust_gc_root;
 
 void
 rust_preserve_from_gc (tree t)
 {
-  rust_gc_root = tree_cons (NULL_TREE, t, rust_gc_root);
+  vec_safe_push (rust_gc_root, t);
 }
 
 /* Convert an identifier for use in an error message.  */
@@ -387,6 +419,7 @@ extern const attribute_spec grs_langhook_common_attribute_table[];
 #undef LANG_HOOKS_HANDLE_OPTION
 #undef LANG_HOOKS_POST_OPTIONS
 #undef LANG_HOOKS_PARSE_FILE
+#undef LANG_HOOKS_FINISH
 #undef LANG_HOOKS_TYPE_FOR_MODE
 #undef LANG_HOOKS_BUILTIN_FUNCTION
 #undef LANG_HOOKS_GLOBAL_BINDINGS_P
@@ -395,6 +428,7 @@ extern const attribute_spec grs_langhook_common_attribute_table[];
 #undef LANG_HOOKS_WRITE_GLOBALS
 #undef LANG_HOOKS_GIMPLIFY_EXPR
 #undef LANG_HOOKS_EH_PERSONALITY
+#undef LANG_HOOKS_PRINT_STATISTICS
 
 #undef LANG_HOOKS_COMMON_ATTRIBUTE_TABLE
 
@@ -410,6 +444,7 @@ extern const attribute_spec grs_langhook_common_attribute_table[];
  * This hook must create a complete parse tree in a global var, and then return.
  */
 #define LANG_HOOKS_PARSE_FILE grs_langhook_parse_file
+#define LANG_HOOKS_FINISH grs_langhook_finish
 #define LANG_HOOKS_TYPE_FOR_MODE grs_langhook_type_for_mode
 #define LANG_HOOKS_BUILTIN_FUNCTION grs_langhook_builtin_function
 #define LANG_HOOKS_GLOBAL_BINDINGS_P grs_langhook_global_bindings_p
@@ -417,6 +452,7 @@ extern const attribute_spec grs_langhook_common_attribute_table[];
 #define LANG_HOOKS_GETDECLS grs_langhook_getdecls
 #define LANG_HOOKS_GIMPLIFY_EXPR grs_langhook_gimplify_expr
 #define LANG_HOOKS_EH_PERSONALITY grs_langhook_eh_personality
+#define LANG_HOOKS_PRINT_STATISTICS grs_langhook_print_statistics
 
 #define LANG_HOOKS_COMMON_ATTRIBUTE_TABLE grs_langhook_common_attribute_table
 
@@ -439,6 +475,20 @@ run_rust_tests ()
   rust_privacy_ctx_test ();
   rust_crate_name_validation_test ();
   rust_simple_path_resolve_test ();
+  rust_metadata_format_test ();
+  rust_macro_first_set_test ();
+  rust_proc_macro_wire_test ();
+  rust_test_harness_test ();
+  rust_derive_test ();
+  rust_symbol_test ();
+  rust_tyty_key_test ();
+  rust_fingerprint_cache_test ();
+  rust_make_deps_test ();
+  rust_self_profile_test ();
+  rust_imports_test ();
+  rust_backend_test ();
+  rust_compile_type_test ();
+  rust_compile_pattern_test ();
 }
 } // namespace selftest
 
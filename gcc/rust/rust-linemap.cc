@@ -51,11 +51,15 @@ Linemap::location_to_string (location_t location)
   if (!path)
     return "";
 
-  // Strip the source file down to the base file, to reduce clutter.
-  std::stringstream ss;
-  ss << lbasename (path) << ":" << SOURCE_LINE (lmo, location) << ":"
-     << SOURCE_COLUMN (lmo, location);
-  return ss.str ();
+  // Strip the source file down to the base file, to reduce clutter. This is
+  // called for every token of a lexer dump, so build the string directly
+  // rather than through a stringstream.
+  std::string str (lbasename (path));
+  str += ':';
+  str += std::to_string (SOURCE_LINE (lmo, location));
+  str += ':';
+  str += std::to_string (SOURCE_COLUMN (lmo, location));
+  return str;
 }
 
 // Stop getting locations.
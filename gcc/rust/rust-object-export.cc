@@ -97,31 +97,24 @@ rust_write_export_data (const char *bytes, unsigned int size)
   assemble_string (bytes, size);
 }
 
-/* The rust_read_export_data function is called by the Rust frontend
-   proper to read Rust export data from an object file.  FD is a file
-   descriptor open for reading.  OFFSET is the offset within the file
-   where the object file starts; this will be 0 except when reading an
-   archive.  On success this returns NULL and sets *PBUF to a buffer
-   allocated using malloc, of size *PLEN, holding the export data.  If
-   the data is not found, this returns NULL and sets *PBUF to NULL and
-   *PLEN to 0.  If some error occurs, this returns an error message
-   and sets *PERR to an errno value or 0 if there is no relevant
+/* The rust_find_export_data function looks for Rust export data in the
+   object file starting at OFFSET in the file open as FD.  On success this
+   returns NULL and sets *PSEC_OFFSET and *PSEC_LENGTH to the offset of the
+   data relative to OFFSET and to its size, or sets *PSEC_LENGTH to 0 if
+   there is no export data.  If some error occurs, this returns an error
+   message and sets *PERR to an errno value or 0 if there is no relevant
    errno.  */
 
 const char *
-rust_read_export_data (int fd, off_t offset, char **pbuf, size_t *plen,
-		       int *perr)
+rust_find_export_data (int fd, off_t offset, off_t *psec_offset,
+		       off_t *psec_length, int *perr)
 {
   simple_object_read *sobj;
   const char *errmsg;
-  off_t sec_offset;
-  off_t sec_length;
   int found;
-  char *buf;
-  ssize_t c;
 
-  *pbuf = NULL;
-  *plen = 0;
+  *psec_offset = 0;
+  *psec_length = 0;
 
   sobj = simple_object_start_read (fd, offset, RUST_EXPORT_SEGMENT_NAME,
 				   &errmsg, perr);
@@ -136,9 +129,43 @@ rust_read_export_data (int fd, off_t offset, char **pbuf, size_t *plen,
     }
 
   found = simple_object_find_section (sobj, RUST_EXPORT_SECTION_NAME,
-				      &sec_offset, &sec_length, &errmsg, perr);
+				      psec_offset, psec_length, &errmsg, perr);
   simple_object_release_read (sobj);
   if (!found)
+    {
+      *psec_length = 0;
+      return errmsg;
+    }
+
+  return NULL;
+}
+
+/* The rust_read_export_data function is called by the Rust frontend
+   proper to read Rust export data from an object file.  FD is a file
+   descriptor open for reading.  OFFSET is the offset within the file
+   where the object file starts; this will be 0 except when reading an
+   archive.  On success this returns NULL and sets *PBUF to a buffer
+   allocated using malloc, of size *PLEN, holding the export data.  If
+   the data is not found, this returns NULL and sets *PBUF to NULL and
+   *PLEN to 0.  If some error occurs, this returns an error message
+   and sets *PERR to an errno value or 0 if there is no relevant
+   errno.  */
+
+const char *
+rust_read_export_data (int fd, off_t offset, char **pbuf, size_t *plen,
+		       int *perr)
+{
+  const char *errmsg;
+  off_t sec_offset;
+  off_t sec_length;
+  char *buf;
+  ssize_t c;
+
+  *pbuf = NULL;
+  *plen = 0;
+
+  errmsg = rust_find_export_data (fd, offset, &sec_offset, &sec_length, perr);
+  if (errmsg != NULL || sec_length == 0)
     return errmsg;
 
   if (lseek (fd, offset + sec_offset, SEEK_SET) < 0)
@@ -24,6 +24,9 @@
 extern unsigned int
 rust_field_alignment (tree t);
 
+extern const char *
+rust_find_export_data (int fd, off_t offset, off_t *psec_offset,
+		       off_t *psec_length, int *perr);
 extern const char *
 rust_read_export_data (int fd, off_t offset, char **pbuf, size_t *plen,
 		       int *perr);
@@ -26,17 +26,19 @@
 #include "rust-ast-resolve.h"
 #include "rust-ast-lower.h"
 #include "rust-hir-type-check.h"
+#include "rust-hir-type-bounds.h"
+#include "rust-hir-dot-operator.h"
 #include "rust-privacy-check.h"
 #include "rust-const-checker.h"
 #include "rust-feature-gate.h"
 #include "rust-compile.h"
 #include "rust-cfg-parser.h"
 #include "rust-lint-scan-deadcode.h"
-#include "rust-lint-unused-var.h"
-#include "rust-readonly-check.h"
+#include "rust-lint-generic.h"
 #include "rust-hir-dump.h"
 #include "rust-ast-dump.h"
 #include "rust-export-metadata.h"
+#include "rust-metadata-format.h"
 #include "rust-imports.h"
 #include "rust-extern-crate.h"
 #include "rust-attributes.h"
@@ -46,14 +48,26 @@
 #include "rust-late-name-resolver-2.0.h"
 #include "rust-cfg-strip.h"
 #include "rust-expand-visitor.h"
+#include "rust-test-harness.h"
 #include "rust-unicode.h"
 #include "rust-attribute-values.h"
 #include "rust-borrow-checker.h"
 #include "rust-ast-validation.h"
 #include "rust-tyty-variance-analysis.h"
-
+#include "rust-module-prefetch.h"
+#include "rust-fingerprint-cache.h"
+#include "rust-make-deps.h"
+#include "rust-self-profile.h"
+#include "rust-thread-state.h"
+#include "rust-proc-macro-server.h"
+
+#include "diagnostic.h"
 #include "input.h"
 #include "selftest.h"
+#include "timevar.h"
+#include "toplev.h"
+#include "varasm.h"
+#include "version.h"
 #include "tm.h"
 #include "rust-target.h"
 
@@ -78,6 +92,13 @@ const char *kHIRDumpFile = "gccrs.hir.dump";
 const char *kHIRPrettyDumpFile = "gccrs.hir-pretty.dump";
 const char *kHIRTypeResolutionDumpFile = "gccrs.type-resolution.dump";
 const char *kTargetOptionsDumpFile = "gccrs.target-options.dump";
+const char *kExpansionStatsDumpFile = "gccrs.expansion-stats.dump";
+const char *kMacroProfileDumpFile = "gccrs.macro-profile.dump";
+const char *kMacroProfileJsonFile = "gccrs.macro-profile.json";
+const char *kParseStatsDumpFile = "gccrs.parse-stats.dump";
+const char *kTypecheckStatsDumpFile = "gccrs.typecheck-stats.dump";
+const char *kMetadataStatsDumpFile = "gccrs.metadata-stats.dump";
+const char *kSelfProfileFile = "gccrs.self-profile.json";
 
 const std::string kDefaultCrateName = "rust_out";
 const size_t kMaxNameLength = 64;
@@ -85,8 +106,11 @@ const size_t kMaxNameLength = 64;
 Session &
 Session::get_instance ()
 {
-  static Session instance{};
-  return instance;
+  auto &instance = ThreadState::current ().session;
+  if (instance == nullptr)
+    instance = new Session ();
+
+  return *instance;
 }
 
 static std::string
@@ -117,6 +141,19 @@ infer_crate_name (const std::string &filename)
   return crate;
 }
 
+/* Tell the build system that the metadata of the crate is complete by
+ * creating the file at PATH, so that it does not have to wait for the
+ * compiler to exit before building the crates depending on this one. */
+
+static void
+signal_metadata_ready (const std::string &path)
+{
+  FILE *file = fopen (path.c_str (), "wb");
+  if (file == NULL || fclose (file) != 0)
+    rust_error_at (UNDEF_LOCATION, "failed to create file %<%s%>: %s",
+		   path.c_str (), xstrerror (errno));
+}
+
 /* Validate the crate name using the ASCII rules */
 
 static bool
@@ -169,6 +206,9 @@ Session::init ()
 								? "big"
 								: "little");
 
+  if (flag_rust_test)
+    options.target_data.insert_key ("test");
+
   // setup singleton linemap
   linemap = rust_get_linemap ();
 
@@ -177,6 +217,10 @@ Session::init ()
 
   // setup mappings class
   mappings = Analysis::Mappings::get ();
+
+  // the server forks, which must happen before any thread is started
+  if (flag_rust_proc_macro_server)
+    ProcMacroServer::start (flag_rust_proc_macro_jobs);
 }
 
 /* Initialise default options. Actually called before handle_option, unlike init
@@ -264,6 +308,46 @@ Session::handle_option (
     case OPT_frust_metadata_output_:
       options.set_metadata_output (arg);
       break;
+    case OPT_frust_metadata_cache_:
+      options.set_metadata_cache_dir (arg);
+      break;
+    case OPT_frust_metadata_ready_:
+      options.set_metadata_ready_path (arg);
+      break;
+    case OPT_frust_incremental_:
+      options.set_incremental_dir (arg);
+      break;
+
+    case OPT_frust_dump_filter_:
+      options.set_dump_filter (arg);
+      break;
+
+    case OPT_M:
+    case OPT_MM:
+      options.enable_make_deps ();
+      break;
+
+    case OPT_MD:
+    case OPT_MMD:
+      options.enable_make_deps ();
+      options.set_make_deps_file (arg);
+      break;
+
+    case OPT_MF:
+      options.set_make_deps_file_user (arg);
+      break;
+
+    case OPT_MP:
+      options.enable_make_deps_phony ();
+      break;
+
+    case OPT_MQ:
+      MakeDependencies::get ().add_target (arg, true);
+      break;
+
+    case OPT_MT:
+      MakeDependencies::get ().add_target (arg, false);
+      break;
 
     default:
       break;
@@ -320,9 +404,12 @@ Session::enable_dump (std::string arg)
     {
       rust_error_at (
 	UNDEF_LOCATION,
-	"dump option was not given a name. choose %<lex%>, %<ast-pretty%>, "
+	"dump option was not given a name. choose %<lex%>, %<parse-stats%>, "
+	"%<ast-pretty%>, "
 	"%<register_plugins%>, %<injection%>, "
-	"%<expansion%>, %<resolution%>, %<target_options%>, %<hir%>, "
+	"%<expansion%>, %<expansion-stats%>, %<macro-profile%>, "
+	"%<resolution%>, %<typecheck-stats%>, %<metadata-stats%>, "
+	"%<target_options%>, %<hir%>, "
 	"%<hir-pretty%>, %<bir%> or %<all%>");
       return false;
     }
@@ -335,6 +422,10 @@ Session::enable_dump (std::string arg)
     {
       options.enable_dump_option (CompileOptions::LEXER_DUMP);
     }
+  else if (arg == "parse-stats")
+    {
+      options.enable_dump_option (CompileOptions::PARSE_STATS_DUMP);
+    }
   else if (arg == "ast-pretty")
     {
       options.enable_dump_option (CompileOptions::AST_DUMP_PRETTY);
@@ -351,10 +442,26 @@ Session::enable_dump (std::string arg)
     {
       options.enable_dump_option (CompileOptions::EXPANSION_DUMP);
     }
+  else if (arg == "expansion-stats")
+    {
+      options.enable_dump_option (CompileOptions::EXPANSION_STATS_DUMP);
+    }
+  else if (arg == "macro-profile")
+    {
+      options.enable_dump_option (CompileOptions::MACRO_PROFILE_DUMP);
+    }
   else if (arg == "resolution")
     {
       options.enable_dump_option (CompileOptions::RESOLUTION_DUMP);
     }
+  else if (arg == "typecheck-stats")
+    {
+      options.enable_dump_option (CompileOptions::TYPECHECK_STATS_DUMP);
+    }
+  else if (arg == "metadata-stats")
+    {
+      options.enable_dump_option (CompileOptions::METADATA_STATS_DUMP);
+    }
   else if (arg == "target_options")
     {
       options.enable_dump_option (CompileOptions::TARGET_OPTION_DUMP);
@@ -375,9 +482,12 @@ Session::enable_dump (std::string arg)
     {
       rust_error_at (
 	UNDEF_LOCATION,
-	"dump option %qs was unrecognised. choose %<lex%>, %<ast-pretty%>, "
+	"dump option %qs was unrecognised. choose %<lex%>, %<parse-stats%>, "
+	"%<ast-pretty%>, "
 	"%<register_plugins%>, %<injection%>, "
-	"%<expansion%>, %<resolution%>, %<target_options%>, %<hir%>, "
+	"%<expansion%>, %<expansion-stats%>, %<macro-profile%>, "
+	"%<resolution%>, %<typecheck-stats%>, %<metadata-stats%>, "
+	"%<target_options%>, %<hir%>, "
 	"%<hir-pretty%>, or %<all%>",
 	arg.c_str ());
       return false;
@@ -414,6 +524,96 @@ Session::handle_input_files (int num_files, const char **files)
 
   rust_debug ("Attempting to parse file: %s", file);
   compile_crate (file);
+
+  if (options.make_deps)
+    write_make_deps ();
+
+  if (SelfProfile::enabled ())
+    write_self_profile ();
+}
+
+void
+Session::write_self_profile () const
+{
+  std::ofstream out (kSelfProfileFile);
+  if (out.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kSelfProfileFile);
+      return;
+    }
+
+  SelfProfile::get ().write (out);
+}
+
+/* What the assembly of a codegen unit depends on besides the items of the
+   crate: the compiler, its options and the crates it imports. The driver names
+   the output and dump files after its temporary files, they are left out.  */
+
+std::string
+Session::incremental_environment () const
+{
+  std::string environment = version_string;
+  environment += "\n";
+  for (unsigned i = 0; i < save_decoded_options_count; i++)
+    {
+      auto &option = save_decoded_options[i];
+      switch (option.opt_index)
+	{
+	case OPT_o:
+	case OPT_dumpbase:
+	case OPT_dumpbase_ext:
+	case OPT_dumpdir:
+	case OPT_quiet:
+	  continue;
+	default:
+	  break;
+	}
+
+      if (option.orig_option_with_args_text != nullptr)
+	environment += option.orig_option_with_args_text;
+      environment += "\n";
+    }
+
+  for (auto &crate : loaded_extern_crates)
+    environment += crate.first + "\n";
+
+  return environment;
+}
+
+void
+Session::finish ()
+{
+  if (incremental_cache == nullptr || seen_error ())
+    return;
+
+  if (reuse_output)
+    incremental_cache->reuse_output (asm_file_name);
+  else
+    incremental_cache->store_output (asm_file_name);
+}
+
+void
+Session::write_make_deps () const
+{
+  auto path = options.get_make_deps_file ();
+
+  FILE *stream = stdout;
+  if (path)
+    {
+      stream = fopen (path->c_str (), "w");
+      if (stream == nullptr)
+	{
+	  rust_error_at (UNDEF_LOCATION, "cannot open %s for writing: %m",
+			 path->c_str ());
+	  return;
+	}
+    }
+
+  MakeDependencies::get ().write (stream, options.make_deps_phony);
+
+  if (path && fclose (stream) != 0)
+    rust_error_at (UNDEF_LOCATION, "cannot write %s: %m", path->c_str ());
 }
 
 void
@@ -493,12 +693,30 @@ Session::compile_crate (const char *filename)
       "GCCRS_EXTRA_ARGS=\"-frust-incomplete-and-experimental-compiler-do-not-"
       "use\"\n\nas an environment variable.");
 
+  if (flag_rust_codegen_units == 0
+      || flag_rust_codegen_unit >= flag_rust_codegen_units)
+    {
+      rust_error_at (UNDEF_LOCATION,
+		     "%<-frust-codegen-unit=%> must be smaller than "
+		     "%<-frust-codegen-units=%>");
+      return;
+    }
+
+  // every unit runs the whole frontend, only the first one reports the
+  // warnings and writes the metadata so that they do not come out once per
+  // unit
+  bool is_first_codegen_unit = flag_rust_codegen_unit == 0;
+  if (!is_first_codegen_unit)
+    global_dc->m_inhibit_warnings = true;
+
   RAIIFile file_wrap (filename);
   if (!file_wrap.ok ())
     {
       rust_error_at (UNDEF_LOCATION, "cannot open filename %s: %m", filename);
       return;
     }
+  if (strcmp (filename, "-") != 0)
+    MakeDependencies::get ().add_dependency (filename);
 
   auto last_step = options.get_compile_until ();
 
@@ -529,8 +747,26 @@ Session::compile_crate (const char *filename)
 
   Parser<Lexer> parser (lex);
 
+  // when stopping before expansion nothing looks into function bodies, unless
+  // they get dumped or checked for syntax errors
+  if ((last_step == CompileOptions::CompileStep::Ast
+       || last_step == CompileOptions::CompileStep::AttributeCheck)
+      && !flag_syntax_only
+      && !options.dump_option_enabled (CompileOptions::AST_DUMP_PRETTY))
+    parser.set_skip_function_bodies (true);
+
   // generate crate from parser
+  timevar_push (TV_RUST_PARSE);
+  size_t nodes_before = mappings.get_node_id_count ();
+  long parse_start = get_run_time ();
   std::unique_ptr<AST::Crate> ast_crate = parser.parse_crate ();
+  long parse_time = get_run_time () - parse_start;
+  timevar_pop (TV_RUST_PARSE);
+  if (options.dump_option_enabled (CompileOptions::PARSE_STATS_DUMP))
+    dump_parse_stats (lex.get_token_count (),
+		      mappings.get_node_id_count () - nodes_before, parse_time);
+  if (flag_rust_mem_report)
+    dump_memory_report ("parsing");
 
   // handle crate name
   handle_crate_name (*ast_crate.get ());
@@ -553,6 +789,9 @@ Session::compile_crate (const char *filename)
   AST::Crate &parsed_crate
     = mappings.insert_ast_crate (std::move (ast_crate), current_crate);
 
+  // start reading the files of the crate's out-of-line modules
+  ModulePrefetcher::get ().prefetch (parsed_crate.items);
+
   /* basic pipeline:
    *  - lex
    *  - parse
@@ -593,7 +832,9 @@ Session::compile_crate (const char *filename)
   if (last_step == CompileOptions::CompileStep::AttributeCheck)
     return;
 
+  timevar_push (TV_RUST_AST_CHECKS);
   Analysis::AttributeChecker ().go (parsed_crate);
+  timevar_pop (TV_RUST_AST_CHECKS);
 
   if (last_step == CompileOptions::CompileStep::Expansion)
     return;
@@ -601,7 +842,11 @@ Session::compile_crate (const char *filename)
   auto name_resolution_ctx = Resolver2_0::NameResolutionContext ();
   // expansion pipeline stage
 
+  timevar_push (TV_RUST_EXPANSION);
   expansion (parsed_crate, name_resolution_ctx);
+  timevar_pop (TV_RUST_EXPANSION);
+  if (flag_rust_mem_report)
+    dump_memory_report ("expansion");
   rust_debug ("\033[0;31mSUCCESSFULLY FINISHED EXPANSION \033[0m");
   if (options.dump_option_enabled (CompileOptions::EXPANSION_DUMP))
     {
@@ -615,21 +860,32 @@ Session::compile_crate (const char *filename)
   if (last_step == CompileOptions::CompileStep::ASTValidation)
     return;
 
-  ASTValidation ().check (parsed_crate);
+  // feature gating, done during the validation walk unless we stop before it
+  bool feature_gating
+    = last_step != CompileOptions::CompileStep::FeatureGating;
+
+  timevar_push (TV_RUST_AST_CHECKS);
+  FeatureGate feature_gate;
+  if (feature_gating)
+    feature_gate.collect_features (parsed_crate);
+  ASTValidation (feature_gating ? &feature_gate : nullptr).check (parsed_crate);
+  timevar_pop (TV_RUST_AST_CHECKS);
 
-  // feature gating
-  if (last_step == CompileOptions::CompileStep::FeatureGating)
+  if (!feature_gating)
     return;
-  FeatureGate ().check (parsed_crate);
 
   if (last_step == CompileOptions::CompileStep::NameResolution)
     return;
 
   // resolution pipeline stage
+  timevar_push (TV_RUST_NAME_RESOLUTION);
   if (flag_name_resolution_2_0)
     Resolver2_0::Late (name_resolution_ctx).go (parsed_crate);
   else
     Resolver::NameResolution::Resolve (parsed_crate);
+  timevar_pop (TV_RUST_NAME_RESOLUTION);
+  if (flag_rust_mem_report)
+    dump_memory_report ("name resolution");
 
   if (options.dump_option_enabled (CompileOptions::RESOLUTION_DUMP))
     dump_name_resolution (name_resolution_ctx);
@@ -637,12 +893,36 @@ Session::compile_crate (const char *filename)
   if (saw_errors ())
     return;
 
+  // the assembly a codegen unit is compiled to can be reused when none of its
+  // items changed. Without one-only symbols, the generic instances a unit
+  // emits depend on the other units, so nothing can be reused.
+  auto incremental_dir = options.get_incremental_dir ();
+  if (incremental_dir && last_step == CompileOptions::CompileStep::End
+      && asm_file_name && strcmp (asm_file_name, "-") != 0
+      && supports_one_only ())
+    {
+      incremental_cache.reset (
+	new Incremental::FingerprintCache (incremental_dir.value (),
+					   options.get_crate_name (),
+					   flag_rust_codegen_unit));
+      if (!incremental_cache->fingerprint (parsed_crate,
+					   incremental_environment (),
+					   Compile::module_codegen_unit))
+	incremental_cache = nullptr;
+      else
+	reuse_output = incremental_cache->load_output ();
+    }
+
   if (last_step == CompileOptions::CompileStep::Lowering)
     return;
 
   // lower AST to HIR
+  timevar_push (TV_RUST_LOWERING);
   std::unique_ptr<HIR::Crate> lowered
     = HIR::ASTLowering::Resolve (parsed_crate);
+  timevar_pop (TV_RUST_LOWERING);
+  if (flag_rust_mem_report)
+    dump_memory_report ("lowering");
   if (saw_errors ())
     return;
 
@@ -657,6 +937,33 @@ Session::compile_crate (const char *filename)
       dump_hir_pretty (hir);
     }
 
+  // The exported items are serialized from their AST, which is not needed by
+  // the following passes. Free it now rather than keeping it alive while the
+  // crate is compiled and optimized.
+  auto public_interface = Metadata::PublicInterface::Gather (hir);
+  mappings.release_ast ();
+
+  // the cached assembly is written out once the backend is done, it already
+  // holds the embedded metadata
+  if (reuse_output)
+    {
+      rust_debug ("reusing the assembly of codegen unit %d",
+		  flag_rust_codegen_unit);
+      if (is_first_codegen_unit)
+	{
+	  timevar_push (TV_RUST_METADATA);
+	  if (!flag_rust_embed_metadata && !options.metadata_output_path_set ())
+	    public_interface->ExportTo (
+	      Metadata::PublicInterface::expected_metadata_filename ());
+	  else if (options.metadata_output_path_set ())
+	    public_interface->ExportTo (options.get_metadata_output ());
+	  if (options.get_metadata_ready_path () && !saw_errors ())
+	    signal_metadata_ready (options.get_metadata_ready_path ().value ());
+	  timevar_pop (TV_RUST_METADATA);
+	}
+      return;
+    }
+
   if (last_step == CompileOptions::CompileStep::TypeCheck)
     return;
 
@@ -664,9 +971,18 @@ Session::compile_crate (const char *filename)
   Resolver2_0::ImmutableNameResolutionContext::init (name_resolution_ctx);
 
   // type resolve
+  timevar_push (TV_RUST_TYPECHECK);
   Resolver::TypeResolution::Resolve (hir);
 
+  timevar_push (TV_RUST_VARIANCE);
   Resolver::TypeCheckContext::get ()->get_variance_analysis_ctx ().solve ();
+  timevar_pop (TV_RUST_VARIANCE);
+  timevar_pop (TV_RUST_TYPECHECK);
+  if (flag_rust_mem_report)
+    dump_memory_report ("type checking");
+
+  if (options.dump_option_enabled (CompileOptions::TYPECHECK_STATS_DUMP))
+    dump_typecheck_stats ();
 
   if (saw_errors ())
     return;
@@ -675,20 +991,32 @@ Session::compile_crate (const char *filename)
     return;
 
   // Various HIR error passes. The privacy pass happens before the unsafe checks
+  timevar_push (TV_RUST_PRIVACY);
   Privacy::Resolver::resolve (hir);
+  timevar_pop (TV_RUST_PRIVACY);
   if (saw_errors ())
     return;
 
   if (last_step == CompileOptions::CompileStep::Unsafety)
     return;
 
-  HIR::UnsafeChecker ().go (hir);
+  // The unsafe and const checks both walk the whole crate. They run item by
+  // item, so that the HIR of an item is still in cache for the second walk.
+  bool check_const = last_step != CompileOptions::CompileStep::Const;
+  HIR::UnsafeChecker unsafe_checker;
+  HIR::ConstChecker const_checker;
+  timevar_push (TV_RUST_HIR_CHECKS);
+  for (auto &item : hir.get_items ())
+    {
+      unsafe_checker.go (*item);
+      if (check_const)
+	const_checker.go (*item);
+    }
+  timevar_pop (TV_RUST_HIR_CHECKS);
 
   if (last_step == CompileOptions::CompileStep::Const)
     return;
 
-  HIR::ConstChecker ().go (hir);
-
   if (last_step == CompileOptions::CompileStep::BorrowCheck)
     return;
 
@@ -696,7 +1024,11 @@ Session::compile_crate (const char *filename)
     {
       const bool dump_bir
 	= options.dump_option_enabled (CompileOptions::DumpOption::BIR_DUMP);
+      timevar_push (TV_RUST_BORROWCHECK);
       HIR::BorrowChecker (dump_bir).go (hir);
+      timevar_pop (TV_RUST_BORROWCHECK);
+      if (flag_rust_mem_report)
+	dump_memory_report ("borrow checking");
     }
 
   if (saw_errors ())
@@ -705,38 +1037,61 @@ Session::compile_crate (const char *filename)
   if (last_step == CompileOptions::CompileStep::Compilation)
     return;
 
-  // do compile to gcc generic
+  // do compile to gcc generic, leaving out the dead private functions
+  std::set<HirId> live_symbols = Analysis::MarkLive::Analysis (hir);
   Compile::Context ctx;
+  // whether a private function is used may depend on the other units, each
+  // unit reused from the incremental cache has to emit all of its functions
+  if (incremental_cache == nullptr)
+    ctx.set_live_items (live_symbols);
+  timevar_push (TV_RUST_COMPILE);
   Compile::CompileCrate::Compile (hir, &ctx);
+  timevar_pop (TV_RUST_COMPILE);
+  if (flag_rust_mem_report)
+    dump_memory_report ("compilation", &ctx);
 
   // we can't do static analysis if there are errors to worry about
-  if (!saw_errors ())
+  if (!saw_errors () && is_first_codegen_unit)
     {
-      // lints
-      Analysis::ScanDeadcode::Scan (hir);
-      Analysis::UnusedVariables::Lint (ctx);
-      Analysis::ReadonlyCheck::Lint (ctx);
-
-      // metadata
+      // metadata, first so that dependent crates can start building while
+      // this one is still linted and optimized
+      timevar_push (TV_RUST_METADATA);
       bool specified_emit_metadata
 	= flag_rust_embed_metadata || options.metadata_output_path_set ();
       if (!specified_emit_metadata)
 	{
-	  Metadata::PublicInterface::ExportTo (
-	    hir, Metadata::PublicInterface::expected_metadata_filename ());
+	  public_interface->ExportTo (
+	    Metadata::PublicInterface::expected_metadata_filename ());
 	}
       else
 	{
 	  if (flag_rust_embed_metadata)
-	    Metadata::PublicInterface::Export (hir);
+	    public_interface->Export ();
 	  if (options.metadata_output_path_set ())
-	    Metadata::PublicInterface::ExportTo (
-	      hir, options.get_metadata_output ());
+	    public_interface->ExportTo (options.get_metadata_output ());
 	}
+      if (options.get_metadata_ready_path () && !saw_errors ())
+	signal_metadata_ready (options.get_metadata_ready_path ().value ());
+      if (options.dump_option_enabled (CompileOptions::METADATA_STATS_DUMP))
+	dump_metadata_stats (*public_interface);
+      timevar_pop (TV_RUST_METADATA);
+
+      // lints
+      timevar_push (TV_RUST_LINTS);
+      Analysis::ScanDeadcode::Scan (hir, live_symbols);
+      Analysis::GenericLints::Lint (ctx);
+      timevar_pop (TV_RUST_LINTS);
     }
 
   // pass to GCC middle-end
+  timevar_push (TV_RUST_COMPILE);
   ctx.write_to_backend ();
+  timevar_pop (TV_RUST_COMPILE);
+
+  // Everything the middle-end needs is in GENERIC now, so the HIR and the
+  // types do not have to stay alive while it optimizes
+  Resolver::TypeCheckContext::get ()->release ();
+  mappings.release_hir ();
 }
 
 void
@@ -747,7 +1102,7 @@ Session::register_plugins (AST::Crate &crate ATTRIBUTE_UNUSED)
 
 // TODO: move somewhere else
 bool
-contains_name (const AST::AttrVec &attrs, std::string name)
+contains_name (const AST::AttrVec &attrs, const std::string &name)
 {
   for (const auto &attr : attrs)
     {
@@ -914,13 +1269,43 @@ Session::expansion (AST::Crate &crate, Resolver2_0::NameResolutionContext &ctx)
   MacroExpander expander (crate, cfg, *this);
   std::vector<Error> macro_errors;
 
+  if (options.dump_option_enabled (CompileOptions::MACRO_PROFILE_DUMP))
+    expander.enable_profiling ();
+
+  // fragments expanded and time spent (in microseconds) in each round
+  std::vector<std::pair<unsigned, long>> round_stats;
+  bool needs_revisit = true;
+
   while (!fixed_point_reached && iterations < cfg.recursion_limit)
     {
+      long round_start = get_run_time ();
+
+      /* Nothing the previous round inserted can be stripped or expanded, so
+       * walking the whole crate once more would only confirm the fixed point.
+       * Name resolution 2.0 still has to collect the items of the final crate
+       * though.  */
+      if (!needs_revisit)
+	{
+	  if (flag_name_resolution_2_0)
+	    {
+	      auto_timevar tv (TV_RUST_EARLY_RESOLUTION);
+	      Resolver2_0::Early early (ctx);
+	      early.go (crate);
+	      macro_errors = early.get_macro_resolve_errors ();
+	    }
+
+	  round_stats.push_back ({0, get_run_time () - round_start});
+	  break;
+	}
+
+      timevar_push (TV_RUST_CFG_STRIP);
       CfgStrip ().go (crate);
+      timevar_pop (TV_RUST_CFG_STRIP);
       // Errors might happen during cfg strip pass
       if (saw_errors ())
 	break;
 
+      timevar_push (TV_RUST_EARLY_RESOLUTION);
       if (flag_name_resolution_2_0)
 	{
 	  Resolver2_0::Early early (ctx);
@@ -929,10 +1314,15 @@ Session::expansion (AST::Crate &crate, Resolver2_0::NameResolutionContext &ctx)
 	}
       else
 	Resolver::EarlyNameResolver ().go (crate);
+      timevar_pop (TV_RUST_EARLY_RESOLUTION);
 
       ExpandVisitor (expander).go (crate);
 
+      round_stats.push_back ({expander.get_expanded_fragment_count (),
+			      get_run_time () - round_start});
+
       fixed_point_reached = !expander.has_changed ();
+      needs_revisit = expander.needs_revisit () || !macro_errors.empty ();
       expander.reset_changed_state ();
       iterations++;
 
@@ -940,18 +1330,24 @@ Session::expansion (AST::Crate &crate, Resolver2_0::NameResolutionContext &ctx)
 	break;
     }
 
+  if (options.dump_option_enabled (CompileOptions::EXPANSION_STATS_DUMP))
+    dump_expansion_stats (round_stats, expander.get_match_cache_hits (),
+			  expander.get_match_cache_misses ());
+  if (options.dump_option_enabled (CompileOptions::MACRO_PROFILE_DUMP))
+    dump_macro_profile (expander.get_macro_profiles ());
+
   // Fixed point reached: Emit unresolved macros error
   for (auto &error : macro_errors)
     error.emit ();
 
   if (iterations == cfg.recursion_limit)
     {
-      auto &last_invoc = expander.get_last_invocation ();
+      auto last_invoc_locus = expander.get_last_invocation_locus ();
       auto &last_def = expander.get_last_definition ();
 
-      rust_assert (last_def.has_value () && last_invoc.has_value ());
+      rust_assert (last_def.has_value () && last_invoc_locus.has_value ());
 
-      rich_location range (line_table, last_invoc->get_locus ());
+      rich_location range (line_table, last_invoc_locus.value ());
       range.add_range (last_def->get_locus ());
 
       rust_error_at (range, "reached recursion limit");
@@ -960,6 +1356,24 @@ Session::expansion (AST::Crate &crate, Resolver2_0::NameResolutionContext &ctx)
   // error reporting - check unused macros, get missing fragment specifiers
 
   // build test harness
+  if (!saw_errors ())
+    {
+      bool linux_target
+	= options.target_data.has_key_value_pair ("target_os", "linux");
+      // x32 is the 32-bit ABI for which time_t was always 64-bit
+      bool time64
+	= POINTER_SIZE == 64
+	  || options.target_data.has_key_value_pair ("target_arch", "x86_64");
+      TestHarness (flag_rust_test, flag_rust_test_json, linux_target, time64)
+	.go (crate);
+
+      // the harness items have to be collected as well
+      if (flag_rust_test && flag_name_resolution_2_0)
+	{
+	  Resolver2_0::Early early (ctx);
+	  early.go (crate);
+	}
+    }
 
   // ast validation (also with proc macro decls)
 
@@ -968,6 +1382,194 @@ Session::expansion (AST::Crate &crate, Resolver2_0::NameResolutionContext &ctx)
   rust_debug ("finished expansion");
 }
 
+/* Rates are given per second of parsing, which includes the lexing since tokens
+   are built on demand.  */
+
+void
+Session::dump_parse_stats (size_t tokens, size_t nodes, long time) const
+{
+  std::ofstream out;
+  out.open (kParseStatsDumpFile);
+  if (out.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kParseStatsDumpFile);
+      return;
+    }
+
+  // get_run_time is in microseconds
+  double seconds = time > 0 ? time / 1e6 : 1e-6;
+  out << "parse time: " << time << " us\n";
+  out << "tokens: " << tokens << ", " << (unsigned long) (tokens / seconds)
+      << " per second\n";
+  out << "AST nodes: " << nodes << ", " << (unsigned long) (nodes / seconds)
+      << " per second\n";
+
+  out.close ();
+}
+
+void
+Session::dump_typecheck_stats () const
+{
+  std::ofstream out;
+  out.open (kTypecheckStatsDumpFile);
+  if (out.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kTypecheckStatsDumpFile);
+      return;
+    }
+
+  out << "bounds probe cache: " << Resolver::TypeBoundsProbe::get_cache_hits ()
+      << " hits, " << Resolver::TypeBoundsProbe::get_cache_misses ()
+      << " misses\n";
+  out << "method probe cache: " << Resolver::MethodResolver::get_cache_hits ()
+      << " hits, " << Resolver::MethodResolver::get_cache_misses ()
+      << " misses\n";
+
+  out.close ();
+}
+
+void
+Session::dump_metadata_stats (
+  const Metadata::PublicInterface &interface) const
+{
+  std::ofstream out;
+  out.open (kMetadataStatsDumpFile);
+  if (out.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kMetadataStatsDumpFile);
+      return;
+    }
+
+  const auto &context = interface.get_context ();
+  size_t total_count = 0;
+  size_t total_bytes = 0;
+  for (const auto &category : context.get_category_sizes ())
+    {
+      out << category.first << ": " << category.second.count << " items, "
+	  << category.second.bytes << " bytes\n";
+      total_count += category.second.count;
+      total_bytes += category.second.bytes;
+    }
+
+  out << "total: " << total_count << " items, " << total_bytes
+      << " bytes, " << context.get_interface_buffer ().size ()
+      << " bytes encoded\n";
+
+  out.close ();
+}
+
+void
+Session::dump_memory_report (const char *stage,
+			     const Compile::Context *ctx) const
+{
+  fprintf (stderr, "\nRust frontend memory after %s:\n", stage);
+  mappings.dump_memory_report ();
+  Resolver::TypeCheckContext::get ()->dump_memory_report ();
+  if (ctx != nullptr)
+    ctx->dump_memory_report ();
+}
+
+void
+Session::dump_expansion_stats (
+  const std::vector<std::pair<unsigned, long>> &round_stats,
+  unsigned match_cache_hits, unsigned match_cache_misses) const
+{
+  std::ofstream out;
+  out.open (kExpansionStatsDumpFile);
+  if (out.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kExpansionStatsDumpFile);
+      return;
+    }
+
+  unsigned total_fragments = 0;
+  long total_time = 0;
+  for (size_t i = 0; i < round_stats.size (); i++)
+    {
+      out << "round " << i + 1 << ": " << round_stats[i].first
+	  << " fragments, " << round_stats[i].second << " us\n";
+      total_fragments += round_stats[i].first;
+      total_time += round_stats[i].second;
+    }
+
+  out << "total: " << round_stats.size () << " rounds, " << total_fragments
+      << " fragments, " << total_time << " us\n";
+  out << "macro_rules! match cache: " << match_cache_hits << " hits, "
+      << match_cache_misses << " misses\n";
+
+  out.close ();
+}
+
+/* Write the profile of every macro that was expanded, slowest first, both as
+   a table for reading and in JSON for tools.  Times are in microseconds.  */
+
+void
+Session::dump_macro_profile (
+  const std::vector<const MacroProfile *> &profiles) const
+{
+  std::ofstream out, json;
+  out.open (kMacroProfileDumpFile);
+  if (out.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kMacroProfileDumpFile);
+      return;
+    }
+  json.open (kMacroProfileJsonFile);
+  if (json.fail ())
+    {
+      rust_error_at (UNKNOWN_LOCATION, "cannot open %s:%m; ignored",
+		     kMacroProfileJsonFile);
+      return;
+    }
+
+  out << "time (us)  invocations  tokens in  tokens out  macro\n";
+  json << "[";
+  for (size_t i = 0; i < profiles.size (); i++)
+    {
+      auto &profile = *profiles[i];
+
+      std::string location = "<unknown>";
+      if (profile.locus != UNDEF_LOCATION)
+	{
+	  expanded_location loc = expand_location (profile.locus);
+	  location = std::string (loc.file) + ":" + std::to_string (loc.line);
+	}
+
+      out << std::setw (9) << profile.time << "  " << std::setw (11)
+	  << profile.invocations << "  " << std::setw (9) << profile.tokens_in
+	  << "  " << std::setw (10) << profile.tokens_out << "  "
+	  << profile.kind << " " << profile.name << " (" << location << ")";
+      if (!profile.arm_matches.empty ())
+	{
+	  out << ", arms matched:";
+	  for (auto matches : profile.arm_matches)
+	    out << " " << matches;
+	}
+      out << "\n";
+
+      json << (i == 0 ? "\n" : ",\n") << "  {\"name\": \""
+	   << SelfProfile::json_escape (profile.name) << "\", \"kind\": \""
+	   << profile.kind << "\", \"location\": \""
+	   << SelfProfile::json_escape (location)
+	   << "\", \"invocations\": " << profile.invocations
+	   << ", \"tokens_in\": " << profile.tokens_in
+	   << ", \"tokens_out\": " << profile.tokens_out
+	   << ", \"time_us\": " << profile.time << ", \"arm_matches\": [";
+      for (size_t arm = 0; arm < profile.arm_matches.size (); arm++)
+	json << (arm == 0 ? "" : ", ") << profile.arm_matches[arm];
+      json << "]}";
+    }
+  json << "\n]\n";
+
+  out.close ();
+  json.close ();
+}
+
 void
 Session::dump_ast_pretty (AST::Crate &crate, bool expanded) const
 {
@@ -984,7 +1586,8 @@ Session::dump_ast_pretty (AST::Crate &crate, bool expanded) const
       return;
     }
 
-  AST::Dump (out).go (crate);
+  AST::Dump (out, options.get_dump_filter (), options.get_crate_name ())
+    .go (crate);
 
   out.close ();
 }
@@ -1022,7 +1625,7 @@ Session::dump_hir (HIR::Crate &crate) const
       return;
     }
 
-  out << crate.as_string ();
+  crate.dump (out);
   out.close ();
 }
 
@@ -1038,15 +1641,49 @@ Session::dump_hir_pretty (HIR::Crate &crate) const
       return;
     }
 
-  HIR::Dump (out).go (crate);
+  HIR::Dump (out, options.get_dump_filter ()).go (crate);
   out.close ();
 }
 
 // imports
 
+/* Parse the source fragments of all the defs of binary crate metadata into a
+   single crate. This is still a full parse of the interface of the crate,
+   which then goes through the whole frontend: the container only saves
+   splitting the text, since the defs hold no decoded types to load lazily.  */
+
+static std::unique_ptr<AST::Crate>
+parse_metadata_sources (const Metadata::MetadataReader &reader,
+			Linemap *linemap)
+{
+  std::vector<std::unique_ptr<AST::Item>> items;
+  for (size_t i = 0; i < reader.num_defs (); i++)
+    {
+      Metadata::DefEntry def = reader.get_def (i);
+      if (def.kind == Metadata::DefKind::INSTANCE)
+	{
+	  Analysis::Mappings::get ().insert_upstream_instance (def.name);
+	  continue;
+	}
+
+      Lexer lex (def.body, def.body_size, linemap);
+      Parser<Lexer> parser (lex);
+      for (auto &item : parser.parse_items ())
+	items.push_back (std::move (item));
+
+      for (const auto &error : parser.get_errors ())
+	error.emit ();
+    }
+
+  return std::unique_ptr<AST::Crate> (
+    new AST::Crate (std::move (items), AST::AttrVec ()));
+}
+
 NodeId
 Session::load_extern_crate (const std::string &crate_name, location_t locus)
 {
+  auto_timevar tv (TV_RUST_EXTERN_CRATES);
+
   // has it already been loaded?
   if (auto crate_num = mappings.lookup_crate_name (crate_name))
     {
@@ -1063,7 +1700,7 @@ Session::load_extern_crate (const std::string &crate_name, location_t locus)
   // -frust-extern
   auto cli_extern_crate = extern_crates.find (crate_name);
 
-  std::pair<std::unique_ptr<Import::Stream>, std::vector<ProcMacro::Procmacro>>
+  std::pair<std::unique_ptr<Import::Stream>, std::vector<LoadedProcMacro>>
     package_result;
   if (cli_extern_crate != extern_crates.end ())
     {
@@ -1094,12 +1731,22 @@ Session::load_extern_crate (const std::string &crate_name, location_t locus)
 	: Imports::ExternCrate (*stream);    // Import from stream
   if (stream != nullptr)
     {
-      bool ok = extern_crate.load (locus);
+      bool ok = extern_crate.load (locus, options.get_metadata_cache_dir ());
       if (!ok)
 	{
 	  rust_error_at (locus, "failed to load crate metadata");
 	  return UNKNOWN_NODEID;
 	}
+
+      // the same crate may be reached under another name, e.g. through
+      // several --extern aliases: import and type check it only once
+      auto loaded = loaded_extern_crates.find (extern_crate.get_checksum ());
+      if (loaded != loaded_extern_crates.end ())
+	{
+	  rust_debug ("crate %s already loaded as %s", crate_name.c_str (),
+		      extern_crate.get_crate_name ().c_str ());
+	  return loaded->second;
+	}
     }
 
   // ensure the current vs this crate name don't collide
@@ -1118,9 +1765,28 @@ Session::load_extern_crate (const std::string &crate_name, location_t locus)
   mappings.set_current_crate (crate_num);
 
   // then lets parse this as a 2nd crate
-  Lexer lex (extern_crate.get_metadata (), linemap);
-  Parser<Lexer> parser (lex);
-  std::unique_ptr<AST::Crate> metadata_crate = parser.parse_crate ();
+  std::unique_ptr<AST::Crate> metadata_crate;
+  const char *metadata = extern_crate.get_metadata ();
+  size_t metadata_size = extern_crate.get_metadata_size ();
+  if (auto reader = Metadata::MetadataReader::open (metadata, metadata_size))
+    {
+      metadata_crate = parse_metadata_sources (*reader, linemap);
+    }
+  else if (Metadata::MetadataReader::is_binary_metadata (metadata,
+							  metadata_size))
+    {
+      rust_error_at (locus, "unsupported or corrupt metadata in crate %qs",
+		     extern_crate.get_crate_name ().c_str ());
+      mappings.set_current_crate (saved_crate_num);
+      return UNKNOWN_NODEID;
+    }
+  else
+    {
+      // metadata written by older compilers is plain source text
+      Lexer lex (metadata, metadata_size, linemap);
+      Parser<Lexer> parser (lex);
+      metadata_crate = parser.parse_crate ();
+    }
 
   AST::Crate &parsed_crate
     = mappings.insert_ast_crate (std::move (metadata_crate), crate_num);
@@ -1129,18 +1795,21 @@ Session::load_extern_crate (const std::string &crate_name, location_t locus)
   std::vector<CustomDeriveProcMacro> derive_macros;
   std::vector<BangProcMacro> bang_macros;
 
-  for (auto &macro : extern_crate.get_proc_macros ())
+  for (auto &loaded : extern_crate.get_proc_macros ())
     {
+      auto &macro = loaded.macro;
       switch (macro.tag)
 	{
 	case ProcMacro::CUSTOM_DERIVE:
-	  derive_macros.push_back (macro.payload.custom_derive);
+	  derive_macros.emplace_back (macro.payload.custom_derive,
+				      loaded.remote, loaded.thread_safe);
 	  break;
 	case ProcMacro::ATTR:
-	  attribute_macros.push_back (macro.payload.attribute);
+	  attribute_macros.emplace_back (macro.payload.attribute,
+					 loaded.remote);
 	  break;
 	case ProcMacro::BANG:
-	  bang_macros.push_back (macro.payload.bang);
+	  bang_macros.emplace_back (macro.payload.bang, loaded.remote);
 	  break;
 	default:
 	  gcc_unreachable ();
@@ -1159,12 +1828,21 @@ Session::load_extern_crate (const std::string &crate_name, location_t locus)
     = HIR::ASTLowering::Resolve (parsed_crate);
   HIR::Crate &hir = mappings.insert_hir_crate (std::move (lowered));
 
-  // perform type resolution
-  Resolver::TypeResolution::Resolve (hir);
+  // perform type resolution, unless it was requested to be done on demand: the
+  // items are then checked through query_type the first time the local crate
+  // refers to them
+  if (!flag_rust_lazy_extern_typecheck)
+    Resolver::TypeResolution::Resolve (hir);
+  else
+    Resolver::TypeResolution::FinishLazy ();
 
   // always restore the crate_num
   mappings.set_current_crate (saved_crate_num);
 
+  if (stream != nullptr)
+    loaded_extern_crates.emplace (extern_crate.get_checksum (),
+				  parsed_crate.get_node_id ());
+
   return parsed_crate.get_node_id ();
 }
 //
@@ -25,6 +25,7 @@
 #include "rust-hir-map.h"
 #include "safe-ctype.h"
 #include "rust-name-resolution-context.h"
+#include "rust-fingerprint-cache.h"
 
 #include "config.h"
 #include "rust-system.h"
@@ -45,6 +46,13 @@ struct Crate;
 namespace HIR {
 class Crate;
 }
+namespace Compile {
+class Context;
+}
+namespace Metadata {
+class PublicInterface;
+}
+struct MacroProfile;
 
 /* Data related to target, most useful for conditional compilation and
  * whatever. */
@@ -76,7 +84,7 @@ public:
   const CrateType &get_crate_type () const { return crate_type; }
 
   // Returns whether a key is defined in the feature set.
-  bool has_key (std::string key) const
+  bool has_key (const std::string &key) const
   {
     auto it = features.find (key);
     return it != features.end ()
@@ -84,12 +92,13 @@ public:
   }
 
   // Returns whether a key exists with the given value in the feature set.
-  bool has_key_value_pair (std::string key, std::string value) const
+  bool has_key_value_pair (const std::string &key,
+			   const std::string &value) const
   {
     auto it = features.find (key);
     if (it != features.end ())
       {
-	auto set = it->second;
+	const auto &set = it->second;
 	auto it2 = set.find (value);
 	if (it2 != set.end ())
 	  return true;
@@ -99,12 +108,12 @@ public:
 
   /* Returns the singular value from the key, or if the key has multiple, an
    * empty string. */
-  std::string get_singular_value (std::string key) const
+  std::string get_singular_value (const std::string &key) const
   {
     auto it = features.find (key);
     if (it != features.end ())
       {
-	auto set = it->second;
+	const auto &set = it->second;
 	if (set.size () == 1 && set.begin ()->has_value ())
 	  return set.begin ()->value ();
       }
@@ -214,11 +223,16 @@ struct CompileOptions
   enum DumpOption
   {
     LEXER_DUMP,
+    PARSE_STATS_DUMP,
     AST_DUMP_PRETTY,
     REGISTER_PLUGINS_DUMP,
     INJECTION_DUMP,
     EXPANSION_DUMP,
+    EXPANSION_STATS_DUMP,
+    MACRO_PROFILE_DUMP,
     RESOLUTION_DUMP,
+    TYPECHECK_STATS_DUMP,
+    METADATA_STATS_DUMP,
     TARGET_OPTION_DUMP,
     HIR_DUMP,
     HIR_DUMP_PRETTY,
@@ -236,6 +250,16 @@ struct CompileOptions
   bool enable_test = false;
   bool debug_assertions = false;
   std::string metadata_output_path;
+  std::string metadata_cache_dir;
+  std::string metadata_ready_path;
+  std::string incremental_dir;
+  std::string dump_filter;
+
+  // Make rules for the files read by the crate, from -M and -MD
+  bool make_deps = false;
+  bool make_deps_phony = false;
+  std::string make_deps_file;
+  std::string make_deps_file_user;
 
   enum class Edition
   {
@@ -274,11 +298,16 @@ struct CompileOptions
   void enable_all_dump_options ()
   {
     enable_dump_option (DumpOption::LEXER_DUMP);
+    enable_dump_option (DumpOption::PARSE_STATS_DUMP);
     enable_dump_option (DumpOption::AST_DUMP_PRETTY);
     enable_dump_option (DumpOption::REGISTER_PLUGINS_DUMP);
     enable_dump_option (DumpOption::INJECTION_DUMP);
     enable_dump_option (DumpOption::EXPANSION_DUMP);
+    enable_dump_option (DumpOption::EXPANSION_STATS_DUMP);
+    enable_dump_option (DumpOption::MACRO_PROFILE_DUMP);
     enable_dump_option (DumpOption::RESOLUTION_DUMP);
+    enable_dump_option (DumpOption::TYPECHECK_STATS_DUMP);
+    enable_dump_option (DumpOption::METADATA_STATS_DUMP);
     enable_dump_option (DumpOption::TARGET_OPTION_DUMP);
     enable_dump_option (DumpOption::HIR_DUMP);
     enable_dump_option (DumpOption::HIR_DUMP_PRETTY);
@@ -334,6 +363,69 @@ struct CompileOptions
   {
     return !metadata_output_path.empty ();
   }
+
+  void set_metadata_cache_dir (const std::string &dir)
+  {
+    metadata_cache_dir = dir;
+  }
+
+  tl::optional<const std::string &> get_metadata_cache_dir () const
+  {
+    if (metadata_cache_dir.empty ())
+      return tl::nullopt;
+
+    return metadata_cache_dir;
+  }
+
+  void set_metadata_ready_path (const std::string &path)
+  {
+    metadata_ready_path = path;
+  }
+
+  tl::optional<const std::string &> get_metadata_ready_path () const
+  {
+    if (metadata_ready_path.empty ())
+      return tl::nullopt;
+
+    return metadata_ready_path;
+  }
+
+  void set_incremental_dir (const std::string &dir) { incremental_dir = dir; }
+
+  tl::optional<const std::string &> get_incremental_dir () const
+  {
+    if (incremental_dir.empty ())
+      return tl::nullopt;
+
+    return incremental_dir;
+  }
+
+  void set_dump_filter (const std::string &path) { dump_filter = path; }
+
+  const std::string &get_dump_filter () const { return dump_filter; }
+
+  void enable_make_deps () { make_deps = true; }
+
+  void set_make_deps_file (const std::string &file) { make_deps_file = file; }
+
+  void set_make_deps_file_user (const std::string &file)
+  {
+    make_deps_file_user = file;
+  }
+
+  void enable_make_deps_phony () { make_deps_phony = true; }
+
+  // The file the Make rules are written to, none stands for stdout. -MF
+  // overrides the file given with -MD.
+  tl::optional<const std::string &> get_make_deps_file () const
+  {
+    auto &file
+      = make_deps_file_user.empty () ? make_deps_file : make_deps_file_user;
+    if (file.empty () || file == "-")
+      return tl::nullopt;
+
+    return file;
+  }
 };
 
 /* Defines a compiler session. This is for a single compiler invocation, so
@@ -346,10 +438,18 @@ struct Session
   std::string injected_crate_name;
   std::map<std::string, std::string> extern_crates;
 
+  // The crates imported from metadata, keyed by the checksum of their payload
+  std::map<std::string, NodeId> loaded_extern_crates;
+
   /* extra files get included during late stages of compilation (e.g. macro
    * expansion) */
   std::vector<std::string> extra_files;
 
+  // With -frust-incremental, the cache of this codegen unit, and whether its
+  // assembly is taken from the cache rather than compiled
+  std::unique_ptr<Incremental::FingerprintCache> incremental_cache;
+  bool reuse_output = false;
+
   // backend linemap
   Linemap *linemap;
 
@@ -366,6 +466,10 @@ public:
    * grs_langhook_init(). Note that this is called after option handling. */
   void init ();
 
+  /* Corresponds to langhook grs_langhook_finish(), called once the assembly
+   * file is closed. */
+  void finish ();
+
   // delete those constructors so we don't access the singleton in any
   // other way than via `get_instance()`
   Session (Session const &) = delete;
@@ -389,14 +493,30 @@ public:
 
   NodeId load_extern_crate (const std::string &crate_name, location_t locus);
 
+  /* Print the size of the frontend's tables to stderr once STAGE is done. The
+   * code generation caches are only printed when CTX is given. */
+  void dump_memory_report (const char *stage,
+			   const Compile::Context *ctx = nullptr) const;
+
 private:
   Session () : mappings (Analysis::Mappings::get ()) {}
   void compile_crate (const char *filename);
   bool enable_dump (std::string arg);
+  void write_make_deps () const;
+  void write_self_profile () const;
+  std::string incremental_environment () const;
 
   void dump_lex (Parser<Lexer> &parser) const;
   void dump_ast_pretty (AST::Crate &crate, bool expanded = false) const;
+  void dump_expansion_stats (
+    const std::vector<std::pair<unsigned, long>> &round_stats,
+    unsigned match_cache_hits, unsigned match_cache_misses) const;
+  void dump_macro_profile (
+    const std::vector<const MacroProfile *> &profiles) const;
   void dump_name_resolution (Resolver2_0::NameResolutionContext &ctx) const;
+  void dump_parse_stats (size_t tokens, size_t nodes, long time) const;
+  void dump_typecheck_stats () const;
+  void dump_metadata_stats (const Metadata::PublicInterface &interface) const;
   void dump_hir (HIR::Crate &crate) const;
   void dump_hir_pretty (HIR::Crate &crate) const;
 
@@ -49,6 +49,13 @@
 #include <stack>
 #include <limits>
 #include <numeric>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <bitset>
+#include <tuple>
+#include <chrono>
 
 // Rust frontend requires C++11 minimum, so will have unordered_map and set
 #include <unordered_map>
@@ -22,6 +22,7 @@
 #include "rust-hir-trait-resolve.h"
 #include "rust-type-util.h"
 #include "rust-substitution-mapper.h"
+#include "rust-tyty-intern.h"
 
 namespace Rust {
 namespace Resolver {
@@ -40,20 +41,62 @@ Adjuster::adjust_type (const std::vector<Adjustment> &adjustments)
   return adjustments.back ().get_expected ()->clone ();
 }
 
+// Whether the current function is a Deref or DerefMut method, which must not
+// find itself when derefing its own receiver
+static bool
+in_deref_method (TypeCheckContext *context, LangItem::Kind deref_lang_item)
+{
+  if (!context->have_function_context ())
+    return false;
+
+  std::string name = LangItem::ToString (deref_lang_item);
+  TypeCheckContextItem current = context->peek_context ();
+  switch (current.get_type ())
+    {
+    case TypeCheckContextItem::ItemType::IMPL_ITEM:
+      return current.get_impl_item ().second->get_function_name ().as_string ()
+	     == name;
+    case TypeCheckContextItem::ItemType::TRAIT_ITEM:
+      return current.get_trait_item ()
+	       ->get_decl ()
+	       .get_function_name ()
+	       .as_string ()
+	     == name;
+    default:
+      return false;
+    }
+}
+
 Adjustment
 Adjuster::try_deref_type (TyTy::BaseType *ty, LangItem::Kind deref_lang_item)
 {
-  TyTy::FnType *fn = nullptr;
-  Adjustment::AdjustmentType requires_ref_adjustment
-    = Adjustment::AdjustmentType::ERROR;
-  bool operator_overloaded
-    = resolve_operator_overload_fn (deref_lang_item, ty, &fn,
-				    &requires_ref_adjustment);
-  if (!operator_overloaded)
+  auto context = TypeCheckContext::get ();
+
+  // the impls found for a fully resolved type do not depend on where it is
+  // derefed, so they are only probed once per type
+  const TyTy::BaseType *interned = nullptr;
+  if (!context->in_snapshot () && !in_deref_method (context, deref_lang_item))
+    interned = TyTy::TypeInterner::get ().intern (ty);
+
+  TypeCheckContext::DerefImpl impl
+    = {nullptr, Adjustment::AdjustmentType::ERROR};
+  if (interned == nullptr
+      || !context->lookup_deref_impl (interned, deref_lang_item, &impl))
     {
-      return Adjustment::get_error ();
+      if (!resolve_operator_overload_fn (deref_lang_item, ty, &impl.fn,
+					 &impl.requires_ref_adjustment))
+	impl = {nullptr, Adjustment::AdjustmentType::ERROR};
+
+      if (interned != nullptr)
+	context->insert_deref_impl (interned, deref_lang_item, impl);
     }
 
+  TyTy::FnType *fn = impl.fn;
+  Adjustment::AdjustmentType requires_ref_adjustment
+    = impl.requires_ref_adjustment;
+  if (fn == nullptr)
+    return Adjustment::get_error ();
+
   auto resolved_base = fn->get_return_type ()->destructure ();
   bool is_valid_type = resolved_base->get_kind () == TyTy::TypeKind::REF;
   if (!is_valid_type)
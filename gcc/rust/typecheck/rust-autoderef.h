@@ -125,6 +125,26 @@ private:
   Adjustment::AdjustmentType requires_ref_adjustment;
 };
 
+// The adjustments of one expression, as stored in the pool of an
+// AdjustmentTable. This is only valid until the table grows again.
+class AdjustmentSpan
+{
+public:
+  AdjustmentSpan (Adjustment *first, size_t count)
+    : first (first), count (count)
+  {}
+
+  Adjustment *begin () const { return first; }
+  Adjustment *end () const { return first + count; }
+
+  size_t size () const { return count; }
+  bool empty () const { return count == 0; }
+
+private:
+  Adjustment *first;
+  size_t count;
+};
+
 class Adjuster
 {
 public:
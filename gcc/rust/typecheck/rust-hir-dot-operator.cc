@@ -22,6 +22,8 @@
 #include "rust-hir-type-check-item.h"
 #include "rust-type-util.h"
 #include "rust-coercion.h"
+#include "rust-hir-impl-index.h"
+#include "rust-tyty-intern.h"
 
 namespace Rust {
 namespace Resolver {
@@ -31,13 +33,51 @@ MethodResolver::MethodResolver (bool autoderef_flag,
   : AutoderefCycle (autoderef_flag), segment_name (segment_name), result ()
 {}
 
+MethodResolver::Cache &
+MethodResolver::get_cache ()
+{
+  static Cache cache;
+  return cache;
+}
+
 std::set<MethodCandidate>
 MethodResolver::Probe (TyTy::BaseType *receiver,
 		       const HIR::PathIdentSegment &segment_name,
 		       bool autoderef_flag)
 {
+  auto interned = TyTy::TypeInterner::get ().intern (receiver);
+  if (interned == nullptr)
+    {
+      MethodResolver resolver (autoderef_flag, segment_name);
+      resolver.cycle (receiver);
+      return resolver.result;
+    }
+
+  auto &cache = get_cache ();
+  auto generation = ImplIndex::get ().get_generation ();
+  if (cache.generation != generation)
+    {
+      cache.results.clear ();
+      cache.generation = generation;
+    }
+
+  auto key = std::make_tuple (interned, segment_name.as_string (),
+			      autoderef_flag);
+  auto cached = cache.results.find (key);
+  if (cached != cache.results.end ())
+    {
+      cache.hits++;
+      return cached->second;
+    }
+
+  cache.misses++;
   MethodResolver resolver (autoderef_flag, segment_name);
   resolver.cycle (receiver);
+
+  // probing can resolve more impls, which makes the results stale already
+  if (ImplIndex::get ().get_generation () == generation)
+    cache.results.emplace (std::move (key), resolver.result);
+
   return resolver.result;
 }
 
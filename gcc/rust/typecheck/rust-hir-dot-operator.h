@@ -65,6 +65,9 @@ public:
     const HIR::PathIdentSegment &segment_name, const TyTy::BaseType &receiver,
     const std::vector<TyTy::TypeBoundPredicate> &specified_bounds);
 
+  static unsigned get_cache_hits () { return get_cache ().hits; }
+  static unsigned get_cache_misses () { return get_cache ().misses; }
+
 protected:
   MethodResolver (bool autoderef_flag,
 		  const HIR::PathIdentSegment &segment_name);
@@ -74,6 +77,21 @@ protected:
   bool select (TyTy::BaseType &receiver) override;
 
 private:
+  // Probe results for receivers without any inference variables or generics
+  // left, by the interned copy of the receiver, the method name and whether
+  // autoderef was allowed
+  struct Cache
+  {
+    unsigned generation = 0;
+    unsigned hits = 0;
+    unsigned misses = 0;
+    std::map<std::tuple<const TyTy::BaseType *, std::string, bool>,
+	     std::set<MethodCandidate>>
+      results;
+  };
+
+  static Cache &get_cache ();
+
   std::vector<Adjustment>
   append_adjustments (const std::vector<Adjustment> &adjustments) const;
 
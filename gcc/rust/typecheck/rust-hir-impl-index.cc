@@ -0,0 +1,186 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-hir-impl-index.h"
+#include "rust-hir-full.h"
+#include "rust-type-util.h"
+#include "rust-thread-state.h"
+
+namespace Rust {
+namespace Resolver {
+
+ImplIndex &
+ImplIndex::get ()
+{
+  auto &instance = ThreadState::current ().impl_index;
+  if (instance == nullptr)
+    instance = new ImplIndex ();
+
+  return *instance;
+}
+
+tl::optional<std::pair<TyTy::TypeKind, std::string>>
+ImplIndex::simplify (const TyTy::BaseType *ty)
+{
+  const TyTy::BaseType *raw = ty->destructure ();
+  switch (raw->get_kind ())
+    {
+    case TyTy::ADT:
+      // ADTs are compared by name
+      return std::make_pair (TyTy::ADT,
+			     static_cast<const TyTy::ADTType *> (raw)
+			       ->get_identifier ());
+
+    // function items, function pointers and closures can all unify with
+    // each other
+    case TyTy::FNDEF:
+    case TyTy::FNPTR:
+    case TyTy::CLOSURE:
+      return std::make_pair (TyTy::FNPTR, std::string ());
+
+    case TyTy::STR:
+    case TyTy::REF:
+    case TyTy::POINTER:
+    case TyTy::ARRAY:
+    case TyTy::SLICE:
+    case TyTy::TUPLE:
+    case TyTy::BOOL:
+    case TyTy::CHAR:
+    case TyTy::INT:
+    case TyTy::UINT:
+    case TyTy::FLOAT:
+    case TyTy::USIZE:
+    case TyTy::ISIZE:
+    case TyTy::DYNAMIC:
+      return std::make_pair (raw->get_kind (), std::string ());
+
+    case TyTy::INFER:
+    case TyTy::PARAM:
+    case TyTy::NEVER:
+    case TyTy::PLACEHOLDER:
+    case TyTy::PROJECTION:
+    case TyTy::CONST:
+    case TyTy::ERROR:
+      break;
+    }
+
+  return tl::nullopt;
+}
+
+void
+ImplIndex::add (HIR::ImplBlock *impl, TyTy::BaseType *self)
+{
+  generation++;
+
+  auto key = simplify (self);
+  if (key.has_value ())
+    buckets[key.value ()].emplace_back (impl, self);
+  else
+    wildcards.emplace_back (impl, self);
+}
+
+void
+ImplIndex::build ()
+{
+  buckets.clear ();
+  wildcards.clear ();
+  unresolved.clear ();
+
+  mappings.iterate_impl_blocks ([this] (HirId, HIR::ImplBlock *impl) {
+    HirId self_id = impl->get_type ()->get_mappings ().get_hirid ();
+    TyTy::BaseType *self = nullptr;
+    if (query_type (self_id, &self))
+      add (impl, self);
+    else
+      unresolved.push_back (impl);
+
+    return true;
+  });
+
+  indexed_impls = mappings.get_impl_block_count ();
+}
+
+void
+ImplIndex::retry_unresolved ()
+{
+  auto pending = std::move (unresolved);
+  unresolved.clear ();
+
+  for (auto impl : pending)
+    {
+      HirId self_id = impl->get_type ()->get_mappings ().get_hirid ();
+      TyTy::BaseType *self = nullptr;
+      if (query_type (self_id, &self))
+	add (impl, self);
+      else
+	unresolved.push_back (impl);
+    }
+}
+
+void
+ImplIndex::refresh ()
+{
+  if (indexed_impls != mappings.get_impl_block_count ())
+    build ();
+  else if (!unresolved.empty ())
+    retry_unresolved ();
+}
+
+unsigned
+ImplIndex::get_generation ()
+{
+  refresh ();
+  return generation;
+}
+
+std::vector<std::pair<HIR::ImplBlock *, TyTy::BaseType *>>
+ImplIndex::get_candidates (const TyTy::BaseType *receiver)
+{
+  refresh ();
+
+  std::vector<Entry> candidates;
+
+  auto key = simplify (receiver);
+  if (key.has_value ())
+    {
+      auto bucket = buckets.find (key.value ());
+      if (bucket != buckets.end ())
+	candidates = bucket->second;
+      candidates.insert (candidates.end (), wildcards.begin (),
+			 wildcards.end ());
+    }
+  else
+    {
+      // an unknown receiver may unify with any impl
+      candidates = wildcards;
+      for (auto &bucket : buckets)
+	candidates.insert (candidates.end (), bucket.second.begin (),
+			   bucket.second.end ());
+    }
+
+  std::sort (candidates.begin (), candidates.end (),
+	     [] (const Entry &a, const Entry &b) {
+	       return a.first->get_mappings ().get_hirid ()
+		      < b.first->get_mappings ().get_hirid ();
+	     });
+
+  return candidates;
+}
+
+} // namespace Resolver
+} // namespace Rust
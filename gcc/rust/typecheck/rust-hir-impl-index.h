@@ -0,0 +1,84 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_HIR_IMPL_INDEX_H
+#define RUST_HIR_IMPL_INDEX_H
+
+#include "rust-system.h"
+#include "rust-hir-map.h"
+#include "rust-tyty.h"
+
+namespace Rust {
+namespace Resolver {
+
+/**
+ * The impl blocks of the program, bucketed by a simplified form of their self
+ * type: the type kind, plus the name of ADTs. Two types with a different
+ * simplified form can never unify, so probing the impls for a receiver only
+ * needs to go through its own bucket and the impls for generic, inferred or
+ * otherwise unknown self types, which can unify with anything.
+ *
+ * The index gets built on the first probe, and rebuilt if impl blocks get
+ * added to the mappings afterwards. Impls whose self type cannot be resolved
+ * yet, because it is being resolved for instance, are retried on every probe
+ * until it can.
+ */
+class ImplIndex
+{
+public:
+  static ImplIndex &get ();
+
+  // The impl blocks whose self type might unify with RECEIVER, in HirId
+  // order, along with their resolved self type
+  std::vector<std::pair<HIR::ImplBlock *, TyTy::BaseType *>>
+  get_candidates (const TyTy::BaseType *receiver);
+
+  // Bumped every time impls get added to the index, so that results derived
+  // from the candidates can be invalidated
+  unsigned get_generation ();
+
+  // The simplified form of TY, or nothing if it can unify with other kinds
+  // of types
+  static tl::optional<std::pair<TyTy::TypeKind, std::string>>
+  simplify (const TyTy::BaseType *ty);
+
+private:
+  ImplIndex ()
+    : indexed_impls (0), generation (0), mappings (Analysis::Mappings::get ())
+  {}
+
+  void build ();
+  void add (HIR::ImplBlock *impl, TyTy::BaseType *self);
+  void retry_unresolved ();
+  void refresh ();
+
+  using Entry = std::pair<HIR::ImplBlock *, TyTy::BaseType *>;
+
+  std::map<std::pair<TyTy::TypeKind, std::string>, std::vector<Entry>> buckets;
+  std::vector<Entry> wildcards;
+  std::vector<HIR::ImplBlock *> unresolved;
+  size_t indexed_impls;
+  unsigned generation;
+
+  Analysis::Mappings &mappings;
+};
+
+} // namespace Resolver
+} // namespace Rust
+
+#endif // RUST_HIR_IMPL_INDEX_H
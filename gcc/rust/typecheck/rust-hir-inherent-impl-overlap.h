@@ -21,24 +21,39 @@
 
 #include "rust-hir-type-check-base.h"
 #include "rust-type-util.h"
+#include "rust-hir-impl-index.h"
 
 namespace Rust {
 namespace Resolver {
 
 class OverlappingImplItemPass : public TypeCheckBase
 {
+  struct ImplItemEntry
+  {
+    // the Self type of the impl block defining the item
+    HirId impl_type_id;
+    TyTy::BaseType *type;
+    HIR::ImplItem *item;
+  };
+
 public:
   static void go ()
   {
     OverlappingImplItemPass pass;
 
-    // generate mappings
+    // generate mappings. An inherent impl is always in the crate of its Self
+    // type, so the ones from the other crates cannot collide with the impls
+    // of this one and were checked when these crates were compiled
+    CrateNum crate = pass.mappings.get_current_crate ();
     pass.mappings.iterate_impl_items (
       [&] (HirId id, HIR::ImplItem *impl_item, HIR::ImplBlock *impl) -> bool {
 	// ignoring trait-impls might need thought later on
 	if (impl->has_trait_ref ())
 	  return true;
 
+	if (impl->get_mappings ().get_crate_num () != crate)
+	  return true;
+
 	pass.process_impl_item (id, impl_item, impl);
 	return true;
       });
@@ -49,80 +64,95 @@ public:
   void process_impl_item (HirId id, HIR::ImplItem *impl_item,
 			  HIR::ImplBlock *impl)
   {
-    // lets make a mapping of impl-item Self type to (impl-item,name):
+    // lets make a mapping of impl-item name to the Self types defining it:
     // {
-    //   impl-type -> [ (item, name), ... ]
+    //   name -> [ (impl-type, item), ... ]
     // }
 
+    // only look at the impls which were type checked already, rather than
+    // querying the others into existence
     HirId impl_type_id = impl->get_type ()->get_mappings ().get_hirid ();
     TyTy::BaseType *impl_type = nullptr;
-    bool ok = query_type (impl_type_id, &impl_type);
+    bool ok = context->lookup_type (impl_type_id, &impl_type);
     if (!ok)
       return;
 
-    std::string impl_item_name = impl_item->get_impl_item_name ();
-    std::pair<HIR::ImplItem *, std::string> elem (impl_item, impl_item_name);
-    impl_mappings[impl_type].insert (std::move (elem));
+    impl_items[impl_item->get_impl_item_name ()].push_back (
+      {impl_type_id, impl_type, impl_item});
   }
 
   void scan ()
   {
-    // we can now brute force the map looking for can_eq on each of the
-    // impl_items_types to look for possible colliding impl blocks;
-    for (auto it = impl_mappings.begin (); it != impl_mappings.end (); it++)
+    // only the items sharing a name can collide, and only when their Self
+    // types can unify: bucket them by the simplified form of these types, so
+    // that can_eq is only used on the pairs which might
+    for (auto &named : impl_items)
       {
-	TyTy::BaseType *query = it->first;
-
-	for (auto iy = impl_mappings.begin (); iy != impl_mappings.end (); iy++)
+	const std::vector<ImplItemEntry> &entries = named.second;
+	if (entries.size () < 2)
+	  continue;
+
+	std::map<std::pair<TyTy::TypeKind, std::string>, std::vector<size_t>>
+	  buckets;
+	std::vector<size_t> wildcards;
+	std::vector<tl::optional<std::pair<TyTy::TypeKind, std::string>>>
+	  simplified;
+	for (size_t i = 0; i < entries.size (); i++)
 	  {
-	    TyTy::BaseType *candidate = iy->first;
-	    if (query == candidate)
-	      continue;
+	    simplified.push_back (ImplIndex::simplify (entries[i].type));
+	    if (simplified.back ().has_value ())
+	      buckets[simplified.back ().value ()].push_back (i);
+	    else
+	      wildcards.push_back (i);
+	  }
 
-	    if (query->can_eq (candidate, false))
+	for (size_t i = 0; i < entries.size (); i++)
+	  {
+	    std::vector<size_t> candidates;
+	    if (simplified[i].has_value ())
 	      {
-		// we might be in the case that we have:
-		//
-		// *const T vs *const [T]
-		//
-		// so lets use an equality check when the
-		// candidates are both generic to be sure we dont emit a false
-		// positive
-
-		bool a = query->is_concrete ();
-		bool b = candidate->is_concrete ();
-		bool both_generic = !a && !b;
-		if (both_generic)
-		  {
-		    if (!query->is_equal (*candidate))
-		      continue;
-		  }
-
-		possible_collision (it->second, iy->second);
+		candidates = buckets[simplified[i].value ()];
+		candidates.insert (candidates.end (), wildcards.begin (),
+				   wildcards.end ());
+		std::sort (candidates.begin (), candidates.end ());
 	      }
+	    else
+	      {
+		for (size_t j = 0; j < entries.size (); j++)
+		  candidates.push_back (j);
+	      }
+
+	    for (size_t j : candidates)
+	      possible_collision (entries[i], entries[j], named.first);
 	  }
       }
   }
 
-  void possible_collision (
-    std::set<std::pair<HIR::ImplItem *, std::string> > query,
-    std::set<std::pair<HIR::ImplItem *, std::string> > candidate)
+  void possible_collision (const ImplItemEntry &query,
+			   const ImplItemEntry &candidate,
+			   const std::string &name)
   {
-    for (auto &q : query)
-      {
-	HIR::ImplItem *query_impl_item = q.first;
-	std::string query_impl_item_name = q.second;
+    if (query.impl_type_id == candidate.impl_type_id)
+      return;
 
-	for (auto &c : candidate)
-	  {
-	    HIR::ImplItem *candidate_impl_item = c.first;
-	    std::string candidate_impl_item_name = c.second;
+    if (!query.type->can_eq (candidate.type, false))
+      return;
 
-	    if (query_impl_item_name.compare (candidate_impl_item_name) == 0)
-	      collision_detected (query_impl_item, candidate_impl_item,
-				  candidate_impl_item_name);
-	  }
-      }
+    // we might be in the case that we have:
+    //
+    // *const T vs *const [T]
+    //
+    // so lets use an equality check when the
+    // candidates are both generic to be sure we dont emit a false
+    // positive
+
+    bool a = query.type->is_concrete ();
+    bool b = candidate.type->is_concrete ();
+    bool both_generic = !a && !b;
+    if (both_generic && !query.type->is_equal (*candidate.type))
+      return;
+
+    collision_detected (query.item, candidate.item, name);
   }
 
   void collision_detected (HIR::ImplItem *query, HIR::ImplItem *dup,
@@ -139,9 +169,10 @@ public:
 private:
   OverlappingImplItemPass () : TypeCheckBase () {}
 
-  std::map<TyTy::BaseType *,
-	   std::set<std::pair<HIR::ImplItem *, std::string> > >
-    impl_mappings;
+  // Keyed by name and kept in the order of the HirIds of the items, rather
+  // than by TyTy pointers, so that the diagnostics come out in the same
+  // order whatever the allocator does.
+  std::map<std::string, std::vector<ImplItemEntry>> impl_items;
 };
 
 } // namespace Resolver
@@ -20,6 +20,7 @@
 #include "rust-hir-trait-resolve.h"
 #include "rust-type-util.h"
 #include "rust-hir-type-bounds.h"
+#include "rust-hir-impl-index.h"
 #include "rust-hir-full.h"
 
 namespace Rust {
@@ -285,11 +286,13 @@ PathProbeType::process_enum_item_for_candiates (const TyTy::ADTType *adt)
 void
 PathProbeType::process_impl_items_for_candidates ()
 {
-  mappings.iterate_impl_items (
-    [&] (HirId id, HIR::ImplItem *item, HIR::ImplBlock *impl) mutable -> bool {
-      process_impl_item_candidate (id, item, impl);
-      return true;
-    });
+  for (auto &candidate : ImplIndex::get ().get_candidates (receiver))
+    {
+      HIR::ImplBlock *impl = candidate.first;
+      for (auto &item : impl->get_impl_items ())
+	process_impl_item_candidate (item->get_impl_mappings ().get_hirid (),
+				     item.get (), impl);
+    }
 }
 
 void
@@ -77,25 +77,46 @@ TraitItemReference::get_tyty () const
   switch (type)
     {
     case CONST:
-      return get_type_from_constant (
-	static_cast</*const*/ HIR::TraitItemConst &> (*hir_trait_item));
+    case FN:
       break;
 
     case TYPE:
       return get_type_from_typealias (
 	static_cast</*const*/ HIR::TraitItemType &> (*hir_trait_item));
 
-    case FN:
-      return get_type_from_fn (
-	static_cast</*const*/ HIR::TraitItemFunc &> (*hir_trait_item));
-      break;
-
     default:
       return get_error ();
     }
 
-  rust_unreachable ();
-  return get_error ();
+  // callers may substitute or otherwise modify the type they get, so each of
+  // them gets its own copy of the cached one
+  if (resolved_tyty != nullptr)
+    return resolved_tyty->clone ();
+
+  HirId id = get_mappings ().get_hirid ();
+  if (context->query_in_progress (id))
+    {
+      rust_error_at (locus, ErrorCode::E0391,
+		     "cycle detected when computing the type of %qs",
+		     identifier.c_str ());
+      return get_error ();
+    }
+
+  context->insert_query (id);
+  TyTy::BaseType *ty
+    = type == CONST
+	? get_type_from_constant (
+	  static_cast</*const*/ HIR::TraitItemConst &> (*hir_trait_item))
+	: get_type_from_fn (
+	  static_cast</*const*/ HIR::TraitItemFunc &> (*hir_trait_item));
+  context->query_completed (id);
+
+  // what gets inserted while unifying speculatively may be rolled back
+  if (context->in_snapshot ())
+    return ty;
+
+  resolved_tyty = ty;
+  return resolved_tyty->clone ();
 }
 
 TyTy::ErrorType *
@@ -120,7 +120,6 @@ private:
 
   TyTy::BaseType *get_type_from_fn (/*const*/ HIR::TraitItemFunc &fn) const;
 
-  bool is_item_resolved () const;
   void resolve_item (HIR::TraitItemType &type);
   void resolve_item (HIR::TraitItemConst &constant);
   void resolve_item (HIR::TraitItemFunc &func);
@@ -135,6 +134,10 @@ private:
   TyTy::BaseType
     *self; // this is the implict Self TypeParam required for methods
   Resolver::TypeCheckContext *context;
+
+  // the type of a function or constant, built on the first get_tyty (), which
+  // hands out clones of it
+  mutable TyTy::BaseType *resolved_tyty;
 };
 
 // this wraps up the HIR::Trait so we can do analysis on it
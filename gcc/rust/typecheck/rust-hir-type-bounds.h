@@ -35,7 +35,25 @@ public:
   static bool is_bound_satisfied_for_type (TyTy::BaseType *receiver,
 					   TraitReference *ref);
 
+  static unsigned get_cache_hits () { return get_cache ().hits; }
+  static unsigned get_cache_misses () { return get_cache ().misses; }
+
 private:
+  // Probe results for receivers without any inference variables or generics
+  // left, by the interned copy of the receiver
+  struct Cache
+  {
+    unsigned generation = 0;
+    unsigned hits = 0;
+    unsigned misses = 0;
+    std::unordered_map<
+      const TyTy::BaseType *,
+      std::vector<std::pair<TraitReference *, HIR::ImplBlock *>>>
+      results;
+  };
+
+  static Cache &get_cache ();
+
   void scan ();
   void assemble_sized_builtin ();
   void assemble_builtin_candidate (LangItem::Kind item);
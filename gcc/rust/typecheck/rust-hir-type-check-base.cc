@@ -264,10 +264,13 @@ TypeCheckBase::resolve_literal (const Analysis::NodeMapping &expr_mappings,
 					       crate_num),
 					     UNKNOWN_LOCAL_DEFID);
 
+	TyTy::BaseType *capacity
+	  = evaluate_const_value (*literal_capacity, expected_ty);
 	TyTy::ArrayType *array
 	  = new TyTy::ArrayType (array_mapping.get_hirid (), locus,
 				 *literal_capacity,
-				 TyTy::TyVar (u8->get_ref ()));
+				 TyTy::TyVar (u8->get_ref ()),
+				 TyTy::TyVar (capacity->get_ref ()));
 	context->insert_type (array_mapping, array);
 
 	infered = new TyTy::ReferenceType (expr_mappings.get_hirid (),
@@ -285,6 +288,17 @@ TypeCheckBase::resolve_literal (const Analysis::NodeMapping &expr_mappings,
   return infered;
 }
 
+// Can NAME be used as the discriminant type of an enum in #[repr(NAME)] ?
+static bool
+is_repr_integer_type (const std::string &name)
+{
+  static const std::set<std::string> names
+    = {"u8", "u16", "u32", "u64", "u128", "usize",
+       "i8", "i16", "i32", "i64", "i128", "isize"};
+
+  return names.find (name) != names.end ();
+}
+
 TyTy::ADTType::ReprOptions
 TypeCheckBase::parse_repr_options (const AST::AttrVec &attrs, location_t locus)
 {
@@ -294,7 +308,7 @@ TypeCheckBase::parse_repr_options (const AST::AttrVec &attrs, location_t locus)
 
   for (const auto &attr : attrs)
     {
-      bool is_repr = attr.get_path ().as_string () == Values::Attributes::REPR;
+      bool is_repr = attr.get_builtin () == Values::BuiltinAttribute::REPR;
       if (is_repr)
 	{
 	  const AST::AttrInput &input = attr.get_attr_input ();
@@ -342,6 +356,17 @@ TypeCheckBase::parse_repr_options (const AST::AttrVec &attrs, location_t locus)
 	    repr.pack = value;
 	  else if (is_align)
 	    repr.align = value;
+	  else if (inline_option.compare ("C") == 0)
+	    repr.is_c = true;
+	  else if (inline_option.compare ("simd") == 0)
+	    repr.is_simd = true;
+	  else if (inline_option.compare ("transparent") == 0)
+	    repr.is_transparent = true;
+	  else if (is_repr_integer_type (inline_option))
+	    {
+	      bool ok = context->lookup_builtin (inline_option, &repr.repr);
+	      rust_assert (ok);
+	    }
 
 	  // Multiple repr options must be specified with e.g. #[repr(C,
 	  // packed(2))].
@@ -373,37 +398,14 @@ TypeCheckBase::resolve_generic_params (
 
 	  break;
 
-	  case HIR::GenericParam::GenericKind::CONST: {
-	    auto param
-	      = static_cast<HIR::ConstGenericParam *> (generic_param.get ());
-	    auto specified_type
-	      = TypeCheckType::Resolve (param->get_type ().get ());
-
-	    if (param->has_default_expression ())
-	      {
-		auto expr_type = TypeCheckExpr::Resolve (
-		  param->get_default_expression ().get ());
-
-		coercion_site (
-		  param->get_mappings ().get_hirid (),
-		  TyTy::TyWithLocation (specified_type),
-		  TyTy::TyWithLocation (
-		    expr_type, param->get_default_expression ()->get_locus ()),
-		  param->get_locus ());
-	      }
-
-	    context->insert_type (generic_param->get_mappings (),
-				  specified_type);
-	  }
-	  break;
-
+	case HIR::GenericParam::GenericKind::CONST:
 	  case HIR::GenericParam::GenericKind::TYPE: {
 	    auto param_type
 	      = TypeResolveGenericParam::Resolve (generic_param.get ());
 	    context->insert_type (generic_param->get_mappings (), param_type);
 
-	    substitutions.push_back (TyTy::SubstitutionParamMapping (
-	      static_cast<HIR::TypeParam &> (*generic_param), param_type));
+	    substitutions.push_back (
+	      TyTy::SubstitutionParamMapping (*generic_param, param_type));
 	  }
 	  break;
 	}
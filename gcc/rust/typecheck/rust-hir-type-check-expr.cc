@@ -918,6 +918,9 @@ TypeCheckExpr::visit (HIR::ArrayExpr &expr)
 
   HIR::Expr *capacity_expr = nullptr;
   TyTy::BaseType *element_type = nullptr;
+  TyTy::BaseType *expected_ty = nullptr;
+  bool ok = context->lookup_builtin ("usize", &expected_ty);
+  rust_assert (ok);
   switch (elements.get_array_expr_type ())
     {
       case HIR::ArrayElems::ArrayExprType::COPIED: {
@@ -929,9 +932,6 @@ TypeCheckExpr::visit (HIR::ArrayExpr &expr)
 	auto capacity_type
 	  = TypeCheckExpr::Resolve (elems.get_num_copies_expr ().get ());
 
-	TyTy::BaseType *expected_ty = nullptr;
-	bool ok = context->lookup_builtin ("usize", &expected_ty);
-	rust_assert (ok);
 	context->insert_type (elems.get_num_copies_expr ()->get_mappings (),
 			      expected_ty);
 
@@ -978,17 +978,20 @@ TypeCheckExpr::visit (HIR::ArrayExpr &expr)
 					      UNDEF_LOCATION, {});
 
 	// mark the type for this implicit node
-	TyTy::BaseType *expected_ty = nullptr;
-	bool ok = context->lookup_builtin ("usize", &expected_ty);
-	rust_assert (ok);
 	context->insert_type (mapping, expected_ty);
       }
       break;
     }
 
+  tl::optional<TyTy::TyVar> capacity = tl::nullopt;
+  auto value = evaluate_const_value (*capacity_expr, expected_ty);
+  if (value != nullptr)
+    capacity = TyTy::TyVar (value->get_ref ());
+
   infered = new TyTy::ArrayType (expr.get_mappings ().get_hirid (),
 				 expr.get_locus (), *capacity_expr,
-				 TyTy::TyVar (element_type->get_ref ()));
+				 TyTy::TyVar (element_type->get_ref ()),
+				 capacity);
 }
 
 // empty struct
@@ -1499,6 +1502,45 @@ TypeCheckExpr::visit (HIR::MatchExpr &expr)
     }
 }
 
+void
+TypeCheckExpr::visit (HIR::InlineAsm &expr)
+{
+  using RegisterType = HIR::InlineAsmOperand::RegisterType;
+
+  for (auto &operand : expr.get_operands ())
+    {
+      TyTy::BaseType *type = nullptr;
+      if (operand.has_expr ())
+	type = TypeCheckExpr::Resolve (operand.expr.get ());
+      if (operand.has_out_expr ())
+	TypeCheckExpr::Resolve (operand.out_expr.get ());
+
+      // const operands are pasted in the template, as integers
+      if (operand.register_type == RegisterType::Const)
+	{
+	  bool valid
+	    = type->get_kind () == TyTy::TypeKind::INT
+	      || type->get_kind () == TyTy::TypeKind::UINT
+	      || type->get_kind () == TyTy::TypeKind::ISIZE
+	      || type->get_kind () == TyTy::TypeKind::USIZE
+	      || (type->get_kind () == TyTy::TypeKind::INFER
+		  && (((TyTy::InferType *) type)->get_infer_kind ()
+		      == TyTy::InferType::INTEGRAL));
+	  if (!valid)
+	    rust_error_at (operand.locus,
+			   "invalid type for %<const%> operand: expected an "
+			   "integer, found %qs",
+			   type->get_name ().c_str ());
+	}
+    }
+
+  HirId id = expr.get_mappings ().get_hirid ();
+  if (expr.has_option (AST::InlineAsmOption::NORETURN))
+    infered = new TyTy::NeverType (id);
+  else
+    infered = TyTy::TupleType::get_unit_type (id);
+}
+
 void
 TypeCheckExpr::visit (HIR::ClosureExpr &expr)
 {
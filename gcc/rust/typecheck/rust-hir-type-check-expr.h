@@ -80,6 +80,7 @@ public:
   // lets not worry about async yet....
   void visit (HIR::AwaitExpr &) override {}
   void visit (HIR::AsyncBlockExpr &) override {}
+  void visit (HIR::InlineAsm &expr) override;
 
   // don't need to implement these see rust-hir-type-check-struct-field.h
   void visit (HIR::StructExprFieldIdentifier &) override
@@ -31,6 +31,7 @@
 #include "rust-substitution-mapper.h"
 #include "rust-type-util.h"
 #include "rust-tyty-variance-analysis.h"
+#include "rust-self-profile.h"
 
 namespace Rust {
 namespace Resolver {
@@ -51,6 +52,7 @@ TypeCheckItem::Resolve (HIR::Item &item)
   rust_assert (item.get_hir_kind () == HIR::Node::BaseKind::VIS_ITEM);
   HIR::VisItem &vis_item = static_cast<HIR::VisItem &> (item);
 
+  SelfProfileScope profile ("typecheck", item.get_mappings ().get_nodeid ());
   TypeCheckItem resolver;
   vis_item.accept_vis (resolver);
   return resolver.infered;
@@ -59,6 +61,8 @@ TypeCheckItem::Resolve (HIR::Item &item)
 TyTy::BaseType *
 TypeCheckItem::ResolveImplItem (HIR::ImplBlock &impl_block, HIR::ImplItem &item)
 {
+  SelfProfileScope profile ("typecheck",
+			    item.get_impl_mappings ().get_nodeid ());
   TypeCheckItem resolver;
   return resolver.resolve_impl_item (impl_block, item);
 }
@@ -347,13 +351,18 @@ TypeCheckItem::visit (HIR::Enum &enum_decl)
     = mappings.lookup_canonical_path (enum_decl.get_mappings ().get_nodeid ());
   RustIdent ident{*canonical_path, enum_decl.get_locus ()};
 
+  // Process #[repr(X)] attribute, if any
+  const AST::AttrVec &attrs = enum_decl.get_outer_attrs ();
+  TyTy::ADTType::ReprOptions repr
+    = parse_repr_options (attrs, enum_decl.get_locus ());
+
   // multi variant ADT
   auto *type
     = new TyTy::ADTType (enum_decl.get_mappings ().get_hirid (),
 			 mappings.get_next_hir_id (),
 			 enum_decl.get_identifier ().as_string (), ident,
 			 TyTy::ADTType::ADTKind::ENUM, std::move (variants),
-			 std::move (substitutions));
+			 std::move (substitutions), repr);
 
   context->insert_type (enum_decl.get_mappings (), type);
   infered = type;
@@ -278,6 +278,14 @@ TypeCheckExpr::resolve_root_path (HIR::PathInExpression &expr, size_t *offset,
 	  return root_tyty;
 	}
 
+      // a const generic parameter is a value of its declared type
+      if (lookup->get_kind () == TyTy::TypeKind::PARAM)
+	{
+	  auto param = static_cast<TyTy::ParamType *> (lookup);
+	  if (param->is_const_param ())
+	    lookup = param->get_const_value_type ();
+	}
+
       // is it an enum item?
       std::pair<HIR::Enum *, HIR::EnumItem *> enum_item_lookup
 	= mappings.lookup_hir_enumitem (ref);
@@ -101,7 +101,8 @@ TypeCheckType::visit (HIR::BareFunctionType &fntype)
 
   translated = new TyTy::FnPtr (fntype.get_mappings ().get_hirid (),
 				fntype.get_locus (), std::move (params),
-				TyTy::TyVar (return_type->get_ref ()));
+				TyTy::TyVar (return_type->get_ref ()),
+				fntype.get_function_qualifiers ().get_abi ());
 }
 
 void
@@ -675,11 +676,17 @@ TypeCheckType::visit (HIR::ArrayType &type)
 				    type.get_size_expr ()->get_locus ()),
 	      type.get_size_expr ()->get_locus ());
 
+  // the length is part of the type when it can be evaluated
+  tl::optional<TyTy::TyVar> capacity = tl::nullopt;
+  auto value = evaluate_const_value (*type.get_size_expr (), expected_ty);
+  if (value != nullptr)
+    capacity = TyTy::TyVar (value->get_ref ());
+
   TyTy::BaseType *base
     = TypeCheckType::Resolve (type.get_element_type ().get ());
   translated = new TyTy::ArrayType (type.get_mappings ().get_hirid (),
 				    type.get_locus (), *type.get_size_expr (),
-				    TyTy::TyVar (base->get_ref ()));
+				    TyTy::TyVar (base->get_ref ()), capacity);
 }
 
 void
@@ -766,7 +773,23 @@ TypeResolveGenericParam::visit (HIR::LifetimeParam &param)
 void
 TypeResolveGenericParam::visit (HIR::ConstGenericParam &param)
 {
-  // TODO
+  auto specified_type = TypeCheckType::Resolve (param.get_type ().get ());
+  if (param.has_default_expression ())
+    {
+      auto expr_type
+	= TypeCheckExpr::Resolve (param.get_default_expression ().get ());
+
+      coercion_site (param.get_mappings ().get_hirid (),
+		     TyTy::TyWithLocation (specified_type),
+		     TyTy::TyWithLocation (
+		       expr_type, param.get_default_expression ()->get_locus ()),
+		     param.get_locus ());
+    }
+
+  // a const param is substituted like a type param, its arguments are
+  // ConstTypes holding the values of the instance
+  resolved = new TyTy::ParamType (param.get_name (), param.get_locus (),
+				  param.get_mappings ().get_hirid (), param, {});
 }
 
 void
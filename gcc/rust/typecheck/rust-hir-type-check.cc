@@ -39,30 +39,31 @@ TypeCheckContext::LifetimeResolver::resolve (const Lifetime &placeholder) const
   if (placeholder == Lifetime::anonymous_lifetime ())
     return TyTy::Region::make_anonymous ();
 
-  for (auto it = lifetime_lookup.rbegin (); it != lifetime_lookup.rend (); ++it)
+  uint32_t index = placeholder.get_index ();
+  if (index >= lifetime_lookup.size () || !lifetime_lookup[index])
+    return tl::nullopt;
+
+  const LifetimeBinderRef &binder = lifetime_lookup[index].value ();
+  if (binder.scope <= ITEM_SCOPE)
     {
-      if (it->first == placeholder)
-	{
-	  if (it->second.scope <= ITEM_SCOPE)
-	    {
-	      // It is useful to have the static lifetime and named
-	      // lifetimed disjoint so we add the +1 here.
-	      return (is_body)
-		       ? TyTy::Region::make_named (it->second.index + 1)
-		       : TyTy::Region::make_early_bound (it->second.index);
-	    }
-	  else
-	    {
-	      return TyTy::Region::make_late_bound (get_current_scope ()
-						      - it->second.scope,
-						    it->second.index);
-	    }
-	}
+      // It is useful to have the static lifetime and named
+      // lifetimed disjoint so we add the +1 here.
+      return (is_body) ? TyTy::Region::make_named (binder.index + 1)
+		       : TyTy::Region::make_early_bound (binder.index);
+    }
+  else
+    {
+      return TyTy::Region::make_late_bound (get_current_scope ()
+					      - binder.scope,
+					    binder.index);
     }
-
-  return tl::nullopt;
 }
 
+/* Each function body is checked right after its signature, in item order, on
+   the single TypeCheckContext. Bodies are not checked concurrently: the
+   context, the mappings, the impl index and the diagnostics machinery would
+   all have to be safe to use from several threads first.  */
+
 void
 TypeResolution::Resolve (HIR::Crate &crate)
 {
@@ -72,12 +73,23 @@ TypeResolution::Resolve (HIR::Crate &crate)
   if (saw_errors ())
     return;
 
+  Finish ();
+}
+
+void
+TypeResolution::Finish ()
+{
   OverlappingImplItemPass::go ();
   if (saw_errors ())
     return;
 
-  auto context = TypeCheckContext::get ();
-  context->compute_inference_variables (true);
+  TypeCheckContext::get ()->compute_inference_variables (true);
+}
+
+void
+TypeResolution::FinishLazy ()
+{
+  TypeCheckContext::get ()->compute_inference_variables (true);
 }
 
 // rust-hir-trait-ref.h
@@ -89,13 +101,14 @@ TraitItemReference::TraitItemReference (
   : identifier (identifier), optional_flag (optional), type (type),
     hir_trait_item (hir_trait_item),
     inherited_substitutions (std::move (substitutions)), locus (locus),
-    self (self), context (TypeCheckContext::get ())
+    self (self), context (TypeCheckContext::get ()), resolved_tyty (nullptr)
 {}
 
 TraitItemReference::TraitItemReference (TraitItemReference const &other)
   : identifier (other.identifier), optional_flag (other.optional_flag),
     type (other.type), hir_trait_item (other.hir_trait_item),
-    locus (other.locus), self (other.self), context (TypeCheckContext::get ())
+    locus (other.locus), self (other.self), context (TypeCheckContext::get ()),
+    resolved_tyty (nullptr)
 {
   inherited_substitutions.clear ();
   inherited_substitutions.reserve (other.inherited_substitutions.size ());
@@ -114,6 +127,7 @@ TraitItemReference::operator= (TraitItemReference const &other)
   self = other.self;
   locus = other.locus;
   context = other.context;
+  resolved_tyty = nullptr;
 
   inherited_substitutions.clear ();
   inherited_substitutions.reserve (other.inherited_substitutions.size ());
@@ -25,6 +25,7 @@
 #include "rust-autoderef.h"
 #include "rust-tyty-region.h"
 #include "rust-tyty-variance-analysis.h"
+#include "rust-dense-id-map.h"
 #include "rust-system.h"
 
 namespace Rust {
@@ -82,6 +83,30 @@ private:
   Item item;
 };
 
+/**
+ * The adjustments of every expression that needs any, by HirId. Most of
+ * these vectors only hold one or two adjustments, so they are all kept in
+ * one pool rather than each in its own allocation.
+ */
+class AdjustmentTable
+{
+public:
+  // The first adjustments inserted for an expression are the ones kept
+  void insert (HirId id, std::vector<Adjustment> &&adjustments);
+  tl::optional<AdjustmentSpan> lookup (HirId id);
+  void clear ();
+
+private:
+  struct Range
+  {
+    uint32_t offset;
+    uint32_t count;
+  };
+
+  DenseIdMap<Range> ranges;
+  std::vector<Adjustment> pool;
+};
+
 /**
  * Interned lifetime representation in TyTy
  *
@@ -100,6 +125,8 @@ public:
 
   WARN_UNUSED_RESULT bool is_static () const { return interner_index == 0; }
 
+  uint32_t get_index () const { return interner_index; }
+
   WARN_UNUSED_RESULT static constexpr Lifetime static_lifetime ()
   {
     return Lifetime (0);
@@ -144,6 +171,23 @@ public:
 
   void insert_implicit_type (HirId id, TyTy::BaseType *type);
 
+  /* Speculative type checking. While a snapshot is open, changes to the
+   * inference tables are logged so that rolling back to the snapshot can undo
+   * them in place, in reverse order. Snapshots nest, the changes made under
+   * an inner snapshot which gets committed stay in the log of the outer
+   * one.
+   *
+   * This makes rolling back exact, not cheaper: only the changes made in
+   * place are logged, and the unifier, the coercion rules and the autoderef
+   * probing still build their results from clones of the types they try,
+   * which a rolled back trial drops. Trials which mutate in place would need
+   * the inference variables to become a union-find over the TyTy types. */
+  size_t snapshot ();
+  void rollback_to (size_t snapshot);
+  void commit_snapshot (size_t snapshot);
+  bool in_snapshot () const { return snapshot_depth > 0; }
+  void record_undo (std::function<void ()> undo);
+
   void insert_type_by_node_id (NodeId ref, HirId id);
   bool lookup_type_by_node_id (NodeId ref, HirId *id);
 
@@ -155,6 +199,14 @@ public:
   void pop_return_type ();
   void iterate (std::function<bool (HirId, TyTy::BaseType *)> cb);
 
+  // Print the number of types by kind to stderr, for -frust-mem-report
+  void dump_memory_report ();
+
+  /* Drop the types and adjustments recorded for each HirId, once the crate
+   * has been compiled to GENERIC. The TyTy nodes themselves are not owned by
+   * the context and are not freed. */
+  void release ();
+
   bool have_loop_context () const;
   void push_new_loop_context (HirId id, location_t locus);
   void push_new_while_loop_context (HirId id);
@@ -191,13 +243,11 @@ public:
 
   void insert_autoderef_mappings (HirId id,
 				  std::vector<Adjustment> &&adjustments);
-  bool lookup_autoderef_mappings (HirId id,
-				  std::vector<Adjustment> **adjustments);
+  tl::optional<AdjustmentSpan> lookup_autoderef_mappings (HirId id);
 
   void insert_cast_autoderef_mappings (HirId id,
 				       std::vector<Adjustment> &&adjustments);
-  bool lookup_cast_autoderef_mappings (HirId id,
-				       std::vector<Adjustment> **adjustments);
+  tl::optional<AdjustmentSpan> lookup_cast_autoderef_mappings (HirId id);
 
   void insert_variant_definition (HirId id, HirId variant);
   bool lookup_variant_definition (HirId id, HirId *variant);
@@ -208,6 +258,19 @@ public:
   void insert_unconstrained_check_marker (HirId id, bool status);
   bool have_checked_for_unconstrained (HirId id, bool *result);
 
+  // The Deref or DerefMut method of an interned type, or nullptr when it has
+  // none, with the adjustment of the receiver it needs. Every autoderef step
+  // through the type looks it up.
+  struct DerefImpl
+  {
+    TyTy::FnType *fn;
+    Adjustment::AdjustmentType requires_ref_adjustment;
+  };
+  void insert_deref_impl (const TyTy::BaseType *interned, LangItem::Kind kind,
+			  DerefImpl impl);
+  bool lookup_deref_impl (const TyTy::BaseType *interned, LangItem::Kind kind,
+			  DerefImpl *impl) const;
+
   void insert_resolved_predicate (HirId id, TyTy::TypeBoundPredicate predicate);
   bool lookup_predicate (HirId id, TyTy::TypeBoundPredicate *result);
 
@@ -238,14 +301,19 @@ public:
 private:
   TypeCheckContext ();
 
-  std::map<NodeId, HirId> node_id_refs;
-  std::map<HirId, TyTy::BaseType *> resolved;
+  void record_resolved (HirId id);
+  void record_node_id_ref (NodeId ref);
+
+  DenseIdMap<HirId> node_id_refs;
+  DenseIdMap<TyTy::BaseType *> resolved;
+  std::vector<std::function<void ()>> undo_log;
+  unsigned snapshot_depth = 0;
   std::vector<std::unique_ptr<TyTy::BaseType>> builtins;
   std::vector<std::pair<TypeCheckContextItem, TyTy::BaseType *>>
     return_type_stack;
   std::vector<TyTy::BaseType *> loop_type_stack;
   std::map<DefId, TraitReference> trait_context;
-  std::map<HirId, TyTy::BaseType *> receiver_context;
+  DenseIdMap<TyTy::BaseType *> receiver_context;
   std::map<HirId, AssociatedImplTrait> associated_impl_traits;
 
   // trait-id -> list of < self-tyty:impl-id>
@@ -255,17 +323,20 @@ private:
   std::map<HirId, HirId> associated_type_mappings;
 
   // adjustment mappings
-  std::map<HirId, std::vector<Adjustment>> autoderef_mappings;
-  std::map<HirId, std::vector<Adjustment>> cast_autoderef_mappings;
+  AdjustmentTable autoderef_mappings;
+  AdjustmentTable cast_autoderef_mappings;
 
   // operator overloads
-  std::map<HirId, TyTy::FnType *> operator_overloads;
+  DenseIdMap<TyTy::FnType *> operator_overloads;
 
   // variants
-  std::map<HirId, HirId> variants;
+  DenseIdMap<HirId> variants;
 
   // unconstrained type-params check
-  std::map<HirId, bool> unconstrained;
+  DenseIdMap<bool> unconstrained;
+
+  std::map<std::pair<const TyTy::BaseType *, LangItem::Kind>, DerefImpl>
+    deref_impls;
 
   // predicates
   std::map<HirId, TyTy::TypeBoundPredicate> predicates;
@@ -309,15 +380,15 @@ private:
      *
      * Used to pop the correct number of lifetimes when leaving a scope.
      */
-    std::stack<uint32_t> binder_size_stack;
+    std::vector<uint32_t> binder_size_stack;
 
     /**
-     * Merged stack of all lifetimes declared in all scopes.
+     * The latest declaration of each lifetime, indexed by its interner index.
      *
-     * Use `binder_size_stack` to determine the number of lifetimes in each
-     * scope.
+     * The indices of the named lifetimes are dense, one per distinct name in
+     * the crate, so resolving a lifetime is a single lookup.
      */
-    std::vector<std::pair<Lifetime, LifetimeBinderRef>> lifetime_lookup;
+    std::vector<tl::optional<LifetimeBinderRef>> lifetime_lookup;
 
     /**
      * Whether the current scope is a function body.
@@ -337,28 +408,39 @@ private:
     /** Add new declaration of a lifetime. */
     void insert_mapping (Lifetime placeholder)
     {
-      lifetime_lookup.push_back (
-	{placeholder, {get_current_scope (), binder_size_stack.top ()++}});
+      uint32_t index = placeholder.get_index ();
+      if (index >= lifetime_lookup.size ())
+	lifetime_lookup.resize (index + 1);
+      lifetime_lookup[index]
+	= LifetimeBinderRef{get_current_scope (), binder_size_stack.back ()++};
     }
 
     WARN_UNUSED_RESULT tl::optional<TyTy::Region>
     resolve (const Lifetime &placeholder) const;
 
     /** Only to be used by the guard. */
-    void push_binder () { binder_size_stack.push (0); }
+    void push_binder () { binder_size_stack.push_back (0); }
     /** Only to be used by the guard. */
-    void pop_binder () { binder_size_stack.pop (); }
+    void pop_binder () { binder_size_stack.pop_back (); }
+
+    /** Forget every declaration, keeping the storage for the next use. */
+    void reset ()
+    {
+      binder_size_stack.clear ();
+      lifetime_lookup.clear ();
+      is_body = false;
+    }
 
     /**
      * Switch from resolving a function header to a function body.
      */
     void switch_to_fn_body () { this->is_body = true; }
 
-    size_t get_num_bound_regions () const { return binder_size_stack.top (); }
+    size_t get_num_bound_regions () const { return binder_size_stack.back (); }
   };
 
-  // lifetime resolving
-  std::unordered_map<std::string, Lifetime> lifetime_name_interner;
+  // lifetime resolving, keyed by the symbol of the lifetime name
+  DenseIdMap<Lifetime> lifetime_name_interner;
   Lifetime next_lifetime_index = Lifetime (Lifetime::FIRST_NAMED_LIFETIME);
 
   /**
@@ -367,20 +449,40 @@ private:
    * Due to the contruction of the type checker, it is possible to start
    * resolution of a new type in the middle of resolving another type. This
    * stack isolates the conexts in such cases.
+   *
+   * The resolvers above LIFETIME_RESOLVER_DEPTH are popped ones kept for
+   * reuse, a resolver is pushed for every item and would otherwise allocate
+   * its tables each time.
    */
-  std::stack<LifetimeResolver> lifetime_resolver_stack;
+  std::vector<LifetimeResolver> lifetime_resolver_stack;
+  size_t lifetime_resolver_depth = 0;
+
+  void push_lifetime_resolver ()
+  {
+    if (lifetime_resolver_depth == lifetime_resolver_stack.size ())
+      lifetime_resolver_stack.emplace_back ();
+    else
+      lifetime_resolver_stack[lifetime_resolver_depth].reset ();
+    lifetime_resolver_depth++;
+  }
+
+  void pop_lifetime_resolver ()
+  {
+    rust_assert (lifetime_resolver_depth > 0);
+    lifetime_resolver_depth--;
+  }
 
 public:
   WARN_UNUSED_RESULT LifetimeResolver &get_lifetime_resolver ()
   {
-    rust_assert (!lifetime_resolver_stack.empty ());
-    return lifetime_resolver_stack.top ();
+    rust_assert (lifetime_resolver_depth > 0);
+    return lifetime_resolver_stack[lifetime_resolver_depth - 1];
   }
 
   WARN_UNUSED_RESULT const LifetimeResolver &get_lifetime_resolver () const
   {
-    rust_assert (!lifetime_resolver_stack.empty ());
-    return lifetime_resolver_stack.top ();
+    rust_assert (lifetime_resolver_depth > 0);
+    return lifetime_resolver_stack[lifetime_resolver_depth - 1];
   }
 
   /**
@@ -408,26 +510,24 @@ public:
     {
       if (kind == IMPL_BLOCK_RESOLVER)
 	{
-	  ctx.lifetime_resolver_stack.push (LifetimeResolver ());
+	  ctx.push_lifetime_resolver ();
 	}
 
       if (kind == RESOLVER)
 	{
-	  ctx.lifetime_resolver_stack.push (LifetimeResolver ());
+	  ctx.push_lifetime_resolver ();
 	  // Skip the `impl` block scope.
-	  ctx.lifetime_resolver_stack.top ().push_binder ();
+	  ctx.get_lifetime_resolver ().push_binder ();
 	}
-      rust_assert (!ctx.lifetime_resolver_stack.empty ());
-      ctx.lifetime_resolver_stack.top ().push_binder ();
+      ctx.get_lifetime_resolver ().push_binder ();
     }
 
     ~LifetimeResolverGuard ()
     {
-      rust_assert (!ctx.lifetime_resolver_stack.empty ());
-      ctx.lifetime_resolver_stack.top ().pop_binder ();
+      ctx.get_lifetime_resolver ().pop_binder ();
       if (kind == RESOLVER)
 	{
-	  ctx.lifetime_resolver_stack.pop ();
+	  ctx.pop_lifetime_resolver ();
 	}
     }
   };
@@ -451,7 +551,7 @@ public:
   /** Switch from resolving a function header to a function body. */
   void switch_to_fn_body ()
   {
-    this->lifetime_resolver_stack.top ().switch_to_fn_body ();
+    get_lifetime_resolver ().switch_to_fn_body ();
   }
 };
 
@@ -459,6 +559,13 @@ class TypeResolution
 {
 public:
   static void Resolve (HIR::Crate &crate);
+
+  // The crate-wide checks run once the items are type checked.
+  static void Finish ();
+
+  // What is left of them for a crate whose items are only type checked on
+  // demand: its impls were checked for overlaps when it was compiled.
+  static void FinishLazy ();
 };
 
 class TraitQueryGuard
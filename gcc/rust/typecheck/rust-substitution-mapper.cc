@@ -342,6 +342,11 @@ SubstMapperInternal::visit (TyTy::DynamicObjectType &type)
 {
   resolved = type.clone ();
 }
+void
+SubstMapperInternal::visit (TyTy::ConstType &type)
+{
+  resolved = type.clone ();
+}
 
 // SubstMapperFromExisting
 
@@ -26,6 +26,9 @@
 #include "rust-unify.h"
 #include "rust-coercion.h"
 #include "rust-hir-type-bounds.h"
+#include "rust-hir-type-check-expr.h"
+#include "rust-immutable-name-resolution-context.h"
+#include "options.h"
 
 namespace Rust {
 namespace Resolver {
@@ -156,6 +159,10 @@ unify_site_and (HirId id, TyTy::TyWithLocation lhs, TyTy::TyWithLocation rhs,
     commit_if_ok ? "true" : "false", implicit_infer_vars ? "true" : "false", id,
     expected->debug_str ().c_str (), expr->debug_str ().c_str ());
 
+  // anything the trial changes in place gets logged, so that it can be undone
+  // without having to track every change here
+  auto snapshot = context.snapshot ();
+
   std::vector<UnifyRules::CommitSite> commits;
   std::vector<UnifyRules::InferenceSite> infers;
   TyTy::BaseType *result
@@ -164,6 +171,7 @@ unify_site_and (HirId id, TyTy::TyWithLocation lhs, TyTy::TyWithLocation rhs,
   bool ok = result->get_kind () != TyTy::TypeKind::ERROR;
   if (ok && commit_if_ok)
     {
+      context.commit_snapshot (snapshot);
       for (auto &c : commits)
 	{
 	  UnifyRules::commit (c.lhs, c.rhs, c.resolved);
@@ -174,15 +182,15 @@ unify_site_and (HirId id, TyTy::TyWithLocation lhs, TyTy::TyWithLocation rhs,
       // FIXME
       // reset the get_next_hir_id
 
+      // this restores the params and drops the implicit inference
+      // variables, along with any type hint the trial applied
+      context.rollback_to (snapshot);
       for (auto &i : infers)
-	{
-	  i.param->set_ref (i.pref);
-	  i.param->set_ty_ref (i.ptyref);
-
-	  // remove the inference variable
-	  context.clear_type (i.infer);
-	  delete i.infer;
-	}
+	delete i.infer;
+    }
+  else
+    {
+      context.commit_snapshot (snapshot);
     }
   return result;
 }
@@ -381,5 +389,273 @@ lookup_associated_impl_block (const TyTy::TypeBoundPredicate &bound,
   return associate_impl_trait;
 }
 
+static bool
+implements_drop (const TyTy::BaseType *ty)
+{
+  auto &mappings = Analysis::Mappings::get ();
+  auto drop = mappings.lookup_lang_item (LangItem::Kind::DROP);
+  if (!drop)
+    return false;
+
+  for (auto &bound : TypeBoundsProbe::Probe (ty))
+    if (bound.first->get_defid () == drop.value ())
+      return true;
+
+  return false;
+}
+
+static bool
+type_needs_drop (const TyTy::BaseType *ty, std::set<HirId> &visiting)
+{
+  ty = ty->destructure ();
+  switch (ty->get_kind ())
+    {
+    case TyTy::BOOL:
+    case TyTy::CHAR:
+    case TyTy::INT:
+    case TyTy::UINT:
+    case TyTy::FLOAT:
+    case TyTy::USIZE:
+    case TyTy::ISIZE:
+    case TyTy::NEVER:
+    case TyTy::STR:
+    case TyTy::REF:
+    case TyTy::POINTER:
+    case TyTy::FNDEF:
+    case TyTy::FNPTR:
+    case TyTy::CONST:
+      return false;
+
+      case TyTy::TUPLE: {
+	for (auto &field : ty->as<const TyTy::TupleType> ()->get_fields ())
+	  if (type_needs_drop (field.get_tyty (), visiting))
+	    return true;
+	return false;
+      }
+
+    case TyTy::ARRAY:
+      return type_needs_drop (
+	ty->as<const TyTy::ArrayType> ()->get_element_type (), visiting);
+
+    case TyTy::SLICE:
+      return type_needs_drop (
+	ty->as<const TyTy::SliceType> ()->get_element_type (), visiting);
+
+      case TyTy::ADT: {
+	if (implements_drop (ty))
+	  return true;
+
+	// a type which contains itself does so through an indirection, which
+	// decides on its own whether it needs to be dropped
+	if (!visiting.insert (ty->get_ref ()).second)
+	  return false;
+
+	bool needs_drop = false;
+	auto adt = ty->as<const TyTy::ADTType> ();
+	for (auto variant : adt->get_variants ())
+	  for (auto field : variant->get_fields ())
+	    needs_drop = needs_drop
+			 || type_needs_drop (field->get_field_type (), visiting);
+
+	visiting.erase (ty->get_ref ());
+	return needs_drop;
+      }
+
+    case TyTy::CLOSURE:
+      // the types of the captures are not recorded in the closure type
+      return !ty->as<const TyTy::ClosureType> ()->get_captures ().empty ();
+
+    case TyTy::DYNAMIC:
+    case TyTy::PARAM:
+    case TyTy::PROJECTION:
+    case TyTy::PLACEHOLDER:
+    case TyTy::INFER:
+    case TyTy::ERROR:
+      return true;
+    }
+
+  rust_unreachable ();
+}
+
+bool
+type_needs_drop (const TyTy::BaseType *ty)
+{
+  std::set<HirId> visiting;
+  return type_needs_drop (ty, visiting);
+}
+
+// The definition a single segment path refers to, for the const values
+static tl::optional<HirId>
+lookup_path_definition (HIR::PathInExpression &path)
+{
+  if (path.get_segments ().size () != 1)
+    return tl::nullopt;
+
+  NodeId ref_node_id = UNKNOWN_NODEID;
+  if (flag_name_resolution_2_0)
+    {
+      auto nr_ctx
+	= Resolver2_0::ImmutableNameResolutionContext::get ().resolver ();
+      nr_ctx.lookup (path.get_mappings ().get_nodeid ())
+	.map ([&ref_node_id] (NodeId resolved) { ref_node_id = resolved; });
+    }
+  else
+    {
+      auto resolver = Resolver::get ();
+      NodeId seg = path.get_segments ().front ().get_mappings ().get_nodeid ();
+      if (!resolver->lookup_resolved_name (seg, &ref_node_id))
+	resolver->lookup_resolved_type (seg, &ref_node_id);
+    }
+
+  if (ref_node_id == UNKNOWN_NODEID)
+    return tl::nullopt;
+
+  return Analysis::Mappings::get ().lookup_node_to_hir (ref_node_id);
+}
+
+// Literals are lexed to decimal strings already, without separators
+static std::string
+normalize_integer (const std::string &digits)
+{
+  std::string value;
+  for (char c : digits)
+    if (c != '_')
+      value += c;
+
+  size_t first = value.find_first_not_of ('0');
+  if (first == std::string::npos)
+    return "0";
+  return value.substr (first);
+}
+
+static TyTy::BaseType *
+evaluate_const (HIR::Expr &expr, TyTy::BaseType *value_type, unsigned depth)
+{
+  // a constant defined in terms of itself has been reported already
+  if (depth > 64)
+    return nullptr;
+
+  auto &mappings = Analysis::Mappings::get ();
+  auto context = TypeCheckContext::get ();
+  auto make_value = [&] (std::string value) -> TyTy::BaseType * {
+    HirId id = mappings.get_next_hir_id ();
+    auto value_ty
+      = new TyTy::ConstType (id, expr.get_locus (),
+			     TyTy::TyVar (value_type->get_ref ()), value);
+    context->insert_implicit_type (id, value_ty);
+    return value_ty;
+  };
+
+  switch (expr.get_expression_type ())
+    {
+      case HIR::Expr::ExprType::Lit: {
+	auto &literal = static_cast<HIR::LiteralExpr &> (expr).get_literal ();
+	switch (literal.get_lit_type ())
+	  {
+	  case HIR::Literal::INT:
+	    return make_value (normalize_integer (literal.as_string ()));
+	  case HIR::Literal::BOOL:
+	    return make_value (literal.as_string () == "true" ? "1" : "0");
+	  default:
+	    return nullptr;
+	  }
+      }
+
+      case HIR::Expr::ExprType::Operator: {
+	auto negation = dynamic_cast<HIR::NegationExpr *> (&expr);
+	if (negation == nullptr)
+	  return nullptr;
+
+	auto operand
+	  = evaluate_const (*negation->get_expr (), value_type, depth + 1);
+	if (operand == nullptr || operand->get_kind () != TyTy::CONST)
+	  return nullptr;
+
+	std::string value = operand->as<TyTy::ConstType> ()->get_value ();
+	if (negation->get_expr_type () == NegationOperator::NOT)
+	  {
+	    if (value_type->get_kind () != TyTy::BOOL)
+	      return nullptr;
+	    return make_value (value == "0" ? "1" : "0");
+	  }
+
+	if (value == "0")
+	  return make_value (value);
+	if (value[0] == '-')
+	  return make_value (value.substr (1));
+	return make_value ("-" + value);
+      }
+
+    case HIR::Expr::ExprType::Grouped:
+      return evaluate_const_value (
+	*static_cast<HIR::GroupedExpr &> (expr).get_expr_in_parens (),
+	value_type, depth + 1);
+
+      case HIR::Expr::ExprType::Block: {
+	auto &block = static_cast<HIR::BlockExpr &> (expr);
+	if (block.has_statements () || !block.has_expr ())
+	  return nullptr;
+
+	return evaluate_const (*block.get_final_expr (), value_type,
+				     depth + 1);
+      }
+
+      case HIR::Expr::ExprType::Path: {
+	auto path = dynamic_cast<HIR::PathInExpression *> (&expr);
+	if (path == nullptr)
+	  return nullptr;
+
+	auto definition = lookup_path_definition (*path);
+	if (!definition)
+	  return nullptr;
+
+	// a const generic parameter of the enclosing item
+	auto param = mappings.lookup_hir_generic_param (definition.value ());
+	if (param
+	    && param.value ()->get_kind ()
+		 == HIR::GenericParam::GenericKind::CONST)
+	  {
+	    TyTy::BaseType *lookup = nullptr;
+	    if (!context->lookup_type (definition.value (), &lookup))
+	      return nullptr;
+	    return lookup;
+	  }
+
+	auto item = mappings.lookup_hir_item (definition.value ());
+	if (!item
+	    || item.value ()->get_item_kind () != HIR::Item::ItemKind::Constant)
+	  return nullptr;
+
+	auto constant = static_cast<HIR::ConstantItem *> (item.value ());
+	return evaluate_const (*constant->get_expr (), value_type,
+				     depth + 1);
+      }
+
+    default:
+      return nullptr;
+    }
+}
+
+TyTy::BaseType *
+resolve_const_value (HIR::Expr &expr, TyTy::BaseType *value_type)
+{
+  TyTy::BaseType *expr_type = TypeCheckExpr::Resolve (&expr);
+  TyTy::BaseType *coerced
+    = coercion_site (expr.get_mappings ().get_hirid (),
+		     TyTy::TyWithLocation (value_type),
+		     TyTy::TyWithLocation (expr_type, expr.get_locus ()),
+		     expr.get_locus ());
+  if (coerced->get_kind () == TyTy::ERROR)
+    return nullptr;
+
+  return evaluate_const_value (expr, value_type);
+}
+
+TyTy::BaseType *
+evaluate_const_value (HIR::Expr &expr, TyTy::BaseType *value_type)
+{
+  return evaluate_const (expr, value_type, 0);
+}
+
 } // namespace Resolver
 } // namespace Rust
@@ -58,6 +58,23 @@ lookup_associated_impl_block (const TyTy::TypeBoundPredicate &bound,
 			      const TyTy::BaseType *binding,
 			      bool *ambigious = nullptr);
 
+// Whether dropping a value of type TY runs any code, either because it
+// implements the `drop` lang item or because one of its components does.
+// Types which are not known yet are assumed to need it.
+bool
+type_needs_drop (const TyTy::BaseType *ty);
+
+// Type checks EXPR, a const generic argument or an array length, against
+// VALUE_TYPE and evaluates it. The result is a ConstType holding its value,
+// the ParamType of the const generic parameter it names inside a generic
+// item, or nullptr when it is not a value we know how to evaluate yet.
+TyTy::BaseType *
+resolve_const_value (HIR::Expr &expr, TyTy::BaseType *value_type);
+
+// The same for an expression which was type checked already
+TyTy::BaseType *
+evaluate_const_value (HIR::Expr &expr, TyTy::BaseType *value_type);
+
 } // namespace Resolver
 } // namespace Rust
 
@@ -18,6 +18,7 @@
 
 #include "rust-hir-type-check.h"
 #include "rust-type-util.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace Resolver {
@@ -25,29 +26,57 @@ namespace Resolver {
 TypeCheckContext *
 TypeCheckContext::get ()
 {
-  static TypeCheckContext *instance;
+  auto &instance = ThreadState::current ().typecheck;
   if (instance == nullptr)
     instance = new TypeCheckContext ();
 
   return instance;
 }
 
-TypeCheckContext::TypeCheckContext () { lifetime_resolver_stack.emplace (); }
+void
+AdjustmentTable::insert (HirId id, std::vector<Adjustment> &&adjustments)
+{
+  if (ranges.lookup (id))
+    return;
+
+  Range range = {static_cast<uint32_t> (pool.size ()),
+		 static_cast<uint32_t> (adjustments.size ())};
+  pool.insert (pool.end (), std::make_move_iterator (adjustments.begin ()),
+	       std::make_move_iterator (adjustments.end ()));
+  ranges.insert (id, range);
+}
+
+tl::optional<AdjustmentSpan>
+AdjustmentTable::lookup (HirId id)
+{
+  return ranges.lookup (id).map ([this] (Range range) {
+    return AdjustmentSpan (pool.data () + range.offset, range.count);
+  });
+}
+
+void
+AdjustmentTable::clear ()
+{
+  ranges.clear ();
+  std::vector<Adjustment> ().swap (pool);
+}
+
+TypeCheckContext::TypeCheckContext () { push_lifetime_resolver (); }
 
 TypeCheckContext::~TypeCheckContext () {}
 
 bool
 TypeCheckContext::lookup_builtin (NodeId id, TyTy::BaseType **type)
 {
-  auto ref_it = node_id_refs.find (id);
-  if (ref_it == node_id_refs.end ())
+  auto ref = node_id_refs.lookup (id);
+  if (!ref)
     return false;
 
-  auto it = resolved.find (ref_it->second);
-  if (it == resolved.end ())
+  auto ty = resolved.lookup (ref.value ());
+  if (!ty)
     return false;
 
-  *type = it->second;
+  *type = ty.value ();
   return true;
 }
 
@@ -68,8 +97,8 @@ TypeCheckContext::lookup_builtin (std::string name, TyTy::BaseType **type)
 void
 TypeCheckContext::insert_builtin (HirId id, NodeId ref, TyTy::BaseType *type)
 {
-  node_id_refs[ref] = id;
-  resolved[id] = type;
+  node_id_refs.insert (ref, id);
+  resolved.insert (id, type);
   builtins.push_back (std::unique_ptr<TyTy::BaseType> (type));
 }
 
@@ -80,60 +109,137 @@ TypeCheckContext::insert_type (const Analysis::NodeMapping &mappings,
   rust_assert (type != nullptr);
   NodeId ref = mappings.get_nodeid ();
   HirId id = mappings.get_hirid ();
-  node_id_refs[ref] = id;
-  resolved[id] = type;
+  if (in_snapshot ())
+    {
+      record_node_id_ref (ref);
+      record_resolved (id);
+    }
+
+  node_id_refs.insert (ref, id);
+  resolved.insert (id, type);
 }
 
 void
 TypeCheckContext::insert_implicit_type (TyTy::BaseType *type)
 {
   rust_assert (type != nullptr);
-  resolved[type->get_ref ()] = type;
+  insert_implicit_type (type->get_ref (), type);
 }
 
 void
 TypeCheckContext::insert_implicit_type (HirId id, TyTy::BaseType *type)
 {
   rust_assert (type != nullptr);
-  resolved[id] = type;
+  if (in_snapshot ())
+    record_resolved (id);
+
+  resolved.insert (id, type);
+}
+
+size_t
+TypeCheckContext::snapshot ()
+{
+  snapshot_depth++;
+  return undo_log.size ();
+}
+
+void
+TypeCheckContext::rollback_to (size_t snapshot)
+{
+  rust_assert (snapshot_depth > 0 && snapshot <= undo_log.size ());
+
+  while (undo_log.size () > snapshot)
+    {
+      undo_log.back () ();
+      undo_log.pop_back ();
+    }
+
+  snapshot_depth--;
+}
+
+void
+TypeCheckContext::commit_snapshot (size_t snapshot)
+{
+  rust_assert (snapshot_depth > 0 && snapshot <= undo_log.size ());
+
+  snapshot_depth--;
+  if (snapshot_depth == 0)
+    undo_log.clear ();
+}
+
+void
+TypeCheckContext::record_undo (std::function<void ()> undo)
+{
+  if (in_snapshot ())
+    undo_log.push_back (std::move (undo));
+}
+
+void
+TypeCheckContext::record_resolved (HirId id)
+{
+  auto old = resolved.lookup (id);
+  if (!old)
+    {
+      record_undo ([this, id] () { resolved.erase (id); });
+      return;
+    }
+
+  TyTy::BaseType *ty = old.value ();
+  record_undo ([this, id, ty] () { resolved.insert (id, ty); });
+}
+
+void
+TypeCheckContext::record_node_id_ref (NodeId ref)
+{
+  auto old = node_id_refs.lookup (ref);
+  if (!old)
+    {
+      record_undo ([this, ref] () { node_id_refs.erase (ref); });
+      return;
+    }
+
+  HirId id = old.value ();
+  record_undo ([this, ref, id] () { node_id_refs.insert (ref, id); });
 }
 
 bool
 TypeCheckContext::lookup_type (HirId id, TyTy::BaseType **type) const
 {
-  auto it = resolved.find (id);
-  if (it == resolved.end ())
+  auto ty = resolved.lookup (id);
+  if (!ty)
     return false;
 
-  *type = it->second;
+  *type = ty.value ();
   return true;
 }
 
 void
 TypeCheckContext::clear_type (TyTy::BaseType *ty)
 {
-  auto it = resolved.find (ty->get_ref ());
-  if (it == resolved.end ())
+  if (!resolved.lookup (ty->get_ref ()))
     return;
 
-  resolved.erase (it);
+  if (in_snapshot ())
+    record_resolved (ty->get_ref ());
+
+  resolved.erase (ty->get_ref ());
 }
 
 void
 TypeCheckContext::insert_type_by_node_id (NodeId ref, HirId id)
 {
-  rust_assert (node_id_refs.find (ref) == node_id_refs.end ());
-  node_id_refs[ref] = id;
+  rust_assert (!node_id_refs.lookup (ref));
+  node_id_refs.insert (ref, id);
 }
 
 bool
 TypeCheckContext::lookup_type_by_node_id (NodeId ref, HirId *id)
 {
-  auto it = node_id_refs.find (ref);
-  if (it == node_id_refs.end ())
+  auto found = node_id_refs.lookup (ref);
+  if (!found)
     return false;
 
-  *id = it->second;
+  *id = found.value ();
   return true;
 }
 
@@ -174,11 +280,55 @@ TypeCheckContext::peek_context ()
 void
 TypeCheckContext::iterate (std::function<bool (HirId, TyTy::BaseType *)> cb)
 {
-  for (auto it = resolved.begin (); it != resolved.end (); it++)
-    {
-      if (!cb (it->first, it->second))
-	return;
-    }
+  resolved.iterate (
+    [&cb] (HirId id, TyTy::BaseType *&ty) { return cb (id, ty); });
+}
+
+void
+TypeCheckContext::release ()
+{
+  node_id_refs.clear ();
+  resolved.clear ();
+  receiver_context.clear ();
+  trait_context.clear ();
+  associated_impl_traits.clear ();
+  associated_traits_to_impls.clear ();
+  associated_type_mappings.clear ();
+  autoderef_mappings.clear ();
+  cast_autoderef_mappings.clear ();
+  operator_overloads.clear ();
+  variants.clear ();
+  unconstrained.clear ();
+  deref_impls.clear ();
+  predicates.clear ();
+}
+
+void
+TypeCheckContext::dump_memory_report ()
+{
+  // Many ids share the same type, so count each type once
+  std::unordered_set<const TyTy::BaseType *> seen;
+  std::map<TyTy::TypeKind, size_t> kinds;
+  resolved.iterate ([&] (HirId, TyTy::BaseType *&ty) {
+    if (seen.insert (ty).second)
+      kinds[ty->get_kind ()]++;
+    return true;
+  });
+
+  fprintf (stderr,
+	   "  %-28s %10" GCC_PRISZ "u entries %10" GCC_PRISZ "u bytes\n",
+	   "resolved types", (fmt_size_t) resolved.size (),
+	   (fmt_size_t) resolved.allocated_bytes ());
+  for (auto &kind : kinds)
+    fprintf (stderr, "    %-26s %10" GCC_PRISZ "u\n",
+	     TyTy::TypeKindFormat::to_string (kind.first).c_str (),
+	     (fmt_size_t) kind.second);
+  fprintf (stderr, "  %-28s %10" GCC_PRISZ "u\n", "receivers",
+	   (fmt_size_t) receiver_context.size ());
+  fprintf (stderr, "  %-28s %10" GCC_PRISZ "u\n", "operator overloads",
+	   (fmt_size_t) operator_overloads.size ());
+  fprintf (stderr, "  %-28s %10" GCC_PRISZ "u\n", "predicates",
+	   (fmt_size_t) predicates.size ());
 }
 
 bool
@@ -245,17 +395,17 @@ TypeCheckContext::lookup_trait_reference (DefId id, TraitReference **ref)
 void
 TypeCheckContext::insert_receiver (HirId id, TyTy::BaseType *t)
 {
-  receiver_context[id] = t;
+  receiver_context.insert (id, t);
 }
 
 bool
 TypeCheckContext::lookup_receiver (HirId id, TyTy::BaseType **ref)
 {
-  auto it = receiver_context.find (id);
-  if (it == receiver_context.end ())
+  auto receiver = receiver_context.lookup (id);
+  if (!receiver)
     return false;
 
-  *ref = it->second;
+  *ref = receiver.value ();
   return true;
 }
 
@@ -346,95 +496,98 @@ void
 TypeCheckContext::insert_autoderef_mappings (
   HirId id, std::vector<Adjustment> &&adjustments)
 {
-  autoderef_mappings.emplace (id, std::move (adjustments));
+  autoderef_mappings.insert (id, std::move (adjustments));
 }
 
-bool
-TypeCheckContext::lookup_autoderef_mappings (
-  HirId id, std::vector<Adjustment> **adjustments)
+tl::optional<AdjustmentSpan>
+TypeCheckContext::lookup_autoderef_mappings (HirId id)
 {
-  auto it = autoderef_mappings.find (id);
-  if (it == autoderef_mappings.end ())
-    return false;
-
-  *adjustments = &it->second;
-  return true;
+  return autoderef_mappings.lookup (id);
 }
 
 void
 TypeCheckContext::insert_cast_autoderef_mappings (
   HirId id, std::vector<Adjustment> &&adjustments)
 {
-  cast_autoderef_mappings.emplace (id, std::move (adjustments));
+  cast_autoderef_mappings.insert (id, std::move (adjustments));
 }
 
-bool
-TypeCheckContext::lookup_cast_autoderef_mappings (
-  HirId id, std::vector<Adjustment> **adjustments)
+tl::optional<AdjustmentSpan>
+TypeCheckContext::lookup_cast_autoderef_mappings (HirId id)
 {
-  auto it = cast_autoderef_mappings.find (id);
-  if (it == cast_autoderef_mappings.end ())
-    return false;
-
-  *adjustments = &it->second;
-  return true;
+  return cast_autoderef_mappings.lookup (id);
 }
 
 void
 TypeCheckContext::insert_variant_definition (HirId id, HirId variant)
 {
-  auto it = variants.find (id);
-  rust_assert (it == variants.end ());
-
-  variants[id] = variant;
+  rust_assert (!variants.lookup (id));
+  variants.insert (id, variant);
 }
 
 bool
 TypeCheckContext::lookup_variant_definition (HirId id, HirId *variant)
 {
-  auto it = variants.find (id);
-  if (it == variants.end ())
+  auto found = variants.lookup (id);
+  if (!found)
     return false;
 
-  *variant = it->second;
+  *variant = found.value ();
   return true;
 }
 
 void
 TypeCheckContext::insert_operator_overload (HirId id, TyTy::FnType *call_site)
 {
-  auto it = operator_overloads.find (id);
-  rust_assert (it == operator_overloads.end ());
-
-  operator_overloads[id] = call_site;
+  rust_assert (!operator_overloads.lookup (id));
+  operator_overloads.insert (id, call_site);
 }
 
 bool
 TypeCheckContext::lookup_operator_overload (HirId id, TyTy::FnType **call)
 {
-  auto it = operator_overloads.find (id);
-  if (it == operator_overloads.end ())
+  auto found = operator_overloads.lookup (id);
+  if (!found)
     return false;
 
-  *call = it->second;
+  *call = found.value ();
   return true;
 }
 
 void
 TypeCheckContext::insert_unconstrained_check_marker (HirId id, bool status)
 {
-  unconstrained[id] = status;
+  unconstrained.insert (id, status);
 }
 
 bool
 TypeCheckContext::have_checked_for_unconstrained (HirId id, bool *result)
 {
-  auto it = unconstrained.find (id);
-  bool found = it != unconstrained.end ();
+  auto found = unconstrained.lookup (id);
   if (!found)
     return false;
 
-  *result = it->second;
+  *result = found.value ();
+  return true;
+}
+
+void
+TypeCheckContext::insert_deref_impl (const TyTy::BaseType *interned,
+				     LangItem::Kind kind, DerefImpl impl)
+{
+  deref_impls[{interned, kind}] = impl;
+}
+
+bool
+TypeCheckContext::lookup_deref_impl (const TyTy::BaseType *interned,
+				     LangItem::Kind kind,
+				     DerefImpl *impl) const
+{
+  auto it = deref_impls.find ({interned, kind});
+  if (it == deref_impls.end ())
+    return false;
+
+  *impl = it->second;
   return true;
 }
 
@@ -507,7 +660,8 @@ TypeCheckContext::intern_lifetime (const HIR::Lifetime &lifetime)
 	return *maybe_interned;
 
       auto interned = next_lifetime_index.next ();
-      lifetime_name_interner[lifetime.get_name ()] = interned;
+      lifetime_name_interner.insert (lifetime.get_symbol ().get_id (),
+				     interned);
       return interned;
     }
   if (lifetime.get_lifetime_type () == AST::Lifetime::WILDCARD)
@@ -527,11 +681,7 @@ TypeCheckContext::lookup_lifetime (const HIR::Lifetime &lifetime) const
   if (lifetime.get_lifetime_type () == AST::Lifetime::NAMED)
     {
       rust_assert (lifetime.get_name () != "static");
-      const auto name = lifetime.get_name ();
-      auto it = lifetime_name_interner.find (name);
-      if (it == lifetime_name_interner.end ())
-	return tl::nullopt;
-      return it->second;
+      return lifetime_name_interner.lookup (lifetime.get_symbol ().get_id ());
     }
   if (lifetime.get_lifetime_type () == AST::Lifetime::WILDCARD)
     {
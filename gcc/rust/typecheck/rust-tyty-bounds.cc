@@ -20,6 +20,8 @@
 #include "rust-hir-trait-resolve.h"
 #include "rust-substitution-mapper.h"
 #include "rust-type-util.h"
+#include "rust-hir-impl-index.h"
+#include "rust-tyty-intern.h"
 
 namespace Rust {
 namespace Resolver {
@@ -28,11 +30,47 @@ TypeBoundsProbe::TypeBoundsProbe (const TyTy::BaseType *receiver)
   : TypeCheckBase (), receiver (receiver)
 {}
 
+TypeBoundsProbe::Cache &
+TypeBoundsProbe::get_cache ()
+{
+  static Cache cache;
+  return cache;
+}
+
 std::vector<std::pair<TraitReference *, HIR::ImplBlock *>>
 TypeBoundsProbe::Probe (const TyTy::BaseType *receiver)
 {
+  auto key = TyTy::TypeInterner::get ().intern (receiver);
+  if (key == nullptr)
+    {
+      TypeBoundsProbe probe (receiver);
+      probe.scan ();
+      return probe.trait_references;
+    }
+
+  auto &cache = get_cache ();
+  auto generation = ImplIndex::get ().get_generation ();
+  if (cache.generation != generation)
+    {
+      cache.results.clear ();
+      cache.generation = generation;
+    }
+
+  auto cached = cache.results.find (key);
+  if (cached != cache.results.end ())
+    {
+      cache.hits++;
+      return cached->second;
+    }
+
+  cache.misses++;
   TypeBoundsProbe probe (receiver);
   probe.scan ();
+
+  // scanning can resolve more impls, which makes the results stale already
+  if (ImplIndex::get ().get_generation () == generation)
+    cache.results.emplace (key, probe.trait_references);
+
   return probe.trait_references;
 }
 
@@ -64,26 +102,23 @@ TypeBoundsProbe::scan ()
 {
   std::vector<std::pair<HIR::TypePath *, HIR::ImplBlock *>>
     possible_trait_paths;
-  mappings.iterate_impl_blocks (
-    [&] (HirId id, HIR::ImplBlock *impl) mutable -> bool {
+  for (auto &candidate : ImplIndex::get ().get_candidates (receiver))
+    {
+      HIR::ImplBlock *impl = candidate.first;
+      TyTy::BaseType *impl_type = candidate.second;
+
       // we are filtering for trait-impl-blocks
       if (!impl->has_trait_ref ())
-	return true;
-
-      HirId impl_ty_id = impl->get_type ()->get_mappings ().get_hirid ();
-      TyTy::BaseType *impl_type = nullptr;
-      if (!query_type (impl_ty_id, &impl_type))
-	return true;
+	continue;
 
       if (!receiver->can_eq (impl_type, false))
 	{
 	  if (!impl_type->can_eq (receiver, false))
-	    return true;
+	    continue;
 	}
 
       possible_trait_paths.push_back ({impl->get_trait_ref ().get (), impl});
-      return true;
-    });
+    }
 
   for (auto &path : possible_trait_paths)
     {
@@ -144,6 +179,7 @@ TypeBoundsProbe::assemble_sized_builtin ()
       break;
 
     case TyTy::DYNAMIC:
+    case TyTy::CONST:
     case TyTy::ERROR:
       break;
     }
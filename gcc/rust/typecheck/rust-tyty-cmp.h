@@ -431,6 +431,22 @@ public:
       }
   }
 
+  virtual void visit (const ConstType &type) override
+  {
+    ok = false;
+    if (emit_error_flag)
+      {
+	location_t ref_locus = mappings.lookup_location (type.get_ref ());
+	location_t base_locus
+	  = mappings.lookup_location (get_base ()->get_ref ());
+	rich_location r (line_table, ref_locus);
+	r.add_range (base_locus);
+	rust_error_at (r, "expected [%s] got [%s]",
+		       get_base ()->as_string ().c_str (),
+		       type.as_string ().c_str ());
+      }
+  }
+
 protected:
   BaseCmp (const BaseType *base, bool emit_errors)
     : mappings (Analysis::Mappings::get ()),
@@ -706,6 +722,19 @@ public:
     BaseCmp::visit (type);
   }
 
+  void visit (const ConstType &type) override
+  {
+    bool is_valid
+      = (base->get_infer_kind () == TyTy::InferType::InferTypeKind::GENERAL);
+    if (is_valid)
+      {
+	ok = true;
+	return;
+      }
+
+    BaseCmp::visit (type);
+  }
+
 private:
   const BaseType *get_base () const override { return base; }
   const InferType *base;
@@ -915,6 +944,17 @@ public:
 	return;
       }
 
+    // and their lengths, when both are known
+    auto base_capacity = base->get_capacity ();
+    auto other_capacity = type.get_capacity ();
+    if (base_capacity && other_capacity
+	&& !base_capacity.value ()->can_eq (other_capacity.value (),
+					    emit_error_flag))
+      {
+	BaseCmp::visit (type);
+	return;
+      }
+
     ok = true;
   }
 
@@ -1417,6 +1457,8 @@ public:
 
   void visit (const DynamicObjectType &) override { ok = true; }
 
+  void visit (const ConstType &) override { ok = base->is_const_param (); }
+
   void visit (const PlaceholderType &type) override
   {
     ok = base->get_symbol ().compare (type.get_symbol ()) == 0;
@@ -1482,6 +1524,53 @@ private:
   const NeverType *base;
 };
 
+class ConstCmp : public BaseCmp
+{
+  using Rust::TyTy::BaseCmp::visit;
+
+public:
+  ConstCmp (const ConstType *base, bool emit_errors)
+    : BaseCmp (base, emit_errors), base (base)
+  {}
+
+  void visit (const ConstType &type) override
+  {
+    if (base->get_value () != type.get_value ())
+      {
+	BaseCmp::visit (type);
+	return;
+      }
+
+    ok = true;
+  }
+
+  void visit (const ParamType &type) override
+  {
+    if (!type.is_const_param ())
+      {
+	BaseCmp::visit (type);
+	return;
+      }
+
+    ok = true;
+  }
+
+  void visit (const InferType &type) override
+  {
+    if (type.get_infer_kind () != InferType::InferTypeKind::GENERAL)
+      {
+	BaseCmp::visit (type);
+	return;
+      }
+
+    ok = true;
+  }
+
+private:
+  const BaseType *get_base () const override { return base; }
+  const ConstType *base;
+};
+
 class PlaceholderCmp : public BaseCmp
 {
   using Rust::TyTy::BaseCmp::visit;
@@ -0,0 +1,57 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-tyty-intern.h"
+#include "rust-thread-state.h"
+
+namespace Rust {
+namespace TyTy {
+
+TypeInterner &
+TypeInterner::get ()
+{
+  auto &instance = ThreadState::current ().type_interner;
+  if (instance == nullptr)
+    instance = new TypeInterner ();
+
+  return *instance;
+}
+
+const BaseType *
+TypeInterner::intern (const BaseType *ty)
+{
+  auto key = TypeKey::make (ty);
+  if (!key)
+    return nullptr;
+
+  std::lock_guard<std::mutex> guard (mutex);
+  auto it = types.find (key.value ());
+  if (it != types.end ())
+    return it->second.get ();
+
+  // the stored key has to refer to the canonical copy, which lives as long
+  // as the map does
+  std::unique_ptr<BaseType> canonical (key->get_type ()->clone ());
+  const BaseType *result = canonical.get ();
+  types.emplace (TypeKey::make (result).value (), std::move (canonical));
+
+  return result;
+}
+
+} // namespace TyTy
+} // namespace Rust
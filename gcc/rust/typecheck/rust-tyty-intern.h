@@ -0,0 +1,61 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_TYTY_INTERN_H
+#define RUST_TYTY_INTERN_H
+
+#include "rust-system.h"
+#include "rust-tyty.h"
+#include "rust-tyty-key.h"
+
+namespace Rust {
+namespace TyTy {
+
+/**
+ * Hash-consing of fully resolved types. Every type the interner accepts maps
+ * to a single canonical copy, shared by all structurally identical types, so
+ * that code which needs to recognise the same type again and again can key on
+ * a pointer instead of comparing types deeply.
+ *
+ * TyTy types carry the HirIds they were created for and get mutated during
+ * inference, so the canonical copies are kept apart from them and never
+ * handed back as the type of a node. Types with inference variables, generics
+ * or anything else whose identity cannot be derived from its structure alone,
+ * such as functions, closures and arrays with their capacity expression, are
+ * not interned.
+ */
+class TypeInterner
+{
+public:
+  static TypeInterner &get ();
+
+  // The canonical copy of TY, or nullptr if TY cannot be interned
+  const BaseType *intern (const BaseType *ty);
+
+private:
+  TypeInterner () {}
+
+  std::unordered_map<TypeKey, std::unique_ptr<BaseType>, TypeKey::Hash> types;
+  // threads adopting the state of another one share its interner
+  std::mutex mutex;
+};
+
+} // namespace TyTy
+} // namespace Rust
+
+#endif // RUST_TYTY_INTERN_H
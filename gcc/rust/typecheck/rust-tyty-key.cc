@@ -0,0 +1,265 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-tyty-key.h"
+#include "selftest.h"
+
+namespace Rust {
+namespace TyTy {
+
+// recursive types would never end
+static const unsigned kMaxDepth = 8;
+
+static uint64_t
+mix (uint64_t hash, uint64_t value)
+{
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+// What tells apart the primitive types sharing a kind
+static uint64_t
+primitive_kind (const BaseType *ty)
+{
+  switch (ty->get_kind ())
+    {
+    case INT:
+      return static_cast<const IntType *> (ty)->get_int_kind ();
+    case UINT:
+      return static_cast<const UintType *> (ty)->get_uint_kind ();
+    case FLOAT:
+      return static_cast<const FloatType *> (ty)->get_float_kind ();
+    default:
+      return 0;
+    }
+}
+
+tl::optional<TypeKey>
+TypeKey::make (const BaseType *ty)
+{
+  ty = ty->destructure ();
+  auto hash = hash_of (ty, 0);
+  if (!hash)
+    return tl::nullopt;
+
+  return TypeKey (ty, hash.value ());
+}
+
+tl::optional<uint64_t>
+TypeKey::hash_of (const BaseType *ty, unsigned depth)
+{
+  if (depth > kMaxDepth)
+    return tl::nullopt;
+
+  ty = ty->destructure ();
+  uint64_t hash = mix (ty->get_kind (), primitive_kind (ty));
+  switch (ty->get_kind ())
+    {
+    case BOOL:
+    case CHAR:
+    case INT:
+    case UINT:
+    case FLOAT:
+    case USIZE:
+    case ISIZE:
+    case STR:
+    case NEVER:
+      return hash;
+
+      case REF: {
+	auto ref = static_cast<const ReferenceType *> (ty);
+	return hash_of (ref->get_base (), depth + 1)
+	  .map ([hash, ref] (uint64_t base) {
+	    return mix (mix (hash, ref->is_mutable ()), base);
+	  });
+      }
+
+      case POINTER: {
+	auto ptr = static_cast<const PointerType *> (ty);
+	return hash_of (ptr->get_base (), depth + 1)
+	  .map ([hash, ptr] (uint64_t base) {
+	    return mix (mix (hash, ptr->is_mutable ()), base);
+	  });
+      }
+
+      case SLICE: {
+	auto slice = static_cast<const SliceType *> (ty);
+	return hash_of (slice->get_element_type (), depth + 1)
+	  .map ([hash] (uint64_t elem) { return mix (hash, elem); });
+      }
+
+      case TUPLE: {
+	auto tuple = static_cast<const TupleType *> (ty);
+	for (size_t i = 0; i < tuple->num_fields (); i++)
+	  {
+	    auto field = hash_of (tuple->get_field (i), depth + 1);
+	    if (!field)
+	      return tl::nullopt;
+	    hash = mix (hash, field.value ());
+	  }
+	return mix (hash, tuple->num_fields ());
+      }
+
+      case ADT: {
+	// the canonical path tells ADTs apart, and the generic arguments
+	// their instances
+	auto adt = static_cast<const ADTType *> (ty);
+	auto &path = adt->get_ident ().path.get ();
+	hash = mix (hash, std::hash<std::string> () (path));
+	for (auto &subst : adt->get_substs ())
+	  {
+	    auto param = subst.get_param_ty ();
+	    if (param == nullptr)
+	      return tl::nullopt;
+
+	    auto arg = hash_of (param->resolve (), depth + 1);
+	    if (!arg)
+	      return tl::nullopt;
+	    hash = mix (hash, arg.value ());
+	  }
+	return hash;
+      }
+
+      case CONST: {
+	auto value = static_cast<const ConstType *> (ty);
+	return hash_of (value->get_value_type (), depth + 1)
+	  .map ([hash, value] (uint64_t type) {
+	    return mix (mix (hash, type),
+			std::hash<std::string> () (value->get_value ()));
+	  });
+      }
+
+    // inference variables and generics get resolved over time, and the
+    // structure of the remaining kinds does not identify them
+    default:
+      return tl::nullopt;
+    }
+}
+
+// Whether A and B, both of which have a key, are the same type
+bool
+TypeKey::equal (const BaseType *a, const BaseType *b)
+{
+  a = a->destructure ();
+  b = b->destructure ();
+  if (a == b)
+    return true;
+  if (a->get_kind () != b->get_kind ()
+      || primitive_kind (a) != primitive_kind (b))
+    return false;
+
+  switch (a->get_kind ())
+    {
+      case REF: {
+	auto x = static_cast<const ReferenceType *> (a);
+	auto y = static_cast<const ReferenceType *> (b);
+	return x->is_mutable () == y->is_mutable ()
+	       && equal (x->get_base (), y->get_base ());
+      }
+
+      case POINTER: {
+	auto x = static_cast<const PointerType *> (a);
+	auto y = static_cast<const PointerType *> (b);
+	return x->is_mutable () == y->is_mutable ()
+	       && equal (x->get_base (), y->get_base ());
+      }
+
+    case SLICE:
+      return equal (static_cast<const SliceType *> (a)->get_element_type (),
+		    static_cast<const SliceType *> (b)->get_element_type ());
+
+      case TUPLE: {
+	auto x = static_cast<const TupleType *> (a);
+	auto y = static_cast<const TupleType *> (b);
+	if (x->num_fields () != y->num_fields ())
+	  return false;
+	for (size_t i = 0; i < x->num_fields (); i++)
+	  if (!equal (x->get_field (i), y->get_field (i)))
+	    return false;
+	return true;
+      }
+
+      case ADT: {
+	auto x = static_cast<const ADTType *> (a);
+	auto y = static_cast<const ADTType *> (b);
+	if (x->get_ident ().path.get () != y->get_ident ().path.get ()
+	    || x->get_substs ().size () != y->get_substs ().size ())
+	  return false;
+	for (size_t i = 0; i < x->get_substs ().size (); i++)
+	  if (!equal (x->get_substs ()[i].get_param_ty ()->resolve (),
+		      y->get_substs ()[i].get_param_ty ()->resolve ()))
+	    return false;
+	return true;
+      }
+
+      case CONST: {
+	auto x = static_cast<const ConstType *> (a);
+	auto y = static_cast<const ConstType *> (b);
+	return x->get_value () == y->get_value ()
+	       && equal (x->get_value_type (), y->get_value_type ());
+      }
+
+    default:
+      return true;
+    }
+}
+
+bool
+TypeKey::operator== (const TypeKey &other) const
+{
+  return hash == other.hash && equal (ty, other.ty);
+}
+
+} // namespace TyTy
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_tyty_key_test (void)
+{
+  using namespace Rust::TyTy;
+
+  IntType a (1, IntType::I32);
+  IntType b (2, IntType::I32);
+  IntType c (3, IntType::I64);
+  UintType d (4, UintType::U32);
+
+  auto key_a = TypeKey::make (&a);
+  auto key_b = TypeKey::make (&b);
+  auto key_c = TypeKey::make (&c);
+  auto key_d = TypeKey::make (&d);
+  ASSERT_TRUE (key_a && key_b && key_c && key_d);
+
+  // the HirIds of the types do not matter
+  ASSERT_TRUE (key_a.value () == key_b.value ());
+  ASSERT_EQ (key_a->get_hash (), key_b->get_hash ());
+
+  ASSERT_TRUE (key_a.value () != key_c.value ());
+  ASSERT_TRUE (key_a.value () != key_d.value ());
+
+  InferType infer (5, InferType::GENERAL, InferType::TypeHint::Default (),
+		   UNDEF_LOCATION);
+  ASSERT_FALSE (TypeKey::make (&infer));
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,78 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_TYTY_KEY_H
+#define RUST_TYTY_KEY_H
+
+#include "rust-system.h"
+#include "rust-tyty.h"
+
+namespace Rust {
+namespace TyTy {
+
+/**
+ * Identity of a fully resolved type, for use as the key of hash maps.
+ *
+ * The structural hash is computed once when the key is made, and keys are
+ * compared by walking the two types side by side, so neither hashing nor
+ * lookup needs to render the type as a string. ADTs are identified by their
+ * canonical path and their generic arguments.
+ *
+ * A key refers to the type it was made from, so keys stored in a map must
+ * be made from types that outlive the map. Inference variables, generics,
+ * functions, closures, trait objects and arrays have no key.
+ */
+class TypeKey
+{
+public:
+  static tl::optional<TypeKey> make (const BaseType *ty);
+
+  uint64_t get_hash () const { return hash; }
+  const BaseType *get_type () const { return ty; }
+
+  bool operator== (const TypeKey &other) const;
+  bool operator!= (const TypeKey &other) const { return !(*this == other); }
+
+  struct Hash
+  {
+    size_t operator() (const TypeKey &key) const { return key.get_hash (); }
+  };
+
+private:
+  TypeKey (const BaseType *ty, uint64_t hash) : ty (ty), hash (hash) {}
+
+  static tl::optional<uint64_t> hash_of (const BaseType *ty, unsigned depth);
+  static bool equal (const BaseType *a, const BaseType *b);
+
+  const BaseType *ty;
+  uint64_t hash;
+};
+
+} // namespace TyTy
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_tyty_key_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_TYTY_KEY_H
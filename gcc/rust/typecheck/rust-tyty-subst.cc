@@ -29,7 +29,7 @@ namespace Rust {
 namespace TyTy {
 
 SubstitutionParamMapping::SubstitutionParamMapping (
-  const HIR::TypeParam &generic, ParamType *param)
+  const HIR::GenericParam &generic, ParamType *param)
   : generic (generic), param (param)
 {}
 
@@ -66,7 +66,7 @@ SubstitutionParamMapping::get_param_ty () const
   return param;
 }
 
-const HIR::TypeParam &
+const HIR::GenericParam &
 SubstitutionParamMapping::get_generic_param () const
 {
   return generic;
@@ -87,13 +87,18 @@ SubstitutionParamMapping::get_param_locus () const
 bool
 SubstitutionParamMapping::param_has_default_ty () const
 {
-  return generic.has_type ();
+  if (generic.get_kind () != HIR::GenericParam::GenericKind::TYPE)
+    return false;
+
+  return static_cast<const HIR::TypeParam &> (generic).has_type ();
 }
 
 BaseType *
 SubstitutionParamMapping::get_default_ty () const
 {
-  TyVar var (generic.get_type_mappings ().get_hirid ());
+  rust_assert (param_has_default_ty ());
+  auto &type_param = static_cast<const HIR::TypeParam &> (generic);
+  TyVar var (type_param.get_type_mappings ().get_hirid ());
   return var.get_tyty ();
 }
 
@@ -668,7 +673,9 @@ SubstitutionRef::get_mappings_from_generic_args (
 
   // for inherited arguments
   size_t offs = used_arguments.size ();
-  if (args.get_type_args ().size () + offs > substitutions.size ())
+  size_t num_args
+    = args.get_type_args ().size () + args.get_const_args ().size ();
+  if (num_args + offs > substitutions.size ())
     {
       rich_location r (line_table, args.get_locus ());
       if (!substitutions.empty ())
@@ -677,12 +684,11 @@ SubstitutionRef::get_mappings_from_generic_args (
       rust_error_at (
 	r,
 	"generic item takes at most %lu type arguments but %lu were supplied",
-	(unsigned long) substitutions.size (),
-	(unsigned long) args.get_type_args ().size ());
+	(unsigned long) substitutions.size (), (unsigned long) num_args);
       return SubstitutionArgumentMappings::error ();
     }
 
-  if (args.get_type_args ().size () + offs < min_required_substitutions ())
+  if (num_args + offs < min_required_substitutions ())
     {
       rich_location r (line_table, args.get_locus ());
       r.add_range (substitutions.front ().get_param_locus ());
@@ -691,21 +697,62 @@ SubstitutionRef::get_mappings_from_generic_args (
 	r, ErrorCode::E0107,
 	"generic item takes at least %lu type arguments but %lu were supplied",
 	(unsigned long) (min_required_substitutions () - offs),
-	(unsigned long) args.get_type_args ().size ());
+	(unsigned long) num_args);
       return SubstitutionArgumentMappings::error ();
     }
 
+  // the type and const arguments are lowered to separate lists, which are
+  // matched to the parameters in order depending on their kind
   std::vector<SubstitutionArg> mappings = used_arguments.get_mappings ();
-  for (auto &arg : args.get_type_args ())
+  size_t type_arg = 0;
+  size_t const_arg = 0;
+  while (type_arg + const_arg < num_args)
     {
-      BaseType *resolved = Resolver::TypeCheckType::Resolve (arg.get ());
-      if (resolved == nullptr || resolved->get_kind () == TyTy::TypeKind::ERROR)
+      SubstitutionParamMapping &param = substitutions.at (offs);
+      BaseType *resolved = nullptr;
+      if (param.get_param_ty ()->is_const_param ())
 	{
-	  rust_error_at (args.get_locus (), "failed to resolve type arguments");
-	  return SubstitutionArgumentMappings::error ();
+	  if (const_arg == args.get_const_args ().size ())
+	    {
+	      auto &arg = args.get_type_args ().at (type_arg);
+	      rust_error_at (arg->get_locus (), ErrorCode::E0747,
+			     "type provided when a constant was expected");
+	      return SubstitutionArgumentMappings::error ();
+	    }
+
+	  auto &arg = args.get_const_args ().at (const_arg++);
+	  resolved = Resolver::resolve_const_value (
+	    *arg.get_expression (),
+	    param.get_param_ty ()->get_const_value_type ());
+	  if (resolved == nullptr)
+	    {
+	      rust_sorry_at (arg.get_locus (),
+			     "unsupported expression in const generic argument");
+	      return SubstitutionArgumentMappings::error ();
+	    }
+	}
+      else
+	{
+	  if (type_arg == args.get_type_args ().size ())
+	    {
+	      auto &arg = args.get_const_args ().at (const_arg);
+	      rust_error_at (arg.get_locus (), ErrorCode::E0747,
+			     "constant provided when a type was expected");
+	      return SubstitutionArgumentMappings::error ();
+	    }
+
+	  auto &arg = args.get_type_args ().at (type_arg++);
+	  resolved = Resolver::TypeCheckType::Resolve (arg.get ());
+	  if (resolved == nullptr
+	      || resolved->get_kind () == TyTy::TypeKind::ERROR)
+	    {
+	      rust_error_at (args.get_locus (),
+			     "failed to resolve type arguments");
+	      return SubstitutionArgumentMappings::error ();
+	    }
 	}
 
-      SubstitutionArg subst_arg (&substitutions.at (offs), resolved);
+      SubstitutionArg subst_arg (&param, resolved);
       offs++;
       mappings.push_back (std::move (subst_arg));
     }
@@ -102,6 +102,7 @@ public:
   void visit (NeverType &type) override {}
 
   void visit (ClosureType &type) override {}
+  void visit (ConstType &type) override {}
   void visit (FnType &type) override
   {
     for (auto &region : type.get_used_arguments ().get_regions ())
@@ -214,7 +215,7 @@ public: // Data used by visitors.
   /** Current solutions. Initiated to bivariant. */
   std::vector<Variance> solutions;
 
-  /** Constrains on solutions. Iteratively applied until fixpoint. */
+  /** Constrains on solutions. Applied from a worklist until fixpoint. */
   std::vector<Constraint> constraints;
 
   /** Maps TyTy::orig_ref to an index of first solution for this type. */
@@ -131,36 +131,77 @@ GenericTyPerCrateCtx::process_type (ADTType &type)
   GenericTyVisitorCtx (*this).process_type (type);
 }
 
+// Add the solutions TERM reads to DEPS
+static void
+collect_term_refs (const Term *term, std::vector<SolutionIndex> &deps)
+{
+  switch (term->kind)
+    {
+    case Term::CONST:
+      return;
+    case Term::REF:
+      deps.push_back (term->ref);
+      return;
+    case Term::TRANSFORM:
+      collect_term_refs (term->transform.lhs, deps);
+      collect_term_refs (term->transform.rhs, deps);
+      return;
+    }
+  rust_unreachable ();
+}
+
 void
 GenericTyPerCrateCtx::solve ()
 {
   rust_debug ("Variance analysis solving started:");
 
-  // Fix point iteration
-  bool changed = true;
-  while (changed)
+  // The constraints reading each solution, which are the only ones that need
+  // applying again when that solution changes
+  std::vector<std::vector<size_t>> dependents (solutions.size ());
+  std::vector<SolutionIndex> deps;
+  for (size_t i = 0; i < constraints.size (); i++)
     {
-      changed = false;
-      for (auto constraint : constraints)
-	{
-	  rust_debug ("\tapplying constraint: %s <= %s",
-		      to_string (constraint.target_index).c_str (),
-		      to_string (*constraint.term).c_str ());
-
-	  auto old_solution = solutions[constraint.target_index];
-	  auto new_solution
-	    = Variance::join (old_solution, evaluate (constraint.term));
+      deps.clear ();
+      collect_term_refs (constraints[i].term, deps);
+      for (auto dep : deps)
+	if (dependents[dep].empty () || dependents[dep].back () != i)
+	  dependents[dep].push_back (i);
+    }
 
-	  if (old_solution != new_solution)
-	    {
-	      rust_debug ("\t\tsolution changed: %s => %s",
-			  old_solution.as_string ().c_str (),
-			  new_solution.as_string ().c_str ());
+  // Worklist iteration to a fixpoint, starting from every constraint
+  std::deque<size_t> worklist;
+  std::vector<bool> queued (constraints.size (), true);
+  for (size_t i = 0; i < constraints.size (); i++)
+    worklist.push_back (i);
 
-	      changed = true;
-	      solutions[constraint.target_index] = new_solution;
-	    }
-	}
+  while (!worklist.empty ())
+    {
+      size_t index = worklist.front ();
+      worklist.pop_front ();
+      queued[index] = false;
+
+      auto &constraint = constraints[index];
+      rust_debug ("\tapplying constraint: %s <= %s",
+		  to_string (constraint.target_index).c_str (),
+		  to_string (*constraint.term).c_str ());
+
+      auto old_solution = solutions[constraint.target_index];
+      auto new_solution
+	= Variance::join (old_solution, evaluate (constraint.term));
+      if (old_solution == new_solution)
+	continue;
+
+      rust_debug ("\t\tsolution changed: %s => %s",
+		  old_solution.as_string ().c_str (),
+		  new_solution.as_string ().c_str ());
+      solutions[constraint.target_index] = new_solution;
+
+      for (auto dependent : dependents[constraint.target_index])
+	if (!queued[dependent])
+	  {
+	    queued[dependent] = true;
+	    worklist.push_back (dependent);
+	  }
     }
 
   constraints.clear ();
@@ -199,9 +240,7 @@ GenericTyPerCrateCtx::debug_print_solutions ()
 	    {
 	      if (i > solution_index)
 		result += ", ";
-	      result += param.get_generic_param ()
-			  .get_type_representation ()
-			  .as_string ();
+	      result += param.get_param_ty ()->get_symbol ();
 	      result += "=";
 	      result += solutions[i].as_string ();
 	      i++;
@@ -239,8 +278,7 @@ GenericTyVisitorCtx::process_type (ADTType &ty)
   first_type = first_lifetime + ty.get_used_arguments ().get_regions ().size ();
 
   for (const auto &param : ty.get_substs ())
-    param_names.push_back (
-      param.get_generic_param ().get_type_representation ().as_string ());
+    param_names.push_back (param.get_param_ty ()->get_symbol ());
 
   for (const auto &variant : ty.get_variants ())
     {
@@ -109,6 +109,9 @@ TypeKindFormat::to_string (TypeKind kind)
     case TypeKind::CLOSURE:
       return "Closure";
 
+    case TypeKind::CONST:
+      return "Const";
+
     case TypeKind::ERROR:
       return "ERROR";
     }
@@ -218,6 +221,7 @@ BaseType::is_unit () const
 
     case STR:
     case DYNAMIC:
+    case CONST:
     case ERROR:
       return false;
 
@@ -558,8 +562,10 @@ BaseType::monomorphized_clone () const
   if (auto arr = x->try_as<const ArrayType> ())
     {
       TyVar elm = arr->get_var_element_type ().monomorphized_clone ();
+      tl::optional<TyVar> capacity = arr->get_var_capacity ().map (
+	[] (const TyVar &var) { return var.monomorphized_clone (); });
       return new ArrayType (arr->get_ref (), arr->get_ty_ref (), ident.locus,
-			    arr->get_capacity_expr (), elm,
+			    arr->get_capacity_expr (), elm, capacity,
 			    arr->get_combined_refs ());
     }
   else if (auto slice = x->try_as<const SliceType> ())
@@ -613,7 +619,7 @@ BaseType::monomorphized_clone () const
 
       TyVar retty = fn->get_var_return_type ().monomorphized_clone ();
       return new FnPtr (fn->get_ref (), fn->get_ty_ref (), ident.locus,
-			std::move (cloned_params), retty,
+			std::move (cloned_params), retty, fn->get_abi (),
 			fn->get_combined_refs ());
     }
   else if (auto adt = x->try_as<const ADTType> ())
@@ -723,6 +729,10 @@ BaseType::is_concrete () const
     }
   else if (auto arr = x->try_as<const ArrayType> ())
     {
+      auto capacity = arr->get_capacity ();
+      if (capacity && !capacity.value ()->is_concrete ())
+	return false;
+
       return arr->get_element_type ()->is_concrete ();
     }
   else if (auto slice = x->try_as<const SliceType> ())
@@ -756,7 +766,7 @@ BaseType::is_concrete () const
 	   || x->is<IntType> () || x->is<UintType> () || x->is<FloatType> ()
 	   || x->is<USizeType> () || x->is<ISizeType> () || x->is<NeverType> ()
 	   || x->is<StrType> () || x->is<DynamicObjectType> ()
-	   || x->is<ErrorType> ())
+	   || x->is<ConstType> () || x->is<ErrorType> ())
     {
       return true;
     }
@@ -790,6 +800,7 @@ BaseType::has_substitutions_defined () const
     case TUPLE:
     case PARAM:
     case PLACEHOLDER:
+    case CONST:
       return false;
 
       case PROJECTION: {
@@ -851,6 +862,7 @@ BaseType::needs_generic_substitutions () const
     case TUPLE:
     case PARAM:
     case PLACEHOLDER:
+    case CONST:
       return false;
 
       case PROJECTION: {
@@ -1116,6 +1128,14 @@ InferType::default_type (BaseType **type) const
 void
 InferType::apply_primitive_type_hint (const BaseType &hint)
 {
+  auto old_kind = infer_kind;
+  auto old_hint = default_hint;
+  Resolver::TypeCheckContext::get ()->record_undo (
+    [this, old_kind, old_hint] () {
+      infer_kind = old_kind;
+      default_hint = old_hint;
+    });
+
   switch (hint.get_kind ())
     {
     case ISIZE:
@@ -1537,6 +1557,13 @@ VariantDef::clone () const
 			 cloned_fields);
 }
 
+VariantDef *
+VariantDef::clone_with_fields (std::vector<StructFieldType *> fields) const
+{
+  return new VariantDef (id, defid, identifier, ident, type, discriminant,
+			 fields);
+}
+
 VariantDef *
 VariantDef::monomorphized_clone () const
 {
@@ -1650,9 +1677,11 @@ ADTType::clone () const
 		      get_region_constraints (), get_combined_refs ());
 }
 
-static bool
-handle_substitions (SubstitutionArgumentMappings &subst_mappings,
-		    StructFieldType *field)
+// The type of FIELD once SUBST_MAPPINGS are applied, or nullptr on error. The
+// field type is only copied once, as it is substituted.
+static BaseType *
+substitute_field_type (SubstitutionArgumentMappings &subst_mappings,
+		       StructFieldType *field)
 {
   auto fty = field->get_field_type ();
   if (auto p = fty->try_as<ParamType> ())
@@ -1669,12 +1698,12 @@ handle_substitions (SubstitutionArgumentMappings &subst_mappings,
 	    {
 	      auto new_field = argt->clone ();
 	      new_field->set_ref (fty->get_ref ());
-	      field->set_field_type (new_field);
-	    }
-	  else
-	    {
-	      field->get_field_type ()->set_ty_ref (argt->get_ref ());
+	      return new_field;
 	    }
+
+	  auto new_field = fty->clone ();
+	  new_field->set_ty_ref (argt->get_ref ());
+	  return new_field;
 	}
     }
   else if (fty->has_substitutions_defined () || !fty->is_concrete ())
@@ -1687,23 +1716,49 @@ handle_substitions (SubstitutionArgumentMappings &subst_mappings,
 	  rust_error_at (subst_mappings.get_locus (),
 			 "Failed to resolve field substitution type: %s",
 			 fty->as_string ().c_str ());
-	  return false;
+	  return nullptr;
 	}
 
       auto new_field = concrete->clone ();
       new_field->set_ref (fty->get_ref ());
-      field->set_field_type (new_field);
+      return new_field;
     }
 
-  return true;
+  return fty->clone ();
 }
 
 ADTType *
 ADTType::handle_substitions (SubstitutionArgumentMappings &subst_mappings)
 {
-  auto adt = clone ()->as<ADTType> ();
-  adt->set_ty_ref (mappings.get_next_hir_id ());
-  adt->used_arguments = subst_mappings;
+  // the variants are rebuilt around the substituted field types, instead of
+  // deep copying every field type first only to replace it afterwards
+  bool ok = true;
+  std::vector<VariantDef *> substituted_variants;
+  for (auto &variant : variants)
+    {
+      std::vector<StructFieldType *> fields;
+      for (auto &field : variant->get_fields ())
+	{
+	  BaseType *fty = nullptr;
+	  if (ok && !variant->is_dataless_variant ())
+	    {
+	      fty = substitute_field_type (subst_mappings, field);
+	      ok = fty != nullptr;
+	    }
+	  if (fty == nullptr)
+	    fty = field->get_field_type ()->clone ();
+
+	  fields.push_back (new StructFieldType (field->get_ref (),
+						 field->get_name (), fty,
+						 field->get_locus ()));
+	}
+      substituted_variants.push_back (variant->clone_with_fields (fields));
+    }
+
+  auto adt = new ADTType (get_ref (), mappings.get_next_hir_id (), identifier,
+			  ident, get_adt_kind (), substituted_variants,
+			  clone_substs (), get_repr_options (), subst_mappings,
+			  get_region_constraints (), get_combined_refs ());
 
   for (auto &sub : adt->get_substs ())
     {
@@ -1714,19 +1769,6 @@ ADTType::handle_substitions (SubstitutionArgumentMappings &subst_mappings)
 	sub.fill_param_ty (subst_mappings, subst_mappings.get_locus ());
     }
 
-  for (auto &variant : adt->get_variants ())
-    {
-      if (variant->is_dataless_variant ())
-	continue;
-
-      for (auto &field : variant->get_fields ())
-	{
-	  bool ok = ::Rust::TyTy::handle_substitions (subst_mappings, field);
-	  if (!ok)
-	    return adt;
-	}
-    }
-
   return adt;
 }
 
@@ -2108,7 +2150,12 @@ FnPtr::as_string () const
       params_str += p.get_tyty ()->as_string () + " ,";
     }
 
-  return "fnptr (" + params_str + ") -> " + get_return_type ()->as_string ();
+  std::string abi_str;
+  if (get_abi () != ABI::RUST)
+    abi_str = "extern \"" + get_string_from_abi (get_abi ()) + "\" ";
+
+  return abi_str + "fnptr (" + params_str + ") -> "
+	 + get_return_type ()->as_string ();
 }
 
 bool
@@ -2125,6 +2172,9 @@ FnPtr::is_equal (const BaseType &other) const
     return false;
 
   auto other2 = static_cast<const FnPtr &> (other);
+  if (get_abi () != other2.get_abi ())
+    return false;
+
   auto this_ret_type = get_return_type ();
   auto other_ret_type = other2.get_return_type ();
   if (this_ret_type->is_equal (*other_ret_type))
@@ -2149,7 +2199,7 @@ FnPtr::clone () const
     cloned_params.push_back (TyVar (p.get_ref ()));
 
   return new FnPtr (get_ref (), get_ty_ref (), ident.locus,
-		    std::move (cloned_params), result_type,
+		    std::move (cloned_params), result_type, get_abi (),
 		    get_combined_refs ());
 }
 
@@ -2264,7 +2314,9 @@ ArrayType::accept_vis (TyConstVisitor &vis) const
 std::string
 ArrayType::as_string () const
 {
-  return "[" + get_element_type ()->as_string () + ":" + "CAPACITY" + "]";
+  auto capacity = get_capacity ();
+  std::string length = capacity ? capacity.value ()->as_string () : "CAPACITY";
+  return "[" + get_element_type ()->as_string () + ":" + length + "]";
 }
 
 bool
@@ -2284,8 +2336,22 @@ ArrayType::is_equal (const BaseType &other) const
 
   auto this_element_type = get_element_type ();
   auto other_element_type = other2.get_element_type ();
+  if (!this_element_type->is_equal (*other_element_type))
+    return false;
 
-  return this_element_type->is_equal (*other_element_type);
+  // arrays whose length is not known here are compared by their elements
+  auto this_capacity = get_capacity ();
+  auto other_capacity = other2.get_capacity ();
+  if (this_capacity && other_capacity)
+    return this_capacity.value ()->is_equal (*other_capacity.value ());
+
+  return true;
+}
+
+tl::optional<BaseType *>
+ArrayType::get_capacity () const
+{
+  return capacity.map ([] (const TyVar &var) { return var.get_tyty (); });
 }
 
 BaseType *
@@ -2304,7 +2370,7 @@ BaseType *
 ArrayType::clone () const
 {
   return new ArrayType (get_ref (), get_ty_ref (), ident.locus, capacity_expr,
-			element_type, get_combined_refs ());
+			element_type, capacity, get_combined_refs ());
 }
 
 ArrayType *
@@ -2320,6 +2386,14 @@ ArrayType::handle_substitions (SubstitutionArgumentMappings &mappings)
   BaseType *concrete = Resolver::SubstMapperInternal::Resolve (base, mappings);
   ref->element_type = TyVar::subst_covariant_var (base, concrete);
 
+  // and the length might be a const generic parameter
+  if (auto capacity = ref->get_capacity ())
+    {
+      BaseType *length
+	= Resolver::SubstMapperInternal::Resolve (capacity.value (), mappings);
+      ref->capacity = TyVar::subst_covariant_var (capacity.value (), length);
+    }
+
   return ref;
 }
 
@@ -3203,6 +3277,21 @@ ParamType::get_generic_param ()
   return param;
 }
 
+bool
+ParamType::is_const_param () const
+{
+  return param.get_kind () == HIR::GenericParam::GenericKind::CONST;
+}
+
+BaseType *
+ParamType::get_const_value_type () const
+{
+  rust_assert (is_const_param ());
+  auto &const_param = static_cast<HIR::ConstGenericParam &> (param);
+  TyVar var (const_param.get_type ()->get_mappings ().get_hirid ());
+  return var.get_tyty ();
+}
+
 bool
 ParamType::can_resolve () const
 {
@@ -3350,6 +3439,68 @@ ParamType::is_implicit_self_trait () const
   return is_trait_self;
 }
 
+// ConstType
+
+ConstType::ConstType (HirId ref, location_t locus, TyVar ty, std::string value,
+		      std::set<HirId> refs)
+  : BaseType (ref, ref, KIND, {Resolver::CanonicalPath::create_empty (), locus},
+	      refs),
+    ty (ty), value (std::move (value))
+{}
+
+ConstType::ConstType (HirId ref, HirId ty_ref, location_t locus, TyVar ty,
+		      std::string value, std::set<HirId> refs)
+  : BaseType (ref, ty_ref, KIND,
+	      {Resolver::CanonicalPath::create_empty (), locus}, refs),
+    ty (ty), value (std::move (value))
+{}
+
+void
+ConstType::accept_vis (TyVisitor &vis)
+{
+  vis.visit (*this);
+}
+
+void
+ConstType::accept_vis (TyConstVisitor &vis) const
+{
+  vis.visit (*this);
+}
+
+std::string
+ConstType::as_string () const
+{
+  if (get_value_type ()->get_kind () == TypeKind::BOOL)
+    return value == "0" ? "false" : "true";
+
+  return value;
+}
+
+bool
+ConstType::can_eq (const BaseType *other, bool emit_errors) const
+{
+  ConstCmp r (this, emit_errors);
+  return r.can_eq (other);
+}
+
+bool
+ConstType::is_equal (const BaseType &other) const
+{
+  if (get_kind () != other.get_kind ())
+    return false;
+
+  auto &other2 = static_cast<const ConstType &> (other);
+  return get_value () == other2.get_value ()
+	 && get_value_type ()->is_equal (*other2.get_value_type ());
+}
+
+BaseType *
+ConstType::clone () const
+{
+  return new ConstType (get_ref (), get_ty_ref (), ident.locus, ty, value,
+			get_combined_refs ());
+}
+
 // StrType
 
 StrType::StrType (HirId ref, std::set<HirId> refs)
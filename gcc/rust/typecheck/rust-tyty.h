@@ -72,6 +72,7 @@ enum TypeKind
   PROJECTION,
   DYNAMIC,
   CLOSURE,
+  CONST,
   // there are more to add...
   ERROR
 };
@@ -174,6 +175,8 @@ public:
   bool has_substitutions_defined () const;
   bool needs_generic_substitutions () const;
 
+  // The fingerprint behind legacy symbol hashes. legacy_hash in
+  // rust-mangle-legacy.cc computes it without building it, keep both in sync.
   std::string mangle_string () const
   {
     return TypeKindFormat::to_string (get_kind ()) + ":" + as_string () + ":"
@@ -387,6 +390,12 @@ public:
 
   HIR::GenericParam &get_generic_param ();
 
+  // Whether this stands for a const generic parameter rather than a type
+  bool is_const_param () const;
+
+  // the declared type of the values of a const generic parameter
+  BaseType *get_const_value_type () const;
+
   bool can_resolve () const;
 
   BaseType *resolve () const;
@@ -406,6 +415,47 @@ private:
   HIR::GenericParam &param;
 };
 
+// The value of a const generic argument, or the length of an array type,
+// once it is known during type checking. The value is kept in decimal, and
+// bools are 0 or 1.
+//
+// Const generic parameters are ParamTypes whose generic parameter is a
+// HIR::ConstGenericParam, so that they go through the same substitutions as
+// type parameters: each instance maps them to one of these.
+class ConstType : public BaseType
+{
+public:
+  static constexpr auto KIND = TypeKind::CONST;
+
+  ConstType (HirId ref, location_t locus, TyVar ty, std::string value,
+	     std::set<HirId> refs = std::set<HirId> ());
+
+  ConstType (HirId ref, HirId ty_ref, location_t locus, TyVar ty,
+	     std::string value, std::set<HirId> refs = std::set<HirId> ());
+
+  void accept_vis (TyVisitor &vis) override;
+  void accept_vis (TyConstVisitor &vis) const override;
+
+  std::string as_string () const override;
+
+  std::string get_name () const override final { return as_string (); }
+
+  bool can_eq (const BaseType *other, bool emit_errors) const override final;
+
+  bool is_equal (const BaseType &other) const override;
+
+  BaseType *clone () const final override;
+
+  BaseType *get_value_type () const { return ty.get_tyty (); }
+  const TyVar &get_var_value_type () const { return ty; }
+
+  const std::string &get_value () const { return value; }
+
+private:
+  TyVar ty;
+  std::string value;
+};
+
 class StructFieldType
 {
 public:
@@ -605,6 +655,9 @@ public:
 
   VariantDef *clone () const;
 
+  // A copy of this variant with FIELDS instead of its own
+  VariantDef *clone_with_fields (std::vector<StructFieldType *> fields) const;
+
   VariantDef *monomorphized_clone () const;
 
   const RustIdent &get_ident () const;
@@ -636,8 +689,9 @@ public:
   // Representation options, specified via attributes e.g. #[repr(packed)]
   struct ReprOptions
   {
-    // bool is_c;
-    // bool is_transparent;
+    bool is_c = false;
+    bool is_simd = false;
+    bool is_transparent = false;
     //...
 
     // For align and pack: 0 = unspecified. Nonzero = byte alignment.
@@ -645,6 +699,10 @@ public:
     // parsing the #[repr] attribute.
     unsigned char align = 0;
     unsigned char pack = 0;
+
+    // Integer type of the discriminant of an enum, as given with e.g.
+    // #[repr(u8)]. nullptr lets the backend pick the smallest one.
+    BaseType *repr = nullptr;
   };
 
   ADTType (HirId ref, std::string identifier, RustIdent ident, ADTKind adt_kind,
@@ -905,19 +963,21 @@ public:
   static constexpr auto KIND = TypeKind::FNPTR;
 
   FnPtr (HirId ref, location_t locus, std::vector<TyVar> params,
-	 TyVar result_type, std::set<HirId> refs = std::set<HirId> ())
+	 TyVar result_type, ABI abi = ABI::RUST,
+	 std::set<HirId> refs = std::set<HirId> ())
     : CallableTypeInterface (ref, ref, TypeKind::FNPTR,
 			     {Resolver::CanonicalPath::create_empty (), locus},
 			     refs),
-      params (std::move (params)), result_type (result_type)
+      params (std::move (params)), result_type (result_type), abi (abi)
   {}
 
   FnPtr (HirId ref, HirId ty_ref, location_t locus, std::vector<TyVar> params,
-	 TyVar result_type, std::set<HirId> refs = std::set<HirId> ())
+	 TyVar result_type, ABI abi = ABI::RUST,
+	 std::set<HirId> refs = std::set<HirId> ())
     : CallableTypeInterface (ref, ty_ref, TypeKind::FNPTR,
 			     {Resolver::CanonicalPath::create_empty (), locus},
 			     refs),
-      params (params), result_type (result_type)
+      params (params), result_type (result_type), abi (abi)
   {}
 
   std::string get_name () const override final { return as_string (); }
@@ -941,6 +1001,10 @@ public:
 
   size_t num_params () const { return params.size (); }
 
+  // The calling convention of the functions this points to, `extern "C"
+  // fn()` only pointing to C functions
+  ABI get_abi () const { return abi; }
+
   void accept_vis (TyVisitor &vis) override;
   void accept_vis (TyConstVisitor &vis) const override;
 
@@ -958,6 +1022,7 @@ public:
 private:
   std::vector<TyVar> params;
   TyVar result_type;
+  ABI abi;
 };
 
 class ClosureType : public CallableTypeInterface, public SubstitutionRef
@@ -1054,18 +1119,20 @@ public:
   static constexpr auto KIND = TypeKind::ARRAY;
 
   ArrayType (HirId ref, location_t locus, HIR::Expr &capacity_expr, TyVar base,
+	     tl::optional<TyVar> capacity = tl::nullopt,
 	     std::set<HirId> refs = std::set<HirId> ())
     : BaseType (ref, ref, TypeKind::ARRAY,
 		{Resolver::CanonicalPath::create_empty (), locus}, refs),
-      element_type (base), capacity_expr (capacity_expr)
+      element_type (base), capacity (capacity), capacity_expr (capacity_expr)
   {}
 
   ArrayType (HirId ref, HirId ty_ref, location_t locus,
 	     HIR::Expr &capacity_expr, TyVar base,
+	     tl::optional<TyVar> capacity = tl::nullopt,
 	     std::set<HirId> refs = std::set<HirId> ())
     : BaseType (ref, ty_ref, TypeKind::ARRAY,
 		{Resolver::CanonicalPath::create_empty (), locus}, refs),
-      element_type (base), capacity_expr (capacity_expr)
+      element_type (base), capacity (capacity), capacity_expr (capacity_expr)
   {}
 
   void accept_vis (TyVisitor &vis) override;
@@ -1086,10 +1153,17 @@ public:
 
   HIR::Expr &get_capacity_expr () const { return capacity_expr; }
 
+  // The length of the array as a ConstType, or as the const generic
+  // parameter or inference variable standing for it. Unset when the length
+  // is an expression which only the backend can evaluate.
+  tl::optional<BaseType *> get_capacity () const;
+  const tl::optional<TyVar> &get_var_capacity () const { return capacity; }
+
   ArrayType *handle_substitions (SubstitutionArgumentMappings &mappings);
 
 private:
   TyVar element_type;
+  tl::optional<TyVar> capacity;
   // FIXME: I dont think this should be in tyty - tyty should already be const
   // evaluated
   HIR::Expr &capacity_expr;
@@ -214,6 +214,8 @@ UnifyRules::go ()
 
 	  // FIXME
 	  // this is hacky to set the implicit param lets make this a function
+	  HirId ty_ref = p->get_ty_ref ();
+	  context.record_undo ([p, ty_ref] () { p->set_ty_ref (ty_ref); });
 	  p->set_ty_ref (i->get_ref ());
 
 	  // set the rtype now to the new inference var
@@ -231,6 +233,8 @@ UnifyRules::go ()
 
 	  // FIXME
 	  // this is hacky to set the implicit param lets make this a function
+	  HirId ty_ref = p->get_ty_ref ();
+	  context.record_undo ([p, ty_ref] () { p->set_ty_ref (ty_ref); });
 	  p->set_ty_ref (i->get_ref ());
 
 	  // set the rtype now to the new inference var
@@ -322,6 +326,9 @@ UnifyRules::go ()
     case TyTy::CLOSURE:
       return expect_closure (static_cast<TyTy::ClosureType *> (ltype), rtype);
 
+    case TyTy::CONST:
+      return expect_const (static_cast<TyTy::ConstType *> (ltype), rtype);
+
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -410,6 +417,7 @@ UnifyRules::expect_inference_variable (TyTy::InferType *ltype,
     case TyTy::PLACEHOLDER:
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
+    case TyTy::CONST:
       case TyTy::CLOSURE: {
 	bool is_valid = (ltype->get_infer_kind ()
 			 == TyTy::InferType::InferTypeKind::GENERAL);
@@ -538,6 +546,7 @@ UnifyRules::expect_adt (TyTy::ADTType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -582,6 +591,7 @@ UnifyRules::expect_str (TyTy::StrType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -652,6 +662,7 @@ UnifyRules::expect_reference (TyTy::ReferenceType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -722,6 +733,7 @@ UnifyRules::expect_pointer (TyTy::PointerType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -783,6 +795,7 @@ UnifyRules::expect_param (TyTy::ParamType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -810,14 +823,34 @@ UnifyRules::expect_array (TyTy::ArrayType *ltype, TyTy::BaseType *rtype)
 	  TyTy::TyWithLocation (type.get_element_type ()), locus, commit_flag,
 	  false /* emit_error*/, infer_flag, commits, infers);
 
-	if (element_unify->get_kind () != TyTy::TypeKind::ERROR)
+	if (element_unify->get_kind () == TyTy::TypeKind::ERROR)
+	  break;
+
+	// the lengths must agree once both of them are known
+	tl::optional<TyTy::TyVar> capacity = type.get_var_capacity ();
+	auto lcapacity = ltype->get_capacity ();
+	auto rcapacity = type.get_capacity ();
+	if (lcapacity && rcapacity)
 	  {
-	    return new TyTy::ArrayType (type.get_ref (), type.get_ty_ref (),
-					type.get_ident ().locus,
-					type.get_capacity_expr (),
-					TyTy::TyVar (
-					  element_unify->get_ref ()));
+	    TyTy::BaseType *capacity_unify = UnifyRules::Resolve (
+	      TyTy::TyWithLocation (lcapacity.value ()),
+	      TyTy::TyWithLocation (rcapacity.value ()), locus, commit_flag,
+	      false /* emit_error*/, infer_flag, commits, infers);
+	    if (capacity_unify->get_kind () == TyTy::TypeKind::ERROR)
+	      break;
+
+	    capacity = TyTy::TyVar (capacity_unify->get_ref ());
+	  }
+	else if (lcapacity)
+	  {
+	    capacity = ltype->get_var_capacity ();
 	  }
+
+	return new TyTy::ArrayType (type.get_ref (), type.get_ty_ref (),
+				    type.get_ident ().locus,
+				    type.get_capacity_expr (),
+				    TyTy::TyVar (element_unify->get_ref ()),
+				    capacity);
       }
       break;
 
@@ -842,6 +875,7 @@ UnifyRules::expect_array (TyTy::ArrayType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -900,6 +934,7 @@ UnifyRules::expect_slice (TyTy::SliceType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -990,6 +1025,7 @@ UnifyRules::expect_fndef (TyTy::FnType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1012,7 +1048,8 @@ UnifyRules::expect_fnptr (TyTy::FnPtr *ltype, TyTy::BaseType *rtype)
 
       case TyTy::FNPTR: {
 	TyTy::FnPtr &type = *static_cast<TyTy::FnPtr *> (rtype);
-	if (ltype->num_params () != type.num_params ())
+	if (ltype->num_params () != type.num_params ()
+	    || ltype->get_abi () != type.get_abi ())
 	  {
 	    return new TyTy::ErrorType (0);
 	  }
@@ -1048,6 +1085,9 @@ UnifyRules::expect_fnptr (TyTy::FnPtr *ltype, TyTy::BaseType *rtype)
 
       case TyTy::FNDEF: {
 	TyTy::FnType &type = *static_cast<TyTy::FnType *> (rtype);
+	if (ltype->get_abi () != type.get_abi ())
+	  return new TyTy::ErrorType (0);
+
 	auto this_ret_type = ltype->get_return_type ();
 	auto other_ret_type = type.get_return_type ();
 
@@ -1106,6 +1146,7 @@ UnifyRules::expect_fnptr (TyTy::FnPtr *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1176,6 +1217,7 @@ UnifyRules::expect_tuple (TyTy::TupleType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1223,6 +1265,7 @@ UnifyRules::expect_bool (TyTy::BoolType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1270,6 +1313,7 @@ UnifyRules::expect_char (TyTy::CharType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1324,6 +1368,7 @@ UnifyRules::expect_int (TyTy::IntType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1378,6 +1423,7 @@ UnifyRules::expect_uint (TyTy::UintType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1432,6 +1478,7 @@ UnifyRules::expect_float (TyTy::FloatType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1479,6 +1526,7 @@ UnifyRules::expect_isize (TyTy::ISizeType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1526,6 +1574,7 @@ UnifyRules::expect_usize (TyTy::USizeType *ltype, TyTy::BaseType *rtype)
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
     case TyTy::CLOSURE:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1595,6 +1644,7 @@ UnifyRules::expect_placeholder (TyTy::PlaceholderType *ltype,
 	return rtype->clone ();
       gcc_fallthrough ();
 
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1642,6 +1692,7 @@ UnifyRules::expect_projection (TyTy::ProjectionType *ltype,
     case TyTy::ISIZE:
     case TyTy::NEVER:
     case TyTy::PLACEHOLDER:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1700,6 +1751,7 @@ UnifyRules::expect_dyn (TyTy::DynamicObjectType *ltype, TyTy::BaseType *rtype)
     case TyTy::NEVER:
     case TyTy::PLACEHOLDER:
     case TyTy::PROJECTION:
+    case TyTy::CONST:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -1770,6 +1822,65 @@ UnifyRules::expect_closure (TyTy::ClosureType *ltype, TyTy::BaseType *rtype)
     case TyTy::PLACEHOLDER:
     case TyTy::PROJECTION:
     case TyTy::DYNAMIC:
+    case TyTy::CONST:
+    case TyTy::ERROR:
+      return new TyTy::ErrorType (0);
+    }
+  return new TyTy::ErrorType (0);
+}
+
+TyTy::BaseType *
+UnifyRules::expect_const (TyTy::ConstType *ltype, TyTy::BaseType *rtype)
+{
+  switch (rtype->get_kind ())
+    {
+      case TyTy::INFER: {
+	TyTy::InferType *r = static_cast<TyTy::InferType *> (rtype);
+	bool is_valid
+	  = r->get_infer_kind () == TyTy::InferType::InferTypeKind::GENERAL;
+	if (is_valid)
+	  return ltype->clone ();
+      }
+      break;
+
+      case TyTy::CONST: {
+	TyTy::ConstType &type = *static_cast<TyTy::ConstType *> (rtype);
+	if (ltype->get_value () != type.get_value ())
+	  return new TyTy::ErrorType (0);
+
+	TyTy::BaseType *value_type = UnifyRules::Resolve (
+	  TyTy::TyWithLocation (ltype->get_value_type ()),
+	  TyTy::TyWithLocation (type.get_value_type ()), locus, commit_flag,
+	  false /* emit_error */, infer_flag, commits, infers);
+	if (value_type->get_kind () == TyTy::TypeKind::ERROR)
+	  return new TyTy::ErrorType (0);
+
+	return type.clone ();
+      }
+      break;
+
+    case TyTy::PARAM:
+    case TyTy::POINTER:
+    case TyTy::STR:
+    case TyTy::ADT:
+    case TyTy::REF:
+    case TyTy::ARRAY:
+    case TyTy::SLICE:
+    case TyTy::FNDEF:
+    case TyTy::FNPTR:
+    case TyTy::TUPLE:
+    case TyTy::BOOL:
+    case TyTy::CHAR:
+    case TyTy::INT:
+    case TyTy::UINT:
+    case TyTy::FLOAT:
+    case TyTy::USIZE:
+    case TyTy::ISIZE:
+    case TyTy::NEVER:
+    case TyTy::PLACEHOLDER:
+    case TyTy::PROJECTION:
+    case TyTy::DYNAMIC:
+    case TyTy::CLOSURE:
     case TyTy::ERROR:
       return new TyTy::ErrorType (0);
     }
@@ -79,6 +79,11 @@ public:
       }
   }
 
+  void write (const std::string &in)
+  {
+    write ((const unsigned char *) in.data (), in.size ());
+  }
+
   void sum (uint64_t *hi, uint64_t *lo) const
   {
     *hi = buf[0];
@@ -181,47 +181,74 @@ def read_derived_core_props_txt(filepath: str) -> None:
             process_line(line.rstrip())
 
 
+def recomposition_entries() -> list[Tuple[Codepoint, Codepoint, Codepoint]]:
+    entries = []
+    for cp in decomposition_map:
+        if binary_search_ranges(composition_exclusion_ranges, cp) != -1:
+            continue
+        d1: Codepoint = decomposition_map[cp][0]
+        d2: Codepoint = 0
+        if len(decomposition_map[cp]) == 2:
+            d2 = decomposition_map[cp][1]
+        entries.append((d1, d2, cp))
+    return sorted(entries)
+
+
+def write_types() -> None:
+    print("// The canonical decomposition of a codepoint into one or two codepoints,")
+    print("// the second one being zero when there is only one")
+    print("struct DecompositionEntry")
+    print("{")
+    print("  uint32_t codepoint;")
+    print("  uint32_t first;")
+    print("  uint32_t second;")
+    print("};")
+    print()
+    print("// The codepoint which a pair of codepoints composes into")
+    print("struct RecompositionEntry")
+    print("{")
+    print("  uint32_t first;")
+    print("  uint32_t second;")
+    print("  uint32_t composite;")
+    print("};")
+
+
+# The tables are sorted arrays of aggregates, so that they are in read-only
+# data instead of being built at startup, and are looked up by binary search.
+
+
 def write_decomposition() -> None:
-    print("const std::map<uint32_t, std::vector<uint32_t>> DECOMPOSITION_MAP = {")
+    print(
+        "const std::array<DecompositionEntry, NUM_DECOMPOSITIONS> DECOMPOSITION_MAP = {{"
+    )
     print("  // clang-format off")
     for cp in sorted(decomposition_map):
-        print("  {{{:#06x}, ".format(cp), end="")
-        print("{", end="")
-        for decomp_cp in decomposition_map[cp]:
-            print("{:#06x}, ".format(decomp_cp), end="")
-        print("}},")
+        decomp = decomposition_map[cp] + [0]
+        print("  {{{:#06x}, {:#06x}, {:#06x}}},".format(cp, decomp[0], decomp[1]))
     print("  // clang-format on")
-    print("};")
+    print("}};")
 
 
 def write_recomposition() -> None:
     print(
-        "const std::map<std::pair<uint32_t, uint32_t>, uint32_t> RECOMPOSITION_MAP = {{"
+        "const std::array<RecompositionEntry, NUM_RECOMPOSITIONS> RECOMPOSITION_MAP = {{"
     )
     print("  // clang-format off")
-    for cp in decomposition_map:
-        if binary_search_ranges(composition_exclusion_ranges, cp) != -1:
-            continue
-        d1: Codepoint
-        d2: Codepoint
-        if len(decomposition_map[cp]) == 1:
-            d1 = decomposition_map[cp][0]
-            d2 = 0
-        else:
-            d1 = decomposition_map[cp][0]
-            d2 = decomposition_map[cp][1]
-        print("  {{{{{:#06x}, {:#06x}}}, {:#06x}}},".format(d1, d2, cp))
+    for d1, d2, cp in recomposition_entries():
+        print("  {{{:#06x}, {:#06x}, {:#06x}}},".format(d1, d2, cp))
     print("  // clang-format on")
     print("}};")
 
 
 def write_ccc() -> None:
-    print("const std::map<uint32_t, int32_t> CCC_TABLE = {")
+    print(
+        "const std::array<std::pair<uint32_t, uint8_t>, NUM_CCC_ENTRIES> CCC_TABLE = {{"
+    )
     print("  // clang-format off")
-    for cp in ccc_table:
+    for cp in sorted(ccc_table):
         print("  {{{:#06x}, {}}},".format(cp, ccc_table[cp]))
     print("  // clang-format on")
-    print("};")
+    print("}};")
 
 
 def write_alphabetic() -> None:
@@ -293,9 +320,16 @@ def main() -> None:
     print("namespace Rust {\n")
     print("const uint32_t NUM_ALPHABETIC_RANGES = {};".format(len(alphabetic_ranges)))
     print(
-        "const uint32_t NUM_NUMERIC_CODEPOINTS = {};\n".format(len(numeric_codepoints))
+        "const uint32_t NUM_NUMERIC_CODEPOINTS = {};".format(len(numeric_codepoints))
     )
+    print("const uint32_t NUM_DECOMPOSITIONS = {};".format(len(decomposition_map)))
+    print(
+        "const uint32_t NUM_RECOMPOSITIONS = {};".format(len(recomposition_entries()))
+    )
+    print("const uint32_t NUM_CCC_ENTRIES = {};\n".format(len(ccc_table)))
 
+    write_types()
+    print()
     write_decomposition()
     print()
     write_recomposition()
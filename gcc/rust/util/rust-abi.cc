@@ -29,6 +29,8 @@ get_abi_from_string (const std::string &abi)
     return Rust::ABI::RUST;
   else if (abi.compare ("rust-intrinsic") == 0)
     return Rust::ABI::INTRINSIC;
+  else if (abi.compare ("platform-intrinsic") == 0)
+    return Rust::ABI::INTRINSIC;
   else if (abi.compare ("C") == 0)
     return Rust::ABI::C;
   else if (abi.compare ("cdecl") == 0)
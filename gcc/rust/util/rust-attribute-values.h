@@ -46,6 +46,9 @@ public:
   static constexpr auto &PROC_MACRO_DERIVE = "proc_macro_derive";
   static constexpr auto &PROC_MACRO_ATTRIBUTE = "proc_macro_attribute";
   static constexpr auto &TARGET_FEATURE = "target_feature";
+  static constexpr auto &THREAD_LOCAL = "thread_local";
+  static constexpr auto &TEST = "test";
+  static constexpr auto &BENCH = "bench";
   // From now on, these are reserved by the compiler and gated through
   // #![feature(rustc_attrs)]
   static constexpr auto &RUSTC_DEPRECATED = "rustc_deprecated";
@@ -57,6 +60,45 @@ public:
   static constexpr auto &RUSTC_CONST_UNSTABLE = "rustc_const_unstable";
   static constexpr auto &MAY_DANGLE = "may_dangle";
 };
+
+// The builtin attributes, as recognized by Analysis::BuiltinAttributeMappings.
+// AST::Attribute::get_builtin resolves an attribute to one of these once, so
+// that checking for an attribute does not need to build its path string.
+enum class BuiltinAttribute
+{
+  UNKNOWN,
+
+  INLINE,
+  COLD,
+  CFG,
+  CFG_ATTR,
+  DEPRECATED,
+  ALLOW,
+  ALLOW_INTERNAL_UNSTABLE,
+  DOC,
+  MUST_USE,
+  LANG,
+  LINK_SECTION,
+  NO_MANGLE,
+  REPR,
+  RUSTC_BUILTIN_MACRO,
+  PATH,
+  MACRO_USE,
+  MACRO_EXPORT,
+  PROC_MACRO,
+  PROC_MACRO_DERIVE,
+  PROC_MACRO_ATTRIBUTE,
+  TARGET_FEATURE,
+  THREAD_LOCAL,
+  TEST,
+  BENCH,
+  RUSTC_DEPRECATED,
+  RUSTC_INHERIT_OVERFLOW_CHECKS,
+  STABLE,
+  UNSTABLE,
+  RUSTC_CONST_STABLE,
+  RUSTC_CONST_UNSTABLE,
+};
 } // namespace Values
 } // namespace Rust
 
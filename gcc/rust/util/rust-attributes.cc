@@ -25,51 +25,59 @@
 #include "rust-diagnostics.h"
 #include "rust-unicode.h"
 #include "rust-attribute-values.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace Analysis {
 
 using Attrs = Values::Attributes;
+using Kind = Values::BuiltinAttribute;
 
 // https://doc.rust-lang.org/stable/nightly-rustc/src/rustc_feature/builtin_attrs.rs.html#248
 static const BuiltinAttrDefinition __definitions[]
-  = {{Attrs::INLINE, CODE_GENERATION},
-     {Attrs::COLD, CODE_GENERATION},
-     {Attrs::CFG, EXPANSION},
-     {Attrs::CFG_ATTR, EXPANSION},
-     {Attrs::DEPRECATED, STATIC_ANALYSIS},
-     {Attrs::ALLOW, STATIC_ANALYSIS},
-     {Attrs::ALLOW_INTERNAL_UNSTABLE, STATIC_ANALYSIS},
-     {Attrs::DOC, HIR_LOWERING},
-     {Attrs::MUST_USE, STATIC_ANALYSIS},
-     {Attrs::LANG, HIR_LOWERING},
-     {Attrs::LINK_SECTION, CODE_GENERATION},
-     {Attrs::NO_MANGLE, CODE_GENERATION},
-     {Attrs::REPR, CODE_GENERATION},
-     {Attrs::RUSTC_BUILTIN_MACRO, EXPANSION},
-     {Attrs::PATH, EXPANSION},
-     {Attrs::MACRO_USE, NAME_RESOLUTION},
-     {Attrs::MACRO_EXPORT, NAME_RESOLUTION},
-     {Attrs::PROC_MACRO, EXPANSION},
-     {Attrs::PROC_MACRO_DERIVE, EXPANSION},
-     {Attrs::PROC_MACRO_ATTRIBUTE, EXPANSION},
+  = {{Attrs::INLINE, CODE_GENERATION, Kind::INLINE},
+     {Attrs::COLD, CODE_GENERATION, Kind::COLD},
+     {Attrs::CFG, EXPANSION, Kind::CFG},
+     {Attrs::CFG_ATTR, EXPANSION, Kind::CFG_ATTR},
+     {Attrs::DEPRECATED, STATIC_ANALYSIS, Kind::DEPRECATED},
+     {Attrs::ALLOW, STATIC_ANALYSIS, Kind::ALLOW},
+     {Attrs::ALLOW_INTERNAL_UNSTABLE, STATIC_ANALYSIS,
+      Kind::ALLOW_INTERNAL_UNSTABLE},
+     {Attrs::DOC, HIR_LOWERING, Kind::DOC},
+     {Attrs::MUST_USE, STATIC_ANALYSIS, Kind::MUST_USE},
+     {Attrs::LANG, HIR_LOWERING, Kind::LANG},
+     {Attrs::LINK_SECTION, CODE_GENERATION, Kind::LINK_SECTION},
+     {Attrs::NO_MANGLE, CODE_GENERATION, Kind::NO_MANGLE},
+     {Attrs::REPR, CODE_GENERATION, Kind::REPR},
+     {Attrs::RUSTC_BUILTIN_MACRO, EXPANSION, Kind::RUSTC_BUILTIN_MACRO},
+     {Attrs::PATH, EXPANSION, Kind::PATH},
+     {Attrs::MACRO_USE, NAME_RESOLUTION, Kind::MACRO_USE},
+     {Attrs::MACRO_EXPORT, NAME_RESOLUTION, Kind::MACRO_EXPORT},
+     {Attrs::PROC_MACRO, EXPANSION, Kind::PROC_MACRO},
+     {Attrs::PROC_MACRO_DERIVE, EXPANSION, Kind::PROC_MACRO_DERIVE},
+     {Attrs::PROC_MACRO_ATTRIBUTE, EXPANSION, Kind::PROC_MACRO_ATTRIBUTE},
      // FIXME: This is not implemented yet, see
      // https://github.com/Rust-GCC/gccrs/issues/1475
-     {Attrs::TARGET_FEATURE, CODE_GENERATION},
+     {Attrs::TARGET_FEATURE, CODE_GENERATION, Kind::TARGET_FEATURE},
+     {Attrs::THREAD_LOCAL, CODE_GENERATION, Kind::THREAD_LOCAL},
+     {Attrs::TEST, EXPANSION, Kind::TEST},
+     {Attrs::BENCH, EXPANSION, Kind::BENCH},
      // From now on, these are reserved by the compiler and gated through
      // #![feature(rustc_attrs)]
-     {Attrs::RUSTC_DEPRECATED, STATIC_ANALYSIS},
-     {Attrs::RUSTC_INHERIT_OVERFLOW_CHECKS, CODE_GENERATION},
-     {Attrs::STABLE, STATIC_ANALYSIS},
-     {Attrs::UNSTABLE, STATIC_ANALYSIS},
+     {Attrs::RUSTC_DEPRECATED, STATIC_ANALYSIS, Kind::RUSTC_DEPRECATED},
+     {Attrs::RUSTC_INHERIT_OVERFLOW_CHECKS, CODE_GENERATION,
+      Kind::RUSTC_INHERIT_OVERFLOW_CHECKS},
+     {Attrs::STABLE, STATIC_ANALYSIS, Kind::STABLE},
+     {Attrs::UNSTABLE, STATIC_ANALYSIS, Kind::UNSTABLE},
      // assuming we keep these for static analysis
-     {Attrs::RUSTC_CONST_STABLE, STATIC_ANALYSIS},
-     {Attrs::RUSTC_CONST_UNSTABLE, STATIC_ANALYSIS}};
+     {Attrs::RUSTC_CONST_STABLE, STATIC_ANALYSIS, Kind::RUSTC_CONST_STABLE},
+     {Attrs::RUSTC_CONST_UNSTABLE, STATIC_ANALYSIS,
+      Kind::RUSTC_CONST_UNSTABLE}};
 
 BuiltinAttributeMappings *
 BuiltinAttributeMappings::get ()
 {
-  static BuiltinAttributeMappings *instance = nullptr;
+  auto &instance = ThreadState::current ().builtin_attributes;
   if (instance == nullptr)
     instance = new BuiltinAttributeMappings ();
 
@@ -269,10 +277,14 @@ AttributeChecker::check_attribute (const AST::Attribute &attribute)
     return;
 
   // TODO: Add checks here for each builtin attribute
-  // TODO: Have an enum of builtins as well, switching on strings is annoying
-  // and costly
-  if (result.name == Attrs::DOC)
-    check_doc_attribute (attribute);
+  switch (result.kind)
+    {
+    case Kind::DOC:
+      check_doc_attribute (attribute);
+      break;
+    default:
+      break;
+    }
 }
 
 void
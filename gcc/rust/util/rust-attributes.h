@@ -21,6 +21,7 @@
 #include "rust-ast.h"
 #include "rust-system.h"
 #include "rust-ast-visitor.h"
+#include "rust-attribute-values.h"
 
 namespace Rust {
 namespace Analysis {
@@ -41,10 +42,12 @@ struct BuiltinAttrDefinition
 {
   std::string name;
   CompilerPass handler;
+  Values::BuiltinAttribute kind;
 
   static BuiltinAttrDefinition get_error ()
   {
-    return BuiltinAttrDefinition{"", UNKNOWN};
+    return BuiltinAttrDefinition{"", UNKNOWN,
+				 Values::BuiltinAttribute::UNKNOWN};
   }
 
   static BuiltinAttrDefinition &error_node ()
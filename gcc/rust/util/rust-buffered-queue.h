@@ -23,12 +23,17 @@
 
 namespace Rust {
 /* Buffered queue implementation. Items are of type T, queue source is of type
- * Source. Note that this is owning of the source. */
+ * Source. Note that this is owning of the source.
+ *
+ * The queued items live in a ring buffer whose size is a power of two, so
+ * skipping items never moves the others and the buffer only grows when more
+ * items are queued at once than it can hold. */
 template <typename T, typename Source> class buffered_queue
 {
 public:
   // Construct empty queue from Source src.
-  buffered_queue (Source src) : source (src), start (0), end (0), buffer () {}
+  buffered_queue (Source src) : source (src), start (0), count (0), buffer ()
+  {}
 
   /* disable copying (since source is probably non-copyable)
    * TODO is this actually a good idea? If source is non-copyable, it would
@@ -40,87 +45,22 @@ public:
   buffered_queue (buffered_queue &&other) = default;
   buffered_queue &operator= (buffered_queue &&other) = default;
 
-  // Returns token at position start + n (i.e. n tokens ahead).
-  T peek (int n)
+  /* Returns token at position start + n (i.e. n tokens ahead). The reference
+   * is only valid until the queue is next modified or peeked past its end. */
+  const T &peek (int n)
   {
     // n should not be behind
     rust_assert (n >= 0);
 
-    int num_queued_items = end - start;
-    int num_items_required = n + 1;
-
     // if required items go past end of queue, add them to queue
-    if (num_items_required > num_queued_items)
-      {
-	int num_items_to_read = num_items_required - num_queued_items;
-
-	/* if queue length + extra items is larger than buffer size, expand
-	 * buffer */
-	if (end + num_items_to_read > (int) buffer.size ())
-	  {
-	    // Resize the buffer by 1.5x
-	    int new_size = (buffer.size () + num_items_to_read);
-	    new_size += (new_size >> 1);
-
-	    // old method:
-	    /*
-		  // create new queue buffer with new size
-		  std::vector<T> new_queue (new_size);
-		  std::copy (buffer.begin () + start, buffer.begin () + end,
-			     new_queue.begin ());
-		  start = 0;
-		  end = num_queued_items;
-		  // TODO: would move be better here? optimisation for move with
-		  // shared pointer?
-
-		  // swap member buffer and new queue buffer
-		  std::swap (buffer, new_queue);
-	    */
-
-	    // TODO: determine overhead of this approach vs copy. Should be
-	    // lower.
-	    std::vector<T> new_queue;
-	    new_queue.reserve (new_size);
-	    new_queue.insert (new_queue.begin (),
-			      std::make_move_iterator (buffer.begin () + start),
-			      std::make_move_iterator (buffer.begin () + end));
-	    start = 0;
-	    end = num_queued_items;
-	    // fill up rest of vector with junk so that indexing can work
-	    new_queue.insert (new_queue.begin () + end,
-			      new_size - new_queue.size (), T ());
-
-	    buffer = std::move (new_queue);
-	    /* this should be best method - std::move(range) would have
-	     * allocation problems; initial construction would require
-	     * reallocation upon resizing */
-
-	    // validate that buffer is large enough now
-	    rust_assert (end + num_items_to_read <= (int) buffer.size ());
-	  }
-
-	/* iterate through buffer and invoke operator () on source on values
-	 * past original end */
-	for (int i = 0; i < num_items_to_read; i++)
-	  buffer[end + i] = source.get ().next ();
-
-	// move end based on additional items added
-	end += num_items_to_read;
-      }
+    if (n >= count)
+      fill (n + 1);
 
-    rust_assert (0 <= start);
-    rust_assert (start <= end);
-    rust_assert (end <= (int) buffer.size ());
+    rust_assert (n < count);
 
-    rust_assert (start + n < end);
-
-    // return value at start + n in buffer
-    return buffer[start + n];
+    return buffer[index (n)];
   }
 
-  /* TODO: add faster peek current token to remove overhead of conditional
-   * branches? */
-
   // Advances start by n + 1.
   void skip (int n)
   {
@@ -129,51 +69,44 @@ public:
 
     // Clear queue values from start to n (inclusive).
     for (int i = 0; i < (n + 1); i++)
-      buffer[start + i] = T ();
-
-    // Move start forward by n + 1.
-    start += (n + 1);
+      buffer[index (i)] = T ();
 
-    // Ensure start is not impossible somehow
-    rust_assert (0 <= start);
-    rust_assert (start <= end);
+    start = index (n + 1);
+    count -= (n + 1);
 
-    // Compact buffer if empty
-    if (start == end)
-      start = end = 0;
+    rust_assert (count >= 0);
   }
 
-  /* Inserts element at front of vector. Really dirty hack with terrible
-   * performance, only use when really needed. */
+  // Inserts element at front of queue.
   void insert_at_front (T elem_to_insert)
   {
-    // TODO: test as this may not work properly
+    reserve (count + 1);
 
-    // Insert actual element in buffer at start.
-    buffer.insert (buffer.begin (), elem_to_insert);
-
-    /* Increase the end number since added element means all others have shifted
-     * one along */
-    end++;
+    start = (start - 1) & mask ();
+    buffer[start] = std::move (elem_to_insert);
+    count++;
   }
 
   // Insert at arbitrary position (attempt)
-  void insert (int index, T elem_to_insert)
+  void insert (int index_to_insert, T elem_to_insert)
   {
-    // TODO: test as this may not work properly
-
     // n should not be behind
-    rust_assert (index >= 0);
+    rust_assert (index_to_insert >= 0);
 
     // call peek to ensure that the items behind this (at least) are in queue
-    if (index >= 1)
-      peek (index - 1);
+    if (index_to_insert >= 1)
+      peek (index_to_insert - 1);
     else
-      peek (index);
+      peek (index_to_insert);
+
+    reserve (count + 1);
 
-    buffer.insert (buffer.begin () + start + index, std::move (elem_to_insert));
+    // shift the items after the insertion point one along
+    for (int i = count; i > index_to_insert; i--)
+      buffer[index (i)] = std::move (buffer[index (i - 1)]);
 
-    end++;
+    buffer[index (index_to_insert)] = std::move (elem_to_insert);
+    count++;
   }
 
   // Replaces the current value in the buffer. Total HACK.
@@ -188,15 +121,51 @@ public:
   }
 
 private:
+  int mask () const { return (int) buffer.size () - 1; }
+
+  // Position in the buffer of the item n items ahead of start
+  int index (int n) const { return (start + n) & mask (); }
+
+  // Grow the buffer so it can hold at least SIZE items, keeping their order
+  void reserve (int size)
+  {
+    if (size <= (int) buffer.size ())
+      return;
+
+    // start small, most lookahead is only a token or two
+    size_t new_size = buffer.empty () ? 16 : buffer.size ();
+    while (new_size < (size_t) size)
+      new_size *= 2;
+
+    std::vector<T> new_buffer (new_size);
+    for (int i = 0; i < count; i++)
+      new_buffer[i] = std::move (buffer[index (i)]);
+
+    buffer = std::move (new_buffer);
+    start = 0;
+  }
+
+  // Read items from the source until SIZE items are queued
+  void fill (int size)
+  {
+    reserve (size);
+
+    while (count < size)
+      {
+	buffer[index (count)] = source.get ().next ();
+	count++;
+      }
+  }
+
   // Source of tokens for queue.
   Source source;
 
-  // Begin of range in buffer, inclusive.
+  // Position of the first queued item in buffer.
   int start;
-  // End of range in buffer, exclusive.
-  int end;
+  // Number of queued items.
+  int count;
 
-  // Queue buffer.
+  // Queue buffer, its size is always zero or a power of two.
   std::vector<T> buffer;
 };
 } // namespace Rust
@@ -43,14 +43,21 @@ namespace Resolver {
 // impl Trait for Struct {
 //    fn f(&self) {} // <::a::Struct as ::a::Trait>::f
 // }
+//
+// Paths are immutable lists of segments sharing their prefixes, with each
+// segment pointing to its parent, so copying or extending a path does not
+// copy its segments. Every segment also keeps the string form of the path
+// ending with it.
 class CanonicalPath
 {
 public:
-  CanonicalPath (const CanonicalPath &other) : segs (other.segs) {}
+  CanonicalPath (const CanonicalPath &other)
+    : last (other.last), crate_num (other.crate_num)
+  {}
 
   CanonicalPath &operator= (const CanonicalPath &other)
   {
-    segs = other.segs;
+    last = other.last;
     crate_num = other.crate_num;
     return *this;
   }
@@ -58,7 +65,7 @@ public:
   static CanonicalPath new_seg (NodeId id, const std::string &path)
   {
     rust_assert (!path.empty ());
-    return CanonicalPath ({std::pair<NodeId, std::string> (id, path)},
+    return CanonicalPath (std::make_shared<const Segment> (nullptr, id, path),
 			  UNKNOWN_CRATENUM);
   }
 
@@ -76,16 +83,10 @@ public:
     return CanonicalPath::new_seg (id, "<" + impl_type_seg.get () + ">");
   }
 
-  std::string get () const
+  const std::string &get () const
   {
-    std::string buf;
-    for (size_t i = 0; i < segs.size (); i++)
-      {
-	bool have_more = (i + 1) < segs.size ();
-	const std::string &seg = segs.at (i).second;
-	buf += seg + (have_more ? "::" : "");
-      }
-    return buf;
+    static const std::string empty;
+    return is_empty () ? empty : last->path;
   }
 
   static CanonicalPath get_big_self (NodeId id)
@@ -95,22 +96,23 @@ public:
 
   static CanonicalPath create_empty ()
   {
-    return CanonicalPath ({}, UNKNOWN_CRATENUM);
+    return CanonicalPath (nullptr, UNKNOWN_CRATENUM);
   }
 
-  bool is_empty () const { return segs.size () == 0; }
+  bool is_empty () const { return last == nullptr; }
 
   CanonicalPath append (const CanonicalPath &other) const
   {
     rust_assert (!other.is_empty ());
     if (is_empty ())
-      return CanonicalPath (other.segs, crate_num);
+      return CanonicalPath (other.last, crate_num);
 
-    std::vector<std::pair<NodeId, std::string>> copy (segs);
-    for (auto &s : other.segs)
-      copy.push_back (s);
+    auto appended = last;
+    for (auto seg : other.get_segments ())
+      appended = std::make_shared<const Segment> (appended, seg->seg.first,
+						  seg->seg.second);
 
-    return CanonicalPath (copy, crate_num);
+    return CanonicalPath (appended, crate_num);
   }
 
   // if we have the path A::B::C this will give a callback for each segment
@@ -125,13 +127,9 @@ public:
   //   A::B::C
   void iterate (std::function<bool (const CanonicalPath &)> cb) const
   {
-    std::vector<std::pair<NodeId, std::string>> buf;
-    for (auto &seg : segs)
-      {
-	buf.push_back (seg);
-	if (!cb (CanonicalPath (buf, crate_num)))
-	  return;
-      }
+    for (auto seg : get_segments ())
+      if (!cb (CanonicalPath (seg, crate_num)))
+	return;
   }
 
   // if we have the path A::B::C this will give a callback for each segment
@@ -146,32 +144,40 @@ public:
   //         C
   void iterate_segs (std::function<bool (const CanonicalPath &)> cb) const
   {
-    for (auto &seg : segs)
+    for (auto seg : get_segments ())
       {
-	std::vector<std::pair<NodeId, std::string>> buf;
-	buf.push_back ({seg.first, seg.second});
-	if (!cb (CanonicalPath (buf, crate_num)))
+	auto single = seg->parent == nullptr
+			? seg
+			: std::make_shared<const Segment> (nullptr,
+							   seg->seg.first,
+							   seg->seg.second);
+	if (!cb (CanonicalPath (single, crate_num)))
 	  return;
       }
   }
 
-  size_t size () const { return segs.size (); }
+  size_t size () const { return is_empty () ? 0 : last->depth; }
 
   NodeId get_node_id () const
   {
-    rust_assert (!segs.empty ());
-    return segs.back ().first;
+    rust_assert (!is_empty ());
+    return last->seg.first;
   }
 
   const std::pair<NodeId, std::string> &get_seg_at (size_t index) const
   {
     rust_assert (index < size ());
-    return segs.at (index);
+
+    auto seg = last.get ();
+    for (size_t i = index + 1; i < size (); i++)
+      seg = seg->parent.get ();
+
+    return seg->seg;
   }
 
   bool is_equal (const CanonicalPath &b) const
   {
-    return get ().compare (b.get ()) == 0;
+    return last == b.last || get () == b.get ();
   }
 
   void set_crate_num (CrateNum n) { crate_num = n; }
@@ -187,12 +193,38 @@ public:
   bool operator< (const CanonicalPath &b) const { return get () < b.get (); }
 
 private:
-  explicit CanonicalPath (std::vector<std::pair<NodeId, std::string>> path,
+  struct Segment
+  {
+    Segment (std::shared_ptr<const Segment> parent, NodeId id,
+	     const std::string &name)
+      : parent (parent), seg (id, name),
+	depth (parent == nullptr ? 1 : parent->depth + 1),
+	path (parent == nullptr ? name : parent->path + "::" + name)
+    {}
+
+    std::shared_ptr<const Segment> parent;
+    std::pair<NodeId, std::string> seg;
+    size_t depth;
+    std::string path;
+  };
+
+  explicit CanonicalPath (std::shared_ptr<const Segment> last,
 			  CrateNum crate_num)
-    : segs (path), crate_num (crate_num)
+    : last (last), crate_num (crate_num)
   {}
 
-  std::vector<std::pair<NodeId, std::string>> segs;
+  // the segments of the path, from the first to the last one
+  std::vector<std::shared_ptr<const Segment>> get_segments () const
+  {
+    std::vector<std::shared_ptr<const Segment>> segments (size ());
+    auto seg = last;
+    for (size_t i = size (); i > 0; i--, seg = seg->parent)
+      segments[i - 1] = seg;
+
+    return segments;
+  }
+
+  std::shared_ptr<const Segment> last;
   CrateNum crate_num;
 };
 
@@ -0,0 +1,165 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_DENSE_ID_MAP_H
+#define RUST_DENSE_ID_MAP_H
+
+#include "rust-system.h"
+#include "optional.h"
+
+namespace Rust {
+
+/**
+ * A map from NodeIds or HirIds to small values, for the side tables which get
+ * an entry for most ids. Ids are handed out in sequence, so rather than a
+ * tree, this is a vector indexed by id, split into pages which only get
+ * allocated once an id in their range is inserted. Ids too large to have
+ * been allocated in sequence, such as UNKNOWN_NODEID, are kept in a map.
+ */
+template <typename T> class DenseIdMap
+{
+public:
+  void insert (uint32_t id, T value)
+  {
+    if (id >= kMaxDenseId)
+      {
+	sparse[id] = value;
+	return;
+      }
+
+    auto page_index = id >> kPageBits;
+    if (page_index >= pages.size ())
+      pages.resize (page_index + 1);
+
+    auto &page = pages[page_index];
+    if (page == nullptr)
+      page.reset (new Page ());
+
+    auto offset = id & kPageMask;
+    if (!page->present[offset])
+      dense_count++;
+    page->values[offset] = value;
+    page->present[offset] = true;
+  }
+
+  tl::optional<T> lookup (uint32_t id) const
+  {
+    if (id >= kMaxDenseId)
+      {
+	auto it = sparse.find (id);
+	if (it == sparse.end ())
+	  return tl::nullopt;
+
+	return it->second;
+      }
+
+    auto page_index = id >> kPageBits;
+    if (page_index >= pages.size () || pages[page_index] == nullptr)
+      return tl::nullopt;
+
+    auto &page = *pages[page_index];
+    auto offset = id & kPageMask;
+    if (!page.present[offset])
+      return tl::nullopt;
+
+    return page.values[offset];
+  }
+
+  void erase (uint32_t id)
+  {
+    if (id >= kMaxDenseId)
+      {
+	sparse.erase (id);
+	return;
+      }
+
+    auto page_index = id >> kPageBits;
+    if (page_index >= pages.size () || pages[page_index] == nullptr)
+      return;
+
+    auto &page = *pages[page_index];
+    auto offset = id & kPageMask;
+    if (page.present[offset])
+      dense_count--;
+    page.values[offset] = T ();
+    page.present[offset] = false;
+  }
+
+  size_t size () const { return dense_count + sparse.size (); }
+
+  // Remove every entry and give the pages back
+  void clear ()
+  {
+    std::vector<std::unique_ptr<Page>> ().swap (pages);
+    sparse.clear ();
+    dense_count = 0;
+  }
+
+  // An estimate of the memory held by the map, for -frust-mem-report
+  size_t allocated_bytes () const
+  {
+    size_t bytes = pages.capacity () * sizeof (std::unique_ptr<Page>);
+    for (auto &page : pages)
+      if (page != nullptr)
+	bytes += sizeof (Page);
+
+    return bytes + sparse.size () * sizeof (std::pair<const uint32_t, T>);
+  }
+
+  // Call CB on every entry in id order, until it returns false
+  void iterate (std::function<bool (uint32_t, T &)> cb)
+  {
+    for (uint32_t page_index = 0; page_index < pages.size (); page_index++)
+      {
+	auto &page = pages[page_index];
+	if (page == nullptr)
+	  continue;
+
+	for (uint32_t offset = 0; offset < kPageSize; offset++)
+	  if (page->present[offset]
+	      && !cb ((page_index << kPageBits) | offset, page->values[offset]))
+	    return;
+      }
+
+    for (auto &entry : sparse)
+      if (!cb (entry.first, entry.second))
+	return;
+  }
+
+private:
+  static const uint32_t kPageBits = 10;
+  static const uint32_t kPageSize = 1 << kPageBits;
+  static const uint32_t kPageMask = kPageSize - 1;
+  static const uint32_t kMaxDenseId = 1 << 28;
+
+  struct Page
+  {
+    Page () : values (), present () {}
+
+    std::array<T, kPageSize> values;
+    std::bitset<kPageSize> present;
+  };
+
+  std::vector<std::unique_ptr<Page>> pages;
+  std::map<uint32_t, T> sparse;
+  size_t dense_count = 0;
+};
+
+} // namespace Rust
+
+#endif // RUST_DENSE_ID_MAP_H
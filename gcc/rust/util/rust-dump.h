@@ -30,7 +30,9 @@ public:
 
   friend std::ostream &operator<< (std::ostream &stream, const Indent &indent)
   {
-    return stream << std::string (indent.tabs, '\t');
+    for (size_t i = 0; i < indent.tabs; i++)
+      stream.put ('\t');
+    return stream;
   };
 
   void increment () { tabs++; };
@@ -44,6 +46,44 @@ public:
 private:
   size_t tabs = 0;
 };
+
+/**
+ * Selection of the items dumped with -frust-dump-filter=PATH. An item is
+ * dumped when its path is PATH or is inside it, the modules enclosing PATH
+ * are dumped with only the items leading to it. Paths start with the crate
+ * name, e.g. `mycrate::module::function`.
+ */
+class DumpFilter
+{
+public:
+  enum Match
+  {
+    SKIP,
+    DESCEND,
+    DUMP,
+  };
+
+  static Match match (const std::string &filter, const std::string &path)
+  {
+    if (filter.empty () || is_inside (path, filter))
+      return DUMP;
+    if (is_inside (filter, path))
+      return DESCEND;
+
+    return SKIP;
+  }
+
+private:
+  // Is PATH the same as PARENT or one of the items it contains?
+  static bool is_inside (const std::string &path, const std::string &parent)
+  {
+    if (path.compare (0, parent.size (), parent) != 0)
+      return false;
+
+    return path.size () == parent.size ()
+	   || path.compare (parent.size (), 2, "::") == 0;
+  }
+};
 } // namespace Rust
 
 #endif
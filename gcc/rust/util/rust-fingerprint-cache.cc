@@ -0,0 +1,601 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-fingerprint-cache.h"
+#include "rust-ast-dump.h"
+#include "rust-ast-visitor.h"
+#include "rust-diagnostics.h"
+#include "rust-hir-map.h"
+#include "rust-item.h"
+#include "rust-macro.h"
+#include "fnv-hash.h"
+#include "selftest.h"
+
+namespace Rust {
+namespace Incremental {
+
+static const char kHeader[] = "gccrs-incremental 1\n";
+static const size_t kFingerprintSize = 32;
+
+static FingerprintCache::Fingerprint
+fingerprint_of (const std::string &text)
+{
+  static const char hex_digits[] = "0123456789abcdef";
+
+  Hash::FNV128 hasher;
+  hasher.write ((const unsigned char *) text.data (), text.size ());
+  uint64_t hi, lo;
+  hasher.sum (&hi, &lo);
+
+  FingerprintCache::Fingerprint fingerprint;
+  for (auto half : {hi, lo})
+    for (int shift = 60; shift >= 0; shift -= 4)
+      fingerprint += hex_digits[(half >> shift) & 0xf];
+
+  return fingerprint;
+}
+
+static bool
+read_file (const std::string &path, std::string &data)
+{
+  std::ifstream in (path, std::ios::binary);
+  if (in.fail ())
+    return false;
+
+  std::stringstream contents;
+  contents << in.rdbuf ();
+  data = contents.str ();
+  return !in.bad ();
+}
+
+// The identifiers of TEXT, which also picks up keywords and the words of
+// literals: the names they match only make the key cover more items
+static void
+collect_words (const std::string &text, std::set<std::string> &words)
+{
+  for (size_t i = 0; i < text.size ();)
+    {
+      if (!ISIDST (text[i]))
+	{
+	  i++;
+	  continue;
+	}
+
+      size_t start = i;
+      while (i < text.size () && ISIDNUM (text[i]))
+	i++;
+      words.insert (text.substr (start, i - start));
+    }
+}
+
+// Collects the names an item defines, and whether it is part of every unit
+class ItemSummary : public AST::DefaultASTVisitor
+{
+public:
+  using AST::DefaultASTVisitor::visit;
+
+  ItemSummary (FingerprintCache::Item &item) : item (item) {}
+
+  void go (AST::Item &node)
+  {
+    // lang items are used by the compiler without being named
+    for (auto &attr : node.get_outer_attrs ())
+      if (attr.get_builtin () == Values::BuiltinAttribute::LANG)
+	item.in_every_unit = true;
+
+    node.accept_vis (*this);
+  }
+
+  // a nested item is placed from its own path, which may be in another unit
+  void visit (AST::BlockExpr &expr) override
+  {
+    for (auto &stmt : expr.get_statements ())
+      if (stmt->get_stmt_kind () == AST::Stmt::Kind::Item)
+	item.in_every_unit = true;
+
+    AST::DefaultASTVisitor::visit (expr);
+  }
+
+  void visit (AST::Trait &trait) override
+  {
+    item.in_every_unit = true;
+    define (trait.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (trait);
+  }
+
+  void visit (AST::TraitImpl &impl) override
+  {
+    item.in_every_unit = true;
+    AST::DefaultASTVisitor::visit (impl);
+  }
+
+  void visit (AST::UseDeclaration &use_decl) override
+  {
+    item.in_every_unit = true;
+    AST::DefaultASTVisitor::visit (use_decl);
+  }
+
+  void visit (AST::ExternCrate &crate) override
+  {
+    item.in_every_unit = true;
+    AST::DefaultASTVisitor::visit (crate);
+  }
+
+  void visit (AST::MacroRulesDefinition &rules_def) override
+  {
+    item.in_every_unit = true;
+    AST::DefaultASTVisitor::visit (rules_def);
+  }
+
+  void visit (AST::Function &function) override
+  {
+    define (function.get_function_name ().as_string ());
+    AST::DefaultASTVisitor::visit (function);
+  }
+
+  void visit (AST::TypeAlias &type_alias) override
+  {
+    define (type_alias.get_new_type_name ().as_string ());
+    AST::DefaultASTVisitor::visit (type_alias);
+  }
+
+  void visit (AST::StructStruct &struct_item) override
+  {
+    define (struct_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (struct_item);
+  }
+
+  void visit (AST::TupleStruct &tuple_struct) override
+  {
+    define (tuple_struct.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (tuple_struct);
+  }
+
+  void visit (AST::Enum &enum_item) override
+  {
+    define (enum_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (enum_item);
+  }
+
+  void visit (AST::EnumItem &variant) override
+  {
+    define (variant.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (variant);
+  }
+
+  void visit (AST::EnumItemTuple &variant) override
+  {
+    define (variant.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (variant);
+  }
+
+  void visit (AST::EnumItemStruct &variant) override
+  {
+    define (variant.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (variant);
+  }
+
+  void visit (AST::EnumItemDiscriminant &variant) override
+  {
+    define (variant.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (variant);
+  }
+
+  void visit (AST::Union &union_item) override
+  {
+    define (union_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (union_item);
+  }
+
+  void visit (AST::ConstantItem &const_item) override
+  {
+    define (const_item.get_identifier ());
+    AST::DefaultASTVisitor::visit (const_item);
+  }
+
+  void visit (AST::StaticItem &static_item) override
+  {
+    define (static_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (static_item);
+  }
+
+  void visit (AST::TraitItemConst &const_item) override
+  {
+    define (const_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (const_item);
+  }
+
+  void visit (AST::TraitItemType &type_item) override
+  {
+    define (type_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (type_item);
+  }
+
+  void visit (AST::ExternalStaticItem &static_item) override
+  {
+    define (static_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (static_item);
+  }
+
+  void visit (AST::ExternalTypeItem &type_item) override
+  {
+    define (type_item.get_identifier ().as_string ());
+    AST::DefaultASTVisitor::visit (type_item);
+  }
+
+private:
+  void define (const std::string &name) { item.names.insert (name); }
+
+  FingerprintCache::Item &item;
+};
+
+FingerprintCache::FingerprintCache (std::string dir, std::string crate_name,
+				    unsigned unit)
+  : dir (std::move (dir)), crate_name (std::move (crate_name)), unit (unit)
+{}
+
+std::string
+FingerprintCache::get_path () const
+{
+  return dir + "/" + crate_name + "." + std::to_string (unit) + ".s";
+}
+
+bool
+FingerprintCache::fingerprint (
+  AST::Crate &crate, const std::string &environment,
+  const std::function<unsigned (const std::vector<std::string> &)> &unit_of)
+{
+  auto &mappings = Analysis::Mappings::get ();
+  std::vector<std::string> root = {mappings.get_current_crate_name ()};
+  if (!fingerprint_items (crate.items, root, root[0], false))
+    return false;
+
+  // the first unit also emits what is not placed in any unit
+  unsigned this_unit = unit;
+  key = unit_key (items, environment + std::to_string (unit) + "\n",
+		  [&] (const Item &item) {
+		    return this_unit == 0 || item.in_every_unit
+			   || unit_of (item.module) == this_unit;
+		  });
+
+  return true;
+}
+
+// Functions are placed with the module of their path, which ends before the
+// first impl block in it
+static std::vector<std::string>
+module_of (const Resolver::CanonicalPath &path)
+{
+  std::vector<std::string> module;
+  for (size_t i = 0; i + 1 < path.size (); i++)
+    {
+      auto &segment = path.get_seg_at (i).second;
+      if (segment[0] == '<')
+	break;
+      module.push_back (segment);
+    }
+
+  return module;
+}
+
+// Modules are not fingerprinted themselves, their items are. Without a path,
+// the items of a module are not placed and go in every unit.
+bool
+FingerprintCache::fingerprint_items (
+  std::vector<std::unique_ptr<AST::Item>> &crate_items,
+  const std::vector<std::string> &module, const std::string &parent,
+  bool in_every_unit)
+{
+  auto &mappings = Analysis::Mappings::get ();
+
+  for (size_t i = 0; i < crate_items.size (); i++)
+    {
+      auto &node = *crate_items[i];
+      if (node.is_marked_for_strip ())
+	continue;
+
+      // items without a canonical path, such as impl blocks, are keyed by
+      // their position in their module
+      Item item;
+      item.path = parent + "::{" + std::to_string (i) + "}";
+      item.module = module;
+      item.in_every_unit = in_every_unit;
+
+      auto canonical = mappings.lookup_canonical_path (node.get_node_id ());
+      bool has_path = canonical && !canonical->is_empty ();
+      if (has_path)
+	{
+	  auto &path = *canonical;
+	  item.path = path.get ();
+	  item.module = module_of (path);
+	  item.names.insert (path.get_seg_at (path.size () - 1).second);
+	}
+
+      if (node.get_ast_kind () == AST::Kind::MODULE)
+	{
+	  auto &submodule = static_cast<AST::Module &> (node);
+	  std::vector<std::string> segments;
+	  if (has_path)
+	    for (size_t seg = 0; seg < canonical->size (); seg++)
+	      segments.push_back (canonical->get_seg_at (seg).second);
+
+	  if (!fingerprint_items (submodule.get_items (), segments, item.path,
+				  in_every_unit || !has_path))
+	    return false;
+	  continue;
+	}
+
+      // the positions in the file end up in the debug information and the
+      // panic messages, so any change to the file changes its items
+      std::stringstream text;
+      AST::Dump (text).go (node);
+      text << "\n";
+      if (const char *file = LOCATION_FILE (node.get_locus ()))
+	{
+	  Fingerprint file_fingerprint;
+	  if (!fingerprint_file (file, file_fingerprint))
+	    return false;
+	  text << file << " " << file_fingerprint << "\n";
+	}
+
+      item.fingerprint = fingerprint_of (text.str ());
+      collect_words (text.str (), item.uses);
+      ItemSummary (item).go (node);
+
+      items.push_back (std::move (item));
+    }
+
+  return true;
+}
+
+bool
+FingerprintCache::fingerprint_file (const std::string &file,
+				    Fingerprint &fingerprint)
+{
+  auto it = files.find (file);
+  if (it == files.end ())
+    {
+      std::string contents;
+      if (!read_file (file, contents))
+	{
+	  rust_debug ("cannot read %s, not using the incremental cache",
+		      file.c_str ());
+	  return false;
+	}
+
+      it = files.emplace (file, fingerprint_of (contents)).first;
+    }
+
+  fingerprint = it->second;
+  return true;
+}
+
+/* The roots are part of the unit, with every item they name, transitively.
+   Names are matched as words, without resolving them: this covers more items
+   than needed, never fewer.  */
+
+FingerprintCache::Fingerprint
+FingerprintCache::unit_key (const std::vector<Item> &items,
+			    const std::string &environment,
+			    const std::function<bool (const Item &)> &is_root)
+{
+  std::map<std::string, std::vector<size_t>> defined_by;
+  for (size_t i = 0; i < items.size (); i++)
+    for (auto &name : items[i].names)
+      defined_by[name].push_back (i);
+
+  std::vector<bool> reached (items.size (), false);
+  std::vector<size_t> worklist;
+  for (size_t i = 0; i < items.size (); i++)
+    if (is_root (items[i]))
+      {
+	reached[i] = true;
+	worklist.push_back (i);
+      }
+
+  while (!worklist.empty ())
+    {
+      size_t i = worklist.back ();
+      worklist.pop_back ();
+
+      for (auto &use : items[i].uses)
+	{
+	  auto it = defined_by.find (use);
+	  if (it == defined_by.end ())
+	    continue;
+
+	  for (size_t j : it->second)
+	    if (!reached[j])
+	      {
+		reached[j] = true;
+		worklist.push_back (j);
+	      }
+	}
+    }
+
+  // the roots are told apart, so that moving an item between units changes
+  // the keys of both
+  std::string key = environment;
+  for (size_t i = 0; i < items.size (); i++)
+    if (reached[i])
+      key += items[i].fingerprint + (is_root (items[i]) ? " + " : " - ")
+	     + items[i].path + "\n";
+
+  return fingerprint_of (key);
+}
+
+bool
+FingerprintCache::load_output ()
+{
+  std::string data;
+  if (!read_file (get_path (), data))
+    return false;
+
+  if (!parse (data, key, output))
+    {
+      rust_debug ("not reusing %s, its key is not %s", get_path ().c_str (),
+		  key.c_str ());
+      return false;
+    }
+
+  return true;
+}
+
+void
+FingerprintCache::reuse_output (const char *asm_file) const
+{
+  FILE *file = fopen (asm_file, "wb");
+  if (file == NULL)
+    {
+      rust_error_at (UNDEF_LOCATION, "cannot open %s: %m", asm_file);
+      return;
+    }
+
+  bool ok = output.empty ()
+	    || fwrite (output.data (), output.size (), 1, file) == 1;
+  if (fclose (file) != 0 || !ok)
+    rust_error_at (UNDEF_LOCATION, "error writing to %s: %m", asm_file);
+}
+
+/* The entry is written under a temporary name and renamed into place, like the
+   entries of the metadata cache, so that an interrupted compilation never
+   leaves a partial entry behind.  */
+
+void
+FingerprintCache::store_output (const char *asm_file) const
+{
+  std::string compiled;
+  if (!read_file (asm_file, compiled))
+    return;
+
+  if (mkdir (dir.c_str (), 0777) != 0 && errno != EEXIST)
+    return;
+
+  std::string path = get_path ();
+  std::string tmp_path = path + "." + std::to_string (getpid ()) + ".tmp";
+  std::string data = serialize (key, compiled);
+
+  FILE *file = fopen (tmp_path.c_str (), "wb");
+  if (file == NULL)
+    return;
+
+  bool ok = fwrite (data.data (), data.size (), 1, file) == 1;
+  ok = fclose (file) == 0 && ok;
+
+  if (!ok || rename (tmp_path.c_str (), path.c_str ()) != 0)
+    {
+      rust_debug ("failed to store incremental cache entry %s", path.c_str ());
+      unlink (tmp_path.c_str ());
+    }
+}
+
+// The header, the key on a line of its own and the assembly
+std::string
+FingerprintCache::serialize (const Fingerprint &key, const std::string &output)
+{
+  return kHeader + key + "\n" + output;
+}
+
+bool
+FingerprintCache::parse (const std::string &data, const Fingerprint &key,
+			 std::string &output)
+{
+  const size_t header_size = sizeof (kHeader) - 1;
+  if (data.compare (0, header_size, kHeader) != 0)
+    return false;
+
+  if (key.size () != kFingerprintSize
+      || data.compare (header_size, kFingerprintSize + 1, key + "\n") != 0)
+    return false;
+
+  output = data.substr (header_size + kFingerprintSize + 1);
+  return true;
+}
+
+} // namespace Incremental
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_fingerprint_cache_test (void)
+{
+  using Rust::Incremental::FingerprintCache;
+
+  FingerprintCache::Fingerprint key (32, 'a');
+  std::string output;
+  ASSERT_TRUE (FingerprintCache::parse (
+    FingerprintCache::serialize (key, "\t.text\n"), key, output));
+  ASSERT_EQ (output, "\t.text\n");
+  ASSERT_TRUE (
+    FingerprintCache::parse (FingerprintCache::serialize (key, ""), key,
+			     output));
+  ASSERT_TRUE (output.empty ());
+
+  ASSERT_FALSE (FingerprintCache::parse ("", key, output));
+  ASSERT_FALSE (FingerprintCache::parse (
+    FingerprintCache::serialize (std::string (32, 'b'), "x"), key, output));
+  ASSERT_FALSE (FingerprintCache::parse ("gccrs-incremental 2\n" + key + "\n",
+					 key, output));
+
+  auto make_item = [] (std::string path, std::string fingerprint,
+		       std::set<std::string> uses) {
+    FingerprintCache::Item item;
+    item.path = "krate::" + path;
+    item.module = {"krate"};
+    item.fingerprint = fingerprint;
+    item.names = {path};
+    item.uses = uses;
+    item.in_every_unit = false;
+    return item;
+  };
+
+  // a calls b, c is unrelated
+  std::vector<FingerprintCache::Item> items
+    = {make_item ("a", std::string (32, '1'), {"fn", "a", "b"}),
+       make_item ("b", std::string (32, '2'), {"fn", "b"}),
+       make_item ("c", std::string (32, '3'), {"fn", "c"})};
+  auto only_a = [] (const FingerprintCache::Item &item) {
+    return item.path == "krate::a";
+  };
+  auto key_a = FingerprintCache::unit_key (items, "env", only_a);
+
+  // editing c leaves the key of a alone, editing b changes it
+  items[2].fingerprint = std::string (32, '4');
+  ASSERT_EQ (FingerprintCache::unit_key (items, "env", only_a), key_a);
+  items[1].fingerprint = std::string (32, '5');
+  ASSERT_NE (FingerprintCache::unit_key (items, "env", only_a), key_a);
+  items[1].fingerprint = std::string (32, '2');
+  ASSERT_EQ (FingerprintCache::unit_key (items, "env", only_a), key_a);
+
+  // so do a different environment and an item in every unit
+  ASSERT_NE (FingerprintCache::unit_key (items, "other", only_a), key_a);
+  items[2].in_every_unit = true;
+  ASSERT_NE (FingerprintCache::unit_key (
+	       items, "env",
+	       [&] (const FingerprintCache::Item &item) {
+		 return only_a (item) || item.in_every_unit;
+	       }),
+	     key_a);
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,122 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_FINGERPRINT_CACHE_H
+#define RUST_FINGERPRINT_CACHE_H
+
+#include "rust-system.h"
+#include "rust-ast.h"
+
+namespace Rust {
+namespace Incremental {
+
+/**
+ * The -frust-incremental cache of a codegen unit: the assembly it was compiled
+ * to, under a key which covers everything the assembly depends on. When the
+ * key of a compilation is the one in the cache, type checking and code
+ * generation are skipped and the cached assembly is written out instead.
+ *
+ * The items of the crate are fingerprinted once macros are expanded and names
+ * are resolved, from their pretty printed AST and from the source file they
+ * come from, which places them. The key of a unit is the fingerprint of its
+ * items, of the items they name, transitively, and of the environment of the
+ * compilation: the compiler, its options and the crates it imports. The first
+ * unit holds the items placed nowhere else and the metadata, its key covers
+ * the whole crate.
+ */
+class FingerprintCache
+{
+public:
+  // Hex encoded 128-bit FNV hash
+  using Fingerprint = std::string;
+
+  struct Item
+  {
+    // The canonical path of the item, or its position in its module
+    std::string path;
+    // The module the item is placed with, from the crate name
+    std::vector<std::string> module;
+    Fingerprint fingerprint;
+    // The names the item defines, and the identifiers it uses
+    std::set<std::string> names;
+    std::set<std::string> uses;
+    /* Trait impls, which are used without being named, and the items which
+       change the meaning of names or contain items placed on their own, are
+       part of every unit.  */
+    bool in_every_unit;
+  };
+
+  FingerprintCache (std::string dir, std::string crate_name, unsigned unit);
+
+  /* Fingerprint the items of the expanded and resolved CRATE, and key the unit
+     from them and from ENVIRONMENT. UNIT_OF places the items of a module.
+     Returns false when a source file of the crate can't be read.  */
+  bool
+  fingerprint (AST::Crate &crate, const std::string &environment,
+	       const std::function<unsigned (const std::vector<std::string> &)>
+		 &unit_of);
+
+  /* Read the assembly of a compilation with the same key from the cache.
+     Returns false when there is none.  */
+  bool load_output ();
+
+  /* Once the assembly file ASM_FILE is closed, replace it with the cached one,
+     or store it in the cache. Failing to store it is not an error.  */
+  void reuse_output (const char *asm_file) const;
+  void store_output (const char *asm_file) const;
+
+  // The key of the unit whose items are those for which IS_ROOT is true
+  static Fingerprint
+  unit_key (const std::vector<Item> &items, const std::string &environment,
+	    const std::function<bool (const Item &)> &is_root);
+
+  static std::string serialize (const Fingerprint &key,
+				const std::string &output);
+  static bool parse (const std::string &data, const Fingerprint &key,
+		     std::string &output);
+
+private:
+  bool fingerprint_items (std::vector<std::unique_ptr<AST::Item>> &items,
+			  const std::vector<std::string> &module,
+			  const std::string &parent, bool in_every_unit);
+  bool fingerprint_file (const std::string &file, Fingerprint &fingerprint);
+
+  std::string get_path () const;
+
+  std::string dir;
+  std::string crate_name;
+  unsigned unit;
+  std::vector<Item> items;
+  std::map<std::string, Fingerprint> files;
+  Fingerprint key;
+  std::string output;
+};
+
+} // namespace Incremental
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_fingerprint_cache_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_FINGERPRINT_CACHE_H
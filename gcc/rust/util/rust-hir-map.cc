@@ -25,6 +25,7 @@
 #include "rust-macro-builtins.h"
 #include "rust-mapping-common.h"
 #include "rust-attribute-values.h"
+#include "rust-thread-state.h"
 
 namespace Rust {
 namespace Analysis {
@@ -113,8 +114,11 @@ Mappings::~Mappings () { delete builtinMarker; }
 Mappings &
 Mappings::get ()
 {
-  static Mappings instance{};
-  return instance;
+  auto &instance = ThreadState::current ().mappings;
+  if (instance == nullptr)
+    instance = new Mappings ();
+
+  return *instance;
 }
 
 CrateNum
@@ -194,27 +198,43 @@ Mappings::node_is_crate (NodeId node_id) const
 }
 
 NodeId
-Mappings::get_next_node_id ()
+Mappings::reserve_node_ids (NodeId count)
 {
-  auto it = nodeIdIter;
-  nodeIdIter++;
-  return it;
+  return nodeIdIter.fetch_add (count);
 }
 
 HirId
-Mappings::get_next_hir_id (CrateNum crateNum)
+Mappings::reserve_hir_ids (CrateNum crateNum, HirId count)
 {
-  auto id = hirIdIter;
-  hirIdIter++;
+  HirId begin = hirIdIter.fetch_add (count);
+  HirId end = begin + count;
 
-  auto it = hirNodesWithinCrate.find (crateNum);
-  if (it == hirNodesWithinCrate.end ())
-    {
-      hirNodesWithinCrate.insert ({crateNum, {}});
-    }
+  std::lock_guard<std::mutex> guard (hirIdRangesLock);
+  auto &ranges = hirIdRanges[crateNum];
 
-  hirNodesWithinCrate[crateNum].insert (id);
-  return id;
+  // ids are mostly allocated one crate after the other, so this usually just
+  // grows the last range
+  if (!ranges.empty () && ranges.back ().second == begin)
+    ranges.back ().second = end;
+  else
+    ranges.emplace_back (begin, end);
+
+  return begin;
+}
+
+bool
+Mappings::is_hirid_within_crate (CrateNum crate, HirId id) const
+{
+  std::lock_guard<std::mutex> guard (hirIdRangesLock);
+  auto it = hirIdRanges.find (crate);
+  if (it == hirIdRanges.end ())
+    return false;
+
+  for (const auto &range : it->second)
+    if (id >= range.first && id < range.second)
+      return true;
+
+  return false;
 }
 
 LocalDefId
@@ -530,7 +550,7 @@ void
 Mappings::insert_hir_expr (HIR::Expr *expr)
 {
   auto id = expr->get_mappings ().get_hirid ();
-  hirExprMappings[id] = expr;
+  hirExprMappings.insert (id, expr);
 
   insert_node_to_hir (expr->get_mappings ().get_nodeid (), id);
   insert_location (id, expr->get_locus ());
@@ -539,9 +559,26 @@ Mappings::insert_hir_expr (HIR::Expr *expr)
 tl::optional<HIR::Expr *>
 Mappings::lookup_hir_expr (HirId id)
 {
-  auto it = hirExprMappings.find (id);
-  if (it == hirExprMappings.end ())
-    return tl::nullopt;
+  return hirExprMappings.lookup (id);
+}
+
+void
+Mappings::insert_expr_attrs (HirId id, AST::AttrVec attrs)
+{
+  if (attrs.empty ())
+    hirExprAttributes.erase (id);
+  else
+    hirExprAttributes[id] = std::move (attrs);
+}
+
+const AST::AttrVec &
+Mappings::lookup_expr_attrs (HirId id) const
+{
+  static const AST::AttrVec empty;
+
+  auto it = hirExprAttributes.find (id);
+  if (it == hirExprAttributes.end ())
+    return empty;
 
   return it->second;
 }
@@ -552,7 +589,7 @@ Mappings::insert_hir_path_expr_seg (HIR::PathExprSegment *expr)
   auto id = expr->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_path_expr_seg (id));
 
-  hirPathSegMappings[id] = expr;
+  hirPathSegMappings.insert (id, expr);
   insert_node_to_hir (expr->get_mappings ().get_nodeid (), id);
   insert_location (id, expr->get_locus ());
 }
@@ -560,11 +597,7 @@ Mappings::insert_hir_path_expr_seg (HIR::PathExprSegment *expr)
 tl::optional<HIR::PathExprSegment *>
 Mappings::lookup_hir_path_expr_seg (HirId id)
 {
-  auto it = hirPathSegMappings.find (id);
-  if (it == hirPathSegMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirPathSegMappings.lookup (id);
 }
 
 void
@@ -573,7 +606,7 @@ Mappings::insert_hir_generic_param (HIR::GenericParam *param)
   auto id = param->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_generic_param (id));
 
-  hirGenericParamMappings[id] = param;
+  hirGenericParamMappings.insert (id, param);
   insert_node_to_hir (param->get_mappings ().get_nodeid (), id);
   insert_location (id, param->get_locus ());
 }
@@ -581,11 +614,7 @@ Mappings::insert_hir_generic_param (HIR::GenericParam *param)
 tl::optional<HIR::GenericParam *>
 Mappings::lookup_hir_generic_param (HirId id)
 {
-  auto it = hirGenericParamMappings.find (id);
-  if (it == hirGenericParamMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirGenericParamMappings.lookup (id);
 }
 
 void
@@ -594,18 +623,14 @@ Mappings::insert_hir_type (HIR::Type *type)
   auto id = type->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_type (id));
 
-  hirTypeMappings[id] = type;
+  hirTypeMappings.insert (id, type);
   insert_node_to_hir (type->get_mappings ().get_nodeid (), id);
 }
 
 tl::optional<HIR::Type *>
 Mappings::lookup_hir_type (HirId id)
 {
-  auto it = hirTypeMappings.find (id);
-  if (it == hirTypeMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirTypeMappings.lookup (id);
 }
 
 void
@@ -614,18 +639,14 @@ Mappings::insert_hir_stmt (HIR::Stmt *stmt)
   auto id = stmt->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_stmt (id));
 
-  hirStmtMappings[id] = stmt;
+  hirStmtMappings.insert (id, stmt);
   insert_node_to_hir (stmt->get_mappings ().get_nodeid (), id);
 }
 
 tl::optional<HIR::Stmt *>
 Mappings::lookup_hir_stmt (HirId id)
 {
-  auto it = hirStmtMappings.find (id);
-  if (it == hirStmtMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirStmtMappings.lookup (id);
 }
 
 void
@@ -634,18 +655,14 @@ Mappings::insert_hir_param (HIR::FunctionParam *param)
   auto id = param->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_param (id));
 
-  hirParamMappings[id] = param;
+  hirParamMappings.insert (id, param);
   insert_node_to_hir (param->get_mappings ().get_nodeid (), id);
 }
 
 tl::optional<HIR::FunctionParam *>
 Mappings::lookup_hir_param (HirId id)
 {
-  auto it = hirParamMappings.find (id);
-  if (it == hirParamMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirParamMappings.lookup (id);
 }
 
 void
@@ -654,18 +671,14 @@ Mappings::insert_hir_self_param (HIR::SelfParam *param)
   auto id = param->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_self_param (id));
 
-  hirSelfParamMappings[id] = param;
+  hirSelfParamMappings.insert (id, param);
   insert_node_to_hir (param->get_mappings ().get_nodeid (), id);
 }
 
 tl::optional<HIR::SelfParam *>
 Mappings::lookup_hir_self_param (HirId id)
 {
-  auto it = hirSelfParamMappings.find (id);
-  if (it == hirSelfParamMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirSelfParamMappings.lookup (id);
 }
 
 void
@@ -674,18 +687,14 @@ Mappings::insert_hir_struct_field (HIR::StructExprField *field)
   auto id = field->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_struct_field (id));
 
-  hirStructFieldMappings[id] = field;
+  hirStructFieldMappings.insert (id, field);
   insert_node_to_hir (field->get_mappings ().get_nodeid (), id);
 }
 
 tl::optional<HIR::StructExprField *>
 Mappings::lookup_hir_struct_field (HirId id)
 {
-  auto it = hirStructFieldMappings.find (id);
-  if (it == hirStructFieldMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirStructFieldMappings.lookup (id);
 }
 
 void
@@ -694,18 +703,14 @@ Mappings::insert_hir_pattern (HIR::Pattern *pattern)
   auto id = pattern->get_mappings ().get_hirid ();
   rust_assert (!lookup_hir_pattern (id));
 
-  hirPatternMappings[id] = pattern;
+  hirPatternMappings.insert (id, pattern);
   insert_node_to_hir (pattern->get_mappings ().get_nodeid (), id);
 }
 
 tl::optional<HIR::Pattern *>
 Mappings::lookup_hir_pattern (HirId id)
 {
-  auto it = hirPatternMappings.find (id);
-  if (it == hirPatternMappings.end ())
-    return tl::nullopt;
-
-  return it->second;
+  return hirPatternMappings.lookup (id);
 }
 
 void
@@ -748,55 +753,42 @@ Mappings::walk_local_defids_for_crate (CrateNum crateNum,
 void
 Mappings::insert_node_to_hir (NodeId id, HirId ref)
 {
-  nodeIdToHirMappings[id] = ref;
-  hirIdToNodeMappings[ref] = id;
+  nodeIdToHirMappings.insert (id, ref);
+  hirIdToNodeMappings.insert (ref, id);
 }
 
 tl::optional<HirId>
 Mappings::lookup_node_to_hir (NodeId id)
 {
-  auto it = nodeIdToHirMappings.find (id);
-  if (it == nodeIdToHirMappings.end ())
-    return tl::nullopt;
-
-  return {it->second};
+  return nodeIdToHirMappings.lookup (id);
 }
 
 tl::optional<NodeId>
 Mappings::lookup_hir_to_node (HirId id)
 {
-  auto it = hirIdToNodeMappings.find (id);
-  if (it == hirIdToNodeMappings.end ())
-    return tl::nullopt;
-
-  return {it->second};
+  return hirIdToNodeMappings.lookup (id);
 }
 
 void
 Mappings::insert_location (HirId id, location_t locus)
 {
-  locations[id] = locus;
+  locations.insert (id, locus);
 }
 
 location_t
 Mappings::lookup_location (HirId id)
 {
-  auto it = locations.find (id);
-  if (it == locations.end ())
-    return UNDEF_LOCATION;
-
-  return it->second;
+  return locations.lookup (id).value_or (UNDEF_LOCATION);
 }
 
 tl::optional<HIR::Stmt *>
 Mappings::resolve_nodeid_to_stmt (NodeId id)
 {
-  auto it = nodeIdToHirMappings.find (id);
-  if (it == nodeIdToHirMappings.end ())
+  auto resolved = nodeIdToHirMappings.lookup (id);
+  if (!resolved)
     return tl::nullopt;
 
-  HirId resolved = it->second;
-  return lookup_hir_stmt (resolved);
+  return lookup_hir_stmt (resolved.value ());
 }
 
 void
@@ -919,6 +911,84 @@ Mappings::get_exported_macros ()
   return exportedMacros;
 }
 
+void
+Mappings::insert_shared_instance (const std::string &path,
+				  const std::string &symbol)
+{
+  sharedInstances.emplace_back (path, symbol);
+}
+
+const std::vector<std::pair<std::string, std::string>> &
+Mappings::get_shared_instances () const
+{
+  return sharedInstances;
+}
+
+void
+Mappings::insert_const_value (HirId id, const std::string &type,
+			      const std::string &value)
+{
+  constValues[id] = {type, value};
+}
+
+tl::optional<const std::pair<std::string, std::string> &>
+Mappings::lookup_const_value (HirId id) const
+{
+  auto it = constValues.find (id);
+  if (it == constValues.end ())
+    return tl::nullopt;
+
+  return it->second;
+}
+
+void
+Mappings::insert_unreachable_item (DefId id)
+{
+  unreachableItems.insert (id);
+}
+
+bool
+Mappings::is_unreachable_item (DefId id) const
+{
+  return unreachableItems.find (id) != unreachableItems.end ();
+}
+
+void
+Mappings::insert_reexported_item (NodeId id)
+{
+  reexportedItems.insert (id);
+}
+
+bool
+Mappings::is_reexported_item (NodeId id) const
+{
+  return reexportedItems.find (id) != reexportedItems.end ();
+}
+
+void
+Mappings::insert_compiler_generated_item (NodeId id)
+{
+  compilerGeneratedItems.insert (id);
+}
+
+bool
+Mappings::is_compiler_generated_item (NodeId id) const
+{
+  return compilerGeneratedItems.find (id) != compilerGeneratedItems.end ();
+}
+
+void
+Mappings::insert_upstream_instance (const std::string &symbol)
+{
+  upstreamInstances.insert (symbol);
+}
+
+bool
+Mappings::is_upstream_instance (const std::string &symbol) const
+{
+  return upstreamInstances.find (symbol) != upstreamInstances.end ();
+}
+
 void
 Mappings::insert_derive_proc_macros (CrateNum num,
 				     std::vector<CustomDeriveProcMacro> macros)
@@ -1258,5 +1328,105 @@ Mappings::lookup_trait_item_lang_item (LangItem::Kind item, location_t locus)
   return lookup_trait_item_defid (trait_item_id);
 }
 
+void
+Mappings::release_ast ()
+{
+  for (auto &crate : ast_crate_mappings)
+    delete crate.second;
+
+  ast_crate_mappings.clear ();
+  ast_item_mappings.clear ();
+  modules.clear ();
+  macroMappings.clear ();
+  macroInvocations.clear ();
+}
+
+void
+Mappings::release_hir ()
+{
+  for (auto &crate : hir_crate_mappings)
+    delete crate.second;
+
+  hir_crate_mappings.clear ();
+  defIdMappings.clear ();
+  defIdTraitItemMappings.clear ();
+  localDefIdMappings.clear ();
+  hirModuleMappings.clear ();
+  hirItemMappings.clear ();
+  hirEnumItemMappings.clear ();
+  hirTypeMappings.clear ();
+  hirExprMappings.clear ();
+  hirExprAttributes.clear ();
+  hirStmtMappings.clear ();
+  hirParamMappings.clear ();
+  hirStructFieldMappings.clear ();
+  hirImplItemMappings.clear ();
+  hirSelfParamMappings.clear ();
+  hirImplItemsToImplMappings.clear ();
+  hirImplBlockMappings.clear ();
+  hirImplBlockTypeMappings.clear ();
+  hirTraitItemMappings.clear ();
+  hirExternBlockMappings.clear ();
+  hirExternItemMappings.clear ();
+  hirPathSegMappings.clear ();
+  hirGenericParamMappings.clear ();
+  hirTraitItemsToTraitMappings.clear ();
+  hirPatternMappings.clear ();
+}
+
+template <typename T>
+static void
+dump_table (const char *name, const DenseIdMap<T> &table)
+{
+  fprintf (stderr,
+	   "  %-28s %10" GCC_PRISZ "u entries %10" GCC_PRISZ "u bytes\n", name,
+	   (fmt_size_t) table.size (), (fmt_size_t) table.allocated_bytes ());
+}
+
+template <typename Table>
+static void
+dump_table (const char *name, const Table &table)
+{
+  fprintf (stderr, "  %-28s %10" GCC_PRISZ "u entries\n", name,
+	   (fmt_size_t) table.size ());
+}
+
+size_t
+Mappings::get_node_id_count () const
+{
+  return nodeIdIter - kDefaultNodeIdBegin;
+}
+
+void
+Mappings::dump_memory_report () const
+{
+  fprintf (stderr, "  %-28s %10u\n", "NodeIds allocated",
+	   (unsigned) (nodeIdIter - kDefaultNodeIdBegin));
+  fprintf (stderr, "  %-28s %10u\n", "HirIds allocated",
+	   (unsigned) (hirIdIter - kDefaultHirIdBegin));
+
+  dump_table ("node to HirId", nodeIdToHirMappings);
+  dump_table ("HirId to node", hirIdToNodeMappings);
+  dump_table ("locations", locations);
+  dump_table ("canonical paths", paths);
+  dump_table ("AST items", ast_item_mappings);
+  dump_table ("AST modules", modules);
+  dump_table ("macro definitions", macroMappings);
+  dump_table ("macro invocations", macroInvocations);
+  dump_table ("visibilities", visibility_map);
+  dump_table ("HIR items", hirItemMappings);
+  dump_table ("HIR impl items", hirImplItemMappings);
+  dump_table ("HIR trait items", hirTraitItemMappings);
+  dump_table ("HIR types", hirTypeMappings);
+  dump_table ("HIR expressions", hirExprMappings);
+  dump_table ("HIR expression attributes", hirExprAttributes);
+  dump_table ("HIR statements", hirStmtMappings);
+  dump_table ("HIR patterns", hirPatternMappings);
+  dump_table ("HIR path segments", hirPathSegMappings);
+  dump_table ("HIR generic params", hirGenericParamMappings);
+  dump_table ("HIR function params", hirParamMappings);
+  dump_table ("constant values", constValues);
+}
+
 } // namespace Analysis
 } // namespace Rust
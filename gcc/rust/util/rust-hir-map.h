@@ -28,6 +28,7 @@
 #include "rust-hir-full-decls.h"
 #include "rust-lang-item.h"
 #include "rust-privacy-common.h"
+#include "rust-dense-id-map.h"
 #include "libproc_macro_internal/proc_macro.h"
 #include "rust-proc-macro.h"
 #include "optional.h"
@@ -88,9 +89,19 @@ public:
   tl::optional<NodeId> crate_num_to_nodeid (const CrateNum &crate_num) const;
   bool node_is_crate (NodeId node_id) const;
 
-  NodeId get_next_node_id ();
+  NodeId get_next_node_id () { return reserve_node_ids (1); }
+  // Number of NodeIds handed out so far, one per AST node
+  size_t get_node_id_count () const;
   HirId get_next_hir_id () { return get_next_hir_id (get_current_crate ()); }
-  HirId get_next_hir_id (CrateNum crateNum);
+  HirId get_next_hir_id (CrateNum crateNum)
+  {
+    return reserve_hir_ids (crateNum, 1);
+  }
+
+  // Reserve COUNT consecutive ids and return the first one. These can be
+  // called from several threads at once.
+  NodeId reserve_node_ids (NodeId count);
+  HirId reserve_hir_ids (CrateNum crateNum, HirId count);
   LocalDefId get_next_localdef_id ()
   {
     return get_next_localdef_id (get_current_crate ());
@@ -148,6 +159,9 @@ public:
   void insert_hir_expr (HIR::Expr *expr);
   tl::optional<HIR::Expr *> lookup_hir_expr (HirId id);
 
+  void insert_expr_attrs (HirId id, std::vector<AST::Attribute> attrs);
+  const std::vector<AST::Attribute> &lookup_expr_attrs (HirId id) const;
+
   void insert_hir_path_expr_seg (HIR::PathExprSegment *expr);
   tl::optional<HIR::PathExprSegment *> lookup_hir_path_expr_seg (HirId id);
 
@@ -184,10 +198,7 @@ public:
 
   tl::optional<HIR::Stmt *> resolve_nodeid_to_stmt (NodeId id);
 
-  std::set<HirId> &get_hirids_within_crate (CrateNum crate)
-  {
-    return hirNodesWithinCrate[crate];
-  }
+  bool is_hirid_within_crate (CrateNum crate, HirId id) const;
 
   void insert_impl_item_mapping (HirId impl_item_id, HIR::ImplBlock *impl)
   {
@@ -207,6 +218,7 @@ public:
     std::function<bool (HirId, HIR::ImplItem *, HIR::ImplBlock *)> cb);
 
   void iterate_impl_blocks (std::function<bool (HirId, HIR::ImplBlock *)> cb);
+  size_t get_impl_block_count () const { return hirImplBlockMappings.size (); }
 
   void iterate_trait_items (
     std::function<bool (HIR::TraitItem *item, HIR::Trait *)> cb);
@@ -288,6 +300,40 @@ public:
   void insert_exported_macro (AST::MacroRulesDefinition &def);
   std::vector<NodeId> &get_exported_macros ();
 
+  // Generic instances emitted by this crate which dependent crates may link
+  // against, as (canonical path, symbol) pairs
+  void insert_shared_instance (const std::string &path,
+			       const std::string &symbol);
+  const std::vector<std::pair<std::string, std::string>> &
+  get_shared_instances () const;
+
+  // Evaluated initializers of the scalar constants, as Rust source for the
+  // type and the value, which the metadata exporter writes instead of the
+  // initializer expressions
+  void insert_const_value (HirId id, const std::string &type,
+			   const std::string &value);
+  tl::optional<const std::pair<std::string, std::string> &>
+  lookup_const_value (HirId id) const;
+
+  // Items of this crate which no other crate can name, from the reachability
+  // analysis of the privacy pass
+  void insert_unreachable_item (DefId id);
+  bool is_unreachable_item (DefId id) const;
+
+  // Items and modules which a `pub use` makes nameable from other crates,
+  // whatever their own path, recorded by name resolution
+  void insert_reexported_item (NodeId id);
+  bool is_reexported_item (NodeId id) const;
+
+  // Items the compiler generated rather than expanded from the crate, which
+  // may use unstable features without the crate enabling them
+  void insert_compiler_generated_item (NodeId id);
+  bool is_compiler_generated_item (NodeId id) const;
+
+  // Symbols of the generic instances emitted by the extern crates
+  void insert_upstream_instance (const std::string &symbol);
+  bool is_upstream_instance (const std::string &symbol) const;
+
   void insert_derive_proc_macros (CrateNum num,
 				  std::vector<CustomDeriveProcMacro> macros);
   void insert_bang_proc_macros (CrateNum num,
@@ -352,13 +398,25 @@ public:
   tl::optional<HIR::TraitItem *>
   lookup_trait_item_lang_item (LangItem::Kind item, location_t locus);
 
+  /* Free the AST of every crate, once it has been lowered to HIR and nothing
+   * needs to look up AST nodes anymore. */
+  void release_ast ();
+
+  /* Free the HIR of every crate, once it has been compiled to GENERIC. The
+   * ids and canonical paths stay available. */
+  void release_hir ();
+
+  // Print the number of ids handed out and the size of the side tables to
+  // stderr, for -frust-mem-report and -fmem-report
+  void dump_memory_report () const;
+
 private:
   Mappings ();
 
   CrateNum crateNumItr;
   CrateNum currentCrateNum;
-  HirId hirIdIter;
-  NodeId nodeIdIter;
+  std::atomic<HirId> hirIdIter;
+  std::atomic<NodeId> nodeIdIter;
   std::map<CrateNum, LocalDefId> localIdIter;
   HIR::ImplBlock *builtinMarker;
 
@@ -372,37 +430,46 @@ private:
   std::map<HirId, HIR::Module *> hirModuleMappings;
   std::map<HirId, HIR::Item *> hirItemMappings;
   std::map<HirId, std::pair<HIR::Enum *, HIR::EnumItem *>> hirEnumItemMappings;
-  std::map<HirId, HIR::Type *> hirTypeMappings;
-  std::map<HirId, HIR::Expr *> hirExprMappings;
-  std::map<HirId, HIR::Stmt *> hirStmtMappings;
-  std::map<HirId, HIR::FunctionParam *> hirParamMappings;
-  std::map<HirId, HIR::StructExprField *> hirStructFieldMappings;
+  DenseIdMap<HIR::Type *> hirTypeMappings;
+  DenseIdMap<HIR::Expr *> hirExprMappings;
+  std::unordered_map<HirId, std::vector<AST::Attribute>> hirExprAttributes;
+  DenseIdMap<HIR::Stmt *> hirStmtMappings;
+  DenseIdMap<HIR::FunctionParam *> hirParamMappings;
+  DenseIdMap<HIR::StructExprField *> hirStructFieldMappings;
   std::map<HirId, std::pair<HirId, HIR::ImplItem *>> hirImplItemMappings;
-  std::map<HirId, HIR::SelfParam *> hirSelfParamMappings;
+  DenseIdMap<HIR::SelfParam *> hirSelfParamMappings;
   std::map<HirId, HIR::ImplBlock *> hirImplItemsToImplMappings;
   std::map<HirId, HIR::ImplBlock *> hirImplBlockMappings;
   std::map<HirId, HIR::ImplBlock *> hirImplBlockTypeMappings;
   std::map<HirId, HIR::TraitItem *> hirTraitItemMappings;
   std::map<HirId, HIR::ExternBlock *> hirExternBlockMappings;
   std::map<HirId, std::pair<HIR::ExternalItem *, HirId>> hirExternItemMappings;
-  std::map<HirId, HIR::PathExprSegment *> hirPathSegMappings;
-  std::map<HirId, HIR::GenericParam *> hirGenericParamMappings;
+  DenseIdMap<HIR::PathExprSegment *> hirPathSegMappings;
+  DenseIdMap<HIR::GenericParam *> hirGenericParamMappings;
   std::map<HirId, HIR::Trait *> hirTraitItemsToTraitMappings;
-  std::map<HirId, HIR::Pattern *> hirPatternMappings;
+  DenseIdMap<HIR::Pattern *> hirPatternMappings;
   std::map<LangItem::Kind, DefId> lang_item_mappings;
   std::map<NodeId, Resolver::CanonicalPath> paths;
-  std::map<NodeId, location_t> locations;
-  std::map<NodeId, HirId> nodeIdToHirMappings;
-  std::map<HirId, NodeId> hirIdToNodeMappings;
+  DenseIdMap<location_t> locations;
+  DenseIdMap<HirId> nodeIdToHirMappings;
+  DenseIdMap<NodeId> hirIdToNodeMappings;
 
-  // all hirid nodes
-  std::map<CrateNum, std::set<HirId>> hirNodesWithinCrate;
+  // all hirid nodes, as the [begin, end) ranges allocated for each crate
+  std::map<CrateNum, std::vector<std::pair<HirId, HirId>>> hirIdRanges;
+  mutable std::mutex hirIdRangesLock;
 
   // MBE macros
   std::map<NodeId, AST::MacroRulesDefinition *> macroMappings;
   std::map<NodeId, AST::MacroRulesDefinition *> macroInvocations;
   std::vector<NodeId> exportedMacros;
 
+  std::vector<std::pair<std::string, std::string>> sharedInstances;
+  std::map<HirId, std::pair<std::string, std::string>> constValues;
+  std::set<std::string> upstreamInstances;
+  std::set<NodeId> compilerGeneratedItems;
+  std::set<DefId> unreachableItems;
+  std::set<NodeId> reexportedItems;
+
   // Procedural macros
   std::map<CrateNum, std::vector<CustomDeriveProcMacro>>
     procmacrosDeriveMappings;
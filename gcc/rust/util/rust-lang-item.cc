@@ -55,6 +55,11 @@ const BiMap<std::string, LangItem::Kind> Rust::LangItem::lang_items = {{
   {"RangeInclusive", Kind::RANGE_INCLUSIVE},
   {"RangeToInclusive", Kind::RANGE_TO_INCLUSIVE},
   {"phantom_data", Kind::PHANTOM_DATA},
+  {"unsafe_cell", Kind::UNSAFE_CELL},
+  {"panic", Kind::PANIC},
+  {"panic_fmt", Kind::PANIC_FMT},
+  {"panic_bounds_check", Kind::PANIC_BOUNDS_CHECK},
+  {"begin_panic", Kind::BEGIN_PANIC},
   {"fn", Kind::FN},
   {"fn_mut", Kind::FN_MUT},
   {"fn_once", Kind::FN_ONCE},
@@ -62,6 +67,7 @@ const BiMap<std::string, LangItem::Kind> Rust::LangItem::lang_items = {{
   {"copy", Kind::COPY},
   {"clone", Kind::CLONE},
   {"sized", Kind::SIZED},
+  {"drop", Kind::DROP},
   {"slice_alloc", Kind::SLICE_ALLOC},
   {"slice_u8_alloc", Kind::SLICE_U8_ALLOC},
   {"str_alloc", Kind::STR_ALLOC},
@@ -71,6 +71,13 @@ public:
 
     // https://github.com/rust-lang/rust/blob/master/library/core/src/marker.rs
     PHANTOM_DATA,
+    UNSAFE_CELL,
+
+    // https://github.com/rust-lang/rust/blob/master/library/core/src/panicking.rs
+    PANIC,
+    PANIC_FMT,
+    PANIC_BOUNDS_CHECK,
+    BEGIN_PANIC,
 
     // functions
     FN,
@@ -83,6 +90,9 @@ public:
     CLONE,
     SIZED,
 
+    // https://github.com/rust-lang/rust/blob/master/library/core/src/ops/drop.rs
+    DROP,
+
     // https://github.com/Rust-GCC/gccrs/issues/1896
     // https://github.com/rust-lang/rust/commit/afbecc0f68c4dcfc4878ba5bcb1ac942544a1bdc
     // https://github.com/Rust-GCC/gccrs/issues/1494
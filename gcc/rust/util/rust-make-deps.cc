@@ -0,0 +1,176 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-make-deps.h"
+#include "rust-thread-state.h"
+#include "selftest.h"
+
+#ifndef TARGET_OBJECT_SUFFIX
+#define TARGET_OBJECT_SUFFIX ".o"
+#endif
+
+namespace Rust {
+
+MakeDependencies &
+MakeDependencies::get ()
+{
+  auto &instance = ThreadState::current ().make_dependencies;
+  if (instance == nullptr)
+    instance = new MakeDependencies ();
+
+  return *instance;
+}
+
+void
+MakeDependencies::add_dependency (const std::string &path)
+{
+  if (seen.insert (path).second)
+    dependencies.push_back (path);
+}
+
+void
+MakeDependencies::add_target (const std::string &target, bool quoted)
+{
+  targets.push_back (quoted ? quote (target) : target);
+}
+
+std::string
+MakeDependencies::quote (const std::string &path)
+{
+  std::string quoted;
+  unsigned slashes = 0;
+
+  for (char c : path)
+    {
+      switch (c)
+	{
+	case '\\':
+	  slashes++;
+	  quoted += c;
+	  continue;
+
+	case ' ':
+	case '\t':
+	  // backslashes before a blank must be doubled, as must the blank
+	  quoted.append (slashes, '\\');
+	  quoted += '\\';
+	  break;
+
+	case '$':
+	  quoted += '$';
+	  break;
+
+	case '#':
+	case ':':
+	  quoted += '\\';
+	  break;
+
+	default:
+	  break;
+	}
+
+      slashes = 0;
+      quoted += c;
+    }
+
+  return quoted;
+}
+
+// Append STR to OUT, wrapping the line so that it stays under 72 columns
+static void
+write_word (std::string &out, const std::string &str, unsigned &column)
+{
+  const unsigned colmax = 72;
+
+  if (column != 0)
+    {
+      if (column + str.size () > colmax)
+	{
+	  out += " \\\n ";
+	  column = 1;
+	}
+      else
+	{
+	  out += ' ';
+	  column++;
+	}
+    }
+
+  column += str.size ();
+  out += str;
+}
+
+static std::string
+object_name (const std::string &root)
+{
+  std::string base = lbasename (root.c_str ());
+  auto dot = base.rfind ('.');
+  if (dot != std::string::npos && dot != 0)
+    base.erase (dot);
+
+  return base + TARGET_OBJECT_SUFFIX;
+}
+
+void
+MakeDependencies::write (FILE *stream, bool phony) const
+{
+  std::string out;
+  unsigned column = 0;
+
+  if (!targets.empty ())
+    for (auto &target : targets)
+      write_word (out, target, column);
+  else if (!dependencies.empty ())
+    write_word (out, quote (object_name (dependencies.front ())), column);
+
+  out += ':';
+  column++;
+
+  for (auto &dep : dependencies)
+    write_word (out, quote (dep), column);
+
+  out += '\n';
+
+  if (phony)
+    for (size_t i = 1; i < dependencies.size (); i++)
+      out += "\n" + quote (dependencies[i]) + ":\n";
+
+  fputs (out.c_str (), stream);
+}
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_make_deps_test (void)
+{
+  using Rust::MakeDependencies;
+
+  ASSERT_EQ (MakeDependencies::quote ("src/lib.rs"), "src/lib.rs");
+  ASSERT_EQ (MakeDependencies::quote ("a b"), "a\\ b");
+  ASSERT_EQ (MakeDependencies::quote ("a\\ b"), "a\\\\\\ b");
+  ASSERT_EQ (MakeDependencies::quote ("$x#y:z"), "$$x\\#y\\:z");
+  ASSERT_EQ (MakeDependencies::quote ("a\\b"), "a\\b");
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,70 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_MAKE_DEPS_H
+#define RUST_MAKE_DEPS_H
+
+#include "rust-system.h"
+
+namespace Rust {
+
+/**
+ * The files read by the compilation of a crate, for the Make rules written
+ * with -M and -MD: the crate root, its out-of-line modules, the files of the
+ * `include!` family of macros and the extern crates, proc macros included.
+ */
+class MakeDependencies
+{
+public:
+  static MakeDependencies &get ();
+
+  // Dependencies are written in the order they are first added, the crate
+  // root comes first
+  void add_dependency (const std::string &path);
+
+  // Add a target of the rule, given with -MT or, when QUOTED, with -MQ
+  void add_target (const std::string &target, bool quoted);
+
+  /* Write the rule to STREAM. Without any target, the rule is for the object
+   * of the crate root. With PHONY, an empty rule is added for each dependency
+   * but the crate root, as with -MP. */
+  void write (FILE *stream, bool phony) const;
+
+  // Quote the characters of PATH which are special to Make
+  static std::string quote (const std::string &path);
+
+private:
+  MakeDependencies () {}
+
+  std::vector<std::string> targets;
+  std::vector<std::string> dependencies;
+  std::set<std::string> seen;
+};
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_make_deps_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_MAKE_DEPS_H
@@ -0,0 +1,129 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-module-prefetch.h"
+#include "rust-item.h"
+#include "rust-thread-state.h"
+
+namespace Rust {
+
+ModulePrefetcher &
+ModulePrefetcher::get ()
+{
+  auto &instance = ThreadState::current ().module_prefetcher;
+  if (instance == nullptr)
+    instance = new ModulePrefetcher ();
+
+  return *instance;
+}
+
+static tl::optional<std::string>
+read_file (const std::string &path)
+{
+  std::ifstream file (path, std::ios::binary);
+  if (!file)
+    return tl::nullopt;
+
+  std::ostringstream contents;
+  contents << file.rdbuf ();
+  if (file.bad ())
+    return tl::nullopt;
+
+  return contents.str ();
+}
+
+void
+ModulePrefetcher::collect (std::vector<std::unique_ptr<AST::Item>> &items,
+			   std::vector<std::string> &paths)
+{
+  for (auto &item : items)
+    {
+      if (item->get_ast_kind () != AST::Kind::MODULE)
+	continue;
+
+      auto &module = static_cast<AST::Module &> (*item);
+      if (module.get_kind () == AST::Module::LOADED)
+	{
+	  collect (module.get_items (), paths);
+	  continue;
+	}
+
+      // errors are reported when the module actually gets loaded, it might
+      // still be configured out
+      auto path = module.find_file_path (false);
+      if (path.has_value () && pending.find (path.value ()) == pending.end ())
+	paths.emplace_back (std::move (path.value ()));
+    }
+}
+
+void
+ModulePrefetcher::prefetch (std::vector<std::unique_ptr<AST::Item>> &items)
+{
+  if (flag_rust_parallel_modules <= 0)
+    return;
+
+  std::vector<std::string> paths;
+  collect (items, paths);
+  if (paths.empty ())
+    return;
+
+  size_t jobs = std::min<size_t> (flag_rust_parallel_modules, paths.size ());
+  std::vector<std::shared_ptr<Batch>> batches;
+  for (size_t i = 0; i < jobs; i++)
+    batches.emplace_back (new Batch ());
+
+  for (size_t i = 0; i < paths.size (); i++)
+    {
+      auto &batch = batches[i % jobs];
+      pending.emplace (paths[i],
+		       std::make_pair (batch, batch->paths.size ()));
+      batch->paths.emplace_back (std::move (paths[i]));
+    }
+
+  for (auto &batch : batches)
+    {
+      batch->contents.resize (batch->paths.size ());
+
+      // falls back to reading the files on the first take () if no thread
+      // can be started
+      Batch *raw = batch.get ();
+      auto read_batch = [raw] () {
+	for (size_t i = 0; i < raw->paths.size (); i++)
+	  raw->contents[i] = read_file (raw->paths[i]);
+      };
+
+      batch->done = std::async (worker_launch, read_batch).share ();
+    }
+}
+
+tl::optional<std::string>
+ModulePrefetcher::take (const std::string &path)
+{
+  auto it = pending.find (path);
+  if (it == pending.end ())
+    return tl::nullopt;
+
+  auto batch = it->second.first;
+  auto index = it->second.second;
+  pending.erase (it);
+
+  batch->done.wait ();
+  return std::move (batch->contents[index]);
+}
+
+} // namespace Rust
@@ -0,0 +1,73 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_MODULE_PREFETCH_H
+#define RUST_MODULE_PREFETCH_H
+
+#include "rust-system.h"
+#include "rust-ast.h"
+#include "optional.h"
+
+namespace Rust {
+
+/**
+ * Reads the files of out-of-line modules (`mod foo;`) on worker threads,
+ * ahead of the moment they get parsed.
+ *
+ * Lexing and parsing still happen on the main thread and in the usual order,
+ * since they allocate NodeIds, fill the line map and emit diagnostics, so the
+ * compiler's output is exactly the same. Only the file reads overlap with the
+ * rest of the pipeline. The number of threads comes from
+ * -frust-parallel-modules=, and prefetching is disabled when it is 0.
+ */
+class ModulePrefetcher
+{
+public:
+  static ModulePrefetcher &get ();
+
+  // Start reading the files of the unloaded modules declared in ITEMS,
+  // including the ones nested in inline modules.
+  void prefetch (std::vector<std::unique_ptr<AST::Item>> &items);
+
+  // Wait for the contents of PATH if it is being prefetched, and hand them
+  // over. Returns nothing if the file was not prefetched or could not be read,
+  // in which case the caller reads it itself.
+  tl::optional<std::string> take (const std::string &path);
+
+private:
+  ModulePrefetcher () {}
+
+  // Files read by the same worker, in order
+  struct Batch
+  {
+    std::vector<std::string> paths;
+    std::vector<tl::optional<std::string>> contents;
+    std::shared_future<void> done;
+  };
+
+  void collect (std::vector<std::unique_ptr<AST::Item>> &items,
+		std::vector<std::string> &paths);
+
+  // for each file being read, its batch and its index in the batch
+  std::unordered_map<std::string, std::pair<std::shared_ptr<Batch>, size_t>>
+    pending;
+};
+
+} // namespace Rust
+
+#endif // RUST_MODULE_PREFETCH_H
@@ -0,0 +1,167 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-self-profile.h"
+#include "rust-hir-map.h"
+#include "rust-thread-state.h"
+#include "options.h"
+#include "selftest.h"
+
+namespace Rust {
+
+SelfProfile &
+SelfProfile::get ()
+{
+  auto &instance = ThreadState::current ().self_profile;
+  if (instance == nullptr)
+    instance = new SelfProfile ();
+
+  return *instance;
+}
+
+SelfProfile::SelfProfile () : origin (std::chrono::steady_clock::now ()) {}
+
+bool
+SelfProfile::enabled ()
+{
+  return flag_rust_self_profile;
+}
+
+long
+SelfProfile::now () const
+{
+  auto elapsed = std::chrono::steady_clock::now () - origin;
+  return std::chrono::duration_cast<std::chrono::microseconds> (elapsed)
+    .count ();
+}
+
+void
+SelfProfile::add_event (const char *category, std::string name, long start,
+			long duration)
+{
+  events.push_back ({category, std::move (name), start, duration});
+}
+
+void
+SelfProfile::add_instance (const std::string &path)
+{
+  instances[path]++;
+}
+
+std::string
+SelfProfile::json_escape (const std::string &str)
+{
+  std::string escaped;
+  for (char c : str)
+    {
+      if (c == '"' || c == '\\')
+	{
+	  escaped += '\\';
+	  escaped += c;
+	}
+      else if ((unsigned char) c < 0x20)
+	{
+	  char buf[8];
+	  snprintf (buf, sizeof (buf), "\\u%04x", c);
+	  escaped += buf;
+	}
+      else
+	escaped += c;
+    }
+
+  return escaped;
+}
+
+/* Complete events ("ph": "X") carry both their start and their duration, so
+   the nesting of the passes is rebuilt by the viewer. Everything runs on the
+   main thread.  */
+
+void
+SelfProfile::write (std::ostream &stream) const
+{
+  stream << "{\"traceEvents\": [";
+  for (size_t i = 0; i < events.size (); i++)
+    {
+      auto &event = events[i];
+      stream << (i == 0 ? "\n" : ",\n") << "  {\"name\": \""
+	     << json_escape (event.name) << "\", \"cat\": \"" << event.category
+	     << "\", \"ph\": \"X\", \"ts\": " << event.start
+	     << ", \"dur\": " << event.duration << ", \"pid\": 1, \"tid\": 1}";
+    }
+  stream << "\n],\n\"displayTimeUnit\": \"ms\",\n";
+
+  // the viewers show these as metadata of the trace
+  stream << "\"otherData\": {";
+  bool first = true;
+  for (auto &instance : instances)
+    {
+      stream << (first ? "\n" : ",\n") << "  \"instances of "
+	     << json_escape (instance.first) << "\": \"" << instance.second
+	     << "\"";
+      first = false;
+    }
+  stream << "\n}}\n";
+}
+
+SelfProfileScope::SelfProfileScope (const char *category, NodeId node)
+  : active (SelfProfile::enabled ()), category (category), node (node),
+    start (active ? SelfProfile::get ().now () : 0)
+{}
+
+SelfProfileScope::SelfProfileScope (const char *category, const char *name)
+  : active (SelfProfile::enabled ()), category (category),
+    node (UNKNOWN_NODEID), name (active ? name : ""),
+    start (active ? SelfProfile::get ().now () : 0)
+{}
+
+SelfProfileScope::~SelfProfileScope ()
+{
+  if (!active)
+    return;
+
+  auto &profile = SelfProfile::get ();
+  long duration = profile.now () - start;
+
+  if (node != UNKNOWN_NODEID)
+    {
+      auto path = Analysis::Mappings::get ().lookup_canonical_path (node);
+      name = path ? path->get () : "node " + std::to_string (node);
+    }
+
+  profile.add_event (category, std::move (name), start, duration);
+}
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_self_profile_test (void)
+{
+  using Rust::SelfProfile;
+
+  ASSERT_EQ (SelfProfile::json_escape ("foo::bar<i32>"), "foo::bar<i32>");
+  ASSERT_EQ (SelfProfile::json_escape ("a\"b\\c"), "a\\\"b\\\\c");
+  ASSERT_EQ (SelfProfile::json_escape ("a\nb"), "a\\u000ab");
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,108 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_SELF_PROFILE_H
+#define RUST_SELF_PROFILE_H
+
+#include "rust-system.h"
+#include "rust-mapping-common.h"
+
+namespace Rust {
+
+/**
+ * The time spent on each item by the passes of the frontend, written with
+ * -frust-self-profile as a Chrome trace-event file (see the "Trace Event
+ * Format" document) which trace viewers such as Perfetto or chrome://tracing
+ * can load. Each event is named after the item it was recorded for and its
+ * category is the pass, e.g. "typecheck" or "compile". The number of
+ * instances compiled for each function is recorded alongside the events.
+ */
+class SelfProfile
+{
+public:
+  static SelfProfile &get ();
+
+  // Whether -frust-self-profile was given
+  static bool enabled ();
+
+  // Microseconds since the profile was started
+  long now () const;
+
+  void add_event (const char *category, std::string name, long start,
+		  long duration);
+
+  // Count one more compiled instance of the function at PATH
+  void add_instance (const std::string &path);
+
+  void write (std::ostream &stream) const;
+
+  // STR as the contents of a JSON string, with the control characters
+  // escaped as well
+  static std::string json_escape (const std::string &str);
+
+private:
+  SelfProfile ();
+
+  struct Event
+  {
+    const char *category;
+    std::string name;
+    long start;
+    long duration;
+  };
+
+  std::chrono::steady_clock::time_point origin;
+  std::vector<Event> events;
+  std::map<std::string, size_t> instances;
+};
+
+/**
+ * Records the time spent from its construction to its destruction as an
+ * event of the self profile, or nothing when profiling is disabled.
+ */
+class SelfProfileScope
+{
+public:
+  // The event is named after the canonical path of NODE, when it has one
+  SelfProfileScope (const char *category, NodeId node);
+  SelfProfileScope (const char *category, const char *name);
+  ~SelfProfileScope ();
+
+private:
+  SelfProfileScope (const SelfProfileScope &) = delete;
+  SelfProfileScope &operator= (const SelfProfileScope &) = delete;
+
+  bool active;
+  const char *category;
+  NodeId node;
+  std::string name;
+  long start;
+};
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_self_profile_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_SELF_PROFILE_H
@@ -0,0 +1,103 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-symbol.h"
+#include "rust-thread-state.h"
+#include "selftest.h"
+
+namespace Rust {
+
+struct SymbolTable
+{
+  std::unordered_map<std::string, uint32_t> ids;
+  // keys of `ids`, which never move, indexed by symbol
+  std::vector<const std::string *> names;
+  // threads adopting the state of another one share its table
+  std::mutex mutex;
+};
+
+static SymbolTable &
+symbol_table ()
+{
+  auto &table = ThreadState::current ().symbols;
+  if (table == nullptr)
+    table = new SymbolTable ();
+
+  return *table;
+}
+
+Symbol
+Symbol::intern (const std::string &name)
+{
+  auto &table = symbol_table ();
+  std::lock_guard<std::mutex> guard (table.mutex);
+  auto inserted = table.ids.emplace (name, table.names.size ());
+  if (inserted.second)
+    table.names.push_back (&inserted.first->first);
+
+  return Symbol (inserted.first->second);
+}
+
+tl::optional<Symbol>
+Symbol::lookup (const std::string &name)
+{
+  auto &table = symbol_table ();
+  std::lock_guard<std::mutex> guard (table.mutex);
+  auto it = table.ids.find (name);
+  if (it == table.ids.end ())
+    return tl::nullopt;
+
+  return Symbol (it->second);
+}
+
+const std::string &
+Symbol::as_string () const
+{
+  auto &table = symbol_table ();
+  std::lock_guard<std::mutex> guard (table.mutex);
+  return *table.names[id];
+}
+
+} // namespace Rust
+
+#if CHECKING_P
+
+namespace selftest {
+
+void
+rust_symbol_test (void)
+{
+  using Rust::Symbol;
+
+  auto foo = Symbol::intern ("foo");
+  auto bar = Symbol::intern ("bar");
+
+  ASSERT_TRUE (foo == Symbol::intern ("foo"));
+  ASSERT_TRUE (foo != bar);
+  ASSERT_EQ (foo.as_string (), "foo");
+  ASSERT_EQ (bar.as_string (), "bar");
+
+  auto found = Symbol::lookup ("bar");
+  ASSERT_TRUE (found.has_value ());
+  ASSERT_TRUE (found.value () == bar);
+  ASSERT_FALSE (Symbol::lookup ("never interned by this test").has_value ());
+}
+
+} // namespace selftest
+
+#endif // CHECKING_P
@@ -0,0 +1,74 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_SYMBOL_H
+#define RUST_SYMBOL_H
+
+#include "rust-system.h"
+#include "optional.h"
+
+namespace Rust {
+
+/**
+ * An interned name. Interning the same string always gives the same symbol,
+ * so symbols are compared and hashed as the 32-bit integer they wrap. Symbols
+ * live for the whole compilation.
+ */
+class Symbol
+{
+public:
+  static Symbol intern (const std::string &name);
+
+  // The symbol for NAME, if NAME was ever interned
+  static tl::optional<Symbol> lookup (const std::string &name);
+
+  const std::string &as_string () const;
+
+  uint32_t get_id () const { return id; }
+
+  bool operator== (const Symbol &other) const { return id == other.id; }
+  bool operator!= (const Symbol &other) const { return id != other.id; }
+
+private:
+  explicit Symbol (uint32_t id) : id (id) {}
+
+  uint32_t id;
+};
+
+} // namespace Rust
+
+namespace std {
+template <> struct hash<Rust::Symbol>
+{
+  size_t operator() (const Rust::Symbol &symbol) const
+  {
+    return symbol.get_id ();
+  }
+};
+} // namespace std
+
+#if CHECKING_P
+
+namespace selftest {
+extern void
+rust_symbol_test (void);
+} // namespace selftest
+
+#endif // CHECKING_P
+
+#endif // RUST_SYMBOL_H
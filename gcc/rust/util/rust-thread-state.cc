@@ -0,0 +1,42 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#include "rust-thread-state.h"
+
+namespace Rust {
+
+ThreadState &
+ThreadState::current ()
+{
+  // the contexts are never freed, like the process-wide instances they
+  // replace
+  static thread_local ThreadState state;
+  return state;
+}
+
+ThreadState::Adopt::Adopt (const ThreadState &state) : previous (current ())
+{
+  current () = state;
+}
+
+ThreadState::Adopt::~Adopt ()
+{
+  current () = previous;
+}
+
+} // namespace Rust
@@ -0,0 +1,123 @@
+// Copyright (C) 2020-2024 Free Software Foundation, Inc.
+
+// This file is part of GCC.
+
+// GCC is free software; you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3, or (at your option) any later
+// version.
+
+// GCC is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with GCC; see the file COPYING3.  If not see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef RUST_THREAD_STATE_H
+#define RUST_THREAD_STATE_H
+
+#include "rust-system.h"
+
+namespace Rust {
+
+struct Session;
+struct SymbolTable;
+struct TokenStringTable;
+struct ProcMacroSourceCache;
+class MakeDependencies;
+class ModulePrefetcher;
+class SelfProfile;
+class CheckRemarks;
+
+namespace Analysis {
+class Mappings;
+class BuiltinAttributeMappings;
+}
+namespace Resolver {
+class TypeCheckContext;
+class ImplIndex;
+class NameResolution;
+class Resolver;
+}
+namespace Resolver2_0 {
+class ImmutableNameResolutionContext;
+}
+namespace Compile {
+class BuiltinsContext;
+}
+namespace TyTy {
+class TypeInterner;
+}
+
+/**
+ * The frontend contexts reached through `get ()`, such as the Session or the
+ * Mappings, belong to the thread rather than to the process, so that
+ * independent crates can be compiled on different threads of the same
+ * process. Each thread creates its own contexts on first use.
+ *
+ * Threads helping another one with its compilation, such as the proc macro
+ * workers which call back into the lexer, must work on the contexts of that
+ * thread instead: they capture its state before being started, and adopt it
+ * with a ThreadState::Adopt for the duration of their work. The interners
+ * such threads may reach concurrently either lock their tables or, like the
+ * token texts, are only reached from the proc macro callbacks, which are
+ * serialized.
+ *
+ * Note that the middle-end keeps its own global state, so the contexts only
+ * make the frontend passes reentrant.
+ */
+struct ThreadState
+{
+  Session *session = nullptr;
+  Analysis::Mappings *mappings = nullptr;
+  Resolver::TypeCheckContext *typecheck = nullptr;
+  Resolver2_0::ImmutableNameResolutionContext *name_resolution = nullptr;
+  Compile::BuiltinsContext *builtins = nullptr;
+  Analysis::BuiltinAttributeMappings *builtin_attributes = nullptr;
+  Resolver::ImplIndex *impl_index = nullptr;
+  Resolver::NameResolution *legacy_name_resolution = nullptr;
+  Resolver::Resolver *legacy_resolver = nullptr;
+  TyTy::TypeInterner *type_interner = nullptr;
+  SymbolTable *symbols = nullptr;
+  TokenStringTable *token_strings = nullptr;
+  ProcMacroSourceCache *proc_macro_sources = nullptr;
+  MakeDependencies *make_dependencies = nullptr;
+  ModulePrefetcher *module_prefetcher = nullptr;
+  SelfProfile *self_profile = nullptr;
+  CheckRemarks *check_remarks = nullptr;
+
+  // The contexts of the calling thread
+  static ThreadState &current ();
+
+  class Adopt;
+};
+
+/* The policy with which the frontend starts its workers with std::async. They
+   run on threads of their own when configure found std::thread usable, and
+   are otherwise deferred until waited for, on the waiting thread.  */
+#ifdef HAVE_STD_THREAD
+const std::launch worker_launch = std::launch::async | std::launch::deferred;
+#else
+const std::launch worker_launch = std::launch::deferred;
+#endif
+
+// Make the calling thread work on the contexts of STATE until destroyed
+class ThreadState::Adopt
+{
+public:
+  explicit Adopt (const ThreadState &state);
+  ~Adopt ();
+
+  Adopt (const Adopt &) = delete;
+  Adopt &operator= (const Adopt &) = delete;
+
+private:
+  ThreadState previous;
+};
+
+} // namespace Rust
+
+#endif // RUST_THREAD_STATE_H
@@ -50,10 +50,15 @@ pop_group (std::vector<ProcMacro::TokenStream> &streams,
   streams.back ().push (tt);
 }
 
+static_assert (sizeof (location_t) <= sizeof (ProcMacro::Span::start),
+	       "a location must fit in the start of a span");
+
+// Spans are built in place rather than through Span::make_span, which
+// lives in libproc_macro_internal and cannot be inlined
 static ProcMacro::Span
 convert (location_t location)
 {
-  return ProcMacro::Span::make_span (location, 0);
+  return {location, 0};
 }
 
 static location_t
@@ -99,13 +104,59 @@ convert_literal (const_TokenPtr lit)
     }
 }
 
+/* Number of token trees directly held by the top level stream (last element)
+   and by the delimited group opened at each position of TOKENS, so that every
+   stream is allocated once with the right capacity rather than grown.  */
+
+static std::vector<std::uint64_t>
+count_group_sizes (const std::vector<const_TokenPtr> &tokens)
+{
+  std::vector<std::uint64_t> sizes (tokens.size () + 1, 0);
+  std::vector<size_t> open_groups = {tokens.size ()};
+
+  for (size_t i = 0; i < tokens.size (); i++)
+    {
+      auto id = tokens[i]->get_id ();
+      switch (id)
+	{
+	case LEFT_SQUARE:
+	case LEFT_CURLY:
+	case LEFT_PAREN:
+	  sizes[open_groups.back ()]++;
+	  open_groups.push_back (i);
+	  break;
+	case RIGHT_SQUARE:
+	case RIGHT_CURLY:
+	case RIGHT_PAREN:
+	  open_groups.pop_back ();
+	  break;
+	case IDENTIFIER:
+	  sizes[open_groups.back ()]++;
+	  break;
+	default:
+	  // punctuation is split into one token per character
+	  if (tokens[i]->is_literal () || token_id_is_keyword (id))
+	    sizes[open_groups.back ()]++;
+	  else
+	    sizes[open_groups.back ()] += tokens[i]->as_string ().size ();
+	  break;
+	}
+    }
+
+  return sizes;
+}
+
 ProcMacro::TokenStream
 convert (const std::vector<const_TokenPtr> &tokens)
 {
+  auto sizes = count_group_sizes (tokens);
+
   std::vector<ProcMacro::TokenStream> trees;
-  trees.push_back (ProcMacro::TokenStream::make_tokenstream ());
-  for (auto &token : tokens)
+  trees.push_back (ProcMacro::TokenStream::make_tokenstream (
+    std::max<std::uint64_t> (sizes.back (), 1)));
+  for (size_t i = 0; i < tokens.size (); i++)
     {
+      auto &token = tokens[i];
       auto loc = convert (token->get_locus ());
       switch (token->get_id ())
 	{
@@ -252,7 +303,8 @@ convert (const std::vector<const_TokenPtr> &tokens)
 	case LEFT_SQUARE:
 	case LEFT_CURLY:
 	case LEFT_PAREN:
-	  trees.push_back (ProcMacro::TokenStream::make_tokenstream ());
+	  trees.push_back (ProcMacro::TokenStream::make_tokenstream (
+	    std::max<std::uint64_t> (sizes[i], 1)));
 	  break;
 	default:
 	  rust_unreachable ();
@@ -439,10 +491,33 @@ from_tokenstream (const ProcMacro::TokenStream &ts,
     }
 }
 
+/* Number of tokens which converting TS produces, when no punctuation gets
+   joined into a single token: every tree gives a token and delimited groups
+   give one more.  */
+
+static size_t
+count_tokens (const ProcMacro::TokenStream &ts)
+{
+  size_t count = ts.size;
+  for (std::uint64_t i = 0; i < ts.size; i++)
+    if (ts.data[i].tag == ProcMacro::GROUP)
+      {
+	auto &group = ts.data[i].payload.group;
+	count += count_tokens (group.stream);
+	if (group.delimiter == ProcMacro::NONE)
+	  count--;
+	else
+	  count++;
+      }
+
+  return count;
+}
+
 std::vector<const_TokenPtr>
 convert (const ProcMacro::TokenStream &ts)
 {
   std::vector<const_TokenPtr> result;
+  result.reserve (count_tokens (ts));
   from_tokenstream (ts, result);
   return result;
 }
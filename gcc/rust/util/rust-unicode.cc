@@ -58,37 +58,57 @@ binary_search_ranges (
 int
 lookup_cc (codepoint_t c)
 {
-  auto it = CCC_TABLE.find (c.value);
-  if (it != CCC_TABLE.end ())
+  auto it
+    = std::lower_bound (CCC_TABLE.begin (), CCC_TABLE.end (), c.value,
+			[] (const std::pair<uint32_t, uint8_t> &entry,
+			    uint32_t cp) { return entry.first < cp; });
+  if (it != CCC_TABLE.end () && it->first == c.value)
     return it->second;
   else
     // Starter. Returns zero.
     return 0;
 }
 
+static tl::optional<codepoint_t>
+lookup_recomp_pair (uint32_t first, uint32_t second)
+{
+  auto it = std::lower_bound (RECOMPOSITION_MAP.begin (),
+			      RECOMPOSITION_MAP.end (),
+			      std::make_pair (first, second),
+			      [] (const RecompositionEntry &entry,
+				  const std::pair<uint32_t, uint32_t> &key) {
+				return std::make_pair (entry.first,
+						       entry.second)
+				       < key;
+			      });
+  if (it != RECOMPOSITION_MAP.end () && it->first == first
+      && it->second == second)
+    return {it->composite};
+
+  return tl::nullopt;
+}
+
 tl::optional<codepoint_t>
 lookup_recomp (codepoint_t starter, codepoint_t c)
 {
-  auto it = Rust::RECOMPOSITION_MAP.find ({starter.value, c.value});
-  if (it != Rust::RECOMPOSITION_MAP.end ())
-    return {it->second};
-
-  it = Rust::RECOMPOSITION_MAP.find ({starter.value, 0});
-  if (it != Rust::RECOMPOSITION_MAP.end ())
-    return {it->second};
+  if (auto composite = lookup_recomp_pair (starter.value, c.value))
+    return composite;
 
-  return tl::nullopt;
+  return lookup_recomp_pair (starter.value, 0);
 }
 
 void
 recursive_decomp_cano (codepoint_t c, string_t &buf)
 {
-  auto it = Rust::DECOMPOSITION_MAP.find (c.value);
-  if (it != Rust::DECOMPOSITION_MAP.end ())
+  auto it = std::lower_bound (DECOMPOSITION_MAP.begin (),
+			      DECOMPOSITION_MAP.end (), c.value,
+			      [] (const DecompositionEntry &entry,
+				  uint32_t cp) { return entry.codepoint < cp; });
+  if (it != DECOMPOSITION_MAP.end () && it->codepoint == c.value)
     {
-      std::vector<uint32_t> decomped = it->second;
-      for (uint32_t cp : decomped)
-	recursive_decomp_cano (cp, buf);
+      recursive_decomp_cano (it->first, buf);
+      if (it->second != 0)
+	recursive_decomp_cano (it->second, buf);
     }
   else
     buf.push_back (c);
@@ -54,7 +54,7 @@ public:
   };
 
   // Returns characters
-  std::vector<Codepoint> get_chars () const { return chars; }
+  const std::vector<Codepoint> &get_chars () const { return chars; }
 
   Utf8String nfc_normalize () const;
 };
@@ -0,0 +1,126 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU Proc Macro Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include "arena.h"
+
+#include <cstdint>
+
+namespace ProcMacro {
+
+namespace {
+
+enum BufferOwner : std::uint32_t
+{
+  HEAP_BUFFER = 0x48454150,
+  ARENA_BUFFER = 0x4152454e,
+};
+
+struct alignas (std::max_align_t) BufferHeader
+{
+  BufferOwner owner;
+};
+
+const std::size_t chunk_size = 64 * 1024;
+
+thread_local Arena *active_arena = nullptr;
+
+std::size_t
+align_size (std::size_t size)
+{
+  const std::size_t align = alignof (BufferHeader);
+  return (size + align - 1) & ~(align - 1);
+}
+
+} // namespace
+
+Arena::Arena () : chunks (), cursor (nullptr), left (0), size (0) {}
+
+Arena::~Arena ()
+{
+  for (auto *chunk : chunks)
+    delete[] chunk;
+}
+
+Arena::Scope::Scope (Arena &arena) : previous (active_arena)
+{
+  active_arena = &arena;
+}
+
+Arena::Scope::~Scope () { active_arena = previous; }
+
+void *
+Arena::allocate (std::size_t bytes)
+{
+  bytes = align_size (bytes);
+  if (bytes > left)
+    {
+      // oversized buffers get a chunk of their own, which leaves the current
+      // chunk in use
+      std::size_t new_size = bytes > chunk_size ? bytes : chunk_size;
+      auto *chunk = new char[new_size];
+      chunks.push_back (chunk);
+      size += new_size;
+      if (bytes > chunk_size)
+	return chunk;
+
+      cursor = chunk;
+      left = new_size;
+    }
+
+  void *result = cursor;
+  cursor += bytes;
+  left -= bytes;
+  return result;
+}
+
+void *
+allocate_buffer (std::size_t size)
+{
+  std::size_t total = sizeof (BufferHeader) + size;
+
+  BufferHeader *header;
+  if (active_arena != nullptr)
+    {
+      header = static_cast<BufferHeader *> (active_arena->allocate (total));
+      header->owner = ARENA_BUFFER;
+    }
+  else
+    {
+      header = reinterpret_cast<BufferHeader *> (new char[total]);
+      header->owner = HEAP_BUFFER;
+    }
+
+  return header + 1;
+}
+
+void
+release_buffer (const void *buf)
+{
+  if (buf == nullptr)
+    return;
+
+  auto *header = static_cast<const BufferHeader *> (buf) - 1;
+  if (header->owner == HEAP_BUFFER)
+    delete[] reinterpret_cast<const char *> (header);
+}
+
+} // namespace ProcMacro
@@ -0,0 +1,90 @@
+// Copyright (C) 2023-2024 Free Software Foundation, Inc.
+//
+// This file is part of the GNU Proc Macro Library.  This library is free
+// software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the
+// Free Software Foundation; either version 3, or (at your option)
+// any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+
+// You should have received a copy of the GNU General Public License and
+// a copy of the GCC Runtime Library Exception along with this program;
+// see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+namespace ProcMacro {
+
+// Storage for the strings and token trees of a single procedural macro
+// invocation, which is released in one go when the arena is destroyed.
+//
+// While a scope of an arena is active on a thread, the buffers of the
+// FFIStrings and TokenStreams created on that thread are allocated from the
+// arena, and dropping them does nothing.
+class Arena
+{
+public:
+  Arena ();
+  ~Arena ();
+
+  Arena (const Arena &) = delete;
+  Arena &operator= (const Arena &) = delete;
+
+  // Make ARENA the one used by the current thread for the lifetime of the
+  // scope
+  class Scope
+  {
+  public:
+    Scope (Arena &arena);
+    ~Scope ();
+
+    Scope (const Scope &) = delete;
+    Scope &operator= (const Scope &) = delete;
+
+  private:
+    Arena *previous;
+  };
+
+  void *allocate (std::size_t size);
+
+  // Total size of the chunks held by the arena
+  std::size_t get_size () const { return size; }
+
+private:
+  std::vector<char *> chunks;
+  char *cursor;
+  std::size_t left;
+  std::size_t size;
+};
+
+// Buffers start with a header recording where they were allocated, so that
+// whichever copy of this library drops them does the right thing: the copy
+// linked into a proc macro never has an arena of its own. Changing the header
+// requires bumping ABI_VERSION in registration.h.
+
+// Allocate SIZE bytes from the active arena, or from the heap if there is
+// none
+void *
+allocate_buffer (std::size_t size);
+
+// Release BUF, a buffer returned by allocate_buffer, unless it belongs to an
+// arena
+void
+release_buffer (const void *buf);
+
+} // namespace ProcMacro
+
+#endif /* ! ARENA_H */
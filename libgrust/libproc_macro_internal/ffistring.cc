@@ -22,12 +22,14 @@
 
 #include <cstring>
 #include "ffistring.h"
+#include "arena.h"
 
 namespace ProcMacro {
 void
 FFIString::drop (FFIString *str)
 {
-  delete[] str->data;
+  release_buffer (str->data);
+  str->data = nullptr;
   str->len = 0;
 }
 
@@ -41,7 +43,7 @@ FFIString::make_ffistring (const std::string &str)
 FFIString
 FFIString::make_ffistring (const unsigned char *data, std::uint64_t len)
 {
-  unsigned char *inner = new unsigned char[len];
+  auto *inner = static_cast<unsigned char *> (allocate_buffer (len));
   // FIXME: UTF-8 Update this with sizeof codepoint instead
   std::memcpy (inner, data, len * sizeof (unsigned char));
   return {inner, len};
@@ -50,7 +52,7 @@ FFIString::make_ffistring (const unsigned char *data, std::uint64_t len)
 FFIString
 FFIString::clone () const
 {
-  unsigned char *inner = new unsigned char[this->len];
+  auto *inner = static_cast<unsigned char *> (allocate_buffer (this->len));
   // FIXME: UTF-8 Update this with sizeof codepoint instead
   std::memcpy (inner, this->data, this->len * sizeof (unsigned char));
   return {inner, this->len};
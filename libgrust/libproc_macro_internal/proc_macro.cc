@@ -62,3 +62,4 @@ ProcMacro::ts_from_str_fn_t __gccrs_proc_macro_ts_from_str_ = nullptr;
 ProcMacro::lit_from_str_fn_t __gccrs_proc_macro_lit_from_str_ = nullptr;
 ProcMacro::BridgeState __gccrs_proc_macro_is_available_
   = ProcMacro::BridgeState::Unavailable;
+const std::uint32_t __gccrs_proc_macro_abi_version_ = ProcMacro::ABI_VERSION;
@@ -31,6 +31,7 @@
 #include "punct.h"
 #include "ident.h"
 #include "registration.h"
+#include "arena.h"
 
 namespace ProcMacro {
 
@@ -23,6 +23,7 @@
 #ifndef REGISTRATION_H
 #define REGISTRATION_H
 
+#include <cstdint>
 #include <string>
 #include "tokenstream.h"
 #include "bridge.h"
@@ -33,10 +34,24 @@ namespace ProcMacro {
 using ts_from_str_fn_t = ProcMacro::TokenStream (*) (std::string &, bool &);
 using lit_from_str_fn_t = ProcMacro::Literal (*) (const std::string &, bool &);
 
+// Version of the layout of the strings and token streams exchanged between
+// the compiler and a proc macro, bumped whenever it changes. The compiler
+// refuses the proc macros built against another version of this library.
+//
+// 1: buffers allocated with new[]
+// 2: buffers starting with the header of arena.h
+const std::uint32_t ABI_VERSION = 2;
+
 } // namespace ProcMacro
 
 extern "C" ProcMacro::ts_from_str_fn_t __gccrs_proc_macro_ts_from_str_;
 extern "C" ProcMacro::lit_from_str_fn_t __gccrs_proc_macro_lit_from_str_;
 extern "C" ProcMacro::BridgeState __gccrs_proc_macro_is_available_;
+extern "C" const std::uint32_t __gccrs_proc_macro_abi_version_;
+
+// Not defined by this library: a proc macro library defines it as non-zero
+// when its macros may run concurrently in the compiler's process. The others
+// are always run one at a time.
+extern "C" const std::uint32_t __gccrs_proc_macro_thread_safe_;
 
 #endif /* !REGISTRATION_H */
@@ -26,6 +26,9 @@
 #include <cstdint>
 
 namespace ProcMacro {
+
+// The compiler stores the location_t of a token in START, so that a span
+// converts to and from a location without any lookup. END is not used yet.
 struct Span
 {
   std::uint32_t start;
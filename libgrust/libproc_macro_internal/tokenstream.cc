@@ -23,16 +23,17 @@
 #include "tokenstream.h"
 #include "tokentree.h"
 #include "registration.h"
+#include "arena.h"
 
 #include <cstring>
 
 namespace ProcMacro {
 
 TokenStream
-TokenStream::make_tokenstream (std::vector<TokenTree> vec)
+TokenStream::make_tokenstream (const std::vector<TokenTree> &vec)
 {
   auto stream = make_tokenstream (vec.size ());
-  for (auto tt : vec)
+  for (auto &tt : vec)
     {
       stream.push (tt);
     }
@@ -42,7 +43,8 @@ TokenStream::make_tokenstream (std::vector<TokenTree> vec)
 TokenStream
 TokenStream::make_tokenstream (std::uint64_t capacity)
 {
-  auto *data = new TokenTree[capacity];
+  auto *data = static_cast<TokenTree *> (
+    allocate_buffer (capacity * sizeof (TokenTree)));
   return {data, 0, capacity};
 }
 
@@ -56,13 +58,27 @@ void
 TokenStream::grow (std::uint64_t delta)
 {
   auto new_capacity = capacity + (delta != 0 ? delta : 1);
-  auto *new_data = new TokenTree[new_capacity];
+  auto *new_data = static_cast<TokenTree *> (
+    allocate_buffer (new_capacity * sizeof (TokenTree)));
   capacity = new_capacity;
   std::memcpy (new_data, data, size * sizeof (TokenTree));
-  delete[] data;
+  release_buffer (data);
   data = new_data;
 }
 
+// Make room for ADDITIONAL more trees, so that they can be pushed without
+// reallocating. The capacity still at least doubles, so that reserving room
+// for a few trees at a time does not reallocate on every call.
+void
+TokenStream::reserve (std::uint64_t additional)
+{
+  if (capacity - size >= additional)
+    return;
+
+  auto needed = size + additional - capacity;
+  grow (needed > capacity ? needed : capacity);
+}
+
 void
 TokenStream::push (TokenTree tree)
 {
@@ -79,7 +95,8 @@ TokenStream::drop (TokenStream *stream)
     {
       TokenTree::TokenTree::drop (&stream->data[i]);
     }
-  delete[] stream->data;
+  release_buffer (stream->data);
+  stream->data = nullptr;
   stream->capacity = 0;
   stream->size = 0;
 }
@@ -102,6 +119,12 @@ TokenSream__push (TokenStream *stream, TokenTree tree)
   stream->push (tree);
 }
 
+extern "C" void
+TokenStream__reserve (TokenStream *stream, std::uint64_t additional)
+{
+  stream->reserve (additional);
+}
+
 extern "C" bool
 TokenStream__from_string (FFIString str, TokenStream *ts)
 {
@@ -115,7 +138,8 @@ TokenStream__from_string (FFIString str, TokenStream *ts)
 extern "C" TokenStream
 TokenStream__clone (const TokenStream *ts)
 {
-  auto *data = new TokenTree[ts->capacity];
+  auto *data = static_cast<TokenTree *> (
+    allocate_buffer (ts->capacity * sizeof (TokenTree)));
   std::memcpy (data, ts->data, ts->size * sizeof (TokenTree));
   return {data, ts->size, ts->capacity};
 }
@@ -40,11 +40,12 @@ struct TokenStream
 
 public:
   void grow (std::uint64_t delta);
+  void reserve (std::uint64_t additional);
   void push (TokenTree tree);
 
   TokenStream clone () const;
 
-  static TokenStream make_tokenstream (std::vector<TokenTree> vec);
+  static TokenStream make_tokenstream (const std::vector<TokenTree> &vec);
   static TokenStream make_tokenstream (std::uint64_t capacity = 1);
   static TokenStream make_tokenstream (std::string &str, bool &has_error);
 
@@ -60,6 +61,9 @@ TokenStream__with_capacity (std::uint64_t capacity);
 extern "C" void
 TokenSream__push (TokenStream *stream, TokenTree tree);
 
+extern "C" void
+TokenStream__reserve (TokenStream *stream, std::uint64_t additional);
+
 extern "C" bool
 TokenStream__from_string (FFIString str, TokenStream *ts);
 